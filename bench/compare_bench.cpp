@@ -0,0 +1,538 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Comparative benchmark of libnop against other serialization formats. Each
+// message of the shared corpus in compare_corpus.h is encoded and decoded with
+// every codec, reporting the encoded size, throughput, latency percentiles and
+// the number of allocations per operation.
+//
+// Build and run with "make compare", passing arguments in COMPARE_ARGS:
+//
+//   make compare COMPARE_ARGS="--min_time=2 Contacts"
+//
+// Arguments:
+//
+//   --min_time=SECONDS  Minimum time to run each operation (default 0.5).
+//   FILTER              Only run the case/codec names containing FILTER.
+//
+// Latencies are per operation, averaged over batches of at least 20
+// microseconds so that the clock does not dominate small messages; the
+// percentiles are over those batches.
+//
+// Protobuf is required. MessagePack (msgpack-c) is included when its headers
+// are found, which defines NOP_COMPARE_MSGPACK.
+//
+// Each codec converts the corpus to its own representation once, outside of
+// the timed loops. Encoding writes into a buffer that is reused between
+// iterations, and decoding decodes into a new value each iteration.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <compare.pb.h>
+#if NOP_COMPARE_MSGPACK
+#include <msgpack.hpp>
+#endif
+
+#include <nop/serializer.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/buffer_writer.h>
+
+#include "compare_corpus.h"
+
+namespace {
+
+// Allocations made by the current thread.
+thread_local std::size_t g_allocation_count = 0;
+
+void* CountedAllocate(std::size_t size) {
+  g_allocation_count++;
+  if (void* pointer = std::malloc(size ? size : 1))
+    return pointer;
+  throw std::bad_alloc{};
+}
+
+}  // anonymous namespace
+
+void* operator new(std::size_t size) { return CountedAllocate(size); }
+void* operator new[](std::size_t size) { return CountedAllocate(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+  g_allocation_count++;
+  return std::malloc(size ? size : 1);
+}
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+  g_allocation_count++;
+  return std::malloc(size ? size : 1);
+}
+void operator delete(void* pointer) noexcept { std::free(pointer); }
+void operator delete[](void* pointer) noexcept { std::free(pointer); }
+void operator delete(void* pointer, std::size_t) noexcept {
+  std::free(pointer);
+}
+void operator delete[](void* pointer, std::size_t) noexcept {
+  std::free(pointer);
+}
+
+namespace {
+
+template <typename T>
+void DoNotOptimize(const T& value) {
+  asm volatile("" : : "r"(&value) : "memory");
+}
+
+//
+// libnop.
+//
+
+template <typename T>
+class NopCodec {
+ public:
+  static const char* Name() { return "libnop"; }
+
+  explicit NopCodec(const T& value)
+      : value_{value}, buffer_(nop::Encoding<T>::Size(value)) {}
+
+  bool Encode() {
+    nop::Serializer<nop::BufferWriter> serializer{buffer_.data(),
+                                                  buffer_.size()};
+    if (!serializer.Write(value_))
+      return false;
+
+    size_ = serializer.writer().size();
+    return true;
+  }
+
+  bool Decode() {
+    T value;
+    nop::Deserializer<nop::BufferReader> deserializer{buffer_.data(), size_};
+    const bool result = !!deserializer.Read(&value);
+    DoNotOptimize(value);
+    return result;
+  }
+
+  std::size_t size() const { return size_; }
+
+ private:
+  T value_;
+  std::vector<std::uint8_t> buffer_;
+  std::size_t size_{0};
+};
+
+//
+// Protobuf.
+//
+
+void ToProtobuf(const corpus::MessageA& value, corpus::pb::MessageA* message) {
+  message->set_a(value.a);
+  message->set_b(value.b);
+  for (short element : value.c)
+    message->add_c(element);
+}
+
+void ToProtobuf(const corpus::MessageB& value, corpus::pb::MessageB* message) {
+  message->set_x(value.x);
+  for (int element : value.y)
+    message->add_y(element);
+  message->mutable_z()->set_first(value.z.first);
+  message->mutable_z()->set_second(value.z.second);
+}
+
+void ToProtobuf(const corpus::TableA& value, corpus::pb::TableA* message) {
+  if (value.a)
+    message->set_a(value.a.get());
+  if (value.b) {
+    for (int element : value.b.get())
+      message->add_b(element);
+  }
+  if (value.id)
+    message->set_id(value.id.get());
+  if (value.timestamp)
+    message->set_timestamp(value.timestamp.get());
+  if (value.offset)
+    message->set_offset(value.offset.get());
+  if (value.latitude)
+    message->set_latitude(value.latitude.get());
+  if (value.longitude)
+    message->set_longitude(value.longitude.get());
+  if (value.accuracy)
+    message->set_accuracy(value.accuracy.get());
+  if (value.owner)
+    message->set_owner(value.owner.get());
+  if (value.device)
+    message->set_device(value.device.get());
+  if (value.flags)
+    message->set_flags(value.flags.get());
+  if (value.version)
+    message->set_version(value.version.get());
+  if (value.balance)
+    message->set_balance(value.balance.get());
+  if (value.region)
+    message->set_region(value.region.get());
+  if (value.labels) {
+    for (const std::string& label : value.labels.get())
+      message->add_labels(label);
+  }
+  if (value.active)
+    message->set_active(value.active.get());
+}
+
+void ToProtobuf(const corpus::Samples& value, corpus::pb::Samples* message) {
+  message->set_start(value.start);
+  message->set_rate(value.rate);
+  message->mutable_values()->Add(value.values.begin(), value.values.end());
+}
+
+void ToProtobuf(const corpus::Contacts& value, corpus::pb::Contacts* message) {
+  for (const corpus::Contact& contact : value.contacts) {
+    corpus::pb::Contact* element = message->add_contacts();
+    element->set_name(contact.name);
+    element->set_email(contact.email);
+    element->set_phone(contact.phone);
+    for (const std::string& tag : contact.tags)
+      element->add_tags(tag);
+  }
+}
+
+template <typename T>
+struct ProtobufType;
+template <>
+struct ProtobufType<corpus::MessageA> {
+  using Type = corpus::pb::MessageA;
+};
+template <>
+struct ProtobufType<corpus::MessageB> {
+  using Type = corpus::pb::MessageB;
+};
+template <>
+struct ProtobufType<corpus::TableA> {
+  using Type = corpus::pb::TableA;
+};
+template <>
+struct ProtobufType<corpus::Samples> {
+  using Type = corpus::pb::Samples;
+};
+template <>
+struct ProtobufType<corpus::Contacts> {
+  using Type = corpus::pb::Contacts;
+};
+
+template <typename T>
+class ProtobufCodec {
+ public:
+  using Message = typename ProtobufType<T>::Type;
+
+  static const char* Name() { return "protobuf"; }
+
+  explicit ProtobufCodec(const T& value) {
+    ToProtobuf(value, &message_);
+    buffer_.resize(message_.ByteSizeLong());
+  }
+
+  bool Encode() {
+    size_ = message_.ByteSizeLong();
+    return size_ <= buffer_.size() &&
+           message_.SerializeToArray(buffer_.data(), static_cast<int>(size_));
+  }
+
+  bool Decode() {
+    Message message;
+    const bool result =
+        message.ParseFromArray(buffer_.data(), static_cast<int>(size_));
+    DoNotOptimize(message);
+    return result;
+  }
+
+  std::size_t size() const { return size_; }
+
+ private:
+  Message message_;
+  std::vector<std::uint8_t> buffer_;
+  std::size_t size_{0};
+};
+
+//
+// MessagePack.
+//
+
+#if NOP_COMPARE_MSGPACK
+namespace mp {
+
+struct MessageA {
+  std::uint32_t a;
+  std::string b;
+  std::vector<short> c;
+  MSGPACK_DEFINE(a, b, c);
+};
+
+struct MessageB {
+  std::uint64_t x;
+  std::vector<int> y;
+  std::pair<std::string, std::string> z;
+  MSGPACK_DEFINE(x, y, z);
+};
+
+// Tables are self-describing maps, the nearest MessagePack equivalent of
+// libnop tables and of Protobuf fields.
+struct TableA {
+  std::string a;
+  std::vector<int> b;
+  std::uint32_t id;
+  std::uint64_t timestamp;
+  std::int32_t offset;
+  double latitude;
+  double longitude;
+  float accuracy;
+  std::string owner;
+  std::string device;
+  std::uint32_t flags;
+  std::uint32_t version;
+  std::int64_t balance;
+  std::vector<std::string> labels;
+  bool active;
+  MSGPACK_DEFINE_MAP(a, b, id, timestamp, offset, latitude, longitude,
+                     accuracy, owner, device, flags, version, balance, labels,
+                     active);
+};
+
+struct Samples {
+  std::uint64_t start;
+  std::uint32_t rate;
+  std::vector<double> values;
+  MSGPACK_DEFINE(start, rate, values);
+};
+
+struct Contact {
+  std::string name;
+  std::string email;
+  std::string phone;
+  std::vector<std::string> tags;
+  MSGPACK_DEFINE(name, email, phone, tags);
+};
+
+struct Contacts {
+  std::vector<Contact> contacts;
+  MSGPACK_DEFINE(contacts);
+};
+
+}  // namespace mp
+
+mp::MessageA ToMsgpack(const corpus::MessageA& value) {
+  return {value.a, value.b, value.c};
+}
+
+mp::MessageB ToMsgpack(const corpus::MessageB& value) {
+  return {value.x, value.y, value.z};
+}
+
+mp::TableA ToMsgpack(const corpus::TableA& value) {
+  return {value.a.get(),        value.b.get(),        value.id.get(),
+          value.timestamp.get(), value.offset.get(),   value.latitude.get(),
+          value.longitude.get(), value.accuracy.get(), value.owner.get(),
+          value.device.get(),    value.flags.get(),    value.version.get(),
+          value.balance.get(),   value.labels.get(),   value.active.get()};
+}
+
+mp::Samples ToMsgpack(const corpus::Samples& value) {
+  return {value.start, value.rate, value.values};
+}
+
+mp::Contacts ToMsgpack(const corpus::Contacts& value) {
+  mp::Contacts result;
+  for (const corpus::Contact& contact : value.contacts) {
+    result.contacts.push_back(
+        {contact.name, contact.email, contact.phone, contact.tags});
+  }
+  return result;
+}
+
+template <typename T>
+class MsgpackCodec {
+ public:
+  using Type = decltype(ToMsgpack(std::declval<const T&>()));
+
+  static const char* Name() { return "msgpack"; }
+
+  explicit MsgpackCodec(const T& value) : value_{ToMsgpack(value)} {}
+
+  bool Encode() {
+    buffer_.clear();
+    msgpack::pack(buffer_, value_);
+    return true;
+  }
+
+  bool Decode() {
+    try {
+      msgpack::object_handle handle =
+          msgpack::unpack(buffer_.data(), buffer_.size());
+      Type value;
+      handle.get().convert(value);
+      DoNotOptimize(value);
+      return true;
+    } catch (const std::exception&) {
+      return false;
+    }
+  }
+
+  std::size_t size() const { return buffer_.size(); }
+
+ private:
+  Type value_;
+  msgpack::sbuffer buffer_;
+};
+#endif  // NOP_COMPARE_MSGPACK
+
+//
+// Measurement.
+//
+
+struct Options {
+  double min_time{0.5};
+  std::string filter;
+};
+
+struct Stats {
+  double throughput{0};  // MB/s.
+  double p50{0};         // ns per operation.
+  double p99{0};         // ns per operation.
+  std::size_t allocations{0};
+};
+
+using Clock = std::chrono::steady_clock;
+
+double ElapsedNs(Clock::time_point start) {
+  return std::chrono::duration<double, std::nano>(Clock::now() - start)
+      .count();
+}
+
+// Runs |op| repeatedly for at least |min_time| seconds. Returns false if any
+// call of |op| fails.
+template <typename Op>
+bool Measure(Op op, std::size_t bytes, double min_time, Stats* stats) {
+  // The first call warms up caches and storage. Allocations are counted on
+  // the second call, in the steady state.
+  if (!op())
+    return false;
+
+  const std::size_t start_count = g_allocation_count;
+  if (!op())
+    return false;
+  stats->allocations = g_allocation_count - start_count;
+
+  // Grow the batch until it takes long enough to time accurately.
+  std::size_t batch = 1;
+  while (true) {
+    const Clock::time_point start = Clock::now();
+    for (std::size_t i = 0; i < batch; i++) {
+      if (!op())
+        return false;
+    }
+    if (ElapsedNs(start) >= 20000 || batch >= (std::size_t{1} << 20))
+      break;
+    batch *= 2;
+  }
+
+  std::vector<double> samples;
+  double total_ns = 0;
+  std::size_t total_ops = 0;
+  while (total_ns < min_time * 1e9) {
+    const Clock::time_point start = Clock::now();
+    for (std::size_t i = 0; i < batch; i++) {
+      if (!op())
+        return false;
+    }
+    const double elapsed = ElapsedNs(start);
+    samples.push_back(elapsed / batch);
+    total_ns += elapsed;
+    total_ops += batch;
+  }
+
+  std::sort(samples.begin(), samples.end());
+  stats->p50 = samples[samples.size() / 2];
+  stats->p99 = samples[samples.size() * 99 / 100];
+  stats->throughput = bytes * total_ops / (total_ns / 1e9) / 1e6;
+  return true;
+}
+
+template <template <typename> class Codec, typename T>
+void Run(const char* case_name, const T& value, const Options& options) {
+  const std::string name = std::string{case_name} + "/" + Codec<T>::Name();
+  if (name.find(options.filter) == std::string::npos)
+    return;
+
+  // Throughput is in terms of the encoded size in both directions.
+  Codec<T> codec{value};
+  Stats encode;
+  Stats decode;
+  if (!codec.Encode() ||
+      !Measure([&codec] { return codec.Encode(); }, codec.size(),
+               options.min_time, &encode) ||
+      !Measure([&codec] { return codec.Decode(); }, codec.size(),
+               options.min_time, &decode)) {
+    std::printf("%-24s failed\n", name.c_str());
+    return;
+  }
+
+  std::printf("%-24s %9zu %9.0f %9.0f %9.0f %6zu %9.0f %9.0f %9.0f %6zu\n",
+              name.c_str(), codec.size(), encode.throughput, encode.p50,
+              encode.p99, encode.allocations, decode.throughput, decode.p50,
+              decode.p99, decode.allocations);
+}
+
+template <typename T>
+void RunCodecs(const char* case_name, const T& value, const Options& options) {
+  Run<NopCodec>(case_name, value, options);
+  Run<ProtobufCodec>(case_name, value, options);
+#if NOP_COMPARE_MSGPACK
+  Run<MsgpackCodec>(case_name, value, options);
+#endif
+}
+
+}  // anonymous namespace
+
+int main(int argc, char** argv) {
+  Options options;
+  for (int i = 1; i < argc; i++) {
+    const char kMinTime[] = "--min_time=";
+    if (std::strncmp(argv[i], kMinTime, sizeof(kMinTime) - 1) == 0) {
+      options.min_time = std::atof(argv[i] + sizeof(kMinTime) - 1);
+    } else if (argv[i][0] == '-') {
+      std::fprintf(stderr, "Unknown argument: %s\n", argv[i]);
+      return 1;
+    } else {
+      options.filter = argv[i];
+    }
+  }
+
+  std::printf("%-24s %9s %9s %9s %9s %6s %9s %9s %9s %6s\n", "", "", "encode",
+              "", "", "", "decode", "", "", "");
+  std::printf("%-24s %9s %9s %9s %9s %6s %9s %9s %9s %6s\n", "case/codec",
+              "bytes", "MB/s", "p50 ns", "p99 ns", "allocs", "MB/s", "p50 ns",
+              "p99 ns", "allocs");
+
+  RunCodecs("MessageA", corpus::MakeMessageA(), options);
+  RunCodecs("MessageB", corpus::MakeMessageB(), options);
+  RunCodecs("TableA", corpus::MakeTableA(), options);
+  RunCodecs("Samples", corpus::MakeSamples(), options);
+  RunCodecs("Contacts", corpus::MakeContacts(), options);
+
+  google::protobuf::ShutdownProtobufLibrary();
+  return 0;
+}
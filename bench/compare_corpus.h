@@ -0,0 +1,179 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Shared corpus of the comparative benchmark. The messages are generated from a
+// fixed seed so that every run, and every codec, encodes the same values.
+//
+// The small RPC messages are the MessageA and MessageB structures of
+// examples/variant.cpp, and the wide table extends TableA of
+// examples/table.cpp.
+
+#ifndef LIBNOP_BENCH_COMPARE_CORPUS_H_
+#define LIBNOP_BENCH_COMPARE_CORPUS_H_
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <nop/structure.h>
+#include <nop/table.h>
+
+namespace corpus {
+
+// Small RPC payloads, as in examples/variant.cpp.
+struct MessageA {
+  std::uint32_t a;
+  std::string b;
+  std::vector<short> c;
+  NOP_STRUCTURE(MessageA, a, b, c);
+};
+
+struct MessageB {
+  std::uint64_t x;
+  std::vector<int> y;
+  std::pair<std::string, std::string> z;
+  NOP_STRUCTURE(MessageB, x, y, z);
+};
+
+// Wide table with a mix of entry types, most of them set.
+struct TableA {
+  nop::Entry<std::string, 0> a;
+  nop::Entry<std::vector<int>, 1> b;
+  nop::Entry<std::uint32_t, 2> id;
+  nop::Entry<std::uint64_t, 3> timestamp;
+  nop::Entry<std::int32_t, 4> offset;
+  nop::Entry<double, 5> latitude;
+  nop::Entry<double, 6> longitude;
+  nop::Entry<float, 7> accuracy;
+  nop::Entry<std::string, 8> owner;
+  nop::Entry<std::string, 9> device;
+  nop::Entry<std::uint32_t, 10> flags;
+  nop::Entry<std::uint32_t, 11> version;
+  nop::Entry<std::int64_t, 12> balance;
+  nop::Entry<std::string, 13> region;
+  nop::Entry<std::vector<std::string>, 14> labels;
+  nop::Entry<bool, 15> active;
+  NOP_TABLE_NS("TableA", TableA, a, b, id, timestamp, offset, latitude,
+               longitude, accuracy, owner, device, flags, version, balance,
+               region, labels, active);
+};
+
+// Large numeric array.
+struct Samples {
+  std::uint64_t start;
+  std::uint32_t rate;
+  std::vector<double> values;
+  NOP_STRUCTURE(Samples, start, rate, values);
+};
+
+// String-heavy records.
+struct Contact {
+  std::string name;
+  std::string email;
+  std::string phone;
+  std::vector<std::string> tags;
+  NOP_STRUCTURE(Contact, name, email, phone, tags);
+};
+
+struct Contacts {
+  std::vector<Contact> contacts;
+  NOP_STRUCTURE(Contacts, contacts);
+};
+
+namespace detail {
+
+inline std::string RandomString(std::mt19937* random, std::size_t min_length,
+                                std::size_t max_length) {
+  const std::size_t length =
+      min_length + (*random)() % (max_length - min_length + 1);
+  std::string value(length, ' ');
+  for (char& c : value)
+    c = static_cast<char>('a' + (*random)() % 26);
+  return value;
+}
+
+}  // namespace detail
+
+inline MessageA MakeMessageA() {
+  std::mt19937 random{1};
+  MessageA value{static_cast<std::uint32_t>(random()),
+                 detail::RandomString(&random, 8, 24),
+                 {}};
+  for (int i = 0; i < 8; i++)
+    value.c.push_back(static_cast<short>(random() % 2000 - 1000));
+  return value;
+}
+
+inline MessageB MakeMessageB() {
+  std::mt19937 random{2};
+  MessageB value{random(), {}, {}};
+  for (int i = 0; i < 16; i++)
+    value.y.push_back(static_cast<int>(random() % 100000) - 50000);
+  value.z = {detail::RandomString(&random, 4, 12),
+             detail::RandomString(&random, 16, 32)};
+  return value;
+}
+
+inline TableA MakeTableA() {
+  std::mt19937 random{3};
+  TableA value;
+  value.a = detail::RandomString(&random, 8, 16);
+  value.b = std::vector<int>{1, 2, 3, 5, 8, 13, 21, 34};
+  value.id = static_cast<std::uint32_t>(random());
+  value.timestamp = std::uint64_t{1500000000000} + random();
+  value.offset = -static_cast<std::int32_t>(random() % 1000);
+  value.latitude = 37.4219983;
+  value.longitude = -122.084;
+  value.accuracy = 4.5f;
+  value.owner = detail::RandomString(&random, 8, 16);
+  value.device = detail::RandomString(&random, 16, 32);
+  value.flags = 0x15;
+  value.version = 7;
+  value.balance = -static_cast<std::int64_t>(random()) * 1000;
+  value.labels = std::vector<std::string>{"alpha", "beta", "gamma"};
+  value.active = true;
+  // Entry 13 (region) is left empty.
+  return value;
+}
+
+inline Samples MakeSamples() {
+  std::mt19937 random{4};
+  std::uniform_real_distribution<double> distribution{-1.0, 1.0};
+  Samples value{std::uint64_t{1500000000000}, 48000, {}};
+  value.values.resize(64 * 1024);
+  for (double& sample : value.values)
+    sample = distribution(random);
+  return value;
+}
+
+inline Contacts MakeContacts() {
+  std::mt19937 random{5};
+  Contacts value;
+  value.contacts.resize(1000);
+  for (Contact& contact : value.contacts) {
+    contact.name = detail::RandomString(&random, 6, 20);
+    contact.email = detail::RandomString(&random, 6, 12) + "@example.com";
+    contact.phone = std::to_string(random() % 1000000000);
+    const std::size_t tag_count = random() % 4;
+    for (std::size_t i = 0; i < tag_count; i++)
+      contact.tags.push_back(detail::RandomString(&random, 3, 10));
+  }
+  return value;
+}
+
+}  // namespace corpus
+
+#endif  // LIBNOP_BENCH_COMPARE_CORPUS_H_
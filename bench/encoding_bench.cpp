@@ -0,0 +1,563 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Microbenchmarks of the encodings against the library-provided writers and
+// readers. Each benchmark is named Write/<Case>/<Writer> or
+// Read/<Case>/<Reader> and reports the time per serialized or deserialized
+// value and the throughput of encoded bytes.
+//
+// Run with "make bench", passing Google Benchmark flags in BENCH_ARGS, e.g.:
+//
+//   make bench BENCH_ARGS=--benchmark_filter=Write/String
+
+#include <benchmark/benchmark.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <map>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <nop/serializer.h>
+#include <nop/structure.h>
+#include <nop/table.h>
+#include <nop/types/variant.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/buffer_writer.h>
+#include <nop/utility/fd_reader.h>
+#include <nop/utility/fd_writer.h>
+#include <nop/utility/pedantic_buffer_reader.h>
+#include <nop/utility/pedantic_buffer_writer.h>
+#include <nop/utility/stream_reader.h>
+#include <nop/utility/stream_writer.h>
+#include <nop/utility/streambuf_reader.h>
+#include <nop/utility/streambuf_writer.h>
+
+using nop::Blittable;
+using nop::BufferReader;
+using nop::BufferWriter;
+using nop::Deserializer;
+using nop::Encoding;
+using nop::Entry;
+using nop::FdReader;
+using nop::FdWriter;
+using nop::PedanticBufferReader;
+using nop::PedanticBufferWriter;
+using nop::Serializer;
+using nop::Status;
+using nop::StreamReader;
+using nop::StreamWriter;
+using nop::StreambufReader;
+using nop::StreambufWriter;
+using nop::Variant;
+
+namespace {
+
+//
+// Values to encode.
+//
+
+struct Record {
+  std::uint32_t id;
+  std::string name;
+  std::vector<float> values;
+  NOP_STRUCTURE(Record, id, name, values);
+};
+
+// Nested structures of small members, where the handling of the status of
+// each member dominates the encoding work.
+struct Point {
+  std::int32_t x;
+  std::int32_t y;
+  NOP_STRUCTURE(Point, x, y);
+};
+
+struct Segment {
+  Point start;
+  Point end;
+  std::uint8_t flags;
+  NOP_STRUCTURE(Segment, start, end, flags);
+};
+
+struct Path {
+  std::uint32_t id;
+  std::vector<Segment> segments;
+  NOP_STRUCTURE(Path, id, segments);
+};
+
+// Fixed-width records, encoded member by member or as blittable blocks.
+struct Tick {
+  std::uint64_t timestamp;
+  double price;
+  std::uint32_t quantity;
+  std::uint32_t venue;
+  NOP_STRUCTURE(Tick, timestamp, price, quantity, venue);
+};
+
+// Records with only fixed size members, which readers that can peek decode
+// from known offsets.
+struct Sample {
+  double time;
+  float gain;
+  std::array<float, 3> position;
+  NOP_STRUCTURE(Sample, time, gain, position);
+};
+
+struct RecordTable {
+  Entry<std::uint32_t, 0> id;
+  Entry<std::string, 1> name;
+  Entry<std::vector<float>, 2> values;
+  NOP_TABLE(RecordTable, id, name, values);
+};
+
+template <typename T, T Value>
+struct IntegerCase {
+  using Type = T;
+  static Type Make() { return Value; }
+};
+
+struct FixIntCase : IntegerCase<std::uint64_t, 100> {
+  static const char* Name() { return "FixInt"; }
+};
+struct U8Case : IntegerCase<std::uint64_t, 0xf0> {
+  static const char* Name() { return "U8"; }
+};
+struct U16Case : IntegerCase<std::uint64_t, 0xf000> {
+  static const char* Name() { return "U16"; }
+};
+struct U32Case : IntegerCase<std::uint64_t, 0xf0000000> {
+  static const char* Name() { return "U32"; }
+};
+struct U64Case : IntegerCase<std::uint64_t, 0xf000000000000000> {
+  static const char* Name() { return "U64"; }
+};
+struct I64Case : IntegerCase<std::int64_t, -0x7000000000000000> {
+  static const char* Name() { return "I64"; }
+};
+
+struct StringCase {
+  using Type = std::string;
+  static const char* Name() { return "String"; }
+  static Type Make() { return std::string(64, 'x'); }
+};
+
+struct LargeStringCase {
+  using Type = std::string;
+  static const char* Name() { return "LargeString"; }
+  static Type Make() { return std::string(4096, 'x'); }
+};
+
+struct IntegralVectorCase {
+  using Type = std::vector<std::uint32_t>;
+  static const char* Name() { return "IntegralVector"; }
+  static Type Make() { return Type(1024, 0x12345678); }
+};
+
+struct StringVectorCase {
+  using Type = std::vector<std::string>;
+  static const char* Name() { return "StringVector"; }
+  static Type Make() { return Type(64, std::string(16, 'x')); }
+};
+
+struct StringListCase {
+  using Type = nop::StringList;
+  static const char* Name() { return "StringList"; }
+  static Type Make() {
+    const auto strings = StringVectorCase::Make();
+    return Type{strings.begin(), strings.end()};
+  }
+};
+
+struct MapCase {
+  using Type = std::map<std::uint32_t, std::string>;
+  static const char* Name() { return "Map"; }
+  static Type Make() {
+    Type value;
+    for (std::uint32_t i = 0; i < 64; i++)
+      value.emplace(i * 1000, std::string(16, 'x'));
+    return value;
+  }
+};
+
+struct VariantCase {
+  using Type = Variant<std::uint32_t, std::string, std::vector<std::uint32_t>>;
+  static const char* Name() { return "Variant"; }
+  static Type Make() { return Type{std::string(64, 'x')}; }
+};
+
+struct StructureCase {
+  using Type = Record;
+  static const char* Name() { return "Structure"; }
+  static Type Make() { return {1234, std::string(32, 'x'), {64, 1.5f}}; }
+};
+
+struct NestedStructureCase {
+  using Type = std::vector<Path>;
+  static const char* Name() { return "NestedStructure"; }
+  static Type Make() {
+    const Segment segment{{1, -2}, {300, -400}, 5};
+    return Type(16, Path{1234, std::vector<Segment>(16, segment)});
+  }
+};
+
+struct TickVectorCase {
+  using Type = std::vector<Tick>;
+  static const char* Name() { return "TickVector"; }
+  static Type Make() {
+    return Type(256, Tick{1500000000000, 100.25, 12, 3});
+  }
+};
+
+struct BlittableTickVectorCase {
+  using Type = Blittable<std::vector<Tick>>;
+  static const char* Name() { return "BlittableTickVector"; }
+  static Type Make() { return TickVectorCase::Make(); }
+};
+
+struct EdgeVectorCase {
+  using Type = std::vector<std::pair<std::uint32_t, std::uint32_t>>;
+  static const char* Name() { return "EdgeVector"; }
+  static Type Make() {
+    Type edges;
+    for (std::uint32_t i = 0; i < 256; i++)
+      edges.emplace_back(i, i * 31 + 0x10000);
+    return edges;
+  }
+};
+
+struct BlittableEdgeVectorCase {
+  using Type = Blittable<EdgeVectorCase::Type>;
+  static const char* Name() { return "BlittableEdgeVector"; }
+  static Type Make() { return EdgeVectorCase::Make(); }
+};
+
+struct SampleVectorCase {
+  using Type = std::vector<Sample>;
+  static const char* Name() { return "SampleVector"; }
+  static Type Make() { return Type(256, Sample{1.5e9, 0.5f, {{1, 2, 3}}}); }
+};
+
+// Large enough that the input and the decoded vector exceed the last level
+// cache, so that decoding is bound by memory latency.
+struct LargeSampleVectorCase {
+  using Type = std::vector<Sample>;
+  static const char* Name() { return "LargeSampleVector"; }
+  static Type Make() {
+    return Type(1 << 22, Sample{1.5e9, 0.5f, {{1, 2, 3}}});
+  }
+};
+
+struct TableCase {
+  using Type = RecordTable;
+  static const char* Name() { return "Table"; }
+  static Type Make() {
+    RecordTable value;
+    value.id = 1234;
+    value.name = std::string(32, 'x');
+    value.values = std::vector<float>(64, 1.5f);
+    return value;
+  }
+};
+
+//
+// Writers and readers, wrapped in fixtures that set up the destination or
+// source once and rewind it for each iteration.
+//
+
+class BufferWriterFixture {
+ public:
+  static const char* Name() { return "BufferWriter"; }
+  explicit BufferWriterFixture(std::size_t size) : buffer_(size) {}
+
+  template <typename T>
+  Status<void> Write(const T& value) {
+    Serializer<BufferWriter> serializer{buffer_.data(), buffer_.size()};
+    return serializer.Write(value);
+  }
+
+ private:
+  std::vector<std::uint8_t> buffer_;
+};
+
+class PedanticBufferWriterFixture {
+ public:
+  static const char* Name() { return "PedanticBufferWriter"; }
+  explicit PedanticBufferWriterFixture(std::size_t size) : buffer_(size) {}
+
+  template <typename T>
+  Status<void> Write(const T& value) {
+    Serializer<PedanticBufferWriter> serializer{buffer_.data(),
+                                                buffer_.size()};
+    return serializer.Write(value);
+  }
+
+ private:
+  std::vector<std::uint8_t> buffer_;
+};
+
+class StreamWriterFixture {
+ public:
+  static const char* Name() { return "StreamWriter"; }
+  explicit StreamWriterFixture(std::size_t /*size*/) {}
+
+  template <typename T>
+  Status<void> Write(const T& value) {
+    serializer_.writer().stream().seekp(0);
+    return serializer_.Write(value);
+  }
+
+ private:
+  Serializer<StreamWriter<std::stringstream>> serializer_;
+};
+
+class StreambufWriterFixture {
+ public:
+  static const char* Name() { return "StreambufWriter"; }
+  explicit StreambufWriterFixture(std::size_t /*size*/)
+      : serializer_{&stream_} {}
+
+  template <typename T>
+  Status<void> Write(const T& value) {
+    stream_.seekp(0);
+    return serializer_.Write(value);
+  }
+
+ private:
+  std::stringstream stream_;
+  Serializer<StreambufWriter> serializer_;
+};
+
+class FdWriterFixture {
+ public:
+  static const char* Name() { return "FdWriter"; }
+  explicit FdWriterFixture(std::size_t /*size*/)
+      : serializer_{::open("/dev/null", O_WRONLY | O_CLOEXEC)} {}
+
+  template <typename T>
+  Status<void> Write(const T& value) {
+    return serializer_.Write(value);
+  }
+
+ private:
+  Serializer<FdWriter> serializer_;
+};
+
+class BufferReaderFixture {
+ public:
+  static const char* Name() { return "BufferReader"; }
+  explicit BufferReaderFixture(const std::string& data) : data_{data} {}
+
+  template <typename T>
+  Status<void> Read(T* value) {
+    Deserializer<BufferReader> deserializer{data_.data(), data_.size()};
+    return deserializer.Read(value);
+  }
+
+ private:
+  std::string data_;
+};
+
+class PedanticBufferReaderFixture {
+ public:
+  static const char* Name() { return "PedanticBufferReader"; }
+  explicit PedanticBufferReaderFixture(const std::string& data)
+      : data_{data} {}
+
+  template <typename T>
+  Status<void> Read(T* value) {
+    Deserializer<PedanticBufferReader> deserializer{data_.data(),
+                                                    data_.size()};
+    return deserializer.Read(value);
+  }
+
+ private:
+  std::string data_;
+};
+
+class StreamReaderFixture {
+ public:
+  static const char* Name() { return "StreamReader"; }
+  explicit StreamReaderFixture(const std::string& data)
+      : deserializer_{data} {}
+
+  template <typename T>
+  Status<void> Read(T* value) {
+    deserializer_.reader().stream().clear();
+    deserializer_.reader().stream().seekg(0);
+    return deserializer_.Read(value);
+  }
+
+ private:
+  Deserializer<StreamReader<std::stringstream>> deserializer_;
+};
+
+class StreambufReaderFixture {
+ public:
+  static const char* Name() { return "StreambufReader"; }
+  explicit StreambufReaderFixture(const std::string& data)
+      : stream_{data}, deserializer_{&stream_} {}
+
+  template <typename T>
+  Status<void> Read(T* value) {
+    stream_.clear();
+    stream_.seekg(0);
+    return deserializer_.Read(value);
+  }
+
+ private:
+  std::stringstream stream_;
+  Deserializer<StreambufReader> deserializer_;
+};
+
+class FdReaderFixture {
+ public:
+  static const char* Name() { return "FdReader"; }
+  explicit FdReaderFixture(const std::string& data)
+      : deserializer_{MakeFile(data)} {}
+
+  template <typename T>
+  Status<void> Read(T* value) {
+    ::lseek(fd_, 0, SEEK_SET);
+    return deserializer_.Read(value);
+  }
+
+ private:
+  // Returns an fd to an unlinked temporary file filled with |data|.
+  int MakeFile(const std::string& data) {
+    char path[] = "/tmp/nop_bench_XXXXXX";
+    fd_ = ::mkstemp(path);
+    if (fd_ < 0)
+      std::abort();
+
+    ::unlink(path);
+    if (::write(fd_, data.data(), data.size()) !=
+        static_cast<ssize_t>(data.size())) {
+      std::abort();
+    }
+    return fd_;
+  }
+
+  int fd_{-1};
+  Deserializer<FdReader> deserializer_;
+};
+
+//
+// Benchmarks.
+//
+
+template <typename Case>
+std::string Encode() {
+  Serializer<StreamWriter<std::stringstream>> serializer;
+  if (!serializer.Write(Case::Make()))
+    std::abort();
+  return serializer.writer().stream().str();
+}
+
+template <typename Case, typename Fixture>
+void WriteBenchmark(benchmark::State& state) {
+  using Type = typename Case::Type;
+  const Type value = Case::Make();
+  const std::size_t size = Encoding<Type>::Size(value);
+  Fixture fixture{size};
+
+  for (auto _ : state) {
+    auto status = fixture.Write(value);
+    if (!status) {
+      state.SkipWithError(status.GetErrorMessage());
+      break;
+    }
+  }
+
+  state.SetBytesProcessed(state.iterations() * size);
+  state.counters["bytes"] = size;
+}
+
+template <typename Case, typename Fixture>
+void ReadBenchmark(benchmark::State& state) {
+  using Type = typename Case::Type;
+  const std::string data = Encode<Case>();
+  Fixture fixture{data};
+
+  for (auto _ : state) {
+    Type value;
+    auto status = fixture.Read(&value);
+    if (!status) {
+      state.SkipWithError(status.GetErrorMessage());
+      break;
+    }
+    benchmark::DoNotOptimize(value);
+  }
+
+  state.SetBytesProcessed(state.iterations() * data.size());
+  state.counters["bytes"] = data.size();
+}
+
+template <typename... Ts>
+struct List {};
+
+using Cases = List<FixIntCase, U8Case, U16Case, U32Case, U64Case, I64Case,
+                   StringCase, LargeStringCase, IntegralVectorCase,
+                   StringVectorCase, StringListCase, MapCase, VariantCase,
+                   StructureCase, NestedStructureCase, TickVectorCase,
+                   BlittableTickVectorCase, EdgeVectorCase,
+                   BlittableEdgeVectorCase, SampleVectorCase,
+                   LargeSampleVectorCase, TableCase>;
+using WriterFixtures = List<BufferWriterFixture, PedanticBufferWriterFixture,
+                            StreamWriterFixture, StreambufWriterFixture,
+                            FdWriterFixture>;
+using ReaderFixtures = List<BufferReaderFixture, PedanticBufferReaderFixture,
+                            StreamReaderFixture, StreambufReaderFixture,
+                            FdReaderFixture>;
+
+template <typename Case, typename... Writers, typename... Readers>
+void RegisterCase(List<Writers...>, List<Readers...>) {
+  using Expand = int[];
+  (void)Expand{0, (benchmark::RegisterBenchmark(
+                       (std::string{"Write/"} + Case::Name() + "/" +
+                        Writers::Name())
+                           .c_str(),
+                       &WriteBenchmark<Case, Writers>),
+                   0)...};
+  (void)Expand{0, (benchmark::RegisterBenchmark(
+                       (std::string{"Read/"} + Case::Name() + "/" +
+                        Readers::Name())
+                           .c_str(),
+                       &ReadBenchmark<Case, Readers>),
+                   0)...};
+}
+
+template <typename... Cases>
+void RegisterBenchmarks(List<Cases...>) {
+  using Expand = int[];
+  (void)Expand{0, (RegisterCase<Cases>(WriterFixtures{}, ReaderFixtures{}),
+                   0)...};
+}
+
+}  // anonymous namespace
+
+int main(int argc, char** argv) {
+  RegisterBenchmarks(Cases{});
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv))
+    return 1;
+
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
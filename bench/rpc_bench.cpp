@@ -0,0 +1,384 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// End to end RPC latency benchmark. A client and a server thread exchange
+// NOP_INTERFACE calls through SimpleMethodSender, SimpleMethodReceiver and
+// InterfaceBindings over each transport, reporting the round trip latency
+// percentiles and the call rate for a range of argument sizes.
+//
+// Build and run with "make rpc", passing arguments in RPC_ARGS:
+//
+//   make rpc RPC_ARGS="--min_time=2 ring/"
+//
+// Arguments:
+//
+//   --min_time=SECONDS  Minimum time to run each case (default 0.5).
+//   FILTER              Only run the transport/case names containing FILTER.
+//
+// Transports:
+//
+//   pipe    A pair of pipes with BufferedFdWriter and BufferedFdReader.
+//   socket  A UNIX domain socket pair with UnixSocketWriter and
+//           UnixSocketReader, one frame per message.
+//   ring    A pair of SharedRings in shared memory.
+//
+// Every call is timed individually. The client and server run as threads of
+// the same process; on a machine with a single CPU each round trip includes
+// two context switches.
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <nop/rpc/interface.h>
+#include <nop/rpc/simple_method_receiver.h>
+#include <nop/rpc/simple_method_sender.h>
+#include <nop/serializer.h>
+#include <nop/utility/buffered_fd_reader.h>
+#include <nop/utility/buffered_fd_writer.h>
+#include <nop/utility/shared_ring.h>
+#include <nop/utility/unix_socket_reader.h>
+#include <nop/utility/unix_socket_writer.h>
+
+using nop::BindInterface;
+using nop::BufferedFdReader;
+using nop::BufferedFdWriter;
+using nop::Deserializer;
+using nop::Interface;
+using nop::MakeSimpleMethodReceiver;
+using nop::MakeSimpleMethodSender;
+using nop::Serializer;
+using nop::SharedRing;
+using nop::SharedRingReader;
+using nop::SharedRingWriter;
+using nop::Status;
+using nop::UnixSocketReader;
+using nop::UnixSocketWriter;
+
+namespace {
+
+//
+// Interface.
+//
+
+using Bytes = std::vector<std::uint8_t>;
+
+struct BenchInterface : public Interface<BenchInterface> {
+  NOP_INTERFACE("io.github.eieio.bench.rpc.Bench");
+
+  // Returns its argument; the smallest possible call.
+  NOP_METHOD(Ping, std::uint64_t(std::uint64_t));
+
+  // Returns its argument, so that the payload crosses the transport twice.
+  NOP_METHOD(Echo, Bytes(const Bytes&));
+
+  NOP_INTERFACE_API(Ping, Echo);
+};
+
+//
+// Transports.
+//
+
+// Hooks that delimit messages for each transport. Flush() passes the bytes
+// serialized since the last flush to the peer, and Fill() receives the next
+// message when the transport is frame based.
+Status<void> Flush(BufferedFdWriter* writer) { return writer->Flush(); }
+Status<void> Flush(UnixSocketWriter* writer) { return writer->Send(); }
+Status<void> Flush(SharedRingWriter* writer) { return writer->Flush(); }
+
+Status<void> Fill(BufferedFdReader* /*reader*/) { return {}; }
+Status<void> Fill(UnixSocketReader* reader) {
+  if (reader->empty())
+    return reader->Receive();
+  return {};
+}
+Status<void> Fill(SharedRingReader* /*reader*/) { return {}; }
+
+// One end of a connection, used as both the serializer and the deserializer of
+// the RPC sender and receiver. The bytes written for a call or a return value
+// are flushed once, when the endpoint next waits for input, so that the
+// method selector and arguments travel together.
+template <typename Writer, typename Reader>
+class Endpoint {
+ public:
+  template <typename WriterArg, typename ReaderArg>
+  Endpoint(WriterArg&& writer_arg, ReaderArg&& reader_arg)
+      : serializer_{std::forward<WriterArg>(writer_arg)},
+        deserializer_{std::forward<ReaderArg>(reader_arg)} {}
+
+  template <typename T>
+  Status<void> Write(const T& value) {
+    pending_ = true;
+    return serializer_.Write(value);
+  }
+
+  template <typename T>
+  Status<void> Read(T* value) {
+    if (pending_) {
+      pending_ = false;
+      auto status = Flush(&serializer_.writer());
+      if (!status)
+        return status;
+    }
+
+    auto status = Fill(&deserializer_.reader());
+    if (!status)
+      return status;
+
+    return deserializer_.Read(value);
+  }
+
+ private:
+  Serializer<Writer> serializer_;
+  Deserializer<Reader> deserializer_;
+  bool pending_{false};
+
+  Endpoint(const Endpoint&) = delete;
+  void operator=(const Endpoint&) = delete;
+};
+
+using PipeEndpoint = Endpoint<BufferedFdWriter, BufferedFdReader>;
+using SocketEndpoint = Endpoint<UnixSocketWriter, UnixSocketReader>;
+using RingEndpoint = Endpoint<SharedRingWriter, SharedRingReader>;
+
+template <typename EndpointType>
+struct Connection {
+  std::unique_ptr<EndpointType> client;
+  std::unique_ptr<EndpointType> server;
+};
+
+bool MakePipes(Connection<PipeEndpoint>* connection) {
+  int request[2];
+  int response[2];
+  if (::pipe(request) < 0)
+    return false;
+  if (::pipe(response) < 0) {
+    ::close(request[0]);
+    ::close(request[1]);
+    return false;
+  }
+
+  connection->client.reset(new PipeEndpoint{request[1], response[0]});
+  connection->server.reset(new PipeEndpoint{response[1], request[0]});
+  return true;
+}
+
+// The writer and reader of each end own separate duplicates of its socket.
+bool MakeSockets(Connection<SocketEndpoint>* connection) {
+  int sockets[2];
+  if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sockets) < 0)
+    return false;
+
+  const int client_fd = ::dup(sockets[0]);
+  const int server_fd = ::dup(sockets[1]);
+  if (client_fd < 0 || server_fd < 0) {
+    for (int fd : {sockets[0], sockets[1], client_fd, server_fd}) {
+      if (fd >= 0)
+        ::close(fd);
+    }
+    return false;
+  }
+
+  connection->client.reset(new SocketEndpoint{sockets[0], client_fd});
+  connection->server.reset(new SocketEndpoint{sockets[1], server_fd});
+  return true;
+}
+
+// Each direction has its own ring, mapped once for the writer and once for the
+// reader as a peer process would.
+bool MakeRings(Connection<RingEndpoint>* connection) {
+  enum : std::size_t { kCapacity = 1 << 20 };
+
+  auto request = SharedRing::Create(kCapacity);
+  auto response = SharedRing::Create(kCapacity);
+  if (!request || !response)
+    return false;
+
+  auto request_peer = SharedRing::Map(::dup(request.get().fd()));
+  auto response_peer = SharedRing::Map(::dup(response.get().fd()));
+  if (!request_peer || !response_peer)
+    return false;
+
+  connection->client.reset(
+      new RingEndpoint{request.take(), response_peer.take()});
+  connection->server.reset(
+      new RingEndpoint{response.take(), request_peer.take()});
+  return true;
+}
+
+//
+// Server.
+//
+
+class Service {
+ public:
+  // Handles calls until the client closes its end of the connection.
+  template <typename EndpointType>
+  void Serve(EndpointType* endpoint) {
+    auto receiver = MakeSimpleMethodReceiver(endpoint, endpoint);
+    while (kDispatcher(&receiver, this)) {
+    }
+  }
+
+ private:
+  std::uint64_t OnPing(std::uint64_t value) { return value; }
+  Bytes OnEcho(const Bytes& bytes) { return bytes; }
+
+  static constexpr auto kDispatcher = BindInterface<Service*>(
+      BenchInterface::Ping::Bind(&Service::OnPing),
+      BenchInterface::Echo::Bind(&Service::OnEcho));
+};
+
+constexpr decltype(Service::kDispatcher) Service::kDispatcher;
+
+//
+// Measurement.
+//
+
+struct Options {
+  double min_time{0.5};
+  std::string filter;
+};
+
+struct Stats {
+  double calls_per_second{0};
+  double p50{0};   // ns per call.
+  double p99{0};   // ns per call.
+  double p999{0};  // ns per call.
+};
+
+using Clock = std::chrono::steady_clock;
+
+double ElapsedNs(Clock::time_point start, Clock::time_point end) {
+  return std::chrono::duration<double, std::nano>(end - start).count();
+}
+
+// Calls |op| repeatedly for at least |min_time| seconds, timing each call.
+// Returns false if any call fails.
+template <typename Op>
+bool Measure(Op op, double min_time, Stats* stats) {
+  enum : std::size_t { kWarmupCalls = 100 };
+  for (std::size_t i = 0; i < kWarmupCalls; i++) {
+    if (!op())
+      return false;
+  }
+
+  std::vector<double> samples;
+  double total_ns = 0;
+  while (total_ns < min_time * 1e9) {
+    const Clock::time_point start = Clock::now();
+    if (!op())
+      return false;
+    const double elapsed = ElapsedNs(start, Clock::now());
+    samples.push_back(elapsed);
+    total_ns += elapsed;
+  }
+
+  std::sort(samples.begin(), samples.end());
+  stats->p50 = samples[samples.size() / 2];
+  stats->p99 = samples[samples.size() * 99 / 100];
+  stats->p999 = samples[samples.size() * 999 / 1000];
+  stats->calls_per_second = samples.size() / (total_ns / 1e9);
+  return true;
+}
+
+template <typename EndpointType, typename Op>
+void RunCase(const std::string& name, EndpointType* client, Op op,
+             const Options& options) {
+  if (name.find(options.filter) == std::string::npos)
+    return;
+
+  auto sender = MakeSimpleMethodSender(client, client);
+  Stats stats;
+  if (!Measure([&sender, &op] { return op(&sender); }, options.min_time,
+               &stats)) {
+    std::printf("%-20s failed\n", name.c_str());
+    return;
+  }
+
+  std::printf("%-20s %10.0f %10.0f %10.0f %10.0f\n", name.c_str(),
+              stats.calls_per_second, stats.p50, stats.p99, stats.p999);
+}
+
+template <typename EndpointType>
+void RunTransport(const char* transport,
+                  bool (*make)(Connection<EndpointType>*),
+                  const Options& options) {
+  Connection<EndpointType> connection;
+  if (!make(&connection)) {
+    std::printf("%-20s failed to connect\n", transport);
+    return;
+  }
+
+  EndpointType* server = connection.server.get();
+  std::thread thread{[server] { Service{}.Serve(server); }};
+
+  const std::string prefix = std::string{transport} + "/";
+  RunCase(prefix + "Ping", connection.client.get(),
+          [](auto* sender) {
+            auto status = BenchInterface::Ping::Invoke(sender, 1);
+            return status && status.get() == 1;
+          },
+          options);
+
+  for (std::size_t size : {16, 1024, 16384, 65536}) {
+    const Bytes bytes(size, 0xa5);
+    RunCase(prefix + "Echo/" + std::to_string(size), connection.client.get(),
+            [&bytes](auto* sender) {
+              auto status = BenchInterface::Echo::Invoke(sender, bytes);
+              return status && status.get().size() == bytes.size();
+            },
+            options);
+  }
+
+  // Closing the client end stops the server.
+  connection.client.reset();
+  thread.join();
+}
+
+}  // anonymous namespace
+
+int main(int argc, char** argv) {
+  Options options;
+  for (int i = 1; i < argc; i++) {
+    const char kMinTime[] = "--min_time=";
+    if (std::strncmp(argv[i], kMinTime, sizeof(kMinTime) - 1) == 0) {
+      options.min_time = std::atof(argv[i] + sizeof(kMinTime) - 1);
+    } else if (argv[i][0] == '-') {
+      std::fprintf(stderr, "Unknown argument: %s\n", argv[i]);
+      return 1;
+    } else {
+      options.filter = argv[i];
+    }
+  }
+
+  std::printf("%-20s %10s %10s %10s %10s\n", "transport/case", "calls/s",
+              "p50 ns", "p99 ns", "p999 ns");
+
+  RunTransport("pipe", MakePipes, options);
+  RunTransport("socket", MakeSockets, options);
+  RunTransport("ring", MakeRings, options);
+  return 0;
+}
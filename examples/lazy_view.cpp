@@ -0,0 +1,73 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+//
+// Example of decoding libnop messages lazily and without copying from python.
+// The shared library exports the schema of the message types with
+// NOP_PYTHON_MODULE, which python/nop_view.py uses to present encoded buffers
+// as python objects. See lazy_view.py.
+//
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <nop/serializer.h>
+#include <nop/structure.h>
+#include <nop/utility/buffer_writer.h>
+#include <nop/utility/python_module.h>
+
+namespace {
+
+// Three component vector of floats.
+struct Vec3 {
+  float x;
+  float y;
+  float z;
+  NOP_STRUCTURE(Vec3, x, y, z);
+};
+NOP_PYTHON_STRUCTURE(Vec3, x, y, z);
+
+// A recording with a large vector of samples and a few annotations.
+struct Recording {
+  std::string name;
+  std::uint64_t timestamp;
+  std::vector<std::int32_t> samples;
+  std::vector<double> gains;
+  std::vector<Vec3> markers;
+  NOP_STRUCTURE(Recording, name, timestamp, samples, gains, markers);
+};
+NOP_PYTHON_STRUCTURE(Recording, name, timestamp, samples, gains, markers);
+
+}  // anonymous namespace
+
+NOP_PYTHON_MODULE(Vec3, Recording);
+
+// Serializes a sample Recording with |count| samples into |buffer|. Returns
+// the number of bytes written or a negative error.
+extern "C" ssize_t GetSerializedRecording(void* buffer, std::size_t size,
+                                          std::size_t count) {
+  Recording recording{"example", 1234567890, {}, {0.5, 1.0, 2.0}, {}};
+  for (std::size_t i = 0; i < count; i++)
+    recording.samples.push_back(static_cast<std::int32_t>(i * i) - 50);
+  recording.markers = {{1.f, 2.f, 3.f}, {4.f, 5.f, 6.f}};
+
+  nop::Serializer<nop::BufferWriter> serializer{buffer, size};
+  auto status = serializer.Write(recording);
+  if (!status)
+    return -static_cast<ssize_t>(status.error());
+
+  return serializer.writer().size();
+}
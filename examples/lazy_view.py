@@ -0,0 +1,56 @@
+# Copyright 2018 The Native Object Protocols Authors
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+#
+# Example of decoding libnop messages lazily and without copying, using the
+# nop_view module and the schema exported by lazy_view.cpp. Run from the root
+# of the repository after building out/lazy_view.so.
+#
+
+import ctypes
+import os
+import sys
+
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), '..', 'python'))
+import nop_view
+
+def main():
+  module = nop_view.Module('out/lazy_view.so')
+
+  GetSerializedRecording = module._library.GetSerializedRecording
+  GetSerializedRecording.argtypes = (ctypes.c_void_p, ctypes.c_size_t,
+                                     ctypes.c_size_t)
+  GetSerializedRecording.restype = ctypes.c_ssize_t
+
+  # Get a serialized Recording from the library.
+  buffer = bytearray(1 << 20)
+  address = ctypes.addressof((ctypes.c_char * len(buffer)).from_buffer(buffer))
+  count = GetSerializedRecording(address, len(buffer), 10000)
+  if count < 0:
+    print('Error:', -count)
+    return
+
+  # Nothing is decoded until the members are accessed.
+  recording = module.view('Recording', memoryview(buffer)[:count])
+  print('name:', recording.name, 'timestamp:', recording.timestamp)
+
+  # The samples refer to the buffer directly.
+  samples = recording.samples
+  print('samples:', len(samples), 'last:', samples[-1])
+
+  print('gains:', list(recording.gains))
+  print('markers:', [(m.x, m.y, m.z) for m in recording.markers])
+
+if __name__ == '__main__':
+  main()
@@ -25,20 +25,20 @@
 #include <nop/structure.h>
 #include <nop/types/file_handle.h>
 #include <nop/types/result.h>
+#include <nop/utility/buffered_fd_reader.h>
+#include <nop/utility/buffered_fd_writer.h>
 #include <nop/utility/die.h>
-#include <nop/utility/stream_reader.h>
-#include <nop/utility/stream_writer.h>
 
 #include "stream_utilities.h"
 #include "string_to_hex.h"
 
+using nop::BufferedFdReader;
+using nop::BufferedFdWriter;
 using nop::Deserializer;
 using nop::ErrorStatus;
 using nop::Result;
 using nop::Serializer;
 using nop::Status;
-using nop::StreamReader;
-using nop::StreamWriter;
 using nop::StringToHex;
 using nop::UniqueFileHandle;
 
@@ -48,8 +48,8 @@ auto Die(const char* error_message = "Error") {
   return nop::Die(std::cerr, error_message);
 }
 
-using Reader = StreamReader<FdInputStream>;
-using Writer = StreamWriter<FdOutputStream>;
+using Reader = BufferedFdReader;
+using Writer = BufferedFdWriter;
 
 // Utility class to combine a serializer and deserializer into a single
 // bi-directional entity.
@@ -62,9 +62,15 @@ struct Channel {
     return deserializer.Read(value);
   }
 
+  // Writes |value| and flushes the writer so that the peer receives the
+  // complete message.
   template <typename T>
   Status<void> Write(const T& value) {
-    return serializer.Write(value);
+    auto status = serializer.Write(value);
+    if (!status)
+      return status;
+
+    return serializer.writer().Flush();
   }
 };
 
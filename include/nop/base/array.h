@@ -18,6 +18,7 @@
 #define LIBNOP_INCLUDE_NOP_BASE_ARRAY_H_
 
 #include <array>
+#include <type_traits>
 
 #include <nop/base/encoding.h>
 #include <nop/base/utility.h>
@@ -44,6 +45,13 @@ namespace nop {
 // Elements are stored as direct little-endian representation of the integral
 // value, each element is sizeof(T) bytes in size.
 //
+// Arrays of floating point and enumeration types are written with the ARY
+// encoding, but std::array<T, N> also accepts the BIN encoding when reading,
+// with each element stored as the direct little-endian IEEE 754 representation
+// or the little-endian representation of the underlying integer type,
+// respectively. Writers opt into the BIN encoding for these types with the
+// Binary<T> wrapper.
+//
 
 template <typename T, std::size_t Length>
 struct Encoding<std::array<T, Length>, EnableIfNotIntegral<T>>
@@ -55,6 +63,9 @@ struct Encoding<std::array<T, Length>, EnableIfNotIntegral<T>>
   }
 
   static constexpr std::size_t Size(const Type& value) {
+    if (HasFixedEncodingSize<T>::value)
+      return FixedEncodingSize<Type>::value;
+
     std::size_t element_size_sum = 0;
     for (std::size_t i=0; i < Length; i++)
       element_size_sum += Encoding<T>::Size(value[i]);
@@ -64,7 +75,8 @@ struct Encoding<std::array<T, Length>, EnableIfNotIntegral<T>>
   }
 
   static constexpr bool Match(EncodingByte prefix) {
-    return prefix == EncodingByte::Array;
+    return prefix == EncodingByte::Array ||
+           (IsBinaryElement<T>::value && prefix == EncodingByte::Binary);
   }
 
   template <typename Writer>
@@ -85,8 +97,11 @@ struct Encoding<std::array<T, Length>, EnableIfNotIntegral<T>>
   }
 
   template <typename Reader>
-  static constexpr Status<void> ReadPayload(EncodingByte /*prefix*/,
-                                            Type* value, Reader* reader) {
+  static constexpr Status<void> ReadPayload(EncodingByte prefix, Type* value,
+                                            Reader* reader) {
+    if (prefix == EncodingByte::Binary)
+      return ReadBinaryPayload(value, reader, IsBinaryElement<T>{});
+
     SizeType size = 0;
     auto status = Encoding<SizeType>::Read(&size, reader);
     if (!status)
@@ -102,6 +117,30 @@ struct Encoding<std::array<T, Length>, EnableIfNotIntegral<T>>
 
     return {};
   }
+
+ private:
+  // Reads the BIN encoding of a floating point or enumeration array.
+  template <typename Reader>
+  static constexpr Status<void> ReadBinaryPayload(Type* value,
+                                                  Reader* reader,
+                                                  std::true_type) {
+    SizeType size = 0;
+    auto status = Encoding<SizeType>::Read(&size, reader);
+    if (!status)
+      return status;
+    else if (size != Length * sizeof(T))
+      return ErrorStatus::InvalidContainerLength;
+
+    return ReadElements(value->data(), value->data() + Length, reader);
+  }
+
+  // Match() never accepts BIN for other element types.
+  template <typename Reader>
+  static constexpr Status<void> ReadBinaryPayload(Type* /*value*/,
+                                                  Reader* /*reader*/,
+                                                  std::false_type) {
+    return ErrorStatus::UnexpectedEncodingType;
+  }
 };
 
 template <typename T, std::size_t Length>
@@ -113,6 +152,9 @@ struct Encoding<T[Length], EnableIfNotIntegral<T>> : EncodingIO<T[Length]> {
   }
 
   static constexpr std::size_t Size(const Type& value) {
+    if (HasFixedEncodingSize<T>::value)
+      return FixedEncodingSize<Type>::value;
+
     std::size_t element_size_sum = 0;
     for (std::size_t i=0; i < Length; i++)
       element_size_sum += Encoding<T>::Size(value[i]);
@@ -189,7 +231,7 @@ struct Encoding<std::array<T, Length>, EnableIfIntegral<T>>
     if (!status)
       return status;
 
-    return writer->Write(value.begin(), value.end());
+    return WriteElements(value.data(), value.data() + Length, writer);
   }
 
   template <typename Reader>
@@ -202,7 +244,7 @@ struct Encoding<std::array<T, Length>, EnableIfIntegral<T>>
     else if (size != Length * sizeof(T))
       return ErrorStatus::InvalidContainerLength;
 
-    return reader->Read(&(*value)[0], &(*value)[Length]);
+    return ReadElements(value->data(), value->data() + Length, reader);
   }
 };
 
@@ -232,7 +274,7 @@ struct Encoding<T[Length], EnableIfIntegral<T>> : EncodingIO<T[Length]> {
     if (!status)
       return status;
 
-    return writer->Write(&value[0], &value[Length]);
+    return WriteElements(&value[0], &value[Length], writer);
   }
 
   template <typename Reader>
@@ -245,10 +287,28 @@ struct Encoding<T[Length], EnableIfIntegral<T>> : EncodingIO<T[Length]> {
     else if (size != Length * sizeof(T))
       return ErrorStatus::InvalidContainerLength;
 
-    return reader->Read(&(*value)[0], &(*value)[Length]);
+    return ReadElements(&(*value)[0], &(*value)[Length], reader);
   }
 };
 
+// Arrays have a fixed encoded size when the element type is integral or has a
+// fixed encoded size.
+template <typename T, std::size_t Length>
+struct FixedEncodingSize<std::array<T, Length>, EnableIfNotIntegral<T>>
+    : FixedContainerEncodingSize<T, EncodingByte::Array, Length> {};
+template <typename T, std::size_t Length>
+struct FixedEncodingSize<T[Length], EnableIfNotIntegral<T>>
+    : FixedContainerEncodingSize<T, EncodingByte::Array, Length> {};
+template <typename T, std::size_t Length>
+struct FixedEncodingSize<std::array<T, Length>, EnableIfIntegral<T>>
+    : std::integral_constant<std::size_t,
+                             BaseEncodingSize(EncodingByte::Binary) +
+                                 Encoding<SizeType>::Size(Length * sizeof(T)) +
+                                 Length * sizeof(T)> {};
+template <typename T, std::size_t Length>
+struct FixedEncodingSize<T[Length], EnableIfIntegral<T>>
+    : FixedEncodingSize<std::array<T, Length>> {};
+
 }  // namespace nop
 
 #endif  // LIBNOP_INCLUDE_NOP_BASE_ARRAY_H_
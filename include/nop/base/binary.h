@@ -0,0 +1,94 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_BASE_BINARY_H_
+#define LIBNOP_INCLUDE_NOP_BASE_BINARY_H_
+
+#include <nop/base/array.h>
+#include <nop/base/encoding.h>
+#include <nop/base/vector.h>
+#include <nop/types/binary.h>
+
+namespace nop {
+
+//
+// Binary<Container> encoding format:
+//
+// +-----+---------+---//----+
+// | BIN | INT64:L | L BYTES |
+// +-----+---------+---//----+
+//
+// Where L = N * sizeof(T) and T is the element type of the container.
+//
+// Elements are stored as direct little-endian representation of the value, or
+// of the underlying integer type for enumerations; each element is sizeof(T)
+// bytes in size. The payload is written with a single call to the writer.
+//
+// Reading is delegated to the encoding of the container, which accepts both the
+// BIN and ARY encodings for floating point and enumeration elements.
+//
+
+template <typename Container>
+struct Encoding<Binary<Container>> : EncodingIO<Binary<Container>> {
+  using Type = Binary<Container>;
+  using ElementType = typename Container::value_type;
+
+  static constexpr EncodingByte Prefix(const Type& /*value*/) {
+    return EncodingByte::Binary;
+  }
+
+  static constexpr std::size_t Size(const Type& value) {
+    const SizeType size = value.get().size() * sizeof(ElementType);
+    return BaseEncodingSize(Prefix(value)) + Encoding<SizeType>::Size(size) +
+           size;
+  }
+
+  static constexpr bool Match(EncodingByte prefix) {
+    return Encoding<Container>::Match(prefix);
+  }
+
+  template <typename Writer>
+  static constexpr Status<void> WritePayload(EncodingByte /*prefix*/,
+                                             const Type& value,
+                                             Writer* writer) {
+    const SizeType length = value.get().size();
+    auto status = Encoding<SizeType>::Write(length * sizeof(ElementType),
+                                            writer);
+    if (!status)
+      return status;
+
+    return WriteElements(value.get().data(), value.get().data() + length,
+                         writer);
+  }
+
+  template <typename Reader>
+  static constexpr Status<void> ReadPayload(EncodingByte prefix, Type* value,
+                                            Reader* reader) {
+    return Encoding<Container>::ReadPayload(prefix, &value->get(), reader);
+  }
+};
+
+// Binary arrays have a fixed encoded size.
+template <typename T, std::size_t Length>
+struct FixedEncodingSize<Binary<std::array<T, Length>>>
+    : std::integral_constant<std::size_t,
+                             BaseEncodingSize(EncodingByte::Binary) +
+                                 Encoding<SizeType>::Size(Length * sizeof(T)) +
+                                 Length * sizeof(T)> {};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_BASE_BINARY_H_
@@ -0,0 +1,208 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_BASE_BITSET_H_
+#define LIBNOP_INCLUDE_NOP_BASE_BITSET_H_
+
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <nop/base/encoding.h>
+#include <nop/utility/endian.h>
+
+namespace nop {
+
+//
+// std::bitset<N> and std::vector<bool> encoding format:
+//
+// +-----+---------+---------+---//----+
+// | BIN | INT64:L | INT64:N | K BYTES |
+// +-----+---------+---------+---//----+
+//
+// Where N is the number of flags, K = ceil(N / 8), and L is the number of bytes
+// that follow it. Flag I is stored in bit I % 8 of byte I / 8, and the unused
+// high bits of the last byte are written as zero.
+//
+// Flags are packed and unpacked 64 at a time through a word in little-endian
+// byte order, and the bytes are written and read in batches through a local
+// buffer. The encoding of std::vector<bool> is in base/vector.h.
+//
+
+namespace detail {
+
+enum : std::size_t { kBitBatchBytes = 256 };
+
+// Returns the number of bytes that hold |count| flags.
+constexpr SizeType BitBytes(SizeType count) {
+  return count / 8 + (count % 8 != 0 ? 1 : 0);
+}
+
+// Returns the length L of the encoding of |count| flags.
+constexpr SizeType BitPayloadSize(SizeType count) {
+  return Encoding<SizeType>::Size(count) + BitBytes(count);
+}
+
+// Returns the encoded size of |count| flags.
+constexpr std::size_t BitEncodingSize(SizeType count) {
+  return BaseEncodingSize(EncodingByte::Binary) +
+         Encoding<SizeType>::Size(BitPayloadSize(count)) +
+         BitPayloadSize(count);
+}
+
+// Writes the payload of the encoding of the |count| flags returned by
+// |get(index)|.
+template <typename Get, typename Writer>
+Status<void> WriteBits(SizeType count, Get get, Writer* writer) {
+  auto status = Encoding<SizeType>::Write(BitPayloadSize(count), writer);
+  if (!status)
+    return status;
+
+  status = Encoding<SizeType>::Write(count, writer);
+  if (!status)
+    return status;
+
+  std::uint8_t batch[kBitBatchBytes];
+  std::size_t size = 0;
+  for (SizeType begin = 0; begin < count; begin += 64) {
+    const SizeType end = count - begin < 64 ? count : begin + 64;
+
+    std::uint64_t word = 0;
+    for (SizeType i = begin; i < end; i++)
+      word |= std::uint64_t{get(i) ? 1u : 0u} << (i - begin);
+
+    word = HostEndian<std::uint64_t>::ToLittle(word);
+    const std::size_t bytes = BitBytes(end - begin);
+    std::memcpy(batch + size, &word, bytes);
+    size += bytes;
+
+    if (size == kBitBatchBytes || end == count) {
+      status = writer->Write(batch, batch + size);
+      if (!status)
+        return status;
+      size = 0;
+    }
+  }
+
+  return {};
+}
+
+// Reads the length and count of the encoding of flags, checking that they
+// agree.
+template <typename Reader>
+Status<SizeType> ReadBitCount(Reader* reader) {
+  SizeType length = 0;
+  auto status = Encoding<SizeType>::Read(&length, reader);
+  if (!status)
+    return status.error();
+
+  // Make sure the reader has enough data to fulfill the requested size as a
+  // defense against abusive or erroneous sizes.
+  status = reader->Ensure(length);
+  if (!status)
+    return status.error();
+
+  SizeType count = 0;
+  status = Encoding<SizeType>::Read(&count, reader);
+  if (!status)
+    return status.error();
+  else if (length != BitPayloadSize(count))
+    return ErrorStatus::InvalidContainerLength;
+  else
+    return count;
+}
+
+// Reads |count| packed flags, passing each to |set(index, flag)|.
+template <typename Set, typename Reader>
+Status<void> ReadBits(SizeType count, Set set, Reader* reader) {
+  std::uint8_t batch[kBitBatchBytes];
+  std::size_t size = 0;
+  std::size_t offset = 0;
+  for (SizeType begin = 0; begin < count; begin += 64) {
+    const SizeType end = count - begin < 64 ? count : begin + 64;
+    const std::size_t bytes = BitBytes(end - begin);
+
+    if (offset == size) {
+      const SizeType remaining = BitBytes(count) - begin / 8;
+      size = remaining < kBitBatchBytes ? remaining : kBitBatchBytes;
+      offset = 0;
+
+      auto status = reader->Read(batch, batch + size);
+      if (!status)
+        return status;
+    }
+
+    std::uint64_t word = 0;
+    std::memcpy(&word, batch + offset, bytes);
+    word = HostEndian<std::uint64_t>::FromLittle(word);
+    offset += bytes;
+
+    for (SizeType i = begin; i < end; i++)
+      set(i, ((word >> (i - begin)) & 1) != 0);
+  }
+
+  return {};
+}
+
+}  // namespace detail
+
+template <std::size_t Length>
+struct Encoding<std::bitset<Length>> : EncodingIO<std::bitset<Length>> {
+  using Type = std::bitset<Length>;
+
+  static constexpr EncodingByte Prefix(const Type& /*value*/) {
+    return EncodingByte::Binary;
+  }
+
+  static constexpr std::size_t Size(const Type& /*value*/) {
+    return detail::BitEncodingSize(Length);
+  }
+
+  static constexpr bool Match(EncodingByte prefix) {
+    return prefix == EncodingByte::Binary;
+  }
+
+  template <typename Writer>
+  static Status<void> WritePayload(EncodingByte /*prefix*/, const Type& value,
+                                   Writer* writer) {
+    return detail::WriteBits(
+        Length, [&value](SizeType index) { return value[index]; }, writer);
+  }
+
+  template <typename Reader>
+  static Status<void> ReadPayload(EncodingByte /*prefix*/, Type* value,
+                                  Reader* reader) {
+    auto count = detail::ReadBitCount(reader);
+    if (!count)
+      return count.error();
+    else if (count.get() != Length)
+      return ErrorStatus::InvalidContainerLength;
+
+    return detail::ReadBits(
+        Length, [value](SizeType index, bool flag) { value->set(index, flag); },
+        reader);
+  }
+};
+
+template <std::size_t Length>
+struct FixedEncodingSize<std::bitset<Length>>
+    : std::integral_constant<std::size_t, detail::BitEncodingSize(Length)> {};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_BASE_BITSET_H_
@@ -0,0 +1,575 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_BASE_BLITTABLE_H_
+#define LIBNOP_INCLUDE_NOP_BASE_BLITTABLE_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <nop/base/encoding.h>
+#include <nop/base/utility.h>
+#include <nop/types/blittable.h>
+#include <nop/types/detail/member_pointer.h>
+#include <nop/utility/endian.h>
+
+namespace nop {
+
+//
+// Blittable<T> encoding format:
+//
+// +-----+---------+--------+-----//----+
+// | BIN | INT64:L | U64:H  | S BYTES   |
+// +-----+---------+--------+-----//----+
+//
+// Blittable<std::vector<T>> and Blittable<std::array<T, N>> encoding format:
+//
+// +-----+---------+--------+-----//----+
+// | BIN | INT64:L | U64:H  | N*S BYTES |
+// +-----+---------+--------+-----//----+
+//
+// Where S is the size of the fields of T, L is the number of bytes that follow
+// it, including the eight bytes of H, and H is the layout hash of T. T is a
+// structure or a std::pair or std::tuple.
+//
+// The members of a structure are stored at their offsets in T in little-endian
+// byte order, which on little-endian hosts is the object representation of T,
+// and S = sizeof(T). The elements of a pair or tuple are stored one after the
+// other in little-endian byte order, and S is the sum of their sizes.
+//
+// The layout hash is the 64-bit FNV-1a hash of S and the kind and size of each
+// member, in declaration order. A reader rejects payloads with a different hash
+// with ErrorStatus::InvalidLayoutHash, so that incompatible changes to the
+// structure fail to decode rather than decode incorrectly. A pair or tuple has
+// the same layout, and therefore the same encoding, as a structure with members
+// of the same types.
+//
+
+namespace detail {
+
+enum : std::uint64_t {
+  kBlittableOffsetBasis = 0xcbf29ce484222325,
+  kBlittablePrime = 0x100000001b3,
+};
+
+// Mixes the eight bytes of |value| into the layout |hash|.
+constexpr std::uint64_t BlittableMix(std::uint64_t hash, std::uint64_t value) {
+  for (std::size_t i = 0; i < sizeof(value); i++)
+    hash = (hash ^ ((value >> (i * 8)) & 0xff)) * kBlittablePrime;
+  return hash;
+}
+
+// Mixes the kind and size of a field of type T into the layout |hash|.
+template <typename T>
+constexpr std::uint64_t BlittableMixField(std::uint64_t hash) {
+  static_assert(std::is_arithmetic<T>::value && !std::is_same<T, bool>::value,
+                "Blittable members and elements must be integral or floating "
+                "point types other than bool.");
+  const std::uint8_t kind = std::is_floating_point<T>::value
+                                ? 'f'
+                                : std::is_signed<T>::value ? 'i' : 'u';
+  return BlittableMix(BlittableMix(hash, kind), sizeof(T));
+}
+
+// Compile-time properties of a structure encoded with Blittable<T>.
+template <typename T>
+struct BlittableLayout {
+  static_assert(HasMemberList<T>::value,
+                "Blittable type must be a structure annotated with "
+                "NOP_STRUCTURE or NOP_EXTERNAL_STRUCTURE, or a std::pair or "
+                "std::tuple.");
+  static_assert(std::is_trivially_copyable<T>::value &&
+                    std::is_standard_layout<T>::value,
+                "Blittable type must be trivially copyable and standard "
+                "layout.");
+
+  enum : std::size_t { Count = MemberListTraits<T>::MemberList::Count };
+
+  using MemberList = typename MemberListTraits<T>::MemberList;
+
+  template <std::size_t Index>
+  using PointerAt = typename MemberList::template At<Index>;
+
+  template <std::size_t Index>
+  using MemberAt = typename PointerAt<Index>::Type;
+
+  // The encoding of an element is its object representation on little-endian
+  // hosts, so sequences of elements are copied as one block.
+  static constexpr bool kContiguous = kLittleEndianHost;
+
+  // Returns the number of bytes that encode an element.
+  static constexpr std::size_t Size() { return sizeof(T); }
+
+  // Returns the layout hash of T.
+  static constexpr std::uint64_t Hash() {
+    return MembersHash(BlittableMix(kBlittableOffsetBasis, sizeof(T)),
+                       Index<Count>{});
+  }
+
+  // Converts the members of |value| between host and little-endian byte order
+  // in place. Does nothing on little-endian hosts.
+  static void ConvertLittle(T* value) {
+    if (!kLittleEndianHost)
+      ConvertLittle(value, Index<Count>{});
+  }
+
+  // Stores the encoding of |value| in the Size() bytes at |bytes|.
+  static void Store(const T& value, std::uint8_t* bytes) {
+    T element = value;
+    ConvertLittle(&element);
+    std::memcpy(bytes, &element, sizeof(T));
+  }
+
+  // Loads |value| from the encoding in the Size() bytes at |bytes|.
+  static void Load(const std::uint8_t* bytes, T* value) {
+    std::memcpy(value, bytes, sizeof(T));
+    ConvertLittle(value);
+  }
+
+ private:
+  static constexpr std::size_t MembersSize(Index<0>) { return 0; }
+
+  template <std::size_t index>
+  static constexpr std::size_t MembersSize(Index<index>) {
+    return MembersSize(Index<index - 1>{}) + sizeof(MemberAt<index - 1>);
+  }
+
+  static_assert(MembersSize(Index<Count>{}) == sizeof(T),
+                "Blittable structures must list every member and must not "
+                "contain padding.");
+
+  static constexpr std::uint64_t MembersHash(std::uint64_t hash, Index<0>) {
+    return hash;
+  }
+
+  template <std::size_t index>
+  static constexpr std::uint64_t MembersHash(std::uint64_t hash,
+                                             Index<index>) {
+    return BlittableMixField<MemberAt<index - 1>>(
+        MembersHash(hash, Index<index - 1>{}));
+  }
+
+  static void ConvertLittle(T* /*value*/, Index<0>) {}
+
+  template <std::size_t index>
+  static void ConvertLittle(T* value, Index<index>) {
+    ConvertLittle(value, Index<index - 1>{});
+    auto* member = PointerAt<index - 1>::Resolve(value);
+    *member = HostEndian<MemberAt<index - 1>>::ToLittle(*member);
+  }
+};
+
+// Compile-time properties of a std::pair or std::tuple encoded with
+// Blittable<T>. The layout of pairs and tuples in memory is unspecified, so the
+// elements are always stored and loaded one at a time.
+template <typename T>
+struct BlittableTupleLayout {
+  enum : std::size_t { Count = std::tuple_size<T>::value };
+
+  template <std::size_t Index>
+  using ElementAt = std::tuple_element_t<Index, T>;
+
+  static constexpr bool kContiguous = false;
+
+  static constexpr std::size_t Size() { return ElementsSize(Index<Count>{}); }
+
+  static constexpr std::uint64_t Hash() {
+    return ElementsHash(BlittableMix(kBlittableOffsetBasis, Size()),
+                        Index<Count>{});
+  }
+
+  static void Store(const T& value, std::uint8_t* bytes) {
+    Store(value, bytes, Index<Count>{});
+  }
+
+  static void Load(const std::uint8_t* bytes, T* value) {
+    Load(bytes, value, Index<Count>{});
+  }
+
+ private:
+  static constexpr std::size_t ElementsSize(Index<0>) { return 0; }
+
+  template <std::size_t index>
+  static constexpr std::size_t ElementsSize(Index<index>) {
+    return ElementsSize(Index<index - 1>{}) + sizeof(ElementAt<index - 1>);
+  }
+
+  static constexpr std::uint64_t ElementsHash(std::uint64_t hash, Index<0>) {
+    return hash;
+  }
+
+  template <std::size_t index>
+  static constexpr std::uint64_t ElementsHash(std::uint64_t hash,
+                                              Index<index>) {
+    return BlittableMixField<ElementAt<index - 1>>(
+        ElementsHash(hash, Index<index - 1>{}));
+  }
+
+  static void Store(const T& /*value*/, std::uint8_t* /*bytes*/, Index<0>) {}
+
+  template <std::size_t index>
+  static void Store(const T& value, std::uint8_t* bytes, Index<index>) {
+    Store(value, bytes, Index<index - 1>{});
+    using Element = ElementAt<index - 1>;
+    const Element element =
+        HostEndian<Element>::ToLittle(std::get<index - 1>(value));
+    std::memcpy(bytes + ElementsSize(Index<index - 1>{}), &element,
+                sizeof(Element));
+  }
+
+  static void Load(const std::uint8_t* /*bytes*/, T* /*value*/, Index<0>) {}
+
+  template <std::size_t index>
+  static void Load(const std::uint8_t* bytes, T* value, Index<index>) {
+    Load(bytes, value, Index<index - 1>{});
+    using Element = ElementAt<index - 1>;
+    Element element;
+    std::memcpy(&element, bytes + ElementsSize(Index<index - 1>{}),
+                sizeof(Element));
+    std::get<index - 1>(*value) = HostEndian<Element>::FromLittle(element);
+  }
+};
+
+template <typename T>
+struct IsBlittableTuple : std::false_type {};
+template <typename First, typename Second>
+struct IsBlittableTuple<std::pair<First, Second>> : std::true_type {};
+template <typename... Types>
+struct IsBlittableTuple<std::tuple<Types...>> : std::true_type {};
+
+// Selects the layout of the element type T.
+template <typename T>
+using BlittableLayoutOf =
+    std::conditional_t<IsBlittableTuple<T>::value, BlittableTupleLayout<T>,
+                       BlittableLayout<T>>;
+
+// Enables the single element encoding for structures, pairs and tuples.
+template <typename T, typename Return = void>
+using EnableIfBlittableElement =
+    std::enable_if_t<HasMemberList<T>::value || IsBlittableTuple<T>::value,
+                     Return>;
+
+// Reads the length and layout hash of a blittable payload, returning the
+// number of bytes of elements that follow.
+template <typename T, typename Reader>
+Status<SizeType> ReadBlittableHeader(Reader* reader) {
+  SizeType length = 0;
+  auto status = Encoding<SizeType>::Read(&length, reader);
+  if (!status)
+    return status.error();
+  else if (length < sizeof(std::uint64_t))
+    return ErrorStatus::InvalidContainerLength;
+
+  std::uint64_t hash = 0;
+  status = ReadElements(&hash, &hash + 1, reader);
+  if (!status)
+    return status.error();
+  else if (hash != BlittableLayoutOf<T>::Hash())
+    return ErrorStatus::InvalidLayoutHash;
+
+  return length - sizeof(hash);
+}
+
+// Writes the length and layout hash of a blittable payload with |count|
+// elements of type T.
+template <typename T, typename Writer>
+Status<void> WriteBlittableHeader(std::size_t count, Writer* writer) {
+  using Layout = BlittableLayoutOf<T>;
+  auto status = Encoding<SizeType>::Write(
+      sizeof(std::uint64_t) + count * Layout::Size(), writer);
+  if (!status)
+    return status;
+
+  const std::uint64_t hash = Layout::Hash();
+  return WriteElements(&hash, &hash + 1, writer);
+}
+
+// Size of the stack buffer used to store and load elements that are not
+// contiguous, so that the writer or reader is called once per block of
+// elements rather than once per element.
+enum : std::size_t { kBlittableBlockSize = 512 };
+
+template <typename T, typename Writer>
+Status<void> WriteBlittableElements(const T* begin, std::size_t count,
+                                    Writer* writer, std::true_type) {
+  const auto* bytes = reinterpret_cast<const std::uint8_t*>(begin);
+  return writer->Write(bytes, bytes + count * sizeof(T));
+}
+
+template <typename T, typename Writer>
+Status<void> WriteBlittableElements(const T* begin, std::size_t count,
+                                    Writer* writer, std::false_type) {
+  using Layout = BlittableLayoutOf<T>;
+  constexpr std::size_t kElementSize = Layout::Size();
+  constexpr std::size_t kBlockCount = kBlittableBlockSize / kElementSize > 0
+                                          ? kBlittableBlockSize / kElementSize
+                                          : 1;
+  std::uint8_t block[kBlockCount * kElementSize];
+
+  while (count > 0) {
+    const std::size_t block_count = count < kBlockCount ? count : kBlockCount;
+    for (std::size_t i = 0; i < block_count; i++)
+      Layout::Store(begin[i], block + i * kElementSize);
+
+    auto status = writer->Write(block, block + block_count * kElementSize);
+    if (!status)
+      return status;
+
+    begin += block_count;
+    count -= block_count;
+  }
+  return {};
+}
+
+// Writes the encoding of the |count| elements at |begin|.
+template <typename T, typename Writer>
+Status<void> WriteBlittableElements(const T* begin, std::size_t count,
+                                    Writer* writer) {
+  using Contiguous =
+      std::integral_constant<bool, BlittableLayoutOf<T>::kContiguous>;
+  return WriteBlittableElements(begin, count, writer, Contiguous{});
+}
+
+template <typename T, typename Reader>
+Status<void> ReadBlittableElements(T* begin, std::size_t count,
+                                   Reader* reader, std::true_type) {
+  auto* bytes = reinterpret_cast<std::uint8_t*>(begin);
+  return reader->Read(bytes, bytes + count * sizeof(T));
+}
+
+template <typename T, typename Reader>
+Status<void> ReadBlittableElements(T* begin, std::size_t count,
+                                   Reader* reader, std::false_type) {
+  using Layout = BlittableLayoutOf<T>;
+  constexpr std::size_t kElementSize = Layout::Size();
+  constexpr std::size_t kBlockCount = kBlittableBlockSize / kElementSize > 0
+                                          ? kBlittableBlockSize / kElementSize
+                                          : 1;
+  std::uint8_t block[kBlockCount * kElementSize];
+
+  while (count > 0) {
+    const std::size_t block_count = count < kBlockCount ? count : kBlockCount;
+    auto status = reader->Read(block, block + block_count * kElementSize);
+    if (!status)
+      return status;
+
+    for (std::size_t i = 0; i < block_count; i++)
+      Layout::Load(block + i * kElementSize, &begin[i]);
+
+    begin += block_count;
+    count -= block_count;
+  }
+  return {};
+}
+
+// Reads the encoding of |count| elements into the elements at |begin|.
+template <typename T, typename Reader>
+Status<void> ReadBlittableElements(T* begin, std::size_t count,
+                                   Reader* reader) {
+  using Contiguous =
+      std::integral_constant<bool, BlittableLayoutOf<T>::kContiguous>;
+  return ReadBlittableElements(begin, count, reader, Contiguous{});
+}
+
+}  // namespace detail
+
+template <typename T>
+struct Encoding<Blittable<T>, detail::EnableIfBlittableElement<T>>
+    : EncodingIO<Blittable<T>> {
+  using Type = Blittable<T>;
+  using Layout = detail::BlittableLayoutOf<T>;
+
+  static constexpr EncodingByte Prefix(const Type& /*value*/) {
+    return EncodingByte::Binary;
+  }
+
+  static constexpr std::size_t Size(const Type& value) {
+    return BaseEncodingSize(Prefix(value)) + Encoding<SizeType>::Size(kLength) +
+           kLength;
+  }
+
+  static constexpr bool Match(EncodingByte prefix) {
+    return prefix == EncodingByte::Binary;
+  }
+
+  template <typename Writer>
+  static Status<void> WritePayload(EncodingByte /*prefix*/, const Type& value,
+                                   Writer* writer) {
+    auto status = detail::WriteBlittableHeader<T>(1, writer);
+    if (!status)
+      return status;
+
+    std::uint8_t bytes[Layout::Size()];
+    Layout::Store(value.get(), bytes);
+    return writer->Write(bytes, bytes + sizeof(bytes));
+  }
+
+  template <typename Reader>
+  static Status<void> ReadPayload(EncodingByte /*prefix*/, Type* value,
+                                  Reader* reader) {
+    auto status = detail::ReadBlittableHeader<T>(reader);
+    if (!status)
+      return status.error();
+    else if (status.get() != Layout::Size())
+      return ErrorStatus::InvalidContainerLength;
+
+    std::uint8_t bytes[Layout::Size()];
+    auto read_status = reader->Read(bytes, bytes + sizeof(bytes));
+    if (!read_status)
+      return read_status;
+
+    Layout::Load(bytes, &value->get());
+    return {};
+  }
+
+ private:
+  enum : std::size_t { kLength = sizeof(std::uint64_t) + Layout::Size() };
+};
+
+template <typename T, typename Allocator>
+struct Encoding<Blittable<std::vector<T, Allocator>>>
+    : EncodingIO<Blittable<std::vector<T, Allocator>>> {
+  using Type = Blittable<std::vector<T, Allocator>>;
+  using Layout = detail::BlittableLayoutOf<T>;
+
+  static constexpr EncodingByte Prefix(const Type& /*value*/) {
+    return EncodingByte::Binary;
+  }
+
+  static constexpr std::size_t Size(const Type& value) {
+    const SizeType length =
+        sizeof(std::uint64_t) + value.get().size() * Layout::Size();
+    return BaseEncodingSize(Prefix(value)) + Encoding<SizeType>::Size(length) +
+           length;
+  }
+
+  static constexpr bool Match(EncodingByte prefix) {
+    return prefix == EncodingByte::Binary;
+  }
+
+  template <typename Writer>
+  static Status<void> WritePayload(EncodingByte /*prefix*/, const Type& value,
+                                   Writer* writer) {
+    const std::vector<T, Allocator>& elements = value.get();
+    auto status = detail::WriteBlittableHeader<T>(elements.size(), writer);
+    if (!status)
+      return status;
+
+    return detail::WriteBlittableElements(elements.data(), elements.size(),
+                                          writer);
+  }
+
+  template <typename Reader>
+  static Status<void> ReadPayload(EncodingByte /*prefix*/, Type* value,
+                                  Reader* reader) {
+    auto status = detail::ReadBlittableHeader<T>(reader);
+    if (!status)
+      return status.error();
+    else if (status.get() % Layout::Size() != 0)
+      return ErrorStatus::InvalidContainerLength;
+
+    // Make sure the reader holds the whole payload before resizing, as a
+    // defense against abusive or erroneous lengths.
+    const SizeType length = status.get();
+    auto read_status = reader->Ensure(length);
+    if (!read_status)
+      return read_status;
+
+    std::vector<T, Allocator>& elements = value->get();
+    elements.resize(length / Layout::Size());
+    return detail::ReadBlittableElements(elements.data(), elements.size(),
+                                         reader);
+  }
+};
+
+template <typename T, std::size_t Length>
+struct Encoding<Blittable<std::array<T, Length>>>
+    : EncodingIO<Blittable<std::array<T, Length>>> {
+  using Type = Blittable<std::array<T, Length>>;
+  using Layout = detail::BlittableLayoutOf<T>;
+
+  static constexpr EncodingByte Prefix(const Type& /*value*/) {
+    return EncodingByte::Binary;
+  }
+
+  static constexpr std::size_t Size(const Type& value) {
+    return BaseEncodingSize(Prefix(value)) + Encoding<SizeType>::Size(kLength) +
+           kLength;
+  }
+
+  static constexpr bool Match(EncodingByte prefix) {
+    return prefix == EncodingByte::Binary;
+  }
+
+  template <typename Writer>
+  static Status<void> WritePayload(EncodingByte /*prefix*/, const Type& value,
+                                   Writer* writer) {
+    auto status = detail::WriteBlittableHeader<T>(Length, writer);
+    if (!status)
+      return status;
+
+    return detail::WriteBlittableElements(value.get().data(), Length, writer);
+  }
+
+  template <typename Reader>
+  static Status<void> ReadPayload(EncodingByte /*prefix*/, Type* value,
+                                  Reader* reader) {
+    auto status = detail::ReadBlittableHeader<T>(reader);
+    if (!status)
+      return status.error();
+    else if (status.get() != Length * Layout::Size())
+      return ErrorStatus::InvalidContainerLength;
+
+    return detail::ReadBlittableElements(value->get().data(), Length, reader);
+  }
+
+ private:
+  enum : std::size_t {
+    kLength = sizeof(std::uint64_t) + Length * Layout::Size()
+  };
+};
+
+// Blittable structures, pairs, tuples and arrays of them have a fixed encoded
+// size.
+template <typename T>
+struct FixedEncodingSize<Blittable<T>, detail::EnableIfBlittableElement<T>>
+    : std::integral_constant<
+          std::size_t,
+          BaseEncodingSize(EncodingByte::Binary) +
+              Encoding<SizeType>::Size(sizeof(std::uint64_t) +
+                                       detail::BlittableLayoutOf<T>::Size()) +
+              sizeof(std::uint64_t) + detail::BlittableLayoutOf<T>::Size()> {};
+
+template <typename T, std::size_t Length>
+struct FixedEncodingSize<Blittable<std::array<T, Length>>>
+    : std::integral_constant<
+          std::size_t,
+          BaseEncodingSize(EncodingByte::Binary) +
+              Encoding<SizeType>::Size(
+                  sizeof(std::uint64_t) +
+                  Length * detail::BlittableLayoutOf<T>::Size()) +
+              sizeof(std::uint64_t) +
+              Length * detail::BlittableLayoutOf<T>::Size()> {};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_BASE_BLITTABLE_H_
@@ -0,0 +1,83 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_BASE_CACHED_H_
+#define LIBNOP_INCLUDE_NOP_BASE_CACHED_H_
+
+#include <utility>
+
+#include <nop/base/encoding.h>
+#include <nop/types/cached.h>
+
+namespace nop {
+
+//
+// Cached<T> encoding format:
+//
+// +-----//-----+
+// | ENCODING:T |
+// +-----//-----+
+//
+// The cached encoding of the value is written verbatim, so the format is
+// exactly that of T. Values that could not be encoded on their own are written
+// with the encoding of T directly.
+//
+
+template <typename T>
+struct Encoding<Cached<T>> : EncodingIO<Cached<T>> {
+  using Type = Cached<T>;
+
+  static EncodingByte Prefix(const Type& value) {
+    const RawEncoded<T>& encoded = value.encoded();
+    return encoded.empty() ? Encoding<T>::Prefix(value.get())
+                           : Encoding<RawEncoded<T>>::Prefix(encoded);
+  }
+
+  static std::size_t Size(const Type& value) {
+    const RawEncoded<T>& encoded = value.encoded();
+    return encoded.empty() ? Encoding<T>::Size(value.get()) : encoded.size();
+  }
+
+  static constexpr bool Match(EncodingByte prefix) {
+    return Encoding<T>::Match(prefix);
+  }
+
+  template <typename Writer>
+  static Status<void> WritePayload(EncodingByte prefix, const Type& value,
+                                   Writer* writer) {
+    const RawEncoded<T>& encoded = value.encoded();
+    if (encoded.empty())
+      return Encoding<T>::WritePayload(prefix, value.get(), writer);
+    else
+      return Encoding<RawEncoded<T>>::WritePayload(prefix, encoded, writer);
+  }
+
+  template <typename Reader>
+  static Status<void> ReadPayload(EncodingByte prefix, Type* value,
+                                  Reader* reader) {
+    T temp;
+    auto status = Encoding<T>::ReadPayload(prefix, &temp, reader);
+    if (!status)
+      return status;
+
+    *value = Type{std::move(temp)};
+    return {};
+  }
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_BASE_CACHED_H_
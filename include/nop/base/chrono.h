@@ -0,0 +1,267 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_BASE_CHRONO_H_
+#define LIBNOP_INCLUDE_NOP_BASE_CHRONO_H_
+
+#include <chrono>
+#include <type_traits>
+#include <vector>
+
+#include <nop/base/encoding.h>
+#include <nop/types/time_deltas.h>
+
+namespace nop {
+
+//
+// std::chrono::duration<Rep, Period> encoding format matches the encoding
+// format of Rep, holding the count of the duration. Integral counts use the
+// smallest integer encoding that holds the value.
+//
+// std::chrono::time_point<Clock, Duration> encoding format matches the
+// encoding format of Duration, holding the time since the epoch of Clock.
+//
+// The unit of the count is not encoded; both sides must agree on the Period.
+//
+
+template <typename Rep, typename Period>
+struct Encoding<std::chrono::duration<Rep, Period>>
+    : EncodingIO<std::chrono::duration<Rep, Period>> {
+  using Type = std::chrono::duration<Rep, Period>;
+
+  static constexpr EncodingByte Prefix(const Type& value) {
+    return Encoding<Rep>::Prefix(value.count());
+  }
+
+  static constexpr std::size_t Size(const Type& value) {
+    return Encoding<Rep>::Size(value.count());
+  }
+
+  static constexpr bool Match(EncodingByte prefix) {
+    return Encoding<Rep>::Match(prefix);
+  }
+
+  template <typename Writer>
+  static constexpr Status<void> WritePayload(EncodingByte prefix,
+                                             const Type& value,
+                                             Writer* writer) {
+    return Encoding<Rep>::WritePayload(prefix, value.count(), writer);
+  }
+
+  template <typename Reader>
+  static constexpr Status<void> ReadPayload(EncodingByte prefix, Type* value,
+                                            Reader* reader) {
+    Rep count{};
+    auto status = Encoding<Rep>::ReadPayload(prefix, &count, reader);
+    if (!status)
+      return status;
+
+    *value = Type{count};
+    return {};
+  }
+};
+
+template <typename Clock, typename Duration>
+struct Encoding<std::chrono::time_point<Clock, Duration>>
+    : EncodingIO<std::chrono::time_point<Clock, Duration>> {
+  using Type = std::chrono::time_point<Clock, Duration>;
+
+  static constexpr EncodingByte Prefix(const Type& value) {
+    return Encoding<Duration>::Prefix(value.time_since_epoch());
+  }
+
+  static constexpr std::size_t Size(const Type& value) {
+    return Encoding<Duration>::Size(value.time_since_epoch());
+  }
+
+  static constexpr bool Match(EncodingByte prefix) {
+    return Encoding<Duration>::Match(prefix);
+  }
+
+  template <typename Writer>
+  static constexpr Status<void> WritePayload(EncodingByte prefix,
+                                             const Type& value,
+                                             Writer* writer) {
+    return Encoding<Duration>::WritePayload(prefix, value.time_since_epoch(),
+                                            writer);
+  }
+
+  template <typename Reader>
+  static constexpr Status<void> ReadPayload(EncodingByte prefix, Type* value,
+                                            Reader* reader) {
+    Duration duration{};
+    auto status = Encoding<Duration>::ReadPayload(prefix, &duration, reader);
+    if (!status)
+      return status;
+
+    *value = Type{duration};
+    return {};
+  }
+};
+
+// Duration and time point encodings have a fixed size when the count does.
+template <typename Rep, typename Period>
+struct FixedEncodingSize<std::chrono::duration<Rep, Period>>
+    : FixedEncodingSize<Rep> {};
+template <typename Clock, typename Duration>
+struct FixedEncodingSize<std::chrono::time_point<Clock, Duration>>
+    : FixedEncodingSize<Duration> {};
+
+//
+// TimeDeltas<std::vector<T>> encoding format:
+//
+// +-----+---------+------+------//-------+
+// | ARY | INT64:N | BASE | N - 1 OFFSETS |
+// +-----+---------+------+------//-------+
+//
+// Where T is a time point or duration with integral count type Rep, BASE is
+// the integer encoding of the count of the first element, and each OFFSET is
+// the integer encoding of the count of the next element minus BASE, computed
+// with wrapping arithmetic in the width of Rep. BASE is absent when N is zero.
+//
+// This is a valid encoding of an array of integers, so generic tools, such as
+// SkipValue(), walk it without knowing the element type.
+//
+
+namespace detail {
+
+// Converts time points and durations to and from their integral counts.
+template <typename T>
+struct TimeCount;
+
+template <typename Rep, typename Period>
+struct TimeCount<std::chrono::duration<Rep, Period>> {
+  using Type = std::chrono::duration<Rep, Period>;
+  using Count = Rep;
+
+  static Count Get(const Type& value) { return value.count(); }
+  static Type Make(Count count) { return Type{count}; }
+};
+
+template <typename Clock, typename Duration>
+struct TimeCount<std::chrono::time_point<Clock, Duration>> {
+  using Type = std::chrono::time_point<Clock, Duration>;
+  using Count = typename Duration::rep;
+
+  static Count Get(const Type& value) {
+    return value.time_since_epoch().count();
+  }
+  static Type Make(Count count) { return Type{Duration{count}}; }
+};
+
+}  // namespace detail
+
+template <typename T, typename Allocator>
+struct Encoding<TimeDeltas<std::vector<T, Allocator>>>
+    : EncodingIO<TimeDeltas<std::vector<T, Allocator>>> {
+  using Type = TimeDeltas<std::vector<T, Allocator>>;
+  using Count = typename detail::TimeCount<T>::Count;
+
+  static_assert(std::is_integral<Count>::value,
+                "TimeDeltas elements must have an integral count type.");
+
+  static constexpr EncodingByte Prefix(const Type& /*value*/) {
+    return EncodingByte::Array;
+  }
+
+  static std::size_t Size(const Type& value) {
+    const std::vector<T, Allocator>& elements = value.get();
+    std::size_t size = BaseEncodingSize(Prefix(value)) +
+                       Encoding<SizeType>::Size(elements.size());
+    if (elements.empty())
+      return size;
+
+    const Count base = detail::TimeCount<T>::Get(elements[0]);
+    size += Encoding<Count>::Size(base);
+    for (std::size_t i = 1; i < elements.size(); i++)
+      size += Encoding<Count>::Size(Offset(elements[i], base));
+    return size;
+  }
+
+  static constexpr bool Match(EncodingByte prefix) {
+    return prefix == EncodingByte::Array;
+  }
+
+  template <typename Writer>
+  static Status<void> WritePayload(EncodingByte /*prefix*/, const Type& value,
+                                   Writer* writer) {
+    const std::vector<T, Allocator>& elements = value.get();
+    auto status = Encoding<SizeType>::Write(elements.size(), writer);
+    if (!status || elements.empty())
+      return status;
+
+    const Count base = detail::TimeCount<T>::Get(elements[0]);
+    status = Encoding<Count>::Write(base, writer);
+    if (!status)
+      return status;
+
+    for (std::size_t i = 1; i < elements.size(); i++) {
+      status = Encoding<Count>::Write(Offset(elements[i], base), writer);
+      if (!status)
+        return status;
+    }
+
+    return {};
+  }
+
+  template <typename Reader>
+  static Status<void> ReadPayload(EncodingByte /*prefix*/, Type* value,
+                                  Reader* reader) {
+    SizeType size = 0;
+    auto status = Encoding<SizeType>::Read(&size, reader);
+    if (!status)
+      return status;
+
+    std::vector<T, Allocator>& elements = value->get();
+    elements.clear();
+    if (size == 0)
+      return {};
+
+    Count base = 0;
+    status = Encoding<Count>::Read(&base, reader);
+    if (!status)
+      return status;
+
+    detail::ReserveEncodedElements<MinimumEncodingSize<Count>::value>(
+        &elements, size, *reader);
+    elements.push_back(detail::TimeCount<T>::Make(base));
+    for (SizeType i = 1; i < size; i++) {
+      Count offset = 0;
+      status = Encoding<Count>::Read(&offset, reader);
+      if (!status)
+        return status;
+
+      elements.push_back(detail::TimeCount<T>::Make(static_cast<Count>(
+          static_cast<Unsigned>(base) + static_cast<Unsigned>(offset))));
+    }
+
+    return {};
+  }
+
+ private:
+  using Unsigned = typename std::make_unsigned<Count>::type;
+
+  static Count Offset(const T& element, Count base) {
+    return static_cast<Count>(
+        static_cast<Unsigned>(detail::TimeCount<T>::Get(element)) -
+        static_cast<Unsigned>(base));
+  }
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_BASE_CHRONO_H_
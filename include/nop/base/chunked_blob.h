@@ -0,0 +1,171 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_BASE_CHUNKED_BLOB_H_
+#define LIBNOP_INCLUDE_NOP_BASE_CHUNKED_BLOB_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+
+#include <nop/base/encoding.h>
+#include <nop/types/chunked_blob.h>
+
+namespace nop {
+
+//
+// ChunkedBlob encoding format:
+//
+// +-----+---------+---//----+
+// | BIN | INT64:L | L BYTES |
+// +-----+---------+---//----+
+//
+// This is the format of std::vector<std::uint8_t>. The payload is written and
+// read in chunks of at most chunk_size() bytes through a buffer of that size.
+// Readers that support borrowing hand each chunk of their input to the sink
+// directly, without copying it through the buffer.
+//
+// Writing a blob without a source or reading a blob without a sink fails with
+// ErrorStatus::InvalidContainerLength; a source or sink error aborts the
+// operation with that error.
+//
+
+template <>
+struct Encoding<ChunkedBlob> : EncodingIO<ChunkedBlob> {
+  using Type = ChunkedBlob;
+
+  static constexpr EncodingByte Prefix(const Type& /*value*/) {
+    return EncodingByte::Binary;
+  }
+
+  static std::size_t Size(const Type& value) {
+    return BaseEncodingSize(Prefix(value)) +
+           Encoding<SizeType>::Size(value.size()) + value.size();
+  }
+
+  static constexpr bool Match(EncodingByte prefix) {
+    return prefix == EncodingByte::Binary;
+  }
+
+  template <typename Writer>
+  static Status<void> WritePayload(EncodingByte /*prefix*/, const Type& value,
+                                   Writer* writer) {
+    if (!value.source())
+      return ErrorStatus::InvalidContainerLength;
+
+    auto status = Encoding<SizeType>::Write(value.size(), writer);
+    if (!status)
+      return status;
+
+    const std::size_t buffer_size = ChunkLength(value.size(), value);
+    std::unique_ptr<std::uint8_t[]> buffer{new std::uint8_t[buffer_size]};
+
+    std::uint64_t remaining = value.size();
+    while (remaining > 0) {
+      const std::size_t length = ChunkLength(remaining, value);
+      status = value.source()(buffer.get(), length);
+      if (!status)
+        return status;
+
+      status = writer->Write(buffer.get(), buffer.get() + length);
+      if (!status)
+        return status;
+
+      remaining -= length;
+    }
+
+    return {};
+  }
+
+  template <typename Reader>
+  static Status<void> ReadPayload(EncodingByte /*prefix*/, Type* value,
+                                  Reader* reader) {
+    if (!value->sink())
+      return ErrorStatus::InvalidContainerLength;
+
+    SizeType size = 0;
+    auto status = Encoding<SizeType>::Read(&size, reader);
+    if (!status)
+      return status;
+    else if (size > value->max_size())
+      return ErrorStatus::InvalidContainerLength;
+
+    value->set_size(size);
+    return ReadChunks(size, *value, reader, ReaderCanBorrow<Reader>{});
+  }
+
+ private:
+  static std::size_t ChunkLength(std::uint64_t remaining, const Type& value) {
+    return remaining < value.chunk_size() ? static_cast<std::size_t>(remaining)
+                                          : value.chunk_size();
+  }
+
+  template <typename Reader>
+  static Status<void> ReadChunks(std::uint64_t remaining, const Type& value,
+                                 Reader* reader, std::true_type) {
+    while (remaining > 0) {
+      const std::size_t length = ChunkLength(remaining, value);
+      auto status = reader->Ensure(length);
+      if (!status)
+        return status;
+
+      const void* data = nullptr;
+      status = reader->Borrow(length, &data);
+      if (!status)
+        return status;
+
+      status = value.sink()(static_cast<const std::uint8_t*>(data), length);
+      if (!status)
+        return status;
+
+      remaining -= length;
+    }
+
+    return {};
+  }
+
+  template <typename Reader>
+  static Status<void> ReadChunks(std::uint64_t remaining, const Type& value,
+                                 Reader* reader, std::false_type) {
+    const std::size_t buffer_size = ChunkLength(remaining, value);
+    std::unique_ptr<std::uint8_t[]> buffer{new std::uint8_t[buffer_size]};
+
+    while (remaining > 0) {
+      const std::size_t length = ChunkLength(remaining, value);
+      auto status = reader->Ensure(length);
+      if (!status)
+        return status;
+
+      status = reader->Read(buffer.get(), buffer.get() + length);
+      if (!status)
+        return status;
+
+      status = value.sink()(buffer.get(), length);
+      if (!status)
+        return status;
+
+      remaining -= length;
+    }
+
+    return {};
+  }
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_BASE_CHUNKED_BLOB_H_
@@ -0,0 +1,227 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_BASE_COLUMNAR_H_
+#define LIBNOP_INCLUDE_NOP_BASE_COLUMNAR_H_
+
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+#include <nop/base/encoding.h>
+#include <nop/base/utility.h>
+#include <nop/types/columnar.h>
+#include <nop/types/detail/member_pointer.h>
+
+namespace nop {
+
+//
+// Columnar<std::vector<T>> encoding format:
+//
+// +-----+---------+-----+-----------+----//----+-----+-----------+---//
+// | STC | INT64:M | BIN | INT64:L_0 | COLUMN_0 | BIN | INT64:L_1 | ...
+// +-----+---------+-----+-----------+----//----+-----+-----------+---//
+//
+// Where M is the number of members of T and column I holds member I of all N
+// elements, so that L_I = N * sizeof(member I). Every column must describe the
+// same number of elements.
+//
+// This is a valid encoding of a structure of M integral or floating point
+// vectors, so generic tools, such as SkipValue(), walk it without knowing the
+// element type. Columns are transposed from the rows in small batches on the
+// stack, so that the writer and reader are called once per batch rather than
+// once per element.
+//
+
+template <typename T, typename Allocator>
+struct Encoding<Columnar<std::vector<T, Allocator>>>
+    : EncodingIO<Columnar<std::vector<T, Allocator>>> {
+  using Type = Columnar<std::vector<T, Allocator>>;
+
+  static_assert(HasMemberList<T>::value,
+                "Columnar element type must be a structure annotated with "
+                "NOP_STRUCTURE or NOP_EXTERNAL_STRUCTURE.");
+
+  static constexpr EncodingByte Prefix(const Type& /*value*/) {
+    return EncodingByte::Structure;
+  }
+
+  static constexpr std::size_t Size(const Type& value) {
+    return BaseEncodingSize(Prefix(value)) + Encoding<SizeType>::Size(Count) +
+           ColumnsSize(value.get().size(), Index<Count>{});
+  }
+
+  static constexpr bool Match(EncodingByte prefix) {
+    return prefix == EncodingByte::Structure;
+  }
+
+  template <typename Writer>
+  static Status<void> WritePayload(EncodingByte /*prefix*/, const Type& value,
+                                   Writer* writer) {
+    auto status = Encoding<SizeType>::Write(Count, writer);
+    if (!status)
+      return status;
+    else
+      return WriteColumns(value.get(), writer, Index<Count>{});
+  }
+
+  template <typename Reader>
+  static Status<void> ReadPayload(EncodingByte /*prefix*/, Type* value,
+                                  Reader* reader) {
+    SizeType count = 0;
+    auto status = Encoding<SizeType>::Read(&count, reader);
+    if (!status)
+      return status;
+    else if (count != Count)
+      return ErrorStatus::InvalidMemberCount;
+    else
+      return ReadColumns(&value->get(), reader, Index<Count>{});
+  }
+
+ private:
+  enum : std::size_t { Count = MemberListTraits<T>::MemberList::Count };
+  enum : std::size_t { kBatchSize = 256 };
+
+  using MemberList = typename MemberListTraits<T>::MemberList;
+
+  template <std::size_t Index>
+  using PointerAt = typename MemberList::template At<Index>;
+
+  template <std::size_t Index>
+  using MemberAt = typename PointerAt<Index>::Type;
+
+  template <std::size_t Index>
+  static constexpr std::size_t CheckedMemberSize() {
+    static_assert(std::is_arithmetic<MemberAt<Index>>::value &&
+                      !std::is_same<MemberAt<Index>, bool>::value,
+                  "Columnar structure members must be integral or floating "
+                  "point types other than bool.");
+    return sizeof(MemberAt<Index>);
+  }
+
+  static constexpr std::size_t ColumnsSize(std::size_t /*rows*/, Index<0>) {
+    return 0;
+  }
+
+  template <std::size_t index>
+  static constexpr std::size_t ColumnsSize(std::size_t rows, Index<index>) {
+    const SizeType length = rows * CheckedMemberSize<index - 1>();
+    return ColumnsSize(rows, Index<index - 1>{}) +
+           BaseEncodingSize(EncodingByte::Binary) +
+           Encoding<SizeType>::Size(length) + length;
+  }
+
+  template <typename Writer>
+  static Status<void> WriteColumns(const std::vector<T, Allocator>& /*rows*/,
+                                   Writer* /*writer*/, Index<0>) {
+    return {};
+  }
+
+  template <std::size_t index, typename Writer>
+  static Status<void> WriteColumns(const std::vector<T, Allocator>& rows,
+                                   Writer* writer, Index<index>) {
+    auto status = WriteColumns(rows, writer, Index<index - 1>{});
+    if (!status)
+      return status;
+
+    using Member = MemberAt<index - 1>;
+    status = writer->Write(static_cast<std::uint8_t>(EncodingByte::Binary));
+    if (!status)
+      return status;
+
+    status = Encoding<SizeType>::Write(
+        rows.size() * CheckedMemberSize<index - 1>(), writer);
+    if (!status)
+      return status;
+
+    Member batch[kBatchSize];
+    for (std::size_t begin = 0; begin < rows.size(); begin += kBatchSize) {
+      const std::size_t count = rows.size() - begin < kBatchSize
+                                    ? rows.size() - begin
+                                    : kBatchSize;
+      for (std::size_t i = 0; i < count; i++)
+        batch[i] = PointerAt<index - 1>::Resolve(rows[begin + i]);
+
+      status = WriteElements(batch, batch + count, writer);
+      if (!status)
+        return status;
+    }
+
+    return {};
+  }
+
+  template <typename Reader>
+  static Status<void> ReadColumns(std::vector<T, Allocator>* /*rows*/,
+                                  Reader* /*reader*/, Index<0>) {
+    return {};
+  }
+
+  template <std::size_t index, typename Reader>
+  static Status<void> ReadColumns(std::vector<T, Allocator>* rows,
+                                  Reader* reader, Index<index>) {
+    auto status = ReadColumns(rows, reader, Index<index - 1>{});
+    if (!status)
+      return status;
+
+    using Member = MemberAt<index - 1>;
+    std::uint8_t prefix = 0;
+    status = reader->Read(&prefix);
+    if (!status)
+      return status;
+    else if (static_cast<EncodingByte>(prefix) != EncodingByte::Binary)
+      return ErrorStatus::UnexpectedEncodingType;
+
+    SizeType length = 0;
+    status = Encoding<SizeType>::Read(&length, reader);
+    if (!status)
+      return status;
+    else if (length % CheckedMemberSize<index - 1>() != 0)
+      return ErrorStatus::InvalidContainerLength;
+
+    // The first column determines the number of elements; the rest must agree.
+    // Make sure the reader holds the whole column before resizing, as a defense
+    // against abusive or erroneous lengths.
+    const SizeType size = length / sizeof(Member);
+    if (index == 1) {
+      status = reader->Ensure(length);
+      if (!status)
+        return status;
+      rows->resize(size);
+    } else if (size != rows->size()) {
+      return ErrorStatus::InvalidContainerLength;
+    }
+
+    Member batch[kBatchSize];
+    for (std::size_t begin = 0; begin < rows->size(); begin += kBatchSize) {
+      const std::size_t count = rows->size() - begin < kBatchSize
+                                    ? rows->size() - begin
+                                    : kBatchSize;
+      status = ReadElements(batch, batch + count, reader);
+      if (!status)
+        return status;
+
+      for (std::size_t i = 0; i < count; i++)
+        *PointerAt<index - 1>::Resolve(&(*rows)[begin + i]) = batch[i];
+    }
+
+    return {};
+  }
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_BASE_COLUMNAR_H_
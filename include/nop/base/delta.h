@@ -0,0 +1,421 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_BASE_DELTA_H_
+#define LIBNOP_INCLUDE_NOP_BASE_DELTA_H_
+
+#include <algorithm>
+#include <cstdint>
+
+#include <nop/base/encoding.h>
+#include <nop/base/members.h>
+#include <nop/base/optional.h>
+#include <nop/base/skip.h>
+#include <nop/base/table.h>
+#include <nop/base/utility.h>
+#include <nop/table.h>
+#include <nop/types/delta.h>
+#include <nop/types/detail/logical_buffer.h>
+
+namespace nop {
+
+//
+// Delta<T> encoding format for structures:
+//
+// +-----+---------+-----------+
+// | MAP | INT64:N | N CHANGES |
+// +-----+---------+-----------+
+//
+// Each CHANGE has the following format:
+//
+// +-------------+-------+
+// | INT64:INDEX | VALUE |
+// +-------------+-------+
+//
+// Where INDEX is the index of a member in the member list of the structure
+// and VALUE is a valid encoding of the member. Changes are written in member
+// order. Reading an index beyond the member list results in
+// ErrorStatus::InvalidMemberCount.
+//
+// Delta<T> encoding format for tables:
+//
+// +-----+---------+-----------+
+// | MAP | INT64:N | N CHANGES |
+// +-----+---------+-----------+
+//
+// Each CHANGE has the following format:
+//
+// +----------+-------+
+// | INT64:ID | VALUE |
+// +----------+-------+
+//
+// Where ID is the id of a table entry and VALUE is a valid encoding of the
+// entry as Optional<T>, which is empty when the entry was cleared. Changes
+// with unknown or deleted entry ids are skipped, which allows older code to
+// apply deltas from newer table definitions.
+//
+
+namespace detail {
+
+// Compares the members of a delta. Logical buffers compare the elements in
+// use rather than the underlying arrays.
+template <typename T>
+constexpr bool DeltaEqual(const T& a, const T& b) {
+  return a == b;
+}
+
+template <typename BufferType, typename SizeType, bool IsUnbounded,
+          typename Enabled>
+bool DeltaEqual(const LogicalBuffer<BufferType, SizeType, IsUnbounded,
+                                    Enabled>& a,
+                const LogicalBuffer<BufferType, SizeType, IsUnbounded,
+                                    Enabled>& b) {
+  return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin());
+}
+
+}  // namespace detail
+
+template <typename T>
+struct Encoding<Delta<T>, EnableIfHasMemberList<T>> : EncodingIO<Delta<T>> {
+  using Type = Delta<T>;
+
+  static constexpr EncodingByte Prefix(const Type& /*value*/) {
+    return EncodingByte::Map;
+  }
+
+  static constexpr std::size_t Size(const Type& value) {
+    if (!value.baseline() || !value.value())
+      return BaseEncodingSize(Prefix(value)) + Encoding<SizeType>::Size(0);
+
+    return BaseEncodingSize(Prefix(value)) +
+           Encoding<SizeType>::Size(ChangeCount(value, Members{})) +
+           Size(value, Members{});
+  }
+
+  static constexpr bool Match(EncodingByte prefix) {
+    return prefix == EncodingByte::Map;
+  }
+
+  template <typename Writer>
+  static constexpr Status<void> WritePayload(EncodingByte /*prefix*/,
+                                             const Type& value,
+                                             Writer* writer) {
+    if (!value.baseline() || !value.value())
+      return ErrorStatus::InvalidReference;
+
+    auto status =
+        Encoding<SizeType>::Write(ChangeCount(value, Members{}), writer);
+    if (!status)
+      return status;
+
+    return WriteChanges(value, writer, Members{});
+  }
+
+  template <typename Reader>
+  static constexpr Status<void> ReadPayload(EncodingByte /*prefix*/,
+                                            Type* value, Reader* reader) {
+    if (!value->target())
+      return ErrorStatus::InvalidReference;
+
+    SizeType count = 0;
+    auto status = Encoding<SizeType>::Read(&count, reader);
+    if (!status)
+      return status;
+
+    for (SizeType i = 0; i < count; i++) {
+      std::uint64_t index = 0;
+      status = Encoding<std::uint64_t>::Read(&index, reader);
+      if (!status)
+        return status;
+
+      status = ReadMember(index, value->target(), reader, Members{});
+      if (!status)
+        return status;
+    }
+
+    return {};
+  }
+
+ private:
+  enum : std::size_t { Count = MemberListTraits<T>::MemberList::Count };
+
+  using MemberList = typename MemberListTraits<T>::MemberList;
+  using Members = Index<Count>;
+
+  template <std::size_t Index>
+  using PointerAt = typename MemberList::template At<Index>;
+
+  template <std::size_t index>
+  static constexpr bool Changed(const Type& value) {
+    using Pointer = PointerAt<index>;
+    return !detail::DeltaEqual(Pointer::Resolve(*value.baseline()),
+                               Pointer::Resolve(*value.value()));
+  }
+
+  static constexpr std::size_t ChangeCount(const Type& /*value*/, Index<0>) {
+    return 0;
+  }
+
+  template <std::size_t index>
+  static constexpr std::size_t ChangeCount(const Type& value, Index<index>) {
+    return ChangeCount(value, Index<index - 1>{}) +
+           (Changed<index - 1>(value) ? 1 : 0);
+  }
+
+  static constexpr std::size_t Size(const Type& /*value*/, Index<0>) {
+    return 0;
+  }
+
+  template <std::size_t index>
+  static constexpr std::size_t Size(const Type& value, Index<index>) {
+    const std::size_t size =
+        Changed<index - 1>(value)
+            ? Encoding<std::uint64_t>::Size(index - 1) +
+                  PointerAt<index - 1>::Size(*value.value())
+            : 0;
+    return Size(value, Index<index - 1>{}) + size;
+  }
+
+  template <typename Writer>
+  static constexpr Status<void> WriteChanges(const Type& /*value*/,
+                                             Writer* /*writer*/, Index<0>) {
+    return {};
+  }
+
+  template <std::size_t index, typename Writer>
+  static constexpr Status<void> WriteChanges(const Type& value, Writer* writer,
+                                             Index<index>) {
+    auto status = WriteChanges(value, writer, Index<index - 1>{});
+    if (!status || !Changed<index - 1>(value))
+      return status;
+
+    status = Encoding<std::uint64_t>::Write(index - 1, writer);
+    if (!status)
+      return status;
+
+    return PointerAt<index - 1>::Write(*value.value(), writer, MemberList{});
+  }
+
+  template <typename Reader>
+  static constexpr Status<void> ReadMember(std::uint64_t /*index*/,
+                                           T* /*target*/, Reader* /*reader*/,
+                                           Index<0>) {
+    return ErrorStatus::InvalidMemberCount;
+  }
+
+  template <std::size_t index, typename Reader>
+  static constexpr Status<void> ReadMember(std::uint64_t key, T* target,
+                                           Reader* reader, Index<index>) {
+    if (key == index - 1)
+      return PointerAt<index - 1>::Read(target, reader, MemberList{});
+    else
+      return ReadMember(key, target, reader, Index<index - 1>{});
+  }
+};
+
+template <typename Table>
+struct Encoding<Delta<Table>, EnableIfHasEntryList<Table>>
+    : EncodingIO<Delta<Table>> {
+  using Type = Delta<Table>;
+
+  static constexpr EncodingByte Prefix(const Type& /*value*/) {
+    return EncodingByte::Map;
+  }
+
+  static constexpr std::size_t Size(const Type& value) {
+    if (!value.baseline() || !value.value())
+      return BaseEncodingSize(Prefix(value)) + Encoding<SizeType>::Size(0);
+
+    return BaseEncodingSize(Prefix(value)) +
+           Encoding<SizeType>::Size(ChangeCount(value, Entries{})) +
+           Size(value, Entries{});
+  }
+
+  static constexpr bool Match(EncodingByte prefix) {
+    return prefix == EncodingByte::Map;
+  }
+
+  template <typename Writer>
+  static constexpr Status<void> WritePayload(EncodingByte /*prefix*/,
+                                             const Type& value,
+                                             Writer* writer) {
+    if (!value.baseline() || !value.value())
+      return ErrorStatus::InvalidReference;
+
+    auto status =
+        Encoding<SizeType>::Write(ChangeCount(value, Entries{}), writer);
+    if (!status)
+      return status;
+
+    return WriteChanges(value, writer, Entries{});
+  }
+
+  template <typename Reader>
+  static constexpr Status<void> ReadPayload(EncodingByte /*prefix*/,
+                                            Type* value, Reader* reader) {
+    if (!value->target())
+      return ErrorStatus::InvalidReference;
+
+    SizeType count = 0;
+    auto status = Encoding<SizeType>::Read(&count, reader);
+    if (!status)
+      return status;
+
+    for (SizeType i = 0; i < count; i++) {
+      std::uint64_t id = 0;
+      status = Encoding<std::uint64_t>::Read(&id, reader);
+      if (!status)
+        return status;
+
+      status = ReadEntry(id, value->target(), reader, Entries{});
+      if (!status)
+        return status;
+    }
+
+    return {};
+  }
+
+ private:
+  enum : std::size_t { Count = EntryListTraits<Table>::EntryList::Count };
+
+  using Entries = Index<Count>;
+
+  template <std::size_t Index>
+  using PointerAt =
+      typename EntryListTraits<Table>::EntryList::template At<Index>;
+
+  template <typename T, std::uint64_t Id>
+  static constexpr bool Changed(const Entry<T, Id, ActiveEntry>& baseline,
+                                const Entry<T, Id, ActiveEntry>& value) {
+    return !(static_cast<const Optional<T>&>(baseline) ==
+             static_cast<const Optional<T>&>(value));
+  }
+
+  template <typename T, std::uint64_t Id>
+  static constexpr bool Changed(
+      const Entry<T, Id, DeletedEntry>& /*baseline*/,
+      const Entry<T, Id, DeletedEntry>& /*value*/) {
+    return false;
+  }
+
+  template <std::size_t index>
+  static constexpr bool Changed(const Type& value) {
+    using Pointer = PointerAt<index>;
+    return Changed(Pointer::Resolve(*value.baseline()),
+                   Pointer::Resolve(*value.value()));
+  }
+
+  static constexpr std::size_t ChangeCount(const Type& /*value*/, Index<0>) {
+    return 0;
+  }
+
+  template <std::size_t index>
+  static constexpr std::size_t ChangeCount(const Type& value, Index<index>) {
+    return ChangeCount(value, Index<index - 1>{}) +
+           (Changed<index - 1>(value) ? 1 : 0);
+  }
+
+  static constexpr std::size_t Size(const Type& /*value*/, Index<0>) {
+    return 0;
+  }
+
+  template <std::size_t index>
+  static constexpr std::size_t Size(const Type& value, Index<index>) {
+    return Size(value, Index<index - 1>{}) +
+           (Changed<index - 1>(value)
+                ? ChangeSize(PointerAt<index - 1>::Resolve(*value.value()))
+                : 0);
+  }
+
+  template <typename T, std::uint64_t Id>
+  static constexpr std::size_t ChangeSize(
+      const Entry<T, Id, ActiveEntry>& entry) {
+    return Encoding<std::uint64_t>::Size(Id) +
+           Encoding<Optional<T>>::Size(entry);
+  }
+
+  template <typename T, std::uint64_t Id>
+  static constexpr std::size_t ChangeSize(
+      const Entry<T, Id, DeletedEntry>& /*entry*/) {
+    return 0;
+  }
+
+  template <typename Writer>
+  static constexpr Status<void> WriteChanges(const Type& /*value*/,
+                                             Writer* /*writer*/, Index<0>) {
+    return {};
+  }
+
+  template <std::size_t index, typename Writer>
+  static constexpr Status<void> WriteChanges(const Type& value, Writer* writer,
+                                             Index<index>) {
+    auto status = WriteChanges(value, writer, Index<index - 1>{});
+    if (!status || !Changed<index - 1>(value))
+      return status;
+
+    return WriteChange(PointerAt<index - 1>::Resolve(*value.value()), writer);
+  }
+
+  template <typename T, std::uint64_t Id, typename Writer>
+  static constexpr Status<void> WriteChange(
+      const Entry<T, Id, ActiveEntry>& entry, Writer* writer) {
+    auto status = Encoding<std::uint64_t>::Write(Id, writer);
+    if (!status)
+      return status;
+
+    return Encoding<Optional<T>>::Write(entry, writer);
+  }
+
+  template <typename T, std::uint64_t Id, typename Writer>
+  static constexpr Status<void> WriteChange(
+      const Entry<T, Id, DeletedEntry>& /*entry*/, Writer* /*writer*/) {
+    return {};
+  }
+
+  template <typename Reader>
+  static constexpr Status<void> ReadEntry(std::uint64_t /*id*/,
+                                          Table* /*target*/, Reader* reader,
+                                          Index<0>) {
+    return SkipValue(reader);
+  }
+
+  template <std::size_t index, typename Reader>
+  static constexpr Status<void> ReadEntry(std::uint64_t id, Table* target,
+                                          Reader* reader, Index<index>) {
+    auto* entry = PointerAt<index - 1>::Resolve(target);
+    if (id == std::decay_t<decltype(*entry)>::Id)
+      return ReadChange(entry, reader);
+    else
+      return ReadEntry(id, target, reader, Index<index - 1>{});
+  }
+
+  template <typename T, std::uint64_t Id, typename Reader>
+  static constexpr Status<void> ReadChange(Entry<T, Id, ActiveEntry>* entry,
+                                           Reader* reader) {
+    return Encoding<Optional<T>>::Read(entry, reader);
+  }
+
+  template <typename T, std::uint64_t Id, typename Reader>
+  static constexpr Status<void> ReadChange(
+      Entry<T, Id, DeletedEntry>* /*entry*/, Reader* reader) {
+    return SkipValue(reader);
+  }
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_BASE_DELTA_H_
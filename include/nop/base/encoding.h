@@ -21,13 +21,19 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <string>
 #include <type_traits>
+#include <utility>
 #include <vector>
 
 #include <nop/base/encoding_byte.h>
 #include <nop/base/utility.h>
 #include <nop/status.h>
+#include <nop/traits/is_detected.h>
+#include <nop/traits/void.h>
+#include <nop/utility/compiler.h>
+#include <nop/utility/endian.h>
 
 namespace nop {
 
@@ -86,6 +92,65 @@ inline constexpr std::size_t BaseEncodingSize(EncodingByte prefix) {
   }
 }
 
+namespace detail {
+
+// Writes |prefix| followed by the low |Size| bytes of |value|, in little-endian
+// order, with a single call to the writer. The prefix and payload are combined
+// into one word before the copy, so that the writer reads back the result of a
+// single store instead of separate stores of the prefix and payload.
+template <std::size_t Size, typename Writer>
+constexpr Status<void> WriteIntegerBytes(EncodingByte prefix,
+                                         std::uint64_t value, Writer* writer) {
+  static_assert(Size < sizeof(std::uint64_t),
+                "The prefix and payload must fit in one word.");
+  const std::uint64_t word =
+      static_cast<std::uint64_t>(prefix) | (value << 8);
+  std::uint8_t bytes[1 + Size] = {};
+  if (NOP_IS_CONSTANT_EVALUATED()) {
+    for (std::size_t i = 0; i < 1 + Size; i++)
+      bytes[i] = static_cast<std::uint8_t>(word >> (i * 8));
+  } else {
+    std::uint64_t little = word;
+    if (!kLittleEndianHost)
+      little = HostEndian<std::uint64_t>::ToLittle(little);
+    std::memcpy(bytes, &little, 1 + Size);
+  }
+  return writer->Write(bytes, bytes + 1 + Size);
+}
+
+// Writes the most compact encoding of an unsigned integer of up to 32 bits.
+// Fixints are written as a single byte and the other encodings with a single
+// call to the writer for the prefix and payload.
+template <typename Writer>
+constexpr Status<void> WriteUnsignedInteger(std::uint32_t value,
+                                            Writer* writer) {
+  if (value < (1U << 7))
+    return writer->Write(static_cast<std::uint8_t>(value));
+  else if (value < (1U << 8))
+    return WriteIntegerBytes<1>(EncodingByte::U8, value, writer);
+  else if (value < (1U << 16))
+    return WriteIntegerBytes<2>(EncodingByte::U16, value, writer);
+  else
+    return WriteIntegerBytes<4>(EncodingByte::U32, value, writer);
+}
+
+// Writes the most compact encoding of a signed integer of up to 32 bits, as
+// above.
+template <typename Writer>
+constexpr Status<void> WriteSignedInteger(std::int32_t value, Writer* writer) {
+  const std::uint64_t bits = static_cast<std::uint64_t>(value);
+  if (value >= -64 && value <= 127)
+    return writer->Write(static_cast<std::uint8_t>(bits));
+  else if (value >= -128 && value <= 127)
+    return WriteIntegerBytes<1>(EncodingByte::I8, bits, writer);
+  else if (value >= -32768 && value <= 32767)
+    return WriteIntegerBytes<2>(EncodingByte::I16, bits, writer);
+  else
+    return WriteIntegerBytes<4>(EncodingByte::I32, bits, writer);
+}
+
+}  // namespace detail
+
 // Base type for all encoding templates. If type T does not have a
 // specialization this template generates a static assert.
 template <typename T, typename Enabled = void>
@@ -97,6 +162,117 @@ struct Encoding {
                 "include the appropriate encoder header.");
 };
 
+namespace detail {
+
+template <typename T, typename Writer>
+Status<void> WriteSwappedElements(const T* begin, const T* end,
+                                  Writer* writer) {
+  constexpr std::size_t kBlockLength = 256 / sizeof(T);
+  T block[kBlockLength];
+  while (begin != end) {
+    const std::size_t remaining = end - begin;
+    const std::size_t length =
+        remaining < kBlockLength ? remaining : kBlockLength;
+    HostEndian<T>::ToLittle(begin, length, block);
+
+    auto status = writer->Write(block, block + length);
+    if (!status)
+      return status;
+
+    begin += length;
+  }
+  return {};
+}
+
+}  // namespace detail
+
+// Writes the arithmetic elements in [begin, end) in the little-endian byte
+// order of the wire format. On little-endian hosts, and for single byte
+// elements, this is a single write of the elements. Otherwise the elements are
+// converted in blocks through a local buffer. Empty ranges, whose pointers may
+// be null, never reach the writer.
+template <typename T, typename Writer, typename Enabled = EnableIfArithmetic<T>>
+constexpr Status<void> WriteElements(const T* begin, const T* end,
+                                     Writer* writer) {
+  if (begin == end)
+    return {};
+  else if (kLittleEndianHost || sizeof(T) == 1)
+    return writer->Write(begin, end);
+  else
+    return detail::WriteSwappedElements(begin, end, writer);
+}
+
+// Reads arithmetic elements in the little-endian byte order of the wire format
+// into [begin, end). On big-endian hosts the elements are converted in place
+// after a single read. Empty ranges never reach the reader.
+template <typename T, typename Reader, typename Enabled = EnableIfArithmetic<T>>
+constexpr Status<void> ReadElements(T* begin, T* end, Reader* reader) {
+  if (begin == end)
+    return {};
+
+  auto status = reader->Read(begin, end);
+  if (!status)
+    return status;
+
+  if (!kLittleEndianHost && sizeof(T) != 1)
+    HostEndian<T>::FromLittle(begin, end - begin, begin);
+  return {};
+}
+
+// Writes enumeration elements as the elements of their underlying type.
+template <typename T, typename Writer>
+constexpr std::enable_if_t<std::is_enum<T>::value, Status<void>> WriteElements(
+    const T* begin, const T* end, Writer* writer) {
+  using IntegerType = std::underlying_type_t<T>;
+  return WriteElements(reinterpret_cast<const IntegerType*>(begin),
+                       reinterpret_cast<const IntegerType*>(end), writer);
+}
+
+// Reads enumeration elements as the elements of their underlying type.
+template <typename T, typename Reader>
+constexpr std::enable_if_t<std::is_enum<T>::value, Status<void>> ReadElements(
+    T* begin, T* end, Reader* reader) {
+  using IntegerType = std::underlying_type_t<T>;
+  return ReadElements(reinterpret_cast<IntegerType*>(begin),
+                      reinterpret_cast<IntegerType*>(end), reader);
+}
+
+// Evaluates to true if Reader provides the optional Borrow() method, which
+// returns a pointer to the next bytes of input without copying them.
+template <typename Reader>
+using ReaderBorrowTest = decltype(std::declval<Reader&>().Borrow(
+    std::declval<std::size_t>(), std::declval<const void**>()));
+template <typename Reader>
+using ReaderCanBorrow = IsDetected<ReaderBorrowTest, Reader>;
+
+// Evaluates to true if Reader provides the optional Peek() method, which
+// returns a pointer to the next bytes of input without advancing past them,
+// and Reader can be constructed over a range of those bytes and reports when
+// it is empty. Encodings of long runs of fixed size elements use these to
+// decode the elements from known offsets instead of one after the other.
+template <typename Reader>
+using ReaderPeekTest = decltype(std::declval<const Reader&>().Peek(
+    std::declval<std::size_t>(), std::declval<const void**>()));
+template <typename Reader>
+using ReaderCanPeek = std::integral_constant<
+    bool, IsDetected<ReaderPeekTest, Reader>::value &&
+              std::is_constructible<Reader, const void*, std::size_t>::value>;
+
+// Evaluates to true if strings and byte vectors may be decoded by borrowing
+// their payload from Reader and copying it, instead of reading it into
+// initialized storage. Readers for which borrowing is not transient, such as
+// readers that retain borrowed input until it is explicitly released, opt out
+// by defining the following member:
+//
+//   static constexpr bool kBorrowToCopy = false;
+//
+template <typename Reader, typename Enabled = void>
+struct ReaderBorrowsToCopy : ReaderCanBorrow<Reader> {};
+template <typename Reader>
+struct ReaderBorrowsToCopy<Reader, Void<decltype(Reader::kBorrowToCopy)>>
+    : std::integral_constant<bool, ReaderCanBorrow<Reader>::value &&
+                                       Reader::kBorrowToCopy> {};
+
 // Implements general IO for encoding types. May also be mixed-in with an
 // Encoding<T> specialization to provide uniform access to Read/Write through
 // the specilization itself.
@@ -108,37 +284,77 @@ struct Encoding {
 //
 //    Encoding<SomeType>::Write(...);
 //
+// Trait that determines whether a writer or reader is notified on entry to and
+// exit from the encoding of every value, for example to attribute the cost of
+// serialization to types. Writers and readers opt in by defining the following
+// members:
+//
+//   static constexpr bool kProfileEncodings = true;
+//
+//   // Writers receive the value being written; readers receive no arguments.
+//   template <typename T>
+//   void EnterEncoding(const T& value);
+//
+//   template <typename T>
+//   void ExitEncoding(const Status<void>& status);
+//
+// Encodings of writers and readers that do not opt in compile to the same code
+// as without the hooks. See ProfilingWriter and ProfilingReader.
+template <typename IO, typename Enabled = void>
+struct ProfilesEncodings : std::false_type {};
+template <typename IO>
+struct ProfilesEncodings<IO, Void<decltype(IO::kProfileEncodings)>>
+    : std::integral_constant<bool, IO::kProfileEncodings> {};
+
+// Traits that determine whether the encoders of type T for a writer or reader
+// are compiled in a single translation unit and called from the others, rather
+// than instantiated in every translation unit that uses them. Specialized by
+// NOP_DECLARE_ENCODING; see nop/extern_encoding.h.
+template <typename T, typename Writer>
+struct ExternWriteEncoding : std::false_type {};
+template <typename T, typename Reader>
+struct ExternReadEncoding : std::false_type {};
+
+// Evaluates to true if Encoding<T> defines the optional WriteWithPrefix()
+// method, which writes the prefix and payload of |value| together instead of
+// with separate calls to the writer:
+//
+//   template <typename Writer>
+//   static Status<void> WriteWithPrefix(const T& value, Writer* writer);
+//
+template <typename T, typename Writer>
+using EncodingWriteWithPrefixTest = decltype(Encoding<T>::WriteWithPrefix(
+    std::declval<const T&>(), std::declval<Writer*>()));
+template <typename T, typename Writer>
+using EncodingWritesWithPrefix =
+    IsDetected<EncodingWriteWithPrefixTest, T, Writer>;
+
 template <typename T>
 struct EncodingIO {
   template <typename Writer>
   static constexpr Status<void> Write(const T& value, Writer* writer) {
-    EncodingByte prefix = Encoding<T>::Prefix(value);
-    auto status = writer->Write(static_cast<std::uint8_t>(prefix));
-    if (!status)
-      return status;
-    else
-      return Encoding<T>::WritePayload(prefix, value, writer);
+    return WriteOrCall(value, writer, ExternWriteEncoding<T, Writer>{});
   }
 
   template <typename Reader>
   static constexpr Status<void> Read(T* value, Reader* reader) {
-    std::uint8_t prefix_byte = 0;
-    auto status = reader->Read(&prefix_byte);
-    if (!status)
-      return status;
-
-    const EncodingByte prefix = static_cast<EncodingByte>(prefix_byte);
-    if (Encoding<T>::Match(prefix))
-      return Encoding<T>::ReadPayload(prefix, value, reader);
-    else
-      return ErrorStatus::UnexpectedEncodingType;
+    return ReadOrCall(value, reader, ExternReadEncoding<T, Reader>{});
   }
 
+  // Encoders defined out of line and without inline below, so that they are
+  // compiled once by an explicit instantiation. See NOP_INSTANTIATE_ENCODING.
+  template <typename Writer>
+  static Status<void> WriteExtern(const T& value, Writer* writer);
+  template <typename Reader>
+  static Status<void> ReadExtern(T* value, Reader* reader);
+
  protected:
   template <typename As, typename From, typename Writer,
             typename Enabled = EnableIfArithmetic<As, From>>
   static constexpr Status<void> WriteAs(From value, Writer* writer) {
     As temp = static_cast<As>(value);
+    if (!kLittleEndianHost)
+      temp = HostEndian<As>::ToLittle(temp);
     return writer->Write(&temp, &temp + 1);
   }
 
@@ -150,11 +366,177 @@ struct EncodingIO {
     if (!status)
       return status;
 
+    if (!kLittleEndianHost)
+      temp = HostEndian<As>::FromLittle(temp);
     *value = static_cast<From>(temp);
     return {};
   }
+
+ private:
+  template <typename Writer>
+  static constexpr Status<void> WriteOrCall(const T& value, Writer* writer,
+                                            std::false_type /*extern*/) {
+    return Write(value, writer, ProfilesEncodings<Writer>{});
+  }
+
+  // Calls the encoder compiled elsewhere, except during constant evaluation.
+  template <typename Writer>
+  static constexpr Status<void> WriteOrCall(const T& value, Writer* writer,
+                                            std::true_type /*extern*/) {
+    if (NOP_IS_CONSTANT_EVALUATED())
+      return Write(value, writer, ProfilesEncodings<Writer>{});
+    else
+      return WriteExtern(value, writer);
+  }
+
+  template <typename Reader>
+  static constexpr Status<void> ReadOrCall(T* value, Reader* reader,
+                                           std::false_type /*extern*/) {
+    return Read(value, reader, ProfilesEncodings<Reader>{});
+  }
+
+  template <typename Reader>
+  static constexpr Status<void> ReadOrCall(T* value, Reader* reader,
+                                           std::true_type /*extern*/) {
+    if (NOP_IS_CONSTANT_EVALUATED())
+      return Read(value, reader, ProfilesEncodings<Reader>{});
+    else
+      return ReadExtern(value, reader);
+  }
+
+  template <typename Writer>
+  static constexpr Status<void> Write(const T& value, Writer* writer,
+                                      std::false_type /*profile*/) {
+    return WriteParts(value, writer, EncodingWritesWithPrefix<T, Writer>{});
+  }
+
+  template <typename Writer>
+  static constexpr Status<void> WriteParts(const T& value, Writer* writer,
+                                           std::true_type /*with_prefix*/) {
+    return Encoding<T>::WriteWithPrefix(value, writer);
+  }
+
+  template <typename Writer>
+  static constexpr Status<void> WriteParts(const T& value, Writer* writer,
+                                           std::false_type /*with_prefix*/) {
+    EncodingByte prefix = Encoding<T>::Prefix(value);
+    auto status = writer->Write(static_cast<std::uint8_t>(prefix));
+    if (!status)
+      return status;
+    else
+      return Encoding<T>::WritePayload(prefix, value, writer);
+  }
+
+  template <typename Writer>
+  static Status<void> Write(const T& value, Writer* writer,
+                            std::true_type /*profile*/) {
+    writer->template EnterEncoding<T>(value);
+    auto status = Write(value, writer, std::false_type{});
+    writer->template ExitEncoding<T>(status);
+    return status;
+  }
+
+  template <typename Reader>
+  static constexpr Status<void> Read(T* value, Reader* reader,
+                                     std::false_type /*profile*/) {
+    std::uint8_t prefix_byte = 0;
+    auto status = reader->Read(&prefix_byte);
+    if (!status)
+      return status;
+
+    const EncodingByte prefix = static_cast<EncodingByte>(prefix_byte);
+    if (Encoding<T>::Match(prefix))
+      return Encoding<T>::ReadPayload(prefix, value, reader);
+    else
+      return ErrorStatus::UnexpectedEncodingType;
+  }
+
+  template <typename Reader>
+  static Status<void> Read(T* value, Reader* reader,
+                           std::true_type /*profile*/) {
+    reader->template EnterEncoding<T>();
+    auto status = Read(value, reader, std::false_type{});
+    reader->template ExitEncoding<T>(status);
+    return status;
+  }
 };
 
+template <typename T>
+template <typename Writer>
+Status<void> EncodingIO<T>::WriteExtern(const T& value, Writer* writer) {
+  return Write(value, writer, ProfilesEncodings<Writer>{});
+}
+
+template <typename T>
+template <typename Reader>
+Status<void> EncodingIO<T>::ReadExtern(T* value, Reader* reader) {
+  return Read(value, reader, ProfilesEncodings<Reader>{});
+}
+
+// Trait that evaluates to the encoded size of type T when that size is a
+// compile-time constant that does not depend on the value, or zero otherwise.
+// Every encoding is at least one byte, so zero unambiguously marks encodings
+// with variable size. Container encodings use this trait to compute their size
+// without visiting every element.
+//
+// Specializations are provided next to the encodings of the fixed size types:
+// bool, float, double, and arrays, structures, and tuples of fixed size types.
+// Integers are variable size because small values use the compact FixInt
+// encodings.
+template <typename T, typename Enabled = void>
+struct FixedEncodingSize : std::integral_constant<std::size_t, 0> {};
+
+// Evaluates to true if type T has a fixed encoded size.
+template <typename T>
+struct HasFixedEncodingSize
+    : std::integral_constant<bool, FixedEncodingSize<T>::value != 0> {};
+
+// Evaluates to a lower bound on the encoded size of type T: the fixed encoded
+// size when there is one, and otherwise the size of the prefix byte.
+template <typename T>
+struct MinimumEncodingSize
+    : std::integral_constant<std::size_t, HasFixedEncodingSize<T>::value
+                                              ? FixedEncodingSize<T>::value
+                                              : 1> {};
+
+namespace detail {
+
+template <typename Reader>
+using ReaderRemainingTest = decltype(std::declval<const Reader&>().remaining());
+
+// Reserves storage for up to |size| elements in |container|. The reservation is
+// bounded by the number of elements of at least |ElementSize| encoded bytes
+// that the bytes remaining in |reader| could possibly hold, so that an abusive
+// size cannot cause a large allocation. No storage is reserved for readers
+// that do not report the bytes remaining.
+template <std::size_t ElementSize, typename Container, typename Reader>
+void ReserveEncodedElements(Container* container, SizeType size,
+                            const Reader& reader, std::true_type) {
+  const SizeType limit = reader.remaining() / ElementSize;
+  container->reserve(size < limit ? size : limit);
+}
+template <std::size_t ElementSize, typename Container, typename Reader>
+void ReserveEncodedElements(Container* /*container*/, SizeType /*size*/,
+                            const Reader& /*reader*/, std::false_type) {}
+
+template <std::size_t ElementSize, typename Container, typename Reader>
+void ReserveEncodedElements(Container* container, SizeType size,
+                            const Reader& reader) {
+  ReserveEncodedElements<ElementSize>(
+      container, size, reader, IsDetected<ReaderRemainingTest, Reader>{});
+}
+
+}  // namespace detail
+
+// Sums the fixed encoded sizes of the given types.
+template <typename... Ts>
+struct FixedEncodingSizeSum : std::integral_constant<std::size_t, 0> {};
+template <typename First, typename... Rest>
+struct FixedEncodingSizeSum<First, Rest...>
+    : std::integral_constant<std::size_t,
+                             FixedEncodingSize<First>::value +
+                                 FixedEncodingSizeSum<Rest...>::value> {};
+
 // Forwards reference types to the underlying type encoder.
 template <typename T>
 struct Encoding<T&&> : Encoding<T> {};
@@ -214,6 +596,11 @@ struct Encoding<bool> : EncodingIO<bool> {
   }
 };
 
+template <>
+struct FixedEncodingSize<bool>
+    : std::integral_constant<std::size_t,
+                             BaseEncodingSize(EncodingByte::True)> {};
+
 //
 // char encoding formats:
 //
@@ -249,6 +636,12 @@ struct Encoding<char> : EncodingIO<char> {
            prefix == EncodingByte::U8;
   }
 
+  template <typename Writer>
+  static constexpr Status<void> WriteWithPrefix(char value, Writer* writer) {
+    return detail::WriteUnsignedInteger(static_cast<std::uint8_t>(value),
+                                        writer);
+  }
+
   template <typename Writer>
   static constexpr Status<void> WritePayload(EncodingByte prefix, char value,
                                              Writer* writer) {
@@ -301,6 +694,12 @@ struct Encoding<std::uint8_t> : EncodingIO<std::uint8_t> {
            prefix == EncodingByte::U8;
   }
 
+  template <typename Writer>
+  static constexpr Status<void> WriteWithPrefix(std::uint8_t value,
+                                                Writer* writer) {
+    return detail::WriteUnsignedInteger(value, writer);
+  }
+
   template <typename Writer>
   static constexpr Status<void> WritePayload(EncodingByte prefix,
                                              std::uint8_t value,
@@ -361,6 +760,12 @@ struct Encoding<std::int8_t> : EncodingIO<std::int8_t> {
            prefix == EncodingByte::I8;
   }
 
+  template <typename Writer>
+  static constexpr Status<void> WriteWithPrefix(std::int8_t value,
+                                                Writer* writer) {
+    return detail::WriteSignedInteger(value, writer);
+  }
+
   template <typename Writer>
   static constexpr Status<void> WritePayload(EncodingByte prefix,
                                              std::int8_t value,
@@ -419,6 +824,12 @@ struct Encoding<std::uint16_t> : EncodingIO<std::uint16_t> {
     return Encoding<std::uint8_t>::Match(prefix) || prefix == EncodingByte::U16;
   }
 
+  template <typename Writer>
+  static constexpr Status<void> WriteWithPrefix(std::uint16_t value,
+                                                Writer* writer) {
+    return detail::WriteUnsignedInteger(value, writer);
+  }
+
   template <typename Writer>
   static constexpr Status<void> WritePayload(EncodingByte prefix,
                                              std::uint16_t value,
@@ -485,6 +896,12 @@ struct Encoding<std::int16_t> : EncodingIO<std::int16_t> {
     return Encoding<std::int8_t>::Match(prefix) || prefix == EncodingByte::I16;
   }
 
+  template <typename Writer>
+  static constexpr Status<void> WriteWithPrefix(std::int16_t value,
+                                                Writer* writer) {
+    return detail::WriteSignedInteger(value, writer);
+  }
+
   template <typename Writer>
   static constexpr Status<void> WritePayload(EncodingByte prefix,
                                              std::int16_t value,
@@ -554,6 +971,12 @@ struct Encoding<std::uint32_t> : EncodingIO<std::uint32_t> {
            prefix == EncodingByte::U32;
   }
 
+  template <typename Writer>
+  static constexpr Status<void> WriteWithPrefix(std::uint32_t value,
+                                                Writer* writer) {
+    return detail::WriteUnsignedInteger(value, writer);
+  }
+
   template <typename Writer>
   static constexpr Status<void> WritePayload(EncodingByte prefix,
                                              std::uint32_t value,
@@ -630,6 +1053,12 @@ struct Encoding<std::int32_t> : EncodingIO<std::int32_t> {
     return Encoding<std::int16_t>::Match(prefix) || prefix == EncodingByte::I32;
   }
 
+  template <typename Writer>
+  static constexpr Status<void> WriteWithPrefix(std::int32_t value,
+                                                Writer* writer) {
+    return detail::WriteSignedInteger(value, writer);
+  }
+
   template <typename Writer>
   static constexpr Status<void> WritePayload(EncodingByte prefix,
                                              std::int32_t value,
@@ -864,6 +1293,11 @@ struct Encoding<float> : EncodingIO<float> {
   }
 };
 
+template <>
+struct FixedEncodingSize<float>
+    : std::integral_constant<std::size_t,
+                             BaseEncodingSize(EncodingByte::F32)> {};
+
 //
 // double encoding format:
 // +-----+---//----+
@@ -898,6 +1332,11 @@ struct Encoding<double> : EncodingIO<double> {
   }
 };
 
+template <>
+struct FixedEncodingSize<double>
+    : std::integral_constant<std::size_t,
+                             BaseEncodingSize(EncodingByte::F64)> {};
+
 //
 // std::size_t encoding format depends on the size of std::size_t for the
 // platform. Simply forward to either std::uint32_t or std::uint64_t.
@@ -930,6 +1369,13 @@ struct Encoding<T,
     return Encoding<BaseType>::Match(prefix);
   }
 
+  // Only defined when the base type writes the prefix and payload together.
+  template <typename Writer, typename Base = BaseType>
+  static constexpr auto WriteWithPrefix(std::size_t value, Writer* writer)
+      -> decltype(Encoding<Base>::WriteWithPrefix(value, writer)) {
+    return Encoding<Base>::WriteWithPrefix(value, writer);
+  }
+
   template <typename Writer>
   static constexpr Status<void> WritePayload(EncodingByte prefix,
                                              std::size_t value,
@@ -958,6 +1404,18 @@ struct Encoding<T, std::enable_if_t<std::is_same<T, int>::value &&
                                     sizeof(int) == sizeof(std::int32_t)>>
     : Encoding<std::int32_t> {};
 
+// Evaluates to the encoded size of a container with the given prefix and
+// |Count| elements of type T, when T has a fixed encoded size, or zero
+// otherwise.
+template <typename T, EncodingByte Prefix, std::size_t Count>
+struct FixedContainerEncodingSize
+    : std::integral_constant<
+          std::size_t,
+          HasFixedEncodingSize<T>::value
+              ? BaseEncodingSize(Prefix) + Encoding<SizeType>::Size(Count) +
+                    Count * FixedEncodingSize<T>::value
+              : 0> {};
+
 }  // namespace nop
 
 #endif  // LIBNOP_INCLUDE_NOP_BASE_ENCODING_H_
@@ -93,6 +93,16 @@ enum class EncodingByte : std::uint8_t {
   NegativeFixIntMax = 0xff,
 };
 
+// Extension types. The Extension encoding byte is followed by one of these
+// values, which determines the format of the rest of the encoding.
+enum class ExtensionType : std::uint8_t {
+  // Definition of or reference to an entry of the string table of a message.
+  StringTable = 0,
+
+  // Definition of or reference to an object shared by std::shared_ptr.
+  SharedPointer = 1,
+};
+
 }  // namespace nop
 
 #endif  // LIBNOP_INCLUDE_NOP_BASE_ENCODING_BYTE_H_
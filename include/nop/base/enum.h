@@ -47,6 +47,17 @@ struct Encoding<T, EnableIfEnum<T>> : EncodingIO<T> {
     return Encoding<IntegerType>::Match(prefix);
   }
 
+  // Only defined when the underlying type writes the prefix and payload
+  // together.
+  template <typename Writer,
+            typename Integer = typename std::underlying_type<T>::type>
+  static constexpr auto WriteWithPrefix(const T& value, Writer* writer)
+      -> decltype(Encoding<Integer>::WriteWithPrefix(
+          static_cast<Integer>(value), writer)) {
+    return Encoding<Integer>::WriteWithPrefix(static_cast<Integer>(value),
+                                              writer);
+  }
+
   template <typename Writer>
   static constexpr Status<void> WritePayload(EncodingByte prefix,
                                              const T& value, Writer* writer) {
@@ -0,0 +1,236 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_BASE_FLAT_H_
+#define LIBNOP_INCLUDE_NOP_BASE_FLAT_H_
+
+#include <numeric>
+#include <utility>
+
+#include <nop/base/encoding.h>
+#include <nop/types/flat_map.h>
+#include <nop/types/flat_set.h>
+#include <nop/utility/reuse_storage.h>
+
+namespace nop {
+
+//
+// FlatMap<Key, T> encoding format:
+//
+// +-----+---------+--------//---------+
+// | MAP | INT64:N | N KEY/VALUE PAIRS |
+// +-----+---------+--------//---------+
+//
+// FlatSet<Key> encoding format:
+//
+// +-----+---------+-----//-----+
+// | ARY | INT64:N | N ELEMENTS |
+// +-----+---------+-----//-----+
+//
+// These are the same formats as std::map and std::set. Elements are decoded
+// into the underlying vector in the order they are read, which is then sorted
+// only if the input was out of order, so that decoding sorted input takes
+// linear time. Readers that reuse storage decode over the existing elements.
+//
+
+namespace detail {
+
+// Decodes |size| elements over the existing elements of |elements| when the
+// reader reuses storage, or clears it first otherwise. |read| decodes one
+// element from the reader.
+template <typename Container, typename Reader, typename Read>
+Status<void> ReadFlatElements(SizeType size, Container* elements,
+                              Reader* /*reader*/, Read read) {
+  SizeType i = 0;
+  if (ReaderReusesStorage<Reader>::value) {
+    if (elements->size() > size)
+      elements->erase(elements->begin() + size, elements->end());
+
+    for (; i < elements->size(); i++) {
+      auto status = read(&(*elements)[i]);
+      if (!status)
+        return status;
+    }
+  } else {
+    elements->clear();
+  }
+
+  for (; i < size; i++) {
+    typename Container::value_type element;
+    auto status = read(&element);
+    if (!status)
+      return status;
+
+    elements->push_back(std::move(element));
+  }
+
+  return {};
+}
+
+}  // namespace detail
+
+template <typename Key, typename T, typename Compare, typename Allocator>
+struct Encoding<FlatMap<Key, T, Compare, Allocator>>
+    : EncodingIO<FlatMap<Key, T, Compare, Allocator>> {
+  using Type = FlatMap<Key, T, Compare, Allocator>;
+
+  static constexpr EncodingByte Prefix(const Type& /*value*/) {
+    return EncodingByte::Map;
+  }
+
+  static std::size_t Size(const Type& value) {
+    return BaseEncodingSize(Prefix(value)) +
+           Encoding<SizeType>::Size(value.size()) +
+           std::accumulate(
+               value.cbegin(), value.cend(), 0U,
+               [](const std::size_t& sum, const std::pair<Key, T>& element) {
+                 return sum + Encoding<Key>::Size(element.first) +
+                        Encoding<T>::Size(element.second);
+               });
+  }
+
+  static constexpr bool Match(EncodingByte prefix) {
+    return prefix == EncodingByte::Map;
+  }
+
+  template <typename Writer>
+  static Status<void> WritePayload(EncodingByte /*prefix*/, const Type& value,
+                                   Writer* writer) {
+    auto status = Encoding<SizeType>::Write(value.size(), writer);
+    if (!status)
+      return status;
+
+    for (const auto& element : value) {
+      status = Encoding<Key>::Write(element.first, writer);
+      if (!status)
+        return status;
+
+      status = Encoding<T>::Write(element.second, writer);
+      if (!status)
+        return status;
+    }
+
+    return {};
+  }
+
+  template <typename Reader>
+  static Status<void> ReadPayload(EncodingByte /*prefix*/, Type* value,
+                                  Reader* reader) {
+    SizeType size = 0;
+    auto status = Encoding<SizeType>::Read(&size, reader);
+    if (!status)
+      return status;
+
+    // Decode into the underlying vector, keeping its capacity, and restore the
+    // map even on failure.
+    typename Type::container_type elements = std::move(*value).extract();
+    if (!ReaderReusesStorage<Reader>::value) {
+      elements.clear();
+      detail::ReserveEncodedElements<MinimumEncodingSize<Key>::value +
+                                     MinimumEncodingSize<T>::value>(
+          &elements, size, *reader);
+    }
+
+    status = detail::ReadFlatElements(
+        size, &elements, reader, [reader](std::pair<Key, T>* element) {
+          auto status = Encoding<Key>::Read(&element->first, reader);
+          if (!status)
+            return status;
+
+          return Encoding<T>::Read(&element->second, reader);
+        });
+
+    value->replace(std::move(elements));
+    return status;
+  }
+};
+
+template <typename Key, typename Compare, typename Allocator>
+struct Encoding<FlatSet<Key, Compare, Allocator>>
+    : EncodingIO<FlatSet<Key, Compare, Allocator>> {
+  using Type = FlatSet<Key, Compare, Allocator>;
+
+  static constexpr EncodingByte Prefix(const Type& /*value*/) {
+    return EncodingByte::Array;
+  }
+
+  static std::size_t Size(const Type& value) {
+    if (HasFixedEncodingSize<Key>::value) {
+      return BaseEncodingSize(Prefix(value)) +
+             Encoding<SizeType>::Size(value.size()) +
+             value.size() * FixedEncodingSize<Key>::value;
+    }
+
+    return BaseEncodingSize(Prefix(value)) +
+           Encoding<SizeType>::Size(value.size()) +
+           std::accumulate(value.cbegin(), value.cend(), 0U,
+                           [](const std::size_t& sum, const Key& element) {
+                             return sum + Encoding<Key>::Size(element);
+                           });
+  }
+
+  static constexpr bool Match(EncodingByte prefix) {
+    return prefix == EncodingByte::Array;
+  }
+
+  template <typename Writer>
+  static Status<void> WritePayload(EncodingByte /*prefix*/, const Type& value,
+                                   Writer* writer) {
+    auto status = Encoding<SizeType>::Write(value.size(), writer);
+    if (!status)
+      return status;
+
+    for (const Key& element : value) {
+      status = Encoding<Key>::Write(element, writer);
+      if (!status)
+        return status;
+    }
+
+    return {};
+  }
+
+  template <typename Reader>
+  static Status<void> ReadPayload(EncodingByte /*prefix*/, Type* value,
+                                  Reader* reader) {
+    SizeType size = 0;
+    auto status = Encoding<SizeType>::Read(&size, reader);
+    if (!status)
+      return status;
+
+    // Decode into the underlying vector, keeping its capacity, and restore the
+    // set even on failure.
+    typename Type::container_type elements = std::move(*value).extract();
+    if (!ReaderReusesStorage<Reader>::value) {
+      elements.clear();
+      detail::ReserveEncodedElements<MinimumEncodingSize<Key>::value>(
+          &elements, size, *reader);
+    }
+
+    status = detail::ReadFlatElements(size, &elements, reader,
+                                      [reader](Key* element) {
+                                        return Encoding<Key>::Read(element,
+                                                                   reader);
+                                      });
+
+    value->replace(std::move(elements));
+    return status;
+  }
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_BASE_FLAT_H_
@@ -17,7 +17,10 @@
 #ifndef LIBNOP_INCLUDE_NOP_BASE_HANDLE_H_
 #define LIBNOP_INCLUDE_NOP_BASE_HANDLE_H_
 
+#include <type_traits>
+
 #include <nop/base/encoding.h>
+#include <nop/traits/is_template_base_of.h>
 #include <nop/types/handle.h>
 
 namespace nop {
@@ -29,10 +32,22 @@ namespace nop {
 // | HND | TYPE | INT64:REF |
 // +-----+------+-----------+
 //
+// UniqueHandle<Policy> and types derived from it, such as UniqueFileHandle,
+// use the same format. Writers reference the handle without taking ownership
+// of it, and readers transfer ownership of the received handle to the value.
+//
+
+namespace detail {
 
+// Deduces the policy of a type derived from Handle<Policy>.
 template <typename Policy>
-struct Encoding<Handle<Policy>> : EncodingIO<Handle<Policy>> {
-  using Type = Handle<Policy>;
+Policy DeduceHandlePolicy(const Handle<Policy>*);
+
+template <typename T>
+using HandlePolicyType = decltype(DeduceHandlePolicy(std::declval<T*>()));
+
+template <typename Type, typename Policy>
+struct HandleEncoding : EncodingIO<Type> {
   using HandleType = decltype(Policy::HandleType());
 
   static constexpr EncodingByte Prefix(const Type& /*value*/) {
@@ -91,6 +106,16 @@ struct Encoding<Handle<Policy>> : EncodingIO<Handle<Policy>> {
   }
 };
 
+}  // namespace detail
+
+template <typename Policy>
+struct Encoding<Handle<Policy>>
+    : detail::HandleEncoding<Handle<Policy>, Policy> {};
+
+template <typename T>
+struct Encoding<T, std::enable_if_t<IsTemplateBaseOf<UniqueHandle, T>::value>>
+    : detail::HandleEncoding<T, detail::HandlePolicyType<T>> {};
+
 }  // namespace nop
 
 #endif  // LIBNOP_INCLUDE_NOP_BASE_HANDLE_H_
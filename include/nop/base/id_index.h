@@ -0,0 +1,91 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_BASE_ID_INDEX_H_
+#define LIBNOP_INCLUDE_NOP_BASE_ID_INDEX_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace nop {
+namespace detail {
+
+// Compile-time index from a set of unique 64-bit ids to their positions in the
+// order given. This is used to dispatch on ids read from the wire, such as
+// table entry ids, without comparing against every id in turn.
+//
+// Lookups of ids that are dense and in position order, such as table entries
+// numbered 0 to N - 1 in declaration order, take constant time. Otherwise the
+// lookup is a binary search over the sorted ids.
+template <std::size_t Count>
+class IdIndex {
+ public:
+  template <typename... Ids>
+  constexpr IdIndex(Ids... ids)
+      : ids_{static_cast<std::uint64_t>(ids)...} {
+    static_assert(sizeof...(Ids) == Count,
+                  "The number of ids must match the index size.");
+    for (std::size_t i = 0; i < Count; i++)
+      positions_[i] = i;
+
+    // Insertion sort by id. The ids are few and sorted at compile time.
+    for (std::size_t i = 1; i < Count; i++) {
+      for (std::size_t j = i; j > 0 && ids_[j - 1] > ids_[j]; j--) {
+        Swap(&ids_[j - 1], &ids_[j]);
+        Swap(&positions_[j - 1], &positions_[j]);
+      }
+    }
+  }
+
+  // Returns the position of |id|, or Count if the id is not in the index.
+  constexpr std::size_t Find(std::uint64_t id) const {
+    if (id < Count && ids_[id] == id)
+      return positions_[id];
+
+    std::size_t begin = 0;
+    std::size_t end = Count;
+    while (begin < end) {
+      const std::size_t middle = begin + (end - begin) / 2;
+      if (ids_[middle] < id)
+        begin = middle + 1;
+      else
+        end = middle;
+    }
+
+    if (begin < Count && ids_[begin] == id)
+      return positions_[begin];
+    else
+      return Count;
+  }
+
+ private:
+  template <typename T>
+  static constexpr void Swap(T* a, T* b) {
+    const T temp = *a;
+    *a = *b;
+    *b = temp;
+  }
+
+  // Zero-length arrays are not allowed; empty indices use a single unused
+  // element.
+  std::uint64_t ids_[Count ? Count : 1]{};
+  std::size_t positions_[Count ? Count : 1]{};
+};
+
+}  // namespace detail
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_BASE_ID_INDEX_H_
@@ -0,0 +1,197 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_BASE_INTERNED_H_
+#define LIBNOP_INCLUDE_NOP_BASE_INTERNED_H_
+
+#include <cstdint>
+#include <string>
+
+#include <nop/base/encoding.h>
+#include <nop/base/string.h>
+#include <nop/base/view.h>
+#include <nop/types/interned.h>
+
+namespace nop {
+
+//
+// Interned<String> encoding format for the first occurrence of a string, which
+// defines a new entry in the string table:
+//
+// +-----+---+-----+---------+---//----+
+// | EXT | 0 | STR | INT64:N | N BYTES |
+// +-----+---+-----+---------+---//----+
+//
+// Interned<String> encoding format for later occurrences, which refer to entry
+// I of the string table:
+//
+// +-----+---+---------+
+// | EXT | 0 | INT64:I |
+// +-----+---+---------+
+//
+// Where 0 is ExtensionType::StringTable. Entries are numbered from zero in the
+// order they are defined.
+//
+// Writing requires a writer that provides the following method, which returns
+// the index of an earlier occurrence of |string| or kNewStringReference after
+// adding |string| to the table:
+//
+//   Status<StringReference> InternString(StringView string);
+//
+// Reading requires a reader that provides the following methods:
+//
+//   Status<void> DefineString(StringView string);
+//   Status<StringView> GetString(StringReference reference);
+//
+// When the reader can borrow, definitions are decoded by borrowing them from
+// the input and the strings passed to DefineString() refer into the input.
+// See InterningWriter and InterningReader. The wrapper writers and readers,
+// such as BoundedWriter and BoundedReader, forward these methods, so interned
+// strings may be nested in table entries.
+//
+// The format is self-delimiting, so SkipValue() skips interned strings without
+// knowing their type.
+//
+
+namespace detail {
+
+template <typename Traits, typename Allocator>
+void AssignInterned(std::basic_string<char, Traits, Allocator>* value,
+                    StringView string) {
+  value->assign(string.data(), string.size());
+}
+inline void AssignInterned(StringView* value, StringView string) {
+  *value = string;
+}
+
+}  // namespace detail
+
+template <typename String>
+struct Encoding<Interned<String>> : EncodingIO<Interned<String>> {
+  using Type = Interned<String>;
+
+  static constexpr EncodingByte Prefix(const Type& /*value*/) {
+    return EncodingByte::Extension;
+  }
+
+  // Overestimates the size as though the string is defined in full, or as a
+  // U32 reference if that is larger, because whether the string is already in
+  // the table is not known ahead of serialization.
+  static std::size_t Size(const Type& value) {
+    const std::size_t definition = Encoding<StringView>::Size(value.get());
+    const std::size_t reference = BaseEncodingSize(EncodingByte::U32);
+    return BaseEncodingSize(Prefix(value)) +
+           Encoding<std::uint8_t>::Size(
+               static_cast<std::uint8_t>(ExtensionType::StringTable)) +
+           (definition > reference ? definition : reference);
+  }
+
+  static constexpr bool Match(EncodingByte prefix) {
+    return prefix == EncodingByte::Extension;
+  }
+
+  template <typename Writer>
+  static Status<void> WritePayload(EncodingByte /*prefix*/, const Type& value,
+                                   Writer* writer) {
+    auto status = Encoding<std::uint8_t>::Write(
+        static_cast<std::uint8_t>(ExtensionType::StringTable), writer);
+    if (!status)
+      return status;
+
+    const StringView string{value.get()};
+    auto intern_status = writer->InternString(string);
+    if (!intern_status)
+      return intern_status.error();
+    else if (intern_status.get() == kNewStringReference)
+      return Encoding<StringView>::Write(string, writer);
+    else
+      return Encoding<StringReference>::Write(intern_status.get(), writer);
+  }
+
+  template <typename Reader>
+  static Status<void> ReadPayload(EncodingByte /*prefix*/, Type* value,
+                                  Reader* reader) {
+    std::uint8_t extension_type = 0;
+    auto status = Encoding<std::uint8_t>::Read(&extension_type, reader);
+    if (!status)
+      return status;
+    else if (extension_type !=
+             static_cast<std::uint8_t>(ExtensionType::StringTable))
+      return ErrorStatus::UnexpectedEncodingType;
+
+    std::uint8_t prefix_byte = 0;
+    status = reader->Read(&prefix_byte);
+    if (!status)
+      return status;
+
+    const EncodingByte prefix = static_cast<EncodingByte>(prefix_byte);
+    if (prefix == EncodingByte::String)
+      return ReadDefinition(value, reader, ReaderCanBorrow<Reader>{});
+    else if (!Encoding<StringReference>::Match(prefix))
+      return ErrorStatus::UnexpectedEncodingType;
+
+    StringReference reference = 0;
+    status = Encoding<StringReference>::ReadPayload(prefix, &reference, reader);
+    if (!status)
+      return status;
+
+    auto get_status = reader->GetString(reference);
+    if (!get_status)
+      return get_status.error();
+
+    detail::AssignInterned(&value->get(), get_status.get());
+    return {};
+  }
+
+ private:
+  // Borrows the definition from the input, so that the table refers to it
+  // without making a copy.
+  template <typename Reader>
+  static Status<void> ReadDefinition(Type* value, Reader* reader,
+                                     std::true_type /*can_borrow*/) {
+    StringView string;
+    auto status = Encoding<StringView>::ReadPayload(EncodingByte::String,
+                                                    &string, reader);
+    if (!status)
+      return status;
+
+    status = reader->DefineString(string);
+    if (!status)
+      return status;
+
+    detail::AssignInterned(&value->get(), string);
+    return {};
+  }
+
+  // Reads the definition into the value, which the table then copies.
+  template <typename Reader>
+  static Status<void> ReadDefinition(Type* value, Reader* reader,
+                                     std::false_type /*can_borrow*/) {
+    static_assert(!std::is_same<String, StringView>::value,
+                  "Decoding a view requires a reader that provides Borrow().");
+
+    auto status = Encoding<String>::ReadPayload(EncodingByte::String,
+                                                &value->get(), reader);
+    if (!status)
+      return status;
+
+    return reader->DefineString(StringView{value->get()});
+  }
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_BASE_INTERNED_H_
@@ -0,0 +1,148 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_BASE_LAZY_ARRAY_H_
+#define LIBNOP_INCLUDE_NOP_BASE_LAZY_ARRAY_H_
+
+#include <limits>
+
+#include <nop/base/encoding.h>
+#include <nop/base/skip.h>
+#include <nop/base/vector.h>
+#include <nop/types/lazy_array.h>
+
+namespace nop {
+
+//
+// LazyArray<T> reads the same formats as std::vector<T>. See base/vector.h.
+//
+// The elements are not decoded during deserialization. Instead, the location
+// and number of the elements are recorded. Elements without a fixed encoded
+// size are skipped to find the end of the array.
+//
+// LazyArray<T> writes the recorded elements verbatim in the format they were
+// read in. An empty LazyArray is written in the format std::vector<T> writes.
+//
+
+template <typename T>
+struct Encoding<LazyArray<T>> : EncodingIO<LazyArray<T>> {
+  using Type = LazyArray<T>;
+
+  static constexpr EncodingByte Prefix(const Type& value) {
+    return value.binary_ || IsIntegral<T>::value ? EncodingByte::Binary
+                                                 : EncodingByte::Array;
+  }
+
+  static constexpr std::size_t Size(const Type& value) {
+    return BaseEncodingSize(Prefix(value)) +
+           Encoding<SizeType>::Size(Length(value)) + value.size_;
+  }
+
+  static constexpr bool Match(EncodingByte prefix) {
+    return Encoding<std::vector<T>>::Match(prefix);
+  }
+
+  template <typename Writer>
+  static Status<void> WritePayload(EncodingByte /*prefix*/, const Type& value,
+                                   Writer* writer) {
+    auto status = Encoding<SizeType>::Write(Length(value), writer);
+    if (!status)
+      return status;
+
+    return writer->Write(value.data_, value.data_ + value.size_);
+  }
+
+  template <typename Reader>
+  static Status<void> ReadPayload(EncodingByte prefix, Type* value,
+                                  Reader* reader) {
+    value->clear();
+
+    SizeType length = 0;
+    auto status = Encoding<SizeType>::Read(&length, reader);
+    if (!status)
+      return status;
+
+    SizeType size = 0;
+    if (prefix == EncodingByte::Binary) {
+      if (length % sizeof(T) != 0)
+        return ErrorStatus::InvalidContainerLength;
+
+      size = length;
+      value->count_ = length / sizeof(T);
+      value->binary_ = true;
+    } else if (HasFixedEncodingSize<T>::value) {
+      const std::size_t element_size = FixedEncodingSize<T>::value;
+      if (length > std::numeric_limits<SizeType>::max() / element_size)
+        return ErrorStatus::ReadLimitReached;
+
+      size = length * element_size;
+      value->count_ = length;
+    } else {
+      return ReadVariablePayload(length, value, reader);
+    }
+
+    status = reader->Ensure(size);
+    if (!status)
+      return status;
+
+    const void* data = nullptr;
+    status = reader->Borrow(size, &data);
+    if (!status)
+      return status;
+
+    value->data_ = static_cast<const std::uint8_t*>(data);
+    value->size_ = size;
+    return {};
+  }
+
+ private:
+  // Returns the integer that follows the prefix: the number of bytes for the
+  // BIN encoding and the number of elements for the ARY encoding.
+  static constexpr SizeType Length(const Type& value) {
+    return Prefix(value) == EncodingByte::Binary ? value.size_ : value.count_;
+  }
+
+  // Skips |count| elements of variable size to find the end of the array.
+  template <typename Reader>
+  static Status<void> ReadVariablePayload(SizeType count, Type* value,
+                                          Reader* reader) {
+    const void* begin = nullptr;
+    auto status = reader->Borrow(0, &begin);
+    if (!status)
+      return status;
+
+    for (SizeType i = 0; i < count; i++) {
+      status = SkipValue(reader);
+      if (!status)
+        return status;
+    }
+
+    const void* end = nullptr;
+    status = reader->Borrow(0, &end);
+    if (!status)
+      return status;
+
+    value->data_ = static_cast<const std::uint8_t*>(begin);
+    value->size_ = static_cast<const std::uint8_t*>(end) - value->data_;
+    value->count_ = count;
+    return {};
+  }
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_BASE_LAZY_ARRAY_H_
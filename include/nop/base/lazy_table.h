@@ -0,0 +1,94 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_BASE_LAZY_TABLE_H_
+#define LIBNOP_INCLUDE_NOP_BASE_LAZY_TABLE_H_
+
+#include <nop/base/encoding.h>
+#include <nop/base/table.h>
+#include <nop/types/lazy_table.h>
+
+namespace nop {
+
+//
+// LazyTable<Table> reads the same format as Table. See base/table.h.
+//
+// The entries are not decoded during deserialization. Instead, the location of
+// the binary container of each known entry is recorded and unknown entries are
+// skipped.
+//
+
+template <typename Table>
+struct Encoding<LazyTable<Table>> : EncodingIO<LazyTable<Table>> {
+  using Type = LazyTable<Table>;
+
+  static constexpr EncodingByte Prefix(const Type& /*value*/) {
+    return EncodingByte::Table;
+  }
+
+  static constexpr bool Match(EncodingByte prefix) {
+    return prefix == EncodingByte::Table;
+  }
+
+  template <typename Reader>
+  static Status<void> ReadPayload(EncodingByte /*prefix*/, Type* value,
+                                  Reader* reader) {
+    value->clear();
+
+    std::uint64_t hash = 0;
+    auto status = Encoding<std::uint64_t>::Read(&hash, reader);
+    if (!status)
+      return status;
+    else if (hash != EntryListTraits<Table>::EntryList::Hash)
+      return ErrorStatus::InvalidTableHash;
+
+    SizeType count = 0;
+    status = Encoding<SizeType>::Read(&count, reader);
+    if (!status)
+      return status;
+
+    for (SizeType i = 0; i < count; i++) {
+      std::uint64_t id = 0;
+      status = Encoding<std::uint64_t>::Read(&id, reader);
+      if (!status)
+        return status;
+
+      SizeType size = 0;
+      status = Encoding<SizeType>::Read(&size, reader);
+      if (!status)
+        return status;
+
+      status = reader->Ensure(size);
+      if (!status)
+        return status;
+
+      const void* data = nullptr;
+      status = reader->Borrow(size, &data);
+      if (!status)
+        return status;
+
+      status = value->SetEntry(id, data, size);
+      if (!status)
+        return status;
+    }
+
+    return {};
+  }
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_BASE_LAZY_TABLE_H_
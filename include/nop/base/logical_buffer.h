@@ -19,12 +19,14 @@
 
 #include <array>
 #include <cstddef>
+#include <cstdint>
 #include <limits>
 #include <type_traits>
 
 #include <nop/base/encoding.h>
 #include <nop/base/utility.h>
 #include <nop/types/detail/logical_buffer.h>
+#include <nop/utility/endian.h>
 
 //
 // Logical buffers support the serialization of structures that contain a pair
@@ -76,6 +78,21 @@
 //
 // static_assert(nop::IsFungible<A, B>::value, "!!");
 //
+// Logical buffers may also pair a pointer with the size member, to encode from
+// and decode into memory owned outside of the structure without staging the
+// elements in an array member:
+//
+// struct Frame {
+//  std::uint64_t timestamp;
+//  std::uint8_t* pixels;
+//  std::uint32_t pixel_count;
+//  NOP_STRUCTURE(Frame, timestamp, (pixels, pixel_count));
+// };
+//
+// Decoding into a Frame writes the pixels into the pixel_count bytes |pixels|
+// points to. Using a const pointer instead binds |pixels| to the bytes of the
+// reader. See the pointer specialization of LogicalBuffer for details.
+//
 
 namespace nop {
 
@@ -187,7 +204,7 @@ struct Encoding<LogicalBuffer<BufferType, SizeType, IsUnbounded>,
     if (!status)
       return status;
 
-    return writer->Write(value.begin(), value.end());
+    return WriteElements(value.begin(), value.end(), writer);
   }
 
   template <typename Reader>
@@ -204,7 +221,169 @@ struct Encoding<LogicalBuffer<BufferType, SizeType, IsUnbounded>,
 
     const SizeType size = size_bytes / sizeof(ValueType);
     value->size() = size;
-    return reader->Read(value->begin(), value->end());
+    return ReadElements(value->begin(), value->end(), reader);
+  }
+};
+
+// Encoding type that handles logical buffers formed by a pointer and size
+// member pair. The format is the same as the array logical buffers above: BIN
+// for integral element types and ARY otherwise.
+template <typename T, typename SizeType, bool IsUnbounded>
+struct Encoding<LogicalBuffer<T*, SizeType, IsUnbounded>>
+    : EncodingIO<LogicalBuffer<T*, SizeType, IsUnbounded>> {
+  using Type = LogicalBuffer<T*, SizeType, IsUnbounded>;
+  using ValueType = std::remove_const_t<T>;
+  using IsBinary = IsIntegral<ValueType>;
+
+  static constexpr EncodingByte Prefix(const Type& /*value*/) {
+    return IsBinary::value ? EncodingByte::Binary : EncodingByte::Array;
+  }
+
+  static constexpr std::size_t Size(const Type& value) {
+    return Size(value, IsBinary{});
+  }
+
+  static constexpr bool Match(EncodingByte prefix) {
+    return prefix == (IsBinary::value ? EncodingByte::Binary
+                                      : EncodingByte::Array);
+  }
+
+  template <typename Writer>
+  static constexpr Status<void> WritePayload(EncodingByte /*prefix*/,
+                                             const Type& value,
+                                             Writer* writer) {
+    if (value.data() == nullptr && value.size() != 0)
+      return ErrorStatus::InvalidContainerLength;
+
+    return WritePayload(value, writer, IsBinary{});
+  }
+
+  template <typename Reader>
+  static Status<void> ReadPayload(EncodingByte /*prefix*/, Type* value,
+                                  Reader* reader) {
+    SizeType length = 0;
+    auto status = Encoding<SizeType>::Read(&length, reader);
+    if (!status)
+      return status;
+
+    return ReadPayload(length, value, reader, IsBinary{},
+                       std::integral_constant<bool, Type::IsBorrowed>{});
+  }
+
+ private:
+  static constexpr std::size_t Size(const Type& value,
+                                    std::true_type /*is_binary*/) {
+    const std::size_t size = value.size() * sizeof(ValueType);
+    return BaseEncodingSize(Prefix(value)) + Encoding<SizeType>::Size(size) +
+           size;
+  }
+
+  static constexpr std::size_t Size(const Type& value,
+                                    std::false_type /*is_binary*/) {
+    std::size_t element_size_sum = 0;
+    for (const ValueType& element : value)
+      element_size_sum += Encoding<ValueType>::Size(element);
+
+    return BaseEncodingSize(Prefix(value)) +
+           Encoding<SizeType>::Size(value.size()) + element_size_sum;
+  }
+
+  template <typename Writer>
+  static constexpr Status<void> WritePayload(const Type& value, Writer* writer,
+                                             std::true_type /*is_binary*/) {
+    auto status =
+        Encoding<SizeType>::Write(value.size() * sizeof(ValueType), writer);
+    if (!status)
+      return status;
+
+    return WriteElements(value.begin(), value.end(), writer);
+  }
+
+  template <typename Writer>
+  static constexpr Status<void> WritePayload(const Type& value, Writer* writer,
+                                             std::false_type /*is_binary*/) {
+    auto status = Encoding<SizeType>::Write(value.size(), writer);
+    if (!status)
+      return status;
+
+    for (const ValueType& element : value) {
+      status = Encoding<ValueType>::Write(element, writer);
+      if (!status)
+        return status;
+    }
+
+    return {};
+  }
+
+  // Decodes integral elements into the caller-supplied destination.
+  template <typename Reader>
+  static Status<void> ReadPayload(SizeType size_bytes, Type* value,
+                                  Reader* reader, std::true_type /*is_binary*/,
+                                  std::false_type /*is_borrowed*/) {
+    if (size_bytes % sizeof(ValueType) != 0)
+      return ErrorStatus::InvalidContainerLength;
+
+    const SizeType size = size_bytes / sizeof(ValueType);
+    if (size > value->size() || (size != 0 && value->data() == nullptr))
+      return ErrorStatus::InvalidContainerLength;
+
+    auto status = ReadElements(value->data(), value->data() + size, reader);
+    if (!status)
+      return status;
+
+    value->size() = size;
+    return {};
+  }
+
+  // Decodes non-integral elements into the caller-supplied destination.
+  template <typename Reader>
+  static Status<void> ReadPayload(SizeType size, Type* value, Reader* reader,
+                                  std::false_type /*is_binary*/,
+                                  std::false_type /*is_borrowed*/) {
+    if (size > value->size() || (size != 0 && value->data() == nullptr))
+      return ErrorStatus::InvalidContainerLength;
+
+    for (SizeType i = 0; i < size; i++) {
+      auto status = Encoding<ValueType>::Read(&value->data()[i], reader);
+      if (!status)
+        return status;
+    }
+
+    value->size() = size;
+    return {};
+  }
+
+  // Binds the pointer to the bytes of the reader.
+  template <typename Reader>
+  static Status<void> ReadPayload(SizeType size_bytes, Type* value,
+                                  Reader* reader, std::true_type /*is_binary*/,
+                                  std::true_type /*is_borrowed*/) {
+    static_assert(ReaderCanBorrow<Reader>::value,
+                  "Logical buffers of const elements require a reader that "
+                  "supports borrowing.");
+
+    if (size_bytes % sizeof(ValueType) != 0)
+      return ErrorStatus::InvalidContainerLength;
+
+    // Borrowed elements are used in place, so they must already be in host
+    // order.
+    if (sizeof(ValueType) > 1 && !kLittleEndianHost)
+      return ErrorStatus::UnexpectedEncodingType;
+
+    auto status = reader->Ensure(size_bytes);
+    if (!status)
+      return status;
+
+    const void* data = nullptr;
+    status = reader->Borrow(size_bytes, &data);
+    if (!status)
+      return status;
+    else if (reinterpret_cast<std::uintptr_t>(data) % alignof(ValueType) != 0)
+      return ErrorStatus::InvalidBufferAlignment;
+
+    value->data() = static_cast<T*>(data);
+    value->size() = size_bytes / sizeof(ValueType);
+    return {};
   }
 };
 
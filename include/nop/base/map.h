@@ -17,11 +17,16 @@
 #ifndef LIBNOP_INCLUDE_NOP_BASE_MAP_H_
 #define LIBNOP_INCLUDE_NOP_BASE_MAP_H_
 
+#include <algorithm>
+#include <functional>
 #include <map>
 #include <numeric>
 #include <unordered_map>
+#include <vector>
 
 #include <nop/base/encoding.h>
+#include <nop/utility/canonical.h>
+#include <nop/utility/reuse_storage.h>
 
 namespace nop {
 
@@ -34,6 +39,9 @@ namespace nop {
 //
 // Each pair must be a valid encoding of Key followed by a valid encoding of T.
 //
+// Pairs of unordered maps are written in iteration order, or in ascending key
+// order by canonical writers.
+//
 
 template <typename Key, typename T, typename Compare, typename Allocator>
 struct Encoding<std::map<Key, T, Compare, Allocator>>
@@ -49,7 +57,8 @@ struct Encoding<std::map<Key, T, Compare, Allocator>>
            Encoding<SizeType>::Size(value.size()) +
            std::accumulate(
                value.cbegin(), value.cend(), 0U,
-               [](const std::size_t& sum, const std::pair<Key, T>& element) {
+               [](const std::size_t& sum,
+                  const typename Type::value_type& element) {
                  return sum + Encoding<Key>::Size(element.first) +
                         Encoding<T>::Size(element.second);
                });
@@ -67,7 +76,7 @@ struct Encoding<std::map<Key, T, Compare, Allocator>>
     if (!status)
       return status;
 
-    for (const std::pair<Key, T>& element : value) {
+    for (const auto& element : value) {
       status = Encoding<Key>::Write(element.first, writer);
       if (!status)
         return status;
@@ -88,6 +97,12 @@ struct Encoding<std::map<Key, T, Compare, Allocator>>
     if (!status)
       return status;
 
+    if (ReaderReusesStorage<Reader>::value)
+      return ReadInPlace(size, value, reader);
+
+    // Maps are written in key order, so hinting each insertion at the end
+    // builds the tree in linear time. Input in a different order is also
+    // decoded correctly, at the usual logarithmic cost per element.
     value->clear();
     for (SizeType i = 0; i < size; i++) {
       std::pair<Key, T> element;
@@ -99,11 +114,45 @@ struct Encoding<std::map<Key, T, Compare, Allocator>>
       if (!status)
         return status;
 
-      value->emplace(std::move(element));
+      value->emplace_hint(value->end(), std::move(element));
     }
 
     return {};
   }
+
+ private:
+  // Decodes |size| entries over the existing entries of |value|. Since maps
+  // are written in key order, the decoded keys are merged with the existing
+  // keys in a single pass: existing entries that sort before the next decoded
+  // key are absent from the input and are erased, and entries with matching
+  // keys are decoded in place. Input in a different order is also decoded
+  // correctly, at the cost of reallocating the out of order entries.
+  template <typename Reader>
+  static Status<void> ReadInPlace(SizeType size, Type* value, Reader* reader) {
+    const Compare compare = value->key_comp();
+    auto position = value->begin();
+    Key key{};
+    for (SizeType i = 0; i < size; i++) {
+      auto status = Encoding<Key>::Read(&key, reader);
+      if (!status)
+        return status;
+
+      while (position != value->end() && compare(position->first, key))
+        position = value->erase(position);
+
+      if (position == value->end() || compare(key, position->first))
+        position = value->emplace_hint(position, std::move(key), T{});
+
+      status = Encoding<T>::Read(&position->second, reader);
+      if (!status)
+        return status;
+
+      ++position;
+    }
+
+    value->erase(position, value->end());
+    return {};
+  }
 };
 
 template <typename Key, typename T, typename Hash, typename KeyEqual,
@@ -121,7 +170,8 @@ struct Encoding<std::unordered_map<Key, T, Hash, KeyEqual, Allocator>>
            Encoding<SizeType>::Size(value.size()) +
            std::accumulate(
                value.cbegin(), value.cend(), 0U,
-               [](const std::size_t& sum, const std::pair<Key, T>& element) {
+               [](const std::size_t& sum,
+                  const typename Type::value_type& element) {
                  return sum + Encoding<Key>::Size(element.first) +
                         Encoding<T>::Size(element.second);
                });
@@ -139,12 +189,40 @@ struct Encoding<std::unordered_map<Key, T, Hash, KeyEqual, Allocator>>
     if (!status)
       return status;
 
-    for (const std::pair<Key, T>& element : value) {
-      status = Encoding<Key>::Write(element.first, writer);
+    return WriteElements(value, writer, WriterIsCanonical<Writer>{});
+  }
+
+  template <typename Writer>
+  static constexpr Status<void> WriteElements(const Type& value,
+                                              Writer* writer,
+                                              std::false_type /*canonical*/) {
+    for (const auto& element : value) {
+      auto status = WriteElement(element, writer);
       if (!status)
         return status;
+    }
 
-      status = Encoding<T>::Write(element.second, writer);
+    return {};
+  }
+
+  // Writes the elements in ascending key order, so that equal maps have the
+  // same encoding regardless of their insertion history. See Canonical.
+  template <typename Writer>
+  static Status<void> WriteElements(const Type& value, Writer* writer,
+                                    std::true_type /*canonical*/) {
+    std::vector<const typename Type::value_type*> elements;
+    elements.reserve(value.size());
+    for (const auto& element : value)
+      elements.push_back(&element);
+
+    std::sort(elements.begin(), elements.end(),
+              [](const typename Type::value_type* a,
+                 const typename Type::value_type* b) {
+                return std::less<Key>{}(a->first, b->first);
+              });
+
+    for (const auto* element : elements) {
+      auto status = WriteElement(*element, writer);
       if (!status)
         return status;
     }
@@ -152,6 +230,16 @@ struct Encoding<std::unordered_map<Key, T, Hash, KeyEqual, Allocator>>
     return {};
   }
 
+  template <typename Writer>
+  static constexpr Status<void> WriteElement(
+      const typename Type::value_type& element, Writer* writer) {
+    auto status = Encoding<Key>::Write(element.first, writer);
+    if (!status)
+      return status;
+
+    return Encoding<T>::Write(element.second, writer);
+  }
+
   template <typename Reader>
   static constexpr Status<void> ReadPayload(EncodingByte /*prefix*/,
                                             Type* value, Reader* reader) {
@@ -160,7 +248,15 @@ struct Encoding<std::unordered_map<Key, T, Hash, KeyEqual, Allocator>>
     if (!status)
       return status;
 
+    if (ReaderReusesStorage<Reader>::value)
+      return ReadInPlace(size, value, reader);
+
+    // Reserve the buckets up front, within the bound of the bytes remaining in
+    // the reader, to avoid rehashing as the elements are inserted.
     value->clear();
+    detail::ReserveEncodedElements<MinimumEncodingSize<Key>::value +
+                                   MinimumEncodingSize<T>::value>(value, size,
+                                                                  *reader);
     for (SizeType i = 0; i < size; i++) {
       std::pair<Key, T> element;
       status = Encoding<Key>::Read(&element.first, reader);
@@ -176,6 +272,59 @@ struct Encoding<std::unordered_map<Key, T, Hash, KeyEqual, Allocator>>
 
     return {};
   }
+
+ private:
+  // Decodes |size| entries over the existing entries of |value|. Entries with
+  // keys already present are decoded in place and the rest are inserted. The
+  // decoded entries are recorded on a thread-local stack, shared with nested
+  // maps of the same type, so that any remaining entries that were absent from
+  // the input can be found and erased afterwards without allocating in the
+  // steady state.
+  template <typename Reader>
+  static Status<void> ReadInPlace(SizeType size, Type* value, Reader* reader) {
+    static thread_local std::vector<const void*> decoded;
+    const std::size_t base = decoded.size();
+
+    Key key{};
+    for (SizeType i = 0; i < size; i++) {
+      auto status = Encoding<Key>::Read(&key, reader);
+      if (!status) {
+        decoded.resize(base);
+        return status;
+      }
+
+      auto position = value->find(key);
+      if (position == value->end())
+        position = value->emplace(std::move(key), T{}).first;
+
+      status = Encoding<T>::Read(&position->second, reader);
+      if (!status) {
+        decoded.resize(base);
+        return status;
+      }
+
+      decoded.push_back(&*position);
+    }
+
+    // Entries absent from the input remain when there are more entries than
+    // distinct keys decoded.
+    const auto begin = decoded.begin() + base;
+    std::sort(begin, decoded.end());
+    const auto end = std::unique(begin, decoded.end());
+    if (value->size() > static_cast<std::size_t>(end - begin)) {
+      for (auto position = value->begin(); position != value->end();) {
+        if (std::binary_search(begin, end,
+                               static_cast<const void*>(&*position))) {
+          ++position;
+        } else {
+          position = value->erase(position);
+        }
+      }
+    }
+
+    decoded.resize(base);
+    return {};
+  }
 };
 
 }  // namespace nop
@@ -17,10 +17,13 @@
 #ifndef LIBNOP_INCLUDE_NOP_BASE_MEMBERS_H_
 #define LIBNOP_INCLUDE_NOP_BASE_MEMBERS_H_
 
+#include <utility>
+
 #include <nop/base/encoding.h>
 #include <nop/base/logical_buffer.h>
 #include <nop/base/utility.h>
 #include <nop/types/detail/member_pointer.h>
+#include <nop/utility/compiler.h>
 
 namespace nop {
 
@@ -41,8 +44,11 @@ struct Encoding<T, EnableIfHasMemberList<T>> : EncodingIO<T> {
   }
 
   static constexpr std::size_t Size(const T& value) {
+    if (HasFixedEncodingSize<T>::value)
+      return FixedEncodingSize<T>::value;
+
     return BaseEncodingSize(Prefix(value)) + Encoding<SizeType>::Size(Count) +
-           Size(value, Index<Count>{});
+           Size(value, Members{});
   }
 
   static constexpr bool Match(EncodingByte prefix) {
@@ -56,7 +62,7 @@ struct Encoding<T, EnableIfHasMemberList<T>> : EncodingIO<T> {
     if (!status)
       return status;
     else
-      return WriteMembers(value, writer, Index<Count>{});
+      return WriteMembers(value, writer, Members{});
   }
 
   template <typename Reader>
@@ -69,7 +75,7 @@ struct Encoding<T, EnableIfHasMemberList<T>> : EncodingIO<T> {
     else if (size != Count)
       return ErrorStatus::InvalidMemberCount;
     else
-      return ReadMembers(value, reader, Index<Count>{});
+      return ReadMembers(value, reader, Members{});
   }
 
  private:
@@ -80,6 +86,38 @@ struct Encoding<T, EnableIfHasMemberList<T>> : EncodingIO<T> {
   template <std::size_t Index>
   using PointerAt = typename MemberList::template At<Index>;
 
+#if NOP_HAS_FOLD_EXPRESSIONS
+  // Expands the operations over all members at once. Writing and reading stop
+  // at the first member that fails.
+  using Members = std::make_index_sequence<Count>;
+
+  template <std::size_t... Is>
+  static constexpr std::size_t Size([[maybe_unused]] const T& value,
+                                    std::index_sequence<Is...>) {
+    return (std::size_t{0} + ... + PointerAt<Is>::Size(value));
+  }
+
+  template <typename Writer, std::size_t... Is>
+  static constexpr Status<void> WriteMembers([[maybe_unused]] const T& value,
+                                             [[maybe_unused]] Writer* writer,
+                                             std::index_sequence<Is...>) {
+    Status<void> status;
+    (void)((status = PointerAt<Is>::Write(value, writer, MemberList{})) &&
+           ...);
+    return status;
+  }
+
+  template <typename Reader, std::size_t... Is>
+  static constexpr Status<void> ReadMembers([[maybe_unused]] T* value,
+                                            [[maybe_unused]] Reader* reader,
+                                            std::index_sequence<Is...>) {
+    Status<void> status;
+    (void)((status = PointerAt<Is>::Read(value, reader, MemberList{})) && ...);
+    return status;
+  }
+#else
+  using Members = Index<Count>;
+
   static constexpr std::size_t Size(const T& /*value*/, Index<0>) { return 0; }
 
   template <std::size_t index>
@@ -118,8 +156,33 @@ struct Encoding<T, EnableIfHasMemberList<T>> : EncodingIO<T> {
     else
       return PointerAt<index - 1>::Read(value, reader, MemberList{});
   }
+#endif
 };
 
+namespace detail {
+
+template <typename MemberList>
+struct FixedMemberListEncodingSize;
+template <typename... MemberPointers>
+struct FixedMemberListEncodingSize<MemberList<MemberPointers...>>
+    : std::integral_constant<
+          std::size_t,
+          And<HasFixedEncodingSize<typename MemberPointers::Type>...>::value
+              ? BaseEncodingSize(EncodingByte::Structure) +
+                    Encoding<SizeType>::Size(sizeof...(MemberPointers)) +
+                    FixedEncodingSizeSum<
+                        typename MemberPointers::Type...>::value
+              : 0> {};
+
+}  // namespace detail
+
+// Structures have a fixed encoded size when every member has a fixed encoded
+// size.
+template <typename T>
+struct FixedEncodingSize<T, EnableIfHasMemberList<T>>
+    : detail::FixedMemberListEncodingSize<
+          typename MemberListTraits<T>::MemberList> {};
+
 }  // namespace nop
 
 #endif  // LIBNOP_INCLUDE_NOP_BASE_MEMBERS_H_
@@ -0,0 +1,311 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_BASE_NULL_BITMAP_H_
+#define LIBNOP_INCLUDE_NOP_BASE_NULL_BITMAP_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#include <nop/base/bitset.h>
+#include <nop/base/encoding.h>
+#include <nop/types/null_bitmap.h>
+#include <nop/types/optional.h>
+
+namespace nop {
+
+//
+// NullBitmap<std::vector<Optional<T>>> encoding format:
+//
+// +-----+---------+------//------+----//----+
+// | STC | INT64:2 | PRESENT BITS |  VALUES  |
+// +-----+---------+------//------+----//----+
+//
+// Where PRESENT BITS is the std::vector<bool> encoding of whether each of the
+// N elements is present; see base/bitset.h. VALUES holds the P present values
+// in order. For integral, floating point and enumeration types other than bool
+// the values are stored as direct little-endian values, in the same format as
+// Binary<std::vector<T>>:
+//
+// +-----+---------+---//----+
+// | BIN | INT64:L | L BYTES |
+// +-----+---------+---//----+
+//
+// Where L = P * sizeof(T). Other values are stored in the same format as
+// std::vector<T>:
+//
+// +-----+---------+-----//-----+
+// | ARY | INT64:P | P ELEMENTS |
+// +-----+---------+-----//-----+
+//
+// This is a valid encoding of a structure of a std::vector<bool> and a vector
+// of T, so generic tools, such as SkipValue(), walk it without knowing the
+// element type. Packed values are gathered into and scattered from small
+// batches on the stack, so that the writer and reader are called once per
+// batch rather than once per element.
+//
+
+template <typename T, typename Allocator>
+struct Encoding<NullBitmap<std::vector<Optional<T>, Allocator>>>
+    : EncodingIO<NullBitmap<std::vector<Optional<T>, Allocator>>> {
+  using Type = NullBitmap<std::vector<Optional<T>, Allocator>>;
+  using Elements = std::vector<Optional<T>, Allocator>;
+
+  static constexpr EncodingByte Prefix(const Type& /*value*/) {
+    return EncodingByte::Structure;
+  }
+
+  static std::size_t Size(const Type& value) {
+    const Elements& elements = value.get();
+    return BaseEncodingSize(Prefix(value)) + Encoding<SizeType>::Size(2) +
+           detail::BitEncodingSize(elements.size()) +
+           ValuesSize(elements, Packed{});
+  }
+
+  static constexpr bool Match(EncodingByte prefix) {
+    return prefix == EncodingByte::Structure;
+  }
+
+  template <typename Writer>
+  static Status<void> WritePayload(EncodingByte /*prefix*/, const Type& value,
+                                   Writer* writer) {
+    const Elements& elements = value.get();
+    auto status = Encoding<SizeType>::Write(2, writer);
+    if (!status)
+      return status;
+
+    status = writer->Write(static_cast<std::uint8_t>(EncodingByte::Binary));
+    if (!status)
+      return status;
+
+    status = detail::WriteBits(
+        elements.size(),
+        [&elements](SizeType index) { return !elements[index].empty(); },
+        writer);
+    if (!status)
+      return status;
+
+    return WriteValues(elements, writer, Packed{});
+  }
+
+  template <typename Reader>
+  static Status<void> ReadPayload(EncodingByte /*prefix*/, Type* value,
+                                  Reader* reader) {
+    SizeType count = 0;
+    auto status = Encoding<SizeType>::Read(&count, reader);
+    if (!status)
+      return status;
+    else if (count != 2)
+      return ErrorStatus::InvalidMemberCount;
+
+    status = ReadPrefix(EncodingByte::Binary, reader);
+    if (!status)
+      return status;
+
+    auto size = detail::ReadBitCount(reader);
+    if (!size)
+      return size.error();
+    else if (size.get() > value->max_size())
+      return ErrorStatus::InvalidContainerLength;
+
+    Elements& elements = value->get();
+    elements.clear();
+    elements.resize(size.get());
+
+    std::size_t present = 0;
+    status = detail::ReadBits(
+        size.get(),
+        [&elements, &present](SizeType index, bool flag) {
+          if (flag) {
+            elements[index] = T{};
+            present++;
+          }
+        },
+        reader);
+    if (!status)
+      return status;
+
+    return ReadValues(&elements, present, reader, Packed{});
+  }
+
+ private:
+  enum : std::size_t { kBatchSize = 256 };
+
+  // Whether the values are packed in bulk as a BIN payload.
+  using Packed =
+      std::integral_constant<bool, (std::is_arithmetic<T>::value &&
+                                    !std::is_same<T, bool>::value) ||
+                                       std::is_enum<T>::value>;
+
+  static std::size_t PresentCount(const Elements& elements) {
+    std::size_t count = 0;
+    for (const auto& element : elements)
+      count += element.empty() ? 0 : 1;
+    return count;
+  }
+
+  template <typename Reader>
+  static Status<void> ReadPrefix(EncodingByte expected, Reader* reader) {
+    std::uint8_t prefix = 0;
+    auto status = reader->Read(&prefix);
+    if (!status)
+      return status;
+    else if (static_cast<EncodingByte>(prefix) != expected)
+      return ErrorStatus::UnexpectedEncodingType;
+    else
+      return {};
+  }
+
+  static std::size_t ValuesSize(const Elements& elements, std::true_type) {
+    const SizeType length = PresentCount(elements) * sizeof(T);
+    return BaseEncodingSize(EncodingByte::Binary) +
+           Encoding<SizeType>::Size(length) + length;
+  }
+
+  static std::size_t ValuesSize(const Elements& elements, std::false_type) {
+    std::size_t count = 0;
+    std::size_t size = 0;
+    for (const auto& element : elements) {
+      if (!element.empty()) {
+        count++;
+        size += Encoding<T>::Size(element.get());
+      }
+    }
+    return BaseEncodingSize(EncodingByte::Array) +
+           Encoding<SizeType>::Size(count) + size;
+  }
+
+  template <typename Writer>
+  static Status<void> WriteValues(const Elements& elements, Writer* writer,
+                                  std::true_type) {
+    auto status =
+        writer->Write(static_cast<std::uint8_t>(EncodingByte::Binary));
+    if (!status)
+      return status;
+
+    status = Encoding<SizeType>::Write(PresentCount(elements) * sizeof(T),
+                                       writer);
+    if (!status)
+      return status;
+
+    T batch[kBatchSize];
+    std::size_t count = 0;
+    for (const auto& element : elements) {
+      if (element.empty())
+        continue;
+
+      batch[count++] = element.get();
+      if (count == kBatchSize) {
+        status = WriteElements(batch, batch + count, writer);
+        if (!status)
+          return status;
+        count = 0;
+      }
+    }
+
+    return WriteElements(batch, batch + count, writer);
+  }
+
+  template <typename Writer>
+  static Status<void> WriteValues(const Elements& elements, Writer* writer,
+                                  std::false_type) {
+    auto status = writer->Write(static_cast<std::uint8_t>(EncodingByte::Array));
+    if (!status)
+      return status;
+
+    status = Encoding<SizeType>::Write(PresentCount(elements), writer);
+    if (!status)
+      return status;
+
+    for (const auto& element : elements) {
+      if (!element.empty()) {
+        status = Encoding<T>::Write(element.get(), writer);
+        if (!status)
+          return status;
+      }
+    }
+
+    return {};
+  }
+
+  template <typename Reader>
+  static Status<void> ReadValues(Elements* elements, std::size_t present,
+                                 Reader* reader, std::true_type) {
+    auto status = ReadPrefix(EncodingByte::Binary, reader);
+    if (!status)
+      return status;
+
+    SizeType length = 0;
+    status = Encoding<SizeType>::Read(&length, reader);
+    if (!status)
+      return status;
+    else if (length != present * sizeof(T))
+      return ErrorStatus::InvalidContainerLength;
+
+    status = reader->Ensure(length);
+    if (!status)
+      return status;
+
+    T batch[kBatchSize];
+    std::size_t index = 0;
+    for (std::size_t begin = 0; begin < present; begin += kBatchSize) {
+      const std::size_t count =
+          present - begin < kBatchSize ? present - begin : kBatchSize;
+      status = ReadElements(batch, batch + count, reader);
+      if (!status)
+        return status;
+
+      for (std::size_t i = 0; i < count; i++) {
+        while ((*elements)[index].empty())
+          index++;
+        (*elements)[index++].get() = batch[i];
+      }
+    }
+
+    return {};
+  }
+
+  template <typename Reader>
+  static Status<void> ReadValues(Elements* elements, std::size_t present,
+                                 Reader* reader, std::false_type) {
+    auto status = ReadPrefix(EncodingByte::Array, reader);
+    if (!status)
+      return status;
+
+    SizeType count = 0;
+    status = Encoding<SizeType>::Read(&count, reader);
+    if (!status)
+      return status;
+    else if (count != present)
+      return ErrorStatus::InvalidContainerLength;
+
+    for (auto& element : *elements) {
+      if (!element.empty()) {
+        status = Encoding<T>::Read(&element.get(), reader);
+        if (!status)
+          return status;
+      }
+    }
+
+    return {};
+  }
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_BASE_NULL_BITMAP_H_
@@ -0,0 +1,318 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_BASE_PACKED_H_
+#define LIBNOP_INCLUDE_NOP_BASE_PACKED_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+#include <nop/base/encoding.h>
+#include <nop/types/packed.h>
+#include <nop/utility/endian.h>
+
+namespace nop {
+
+//
+// Packed<std::vector<T>> encoding format:
+//
+// +-----+---------+---------+----//----+
+// | BIN | INT64:L | INT64:N | B BLOCKS |
+// +-----+---------+---------+----//----+
+//
+// Where L is the number of bytes that follow it, N is the number of elements,
+// and B = ceil(N / 128). Each block encodes up to 128 elements:
+//
+// +----------+----//----+
+// | U8:WIDTH | K BYTES  |
+// +----------+----//----+
+//
+// Where K = ceil(C * WIDTH / 8) for the C elements in the block. Each element
+// is stored as the zigzag encoded difference from the previous element (or
+// from zero for the first element), computed with wrapping arithmetic in the
+// width of T. The differences are packed least significant bit first at WIDTH
+// bits each, where WIDTH, between 0 and 64, is the bit length of the largest
+// difference in the block.
+//
+// The packed bits of each block are moved through 64-bit words, with one load
+// or store per word, and each block is written or read with a single call to
+// the writer or reader. Note that blocks of zero differences pack to a single
+// byte, so the decoded size may be up to 128 elements per byte of input.
+//
+
+namespace detail {
+
+enum : std::size_t { kPackedBlockSize = 128 };
+
+// Returns the number of bytes that |count| values of |width| bits pack into.
+constexpr std::size_t PackedBlockBytes(std::size_t count, unsigned width) {
+  return (count * width + 7) / 8;
+}
+
+// Returns the number of bits required to represent |value|.
+inline unsigned PackedBitWidth(std::uint64_t value) {
+  unsigned width = 0;
+  for (; value != 0; value >>= 1)
+    width++;
+  return width;
+}
+
+// Packs the low |width| bits of each of the |count| values into |out|, which
+// must hold PackedBlockBytes(count, width) bytes.
+inline void PackBlock(const std::uint64_t* values, std::size_t count,
+                      unsigned width, std::uint8_t* out) {
+  if (width == 0)
+    return;
+
+  std::uint64_t buffer = 0;
+  unsigned bits = 0;
+  for (std::size_t i = 0; i < count; i++) {
+    const std::uint64_t value = values[i];
+    buffer |= value << bits;
+    if (bits + width >= 64) {
+      const std::uint64_t word = HostEndian<std::uint64_t>::ToLittle(buffer);
+      std::memcpy(out, &word, sizeof(word));
+      out += sizeof(word);
+
+      // Carry the bits of the value that did not fit into the word.
+      const unsigned spill = bits + width - 64;
+      buffer = spill != 0 ? value >> (width - spill) : 0;
+      bits = spill;
+    } else {
+      bits += width;
+    }
+  }
+
+  for (; bits > 0; bits = bits > 8 ? bits - 8 : 0) {
+    *out++ = static_cast<std::uint8_t>(buffer);
+    buffer >>= 8;
+  }
+}
+
+// Unpacks |count| values of |width| bits from the PackedBlockBytes(count,
+// width) bytes at |in|.
+inline void UnpackBlock(const std::uint8_t* in, std::size_t count,
+                        unsigned width, std::uint64_t* values) {
+  if (width == 0) {
+    for (std::size_t i = 0; i < count; i++)
+      values[i] = 0;
+    return;
+  }
+
+  const std::uint8_t* const end = in + PackedBlockBytes(count, width);
+  const std::uint64_t mask =
+      width == 64 ? ~std::uint64_t{0} : (std::uint64_t{1} << width) - 1;
+
+  std::uint64_t buffer = 0;
+  unsigned bits = 0;
+  for (std::size_t i = 0; i < count; i++) {
+    if (bits >= width) {
+      values[i] = buffer & mask;
+      buffer >>= width;
+      bits -= width;
+      continue;
+    }
+
+    // Refill with the next word, or the bytes that remain at the end.
+    std::uint64_t word = 0;
+    unsigned loaded = 0;
+    if (end - in >= 8) {
+      std::memcpy(&word, in, sizeof(word));
+      word = HostEndian<std::uint64_t>::FromLittle(word);
+      in += 8;
+      loaded = 64;
+    } else {
+      for (; in < end; in++, loaded += 8)
+        word |= std::uint64_t{*in} << loaded;
+    }
+
+    values[i] = (buffer | (word << bits)) & mask;
+    const unsigned consumed = width - bits;
+    buffer = consumed < 64 ? word >> consumed : 0;
+    bits = loaded - consumed;
+  }
+}
+
+}  // namespace detail
+
+template <typename T, typename Allocator>
+struct Encoding<Packed<std::vector<T, Allocator>>>
+    : EncodingIO<Packed<std::vector<T, Allocator>>> {
+  using Type = Packed<std::vector<T, Allocator>>;
+
+  static constexpr EncodingByte Prefix(const Type& /*value*/) {
+    return EncodingByte::Binary;
+  }
+
+  static std::size_t Size(const Type& value) {
+    const SizeType length = PayloadSize(value.get());
+    return BaseEncodingSize(Prefix(value)) + Encoding<SizeType>::Size(length) +
+           length;
+  }
+
+  static constexpr bool Match(EncodingByte prefix) {
+    return prefix == EncodingByte::Binary;
+  }
+
+  template <typename Writer>
+  static Status<void> WritePayload(EncodingByte /*prefix*/, const Type& value,
+                                   Writer* writer) {
+    const std::vector<T, Allocator>& elements = value.get();
+    auto status = Encoding<SizeType>::Write(PayloadSize(elements), writer);
+    if (!status)
+      return status;
+
+    status = Encoding<SizeType>::Write(elements.size(), writer);
+    if (!status)
+      return status;
+
+    std::uint64_t deltas[kBlockSize];
+    std::uint8_t block[1 + detail::PackedBlockBytes(kBlockSize, 64)];
+    for (std::size_t begin = 0; begin < elements.size(); begin += kBlockSize) {
+      const std::size_t count = BlockCount(elements.size(), begin);
+      const unsigned width = Deltas(elements, begin, count, deltas);
+
+      block[0] = static_cast<std::uint8_t>(width);
+      detail::PackBlock(deltas, count, width, block + 1);
+      status = writer->Write(
+          block, block + 1 + detail::PackedBlockBytes(count, width));
+      if (!status)
+        return status;
+    }
+
+    return {};
+  }
+
+  template <typename Reader>
+  static Status<void> ReadPayload(EncodingByte /*prefix*/, Type* value,
+                                  Reader* reader) {
+    SizeType length = 0;
+    auto status = Encoding<SizeType>::Read(&length, reader);
+    if (!status)
+      return status;
+
+    status = reader->Ensure(length);
+    if (!status)
+      return status;
+
+    SizeType size = 0;
+    status = Encoding<SizeType>::Read(&size, reader);
+    if (!status)
+      return status;
+
+    // Every block takes at least one byte, which bounds the number of
+    // elements that may be claimed by a payload of this length.
+    const std::size_t size_bytes = Encoding<SizeType>::Size(size);
+    const std::size_t blocks = (size + kBlockSize - 1) / kBlockSize;
+    if (length < size_bytes || blocks > length - size_bytes)
+      return ErrorStatus::InvalidContainerLength;
+
+    std::vector<T, Allocator>& elements = value->get();
+    elements.resize(size);
+
+    std::size_t remaining = length - size_bytes;
+    std::uint64_t deltas[kBlockSize];
+    std::uint8_t block[detail::PackedBlockBytes(kBlockSize, 64)];
+    T previous = 0;
+    for (std::size_t begin = 0; begin < size; begin += kBlockSize) {
+      const std::size_t count = BlockCount(size, begin);
+
+      std::uint8_t width = 0;
+      status = reader->Read(&width);
+      if (!status)
+        return status;
+
+      const std::size_t bytes = detail::PackedBlockBytes(count, width);
+      if (width > 64 || 1 + bytes > remaining)
+        return ErrorStatus::InvalidContainerLength;
+      remaining -= 1 + bytes;
+
+      status = ReadElements(block, block + bytes, reader);
+      if (!status)
+        return status;
+
+      detail::UnpackBlock(block, count, width, deltas);
+      for (std::size_t i = 0; i < count; i++) {
+        previous = Undelta(deltas[i], previous);
+        elements[begin + i] = previous;
+      }
+    }
+
+    if (remaining != 0)
+      return ErrorStatus::InvalidContainerLength;
+    else
+      return {};
+  }
+
+ private:
+  enum : std::size_t { kBlockSize = detail::kPackedBlockSize };
+
+  using Unsigned = std::make_unsigned_t<T>;
+  using Signed = std::make_signed_t<T>;
+
+  static std::size_t BlockCount(std::size_t size, std::size_t begin) {
+    return size - begin < kBlockSize ? size - begin : kBlockSize;
+  }
+
+  // Returns the zigzag encoded difference between |value| and |previous|.
+  static std::uint64_t Delta(T value, T previous) {
+    const std::int64_t delta = static_cast<Signed>(static_cast<Unsigned>(
+        static_cast<Unsigned>(value) - static_cast<Unsigned>(previous)));
+    return (static_cast<std::uint64_t>(delta) << 1) ^
+           static_cast<std::uint64_t>(delta >> 63);
+  }
+
+  // Returns the element that follows |previous| by zigzag encoded |delta|.
+  static T Undelta(std::uint64_t delta, T previous) {
+    const std::uint64_t difference = (delta >> 1) ^ (~(delta & 1) + 1);
+    return static_cast<T>(static_cast<Unsigned>(
+        static_cast<Unsigned>(previous) + static_cast<Unsigned>(difference)));
+  }
+
+  // Computes the differences of the |count| elements starting at |begin| and
+  // returns their bit width.
+  static unsigned Deltas(const std::vector<T, Allocator>& elements,
+                         std::size_t begin, std::size_t count,
+                         std::uint64_t* deltas) {
+    T previous = begin > 0 ? elements[begin - 1] : 0;
+    std::uint64_t bits = 0;
+    for (std::size_t i = 0; i < count; i++) {
+      deltas[i] = Delta(elements[begin + i], previous);
+      previous = elements[begin + i];
+      bits |= deltas[i];
+    }
+    return detail::PackedBitWidth(bits);
+  }
+
+  static SizeType PayloadSize(const std::vector<T, Allocator>& elements) {
+    std::size_t size = Encoding<SizeType>::Size(elements.size());
+    std::uint64_t deltas[kBlockSize];
+    for (std::size_t begin = 0; begin < elements.size(); begin += kBlockSize) {
+      const std::size_t count = BlockCount(elements.size(), begin);
+      const unsigned width = Deltas(elements, begin, count, deltas);
+      size += 1 + detail::PackedBlockBytes(count, width);
+    }
+    return size;
+  }
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_BASE_PACKED_H_
@@ -89,6 +89,17 @@ struct Encoding<std::pair<T, U>> : EncodingIO<std::pair<T, U>> {
   using Second = std::remove_cv_t<std::remove_reference_t<U>>;
 };
 
+// Pairs have a fixed encoded size when both elements have a fixed encoded size.
+template <typename T, typename U>
+struct FixedEncodingSize<std::pair<T, U>>
+    : std::integral_constant<
+          std::size_t,
+          HasFixedEncodingSize<T>::value && HasFixedEncodingSize<U>::value
+              ? BaseEncodingSize(EncodingByte::Array) +
+                    Encoding<SizeType>::Size(2u) +
+                    FixedEncodingSizeSum<T, U>::value
+              : 0> {};
+
 }  // namespace nop
 
 #endif  // LIBNOP_INCLUDE_NOP_BASE_PAIR_H_
@@ -0,0 +1,298 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_BASE_POINTER_H_
+#define LIBNOP_INCLUDE_NOP_BASE_POINTER_H_
+
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+#include <nop/base/encoding.h>
+
+namespace nop {
+
+//
+// std::unique_ptr<T> encoding formats:
+//
+// Null pointer:
+//
+// +-----+
+// | NIL |
+// +-----+
+//
+// Non-null pointer:
+//
+// +---//----+
+// | ELEMENT |
+// +---//----+
+//
+// Element must be a valid encoding of type T. This is the same format as
+// Optional<T>.
+//
+// std::shared_ptr<T> encoding formats:
+//
+// Null pointer:
+//
+// +-----+
+// | NIL |
+// +-----+
+//
+// First occurrence of an object, which defines a new entry in the pointer
+// table:
+//
+// +-----+---+----+---//----+
+// | EXT | 1 | -1 | ELEMENT |
+// +-----+---+----+---//----+
+//
+// Later occurrences of the same object, which refer to entry I of the pointer
+// table:
+//
+// +-----+---+---------+
+// | EXT | 1 | INT64:I |
+// +-----+---+---------+
+//
+// Where 1 is ExtensionType::SharedPointer. Entries are numbered from zero in
+// the order they are defined. Readers reconstruct the sharing: every reference
+// to an entry decodes to a pointer to the same object.
+//
+// Writing a std::shared_ptr requires a writer that provides the following
+// method, which returns the index of an earlier occurrence of |pointer| or
+// kNewPointerReference after adding |pointer| to the table:
+//
+//   template <typename T>
+//   Status<PointerReference> InternPointer(const std::shared_ptr<T>& pointer,
+//                                          PointerType type);
+//
+// Reading requires a reader that provides the following methods:
+//
+//   Status<void> DefinePointer(std::shared_ptr<void> pointer,
+//                              PointerType type);
+//   Status<std::shared_ptr<void>> GetPointer(PointerReference reference,
+//                                            PointerType type);
+//
+// See InterningWriter and InterningReader. The wrapper writers and readers,
+// such as BoundedWriter and BoundedReader, forward these methods, so shared
+// pointers may be nested in table entries.
+//
+// SkipValue() skips shared pointers without knowing their type. Skipping a
+// definition reserves its entry in the pointer table of the reader, if any, so
+// later entries keep their numbers, and references to a skipped object fail
+// with ErrorStatus::InvalidReference.
+//
+// The size of an encoding is computed with every occurrence in full, so it is
+// an overestimate when objects are shared, and the pointer graph must be
+// acyclic.
+//
+
+// Index of an object in the pointer table of a message.
+using PointerReference = std::int64_t;
+
+// Returned by InterningWriter::InternPointer() and encoded in place of a
+// reference when an object is not in the table yet and must be defined in full.
+enum : PointerReference { kNewPointerReference = -1 };
+
+// Identifies the type of the objects in the pointer table, so that a reference
+// that resolves to an object of another type is rejected.
+using PointerType = const void*;
+
+namespace detail {
+
+template <typename T>
+struct PointerTypeTag {
+  static const char id;
+};
+template <typename T>
+const char PointerTypeTag<T>::id = 0;
+
+}  // namespace detail
+
+// Returns the PointerType of objects of type T.
+template <typename T>
+PointerType PointerTypeOf() {
+  return &detail::PointerTypeTag<std::remove_cv_t<T>>::id;
+}
+
+// Evaluates to true if Writer provides the InternPointer() method required to
+// write std::shared_ptr values. Writers that wrap another writer forward the
+// method only when the underlying writer provides it.
+template <typename Writer>
+using WriterInternPointerTest = decltype(std::declval<Writer&>().InternPointer(
+    std::declval<const std::shared_ptr<void>&>(), std::declval<PointerType>()));
+template <typename Writer>
+using WriterInternsPointers = IsDetected<WriterInternPointerTest, Writer>;
+
+// Evaluates to true if Reader provides the DefinePointer() and GetPointer()
+// methods required to read std::shared_ptr values.
+template <typename Reader>
+using ReaderDefinePointerTest = decltype(std::declval<Reader&>().DefinePointer(
+    std::declval<std::shared_ptr<void>>(), std::declval<PointerType>()));
+template <typename Reader>
+using ReaderGetPointerTest = decltype(std::declval<Reader&>().GetPointer(
+    std::declval<PointerReference>(), std::declval<PointerType>()));
+template <typename Reader>
+using ReaderInternsPointers = IsDetected<ReaderDefinePointerTest, Reader>;
+
+template <typename T>
+struct Encoding<std::unique_ptr<T>> : EncodingIO<std::unique_ptr<T>> {
+  using Type = std::unique_ptr<T>;
+  using Element = std::remove_cv_t<T>;
+
+  static constexpr EncodingByte Prefix(const Type& value) {
+    return value ? Encoding<Element>::Prefix(*value) : EncodingByte::Nil;
+  }
+
+  static constexpr std::size_t Size(const Type& value) {
+    return value ? Encoding<Element>::Size(*value)
+                 : BaseEncodingSize(EncodingByte::Nil);
+  }
+
+  static constexpr bool Match(EncodingByte prefix) {
+    return prefix == EncodingByte::Nil || Encoding<Element>::Match(prefix);
+  }
+
+  template <typename Writer>
+  static constexpr Status<void> WritePayload(EncodingByte prefix,
+                                             const Type& value,
+                                             Writer* writer) {
+    if (value)
+      return Encoding<Element>::WritePayload(prefix, *value, writer);
+    else
+      return {};
+  }
+
+  template <typename Reader>
+  static Status<void> ReadPayload(EncodingByte prefix, Type* value,
+                                  Reader* reader) {
+    if (prefix == EncodingByte::Nil) {
+      value->reset();
+      return {};
+    }
+
+    std::unique_ptr<Element> element{new Element{}};
+    auto status = Encoding<Element>::ReadPayload(prefix, element.get(), reader);
+    if (!status)
+      return status;
+
+    *value = std::move(element);
+    return {};
+  }
+};
+
+template <typename T>
+struct Encoding<std::shared_ptr<T>> : EncodingIO<std::shared_ptr<T>> {
+  using Type = std::shared_ptr<T>;
+  using Element = std::remove_cv_t<T>;
+
+  static constexpr EncodingByte Prefix(const Type& value) {
+    return value ? EncodingByte::Extension : EncodingByte::Nil;
+  }
+
+  static std::size_t Size(const Type& value) {
+    if (!value)
+      return BaseEncodingSize(EncodingByte::Nil);
+
+    // Overestimate the size as though this is the first occurrence of the
+    // object, since whether it is already in the table is not known ahead of
+    // serialization.
+    const std::size_t definition =
+        Encoding<PointerReference>::Size(kNewPointerReference) +
+        Encoding<Element>::Size(*value);
+    const std::size_t reference = BaseEncodingSize(EncodingByte::I64);
+    return BaseEncodingSize(EncodingByte::Extension) +
+           Encoding<std::uint8_t>::Size(
+               static_cast<std::uint8_t>(ExtensionType::SharedPointer)) +
+           (definition > reference ? definition : reference);
+  }
+
+  static constexpr bool Match(EncodingByte prefix) {
+    return prefix == EncodingByte::Nil || prefix == EncodingByte::Extension;
+  }
+
+  template <typename Writer>
+  static Status<void> WritePayload(EncodingByte prefix, const Type& value,
+                                   Writer* writer) {
+    if (prefix == EncodingByte::Nil)
+      return {};
+
+    auto status = Encoding<std::uint8_t>::Write(
+        static_cast<std::uint8_t>(ExtensionType::SharedPointer), writer);
+    if (!status)
+      return status;
+
+    auto intern_status =
+        writer->InternPointer(value, PointerTypeOf<Element>());
+    if (!intern_status)
+      return intern_status.error();
+
+    status = Encoding<PointerReference>::Write(intern_status.get(), writer);
+    if (!status || intern_status.get() != kNewPointerReference)
+      return status;
+
+    return Encoding<Element>::Write(*value, writer);
+  }
+
+  template <typename Reader>
+  static Status<void> ReadPayload(EncodingByte prefix, Type* value,
+                                  Reader* reader) {
+    if (prefix == EncodingByte::Nil) {
+      value->reset();
+      return {};
+    }
+
+    std::uint8_t extension_type = 0;
+    auto status = Encoding<std::uint8_t>::Read(&extension_type, reader);
+    if (!status)
+      return status;
+    else if (extension_type !=
+             static_cast<std::uint8_t>(ExtensionType::SharedPointer))
+      return ErrorStatus::UnexpectedEncodingType;
+
+    PointerReference reference = 0;
+    status = Encoding<PointerReference>::Read(&reference, reader);
+    if (!status)
+      return status;
+
+    if (reference != kNewPointerReference) {
+      auto get_status =
+          reader->GetPointer(reference, PointerTypeOf<Element>());
+      if (!get_status)
+        return get_status.error();
+
+      *value = std::static_pointer_cast<Element>(get_status.take());
+      return {};
+    }
+
+    // Define the entry before decoding the object, which may define entries of
+    // its own, to number the entries in the order the writer defined them.
+    auto element = std::make_shared<Element>();
+    status = reader->DefinePointer(element, PointerTypeOf<Element>());
+    if (!status)
+      return status;
+
+    status = Encoding<Element>::Read(element.get(), reader);
+    if (!status)
+      return status;
+
+    *value = std::move(element);
+    return {};
+  }
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_BASE_POINTER_H_
@@ -0,0 +1,114 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_BASE_PROJECTION_H_
+#define LIBNOP_INCLUDE_NOP_BASE_PROJECTION_H_
+
+#include <type_traits>
+
+#include <nop/base/encoding.h>
+#include <nop/base/members.h>
+#include <nop/base/skip.h>
+#include <nop/base/utility.h>
+#include <nop/projection.h>
+
+namespace nop {
+
+//
+// Projection<T, Members> reads the same format as T. See base/members.h.
+//
+// Members of T that are in the projection are decoded as usual. The encodings
+// of the other members are skipped with SkipValue().
+//
+
+template <typename T, typename... Projected>
+struct Encoding<Projection<T, MemberList<Projected...>>,
+                EnableIfHasMemberList<T>>
+    : EncodingIO<Projection<T, MemberList<Projected...>>> {
+  using Type = Projection<T, MemberList<Projected...>>;
+
+  static constexpr EncodingByte Prefix(const Type& /*value*/) {
+    return EncodingByte::Structure;
+  }
+
+  static constexpr bool Match(EncodingByte prefix) {
+    return prefix == EncodingByte::Structure;
+  }
+
+  template <typename Reader>
+  static Status<void> ReadPayload(EncodingByte /*prefix*/, Type* value,
+                                  Reader* reader) {
+    SizeType size = 0;
+    auto status = Encoding<SizeType>::Read(&size, reader);
+    if (!status)
+      return status;
+    else if (size != Count)
+      return ErrorStatus::InvalidMemberCount;
+    else
+      return ReadMembers(value->get(), reader, Index<Count>{});
+  }
+
+ private:
+  enum : std::size_t { Count = MemberListTraits<T>::MemberList::Count };
+
+  using Members = typename MemberListTraits<T>::MemberList;
+
+  template <std::size_t Index>
+  using PointerAt = typename Members::template At<Index>;
+
+  template <typename Pointer>
+  using IsProjected = Or<std::is_same<Pointer, Projected>...>;
+
+  template <typename Pointer, typename List>
+  struct IsMember;
+  template <typename Pointer, typename... Pointers>
+  struct IsMember<Pointer, MemberList<Pointers...>>
+      : Or<std::is_same<Pointer, Pointers>...> {};
+
+  static_assert(And<IsMember<Projected, Members>...>::value,
+                "Projected members must be members of the structure.");
+
+  template <typename Reader>
+  static Status<void> ReadMembers(T* /*value*/, Reader* /*reader*/, Index<0>) {
+    return {};
+  }
+
+  template <std::size_t index, typename Reader>
+  static Status<void> ReadMembers(T* value, Reader* reader, Index<index>) {
+    auto status = ReadMembers(value, reader, Index<index - 1>{});
+    if (!status)
+      return status;
+
+    using Pointer = PointerAt<index - 1>;
+    return ReadMember<Pointer>(value, reader, IsProjected<Pointer>{});
+  }
+
+  template <typename Pointer, typename Reader>
+  static Status<void> ReadMember(T* value, Reader* reader,
+                                 std::true_type /*projected*/) {
+    return Pointer::Read(value, reader, Members{});
+  }
+
+  template <typename Pointer, typename Reader>
+  static Status<void> ReadMember(T* /*value*/, Reader* reader,
+                                 std::false_type /*projected*/) {
+    return SkipValue(reader);
+  }
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_BASE_PROJECTION_H_
@@ -0,0 +1,117 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_BASE_RAW_ENCODED_H_
+#define LIBNOP_INCLUDE_NOP_BASE_RAW_ENCODED_H_
+
+#include <utility>
+#include <vector>
+
+#include <nop/base/encoding.h>
+#include <nop/base/serializer.h>
+#include <nop/base/skip.h>
+#include <nop/types/raw_encoded.h>
+#include <nop/utility/pedantic_buffer_reader.h>
+#include <nop/utility/vector_writer.h>
+
+namespace nop {
+
+//
+// RawEncoded<T> encoding format:
+//
+// +-----//-----+
+// | ENCODING:T |
+// +-----//-----+
+//
+// The bytes held by the RawEncoded<T> are written verbatim, so the format is
+// exactly that of T. Reading captures the bytes of the next value, whose
+// prefix must match T, without decoding it.
+//
+// Writing an empty RawEncoded<T> fails with
+// ErrorStatus::UnexpectedEncodingType.
+//
+
+template <typename T>
+struct Encoding<RawEncoded<T>> : EncodingIO<RawEncoded<T>> {
+  using Type = RawEncoded<T>;
+
+  static constexpr EncodingByte Prefix(const Type& value) {
+    return value.empty() ? EncodingByte::Nil
+                         : static_cast<EncodingByte>(value.data()[0]);
+  }
+
+  static constexpr std::size_t Size(const Type& value) {
+    return value.empty() ? BaseEncodingSize(EncodingByte::Nil) : value.size();
+  }
+
+  static constexpr bool Match(EncodingByte prefix) {
+    return Encoding<T>::Match(prefix);
+  }
+
+  template <typename Writer>
+  static constexpr Status<void> WritePayload(EncodingByte /*prefix*/,
+                                             const Type& value,
+                                             Writer* writer) {
+    if (value.empty())
+      return ErrorStatus::UnexpectedEncodingType;
+
+    return writer->Write(value.data() + 1, value.data() + value.size());
+  }
+
+  template <typename Reader>
+  static constexpr Status<void> ReadPayload(EncodingByte prefix, Type* value,
+                                            Reader* reader) {
+    // Reuse the storage of the previous value.
+    std::vector<std::uint8_t> bytes = value->take();
+    bytes.clear();
+
+    auto status = CapturePayload(prefix, reader, &bytes);
+    if (!status)
+      return status;
+
+    *value = Type{std::move(bytes)};
+    return {};
+  }
+};
+
+// Encodes |value| into a RawEncoded<T>.
+template <typename T>
+Status<RawEncoded<T>> EncodeRaw(const T& value) {
+  VectorWriter writer;
+  auto status = SerializerCommon::Write(value, &writer);
+  if (!status)
+    return status.error();
+
+  return RawEncoded<T>{writer.Take()};
+}
+
+// Decodes the value held by |raw| into |value|. Returns
+// ErrorStatus::ProtocolError if |raw| holds more than one value.
+template <typename T>
+Status<void> DecodeRaw(const RawEncoded<T>& raw, T* value) {
+  PedanticBufferReader reader{raw.data(), raw.size()};
+  auto status = Deserializer<PedanticBufferReader*>{&reader}.Read(value);
+  if (!status)
+    return status;
+  else if (!reader.empty())
+    return ErrorStatus::ProtocolError;
+  else
+    return {};
+}
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_BASE_RAW_ENCODED_H_
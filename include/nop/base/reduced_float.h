@@ -0,0 +1,246 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_BASE_REDUCED_FLOAT_H_
+#define LIBNOP_INCLUDE_NOP_BASE_REDUCED_FLOAT_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <nop/base/encoding.h>
+#include <nop/types/reduced_float.h>
+
+namespace nop {
+
+//
+// ReducedFloat<Container, Format> encoding format:
+//
+// +-----+---------+---//----+
+// | BIN | INT64:L | L BYTES |
+// +-----+---------+---//----+
+//
+// Where L = N * 2. Each element is stored as the little-endian 16-bit pattern
+// of the value in Format, so the encoding is also a valid encoding of a vector
+// of std::uint16_t.
+//
+// Elements are converted in batches on the stack with branch-light integer
+// arithmetic, so that the writer and reader are called once per batch rather
+// than once per element.
+//
+
+namespace detail {
+
+inline std::uint32_t FloatBits(float value) {
+  std::uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+inline float BitsFloat(std::uint32_t bits) {
+  float value;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+// Converts |value| to IEEE half precision, rounding to nearest even.
+inline std::uint16_t FloatToHalf(float value) {
+  const std::uint32_t kInfinity = 255u << 23;
+  const std::uint32_t kHalfOverflow = (127u + 16) << 23;
+  const std::uint32_t kSubnormalMagic = ((127u - 15) + (23 - 10) + 1) << 23;
+
+  std::uint32_t bits = FloatBits(value);
+  const std::uint32_t sign = bits & 0x80000000u;
+  bits ^= sign;
+
+  std::uint32_t half;
+  if (bits >= kHalfOverflow) {
+    // Infinity, quiet NaN, or a magnitude too large for half precision.
+    half = bits > kInfinity ? 0x7e00 : 0x7c00;
+  } else if (bits < (113u << 23)) {
+    // Subnormal or zero in half precision: let the floating point addition
+    // align the mantissa and round it.
+    half = FloatBits(BitsFloat(bits) + BitsFloat(kSubnormalMagic)) -
+           kSubnormalMagic;
+  } else {
+    // Rebias the exponent and round the mantissa to nearest even. Carries out
+    // of the mantissa correctly increment the exponent, up to infinity.
+    const std::uint32_t odd = (bits >> 13) & 1;
+    bits += ((15u - 127u) << 23) + 0xfff + odd;
+    half = bits >> 13;
+  }
+
+  return static_cast<std::uint16_t>(half | (sign >> 16));
+}
+
+// Converts IEEE half precision |half| to float exactly.
+inline float HalfToFloat(std::uint16_t half) {
+  const std::uint32_t kExponent = 0x7c00u << 13;
+  const float kSubnormalMagic = BitsFloat(113u << 23);
+
+  std::uint32_t bits = (half & 0x7fffu) << 13;
+  const std::uint32_t exponent = bits & kExponent;
+  bits += (127u - 15) << 23;
+
+  if (exponent == kExponent) {
+    // Infinity or NaN.
+    bits += (128u - 16) << 23;
+  } else if (exponent == 0) {
+    // Zero or subnormal: renormalize with a floating point subtraction.
+    bits += 1u << 23;
+    bits = FloatBits(BitsFloat(bits) - kSubnormalMagic);
+  }
+
+  return BitsFloat(bits | (std::uint32_t{half & 0x8000u} << 16));
+}
+
+// Converts |value| to bfloat16, rounding to nearest even.
+inline std::uint16_t FloatToBFloat16(float value) {
+  const std::uint32_t bits = FloatBits(value);
+  if ((bits & 0x7fffffffu) > 0x7f800000u)
+    return static_cast<std::uint16_t>((bits >> 16) | 0x40);  // Quiet NaN.
+
+  const std::uint32_t odd = (bits >> 16) & 1;
+  return static_cast<std::uint16_t>((bits + 0x7fff + odd) >> 16);
+}
+
+// Converts bfloat16 |value| to float exactly.
+inline float BFloat16ToFloat(std::uint16_t value) {
+  return BitsFloat(std::uint32_t{value} << 16);
+}
+
+template <FloatFormat Format>
+struct FloatConverter;
+
+template <>
+struct FloatConverter<FloatFormat::Half> {
+  static std::uint16_t Narrow(float value) { return FloatToHalf(value); }
+  static float Widen(std::uint16_t value) { return HalfToFloat(value); }
+};
+
+template <>
+struct FloatConverter<FloatFormat::BFloat16> {
+  static std::uint16_t Narrow(float value) { return FloatToBFloat16(value); }
+  static float Widen(std::uint16_t value) { return BFloat16ToFloat(value); }
+};
+
+template <typename Allocator>
+bool ResizeReducedFloat(std::vector<float, Allocator>* value,
+                        std::size_t size) {
+  value->resize(size);
+  return true;
+}
+
+template <std::size_t Length>
+bool ResizeReducedFloat(std::array<float, Length>* /*value*/,
+                        std::size_t size) {
+  return size == Length;
+}
+
+}  // namespace detail
+
+template <typename Container, FloatFormat Format>
+struct Encoding<ReducedFloat<Container, Format>>
+    : EncodingIO<ReducedFloat<Container, Format>> {
+  using Type = ReducedFloat<Container, Format>;
+  using Converter = detail::FloatConverter<Format>;
+
+  static constexpr EncodingByte Prefix(const Type& /*value*/) {
+    return EncodingByte::Binary;
+  }
+
+  static constexpr std::size_t Size(const Type& value) {
+    const SizeType size = value.get().size() * sizeof(std::uint16_t);
+    return BaseEncodingSize(Prefix(value)) + Encoding<SizeType>::Size(size) +
+           size;
+  }
+
+  static constexpr bool Match(EncodingByte prefix) {
+    return prefix == EncodingByte::Binary;
+  }
+
+  template <typename Writer>
+  static Status<void> WritePayload(EncodingByte /*prefix*/, const Type& value,
+                                   Writer* writer) {
+    const Container& elements = value.get();
+    auto status = Encoding<SizeType>::Write(
+        elements.size() * sizeof(std::uint16_t), writer);
+    if (!status)
+      return status;
+
+    std::uint16_t batch[kBatchSize];
+    for (std::size_t begin = 0; begin < elements.size(); begin += kBatchSize) {
+      const std::size_t count = BatchCount(elements.size(), begin);
+      for (std::size_t i = 0; i < count; i++)
+        batch[i] = Converter::Narrow(elements[begin + i]);
+
+      status = WriteElements(batch, batch + count, writer);
+      if (!status)
+        return status;
+    }
+
+    return {};
+  }
+
+  template <typename Reader>
+  static Status<void> ReadPayload(EncodingByte /*prefix*/, Type* value,
+                                  Reader* reader) {
+    SizeType length = 0;
+    auto status = Encoding<SizeType>::Read(&length, reader);
+    if (!status)
+      return status;
+    else if (length % sizeof(std::uint16_t) != 0)
+      return ErrorStatus::InvalidContainerLength;
+
+    // Make sure the reader has enough data to fulfill the requested size as a
+    // defense against abusive or erroneous vector sizes.
+    status = reader->Ensure(length);
+    if (!status)
+      return status;
+
+    const std::size_t size = length / sizeof(std::uint16_t);
+    Container& elements = value->get();
+    if (!detail::ResizeReducedFloat(&elements, size))
+      return ErrorStatus::InvalidContainerLength;
+
+    std::uint16_t batch[kBatchSize];
+    for (std::size_t begin = 0; begin < size; begin += kBatchSize) {
+      const std::size_t count = BatchCount(size, begin);
+      status = ReadElements(batch, batch + count, reader);
+      if (!status)
+        return status;
+
+      for (std::size_t i = 0; i < count; i++)
+        elements[begin + i] = Converter::Widen(batch[i]);
+    }
+
+    return {};
+  }
+
+ private:
+  enum : std::size_t { kBatchSize = 256 };
+
+  static std::size_t BatchCount(std::size_t size, std::size_t begin) {
+    return size - begin < kBatchSize ? size - begin : kBatchSize;
+  }
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_BASE_REDUCED_FLOAT_H_
@@ -0,0 +1,228 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_BASE_SEQUENCE_H_
+#define LIBNOP_INCLUDE_NOP_BASE_SEQUENCE_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include <nop/base/bitset.h>
+#include <nop/base/encoding.h>
+#include <nop/types/sequence.h>
+
+namespace nop {
+
+//
+// Range<Iterator> and Generator<T> encoding formats are the same as
+// std::vector<T>. For non-integral types:
+//
+// +-----+---------+-----//-----+
+// | ARY | INT64:N | N ELEMENTS |
+// +-----+---------+-----//-----+
+//
+// For integral types:
+//
+// +-----+---------+---//----+
+// | BIN | INT64:L | L BYTES |
+// +-----+---------+---//----+
+//
+// Where L = N * sizeof(T). Integral elements are gathered into small batches
+// on the stack, so that the writer is called once per batch rather than once
+// per element.
+//
+// For bool elements, the flags are bit-packed in the format of
+// std::vector<bool> described in base/bitset.h.
+//
+// These types are write-only; read the values back into std::vector<T>.
+//
+
+namespace detail {
+
+// Shared implementation of the sequence encodings. |ForEach| visits the
+// elements of a sequence in order, stopping at the first error returned by its
+// callback.
+template <typename T, typename Sequence, typename ForEach>
+struct SequenceEncoding : EncodingIO<Sequence> {
+  static constexpr EncodingByte Prefix(const Sequence& /*value*/) {
+    return std::is_integral<T>::value ? EncodingByte::Binary
+                                      : EncodingByte::Array;
+  }
+
+  static std::size_t Size(const Sequence& value) {
+    if (std::is_same<T, bool>::value)
+      return BitEncodingSize(value.size());
+
+    if (std::is_integral<T>::value) {
+      const SizeType size = value.size() * sizeof(T);
+      return BaseEncodingSize(Prefix(value)) + Encoding<SizeType>::Size(size) +
+             size;
+    }
+
+    std::size_t size = BaseEncodingSize(Prefix(value)) +
+                       Encoding<SizeType>::Size(value.size());
+    if (HasFixedEncodingSize<T>::value)
+      return size + value.size() * FixedEncodingSize<T>::value;
+
+    ForEach::Visit(value, [&size](const T& element) -> Status<void> {
+      size += Encoding<T>::Size(element);
+      return {};
+    });
+    return size;
+  }
+
+  static constexpr bool Match(EncodingByte prefix) {
+    return prefix == (std::is_integral<T>::value ? EncodingByte::Binary
+                                                 : EncodingByte::Array);
+  }
+
+  template <typename Writer>
+  static Status<void> WritePayload(EncodingByte /*prefix*/,
+                                   const Sequence& value, Writer* writer) {
+    return WriteElements(value, writer, std::is_integral<T>{},
+                         std::is_same<T, bool>{});
+  }
+
+  template <typename Reader>
+  static Status<void> ReadPayload(EncodingByte /*prefix*/, Sequence* /*value*/,
+                                  Reader* /*reader*/) {
+    static_assert(sizeof(Reader) != sizeof(Reader),
+                  "Sequences are write-only; read them into std::vector.");
+    return ErrorStatus::UnexpectedEncodingType;
+  }
+
+ private:
+  enum : std::size_t { kBatchSize = 256 };
+
+  template <typename Writer>
+  static Status<void> WriteElements(const Sequence& value, Writer* writer,
+                                    std::false_type, std::false_type) {
+    auto status = Encoding<SizeType>::Write(value.size(), writer);
+    if (!status)
+      return status;
+
+    return ForEach::Visit(value, [writer](const T& element) {
+      return Encoding<T>::Write(element, writer);
+    });
+  }
+
+  template <typename Writer>
+  static Status<void> WriteElements(const Sequence& value, Writer* writer,
+                                    std::true_type, std::false_type) {
+    auto status = Encoding<SizeType>::Write(value.size() * sizeof(T), writer);
+    if (!status)
+      return status;
+
+    T batch[kBatchSize];
+    std::size_t count = 0;
+    status = ForEach::Visit(value, [&](const T& element) -> Status<void> {
+      batch[count++] = element;
+      if (count < kBatchSize)
+        return {};
+
+      count = 0;
+      return nop::WriteElements(batch, batch + kBatchSize, writer);
+    });
+    if (!status)
+      return status;
+
+    return nop::WriteElements(batch, batch + count, writer);
+  }
+
+  // Packs the flags into a batch on the stack as they are visited, since the
+  // elements of a sequence may only be visited in order.
+  template <typename Writer>
+  static Status<void> WriteElements(const Sequence& value, Writer* writer,
+                                    std::true_type, std::true_type) {
+    const SizeType count = value.size();
+    auto status = Encoding<SizeType>::Write(BitPayloadSize(count), writer);
+    if (!status)
+      return status;
+
+    status = Encoding<SizeType>::Write(count, writer);
+    if (!status)
+      return status;
+
+    std::uint8_t batch[kBitBatchBytes] = {};
+    std::size_t index = 0;
+    status = ForEach::Visit(value, [&](const bool& flag) -> Status<void> {
+      if (flag)
+        batch[index / 8] |= static_cast<std::uint8_t>(1u << (index % 8));
+      if (++index < kBitBatchBytes * 8)
+        return {};
+
+      index = 0;
+      auto batch_status = writer->Write(batch, batch + kBitBatchBytes);
+      std::fill(batch, batch + kBitBatchBytes, 0);
+      return batch_status;
+    });
+    if (!status)
+      return status;
+
+    return writer->Write(batch, batch + BitBytes(index));
+  }
+};
+
+template <typename Iterator>
+struct RangeForEach {
+  template <typename Callback>
+  static Status<void> Visit(const Range<Iterator>& value, Callback callback) {
+    for (auto it = value.begin(); it != value.end(); ++it) {
+      auto status = callback(*it);
+      if (!status)
+        return status;
+    }
+    return {};
+  }
+};
+
+template <typename T>
+struct GeneratorForEach {
+  template <typename Callback>
+  static Status<void> Visit(const Generator<T>& value, Callback callback) {
+    T element{};
+    for (std::size_t i = 0; i < value.size(); i++) {
+      auto status = value.Produce(i, &element);
+      if (!status)
+        return status;
+
+      status = callback(element);
+      if (!status)
+        return status;
+    }
+    return {};
+  }
+};
+
+}  // namespace detail
+
+template <typename Iterator>
+struct Encoding<Range<Iterator>>
+    : detail::SequenceEncoding<typename Range<Iterator>::ValueType,
+                               Range<Iterator>,
+                               detail::RangeForEach<Iterator>> {};
+
+template <typename T>
+struct Encoding<Generator<T>>
+    : detail::SequenceEncoding<T, Generator<T>, detail::GeneratorForEach<T>> {
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_BASE_SEQUENCE_H_
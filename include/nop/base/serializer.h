@@ -17,10 +17,17 @@
 #ifndef LIBNOP_INCLUDE_NOP_BASE_SERIALIZER_H_
 #define LIBNOP_INCLUDE_NOP_BASE_SERIALIZER_H_
 
+#include <iterator>
 #include <memory>
+#include <type_traits>
 
 #include <nop/base/encoding.h>
+#include <nop/base/size_cache.h>
 #include <nop/status.h>
+#include <nop/traits/is_detected.h>
+#include <nop/traits/void.h>
+#include <nop/utility/arena.h>
+#include <nop/utility/compiler.h>
 
 namespace nop {
 
@@ -48,19 +55,179 @@ namespace nop {
 // deserialization tasks.
 //
 
+// Trait that determines whether a writer uses the size passed to Prepare().
+// Writers that ignore the size, such as stream and file descriptor writers, may
+// opt out of the size computation that precedes serialization by defining:
+//
+//   static constexpr bool kNeedsPrepare = false;
+//
+// Serialization of such writers visits each value only once. Writers that do
+// not define kNeedsPrepare are always prepared.
+template <typename Writer, typename Enabled = void>
+struct WriterNeedsPrepare : std::true_type {};
+template <typename Writer>
+struct WriterNeedsPrepare<Writer, Void<decltype(Writer::kNeedsPrepare)>>
+    : std::integral_constant<bool, Writer::kNeedsPrepare> {};
+
+// Trait that determines whether a writer provides an unchecked writer for
+// prepared space. Writers that bounds check every write may skip the checks
+// once the Serializer has prepared the space for a value, by defining:
+//
+//   // Returns a writer over the |size| bytes at the current position, which
+//   // were reserved by a successful call to Prepare(size).
+//   UncheckedWriter Unchecked(std::size_t size);
+//
+//   // Advances the current position past the bytes written to |writer|.
+//   void Commit(const UncheckedWriter& writer);
+//
+// The value is then encoded to the unchecked writer. The size of an encoding is
+// an upper bound, but user encodings and generators may underestimate it, so
+// unchecked writers must still fail writes beyond the prepared space. See
+// UncheckedBufferWriter.
+template <typename Writer>
+using WriterUncheckedTest =
+    decltype(std::declval<Writer&>().Unchecked(std::declval<std::size_t>()));
+template <typename Writer>
+using WriterHasUnchecked = IsDetected<WriterUncheckedTest, Writer>;
+
 // Implementation of Write method common to all Serializer specializations.
 struct SerializerCommon {
   template <typename T, typename Writer>
   static constexpr Status<void> Write(const T& value, Writer* writer) {
+    if (NOP_IS_CONSTANT_EVALUATED())
+      return Write(value, writer, WriterNeedsPrepare<Writer>{});
+    else
+      return WriteScoped(value, writer);
+  }
+
+  template <typename Iterator, typename Writer>
+  static Status<void> WriteMany(Iterator first, Iterator last, Writer* writer) {
+    const detail::EntrySizeCache::Scope scope;
+    return WriteMany(first, last, writer, WriterNeedsPrepare<Writer>{});
+  }
+
+ private:
+  // Writes |value| with an entry size cache of its own. A write may be nested
+  // in another, for example when an encoding serializes a value of its own
+  // while the size of an enclosing table is computed.
+  template <typename T, typename Writer>
+  static Status<void> WriteScoped(const T& value, Writer* writer) {
+    const detail::EntrySizeCache::Scope scope;
+    return Write(value, writer, WriterNeedsPrepare<Writer>{});
+  }
+
+  template <typename Iterator>
+  using ValueType = std::decay_t<decltype(*std::declval<Iterator>())>;
+
+  template <typename Iterator, typename Writer>
+  static Status<void> WriteMany(Iterator first, Iterator last, Writer* writer,
+                                std::true_type /*needs_prepare*/) {
+    using T = ValueType<Iterator>;
+
+    // Record the table entry sizes of every value in the batch. The values are
+    // written in the same order, so the sizes are taken in the order recorded.
+    detail::EntrySizeCache& cache = detail::EntrySizeCache::Get();
+    const bool started = cache.Start();
+    std::size_t size_bytes = 0;
+    for (Iterator it = first; it != last; ++it)
+      size_bytes += Encoding<T>::Size(*it);
+    if (started)
+      cache.Stop();
+
+    auto status = writer->Prepare(size_bytes);
+    if (status) {
+      status = WriteManyPrepared(first, last, writer, size_bytes,
+                                 WriterHasUnchecked<Writer>{});
+    }
+    if (started)
+      cache.Clear();
+    return status;
+  }
+
+  template <typename Iterator, typename Writer>
+  static Status<void> WriteMany(Iterator first, Iterator last, Writer* writer,
+                                std::false_type /*needs_prepare*/) {
+    return WriteManyPrepared(first, last, writer, 0, std::false_type{});
+  }
+
+  template <typename Iterator, typename Writer>
+  static Status<void> WriteManyPrepared(Iterator first, Iterator last,
+                                        Writer* writer,
+                                        std::size_t /*size_bytes*/,
+                                        std::false_type /*unchecked*/) {
+    for (; first != last; ++first) {
+      auto status = Encoding<ValueType<Iterator>>::Write(*first, writer);
+      if (!status)
+        return status;
+    }
+    return {};
+  }
+
+  template <typename Iterator, typename Writer>
+  static Status<void> WriteManyPrepared(Iterator first, Iterator last,
+                                        Writer* writer, std::size_t size_bytes,
+                                        std::true_type /*unchecked*/) {
+    auto unchecked_writer = writer->Unchecked(size_bytes);
+    auto status = WriteManyPrepared(first, last, &unchecked_writer, size_bytes,
+                                    std::false_type{});
+    writer->Commit(unchecked_writer);
+    return status;
+  }
+
+  template <typename T, typename Writer>
+  static constexpr Status<void> Write(const T& value, Writer* writer,
+                                      std::true_type /*needs_prepare*/) {
     // Determine how much space to prepare the writer for.
+    if (NOP_IS_CONSTANT_EVALUATED())
+      return Write(value, writer, Encoding<T>::Size(value));
+
+    // Record the sizes of table entries while computing the total size, so that
+    // the entries do not compute them again when they are written.
+    detail::EntrySizeCache& cache = detail::EntrySizeCache::Get();
+    const bool started = cache.Start();
     const std::size_t size_bytes = Encoding<T>::Size(value);
+    if (started)
+      cache.Stop();
 
+    auto status = Write(value, writer, size_bytes);
+    if (started)
+      cache.Clear();
+    return status;
+  }
+
+  template <typename T, typename Writer>
+  static constexpr Status<void> Write(const T& value, Writer* writer,
+                                      std::size_t size_bytes) {
     // Prepare the writer for the serialized data.
     auto status = writer->Prepare(size_bytes);
     if (!status)
       return status;
 
     // Serialize the data to the writer.
+    return WritePrepared(value, writer, size_bytes,
+                         WriterHasUnchecked<Writer>{});
+  }
+
+  template <typename T, typename Writer>
+  static constexpr Status<void> WritePrepared(const T& value, Writer* writer,
+                                              std::size_t /*size_bytes*/,
+                                              std::false_type /*unchecked*/) {
+    return Encoding<T>::Write(value, writer);
+  }
+
+  template <typename T, typename Writer>
+  static Status<void> WritePrepared(const T& value, Writer* writer,
+                                    std::size_t size_bytes,
+                                    std::true_type /*unchecked*/) {
+    auto unchecked_writer = writer->Unchecked(size_bytes);
+    auto status = Encoding<T>::Write(value, &unchecked_writer);
+    writer->Commit(unchecked_writer);
+    return status;
+  }
+
+  template <typename T, typename Writer>
+  static constexpr Status<void> Write(const T& value, Writer* writer,
+                                      std::false_type /*needs_prepare*/) {
     return Encoding<T>::Write(value, writer);
   }
 };
@@ -76,7 +243,8 @@ class Serializer {
   constexpr Serializer& operator=(Serializer&&) = default;
 
   // Returns the encoded size of |value| in bytes. This may be an over estimate
-  // but must never be an under esitmate.
+  // but must never be an under esitmate. See ExactEncodingSize() in
+  // nop/utility/sizing_writer.h for the exact size.
   template <typename T>
   constexpr std::size_t GetSize(const T& value) {
     return Encoding<T>::Size(value);
@@ -88,6 +256,14 @@ class Serializer {
     return SerializerCommon::Write(value, &writer_);
   }
 
+  // Serializes the values in the range [|first|, |last|) to the Writer as a
+  // sequence of top-level values, preparing the Writer once for the whole
+  // batch. Values before a failed write remain in the Writer.
+  template <typename Iterator>
+  Status<void> WriteMany(Iterator first, Iterator last) {
+    return SerializerCommon::WriteMany(first, last, &writer_);
+  }
+
   constexpr const Writer& writer() const { return writer_; }
   constexpr Writer& writer() { return writer_; }
   constexpr Writer&& take() { return std::move(writer_); }
@@ -109,7 +285,8 @@ class Serializer<Writer*> {
   constexpr Serializer& operator=(const Serializer&) = default;
 
   // Returns the encoded size of |value| in bytes. This may be an over estimate
-  // but must never be an under esitmate.
+  // but must never be an under esitmate. See ExactEncodingSize() in
+  // nop/utility/sizing_writer.h for the exact size.
   template <typename T>
   constexpr std::size_t GetSize(const T& value) {
     return Encoding<T>::Size(value);
@@ -121,6 +298,14 @@ class Serializer<Writer*> {
     return SerializerCommon::Write(value, writer_);
   }
 
+  // Serializes the values in the range [|first|, |last|) to the Writer as a
+  // sequence of top-level values, preparing the Writer once for the whole
+  // batch. Values before a failed write remain in the Writer.
+  template <typename Iterator>
+  Status<void> WriteMany(Iterator first, Iterator last) {
+    return SerializerCommon::WriteMany(first, last, writer_);
+  }
+
   constexpr const Writer& writer() const { return *writer_; }
   constexpr Writer& writer() { return *writer_; }
 
@@ -139,7 +324,8 @@ class Serializer<std::unique_ptr<Writer>> {
   constexpr Serializer& operator=(Serializer&&) = default;
 
   // Returns the encoded size of |value| in bytes. This may be an over estimate
-  // but must never be an under esitmate.
+  // but must never be an under esitmate. See ExactEncodingSize() in
+  // nop/utility/sizing_writer.h for the exact size.
   template <typename T>
   constexpr std::size_t GetSize(const T& value) {
     return Encoding<T>::Size(value);
@@ -151,6 +337,14 @@ class Serializer<std::unique_ptr<Writer>> {
     return SerializerCommon::Write(value, writer_.get());
   }
 
+  // Serializes the values in the range [|first|, |last|) to the Writer as a
+  // sequence of top-level values, preparing the Writer once for the whole
+  // batch. Values before a failed write remain in the Writer.
+  template <typename Iterator>
+  Status<void> WriteMany(Iterator first, Iterator last) {
+    return SerializerCommon::WriteMany(first, last, writer_.get());
+  }
+
   constexpr const Writer& writer() const { return *writer_; }
   constexpr Writer& writer() { return *writer_; }
 
@@ -161,6 +355,57 @@ class Serializer<std::unique_ptr<Writer>> {
   Serializer& operator=(const Serializer&) = delete;
 };
 
+namespace detail {
+
+// Determines the type of the values assigned through an output iterator. Insert
+// iterators, such as std::back_insert_iterator, have a void value_type and are
+// resolved through the container they insert into.
+template <typename Iterator, typename Enabled = void>
+struct OutputValueType {
+  using Type = typename std::iterator_traits<Iterator>::value_type;
+};
+template <typename Iterator>
+struct OutputValueType<Iterator,
+                       Void<typename Iterator::container_type::value_type>> {
+  using Type = typename Iterator::container_type::value_type;
+};
+
+}  // namespace detail
+
+// Implementation of ReadMany method common to all Deserializer
+// specializations.
+struct DeserializerCommon {
+  template <typename Iterator, typename Reader>
+  static Status<std::size_t> ReadMany(Iterator out, std::size_t max_count,
+                                      Reader* reader) {
+    using T = typename detail::OutputValueType<Iterator>::Type;
+    using HasRemaining = IsDetected<detail::ReaderRemainingTest, Reader>;
+
+    std::size_t count = 0;
+    for (; count < max_count && !Empty(*reader, HasRemaining{}); count++) {
+      T value;
+      auto status = Encoding<T>::Read(&value, reader);
+      if (!status)
+        return status.error();
+
+      *out = std::move(value);
+      ++out;
+    }
+    return count;
+  }
+
+ private:
+  template <typename Reader>
+  static bool Empty(const Reader& reader, std::true_type /*has_remaining*/) {
+    return reader.remaining() == 0;
+  }
+  template <typename Reader>
+  static bool Empty(const Reader& /*reader*/,
+                    std::false_type /*has_remaining*/) {
+    return false;
+  }
+};
+
 // Deserializer that wraps an internal instance of Reader.
 template <typename Reader>
 class Deserializer {
@@ -178,6 +423,22 @@ class Deserializer {
     return Encoding<T>::Read(value, &reader_);
   }
 
+  // Deserializes up to |max_count| top-level values from the Reader and assigns
+  // them to |out| in order. Stops early when a Reader that reports its
+  // remaining() bytes is exhausted. Returns the number of values read.
+  template <typename Iterator>
+  Status<std::size_t> ReadMany(Iterator out, std::size_t max_count) {
+    return DeserializerCommon::ReadMany(out, max_count, &reader_);
+  }
+
+  // Deserializes the data from the reader with |arena| as the current arena,
+  // so that elements using ArenaAllocator allocate from it.
+  template <typename T>
+  Status<void> Read(T* value, Arena* arena) {
+    ArenaScope scope{arena};
+    return Read(value);
+  }
+
   constexpr const Reader& reader() const { return reader_; }
   constexpr Reader& reader() { return reader_; }
   constexpr Reader&& take() { return std::move(reader_); }
@@ -204,6 +465,22 @@ class Deserializer<Reader*> {
     return Encoding<T>::Read(value, reader_);
   }
 
+  // Deserializes up to |max_count| top-level values from the Reader and assigns
+  // them to |out| in order. Stops early when a Reader that reports its
+  // remaining() bytes is exhausted. Returns the number of values read.
+  template <typename Iterator>
+  Status<std::size_t> ReadMany(Iterator out, std::size_t max_count) {
+    return DeserializerCommon::ReadMany(out, max_count, reader_);
+  }
+
+  // Deserializes the data from the reader with |arena| as the current arena,
+  // so that elements using ArenaAllocator allocate from it.
+  template <typename T>
+  Status<void> Read(T* value, Arena* arena) {
+    ArenaScope scope{arena};
+    return Read(value);
+  }
+
   constexpr const Reader& reader() const { return *reader_; }
   constexpr Reader& reader() { return *reader_; }
 
@@ -227,6 +504,22 @@ class Deserializer<std::unique_ptr<Reader>> {
     return Encoding<T>::Read(value, reader_.get());
   }
 
+  // Deserializes up to |max_count| top-level values from the Reader and assigns
+  // them to |out| in order. Stops early when a Reader that reports its
+  // remaining() bytes is exhausted. Returns the number of values read.
+  template <typename Iterator>
+  Status<std::size_t> ReadMany(Iterator out, std::size_t max_count) {
+    return DeserializerCommon::ReadMany(out, max_count, reader_.get());
+  }
+
+  // Deserializes the data from the reader with |arena| as the current arena,
+  // so that elements using ArenaAllocator allocate from it.
+  template <typename T>
+  Status<void> Read(T* value, Arena* arena) {
+    ArenaScope scope{arena};
+    return Read(value);
+  }
+
   constexpr const Reader& reader() const { return *reader_; }
   constexpr Reader& reader() { return *reader_; }
 
@@ -0,0 +1,241 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_BASE_SET_H_
+#define LIBNOP_INCLUDE_NOP_BASE_SET_H_
+
+#include <algorithm>
+#include <functional>
+#include <numeric>
+#include <set>
+#include <type_traits>
+#include <unordered_set>
+#include <vector>
+
+#include <nop/base/encoding.h>
+#include <nop/utility/canonical.h>
+
+namespace nop {
+
+//
+// std::set<Key>, std::multiset<Key>, std::unordered_set<Key>, and
+// std::unordered_multiset<Key> encoding format:
+//
+// +-----+---------+-----//-----+
+// | ARY | INT64:N | N ELEMENTS |
+// +-----+---------+-----//-----+
+//
+// Elements must be valid encodings of type Key. This is the same format as a
+// std::vector<Key> of non-integral type.
+//
+// Elements of unordered sets are written in iteration order, or in ascending
+// order by canonical writers.
+//
+
+namespace detail {
+
+// Common encoding of the set types.
+template <typename Type>
+struct SetEncoding : EncodingIO<Type> {
+  using Key = typename Type::key_type;
+
+  static constexpr EncodingByte Prefix(const Type& /*value*/) {
+    return EncodingByte::Array;
+  }
+
+  static constexpr std::size_t Size(const Type& value) {
+    if (HasFixedEncodingSize<Key>::value) {
+      return BaseEncodingSize(Prefix(value)) +
+             Encoding<SizeType>::Size(value.size()) +
+             value.size() * FixedEncodingSize<Key>::value;
+    }
+
+    return BaseEncodingSize(Prefix(value)) +
+           Encoding<SizeType>::Size(value.size()) +
+           std::accumulate(value.cbegin(), value.cend(), 0U,
+                           [](const std::size_t& sum, const Key& element) {
+                             return sum + Encoding<Key>::Size(element);
+                           });
+  }
+
+  static constexpr bool Match(EncodingByte prefix) {
+    return prefix == EncodingByte::Array;
+  }
+
+ protected:
+  template <typename Writer>
+  static Status<void> WriteElements(const Type& value, Writer* writer) {
+    auto status = Encoding<SizeType>::Write(value.size(), writer);
+    if (!status)
+      return status;
+
+    for (const Key& element : value) {
+      status = Encoding<Key>::Write(element, writer);
+      if (!status)
+        return status;
+    }
+
+    return {};
+  }
+
+  // Writes the elements in ascending order, so that equal sets have the same
+  // encoding regardless of their insertion history. See Canonical.
+  template <typename Writer>
+  static Status<void> WriteSortedElements(const Type& value, Writer* writer) {
+    auto status = Encoding<SizeType>::Write(value.size(), writer);
+    if (!status)
+      return status;
+
+    std::vector<const Key*> elements;
+    elements.reserve(value.size());
+    for (const Key& element : value)
+      elements.push_back(&element);
+
+    std::sort(elements.begin(), elements.end(),
+              [](const Key* a, const Key* b) {
+                return std::less<Key>{}(*a, *b);
+              });
+
+    for (const Key* element : elements) {
+      status = Encoding<Key>::Write(*element, writer);
+      if (!status)
+        return status;
+    }
+
+    return {};
+  }
+
+  // Reads the number of elements and clears |value|.
+  template <typename Reader>
+  static Status<SizeType> ReadSize(Type* value, Reader* reader) {
+    SizeType size = 0;
+    auto status = Encoding<SizeType>::Read(&size, reader);
+    if (!status)
+      return status.error();
+
+    value->clear();
+    return size;
+  }
+
+  // Reads |size| elements into |value|, inserting each with |insert|.
+  template <typename Reader, typename Insert>
+  static Status<void> ReadElements(SizeType size, Type* value, Reader* reader,
+                                   Insert insert) {
+    for (SizeType i = 0; i < size; i++) {
+      Key element;
+      auto status = Encoding<Key>::Read(&element, reader);
+      if (!status)
+        return status;
+
+      insert(value, std::move(element));
+    }
+
+    return {};
+  }
+};
+
+// Encoding of std::set and std::multiset.
+template <typename Type>
+struct OrderedSetEncoding : SetEncoding<Type> {
+  using Key = typename Type::key_type;
+
+  template <typename Writer>
+  static Status<void> WritePayload(EncodingByte /*prefix*/, const Type& value,
+                                   Writer* writer) {
+    return SetEncoding<Type>::WriteElements(value, writer);
+  }
+
+  // Sets are written in order, so hinting each insertion at the end builds the
+  // tree in linear time. Input in a different order is also decoded correctly,
+  // at the usual logarithmic cost per element.
+  template <typename Reader>
+  static Status<void> ReadPayload(EncodingByte /*prefix*/, Type* value,
+                                  Reader* reader) {
+    auto size = SetEncoding<Type>::ReadSize(value, reader);
+    if (!size)
+      return size.error();
+
+    return SetEncoding<Type>::ReadElements(
+        size.get(), value, reader, [](Type* set, Key&& element) {
+          set->emplace_hint(set->end(), std::move(element));
+        });
+  }
+};
+
+// Encoding of std::unordered_set and std::unordered_multiset.
+template <typename Type>
+struct UnorderedSetEncoding : SetEncoding<Type> {
+  using Key = typename Type::key_type;
+
+  template <typename Writer>
+  static Status<void> WritePayload(EncodingByte /*prefix*/, const Type& value,
+                                   Writer* writer) {
+    return WritePayload(value, writer, WriterIsCanonical<Writer>{});
+  }
+
+  template <typename Writer>
+  static Status<void> WritePayload(const Type& value, Writer* writer,
+                                   std::false_type /*canonical*/) {
+    return SetEncoding<Type>::WriteElements(value, writer);
+  }
+
+  template <typename Writer>
+  static Status<void> WritePayload(const Type& value, Writer* writer,
+                                   std::true_type /*canonical*/) {
+    return SetEncoding<Type>::WriteSortedElements(value, writer);
+  }
+
+  // Reserves the buckets up front, within the bound of the bytes remaining in
+  // the reader, to avoid rehashing as the elements are inserted.
+  template <typename Reader>
+  static Status<void> ReadPayload(EncodingByte /*prefix*/, Type* value,
+                                  Reader* reader) {
+    auto size = SetEncoding<Type>::ReadSize(value, reader);
+    if (!size)
+      return size.error();
+
+    ReserveEncodedElements<MinimumEncodingSize<Key>::value>(value, size.get(),
+                                                            *reader);
+    return SetEncoding<Type>::ReadElements(
+        size.get(), value, reader,
+        [](Type* set, Key&& element) { set->emplace(std::move(element)); });
+  }
+};
+
+}  // namespace detail
+
+template <typename Key, typename Compare, typename Allocator>
+struct Encoding<std::set<Key, Compare, Allocator>>
+    : detail::OrderedSetEncoding<std::set<Key, Compare, Allocator>> {};
+
+template <typename Key, typename Compare, typename Allocator>
+struct Encoding<std::multiset<Key, Compare, Allocator>>
+    : detail::OrderedSetEncoding<std::multiset<Key, Compare, Allocator>> {};
+
+template <typename Key, typename Hash, typename KeyEqual, typename Allocator>
+struct Encoding<std::unordered_set<Key, Hash, KeyEqual, Allocator>>
+    : detail::UnorderedSetEncoding<
+          std::unordered_set<Key, Hash, KeyEqual, Allocator>> {};
+
+template <typename Key, typename Hash, typename KeyEqual, typename Allocator>
+struct Encoding<std::unordered_multiset<Key, Hash, KeyEqual, Allocator>>
+    : detail::UnorderedSetEncoding<
+          std::unordered_multiset<Key, Hash, KeyEqual, Allocator>> {};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_BASE_SET_H_
@@ -0,0 +1,169 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_BASE_SIZE_CACHE_H_
+#define LIBNOP_INCLUDE_NOP_BASE_SIZE_CACHE_H_
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace nop {
+namespace detail {
+
+// Thread-local scratch stack of table entry sizes.
+//
+// Writing a table entry requires the encoded size of the entry value up front.
+// Without a cache, the size of a nested table entry is recomputed at every
+// level of nesting above it, making the size computation quadratic in the
+// depth of the tables. While recording, the table encoding reserves a slot for
+// each active entry in the order the entries are visited by Size(), which is
+// the same order they are written. The write phase then takes the sizes from
+// the front of the cache instead of recomputing them.
+//
+// Each slot records the address and type of its entry. A slot is only used
+// when both match the entry being written, so a mismatch, such as from a
+// user-defined encoding whose Size() does not visit the same values as
+// Write(), safely falls back to computing the size.
+//
+// Serialization may nest, for example when an encoding serializes a value of
+// its own from Size(). Each top-level write holds a Scope, which sets aside the
+// slots of an enclosing write until the nested write completes, so that the
+// two never share slots.
+//
+// The cache is only used at runtime: the table encoding and the serializer
+// bypass it during constant evaluation.
+class EntrySizeCache {
+ public:
+  using Tag = const void*;
+
+  // Gives a top-level write an empty cache of its own. See below.
+  class Scope;
+
+  // Returns a unique tag for type T.
+  template <typename T>
+  static Tag TagFor() {
+    static const char tag = 0;
+    return &tag;
+  }
+
+  static EntrySizeCache& Get() {
+    static thread_local EntrySizeCache cache;
+    return cache;
+  }
+
+  bool recording() const { return recording_; }
+
+  // Returns true if the cache holds sizes that have not been taken.
+  bool pending() const { return index_ != slots_.size(); }
+
+  // Returns true if an operation is recording or taking sizes.
+  bool in_use() const { return recording_ || pending(); }
+
+  // Starts recording sizes. Returns false if the cache is already in use by an
+  // enclosing operation, in which case the caller must not call Stop() or
+  // Clear().
+  bool Start() {
+    if (in_use())
+      return false;
+
+    Clear();
+    recording_ = true;
+    return true;
+  }
+
+  void Stop() { recording_ = false; }
+
+  // Discards all slots while retaining the storage.
+  void Clear() {
+    slots_.clear();
+    index_ = 0;
+  }
+
+  // Reserves a slot for the entry at |address| with type tag |tag| and returns
+  // its index.
+  std::size_t Reserve(const void* address, Tag tag) {
+    slots_.push_back({address, tag, 0});
+    return slots_.size() - 1;
+  }
+
+  // Records |size| in |slot| if the slot is still reserved for the entry at
+  // |address| with type tag |tag|. Otherwise nothing is recorded, and the write
+  // phase computes the size of the entry again.
+  void Set(std::size_t slot, const void* address, Tag tag, std::size_t size) {
+    if (slot < slots_.size() && slots_[slot].address == address &&
+        slots_[slot].tag == tag) {
+      slots_[slot].size = size;
+    }
+  }
+
+  // Takes the size at the front of the cache if it was recorded for the entry
+  // at |address| with type tag |tag|. Otherwise the remaining slots are stale
+  // and are discarded. Sizes are never taken, nor discarded, while recording.
+  bool Take(const void* address, Tag tag, std::size_t* size) {
+    if (recording_ || !pending())
+      return false;
+
+    const Slot& slot = slots_[index_];
+    if (slot.address != address || slot.tag != tag) {
+      Clear();
+      return false;
+    }
+
+    *size = slot.size;
+    index_++;
+    return true;
+  }
+
+ private:
+  struct Slot {
+    const void* address;
+    Tag tag;
+    std::size_t size;
+  };
+
+  std::vector<Slot> slots_;
+  std::size_t index_{0};
+  bool recording_{false};
+};
+
+// Gives the enclosing top-level write an empty cache of its own for its
+// lifetime. The state of the cache is only saved when it is in use, so the
+// outermost write keeps the storage of the cache between writes.
+class EntrySizeCache::Scope {
+ public:
+  Scope() : cache_(Get()), nested_{cache_.in_use()} {
+    if (nested_)
+      std::swap(saved_, cache_);
+  }
+  ~Scope() {
+    if (nested_)
+      cache_ = std::move(saved_);
+  }
+
+  Scope(const Scope&) = delete;
+  void operator=(const Scope&) = delete;
+
+ private:
+  EntrySizeCache& cache_;
+  EntrySizeCache saved_;
+  const bool nested_;
+};
+
+}  // namespace detail
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_BASE_SIZE_CACHE_H_
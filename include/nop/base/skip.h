@@ -0,0 +1,712 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_BASE_SKIP_H_
+#define LIBNOP_INCLUDE_NOP_BASE_SKIP_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <nop/base/encoding.h>
+#include <nop/base/pointer.h>
+#include <nop/base/utility.h>
+#include <nop/status.h>
+#include <nop/traits/is_detected.h>
+#include <nop/types/interned.h>
+
+namespace nop {
+
+//
+// SkipValue() and ValidateValue() advance a reader past exactly one encoded
+// value of any type, without knowing the C++ type of the value and without
+// materializing it. The value is walked using only the prefix bytes and
+// lengths of the format: integers and floating point values are skipped by
+// width, binary and string payloads by length, and containers, structures,
+// variants, results, handles, tables, and extensions recursively.
+//
+// SkipValue() does the minimum work required to find the end of the value. In
+// particular, the entries of tables are skipped using their byte lengths.
+//
+// ValidateValue() additionally checks the structure of the value:
+//   * Table entries must contain exactly one valid value, optionally followed
+//     by padding, within the entry length.
+//   * Variant indices must be in the valid range and empty variants must hold
+//     NIL.
+//   * Container element counts must not exceed the number of bytes the reader
+//     reports as available, for readers that bound their input.
+//
+// Neither function checks that a value matches a particular C++ type; that
+// requires deserializing it. Both limit the nesting depth of containers to
+// |max_depth| to bound the stack usage on untrusted input, returning
+// ErrorStatus::DepthLimitReached when the limit is exceeded.
+//
+// The string and pointer table extensions used by Interned<String> and
+// std::shared_ptr are self-delimiting: a string table value holds a single
+// definition or reference, and a pointer table value holds a reference that is
+// followed by the definition of the object when it is kNewPointerReference.
+// Since the entries of these tables are numbered in the order they are defined,
+// skipping a definition would throw off the numbering of the entries defined
+// after it. When |reader| keeps the tables, as InterningReader does, skipped
+// strings are therefore added to its string table, and skipped objects reserve
+// their entries in its pointer table. References to reserved entries fail with
+// ErrorStatus::InvalidReference, since the objects were never decoded.
+//
+// CaptureValue() walks a value like SkipValue() and appends the encoded bytes
+// of the value to a buffer, which allows values to be relayed without
+// decoding them. Captured definitions are not added to the tables of the
+// reader.
+//
+// Unknown extension types and reserved prefixes have no defined length and
+// result in ErrorStatus::UnexpectedEncodingType.
+//
+
+enum : std::size_t { kDefaultMaxValueDepth = 64 };
+
+namespace detail {
+
+// Reader wrapper that counts the bytes read and enforces nested limits, such
+// as the lengths of table entries. Unlike nesting BoundedReader, the type of
+// the reader does not change with the nesting depth of the value.
+template <typename Reader>
+class SkipReader {
+ public:
+  explicit SkipReader(Reader* reader) : reader_{reader} {}
+
+  Status<void> Ensure(std::size_t size) {
+    if (limit_ - offset_ < size)
+      return ErrorStatus::ReadLimitReached;
+    else
+      return reader_->Ensure(size);
+  }
+
+  Status<void> Read(std::uint8_t* byte) {
+    if (limit_ == offset_)
+      return ErrorStatus::ReadLimitReached;
+
+    auto status = reader_->Read(byte);
+    if (!status)
+      return status;
+
+    offset_ += 1;
+    return {};
+  }
+
+  template <typename T, typename Enable = EnableIfArithmetic<T>>
+  Status<void> Read(T* begin, T* end) {
+    const std::size_t length_bytes = (end - begin) * sizeof(T);
+    if (limit_ - offset_ < length_bytes)
+      return ErrorStatus::ReadLimitReached;
+
+    auto status = reader_->Read(begin, end);
+    if (!status)
+      return status;
+
+    offset_ += length_bytes;
+    return {};
+  }
+
+  Status<void> Skip(std::size_t padding_bytes) {
+    if (limit_ - offset_ < padding_bytes)
+      return ErrorStatus::ReadLimitReached;
+
+    auto status = reader_->Skip(padding_bytes);
+    if (!status)
+      return status;
+
+    offset_ += padding_bytes;
+    return {};
+  }
+
+  // Skips up to |max_count| consecutive fixint values, returning the number
+  // skipped. Readers that expose their input as memory may provide a
+  // SkipFixInts() method that scans runs of fixints in bulk; otherwise no
+  // values are skipped here and each value is walked individually.
+  std::size_t SkipFixInts(std::size_t max_count) {
+    if (limit_ - offset_ < max_count)
+      max_count = limit_ - offset_;
+
+    const std::size_t count =
+        SkipFixInts(max_count, IsDetected<HasSkipFixInts, Reader>{});
+    offset_ += count;
+    return count;
+  }
+
+  // Skips a string table definition of |size| bytes, adding it to the string
+  // table of the reader if the reader keeps one.
+  Status<void> SkipStringDefinition(std::size_t size) {
+    if (limit_ - offset_ < size)
+      return ErrorStatus::ReadLimitReached;
+
+    auto status = SkipStringDefinition(size, ReaderInternsStrings<Reader>{},
+                                       ReaderCanBorrow<Reader>{});
+    if (!status)
+      return status;
+
+    offset_ += size;
+    return {};
+  }
+
+  // Reserves the entry of a skipped object definition in the pointer table of
+  // the reader if the reader keeps one.
+  Status<void> SkipPointerDefinition() {
+    return SkipPointerDefinition(ReaderInternsPointers<Reader>{});
+  }
+
+  // Limits reading to the next |size| bytes and returns the previous limit,
+  // which must be restored with PopLimit().
+  Status<std::size_t> PushLimit(std::size_t size) {
+    if (limit_ - offset_ < size)
+      return ErrorStatus::ReadLimitReached;
+
+    const std::size_t previous_limit = limit_;
+    limit_ = offset_ + size;
+    return previous_limit;
+  }
+
+  // Skips the bytes remaining before the current limit and restores the
+  // previous limit.
+  Status<void> PopLimit(std::size_t previous_limit) {
+    auto status = Skip(limit_ - offset_);
+    if (!status)
+      return status;
+
+    limit_ = previous_limit;
+    return {};
+  }
+
+ private:
+  template <typename T>
+  using HasSkipFixInts =
+      decltype(std::declval<T&>().SkipFixInts(std::size_t{}));
+
+  std::size_t SkipFixInts(std::size_t max_count, std::true_type) {
+    return reader_->SkipFixInts(max_count);
+  }
+  std::size_t SkipFixInts(std::size_t /*max_count*/, std::false_type) {
+    return 0;
+  }
+
+  template <typename CanBorrow>
+  Status<void> SkipStringDefinition(std::size_t size,
+                                    std::false_type /*interns_strings*/,
+                                    CanBorrow) {
+    return reader_->Skip(size);
+  }
+
+  // Borrows the definition, since the table may refer into the input.
+  Status<void> SkipStringDefinition(std::size_t size,
+                                    std::true_type /*interns_strings*/,
+                                    std::true_type /*can_borrow*/) {
+    const void* data = nullptr;
+    auto status = reader_->Borrow(size, &data);
+    if (!status)
+      return status;
+
+    return reader_->DefineString(
+        StringView{static_cast<const char*>(data), size});
+  }
+
+  // Reads the definition into a temporary string, which the table copies.
+  Status<void> SkipStringDefinition(std::size_t size,
+                                    std::true_type /*interns_strings*/,
+                                    std::false_type /*can_borrow*/) {
+    std::string string(size, '\0');
+    auto status = reader_->Read(&string[0], &string[0] + size);
+    if (!status)
+      return status;
+
+    return reader_->DefineString(StringView{string.data(), string.size()});
+  }
+
+  Status<void> SkipPointerDefinition(std::false_type /*interns_pointers*/) {
+    return {};
+  }
+  Status<void> SkipPointerDefinition(std::true_type /*interns_pointers*/) {
+    return reader_->DefinePointer(nullptr, nullptr);
+  }
+
+  Reader* reader_;
+  std::size_t offset_{0};
+  std::size_t limit_{std::numeric_limits<std::size_t>::max()};
+};
+
+// Reader wrapper that appends the bytes read or skipped through it to a
+// buffer, up to |max_size| bytes in total.
+template <typename Reader>
+class CaptureReader {
+ public:
+  CaptureReader(Reader* reader, std::vector<std::uint8_t>* bytes,
+                std::size_t max_size)
+      : reader_{reader}, bytes_{bytes}, max_size_{max_size} {}
+
+  Status<void> Ensure(std::size_t size) { return reader_->Ensure(size); }
+
+  Status<void> Read(std::uint8_t* byte) {
+    if (bytes_->size() >= max_size_)
+      return ErrorStatus::ReadLimitReached;
+
+    auto status = reader_->Read(byte);
+    if (!status)
+      return status;
+
+    bytes_->push_back(*byte);
+    return {};
+  }
+
+  template <typename T, typename Enable = EnableIfArithmetic<T>>
+  Status<void> Read(T* begin, T* end) {
+    auto status = reader_->Read(begin, end);
+    if (!status)
+      return status;
+
+    const std::size_t length_bytes = (end - begin) * sizeof(T);
+    std::uint8_t* data = Extend(length_bytes);
+    if (data == nullptr)
+      return ErrorStatus::ReadLimitReached;
+
+    std::memcpy(data, begin, length_bytes);
+    return {};
+  }
+
+  // Payloads that the skipper would skip are read directly into the buffer.
+  Status<void> Skip(std::size_t padding_bytes) {
+    std::uint8_t* data = Extend(padding_bytes);
+    if (data == nullptr)
+      return ErrorStatus::ReadLimitReached;
+
+    auto status = reader_->Read(data, data + padding_bytes);
+    if (!status)
+      bytes_->resize(bytes_->size() - padding_bytes);
+    return status;
+  }
+
+ private:
+  // Grows the buffer by |size| bytes and returns a pointer to them, or nullptr
+  // if the buffer would exceed the maximum size.
+  std::uint8_t* Extend(std::size_t size) {
+    const std::size_t offset = bytes_->size();
+    if (max_size_ - offset < size)
+      return nullptr;
+
+    bytes_->resize(offset + size);
+    return bytes_->data() + offset;
+  }
+
+  Reader* reader_;
+  std::vector<std::uint8_t>* bytes_;
+  std::size_t max_size_;
+};
+
+template <bool Validate>
+struct ValueSkipper {
+  template <typename Reader>
+  static Status<void> Skip(Reader* reader, std::size_t depth) {
+    if (depth == 0)
+      return ErrorStatus::DepthLimitReached;
+
+    EncodingByte prefix;
+    auto status = ReadPrefix(&prefix, reader);
+    if (!status)
+      return status;
+
+    return SkipPayload(prefix, reader, depth - 1);
+  }
+
+ private:
+  template <typename Reader>
+  static Status<void> ReadPrefix(EncodingByte* prefix, Reader* reader) {
+    auto status = reader->Ensure(sizeof(std::uint8_t));
+    if (!status)
+      return status;
+
+    std::uint8_t byte;
+    status = reader->Read(&byte);
+    if (!status)
+      return status;
+
+    *prefix = static_cast<EncodingByte>(byte);
+    return {};
+  }
+
+  template <typename Reader>
+  static Status<void> SkipBytes(Reader* reader, std::size_t size) {
+    auto status = reader->Ensure(size);
+    if (!status)
+      return status;
+
+    return reader->Skip(size);
+  }
+
+  static constexpr bool IsFixInt(EncodingByte prefix) {
+    return prefix <= EncodingByte::PositiveFixIntMax ||
+           prefix >= EncodingByte::NegativeFixIntMin;
+  }
+
+  // Returns the number of payload bytes of an integer or floating point
+  // encoding, or -1 if the prefix is not in one of these classes.
+  static constexpr int NumberPayloadSize(EncodingByte prefix) {
+    switch (prefix) {
+      case EncodingByte::U8:
+      case EncodingByte::I8:
+        return 1;
+      case EncodingByte::U16:
+      case EncodingByte::I16:
+        return 2;
+      case EncodingByte::U32:
+      case EncodingByte::I32:
+      case EncodingByte::F32:
+        return 4;
+      case EncodingByte::U64:
+      case EncodingByte::I64:
+      case EncodingByte::F64:
+        return 8;
+      default:
+        return IsFixInt(prefix) ? 0 : -1;
+    }
+  }
+
+  // Skips an integer of any size or signedness.
+  template <typename Reader>
+  static Status<void> SkipInteger(Reader* reader) {
+    EncodingByte prefix;
+    auto status = ReadPrefix(&prefix, reader);
+    if (!status)
+      return status;
+
+    const int size = NumberPayloadSize(prefix);
+    if (size < 0 || prefix == EncodingByte::F32 || prefix == EncodingByte::F64)
+      return ErrorStatus::UnexpectedEncodingType;
+
+    return SkipBytes(reader, size);
+  }
+
+  // Reads an element count and, when validating, checks that the reader can
+  // hold at least one byte for each of the |count| * |multiple| elements.
+  template <typename Reader>
+  static Status<void> ReadCount(SizeType* count, std::size_t multiple,
+                                Reader* reader) {
+    auto status = Encoding<SizeType>::Read(count, reader);
+    if (!status)
+      return status;
+
+    if (Validate) {
+      if (*count > std::numeric_limits<std::size_t>::max() / multiple)
+        return ErrorStatus::InvalidContainerLength;
+
+      status = reader->Ensure(*count * multiple);
+      if (!status)
+        return ErrorStatus::InvalidContainerLength;
+    }
+
+    return {};
+  }
+
+  template <typename Reader>
+  static Status<void> SkipElements(Reader* reader, std::size_t multiple,
+                                   std::size_t depth) {
+    SizeType count = 0;
+    auto status = ReadCount(&count, multiple, reader);
+    if (!status)
+      return status;
+
+    if (multiple == 1) {
+      // Arrays and structures of small integers are mostly fixints, which do
+      // not need to be walked one at a time when the reader can scan them.
+      SizeType i = 0;
+      while (i < count) {
+        i += reader->SkipFixInts(count - i);
+        if (i == count)
+          break;
+
+        status = Skip(reader, depth);
+        if (!status)
+          return status;
+        i++;
+      }
+      return {};
+    }
+
+    for (SizeType i = 0; i < count; i++) {
+      for (std::size_t j = 0; j < multiple; j++) {
+        status = Skip(reader, depth);
+        if (!status)
+          return status;
+      }
+    }
+    return {};
+  }
+
+  template <typename Reader>
+  static Status<void> SkipVariant(Reader* reader, std::size_t depth) {
+    if (!Validate) {
+      auto status = SkipInteger(reader);
+      if (!status)
+        return status;
+
+      return Skip(reader, depth);
+    }
+
+    std::int32_t index = 0;
+    auto status = Encoding<std::int32_t>::Read(&index, reader);
+    if (!status)
+      return status;
+    else if (index < -1)
+      return ErrorStatus::UnexpectedVariantType;
+    else if (index >= 0)
+      return Skip(reader, depth);
+
+    EncodingByte prefix;
+    status = ReadPrefix(&prefix, reader);
+    if (!status)
+      return status;
+    else if (prefix != EncodingByte::Nil)
+      return ErrorStatus::UnexpectedVariantType;
+    else
+      return {};
+  }
+
+  // Skips a string table definition or reference.
+  template <typename Reader>
+  static Status<void> SkipStringTableValue(Reader* reader) {
+    EncodingByte prefix;
+    auto status = ReadPrefix(&prefix, reader);
+    if (!status)
+      return status;
+
+    if (prefix == EncodingByte::String) {
+      SizeType size = 0;
+      status = Encoding<SizeType>::Read(&size, reader);
+      if (!status)
+        return status;
+
+      status = reader->Ensure(size);
+      if (!status)
+        return status;
+
+      return reader->SkipStringDefinition(size);
+    } else if (Encoding<StringReference>::Match(prefix)) {
+      return SkipBytes(reader, NumberPayloadSize(prefix));
+    } else {
+      return ErrorStatus::UnexpectedEncodingType;
+    }
+  }
+
+  // Skips a pointer table reference and the definition that follows it, if
+  // any.
+  template <typename Reader>
+  static Status<void> SkipPointerTableValue(Reader* reader,
+                                            std::size_t depth) {
+    PointerReference reference = 0;
+    auto status = Encoding<PointerReference>::Read(&reference, reader);
+    if (!status)
+      return status;
+    else if (Validate && reference < kNewPointerReference)
+      return ErrorStatus::InvalidReference;
+    else if (reference != kNewPointerReference)
+      return {};
+
+    status = reader->SkipPointerDefinition();
+    if (!status)
+      return status;
+
+    return Skip(reader, depth);
+  }
+
+  template <typename Reader>
+  static Status<void> SkipExtension(Reader* reader, std::size_t depth) {
+    std::uint8_t type = 0;
+    auto status = Encoding<std::uint8_t>::Read(&type, reader);
+    if (!status)
+      return status;
+
+    switch (static_cast<ExtensionType>(type)) {
+      case ExtensionType::StringTable:
+        return SkipStringTableValue(reader);
+
+      case ExtensionType::SharedPointer:
+        return SkipPointerTableValue(reader, depth);
+
+      default:
+        return ErrorStatus::UnexpectedEncodingType;
+    }
+  }
+
+  template <typename Reader>
+  static Status<void> SkipTable(Reader* reader, std::size_t depth) {
+    std::uint64_t hash = 0;
+    auto status = Encoding<std::uint64_t>::Read(&hash, reader);
+    if (!status)
+      return status;
+
+    // Each entry is at least two bytes: the id and the length.
+    SizeType count = 0;
+    status = ReadCount(&count, 2, reader);
+    if (!status)
+      return status;
+
+    for (SizeType i = 0; i < count; i++) {
+      std::uint64_t id = 0;
+      status = Encoding<std::uint64_t>::Read(&id, reader);
+      if (!status)
+        return status;
+
+      SizeType size = 0;
+      status = Encoding<SizeType>::Read(&size, reader);
+      if (!status)
+        return status;
+
+      if (Validate) {
+        status = reader->Ensure(size);
+        if (!status)
+          return status;
+
+        auto limit_status = reader->PushLimit(size);
+        if (!limit_status)
+          return limit_status.error();
+
+        status = Skip(reader, depth);
+        if (!status)
+          return status;
+
+        status = reader->PopLimit(limit_status.get());
+      } else {
+        status = SkipBytes(reader, size);
+      }
+      if (!status)
+        return status;
+    }
+    return {};
+  }
+
+ public:
+  // Skips the payload of a value whose prefix has already been read.
+  template <typename Reader>
+  static Status<void> SkipPayload(EncodingByte prefix, Reader* reader,
+                                  std::size_t depth) {
+    switch (prefix) {
+      case EncodingByte::Nil:
+        return {};
+
+      case EncodingByte::Binary:
+      case EncodingByte::String: {
+        SizeType size = 0;
+        auto status = Encoding<SizeType>::Read(&size, reader);
+        if (!status)
+          return status;
+
+        return SkipBytes(reader, size);
+      }
+
+      case EncodingByte::Array:
+      case EncodingByte::Structure:
+        return SkipElements(reader, 1, depth);
+
+      case EncodingByte::Map:
+        return SkipElements(reader, 2, depth);
+
+      case EncodingByte::Variant:
+        return SkipVariant(reader, depth);
+
+      case EncodingByte::Table:
+        return SkipTable(reader, depth);
+
+      case EncodingByte::Error:
+        return SkipInteger(reader);
+
+      case EncodingByte::Handle: {
+        auto status = SkipInteger(reader);
+        if (!status)
+          return status;
+
+        return SkipInteger(reader);
+      }
+
+      case EncodingByte::Extension:
+        return SkipExtension(reader, depth);
+
+      default: {
+        const int size = NumberPayloadSize(prefix);
+        if (size < 0)
+          return ErrorStatus::UnexpectedEncodingType;
+
+        return SkipBytes(reader, size);
+      }
+    }
+  }
+};
+
+}  // namespace detail
+
+// Advances |reader| past one encoded value of any type.
+template <typename Reader>
+Status<void> SkipValue(Reader* reader,
+                       std::size_t max_depth = kDefaultMaxValueDepth) {
+  detail::SkipReader<Reader> skip_reader{reader};
+  return detail::ValueSkipper<false>::Skip(&skip_reader, max_depth);
+}
+
+// Advances |reader| past one encoded value of any type, checking that the
+// value is well formed.
+template <typename Reader>
+Status<void> ValidateValue(Reader* reader,
+                           std::size_t max_depth = kDefaultMaxValueDepth) {
+  detail::SkipReader<Reader> skip_reader{reader};
+  return detail::ValueSkipper<true>::Skip(&skip_reader, max_depth);
+}
+
+// Reads one encoded value of any type from |reader| and appends its encoded
+// bytes to |bytes|. Returns ErrorStatus::ReadLimitReached if the value would
+// grow |bytes| beyond |max_size| bytes, which bounds the memory used for
+// untrusted input from readers that do not bound their input themselves. The
+// contents of |bytes| after an error are unspecified.
+template <typename Reader>
+Status<void> CaptureValue(
+    Reader* reader, std::vector<std::uint8_t>* bytes,
+    std::size_t max_size = std::numeric_limits<std::size_t>::max(),
+    std::size_t max_depth = kDefaultMaxValueDepth) {
+  detail::CaptureReader<Reader> capture_reader{reader, bytes, max_size};
+  return SkipValue(&capture_reader, max_depth);
+}
+
+// Like CaptureValue(), for a value whose prefix byte |prefix| has already been
+// read from |reader|. The prefix is appended to |bytes| before the payload.
+template <typename Reader>
+Status<void> CapturePayload(
+    EncodingByte prefix, Reader* reader, std::vector<std::uint8_t>* bytes,
+    std::size_t max_size = std::numeric_limits<std::size_t>::max(),
+    std::size_t max_depth = kDefaultMaxValueDepth) {
+  if (max_depth == 0)
+    return ErrorStatus::DepthLimitReached;
+  else if (bytes->size() >= max_size)
+    return ErrorStatus::ReadLimitReached;
+
+  bytes->push_back(static_cast<std::uint8_t>(prefix));
+  detail::CaptureReader<Reader> capture_reader{reader, bytes, max_size};
+  detail::SkipReader<detail::CaptureReader<Reader>> skip_reader{
+      &capture_reader};
+  return detail::ValueSkipper<false>::SkipPayload(prefix, &skip_reader,
+                                                  max_depth - 1);
+}
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_BASE_SKIP_H_
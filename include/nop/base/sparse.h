@@ -0,0 +1,259 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_BASE_SPARSE_H_
+#define LIBNOP_INCLUDE_NOP_BASE_SPARSE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <nop/base/encoding.h>
+#include <nop/types/sparse.h>
+
+namespace nop {
+
+//
+// Sparse<std::vector<T>> encoding format:
+//
+// +-----+---------+---------+----//----+
+// | BIN | INT64:L | INT64:N | R RUNS   |
+// +-----+---------+---------+----//----+
+//
+// Where L is the number of bytes that follow it and N is the number of
+// elements. Each run is a number of zero elements followed by a number of
+// elements stored as direct little-endian values:
+//
+// +---------+---------+---//----+
+// | INT64:Z | INT64:K | K VALUES |
+// +---------+---------+---//----+
+//
+// Every run covers at least one element, and the runs cover exactly N
+// elements. Zero runs shorter than a few bytes are stored with the elements
+// around them, where they cost less than the counts of a new run.
+//
+// Zero runs are found 8 bytes at a time, and each run of elements is written
+// and read with a single call to the writer or reader.
+//
+
+namespace detail {
+
+// Returns whether every byte of |value| is zero.
+template <typename T>
+bool IsZeroBytes(const T& value) {
+  const T zero{};
+  return std::memcmp(&value, &zero, sizeof(T)) == 0;
+}
+
+// Returns the number of leading zero elements of the |count| elements at
+// |data|.
+template <typename T>
+std::size_t CountZeroElements(const T* data, std::size_t count) {
+  static_assert(8 % sizeof(T) == 0, "Element size must divide a word.");
+  enum : std::size_t { kWordElements = 8 / sizeof(T) };
+
+  std::size_t index = 0;
+  for (; count - index >= kWordElements; index += kWordElements) {
+    std::uint64_t word;
+    std::memcpy(&word, data + index, sizeof(word));
+    if (word != 0)
+      break;
+  }
+
+  while (index < count && IsZeroBytes(data[index]))
+    index++;
+  return index;
+}
+
+}  // namespace detail
+
+template <typename T, typename Allocator>
+struct Encoding<Sparse<std::vector<T, Allocator>>>
+    : EncodingIO<Sparse<std::vector<T, Allocator>>> {
+  using Type = Sparse<std::vector<T, Allocator>>;
+
+  static constexpr EncodingByte Prefix(const Type& /*value*/) {
+    return EncodingByte::Binary;
+  }
+
+  static std::size_t Size(const Type& value) {
+    const SizeType length = PayloadSize(value.get());
+    return BaseEncodingSize(Prefix(value)) + Encoding<SizeType>::Size(length) +
+           length;
+  }
+
+  static constexpr bool Match(EncodingByte prefix) {
+    return prefix == EncodingByte::Binary;
+  }
+
+  template <typename Writer>
+  static Status<void> WritePayload(EncodingByte /*prefix*/, const Type& value,
+                                   Writer* writer) {
+    const std::vector<T, Allocator>& elements = value.get();
+    auto status = Encoding<SizeType>::Write(PayloadSize(elements), writer);
+    if (!status)
+      return status;
+
+    status = Encoding<SizeType>::Write(elements.size(), writer);
+    if (!status)
+      return status;
+
+    for (std::size_t index = 0; index < elements.size();) {
+      const Run run = NextRun(elements, index);
+      status = Encoding<SizeType>::Write(run.zeros, writer);
+      if (status)
+        status = Encoding<SizeType>::Write(run.elements, writer);
+      if (!status)
+        return status;
+
+      index += run.zeros;
+      status = WriteElements(elements.data() + index,
+                             elements.data() + index + run.elements, writer);
+      if (!status)
+        return status;
+      index += run.elements;
+    }
+
+    return {};
+  }
+
+  template <typename Reader>
+  static Status<void> ReadPayload(EncodingByte /*prefix*/, Type* value,
+                                  Reader* reader) {
+    SizeType length = 0;
+    auto status = Encoding<SizeType>::Read(&length, reader);
+    if (!status)
+      return status;
+
+    status = reader->Ensure(length);
+    if (!status)
+      return status;
+
+    SizeType size = 0;
+    status = Encoding<SizeType>::Read(&size, reader);
+    if (!status)
+      return status;
+
+    std::size_t remaining = length;
+    if (!Consume(Encoding<SizeType>::Size(size), &remaining) ||
+        size > value->max_size()) {
+      return ErrorStatus::InvalidContainerLength;
+    }
+
+    // The vector grows as the runs are decoded, so that a large size without
+    // the runs to back it fails before it allocates.
+    std::vector<T, Allocator>& elements = value->get();
+    elements.clear();
+
+    for (SizeType index = 0; index < size;) {
+      SizeType zeros = 0;
+      SizeType count = 0;
+      status = Encoding<SizeType>::Read(&zeros, reader);
+      if (status)
+        status = Encoding<SizeType>::Read(&count, reader);
+      if (!status)
+        return status;
+
+      // Each run must make progress and stay within the vector and payload.
+      if (zeros + count == 0 || zeros > size - index ||
+          count > size - index - zeros ||
+          !Consume(Encoding<SizeType>::Size(zeros) +
+                       Encoding<SizeType>::Size(count),
+                   &remaining) ||
+          count > remaining / sizeof(T) ||
+          !Consume(count * sizeof(T), &remaining)) {
+        return ErrorStatus::InvalidContainerLength;
+      }
+
+      elements.resize(index + zeros + count);
+      index += zeros;
+      status = ReadElements(elements.data() + index,
+                            elements.data() + index + count, reader);
+      if (!status)
+        return status;
+      index += count;
+    }
+
+    if (remaining != 0)
+      return ErrorStatus::InvalidContainerLength;
+    else
+      return {};
+  }
+
+ private:
+  // Zero runs of at least this many bytes start a new run.
+  enum : std::size_t { kMinZeroRunBytes = 4 };
+  enum : std::size_t {
+    kMinZeroRun = (kMinZeroRunBytes + sizeof(T) - 1) / sizeof(T)
+  };
+
+  struct Run {
+    std::size_t zeros;
+    std::size_t elements;
+  };
+
+  static bool Consume(std::size_t size, std::size_t* remaining) {
+    if (size > *remaining)
+      return false;
+    *remaining -= size;
+    return true;
+  }
+
+  // Returns the run that starts at |index|.
+  static Run NextRun(const std::vector<T, Allocator>& elements,
+                     std::size_t index) {
+    const T* data = elements.data();
+    const std::size_t size = elements.size();
+
+    const std::size_t zeros =
+        detail::CountZeroElements(data + index, size - index);
+    const std::size_t begin = index + zeros;
+
+    std::size_t end = begin;
+    while (end < size) {
+      if (!detail::IsZeroBytes(data[end])) {
+        end++;
+        continue;
+      }
+
+      const std::size_t next_zeros =
+          detail::CountZeroElements(data + end, size - end);
+      if (next_zeros >= kMinZeroRun || end + next_zeros == size)
+        break;
+      end += next_zeros;
+    }
+
+    return {zeros, end - begin};
+  }
+
+  static SizeType PayloadSize(const std::vector<T, Allocator>& elements) {
+    std::size_t size = Encoding<SizeType>::Size(elements.size());
+    for (std::size_t index = 0; index < elements.size();) {
+      const Run run = NextRun(elements, index);
+      size += Encoding<SizeType>::Size(run.zeros) +
+              Encoding<SizeType>::Size(run.elements) +
+              run.elements * sizeof(T);
+      index += run.zeros + run.elements;
+    }
+    return size;
+  }
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_BASE_SPARSE_H_
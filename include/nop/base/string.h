@@ -82,8 +82,42 @@ struct Encoding<std::basic_string<CharType, Traits, Allocator>>
     if (!status)
       return status;
 
+    return ReadCharacters(
+        value, size, reader,
+        std::integral_constant<bool, CharSize == 1 &&
+                                         ReaderBorrowsToCopy<Reader>::value>{});
+  }
+
+ private:
+  // Copies the characters directly from readers that support borrowing, which
+  // avoids initializing the string before overwriting it.
+  template <typename Reader>
+  static Status<void> ReadCharacters(Type* value, SizeType size,
+                                     Reader* reader, std::true_type) {
+    const void* data = nullptr;
+    auto status = reader->Borrow(size, &data);
+    if (!status)
+      return status;
+
+    value->assign(static_cast<const CharType*>(data), size);
+    return {};
+  }
+
+  template <typename Reader>
+  static constexpr Status<void> ReadCharacters(Type* value, SizeType size,
+                                               Reader* reader,
+                                               std::false_type) {
+#if defined(__cpp_lib_string_resize_and_overwrite)
+    Status<void> status;
+    value->resize_and_overwrite(size, [&](CharType* data, std::size_t length) {
+      status = reader->Read(data, data + length);
+      return status ? length : 0;
+    });
+    return status;
+#else
     value->resize(size);
     return reader->Read(&(*value)[0], &(*value)[size]);
+#endif
   }
 };
 
@@ -0,0 +1,144 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_BASE_STRING_LIST_H_
+#define LIBNOP_INCLUDE_NOP_BASE_STRING_LIST_H_
+
+#include <string>
+
+#include <nop/base/encoding.h>
+#include <nop/base/string.h>
+#include <nop/base/view.h>
+#include <nop/types/string_list.h>
+
+namespace nop {
+
+//
+// StringList encoding format:
+//
+// +-----+---------+-----//-----+
+// | ARY | INT64:N | N ELEMENTS |
+// +-----+---------+-----//-----+
+//
+// Where each element has the encoding of std::string:
+//
+// +-----+---------+---//----+
+// | STR | INT64:L | L BYTES |
+// +-----+---------+---//----+
+//
+// This is the same format as std::vector<std::string>.
+//
+
+template <>
+struct Encoding<StringList> : EncodingIO<StringList> {
+  using Type = StringList;
+
+  static constexpr EncodingByte Prefix(const Type& /*value*/) {
+    return EncodingByte::Array;
+  }
+
+  static std::size_t Size(const Type& value) {
+    std::size_t size = BaseEncodingSize(Prefix(value)) +
+                       Encoding<SizeType>::Size(value.size());
+    for (StringView string : value)
+      size += Encoding<StringView>::Size(string);
+    return size;
+  }
+
+  static constexpr bool Match(EncodingByte prefix) {
+    return prefix == EncodingByte::Array;
+  }
+
+  template <typename Writer>
+  static Status<void> WritePayload(EncodingByte /*prefix*/, const Type& value,
+                                   Writer* writer) {
+    auto status = Encoding<SizeType>::Write(value.size(), writer);
+    if (!status)
+      return status;
+
+    for (StringView string : value) {
+      status = Encoding<StringView>::Write(string, writer);
+      if (!status)
+        return status;
+    }
+
+    return {};
+  }
+
+  template <typename Reader>
+  static Status<void> ReadPayload(EncodingByte /*prefix*/, Type* value,
+                                  Reader* reader) {
+    SizeType count = 0;
+    auto status = Encoding<SizeType>::Read(&count, reader);
+    if (!status)
+      return status;
+
+    // Reserve the offsets once, bounded by the bytes remaining in the reader
+    // as a defense against abusive or erroneous counts.
+    value->clear();
+    detail::ReserveEncodedElements<MinimumEncodingSize<std::string>::value>(
+        &value->ends_, count, *reader);
+
+    for (SizeType i = 0; i < count; i++) {
+      status = ReadString(value, reader);
+      if (!status)
+        return status;
+    }
+
+    return {};
+  }
+
+ private:
+  // Appends the characters of the next string encoding to the block.
+  template <typename Reader>
+  static Status<void> ReadString(Type* value, Reader* reader) {
+    std::uint8_t prefix = 0;
+    auto status = reader->Read(&prefix);
+    if (!status)
+      return status;
+    else if (static_cast<EncodingByte>(prefix) != EncodingByte::String)
+      return ErrorStatus::UnexpectedEncodingType;
+
+    SizeType size = 0;
+    status = Encoding<SizeType>::Read(&size, reader);
+    if (!status)
+      return status;
+
+    // Make sure the reader has enough data to fulfill the requested size as a
+    // defense against abusive or erroneous string sizes.
+    status = reader->Ensure(size);
+    if (!status)
+      return status;
+
+    auto& characters = value->characters_;
+    const std::size_t begin = characters.size();
+    characters.resize(begin + size);
+    status = reader->Read(characters.data() + begin,
+                          characters.data() + begin + size);
+    if (!status) {
+      characters.resize(begin);
+      return status;
+    }
+
+    value->ends_.push_back(characters.size());
+    return {};
+  }
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_BASE_STRING_LIST_H_
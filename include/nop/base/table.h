@@ -17,12 +17,24 @@
 #ifndef LIBNOP_INCLUDE_NOP_BASE_TABLE_H_
 #define LIBNOP_INCLUDE_NOP_BASE_TABLE_H_
 
+#include <type_traits>
+#include <utility>
+
 #include <nop/base/encoding.h>
+#include <nop/base/id_index.h>
 #include <nop/base/members.h>
+#include <nop/base/pointer.h>
+#include <nop/base/size_cache.h>
+#include <nop/base/skip.h>
 #include <nop/base/utility.h>
 #include <nop/table.h>
+#include <nop/types/interned.h>
 #include <nop/utility/bounded_reader.h>
 #include <nop/utility/bounded_writer.h>
+#include <nop/utility/buffer_writer.h>
+#include <nop/utility/canonical.h>
+#include <nop/utility/compiler.h>
+#include <nop/utility/exact_table_entries.h>
 
 namespace nop {
 
@@ -69,8 +81,8 @@ struct Encoding<Table, EnableIfHasEntryList<Table>> : EncodingIO<Table> {
     return BaseEncodingSize(Prefix(value)) +
            Encoding<std::uint64_t>::Size(
                EntryListTraits<Table>::EntryList::Hash) +
-           Encoding<SizeType>::Size(ActiveEntryCount(value, Index<Count>{})) +
-           Size(value, Index<Count>{});
+           Encoding<SizeType>::Size(ActiveEntryCount(value, Entries{})) +
+           Size(value, Entries{});
   }
 
   static constexpr bool Match(EncodingByte prefix) {
@@ -86,12 +98,12 @@ struct Encoding<Table, EnableIfHasEntryList<Table>> : EncodingIO<Table> {
     if (!status)
       return status;
 
-    status = Encoding<SizeType>::Write(ActiveEntryCount(value, Index<Count>{}),
+    status = Encoding<SizeType>::Write(ActiveEntryCount(value, Entries{}),
                                        writer);
     if (!status)
       return status;
 
-    return WriteEntries(value, writer, Index<Count>{});
+    return WriteEntries(value, writer, Entries{});
   }
 
   template <typename Reader>
@@ -99,7 +111,7 @@ struct Encoding<Table, EnableIfHasEntryList<Table>> : EncodingIO<Table> {
                                             Table* value, Reader* reader) {
     // Clear entries so that we can detect whether there are duplicate entries
     // for the same id during deserialization.
-    ClearEntries(value, Index<Count>{});
+    ClearEntries(value, Entries{});
 
     std::uint64_t hash = 0;
     auto status = Encoding<std::uint64_t>::Read(&hash, reader);
@@ -123,6 +135,42 @@ struct Encoding<Table, EnableIfHasEntryList<Table>> : EncodingIO<Table> {
   using PointerAt =
       typename EntryListTraits<Table>::EntryList::template At<Index>;
 
+#if NOP_HAS_FOLD_EXPRESSIONS
+  // Expands the operations over all entries at once. Writing stops at the
+  // first entry that fails.
+  using Entries = std::make_index_sequence<Count>;
+
+  template <std::size_t... Is>
+  static constexpr std::size_t ActiveEntryCount(
+      [[maybe_unused]] const Table& value, std::index_sequence<Is...>) {
+    return (std::size_t{0} + ... +
+            (PointerAt<Is>::Resolve(value) ? std::size_t{1} : 0));
+  }
+
+  template <std::size_t... Is>
+  static constexpr std::size_t Size([[maybe_unused]] const Table& value,
+                                    std::index_sequence<Is...>) {
+    return (std::size_t{0} + ... + Size(PointerAt<Is>::Resolve(value)));
+  }
+
+  template <std::size_t... Is>
+  static void ClearEntries([[maybe_unused]] Table* value,
+                           std::index_sequence<Is...>) {
+    (PointerAt<Is>::Resolve(value)->clear(), ...);
+  }
+
+  template <typename Writer, std::size_t... Is>
+  static constexpr Status<void> WriteEntries(
+      [[maybe_unused]] const Table& value, [[maybe_unused]] Writer* writer,
+      std::index_sequence<Is...>) {
+    Status<void> status;
+    (void)((status = WriteEntry(PointerAt<Is>::Resolve(value), writer)) &&
+           ...);
+    return status;
+  }
+#else
+  using Entries = Index<Count>;
+
   static constexpr std::size_t ActiveEntryCount(const Table& /*value*/,
                                                 Index<0>) {
     return 0;
@@ -136,23 +184,6 @@ struct Encoding<Table, EnableIfHasEntryList<Table>> : EncodingIO<Table> {
     return ActiveEntryCount(value, Index<index - 1>{}) + count;
   }
 
-  template <typename T, std::uint64_t Id>
-  static constexpr std::size_t Size(const Entry<T, Id, ActiveEntry>& entry) {
-    if (entry) {
-      const std::size_t size = Encoding<T>::Size(entry.get());
-      return Encoding<std::uint64_t>::Size(Id) +
-             Encoding<std::uint64_t>::Size(size) + size;
-    } else {
-      return 0;
-    }
-  }
-
-  template <typename T, std::uint64_t Id>
-  static constexpr std::size_t Size(
-      const Entry<T, Id, DeletedEntry>& /*entry*/) {
-    return 0;
-  }
-
   static constexpr std::size_t Size(const Table& /*value*/, Index<0>) {
     return 0;
   }
@@ -171,60 +202,184 @@ struct Encoding<Table, EnableIfHasEntryList<Table>> : EncodingIO<Table> {
     PointerAt<index - 1>::Resolve(value)->clear();
   }
 
-  template <typename T, std::uint64_t Id, typename Writer>
-  static constexpr Status<void> WriteEntry(
-      const Entry<T, Id, ActiveEntry>& entry, Writer* writer) {
-    if (entry) {
-      auto status = Encoding<std::uint64_t>::Write(Id, writer);
-      if (!status)
-        return status;
+  template <typename Writer>
+  static constexpr Status<void> WriteEntries(const Table& /*value*/,
+                                             Writer* /*writer*/, Index<0>) {
+    return {};
+  }
 
-      const SizeType size = Encoding<T>::Size(entry.get());
-      status = Encoding<SizeType>::Write(size, writer);
-      if (!status)
-        return status;
+  template <std::size_t index, typename Writer>
+  static constexpr Status<void> WriteEntries(const Table& value, Writer* writer,
+                                             Index<index>) {
+    auto status = WriteEntries(value, writer, Index<index - 1>{});
+    if (!status)
+      return status;
 
-      // Use a BoundedWriter to track the number of bytes written. Since a few
-      // encodings overestimate their size, the remaining bytes must be padded
-      // out to match the size written above. This is a tradeoff that
-      // potentially increases the encoding size to avoid unnecessary dynamic
-      // memory allocation during encoding; some size savings could be made by
-      // encoding the entry to a temporary buffer and then writing the exact
-      // size for the binary container. However, overestimation is rare and
-      // small, making the savings not worth the expense of the temporary
-      // buffer.
-      BoundedWriter<Writer> bounded_writer{writer, size};
-      status = Encoding<T>::Write(entry.get(), &bounded_writer);
-      if (!status)
-        return status;
+    using Pointer = PointerAt<index - 1>;
+    return WriteEntry(Pointer::Resolve(value), writer);
+  }
+#endif
 
-      return bounded_writer.WritePadding();
+  template <typename T, std::uint64_t Id>
+  static constexpr std::size_t Size(const Entry<T, Id, ActiveEntry>& entry) {
+    if (entry) {
+      const std::size_t size = EntrySize(entry);
+      return Encoding<std::uint64_t>::Size(Id) +
+             Encoding<std::uint64_t>::Size(size) + size;
     } else {
+      return 0;
+    }
+  }
+
+  // Returns the encoded size of the value of |entry|. When the entry size cache
+  // is recording, the size is also recorded for the write phase.
+  template <typename T, std::uint64_t Id>
+  static constexpr std::size_t EntrySize(
+      const Entry<T, Id, ActiveEntry>& entry) {
+    if (NOP_IS_CONSTANT_EVALUATED())
+      return Encoding<T>::Size(entry.get());
+
+    detail::EntrySizeCache& cache = detail::EntrySizeCache::Get();
+    if (!cache.recording())
+      return Encoding<T>::Size(entry.get());
+
+    const detail::EntrySizeCache::Tag tag =
+        detail::EntrySizeCache::TagFor<decltype(entry)>();
+    const std::size_t slot = cache.Reserve(&entry, tag);
+    const std::size_t size = Encoding<T>::Size(entry.get());
+    cache.Set(slot, &entry, tag, size);
+    return size;
+  }
+
+  template <typename T, std::uint64_t Id>
+  static constexpr std::size_t Size(
+      const Entry<T, Id, DeletedEntry>& /*entry*/) {
+    return 0;
+  }
+
+  template <typename T, std::uint64_t Id, typename Writer>
+  static constexpr Status<void> WriteEntry(
+      const Entry<T, Id, ActiveEntry>& entry, Writer* writer) {
+    if (!entry)
       return {};
+    else if (NOP_IS_CONSTANT_EVALUATED())
+      return WriteEntry(entry, Encoding<T>::Size(entry.get()), writer);
+
+    // Use the size recorded when the size of an enclosing value was computed.
+    // Otherwise, compute the size while recording the sizes of any nested
+    // entries, so that they are not computed again when they are written.
+    detail::EntrySizeCache& cache = detail::EntrySizeCache::Get();
+    std::size_t size = 0;
+    if (cache.Take(&entry, detail::EntrySizeCache::TagFor<decltype(entry)>(),
+                   &size)) {
+      return WriteEntry(entry, size, writer);
     }
+
+    const bool started = cache.Start();
+    size = Encoding<T>::Size(entry.get());
+    if (started)
+      cache.Stop();
+
+    auto status = WriteEntry(entry, size, writer);
+    if (started)
+      cache.Clear();
+    return status;
   }
 
   template <typename T, std::uint64_t Id, typename Writer>
   static constexpr Status<void> WriteEntry(
-      const Entry<T, Id, DeletedEntry>& /*entry*/, Writer* /*writer*/) {
-    return {};
+      const Entry<T, Id, ActiveEntry>& entry, SizeType size, Writer* writer) {
+    // Canonical writers never patch; see below.
+    using Exact =
+        std::integral_constant<bool, WriterExactTableEntries<Writer>::value &&
+                                         !WriterIsCanonical<Writer>::value>;
+    return WriteEntry(entry, size, writer, Exact{});
   }
 
-  template <typename Writer>
-  static constexpr Status<void> WriteEntries(const Table& /*value*/,
-                                             Writer* /*writer*/, Index<0>) {
-    return {};
+  template <typename T, std::uint64_t Id, typename Writer>
+  static constexpr Status<void> WriteEntry(
+      const Entry<T, Id, ActiveEntry>& entry, SizeType size, Writer* writer,
+      std::false_type /*exact*/) {
+    auto status = Encoding<std::uint64_t>::Write(Id, writer);
+    if (!status)
+      return status;
+
+    status = Encoding<SizeType>::Write(size, writer);
+    if (!status)
+      return status;
+
+    // Use a BoundedWriter to track the number of bytes written. Since a few
+    // encodings overestimate their size, the remaining bytes must be padded
+    // out to match the size written above. This is a tradeoff that
+    // potentially increases the encoding size to avoid unnecessary dynamic
+    // memory allocation during encoding; some size savings could be made by
+    // encoding the entry to a temporary buffer and then writing the exact
+    // size for the binary container. However, overestimation is rare and
+    // small, making the savings not worth the expense of the temporary
+    // buffer. Writers that support patching may opt in to exact entry lengths
+    // instead; see ExactTableEntries.
+    BoundedWriter<Writer> bounded_writer{writer, size};
+    status = Encoding<T>::Write(entry.get(), &bounded_writer);
+    if (!status)
+      return status;
+
+    // The canonical encoding has no padding. Entry sizes are only
+    // overestimated for values that are not content, such as handles and
+    // references, which cannot be encoded canonically.
+    if (WriterIsCanonical<Writer>::value && bounded_writer.size() != size)
+      return ErrorStatus::ProtocolError;
+
+    return bounded_writer.WritePadding();
   }
 
-  template <std::size_t index, typename Writer>
-  static constexpr Status<void> WriteEntries(const Table& value, Writer* writer,
-                                             Index<index>) {
-    auto status = WriteEntries(value, writer, Index<index - 1>{});
+  // Writes the entry without padding and patches the entry length to match the
+  // number of bytes written. See ExactTableEntries.
+  template <typename T, std::uint64_t Id, typename Writer>
+  static Status<void> WriteEntry(const Entry<T, Id, ActiveEntry>& entry,
+                                 SizeType size, Writer* writer,
+                                 std::true_type /*exact*/) {
+    auto status = Encoding<std::uint64_t>::Write(Id, writer);
     if (!status)
       return status;
 
-    using Pointer = PointerAt<index - 1>;
-    return WriteEntry(Pointer::Resolve(value), writer);
+    const std::size_t length_offset = writer->offset();
+    status = Encoding<SizeType>::Write(size, writer);
+    if (!status)
+      return status;
+
+    BoundedWriter<Writer> bounded_writer{writer, size};
+    status = Encoding<T>::Write(entry.get(), &bounded_writer);
+    if (!status)
+      return status;
+    else if (bounded_writer.size() == size)
+      return {};
+
+    // Encode the actual length using the prefix of the estimated length, which
+    // is at least as wide. Lengths that fit in the prefix byte use their own
+    // prefix, since a smaller length also fits.
+    const SizeType length = bounded_writer.size();
+    EncodingByte prefix = Encoding<SizeType>::Prefix(size);
+    if (BaseEncodingSize(prefix) == 1)
+      prefix = Encoding<SizeType>::Prefix(length);
+
+    std::uint8_t buffer[BaseEncodingSize(EncodingByte::U64)];
+    BufferWriter length_writer{buffer};
+    status = length_writer.Write(static_cast<std::uint8_t>(prefix));
+    if (!status)
+      return status;
+
+    status = Encoding<SizeType>::WritePayload(prefix, length, &length_writer);
+    if (!status)
+      return status;
+
+    return writer->Patch(length_offset, buffer,
+                         buffer + length_writer.size());
+  }
+
+  template <typename T, std::uint64_t Id, typename Writer>
+  static constexpr Status<void> WriteEntry(
+      const Entry<T, Id, DeletedEntry>& /*entry*/, Writer* /*writer*/) {
+    return {};
   }
 
   template <typename T, std::uint64_t Id, typename Reader>
@@ -256,7 +411,9 @@ struct Encoding<Table, EnableIfHasEntryList<Table>> : EncodingIO<Table> {
     }
   }
 
-  // Skips over the binary container for an entry.
+  // Skips over the binary container for an entry. Readers that keep string or
+  // pointer tables walk the value instead, so that the definitions inside the
+  // entry are added to the tables and later references still resolve.
   template <typename Reader>
   static constexpr Status<void> SkipEntry(Reader* reader) {
     SizeType size = 0;
@@ -264,15 +421,51 @@ struct Encoding<Table, EnableIfHasEntryList<Table>> : EncodingIO<Table> {
     if (!status)
       return status;
 
+    using Interns =
+        std::integral_constant<bool, ReaderInternsStrings<Reader>::value ||
+                                         ReaderInternsPointers<Reader>::value>;
+    return SkipEntryValue(size, reader, Interns{});
+  }
+
+  template <typename Reader>
+  static constexpr Status<void> SkipEntryValue(SizeType size, Reader* reader,
+                                               std::false_type /*interns*/) {
     return reader->Skip(size);
   }
 
+  template <typename Reader>
+  static Status<void> SkipEntryValue(SizeType size, Reader* reader,
+                                     std::true_type /*interns*/) {
+    if (size == 0)
+      return {};
+
+    BoundedReader<Reader> bounded_reader{reader, size};
+    auto status = SkipValue(&bounded_reader);
+    if (!status)
+      return status;
+
+    return bounded_reader.ReadPadding();
+  }
+
   template <typename T, std::uint64_t Id, typename Reader>
   static constexpr Status<void> ReadEntry(Entry<T, Id, DeletedEntry>* /*entry*/,
                                           Reader* reader) {
     return SkipEntry(reader);
   }
 
+  template <std::size_t index, typename Reader>
+  static Status<void> ReadEntryAt(Table* value, Reader* reader) {
+    return ReadEntry(PointerAt<index>::Resolve(value), reader);
+  }
+
+  template <typename Reader>
+  static Status<void> SkipEntryAt(Table* /*value*/, Reader* reader) {
+    return SkipEntry(reader);
+  }
+
+  // Reads the entry for |id| by comparing the id with each entry in turn. The
+  // dispatch tables below are static locals, which constant expressions may
+  // not use, so this path is taken during constant evaluation.
   template <typename Reader>
   static constexpr Status<void> ReadEntryForId(Table* /*value*/,
                                                std::uint64_t /*id*/,
@@ -291,6 +484,22 @@ struct Encoding<Table, EnableIfHasEntryList<Table>> : EncodingIO<Table> {
       return ReadEntryForId(value, id, reader, Index<index - 1>{});
   }
 
+  // Reads the entry for |id|, or skips it if the table has no such entry. The
+  // entry is found using a compile-time index of the entry ids and read through
+  // a table of entry readers indexed by position, with unknown ids mapping to
+  // the skip reader at the end.
+  template <typename Reader, std::size_t... Is>
+  static Status<void> ReadEntryForId(Table* value, std::uint64_t id,
+                                     Reader* reader,
+                                     std::index_sequence<Is...>) {
+    using EntryReader = Status<void> (*)(Table*, Reader*);
+    static constexpr detail::IdIndex<Count> kIndex{
+        static_cast<std::uint64_t>(PointerAt<Is>::Type::Id)...};
+    static constexpr EntryReader kReaders[] = {&ReadEntryAt<Is, Reader>...,
+                                               &SkipEntryAt<Reader>};
+    return kReaders[kIndex.Find(id)](value, reader);
+  }
+
   template <typename Reader>
   static constexpr Status<void> ReadEntries(Table* value, SizeType count,
                                             Reader* reader) {
@@ -300,7 +509,12 @@ struct Encoding<Table, EnableIfHasEntryList<Table>> : EncodingIO<Table> {
       if (!status)
         return status;
 
-      status = ReadEntryForId(value, id, reader, Index<Count>{});
+      if (NOP_IS_CONSTANT_EVALUATED()) {
+        status = ReadEntryForId(value, id, reader, Index<Count>{});
+      } else {
+        status = ReadEntryForId(value, id, reader,
+                                std::make_index_sequence<Count>{});
+      }
       if (!status)
         return status;
     }
@@ -128,6 +128,18 @@ struct Encoding<std::tuple<Types...>> : EncodingIO<std::tuple<Types...>> {
   }
 };
 
+// Tuples have a fixed encoded size when every element has a fixed encoded
+// size.
+template <typename... Types>
+struct FixedEncodingSize<std::tuple<Types...>>
+    : std::integral_constant<
+          std::size_t,
+          And<HasFixedEncodingSize<Types>...>::value
+              ? BaseEncodingSize(EncodingByte::Array) +
+                    Encoding<SizeType>::Size(sizeof...(Types)) +
+                    FixedEncodingSizeSum<Types...>::value
+              : 0> {};
+
 }  // namespace nop
 
 #endif  //  LIBNOP_INCLUDE_NOP_BASE_TUPLE_H_
@@ -17,6 +17,7 @@
 #ifndef LIBNOP_INCLUDE_NOP_BASE_UTILITY_H_
 #define LIBNOP_INCLUDE_NOP_BASE_UTILITY_H_
 
+#include <array>
 #include <cstddef>
 #include <type_traits>
 
@@ -53,6 +54,14 @@ struct IsArithmetic<First, Rest...>
     : std::integral_constant<bool, IsArithmetic<First>::value &&
                                        IsArithmetic<Rest...>::value> {};
 
+// Trait to determine if containers of T accept the BIN encoding when reading,
+// in addition to their default ARY encoding. Writers opt into BIN for these
+// element types with the Binary<Container> wrapper.
+template <typename T>
+struct IsBinaryElement
+    : std::integral_constant<bool, std::is_floating_point<T>::value ||
+                                       std::is_enum<T>::value> {};
+
 // Enable if every entry of Types is an integral type.
 template <typename... Types>
 using EnableIfIntegral =
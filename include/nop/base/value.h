@@ -65,6 +65,11 @@ struct Encoding<T, EnableIfIsValueWrapper<T>> : EncodingIO<T> {
   }
 };
 
+// Value wrappers have the fixed encoded size of the wrapped type, if any.
+template <typename T>
+struct FixedEncodingSize<T, EnableIfIsValueWrapper<T>>
+    : FixedEncodingSize<typename ValueWrapperTraits<T>::Pointer::Type> {};
+
 }  // namespace nop
 
 #endif  // LIBNOP_INCLUDE_NOP_BASE_VALUE_H_
@@ -17,6 +17,9 @@
 #ifndef LIBNOP_INCLUDE_NOP_BASE_VARIANT_H_
 #define LIBNOP_INCLUDE_NOP_BASE_VARIANT_H_
 
+#include <cstddef>
+#include <utility>
+
 #include <nop/base/encoding.h>
 #include <nop/types/variant.h>
 
@@ -73,9 +76,80 @@ struct Encoding<EmptyVariant> : EncodingIO<EmptyVariant> {
   }
 };
 
+namespace detail {
+
+// Dispatches to the encoding of the active element of a Variant through tables
+// of function pointers indexed by Variant::index(). This takes constant time
+// regardless of the number of element types, where Variant::Visit compares the
+// index against each element type in turn. Entry 0 of each table handles the
+// empty Variant, so the tables are indexed by |index + 1|.
+template <typename Type, typename Indices>
+struct VariantDispatch;
+template <typename... Ts, std::size_t... Is>
+struct VariantDispatch<Variant<Ts...>, std::index_sequence<Is...>> {
+  using Type = Variant<Ts...>;
+
+  template <std::size_t I>
+  using Element = std::decay_t<TypeForIndex<I, Ts...>>;
+
+  static std::size_t Size(const Type& value) {
+    using Function = std::size_t (*)(const Type&);
+    static const Function kTable[] = {&SizeEmpty, &SizeElement<Is>...};
+    return kTable[value.index() + 1](value);
+  }
+
+  template <typename Writer>
+  static Status<void> Write(const Type& value, Writer* writer) {
+    using Function = Status<void> (*)(const Type&, Writer*);
+    static const Function kTable[] = {&WriteEmpty<Writer>,
+                                      &WriteElement<Is, Writer>...};
+    return kTable[value.index() + 1](value, writer);
+  }
+
+  template <typename Reader>
+  static Status<void> Read(Type* value, Reader* reader) {
+    using Function = Status<void> (*)(Type*, Reader*);
+    static const Function kTable[] = {&ReadEmpty<Reader>,
+                                      &ReadElement<Is, Reader>...};
+    return kTable[value->index() + 1](value, reader);
+  }
+
+ private:
+  static std::size_t SizeEmpty(const Type& /*value*/) {
+    return Encoding<EmptyVariant>::Size({});
+  }
+  template <std::size_t I>
+  static std::size_t SizeElement(const Type& value) {
+    return Encoding<Element<I>>::Size(*value.template get<I>());
+  }
+
+  template <typename Writer>
+  static Status<void> WriteEmpty(const Type& /*value*/, Writer* writer) {
+    return Encoding<EmptyVariant>::Write({}, writer);
+  }
+  template <std::size_t I, typename Writer>
+  static Status<void> WriteElement(const Type& value, Writer* writer) {
+    return Encoding<Element<I>>::Write(*value.template get<I>(), writer);
+  }
+
+  template <typename Reader>
+  static Status<void> ReadEmpty(Type* /*value*/, Reader* reader) {
+    EmptyVariant empty;
+    return Encoding<EmptyVariant>::Read(&empty, reader);
+  }
+  template <std::size_t I, typename Reader>
+  static Status<void> ReadElement(Type* value, Reader* reader) {
+    return Encoding<Element<I>>::Read(value->template get<I>(), reader);
+  }
+};
+
+}  // namespace detail
+
 template <typename... Ts>
 struct Encoding<Variant<Ts...>> : EncodingIO<Variant<Ts...>> {
   using Type = Variant<Ts...>;
+  using Dispatch =
+      detail::VariantDispatch<Type, std::index_sequence_for<Ts...>>;
 
   static constexpr EncodingByte Prefix(const Type& /*value*/) {
     return EncodingByte::Variant;
@@ -83,11 +157,7 @@ struct Encoding<Variant<Ts...>> : EncodingIO<Variant<Ts...>> {
 
   static constexpr std::size_t Size(const Type& value) {
     return BaseEncodingSize(Prefix(value)) +
-           Encoding<std::int32_t>::Size(value.index()) +
-           value.Visit([](const auto& element) {
-             using Element = typename std::decay<decltype(element)>::type;
-             return Encoding<Element>::Size(element);
-           });
+           Encoding<std::int32_t>::Size(value.index()) + Dispatch::Size(value);
   }
 
   static constexpr bool Match(EncodingByte prefix) {
@@ -102,10 +172,7 @@ struct Encoding<Variant<Ts...>> : EncodingIO<Variant<Ts...>> {
     if (!status)
       return status;
 
-    return value.Visit([writer](const auto& element) {
-      using Element = typename std::decay<decltype(element)>::type;
-      return Encoding<Element>::Write(element, writer);
-    });
+    return Dispatch::Write(value, writer);
   }
 
   template <typename Reader>
@@ -121,11 +188,7 @@ struct Encoding<Variant<Ts...>> : EncodingIO<Variant<Ts...>> {
     }
 
     value->Become(type);
-
-    return value->Visit([reader](auto&& element) {
-      using Element = typename std::decay<decltype(element)>::type;
-      return Encoding<Element>::Read(&element, reader);
-    });
+    return Dispatch::Read(value, reader);
   }
 };
 
@@ -17,11 +17,16 @@
 #ifndef LIBNOP_INCLUDE_NOP_BASE_VECTOR_H_
 #define LIBNOP_INCLUDE_NOP_BASE_VECTOR_H_
 
+#include <cstdint>
 #include <numeric>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
+#include <nop/base/bitset.h>
 #include <nop/base/encoding.h>
 #include <nop/base/utility.h>
+#include <nop/utility/reuse_storage.h>
 
 namespace nop {
 
@@ -45,6 +50,27 @@ namespace nop {
 // Elements are stored as direct little-endian representation of the integral
 // value; each element is sizeof(T) bytes in size.
 //
+// Vectors of floating point and enumeration types are written with the ARY
+// encoding, but the BIN encoding is also accepted when reading, with each
+// element stored as the direct little-endian IEEE 754 representation or the
+// little-endian representation of the underlying integer type, respectively.
+// Writers opt into the BIN encoding for these types with the Binary<T> wrapper.
+//
+// std::vector<bool> is bit-packed in the same format as std::bitset<N>; see
+// base/bitset.h.
+//
+
+namespace detail {
+
+// Reserves storage for up to |size| elements of |value|, bounded by the bytes
+// remaining in |reader|. See ReserveEncodedElements().
+template <typename T, typename Allocator, typename Reader>
+void ReserveElements(std::vector<T, Allocator>* value, SizeType size,
+                     const Reader& reader) {
+  ReserveEncodedElements<MinimumEncodingSize<T>::value>(value, size, reader);
+}
+
+}  // namespace detail
 
 // Specialization for non-integral types.
 template <typename T, typename Allocator>
@@ -57,6 +83,13 @@ struct Encoding<std::vector<T, Allocator>, EnableIfNotIntegral<T>>
   }
 
   static constexpr std::size_t Size(const Type& value) {
+    // Avoid visiting every element when the element size is a constant.
+    if (HasFixedEncodingSize<T>::value) {
+      return BaseEncodingSize(Prefix(value)) +
+             Encoding<SizeType>::Size(value.size()) +
+             value.size() * FixedEncodingSize<T>::value;
+    }
+
     return BaseEncodingSize(Prefix(value)) +
            Encoding<SizeType>::Size(value.size()) +
            std::accumulate(value.cbegin(), value.cend(), 0U,
@@ -66,7 +99,8 @@ struct Encoding<std::vector<T, Allocator>, EnableIfNotIntegral<T>>
   }
 
   static constexpr bool Match(EncodingByte prefix) {
-    return prefix == EncodingByte::Array;
+    return prefix == EncodingByte::Array ||
+           (IsBinaryElement<T>::value && prefix == EncodingByte::Binary);
   }
 
   template <typename Writer>
@@ -87,20 +121,39 @@ struct Encoding<std::vector<T, Allocator>, EnableIfNotIntegral<T>>
   }
 
   template <typename Reader>
-  static constexpr Status<void> ReadPayload(EncodingByte /*prefix*/,
-                                            Type* value, Reader* reader) {
+  static constexpr Status<void> ReadPayload(EncodingByte prefix, Type* value,
+                                            Reader* reader) {
+    if (prefix == EncodingByte::Binary)
+      return ReadBinaryPayload(value, reader, IsBinaryElement<T>{});
+
     SizeType size = 0;
     auto status = Encoding<SizeType>::Read(&size, reader);
     if (!status)
       return status;
 
     // Clear the vector to make sure elements are inserted at the correct
-    // indices. Intentionally avoid calling reserve() to prevent abuse from very
-    // large size values. Regardless of the size specified in the encoding the
-    // bytes remaining in the reader provide a natural upper limit to the number
-    // of allocations.
-    value->clear();
-    for (SizeType i = 0; i < size; i++) {
+    // indices, unless the reader opts into decoding over the existing elements.
+    // Avoid reserving the size from the encoding directly to prevent abuse from
+    // very large size values. Instead, reserve only as many elements as the
+    // bytes remaining in the reader could hold; otherwise the remaining bytes
+    // provide a natural upper limit to the number of allocations.
+    SizeType i = 0;
+    if (ReaderReusesStorage<Reader>::value) {
+      if (value->size() > size)
+        value->erase(value->begin() + size, value->end());
+
+      for (; i < value->size(); i++) {
+        status = Encoding<T>::Read(&(*value)[i], reader);
+        if (!status)
+          return status;
+      }
+    } else {
+      value->clear();
+    }
+
+    detail::ReserveElements(value, size, *reader);
+    ReadFixedElements(&i, size, value, reader, UseFixedElements<Reader>{});
+    for (; i < size; i++) {
       T element;
       status = Encoding<T>::Read(&element, reader);
       if (!status)
@@ -111,11 +164,135 @@ struct Encoding<std::vector<T, Allocator>, EnableIfNotIntegral<T>>
 
     return {};
   }
+
+ private:
+  // Number of elements whose prefixes are checked before their payloads are
+  // decoded, and the distance ahead of the cursor, in blocks, at which the
+  // input is prefetched.
+  enum : std::size_t { kFixedBlockElements = 16, kPrefetchBlocks = 8 };
+  enum : std::size_t { kCacheLineSize = 64 };
+
+  template <typename Reader>
+  using UseFixedElements =
+      std::integral_constant<bool, HasFixedEncodingSize<T>::value &&
+                                       ReaderCanPeek<Reader>::value>;
+
+  // Decodes elements |*index| through |size| - 1 of a vector of fixed size
+  // elements from offsets computed up front, rather than each behind the
+  // cursor advanced by the previous element. Each block of elements is
+  // prefetched several blocks in advance, and the prefixes of a block are
+  // checked before any of its payloads are decoded, so that the loads of
+  // independent elements overlap.
+  //
+  // Stops at the first element that does not occupy exactly the fixed size,
+  // such as a fungible element written with a different encoding, or that
+  // fails to decode, leaving |*index| and the reader at that element for the
+  // general loop to handle.
+  template <typename Reader>
+  static void ReadFixedElements(SizeType* index, SizeType size, Type* value,
+                                Reader* reader, std::true_type) {
+    constexpr std::size_t kElementSize = FixedEncodingSize<T>::value;
+    const SizeType count = size - *index;
+    if (count > SIZE_MAX / kElementSize ||
+        !reader->Ensure(count * kElementSize)) {
+      return;
+    }
+
+    const std::size_t total = count * kElementSize;
+    const void* peeked = nullptr;
+    if (!reader->Peek(total, &peeked))
+      return;
+
+    const std::uint8_t* data = static_cast<const std::uint8_t*>(peeked);
+    std::size_t done = 0;
+    while (done < count) {
+      const std::size_t block =
+          count - done < kFixedBlockElements ? count - done
+                                             : kFixedBlockElements;
+      const std::size_t begin = done * kElementSize;
+      const std::size_t block_size = block * kElementSize;
+
+      const std::size_t ahead =
+          begin + kPrefetchBlocks * kFixedBlockElements * kElementSize;
+      for (std::size_t offset = ahead;
+           offset < ahead + block_size && offset < total;
+           offset += kCacheLineSize) {
+        NOP_PREFETCH(data + offset);
+      }
+
+      EncodingByte prefixes[kFixedBlockElements];
+      std::size_t matched = 0;
+      for (; matched < block; matched++) {
+        prefixes[matched] =
+            static_cast<EncodingByte>(data[begin + matched * kElementSize]);
+        if (!Encoding<T>::Match(prefixes[matched]))
+          break;
+      }
+
+      std::size_t decoded = 0;
+      for (; decoded < matched; decoded++) {
+        Reader element_reader{data + begin + decoded * kElementSize + 1,
+                              kElementSize - 1};
+        T element;
+        auto status = Encoding<T>::ReadPayload(prefixes[decoded], &element,
+                                               &element_reader);
+        if (!status || !element_reader.empty())
+          break;
+
+        value->push_back(std::move(element));
+      }
+
+      done += decoded;
+      if (decoded < block)
+        break;
+    }
+
+    reader->Skip(done * kElementSize);
+    *index += done;
+  }
+
+  template <typename Reader>
+  static void ReadFixedElements(SizeType* /*index*/, SizeType /*size*/,
+                                Type* /*value*/, Reader* /*reader*/,
+                                std::false_type) {}
+
+  // Reads the BIN encoding of a floating point or enumeration vector.
+  template <typename Reader>
+  static constexpr Status<void> ReadBinaryPayload(Type* value,
+                                                  Reader* reader,
+                                                  std::true_type) {
+    SizeType size = 0;
+    auto status = Encoding<SizeType>::Read(&size, reader);
+    if (!status)
+      return status;
+    else if (size % sizeof(T) != 0)
+      return ErrorStatus::InvalidContainerLength;
+
+    // Make sure the reader has enough data to fulfill the requested size as a
+    // defense against abusive or erroneous vector sizes.
+    status = reader->Ensure(size);
+    if (!status)
+      return status;
+
+    const SizeType length = size / sizeof(T);
+    value->resize(length);
+    return ReadElements(value->data(), value->data() + length, reader);
+  }
+
+  // Match() never accepts BIN for other element types.
+  template <typename Reader>
+  static constexpr Status<void> ReadBinaryPayload(Type* /*value*/,
+                                                  Reader* /*reader*/,
+                                                  std::false_type) {
+    return ErrorStatus::UnexpectedEncodingType;
+  }
 };
 
-// Specialization for integral types.
+// Specialization for integral types other than bool.
 template <typename T, typename Allocator>
-struct Encoding<std::vector<T, Allocator>, EnableIfIntegral<T>>
+struct Encoding<
+    std::vector<T, Allocator>,
+    std::enable_if_t<IsIntegral<T>::value && !std::is_same<T, bool>::value>>
     : EncodingIO<std::vector<T, Allocator>> {
   using Type = std::vector<T, Allocator>;
 
@@ -143,7 +320,7 @@ struct Encoding<std::vector<T, Allocator>, EnableIfIntegral<T>>
     if (!status)
       return status;
 
-    return writer->Write(&value[0], &value[length]);
+    return WriteElements(value.data(), value.data() + length, writer);
   }
 
   template <typename Reader>
@@ -161,12 +338,81 @@ struct Encoding<std::vector<T, Allocator>, EnableIfIntegral<T>>
 
     // Make sure the reader has enough data to fulfill the requested size as a
     // defense against abusive or erroneous vector sizes.
-    status = reader->Ensure(length);
+    status = reader->Ensure(size);
     if (!status)
       return status;
 
+    return ReadPayloadElements(
+        value, length, reader,
+        std::integral_constant<bool, sizeof(T) == 1 &&
+                                         ReaderBorrowsToCopy<Reader>::value>{});
+  }
+
+ private:
+  // Copies single byte elements directly from readers that support borrowing,
+  // which avoids initializing the elements before overwriting them. Other
+  // vectors may avoid the initialization with DefaultInitAllocator.
+  template <typename Reader>
+  static Status<void> ReadPayloadElements(Type* value, SizeType length,
+                                          Reader* reader, std::true_type) {
+    const void* data = nullptr;
+    auto status = reader->Borrow(length, &data);
+    if (!status)
+      return status;
+
+    const T* begin = static_cast<const T*>(data);
+    value->assign(begin, begin + length);
+    return {};
+  }
+
+  template <typename Reader>
+  static constexpr Status<void> ReadPayloadElements(Type* value,
+                                                    SizeType length,
+                                                    Reader* reader,
+                                                    std::false_type) {
     value->resize(length);
-    return reader->Read(&(*value)[0], &(*value)[length]);
+    return ReadElements(value->data(), value->data() + length, reader);
+  }
+};
+
+// Specialization for bool, which is bit-packed.
+template <typename Allocator>
+struct Encoding<std::vector<bool, Allocator>>
+    : EncodingIO<std::vector<bool, Allocator>> {
+  using Type = std::vector<bool, Allocator>;
+
+  static constexpr EncodingByte Prefix(const Type& /*value*/) {
+    return EncodingByte::Binary;
+  }
+
+  static std::size_t Size(const Type& value) {
+    return detail::BitEncodingSize(value.size());
+  }
+
+  static constexpr bool Match(EncodingByte prefix) {
+    return prefix == EncodingByte::Binary;
+  }
+
+  template <typename Writer>
+  static Status<void> WritePayload(EncodingByte /*prefix*/, const Type& value,
+                                   Writer* writer) {
+    return detail::WriteBits(
+        value.size(), [&value](SizeType index) { return value[index]; },
+        writer);
+  }
+
+  template <typename Reader>
+  static Status<void> ReadPayload(EncodingByte /*prefix*/, Type* value,
+                                  Reader* reader) {
+    auto count = detail::ReadBitCount(reader);
+    if (!count)
+      return count.error();
+
+    value->resize(count.get());
+    return detail::ReadBits(
+        count.get(),
+        [value](SizeType index, bool flag) { (*value)[index] = flag; },
+        reader);
   }
 };
 
@@ -0,0 +1,169 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_BASE_VIEW_H_
+#define LIBNOP_INCLUDE_NOP_BASE_VIEW_H_
+
+#include <nop/base/encoding.h>
+#include <nop/types/view.h>
+
+namespace nop {
+
+//
+// BinaryView<T> encoding format:
+//
+// +-----+---------+---//----+
+// | BIN | INT64:L | L BYTES |
+// +-----+---------+---//----+
+//
+// Where L = N * sizeof(T). This is the same format as std::vector<T> for
+// integral T.
+//
+// StringView encoding format:
+//
+// +-----+---------+---//----+
+// | STR | INT64:N | N BYTES |
+// +-----+---------+---//----+
+//
+// This is the same format as std::string.
+//
+// Deserializing a view requires a reader that provides the following method,
+// which returns a pointer to the next |size| bytes of input and advances past
+// them:
+//
+//   Status<void> Borrow(std::size_t size, const void** data);
+//
+// The returned memory must remain valid for as long as the views decoded from
+// it are used.
+//
+// Borrowed elements reference the input directly and therefore remain in the
+// little-endian byte order of the wire format. On big-endian hosts, views of
+// multi-byte elements must be converted with HostEndian<T>::FromLittle()
+// before use.
+//
+
+template <typename T>
+struct Encoding<BinaryView<T>> : EncodingIO<BinaryView<T>> {
+  using Type = BinaryView<T>;
+
+  static constexpr EncodingByte Prefix(const Type& /*value*/) {
+    return EncodingByte::Binary;
+  }
+
+  static constexpr std::size_t Size(const Type& value) {
+    const SizeType size = value.size_bytes();
+    return BaseEncodingSize(Prefix(value)) + Encoding<SizeType>::Size(size) +
+           size;
+  }
+
+  static constexpr bool Match(EncodingByte prefix) {
+    return prefix == EncodingByte::Binary;
+  }
+
+  template <typename Writer>
+  static constexpr Status<void> WritePayload(EncodingByte /*prefix*/,
+                                             const Type& value,
+                                             Writer* writer) {
+    auto status = Encoding<SizeType>::Write(value.size_bytes(), writer);
+    if (!status)
+      return status;
+
+    return WriteElements(value.begin(), value.end(), writer);
+  }
+
+  template <typename Reader>
+  static constexpr Status<void> ReadPayload(EncodingByte /*prefix*/,
+                                            Type* value, Reader* reader) {
+    static_assert(ReaderCanBorrow<Reader>::value,
+                  "Decoding a view requires a reader that provides Borrow().");
+
+    SizeType size = 0;
+    auto status = Encoding<SizeType>::Read(&size, reader);
+    if (!status)
+      return status;
+    else if (size % sizeof(T) != 0)
+      return ErrorStatus::InvalidContainerLength;
+
+    status = reader->Ensure(size);
+    if (!status)
+      return status;
+
+    const void* data = nullptr;
+    status = reader->Borrow(size, &data);
+    if (!status)
+      return status;
+
+    *value = Type{static_cast<const T*>(data), size / sizeof(T)};
+    return {};
+  }
+};
+
+template <>
+struct Encoding<StringView> : EncodingIO<StringView> {
+  using Type = StringView;
+
+  static constexpr EncodingByte Prefix(const Type& /*value*/) {
+    return EncodingByte::String;
+  }
+
+  static constexpr std::size_t Size(const Type& value) {
+    return BaseEncodingSize(Prefix(value)) +
+           Encoding<SizeType>::Size(value.size()) + value.size();
+  }
+
+  static constexpr bool Match(EncodingByte prefix) {
+    return prefix == EncodingByte::String;
+  }
+
+  template <typename Writer>
+  static constexpr Status<void> WritePayload(EncodingByte /*prefix*/,
+                                             const Type& value,
+                                             Writer* writer) {
+    auto status = Encoding<SizeType>::Write(value.size(), writer);
+    if (!status)
+      return status;
+
+    return writer->Write(value.begin(), value.end());
+  }
+
+  template <typename Reader>
+  static constexpr Status<void> ReadPayload(EncodingByte /*prefix*/,
+                                            Type* value, Reader* reader) {
+    static_assert(ReaderCanBorrow<Reader>::value,
+                  "Decoding a view requires a reader that provides Borrow().");
+
+    SizeType size = 0;
+    auto status = Encoding<SizeType>::Read(&size, reader);
+    if (!status)
+      return status;
+
+    status = reader->Ensure(size);
+    if (!status)
+      return status;
+
+    const void* data = nullptr;
+    status = reader->Borrow(size, &data);
+    if (!status)
+      return status;
+
+    *value = Type{static_cast<const char*>(data), size};
+    return {};
+  }
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_BASE_VIEW_H_
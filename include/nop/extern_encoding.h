@@ -0,0 +1,85 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_EXTERN_ENCODING_H_
+#define LIBNOP_INCLUDE_NOP_EXTERN_ENCODING_H_
+
+#include <type_traits>
+
+#include <nop/serializer.h>
+
+namespace nop {
+
+//
+// By default the encoders of a type are instantiated in every translation unit
+// that serializes or deserializes the type, and the linker keeps one of the
+// identical copies. Compilers inline the encoders into each caller however,
+// duplicating the code of large types throughout the binary. The following
+// macros compile the encoders of a type for a given writer and reader in one
+// translation unit and call them from the others.
+//
+// Example:
+//
+//  // capabilities.h
+//  struct Capabilities {
+//    ...
+//    NOP_STRUCTURE(Capabilities, ...);
+//  };
+//
+//  NOP_DECLARE_ENCODING(Capabilities, nop::StreamWriter<std::ostream*>,
+//                       nop::StreamReader<std::istream*>);
+//
+//  // capabilities.cpp
+//  #include "capabilities.h"
+//
+//  NOP_INSTANTIATE_ENCODING(Capabilities, nop::StreamWriter<std::ostream*>,
+//                           nop::StreamReader<std::istream*>);
+//
+// Both macros must be invoked at global scope. NOP_DECLARE_ENCODING must
+// follow the definition of the type and precede every use of its encoding, so
+// it belongs in the header that defines the type. Only the encoding of the
+// type itself with the named writer and reader is shared; writers that wrap
+// these, such as the BoundedWriter used for table entries, are instantiated
+// as usual. Constant evaluation always uses the encoders inline. Arguments
+// that contain commas must be passed through an alias.
+//
+// Combined with the type-erased AnyWriter, a type used on cold paths is
+// compiled once for every writer.
+//
+
+#define NOP_DECLARE_ENCODING(type, writer, reader)                           \
+  namespace nop {                                                            \
+  template <>                                                                \
+  struct ExternWriteEncoding<type, writer> : std::true_type {};              \
+  template <>                                                                \
+  struct ExternReadEncoding<type, reader> : std::true_type {};               \
+  extern template Status<void> EncodingIO<type>::WriteExtern<writer>(        \
+      const type&, writer*);                                                 \
+  extern template Status<void> EncodingIO<type>::ReadExtern<reader>(type*,   \
+                                                                    reader*); \
+  }  // namespace nop
+
+#define NOP_INSTANTIATE_ENCODING(type, writer, reader)                        \
+  namespace nop {                                                             \
+  template Status<void> EncodingIO<type>::WriteExtern<writer>(const type&,    \
+                                                              writer*);       \
+  template Status<void> EncodingIO<type>::ReadExtern<reader>(type*, reader*); \
+  }  // namespace nop
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_EXTERN_ENCODING_H_
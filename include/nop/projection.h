@@ -0,0 +1,75 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_PROJECTION_H_
+#define LIBNOP_INCLUDE_NOP_PROJECTION_H_
+
+#include <nop/base/macros.h>
+#include <nop/structure.h>
+#include <nop/types/detail/member_pointer.h>
+
+namespace nop {
+
+//
+// Projections deserialize a subset of the members of a user-defined structure.
+// The members in the projection are decoded into the target structure, while
+// the encodings of the other members are skipped without being decoded. The
+// skipped members of the target are left untouched.
+//
+// Projection types are defined with the NOP_PROJECTION(type, members...) macro,
+// which takes the same member syntax as NOP_STRUCTURE. The macro must be used
+// where the members are accessible. Projections only support deserialization.
+//
+// Example:
+//
+//   struct Event {
+//     std::uint64_t timestamp;
+//     std::string source;
+//     std::vector<std::uint8_t> payload;
+//     std::uint32_t kind;
+//
+//     NOP_STRUCTURE(Event, timestamp, source, payload, kind);
+//   };
+//
+//   using EventSummary = NOP_PROJECTION(Event, timestamp, kind);
+//
+//   Event event;
+//   EventSummary summary{&event};
+//   auto status = deserializer.Read(&summary);
+//
+template <typename T, typename Members>
+class Projection {
+ public:
+  constexpr Projection() = default;
+  constexpr Projection(const Projection&) = default;
+  constexpr Projection(T* value) : value_{value} {}
+
+  constexpr Projection& operator=(const Projection&) = default;
+
+  constexpr T* get() const { return value_; }
+
+ private:
+  T* value_{nullptr};
+};
+
+// Defines the projection type of the given structure type and members.
+#define NOP_PROJECTION(type, ... /*members*/) \
+  ::nop::Projection<type,                      \
+                    ::nop::MemberList<_NOP_MEMBER_LIST(type, __VA_ARGS__)>>
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_PROJECTION_H_
@@ -0,0 +1,98 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_RPC_ASYNC_METHOD_RECEIVER_H_
+#define LIBNOP_INCLUDE_NOP_RPC_ASYNC_METHOD_RECEIVER_H_
+
+#include <cstdint>
+#include <tuple>
+
+#include <nop/status.h>
+
+namespace nop {
+
+// AsyncMethodReceiver is an implementation of the Receiver type required by the
+// remote interface support in nop/rpc/interface.h that serves calls sent by
+// AsyncMethodSender. It reads the request id that precedes each method
+// selector and tags the return value with it, so that the sender can match
+// replies to calls regardless of the order in which they are sent.
+//
+// Example of serving calls with a dispatch table:
+//
+//   AsyncMethodReceiver<Serializer<FdWriter>, Deserializer<FdReader>> receiver{
+//       &serializer, &deserializer};
+//   while (true) {
+//     auto status = dispatcher(&receiver);
+//     if (!status)
+//       break;
+//   }
+//
+template <typename Serializer, typename Deserializer>
+class AsyncMethodReceiver {
+ public:
+  constexpr AsyncMethodReceiver(Serializer* serializer,
+                                Deserializer* deserializer)
+      : serializer_{serializer}, deserializer_{deserializer} {}
+
+  template <typename MethodSelector>
+  Status<void> GetMethodSelector(MethodSelector* method_selector) {
+    auto status = deserializer_->Read(&request_id_);
+    if (!status)
+      return status;
+
+    return deserializer_->Read(method_selector);
+  }
+
+  template <typename... Args>
+  Status<void> GetArgs(std::tuple<Args...>* args) {
+    return deserializer_->Read(args);
+  }
+
+  template <typename Return>
+  Status<void> SendReturn(const Return& return_value) {
+    auto status = serializer_->Write(request_id_);
+    if (!status)
+      return status;
+
+    return serializer_->Write(return_value);
+  }
+
+  // Sends the reply of a method that returns void.
+  Status<void> SendReturn() { return serializer_->Write(request_id_); }
+
+  // Returns the request id of the call being dispatched.
+  std::uint64_t request_id() const { return request_id_; }
+
+  const Serializer& serializer() const { return *serializer_; }
+  Serializer& serializer() { return *serializer_; }
+  const Deserializer& deserializer() const { return *deserializer_; }
+  Deserializer& deserializer() { return *deserializer_; }
+
+ private:
+  Serializer* serializer_;
+  Deserializer* deserializer_;
+  std::uint64_t request_id_{0};
+};
+
+template <typename Serializer, typename Deserializer>
+AsyncMethodReceiver<Serializer, Deserializer> MakeAsyncMethodReceiver(
+    Serializer* serializer, Deserializer* deserializer) {
+  return {serializer, deserializer};
+}
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_RPC_ASYNC_METHOD_RECEIVER_H_
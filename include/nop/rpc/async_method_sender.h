@@ -0,0 +1,256 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_RPC_ASYNC_METHOD_SENDER_H_
+#define LIBNOP_INCLUDE_NOP_RPC_ASYNC_METHOD_SENDER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+
+#include <nop/status.h>
+
+namespace nop {
+
+//
+// Asynchronous RPC message format:
+//
+// Request: | U64: request id | method selector | arguments tuple |
+// Reply:   | U64: request id | return value |
+//
+// Each element is a separate message written to the serializer of the channel.
+// Replies may arrive in any order and are matched to their calls by request
+// id. Methods that return void reply with only the request id.
+//
+
+namespace detail {
+
+// Completes an asynchronous call by invoking |callback| with the return value
+// read from |deserializer|, or with |error| when |deserializer| is nullptr.
+// Returns the error of the deserializer, if any.
+template <typename Deserializer, typename Return, typename Callback>
+struct ReplyHandler {
+  Callback callback;
+
+  Status<void> operator()(Deserializer* deserializer, ErrorStatus error) {
+    if (deserializer == nullptr) {
+      callback(Status<Return>{error});
+      return {};
+    }
+
+    Return return_value;
+    auto status = deserializer->Read(&return_value);
+    if (!status) {
+      callback(Status<Return>{status.error()});
+      return status;
+    }
+
+    callback(Status<Return>{std::move(return_value)});
+    return {};
+  }
+};
+
+template <typename Deserializer, typename Callback>
+struct ReplyHandler<Deserializer, void, Callback> {
+  Callback callback;
+
+  Status<void> operator()(Deserializer* deserializer, ErrorStatus error) {
+    if (deserializer == nullptr)
+      callback(Status<void>{error});
+    else
+      callback(Status<void>{});
+    return {};
+  }
+};
+
+}  // namespace detail
+
+// AsyncMethodSender is an implementation of the Sender type required by the
+// remote interface support in nop/rpc/interface.h that allows any number of
+// calls to be in flight on the same channel at once. Calls made through
+// InterfaceMethod::InvokeAsync() are tagged with a request id and written
+// immediately, without waiting for the reply to the previous call, and return
+// a future or invoke a callback once the matching reply is received.
+//
+// Replies are read by calling ReceiveReply(), typically in a loop on a thread
+// dedicated to reading the channel. Calls may be sent from any number of
+// threads concurrently. The remote side uses AsyncMethodReceiver.
+//
+// Example:
+//
+//   AsyncMethodSender<Serializer<FdWriter>, Deserializer<FdReader>> sender{
+//       &serializer, &deserializer};
+//   std::thread reader{[&sender] {
+//     while (sender.ReceiveReply()) {
+//     }
+//     sender.Cancel(ErrorStatus::IOError);
+//   }};
+//
+//   auto first = Calculator::Sum::InvokeAsync(&sender, 1, 2);
+//   auto second = Calculator::Sum::InvokeAsync(&sender, 3, 4);
+//   Status<int> result = first.get();
+//
+template <typename Serializer, typename Deserializer>
+class AsyncMethodSender {
+ public:
+  // The future type returned by InterfaceMethod::InvokeAsync() for methods
+  // returning Return.
+  template <typename Return>
+  using Future = std::future<Status<Return>>;
+
+  AsyncMethodSender(Serializer* serializer, Deserializer* deserializer)
+      : serializer_{serializer}, deserializer_{deserializer} {}
+
+  AsyncMethodSender(const AsyncMethodSender&) = delete;
+  void operator=(const AsyncMethodSender&) = delete;
+
+  // Sends a call and returns a future that completes with the reply.
+  template <typename Return, typename MethodSelector, typename... Args>
+  Future<Return> SendMethodAsync(MethodSelector method_selector,
+                                 const std::tuple<Args...>& args) {
+    auto promise = std::make_shared<std::promise<Status<Return>>>();
+    Future<Return> future = promise->get_future();
+    SendMethodAsync<Return>(method_selector, args,
+                            [promise](Status<Return> return_value) {
+                              promise->set_value(std::move(return_value));
+                            });
+    return future;
+  }
+
+  // Sends a call and invokes |callback| with the Status<Return> of the call
+  // when the reply is received or the call fails. The callback is invoked
+  // exactly once, on the thread that calls ReceiveReply() or Cancel(), or on
+  // the calling thread if the call cannot be sent.
+  template <typename Return, typename MethodSelector, typename... Args,
+            typename Callback>
+  void SendMethodAsync(MethodSelector method_selector,
+                       const std::tuple<Args...>& args, Callback&& callback) {
+    using ReplyHandler =
+        detail::ReplyHandler<Deserializer, Return, std::decay_t<Callback>>;
+
+    // Register the call before sending it, since the reply may be received
+    // before the request is completely written.
+    std::uint64_t request_id;
+    {
+      std::lock_guard<std::mutex> lock{pending_mutex_};
+      request_id = next_request_id_++;
+      pending_.emplace(request_id,
+                       ReplyHandler{std::forward<Callback>(callback)});
+    }
+
+    Status<void> status;
+    {
+      std::lock_guard<std::mutex> lock{send_mutex_};
+      status = serializer_->Write(request_id);
+      if (status)
+        status = serializer_->Write(method_selector);
+      if (status)
+        status = serializer_->Write(args);
+    }
+
+    if (!status)
+      Fail(request_id, status.error());
+  }
+
+  // Reads one reply from the deserializer and completes the matching call.
+  // Returns ErrorStatus::ProtocolError if the reply does not match a pending
+  // call, or the error of the deserializer. After an error, the position of the
+  // deserializer in the stream is undefined and the pending calls should be
+  // failed with Cancel().
+  Status<void> ReceiveReply() {
+    std::uint64_t request_id;
+    auto status = deserializer_->Read(&request_id);
+    if (!status)
+      return status;
+
+    Handler handler;
+    {
+      std::lock_guard<std::mutex> lock{pending_mutex_};
+      auto search = pending_.find(request_id);
+      if (search == pending_.end())
+        return ErrorStatus::ProtocolError;
+
+      handler = std::move(search->second);
+      pending_.erase(search);
+    }
+
+    return handler(deserializer_, ErrorStatus::None);
+  }
+
+  // Fails all pending calls with |error|, for example after the channel is
+  // disconnected.
+  void Cancel(ErrorStatus error) {
+    std::unordered_map<std::uint64_t, Handler> pending;
+    {
+      std::lock_guard<std::mutex> lock{pending_mutex_};
+      pending.swap(pending_);
+    }
+
+    for (auto& entry : pending)
+      entry.second(nullptr, error);
+  }
+
+  // Returns the number of calls waiting for a reply.
+  std::size_t pending() const {
+    std::lock_guard<std::mutex> lock{pending_mutex_};
+    return pending_.size();
+  }
+
+  const Serializer& serializer() const { return *serializer_; }
+  Serializer& serializer() { return *serializer_; }
+  const Deserializer& deserializer() const { return *deserializer_; }
+  Deserializer& deserializer() { return *deserializer_; }
+
+ private:
+  // Completes a call, either by reading the return value from |deserializer|,
+  // or with |error| when |deserializer| is nullptr.
+  using Handler = std::function<Status<void>(Deserializer*, ErrorStatus)>;
+
+  void Fail(std::uint64_t request_id, ErrorStatus error) {
+    Handler handler;
+    {
+      std::lock_guard<std::mutex> lock{pending_mutex_};
+      auto search = pending_.find(request_id);
+
+      // The call may have been canceled concurrently.
+      if (search == pending_.end())
+        return;
+
+      handler = std::move(search->second);
+      pending_.erase(search);
+    }
+
+    handler(nullptr, error);
+  }
+
+  Serializer* serializer_;
+  Deserializer* deserializer_;
+
+  std::mutex send_mutex_;
+  mutable std::mutex pending_mutex_;
+  std::uint64_t next_request_id_{0};
+  std::unordered_map<std::uint64_t, Handler> pending_;
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_RPC_ASYNC_METHOD_SENDER_H_
@@ -0,0 +1,105 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_RPC_BATCH_METHOD_RECEIVER_H_
+#define LIBNOP_INCLUDE_NOP_RPC_BATCH_METHOD_RECEIVER_H_
+
+#include <cstdint>
+#include <tuple>
+
+#include <nop/rpc/batch_method_sender.h>
+#include <nop/status.h>
+
+namespace nop {
+
+// BatchMethodReceiver serves the batched calls sent by BatchMethodSender. A
+// batch is dispatched through an InterfaceBindings dispatch table, with this
+// class acting as the Receiver for each call, and the return values are
+// collected into one reply that is written to the transport with a single
+// write.
+//
+// If a call fails to dispatch, for example because its method is not bound,
+// the rest of the batch cannot be decoded. The error is returned without a
+// reply and the connection should be closed.
+//
+// Example:
+//
+//   BatchMethodReceiver<Serializer<FdWriter>, Deserializer<FdReader>> receiver{
+//       &serializer, &deserializer};
+//   while (receiver.DispatchBatch(dispatcher)) {
+//   }
+//
+template <typename Serializer, typename Deserializer>
+class BatchMethodReceiver {
+ public:
+  BatchMethodReceiver(Serializer* serializer, Deserializer* deserializer)
+      : serializer_{serializer}, deserializer_{deserializer} {}
+
+  BatchMethodReceiver(const BatchMethodReceiver&) = delete;
+  void operator=(const BatchMethodReceiver&) = delete;
+
+  // Reads one batch, dispatches each call in it with |dispatcher| and the
+  // given passthrough arguments, and writes the reply.
+  template <typename Dispatcher, typename... Passthrough>
+  Status<void> DispatchBatch(const Dispatcher& dispatcher,
+                             Passthrough&&... passthrough) {
+    std::uint64_t count;
+    auto status = deserializer_->Read(&count);
+    if (!status)
+      return status;
+
+    replies_.Reset();
+    for (std::uint64_t i = 0; i < count; i++) {
+      status = dispatcher(this, passthrough...);
+      if (!status)
+        return status;
+    }
+
+    return replies_.WriteTo(&serializer_->writer(), count);
+  }
+
+  template <typename MethodSelector>
+  Status<void> GetMethodSelector(MethodSelector* method_selector) {
+    return deserializer_->Read(method_selector);
+  }
+
+  template <typename... Args>
+  Status<void> GetArgs(std::tuple<Args...>* args) {
+    return deserializer_->Read(args);
+  }
+
+  template <typename Return>
+  Status<void> SendReturn(const Return& return_value) {
+    return replies_.Append(return_value);
+  }
+
+  // Sends the reply of a method that returns void.
+  Status<void> SendReturn() { return {}; }
+
+  const Serializer& serializer() const { return *serializer_; }
+  Serializer& serializer() { return *serializer_; }
+  const Deserializer& deserializer() const { return *deserializer_; }
+  Deserializer& deserializer() { return *deserializer_; }
+
+ private:
+  Serializer* serializer_;
+  Deserializer* deserializer_;
+  detail::BatchBuffer replies_;
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_RPC_BATCH_METHOD_RECEIVER_H_
@@ -0,0 +1,233 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_RPC_BATCH_METHOD_SENDER_H_
+#define LIBNOP_INCLUDE_NOP_RPC_BATCH_METHOD_SENDER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <nop/base/serializer.h>
+#include <nop/rpc/async_method_sender.h>
+#include <nop/status.h>
+#include <nop/utility/buffer_writer.h>
+#include <nop/utility/vector_writer.h>
+
+namespace nop {
+
+//
+// Batched RPC message format:
+//
+// Request: | U64: N | N * (method selector, arguments tuple) |
+// Reply:   | U64: N | N * return value |
+//
+// The return values are in the order of the calls in the request. Methods that
+// return void contribute nothing to the reply besides the count.
+//
+
+namespace detail {
+
+// Buffer that accumulates the elements of a batch after space reserved for the
+// count, so that the count and the elements are written to the transport with
+// a single call to the writer.
+class BatchBuffer {
+ public:
+  // Largest encoding of the count: a prefix byte and a 64-bit payload.
+  enum : std::size_t { kMaxHeaderSize = 9 };
+
+  BatchBuffer() { Reset(); }
+
+  void Reset() {
+    writer_.Reset();
+    writer_.Prepare(kMaxHeaderSize);
+    writer_.Skip(kMaxHeaderSize);
+  }
+
+  // Serializes |value| as the next element of the batch.
+  template <typename T>
+  Status<void> Append(const T& value) {
+    return Serializer<VectorWriter*>{&writer_}.Write(value);
+  }
+
+  // Discards the elements appended after the batch had |size| bytes.
+  void Truncate(std::size_t size) { writer_.Truncate(kMaxHeaderSize + size); }
+
+  // Writes the count followed by the elements of the batch to |writer|.
+  template <typename Writer>
+  Status<void> WriteTo(Writer* writer, std::uint64_t count) {
+    const std::size_t header_size = Encoding<std::uint64_t>::Size(count);
+    std::uint8_t* begin = writer_.data() + kMaxHeaderSize - header_size;
+    BufferWriter header_writer{begin, header_size};
+    auto status = Encoding<std::uint64_t>::Write(count, &header_writer);
+    if (!status)
+      return status;
+
+    const std::uint8_t* end = writer_.data() + writer_.size();
+    status = writer->Prepare(end - begin);
+    if (!status)
+      return status;
+
+    return writer->Write(begin, end);
+  }
+
+  bool empty() const { return writer_.size() == kMaxHeaderSize; }
+  std::size_t size() const { return writer_.size() - kMaxHeaderSize; }
+
+ private:
+  VectorWriter writer_;
+};
+
+}  // namespace detail
+
+// BatchMethodSender is an implementation of the Sender type required by the
+// remote interface support in nop/rpc/interface.h that coalesces many calls
+// into one request. Calls made through InterfaceMethod::InvokeAsync() are
+// serialized into an internal buffer; Flush() writes the whole batch to the
+// transport with a single write, reads the single reply and completes the
+// calls in order. The remote side uses BatchMethodReceiver.
+//
+// A batch is flushed automatically when it reaches the maximum number of calls
+// passed to the constructor. When a batch fails, every call in it completes
+// with the error. This class is not thread safe.
+//
+// Example:
+//
+//   BatchMethodSender<Serializer<FdWriter>, Deserializer<FdReader>> sender{
+//       &serializer, &deserializer};
+//   std::vector<BatchMethodSender<...>::Future<bool>> results;
+//   for (const auto& route : routes)
+//     results.push_back(Control::AddRoute::InvokeAsync(&sender, route));
+//
+//   auto status = sender.Flush();
+//
+template <typename Serializer, typename Deserializer>
+class BatchMethodSender {
+ public:
+  // Default number of calls after which a batch is flushed.
+  enum : std::size_t { kDefaultMaxCalls = 256 };
+
+  // The future type returned by InterfaceMethod::InvokeAsync() for methods
+  // returning Return.
+  template <typename Return>
+  using Future = std::future<Status<Return>>;
+
+  BatchMethodSender(Serializer* serializer, Deserializer* deserializer,
+                    std::size_t max_calls = kDefaultMaxCalls)
+      : serializer_{serializer},
+        deserializer_{deserializer},
+        max_calls_{max_calls > 0 ? max_calls : 1} {}
+
+  BatchMethodSender(const BatchMethodSender&) = delete;
+  void operator=(const BatchMethodSender&) = delete;
+
+  // Adds a call to the batch and returns a future that completes when the
+  // batch is flushed.
+  template <typename Return, typename MethodSelector, typename... Args>
+  Future<Return> SendMethodAsync(MethodSelector method_selector,
+                                 const std::tuple<Args...>& args) {
+    auto promise = std::make_shared<std::promise<Status<Return>>>();
+    Future<Return> future = promise->get_future();
+    SendMethodAsync<Return>(method_selector, args,
+                            [promise](Status<Return> return_value) {
+                              promise->set_value(std::move(return_value));
+                            });
+    return future;
+  }
+
+  // Adds a call to the batch and invokes |callback| with the Status<Return> of
+  // the call when the batch is flushed.
+  template <typename Return, typename MethodSelector, typename... Args,
+            typename Callback>
+  void SendMethodAsync(MethodSelector method_selector,
+                       const std::tuple<Args...>& args, Callback&& callback) {
+    using ReplyHandler =
+        detail::ReplyHandler<Deserializer, Return, std::decay_t<Callback>>;
+
+    // Roll back a partially serialized call.
+    const std::size_t batch_size = batch_.size();
+    auto status = batch_.Append(method_selector);
+    if (status)
+      status = batch_.Append(args);
+    if (!status) {
+      batch_.Truncate(batch_size);
+      callback(Status<Return>{status.error()});
+      return;
+    }
+
+    handlers_.emplace_back(ReplyHandler{std::forward<Callback>(callback)});
+    if (handlers_.size() >= max_calls_)
+      Flush();
+  }
+
+  // Sends the batched calls, waits for the reply and completes the calls.
+  // Returns the first error of the transport or of decoding the reply.
+  Status<void> Flush() {
+    if (handlers_.empty())
+      return {};
+
+    // Take the calls first, so that callbacks may start the next batch.
+    std::vector<Handler> handlers;
+    handlers.swap(handlers_);
+
+    auto status = batch_.WriteTo(&serializer_->writer(), handlers.size());
+    batch_.Reset();
+
+    std::uint64_t count = 0;
+    if (status)
+      status = deserializer_->Read(&count);
+    if (status && count != handlers.size())
+      status = ErrorStatus::ProtocolError;
+
+    for (auto& handler : handlers) {
+      if (status)
+        status = handler(deserializer_, ErrorStatus::None);
+      else
+        handler(nullptr, status.error());
+    }
+
+    return status;
+  }
+
+  // Returns the number of calls in the current batch.
+  std::size_t pending() const { return handlers_.size(); }
+
+  // Returns the size of the serialized calls in the current batch.
+  std::size_t batch_size() const { return batch_.size(); }
+
+  const Serializer& serializer() const { return *serializer_; }
+  Serializer& serializer() { return *serializer_; }
+  const Deserializer& deserializer() const { return *deserializer_; }
+  Deserializer& deserializer() { return *deserializer_; }
+
+ private:
+  using Handler = std::function<Status<void>(Deserializer*, ErrorStatus)>;
+
+  Serializer* serializer_;
+  Deserializer* deserializer_;
+  std::size_t max_calls_;
+  detail::BatchBuffer batch_;
+  std::vector<Handler> handlers_;
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_RPC_BATCH_METHOD_SENDER_H_
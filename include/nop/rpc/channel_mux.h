@@ -0,0 +1,416 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_RPC_CHANNEL_MUX_H_
+#define LIBNOP_INCLUDE_NOP_RPC_CHANNEL_MUX_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <nop/base/serializer.h>
+#include <nop/status.h>
+#include <nop/types/view.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/vector_writer.h>
+
+namespace nop {
+
+//
+// Multiplexed channel frame format:
+//
+// | U32: channel id | U32: credit | BIN: message |
+//
+// Each element is a separate value written to the serializer of the transport.
+// The credit field returns that many bytes of window on the channel to the
+// receiver of the frame, and the message, when not empty, is counted against
+// the window of the sender of the frame. Frames that only return credit carry
+// an empty message.
+//
+
+// ChannelMux carries any number of logical channels over a single transport,
+// given as the serializer and deserializer of a connection. Each channel is a
+// bidirectional sequence of messages identified by a channel id that both ends
+// of the connection open, and implements both the Sender and the Receiver
+// types required by the remote interface support in nop/rpc/interface.h, so
+// each channel may dispatch a different set of InterfaceBindings.
+//
+// Frames are read from the transport by calling Receive(), typically in a loop
+// on a thread dedicated to reading the connection, which queues the messages
+// on their channels. Channels may be used from any number of other threads
+// concurrently, but each channel carries one call at a time, in the same way
+// as SimpleMethodSender and SimpleMethodReceiver.
+//
+// Flow control is credit based and per channel: a sender may have at most
+// |window| bytes of messages that the receiver has not consumed, and blocks
+// until the receiver returns credit. A slow consumer on one channel therefore
+// never stops the other channels of the connection from making progress.
+// Credit is returned when a channel has no more queued messages or when half of
+// the window has been consumed, either in a credit-only frame or with the next
+// message sent on the channel.
+//
+// Example:
+//
+//   ChannelMux<Serializer<FdWriter>, Deserializer<FdReader>> mux{
+//       &serializer, &deserializer};
+//   std::thread reader{[&mux] {
+//     while (mux.Receive()) {
+//     }
+//     mux.Close(ErrorStatus::IOError);
+//   }};
+//
+//   // Client:
+//   auto* calculator = mux.Open(kCalculatorChannel);
+//   Status<int> sum = Calculator::Sum::Invoke(calculator, 1, 2);
+//
+//   // Server:
+//   auto* calculator = mux.Open(kCalculatorChannel);
+//   auto dispatcher = BindCalculator();
+//   while (dispatcher(calculator)) {
+//   }
+//
+template <typename Serializer, typename Deserializer>
+class ChannelMux {
+ public:
+  // Default size of the window of each channel, in bytes.
+  enum : std::size_t { kDefaultWindow = 64 * 1024 };
+
+  // Deserializer of the values of a single message.
+  using MessageDeserializer = ::nop::Deserializer<BufferReader>;
+
+  // A logical channel of the connection.
+  class Channel {
+   public:
+    Channel(const Channel&) = delete;
+    void operator=(const Channel&) = delete;
+
+    // Sender interface: sends the call as one message and, for methods that
+    // return a value, waits for the reply message.
+    template <typename MethodSelector, typename Return, typename... Args>
+    void SendMethod(MethodSelector method_selector,
+                    Status<Return>* return_value,
+                    const std::tuple<Args...>& args) {
+      auto status = Send(method_selector, args);
+      if (!status) {
+        *return_value = status.error();
+        return;
+      }
+
+      GetReturn(return_value);
+    }
+
+    // Receiver interface: waits for the next call and reads its selector.
+    template <typename MethodSelector>
+    Status<void> GetMethodSelector(MethodSelector* method_selector) {
+      auto status = Next();
+      if (!status)
+        return status;
+
+      return message_deserializer_.Read(method_selector);
+    }
+
+    // Receiver interface: reads the arguments of the current call.
+    template <typename... Args>
+    Status<void> GetArgs(std::tuple<Args...>* args) {
+      return message_deserializer_.Read(args);
+    }
+
+    // Receiver interface: sends the reply to the current call.
+    template <typename Return>
+    Status<void> SendReturn(const Return& return_value) {
+      return Send(return_value);
+    }
+
+    // Serializes |values| and sends them as one message, waiting for enough
+    // credit. Returns ErrorStatus::WriteLimitReached if the message is larger
+    // than the window, or the error passed to ChannelMux::Close().
+    template <typename... Ts>
+    Status<void> Send(const Ts&... values) {
+      std::lock_guard<std::mutex> lock{send_mutex_};
+      buffer_.Reset();
+      auto status = WriteAll(&buffer_, values...);
+      if (!status)
+        return status;
+
+      status = mux_->Acquire(this, buffer_.size());
+      if (!status)
+        return status;
+
+      return mux_->SendFrame(this, BinaryView<std::uint8_t>{
+                                       buffer_.data(), buffer_.size()});
+    }
+
+    // Waits for the next message on the channel and returns a deserializer
+    // that reads its values. The deserializer remains valid until the next
+    // call to Next(), GetMethodSelector() or SendMethod().
+    Status<MessageDeserializer*> Receive() {
+      auto status = Next();
+      if (!status)
+        return status.error();
+
+      return &message_deserializer_;
+    }
+
+    std::uint32_t id() const { return id_; }
+
+    // Returns the number of bytes this end may send before waiting for credit.
+    std::size_t credit() const {
+      std::lock_guard<std::mutex> lock{mux_->mutex_};
+      return send_credit_;
+    }
+
+    // Returns the number of messages received but not yet consumed.
+    std::size_t queued() const {
+      std::lock_guard<std::mutex> lock{mux_->mutex_};
+      return queue_.size();
+    }
+
+   private:
+    friend class ChannelMux;
+
+    Channel(ChannelMux* mux, std::uint32_t id)
+        : mux_{mux}, id_{id}, send_credit_{mux->window_} {}
+
+    static Status<void> WriteAll(VectorWriter*) { return {}; }
+
+    template <typename T, typename... Ts>
+    static Status<void> WriteAll(VectorWriter* writer, const T& value,
+                                 const Ts&... values) {
+      auto status = SerializerCommon::Write(value, writer);
+      if (!status)
+        return status;
+      else
+        return WriteAll(writer, values...);
+    }
+
+    // Makes the next queued message the current message and returns its
+    // credit to the peer.
+    Status<void> Next() {
+      auto status = mux_->Pop(this, &message_);
+      if (!status)
+        return status;
+
+      message_deserializer_ =
+          MessageDeserializer{message_.data(), message_.size()};
+      return {};
+    }
+
+    template <typename Return>
+    void GetReturn(Status<Return>* return_status) {
+      auto status = Next();
+      if (!status) {
+        *return_status = status.error();
+        return;
+      }
+
+      Return return_value;
+      status = message_deserializer_.Read(&return_value);
+      if (!status)
+        *return_status = status.error();
+      else
+        *return_status = std::move(return_value);
+    }
+
+    // Methods that return void do not reply.
+    void GetReturn(Status<void>* return_status) { *return_status = {}; }
+
+    ChannelMux* mux_;
+    const std::uint32_t id_;
+
+    // Serializes outgoing messages, one at a time.
+    std::mutex send_mutex_;
+    VectorWriter buffer_;
+
+    // The current incoming message.
+    std::vector<std::uint8_t> message_;
+    MessageDeserializer message_deserializer_;
+
+    // State shared with the reading thread, guarded by the mutex of the mux.
+    std::condition_variable condition_;
+    std::deque<std::vector<std::uint8_t>> queue_;
+    std::size_t send_credit_;
+    std::size_t receive_used_{0};
+    std::size_t receive_consumed_{0};
+  };
+
+  // Constructs a mux over the given transport. |window| must be the same at
+  // both ends of the connection and fit in 32 bits.
+  ChannelMux(Serializer* serializer, Deserializer* deserializer,
+             std::size_t window = kDefaultWindow)
+      : serializer_{serializer}, deserializer_{deserializer}, window_{window} {}
+
+  ChannelMux(const ChannelMux&) = delete;
+  void operator=(const ChannelMux&) = delete;
+
+  // Returns the channel with |id|, opening it if necessary. Both ends of the
+  // connection must open a channel before frames for it are received. The
+  // channel remains valid for the lifetime of the mux.
+  Channel* Open(std::uint32_t id) {
+    std::lock_guard<std::mutex> lock{mutex_};
+    auto& channel = channels_[id];
+    if (!channel)
+      channel.reset(new Channel{this, id});
+    return channel.get();
+  }
+
+  // Reads one frame from the transport and delivers it to its channel. Returns
+  // ErrorStatus::ProtocolError if the frame is for a channel that is not open
+  // or exceeds the flow control window, or the error of the deserializer.
+  // After an error, the position of the deserializer in the stream is undefined
+  // and the mux should be closed with Close().
+  Status<void> Receive() {
+    std::uint32_t id;
+    std::uint32_t credit;
+    std::vector<std::uint8_t> message;
+    auto status = deserializer_->Read(&id);
+    if (status)
+      status = deserializer_->Read(&credit);
+    if (status)
+      status = deserializer_->Read(&message);
+    if (!status)
+      return status;
+
+    std::lock_guard<std::mutex> lock{mutex_};
+    auto search = channels_.find(id);
+    if (search == channels_.end())
+      return ErrorStatus::ProtocolError;
+
+    Channel* channel = search->second.get();
+    if (credit > window_ - channel->send_credit_ ||
+        message.size() > window_ - channel->receive_used_) {
+      return ErrorStatus::ProtocolError;
+    }
+
+    channel->send_credit_ += credit;
+    if (!message.empty()) {
+      channel->receive_used_ += message.size();
+      channel->queue_.push_back(std::move(message));
+    }
+    if (credit > 0 || !channel->queue_.empty())
+      channel->condition_.notify_all();
+    return {};
+  }
+
+  // Fails the calls waiting on every channel, and all subsequent calls, with
+  // |error|, for example after the connection is disconnected. Messages that
+  // are already queued may still be consumed.
+  void Close(ErrorStatus error) {
+    std::lock_guard<std::mutex> lock{mutex_};
+    error_ = error;
+    for (auto& entry : channels_)
+      entry.second->condition_.notify_all();
+  }
+
+  bool is_closed() const {
+    std::lock_guard<std::mutex> lock{mutex_};
+    return error_ != ErrorStatus::None;
+  }
+
+  std::size_t window() const { return window_; }
+
+  const Serializer& serializer() const { return *serializer_; }
+  Serializer& serializer() { return *serializer_; }
+  const Deserializer& deserializer() const { return *deserializer_; }
+  Deserializer& deserializer() { return *deserializer_; }
+
+ private:
+  // Waits until |channel| has |size| bytes of credit and takes them.
+  Status<void> Acquire(Channel* channel, std::size_t size) {
+    if (size > window_)
+      return ErrorStatus::WriteLimitReached;
+
+    std::unique_lock<std::mutex> lock{mutex_};
+    channel->condition_.wait(lock, [this, channel, size] {
+      return channel->send_credit_ >= size || error_ != ErrorStatus::None;
+    });
+    if (error_ != ErrorStatus::None)
+      return error_;
+
+    channel->send_credit_ -= size;
+    return {};
+  }
+
+  // Waits for a message on |channel|, moves it to |message| and returns credit
+  // to the peer when the channel is drained or half of the window is consumed.
+  Status<void> Pop(Channel* channel, std::vector<std::uint8_t>* message) {
+    bool return_credit;
+    {
+      std::unique_lock<std::mutex> lock{mutex_};
+      channel->condition_.wait(lock, [this, channel] {
+        return !channel->queue_.empty() || error_ != ErrorStatus::None;
+      });
+      if (channel->queue_.empty())
+        return error_;
+
+      *message = std::move(channel->queue_.front());
+      channel->queue_.pop_front();
+      channel->receive_consumed_ += message->size();
+      return_credit = channel->queue_.empty() ||
+                      channel->receive_consumed_ >= window_ / 2;
+    }
+
+    if (return_credit)
+      return SendFrame(channel, BinaryView<std::uint8_t>{});
+    else
+      return {};
+  }
+
+  // Writes a frame for |channel|, returning the credit of the messages it has
+  // consumed since the last frame.
+  Status<void> SendFrame(Channel* channel, BinaryView<std::uint8_t> message) {
+    std::lock_guard<std::mutex> send_lock{send_mutex_};
+    std::uint32_t credit;
+    {
+      std::lock_guard<std::mutex> lock{mutex_};
+      credit = static_cast<std::uint32_t>(channel->receive_consumed_);
+      channel->receive_used_ -= channel->receive_consumed_;
+      channel->receive_consumed_ = 0;
+    }
+
+    // Another frame already returned the credit.
+    if (credit == 0 && message.empty())
+      return {};
+
+    auto status = serializer_->Write(channel->id_);
+    if (status)
+      status = serializer_->Write(credit);
+    if (status)
+      status = serializer_->Write(message);
+    return status;
+  }
+
+  Serializer* serializer_;
+  Deserializer* deserializer_;
+  const std::size_t window_;
+
+  // Serializes frames on the transport.
+  std::mutex send_mutex_;
+
+  mutable std::mutex mutex_;
+  std::unordered_map<std::uint32_t, std::unique_ptr<Channel>> channels_;
+  ErrorStatus error_{ErrorStatus::None};
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_RPC_CHANNEL_MUX_H_
@@ -0,0 +1,113 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_RPC_COROUTINE_METHOD_RECEIVER_H_
+#define LIBNOP_INCLUDE_NOP_RPC_COROUTINE_METHOD_RECEIVER_H_
+
+#include <nop/rpc/coroutine_method_sender.h>
+
+#if defined(NOP_HAS_COROUTINES)
+
+#include <cstddef>
+
+#include <nop/base/serializer.h>
+#include <nop/rpc/simple_method_receiver.h>
+#include <nop/status.h>
+#include <nop/utility/buffer_pool.h>
+#include <nop/utility/frame_writer.h>
+#include <nop/utility/pedantic_buffer_reader.h>
+
+namespace nop {
+
+// CoroutineMethodReceiver serves the calls sent by CoroutineMethodSender from
+// a C++20 coroutine. Each call frame is read by suspending on the transport,
+// dispatched from memory through an InterfaceBindings dispatch table, and the
+// reply is written as one frame.
+//
+// Example:
+//
+//   Task<Status<void>> Session(Socket* socket) {
+//     CoroutineMethodReceiver<Socket, Socket> receiver{socket, socket};
+//     co_return co_await receiver.Serve(dispatcher);
+//   }
+//
+template <AsyncWriter Writer, AsyncReader Reader>
+class CoroutineMethodReceiver {
+ public:
+  // Default limit on the size of a call.
+  enum : std::size_t { kDefaultMaxFrameSize = 64 * 1024 * 1024 };
+
+  CoroutineMethodReceiver(Writer* writer, Reader* reader,
+                          std::size_t max_frame_size = kDefaultMaxFrameSize)
+      : writer_{writer}, reader_{reader}, max_frame_size_{max_frame_size} {}
+
+  // Reads, dispatches and replies to one call. |dispatcher| must remain valid
+  // until the returned task completes.
+  template <typename Dispatcher>
+  Task<Status<void>> Dispatch(const Dispatcher& dispatcher) {
+    PooledBuffer request;
+    Status<void> status = co_await detail::ReadFrameAsync(reader_, &request,
+                                                          max_frame_size_);
+    if (!status)
+      co_return status;
+
+    PooledWriter reply;
+    detail::BeginFrame(&reply);
+
+    PedanticBufferReader request_reader{request.data(), request.size()};
+    Deserializer<PedanticBufferReader*> deserializer{&request_reader};
+    Serializer<PooledWriter*> serializer{&reply};
+    auto receiver = MakeSimpleMethodReceiver(&serializer, &deserializer);
+    status = dispatcher(&receiver);
+    if (!status)
+      co_return status;
+    else if (!request_reader.empty())
+      co_return ErrorStatus::ProtocolError;
+
+    status = detail::EndFrame(&reply);
+    if (!status)
+      co_return status;
+
+    co_return co_await writer_->Write(reply.data(), reply.size());
+  }
+
+  // Dispatches calls until an error occurs, such as the transport closing, and
+  // returns the error.
+  template <typename Dispatcher>
+  Task<Status<void>> Serve(const Dispatcher& dispatcher) {
+    while (true) {
+      auto status = co_await Dispatch(dispatcher);
+      if (!status)
+        co_return status;
+    }
+  }
+
+  const Writer& writer() const { return *writer_; }
+  Writer& writer() { return *writer_; }
+  const Reader& reader() const { return *reader_; }
+  Reader& reader() { return *reader_; }
+
+ private:
+  Writer* writer_;
+  Reader* reader_;
+  std::size_t max_frame_size_;
+};
+
+}  // namespace nop
+
+#endif  // defined(NOP_HAS_COROUTINES)
+
+#endif  // LIBNOP_INCLUDE_NOP_RPC_COROUTINE_METHOD_RECEIVER_H_
@@ -0,0 +1,170 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_RPC_COROUTINE_METHOD_SENDER_H_
+#define LIBNOP_INCLUDE_NOP_RPC_COROUTINE_METHOD_SENDER_H_
+
+#include <nop/utility/coroutine.h>
+
+#if defined(NOP_HAS_COROUTINES)
+
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <nop/base/serializer.h>
+#include <nop/status.h>
+#include <nop/utility/buffer_pool.h>
+#include <nop/utility/endian.h>
+#include <nop/utility/frame_writer.h>
+#include <nop/utility/pedantic_buffer_reader.h>
+
+namespace nop {
+
+namespace detail {
+
+// Reads a length-prefixed frame from |reader| into |frame|. Lengths larger
+// than |max_size| result in ErrorStatus::ProtocolError.
+template <AsyncReader Reader>
+Task<Status<void>> ReadFrameAsync(Reader* reader, PooledBuffer* frame,
+                                  std::size_t max_size) {
+  std::uint32_t header;
+  Status<void> status =
+      co_await reader->Read(reinterpret_cast<std::uint8_t*>(&header),
+                            sizeof(header));
+  if (!status)
+    co_return status;
+
+  const std::size_t length = HostEndian<std::uint32_t>::FromLittle(header);
+  if (length > max_size)
+    co_return ErrorStatus::ProtocolError;
+
+  frame->resize(length);
+  co_return co_await reader->Read(frame->data(), length);
+}
+
+}  // namespace detail
+
+// CoroutineMethodSender is an implementation of the Sender type required by
+// the remote interface support in nop/rpc/interface.h for C++20 coroutines.
+// InterfaceMethod::InvokeAsync() returns a Task that, when awaited, sends the
+// call and suspends the awaiting coroutine on the I/O of the transport instead
+// of blocking the thread:
+//
+//   Task<Status<int>> Add(CoroutineMethodSender<Socket, Socket>* sender) {
+//     Status<int> sum = co_await Calculator::Sum::InvokeAsync(sender, 1, 2);
+//     co_return sum;
+//   }
+//
+// The call and the reply are each sent as one length-prefixed frame, in the
+// format of FrameWriter, so the transport only moves whole buffers and the
+// encodings run without suspending. The arguments are serialized when
+// InvokeAsync() is called. Like SimpleMethodSender, a sender carries one call
+// at a time: each call must complete before the next is awaited. The remote
+// side uses CoroutineMethodReceiver.
+template <AsyncWriter Writer, AsyncReader Reader>
+class CoroutineMethodSender {
+ public:
+  // Default limit on the size of a reply.
+  enum : std::size_t { kDefaultMaxFrameSize = 64 * 1024 * 1024 };
+
+  // The awaitable type returned by InterfaceMethod::InvokeAsync() for methods
+  // returning Return.
+  template <typename Return>
+  using Future = Task<Status<Return>>;
+
+  CoroutineMethodSender(Writer* writer, Reader* reader,
+                        std::size_t max_frame_size = kDefaultMaxFrameSize)
+      : writer_{writer}, reader_{reader}, max_frame_size_{max_frame_size} {}
+
+  template <typename Return, typename MethodSelector, typename... Args>
+  Future<Return> SendMethodAsync(MethodSelector method_selector,
+                                 const std::tuple<Args...>& args) {
+    // The arguments may refer to temporaries of the caller, so serialize them
+    // before returning the lazily started task.
+    PooledWriter request;
+    detail::BeginFrame(&request);
+    Serializer<PooledWriter*> serializer{&request};
+    auto status = serializer.Write(method_selector);
+    if (status)
+      status = serializer.Write(args);
+    if (status)
+      status = detail::EndFrame(&request);
+    if (!status)
+      return Fail<Return>(status.error());
+
+    return Call<Return>(std::move(request));
+  }
+
+  const Writer& writer() const { return *writer_; }
+  Writer& writer() { return *writer_; }
+  const Reader& reader() const { return *reader_; }
+  Reader& reader() { return *reader_; }
+
+ private:
+  template <typename Return>
+  static Future<Return> Fail(ErrorStatus error) {
+    co_return error;
+  }
+
+  template <typename Return>
+  Future<Return> Call(PooledWriter request) {
+    Status<void> status = co_await writer_->Write(request.data(),
+                                                  request.size());
+    if (!status)
+      co_return status.error();
+
+    PooledBuffer reply;
+    status = co_await detail::ReadFrameAsync(reader_, &reply,
+                                             max_frame_size_);
+    if (!status)
+      co_return status.error();
+
+    co_return Decode<Return>(reply);
+  }
+
+  // Decodes the return value, which must fill the reply.
+  template <typename Return>
+  static Status<Return> Decode(const PooledBuffer& reply) {
+    PedanticBufferReader reader{reply.data(), reply.size()};
+    if constexpr (std::is_void<Return>::value) {
+      if (!reader.empty())
+        return ErrorStatus::ProtocolError;
+      return {};
+    } else {
+      Return return_value;
+      auto status = Deserializer<PedanticBufferReader*>{&reader}.Read(
+          &return_value);
+      if (!status)
+        return status.error();
+      else if (!reader.empty())
+        return ErrorStatus::ProtocolError;
+      return Status<Return>{std::move(return_value)};
+    }
+  }
+
+  Writer* writer_;
+  Reader* reader_;
+  std::size_t max_frame_size_;
+};
+
+}  // namespace nop
+
+#endif  // defined(NOP_HAS_COROUTINES)
+
+#endif  // LIBNOP_INCLUDE_NOP_RPC_COROUTINE_METHOD_SENDER_H_
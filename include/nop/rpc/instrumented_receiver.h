@@ -0,0 +1,313 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_RPC_INSTRUMENTED_RECEIVER_H_
+#define LIBNOP_INCLUDE_NOP_RPC_INSTRUMENTED_RECEIVER_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <nop/base/encoding.h>
+#include <nop/base/tuple.h>
+#include <nop/status.h>
+#include <nop/utility/io_stats.h>
+#include <nop/utility/latency_histogram.h>
+
+namespace nop {
+
+// Statistics of a single interface method, as returned by
+// MethodStatsTable::Snapshot(). Latencies are in the ticks of the clock of the
+// InstrumentedReceiver that recorded them.
+struct MethodStats {
+  // Number of calls that were received.
+  std::uint64_t calls{0};
+  // Number of calls that have been received but not yet completed.
+  std::uint64_t in_flight{0};
+  // Number of calls that failed to decode their arguments, to encode their
+  // return value, or that did not send a return value.
+  std::uint64_t errors{0};
+  // Encoded size of the arguments and return values of the calls.
+  std::uint64_t bytes_in{0};
+  std::uint64_t bytes_out{0};
+
+  // Time spent decoding the arguments, in the handler and encoding the return
+  // value of the calls.
+  LatencyHistogram decode;
+  LatencyHistogram handler;
+  LatencyHistogram encode;
+
+  MethodStats& operator+=(const MethodStats& other) {
+    calls += other.calls;
+    in_flight += other.in_flight;
+    errors += other.errors;
+    bytes_in += other.bytes_in;
+    bytes_out += other.bytes_out;
+    decode += other.decode;
+    handler += other.handler;
+    encode += other.encode;
+    return *this;
+  }
+};
+
+// MethodStatsTable collects MethodStats for each interface method selector
+// from any number of InstrumentedReceivers.
+//
+// Each receiver records into a shard of the table that is only written by that
+// receiver, so recording a call takes no locks and uses no read-modify-write
+// instructions. Snapshot() may be called from any thread at any time and merges
+// the shards. Shards are retained by the table after their receiver is
+// destroyed, so the table must outlive its receivers and its memory grows
+// with the number of receivers that are created; create receivers per thread
+// or per connection rather than per call.
+class MethodStatsTable {
+ public:
+  // Per-method counters of a shard.
+  struct Record {
+    std::atomic<std::uint64_t> started{0};
+    std::atomic<std::uint64_t> finished{0};
+    std::atomic<std::uint64_t> errors{0};
+    std::atomic<std::uint64_t> bytes_in{0};
+    std::atomic<std::uint64_t> bytes_out{0};
+    AtomicLatencyHistogram decode;
+    AtomicLatencyHistogram handler;
+    AtomicLatencyHistogram encode;
+  };
+
+  // The counters written by a single receiver.
+  class Shard {
+   public:
+    // Returns the record for |selector|, creating it on first use. Only called
+    // by the owning receiver.
+    Record* Find(std::uint64_t selector) {
+      auto search = records_.find(selector);
+      if (search != records_.end())
+        return search->second.get();
+
+      std::unique_ptr<Record> record{new Record};
+      Record* pointer = record.get();
+      std::lock_guard<std::mutex> lock{mutex_};
+      records_.emplace(selector, std::move(record));
+      return pointer;
+    }
+
+   private:
+    friend class MethodStatsTable;
+
+    std::mutex mutex_;
+    std::unordered_map<std::uint64_t, std::unique_ptr<Record>> records_;
+  };
+
+  MethodStatsTable() = default;
+
+  MethodStatsTable(const MethodStatsTable&) = delete;
+  void operator=(const MethodStatsTable&) = delete;
+
+  // Returns a new shard for a receiver to record into.
+  Shard* NewShard() {
+    std::unique_ptr<Shard> shard{new Shard};
+    Shard* pointer = shard.get();
+    std::lock_guard<std::mutex> lock{mutex_};
+    shards_.push_back(std::move(shard));
+    return pointer;
+  }
+
+  // Returns the merged statistics of every method selector that has been
+  // received, keyed by selector.
+  std::map<std::uint64_t, MethodStats> Snapshot() const {
+    std::map<std::uint64_t, MethodStats> snapshot;
+    std::lock_guard<std::mutex> lock{mutex_};
+    for (const auto& shard : shards_) {
+      std::lock_guard<std::mutex> shard_lock{shard->mutex_};
+      for (const auto& entry : shard->records_)
+        snapshot[entry.first] += Load(*entry.second);
+    }
+    return snapshot;
+  }
+
+  // Returns the merged statistics of |Method|.
+  template <typename Method>
+  MethodStats Snapshot() const {
+    const auto selector = static_cast<std::uint64_t>(Method::Selector);
+    MethodStats stats;
+    std::lock_guard<std::mutex> lock{mutex_};
+    for (const auto& shard : shards_) {
+      std::lock_guard<std::mutex> shard_lock{shard->mutex_};
+      auto search = shard->records_.find(selector);
+      if (search != shard->records_.end())
+        stats += Load(*search->second);
+    }
+    return stats;
+  }
+
+ private:
+  static MethodStats Load(const Record& record) {
+    MethodStats stats;
+    // Load finished before started so that in_flight cannot underflow.
+    const std::uint64_t finished =
+        record.finished.load(std::memory_order_acquire);
+    stats.calls = record.started.load(std::memory_order_relaxed);
+    stats.in_flight = stats.calls - finished;
+    stats.errors = record.errors.load(std::memory_order_relaxed);
+    stats.bytes_in = record.bytes_in.load(std::memory_order_relaxed);
+    stats.bytes_out = record.bytes_out.load(std::memory_order_relaxed);
+    stats.decode = record.decode.Snapshot();
+    stats.handler = record.handler.Snapshot();
+    stats.encode = record.encode.Snapshot();
+    return stats;
+  }
+
+  mutable std::mutex mutex_;
+  std::vector<std::unique_ptr<Shard>> shards_;
+};
+
+// InstrumentedReceiver wraps another receiver, such as SimpleMethodReceiver,
+// and records per-method statistics into a MethodStatsTable: the number of
+// calls in flight, the time spent decoding the arguments, in the handler and
+// encoding the return value, and the encoded size of the arguments and return
+// value. It is used in place of the wrapped receiver with InterfaceBindings,
+// so that handlers do not need to be instrumented individually.
+//
+// The handler time is measured from the return of GetArgs() to the call to
+// SendReturn(). A call that does not send a return value, because the handler
+// is not bound or the receiver failed, is counted as an error when the next
+// call is received, when Dispatch() returns, or when the receiver is
+// destroyed. Latencies are measured with |Clock|; see nop/utility/io_stats.h.
+//
+// Like the receivers it wraps, an InstrumentedReceiver is used by one thread
+// at a time.
+//
+// Example:
+//
+//   MethodStatsTable stats;
+//
+//   // On each server thread:
+//   auto receiver = MakeSimpleMethodReceiver(&serializer, &deserializer);
+//   InstrumentedReceiver<decltype(receiver)> instrumented{&receiver, &stats};
+//   while (instrumented.Dispatch(bindings, &service)) {
+//   }
+//
+//   // On a monitoring thread:
+//   MethodStats sum = stats.Snapshot<Service::Sum>();
+//   std::uint64_t p99 = sum.handler.Percentile(0.99);
+//
+template <typename Receiver, typename Clock = SteadyClock>
+class InstrumentedReceiver {
+ public:
+  InstrumentedReceiver(Receiver* receiver, MethodStatsTable* table)
+      : receiver_{receiver}, shard_{table->NewShard()} {}
+  ~InstrumentedReceiver() { Finish(false); }
+
+  InstrumentedReceiver(const InstrumentedReceiver&) = delete;
+  void operator=(const InstrumentedReceiver&) = delete;
+
+  // Dispatches one call with |bindings|, completing the statistics of calls
+  // that fail before sending a return value.
+  template <typename Bindings, typename... Args>
+  Status<void> Dispatch(const Bindings& bindings, Args&&... args) {
+    auto status = bindings(this, std::forward<Args>(args)...);
+    Finish(false);
+    return status;
+  }
+
+  template <typename MethodSelector>
+  Status<void> GetMethodSelector(MethodSelector* method_selector) {
+    Finish(false);
+
+    auto status = receiver_->GetMethodSelector(method_selector);
+    if (!status)
+      return status;
+
+    record_ = shard_->Find(static_cast<std::uint64_t>(*method_selector));
+    Increment(&record_->started, 1);
+    return {};
+  }
+
+  template <typename... Args>
+  Status<void> GetArgs(std::tuple<Args...>* args) {
+    const std::uint64_t start = Now();
+    auto status = receiver_->GetArgs(args);
+    timestamp_ = Now();
+    if (!status) {
+      Finish(false);
+      return status;
+    }
+
+    if (record_) {
+      if (Clock::kEnabled)
+        record_->decode.Record(timestamp_ - start);
+      Increment(&record_->bytes_in, Encoding<std::tuple<Args...>>::Size(*args));
+    }
+    return {};
+  }
+
+  template <typename Return>
+  Status<void> SendReturn(const Return& return_value) {
+    const std::uint64_t start = Now();
+    if (record_ && Clock::kEnabled)
+      record_->handler.Record(start - timestamp_);
+
+    auto status = receiver_->SendReturn(return_value);
+    if (record_) {
+      if (Clock::kEnabled)
+        record_->encode.Record(Now() - start);
+      if (status)
+        Increment(&record_->bytes_out, Encoding<Return>::Size(return_value));
+    }
+
+    Finish(!status.has_error());
+    return status;
+  }
+
+  const Receiver& receiver() const { return *receiver_; }
+  Receiver& receiver() { return *receiver_; }
+
+ private:
+  static std::uint64_t Now() { return Clock::kEnabled ? Clock::Now() : 0; }
+
+  static void Increment(std::atomic<std::uint64_t>* counter,
+                        std::uint64_t value) {
+    counter->store(counter->load(std::memory_order_relaxed) + value,
+                   std::memory_order_relaxed);
+  }
+
+  // Completes the current call, if any.
+  void Finish(bool ok) {
+    if (record_ == nullptr)
+      return;
+
+    if (!ok)
+      Increment(&record_->errors, 1);
+    record_->finished.store(
+        record_->finished.load(std::memory_order_relaxed) + 1,
+        std::memory_order_release);
+    record_ = nullptr;
+  }
+
+  Receiver* receiver_;
+  MethodStatsTable::Shard* shard_;
+  MethodStatsTable::Record* record_{nullptr};
+  std::uint64_t timestamp_{0};
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_RPC_INSTRUMENTED_RECEIVER_H_
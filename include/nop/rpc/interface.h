@@ -23,6 +23,7 @@
 #include <utility>
 
 #include <nop/base/encoding.h>
+#include <nop/base/id_index.h>
 #include <nop/base/members.h>
 #include <nop/base/tuple.h>
 #include <nop/base/utility.h>
@@ -114,6 +115,30 @@ struct InterfaceMethod {
         sender, return_value, std::forward<Args>(args)...);
   }
 
+  // Invokes this interface method asynchronously using the given sender and
+  // arguments. Returns the future type defined by the sender, which completes
+  // with the return value of the method. See AsyncMethodSender.
+  template <typename Sender, typename... Args,
+            typename Return = typename InterfaceTraits::Return>
+  static EnableIfConforming<Return(Args...),
+                            typename Sender::template Future<Return>>
+  InvokeAsync(Sender* sender, Args&&... args) {
+    return Helper<ConformingSignature<Return(Args...)>>::InvokeAsync(
+        sender, std::forward<Args>(args)...);
+  }
+
+  // Invokes this interface method asynchronously using the given sender and
+  // arguments. The sender calls |callback| with the Status<Return> of the call
+  // once the reply is received or the call fails.
+  template <typename Sender, typename Callback, typename... Args,
+            typename Return = typename InterfaceTraits::Return>
+  static EnableIfConforming<Return(Args...)> InvokeAsync(Sender* sender,
+                                                         Callback&& callback,
+                                                         Args&&... args) {
+    Helper<ConformingSignature<Return(Args...)>>::InvokeAsync(
+        sender, std::forward<Callback>(callback), std::forward<Args>(args)...);
+  }
+
   // Utility type that deals with the complexity of validating fungible
   // arguments defined by the interface method protocol while accommodating
   // leading passthrough arguments that a handler might receive.
@@ -123,6 +148,12 @@ struct InterfaceMethod {
   // passthough and are ignored by the compatibility checks. The
   // protocol-defined arguments can vary from the original protocol types as
   // long as the fungibility constraints are met.
+  //
+  // In particular, handlers may declare StringView and BinaryView<T> in place
+  // of std::string and std::vector<T> to receive views that alias the input of
+  // the receiver instead of copies. This requires a receiver that decodes from
+  // memory with a reader that supports borrowing, such as BufferReader, and the
+  // views are only valid until the handler returns.
   template <typename HandlerType>
   struct HandlerArgs {
     using HandlerTraits = FunctionTraits<HandlerType>;
@@ -248,6 +279,24 @@ struct InterfaceMethod {
                                   std::forward_as_tuple(args...));
     }
 
+    // Invokes the remote method asynchronously using the given sender,
+    // returning the future provided by the sender.
+    template <typename Sender>
+    static typename Sender::template Future<Return> InvokeAsync(Sender* sender,
+                                                                Args... args) {
+      return sender->template SendMethodAsync<Return>(
+          InterfaceMethod::Selector, std::forward_as_tuple(args...));
+    }
+
+    // Invokes the remote method asynchronously using the given sender,
+    // completing the call with the given callback.
+    template <typename Sender, typename Callback>
+    static void InvokeAsync(Sender* sender, Callback&& callback, Args... args) {
+      sender->template SendMethodAsync<Return>(
+          InterfaceMethod::Selector, std::forward_as_tuple(args...),
+          std::forward<Callback>(callback));
+    }
+
     // Dispatches the given handler op, getting the arguments from the given
     // receiver and passthough arguments and then passing the return value back
     // to the receiver.
@@ -419,7 +468,7 @@ class InterfaceBindings<Passthrough<Args...>, Bindings...> {
   // Returns true if the given selector matches one of the interface methods
   // bound in this dispatch table.
   bool Match(MethodSelector method_selector) {
-    return MatchTable(method_selector, Index<sizeof...(Bindings)>{});
+    return Find(method_selector) != Count;
   }
 
   // Attempts to dispatch one of the bound handlers with the given receiver and
@@ -432,8 +481,8 @@ class InterfaceBindings<Passthrough<Args...>, Bindings...> {
     if (!status)
       return status.error();
 
-    return DispatchTable(receiver, method_selector,
-                         Index<sizeof...(Bindings)>{},
+    return DispatchTable(receiver, Find(method_selector),
+                         std::make_index_sequence<Count>{},
                          std::forward<Args>(args)...);
   }
 
@@ -445,44 +494,42 @@ class InterfaceBindings<Passthrough<Args...>, Bindings...> {
   template <std::size_t Index>
   using At = typename std::tuple_element<Index, decltype(bindings_)>::type;
 
-  // Terminates recursion when searching for the given method selector. Reaching
-  // this function means the selector was not found in this dispatch table.
-  template <typename MethodSelector>
-  bool MatchTable(MethodSelector /*method_selector*/, Index<0>) const {
-    return false;
+  // Returns the index of the binding for the given method selector, or Count if
+  // the selector is not bound in this dispatch table. The selectors are indexed
+  // at compile time, making the lookup independent of the position of the
+  // method in the bindings.
+  static std::size_t Find(MethodSelector method_selector) {
+    static constexpr detail::IdIndex<Count> kIndex{static_cast<std::uint64_t>(
+        Bindings::InterfaceMethodType::Selector)...};
+    return kIndex.Find(static_cast<std::uint64_t>(method_selector));
   }
 
-  // Recurses through the bindings in this dispatch table looking for the given
-  // method selector.
-  template <typename MethodSelector, std::size_t index>
-  bool MatchTable(MethodSelector method_selector, Index<index>) const {
-    if (At<index - 1>::Match(method_selector))
-      return true;
-    else
-      return MatchTable(method_selector, Index<index - 1>{});
+  // Dispatches the binding at the given index.
+  template <std::size_t index, typename Receiver>
+  static Status<void> DispatchAt(const InterfaceBindings& self,
+                                 Receiver* receiver, Args&&... args) {
+    return std::get<index>(self.bindings_)
+        .Dispatch(receiver, std::forward<Args>(args)...);
   }
 
-  // Terminates recursion when searching for the given method selector to
-  // dispatch.
-  template <typename Receiver, typename MethodSelector>
-  Status<void> DispatchTable(Receiver* /*receiver*/,
-                             MethodSelector /*method_selector*/, Index<0>,
-                             Args&&... /*args*/) const {
+  // Handles selectors that are not bound in this dispatch table.
+  template <typename Receiver>
+  static Status<void> DispatchInvalid(const InterfaceBindings& /*self*/,
+                                      Receiver* /*receiver*/,
+                                      Args&&... /*args*/) {
     return ErrorStatus::InvalidInterfaceMethod;
   }
 
-  // Recurses through the bindings in this dispatch table looking for the given
-  // method selector.
-  template <typename Receiver, typename MethodSelector, std::size_t index>
-  Status<void> DispatchTable(Receiver* receiver, MethodSelector method_selector,
-                             Index<index>, Args&&... args) const {
-    if (At<index - 1>::Match(method_selector)) {
-      return std::get<index - 1>(bindings_).Dispatch(
-          receiver, std::forward<Args>(args)...);
-    } else {
-      return DispatchTable(receiver, method_selector, Index<index - 1>{},
-                           std::forward<Args>(args)...);
-    }
+  // Dispatches the binding at the given index through a table of dispatch
+  // functions, with the index Count selecting the invalid method handler.
+  template <typename Receiver, std::size_t... Is>
+  Status<void> DispatchTable(Receiver* receiver, std::size_t index,
+                             std::index_sequence<Is...>, Args&&... args) const {
+    using DispatchFunction =
+        Status<void> (*)(const InterfaceBindings&, Receiver*, Args&&...);
+    static constexpr DispatchFunction kDispatch[] = {
+        &DispatchAt<Is, Receiver>..., &DispatchInvalid<Receiver>};
+    return kDispatch[index](*this, receiver, std::forward<Args>(args)...);
   }
 };
 
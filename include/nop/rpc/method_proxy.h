@@ -0,0 +1,152 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_RPC_METHOD_PROXY_H_
+#define LIBNOP_INCLUDE_NOP_RPC_METHOD_PROXY_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include <nop/base/skip.h>
+#include <nop/status.h>
+
+namespace nop {
+
+// MethodProxy relays remote method calls between a client and a backend
+// without decoding the arguments or return values. Only the method selector of
+// each call is decoded, so that the proxy can choose a backend; the encoded
+// argument tuple and return value are captured as opaque bytes by walking
+// their encodings and are written verbatim to the other side.
+//
+// The client side uses the same format as SimpleMethodSender and
+// SimpleMethodReceiver: the method selector followed by the argument tuple,
+// and then the return value.
+//
+// Example:
+//
+//   MethodProxy<Serializer<FdWriter>, Deserializer<FdReader>> proxy{
+//       &client_serializer, &client_deserializer};
+//
+//   std::uint64_t method_selector;
+//   auto status = proxy.GetMethodSelector(&method_selector);
+//   if (!status)
+//     return status;
+//
+//   Backend* backend = ChooseBackend(method_selector);
+//   return proxy.Forward(method_selector, &backend->serializer,
+//                        &backend->deserializer);
+//
+template <typename Serializer, typename Deserializer>
+class MethodProxy {
+ public:
+  // Limits the size of the arguments or return value of a single call to
+  // |max_value_size| bytes.
+  MethodProxy(
+      Serializer* serializer, Deserializer* deserializer,
+      std::size_t max_value_size = std::numeric_limits<std::size_t>::max())
+      : serializer_{serializer},
+        deserializer_{deserializer},
+        max_value_size_{max_value_size} {}
+
+  MethodProxy(const MethodProxy&) = delete;
+  void operator=(const MethodProxy&) = delete;
+
+  // Reads the method selector of the next call from the client. Any integer
+  // type wide enough for the selectors of the interface may be used.
+  template <typename MethodSelector>
+  Status<void> GetMethodSelector(MethodSelector* method_selector) {
+    return deserializer_->Read(method_selector);
+  }
+
+  // Relays the arguments of the call whose selector was just read, preceded
+  // by |method_selector|, to the backend through |backend_serializer|.
+  template <typename MethodSelector, typename BackendSerializer>
+  Status<void> ForwardArgs(MethodSelector method_selector,
+                           BackendSerializer* backend_serializer) {
+    auto status = Capture(&deserializer_->reader());
+    if (!status)
+      return status;
+
+    status = backend_serializer->Write(method_selector);
+    if (!status)
+      return status;
+
+    return WriteCaptured(&backend_serializer->writer());
+  }
+
+  // Relays the return value of the forwarded call from the backend through
+  // |backend_deserializer| to the client.
+  template <typename BackendDeserializer>
+  Status<void> ForwardReturn(BackendDeserializer* backend_deserializer) {
+    auto status = Capture(&backend_deserializer->reader());
+    if (!status)
+      return status;
+
+    return WriteCaptured(&serializer_->writer());
+  }
+
+  // Relays the call whose selector was just read to the backend and its
+  // return value back to the client.
+  template <typename MethodSelector, typename BackendSerializer,
+            typename BackendDeserializer>
+  Status<void> Forward(MethodSelector method_selector,
+                       BackendSerializer* backend_serializer,
+                       BackendDeserializer* backend_deserializer) {
+    auto status = ForwardArgs(method_selector, backend_serializer);
+    if (!status)
+      return status;
+
+    return ForwardReturn(backend_deserializer);
+  }
+
+  // Returns the bytes of the last value relayed.
+  const std::vector<std::uint8_t>& captured() const { return buffer_; }
+
+  const Serializer& serializer() const { return *serializer_; }
+  Serializer& serializer() { return *serializer_; }
+  const Deserializer& deserializer() const { return *deserializer_; }
+  Deserializer& deserializer() { return *deserializer_; }
+
+ private:
+  // Captures the next value of |reader| into the buffer, which retains its
+  // capacity between calls.
+  template <typename Reader>
+  Status<void> Capture(Reader* reader) {
+    buffer_.clear();
+    return CaptureValue(reader, &buffer_, max_value_size_);
+  }
+
+  // Writes the captured value as one message.
+  template <typename Writer>
+  Status<void> WriteCaptured(Writer* writer) {
+    auto status = writer->Prepare(buffer_.size());
+    if (!status)
+      return status;
+
+    return writer->Write(buffer_.data(), buffer_.data() + buffer_.size());
+  }
+
+  Serializer* serializer_;
+  Deserializer* deserializer_;
+  std::size_t max_value_size_;
+  std::vector<std::uint8_t> buffer_;
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_RPC_METHOD_PROXY_H_
@@ -0,0 +1,201 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_RPC_THREAD_POOL_SERVER_H_
+#define LIBNOP_INCLUDE_NOP_RPC_THREAD_POOL_SERVER_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include <nop/base/serializer.h>
+#include <nop/rpc/simple_method_receiver.h>
+#include <nop/status.h>
+#include <nop/utility/buffer_pool.h>
+#include <nop/utility/frame_reader.h>
+#include <nop/utility/frame_writer.h>
+#include <nop/utility/pedantic_buffer_reader.h>
+#include <nop/utility/thread_pool.h>
+
+namespace nop {
+
+// ThreadPoolServer serves framed calls from any number of connections on a
+// shared work-stealing ThreadPool. Each call frame holds the method selector
+// and argument tuple, and each reply frame holds the return value, which is the
+// format used by CoroutineMethodSender.
+//
+// The calls of each connection run one at a time and in the order they were
+// received, and their replies are written to the connection in the same
+// order, so clients may pipeline calls without request ids. Calls from
+// different connections run in parallel, which means that the handlers bound
+// to |dispatcher| must be safe to call concurrently.
+//
+// Connections are usually served by calling Serve() on a thread per
+// connection, which only reads frames and leaves decoding, the handlers and
+// encoding the replies to the pool. Event loops that read frames themselves
+// submit them to a Connection instead.
+//
+// Example:
+//
+//   ThreadPoolServer<decltype(dispatcher)> server{dispatcher, 8};
+//
+//   // On the thread of each accepted socket:
+//   FdReader reader{socket_fd};
+//   FdWriter writer{socket_fd};
+//   auto status = server.Serve(&reader, &writer);
+//
+template <typename Dispatcher>
+class ThreadPoolServer {
+ public:
+  // Default limit on the size of a call.
+  enum : std::size_t { kDefaultMaxFrameSize = 64 * 1024 * 1024 };
+
+  // Per-connection state that orders the calls of a connection and writes
+  // their replies to |writer|. The connection must outlive its calls; the
+  // destructor waits for them.
+  template <typename Writer>
+  class Connection {
+   public:
+    Connection(ThreadPoolServer* server, Writer* writer)
+        : server_{server}, writer_{writer}, executor_{&server->pool_} {}
+    ~Connection() { executor_.Wait(); }
+
+    Connection(const Connection&) = delete;
+    void operator=(const Connection&) = delete;
+
+    // Queues the call in |frame|, the payload of a call frame, to run after the
+    // calls submitted before it.
+    void Submit(std::vector<std::uint8_t> frame) {
+      executor_.Submit([this, frame = std::move(frame)] { Dispatch(frame); });
+    }
+
+    // Blocks until the submitted calls have completed and returns the first
+    // error, if any. Must not be called from a handler.
+    Status<void> Wait() {
+      executor_.Wait();
+      std::lock_guard<std::mutex> lock{mutex_};
+      return status_;
+    }
+
+    // Returns true once a call has failed. The calls that follow a failed call
+    // are discarded and the connection should be closed, since the client
+    // would otherwise wait for replies that are never sent.
+    bool failed() const { return failed_.load(); }
+
+   private:
+    void Dispatch(const std::vector<std::uint8_t>& frame) {
+      if (failed())
+        return;
+
+      auto status = DispatchFrame(frame);
+      if (!status) {
+        std::lock_guard<std::mutex> lock{mutex_};
+        status_ = status;
+        failed_.store(true);
+      }
+    }
+
+    Status<void> DispatchFrame(const std::vector<std::uint8_t>& frame) {
+      PooledWriter reply;
+      detail::BeginFrame(&reply);
+
+      PedanticBufferReader request_reader{frame.data(), frame.size()};
+      Deserializer<PedanticBufferReader*> deserializer{&request_reader};
+      Serializer<PooledWriter*> serializer{&reply};
+      auto receiver = MakeSimpleMethodReceiver(&serializer, &deserializer);
+      auto status = server_->dispatcher_(&receiver);
+      if (!status)
+        return status;
+      else if (!request_reader.empty())
+        return ErrorStatus::ProtocolError;
+
+      status = detail::EndFrame(&reply);
+      if (!status)
+        return status;
+
+      // Calls of the same connection never run concurrently, so the writer is
+      // only used by one worker at a time.
+      status = writer_->Prepare(reply.size());
+      if (!status)
+        return status;
+
+      return writer_->Write(reply.data(), reply.data() + reply.size());
+    }
+
+    ThreadPoolServer* server_;
+    Writer* writer_;
+    SerialExecutor executor_;
+    std::atomic<bool> failed_{false};
+    std::mutex mutex_;
+    Status<void> status_;
+  };
+
+  // Serves calls with |dispatcher| on a pool of |thread_count| workers, or one
+  // per hardware thread when |thread_count| is zero.
+  ThreadPoolServer(Dispatcher dispatcher, std::size_t thread_count = 0,
+                   std::size_t max_frame_size = kDefaultMaxFrameSize)
+      : dispatcher_{std::move(dispatcher)},
+        max_frame_size_{max_frame_size},
+        pool_{thread_count} {}
+
+  ThreadPoolServer(const ThreadPoolServer&) = delete;
+  void operator=(const ThreadPoolServer&) = delete;
+
+  // Reads call frames from |reader| and replies to them through |writer| until
+  // reading fails, for example because the client closed the connection, or a
+  // call fails. Returns once the calls that were read have completed, with the
+  // error of the first failed call, or otherwise the read error.
+  template <typename Reader, typename Writer>
+  Status<void> Serve(Reader* reader, Writer* writer) {
+    FrameReader<Reader> frame_reader{reader, max_frame_size_};
+    Connection<Writer> connection{this, writer};
+
+    Status<void> read_status;
+    while (!connection.failed()) {
+      std::vector<std::uint8_t> frame;
+      read_status = frame_reader.ReadFrame(&frame);
+      if (!read_status)
+        break;
+
+      connection.Submit(std::move(frame));
+    }
+
+    auto status = connection.Wait();
+    if (!status)
+      return status;
+    else
+      return read_status;
+  }
+
+  const Dispatcher& dispatcher() const { return dispatcher_; }
+  const ThreadPool& pool() const { return pool_; }
+  ThreadPool& pool() { return pool_; }
+
+ private:
+  Dispatcher dispatcher_;
+  std::size_t max_frame_size_;
+
+  // Declared last so that the workers are joined before the dispatcher is
+  // destroyed.
+  ThreadPool pool_;
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_RPC_THREAD_POOL_SERVER_H_
@@ -18,21 +18,44 @@
 #define LIBNOP_INCLUDE_NOP_SERIALIZER_H_
 
 #include <nop/base/array.h>
+#include <nop/base/binary.h>
+#include <nop/base/bitset.h>
+#include <nop/base/blittable.h>
+#include <nop/base/cached.h>
+#include <nop/base/chrono.h>
+#include <nop/base/chunked_blob.h>
+#include <nop/base/columnar.h>
+#include <nop/base/delta.h>
 #include <nop/base/encoding.h>
 #include <nop/base/enum.h>
+#include <nop/base/flat.h>
 #include <nop/base/handle.h>
+#include <nop/base/interned.h>
+#include <nop/base/lazy_array.h>
+#include <nop/base/lazy_table.h>
 #include <nop/base/map.h>
 #include <nop/base/members.h>
+#include <nop/base/null_bitmap.h>
 #include <nop/base/optional.h>
+#include <nop/base/packed.h>
 #include <nop/base/pair.h>
+#include <nop/base/pointer.h>
+#include <nop/base/projection.h>
+#include <nop/base/raw_encoded.h>
+#include <nop/base/reduced_float.h>
 #include <nop/base/reference_wrapper.h>
 #include <nop/base/result.h>
+#include <nop/base/sparse.h>
+#include <nop/base/sequence.h>
 #include <nop/base/serializer.h>
+#include <nop/base/set.h>
 #include <nop/base/string.h>
+#include <nop/base/string_list.h>
 #include <nop/base/table.h>
 #include <nop/base/tuple.h>
 #include <nop/base/value.h>
 #include <nop/base/variant.h>
 #include <nop/base/vector.h>
+#include <nop/base/view.h>
 
 #endif  // LIBNOP_INCLUDE_NOP_SERIALIZER_H_
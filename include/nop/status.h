@@ -18,6 +18,7 @@
 #define LIBNOP_INCLUDE_NOP_STATUS_H_
 
 #include <string>
+#include <type_traits>
 
 #include <nop/types/result.h>
 
@@ -49,6 +50,11 @@ enum class ErrorStatus {
   IOError,                 // 16
   SystemError,             // 17
   DebugError,              // 18
+  DepthLimitReached,       // 19
+  InvalidReference,        // 20
+  InvalidLayoutHash,       // 21
+  InvalidBufferAlignment,  // 22
+  BudgetExceeded,          // 23
 };
 
 template <typename T>
@@ -95,12 +101,29 @@ struct Status : Result<ErrorStatus, T> {
         return "System Error";
       case ErrorStatus::DebugError:
         return "Debug Error";
+      case ErrorStatus::DepthLimitReached:
+        return "Depth Limit Reached";
+      case ErrorStatus::InvalidReference:
+        return "Invalid Reference";
+      case ErrorStatus::InvalidLayoutHash:
+        return "Invalid Layout Hash";
+      case ErrorStatus::InvalidBufferAlignment:
+        return "Invalid Buffer Alignment";
+      case ErrorStatus::BudgetExceeded:
+        return "Budget Exceeded";
       default:
         return "Unknown Error";
     }
   }
 };
 
+// Status<void> is returned by every encoding operation; it must remain a single
+// trivially copyable word to be returned in a register.
+static_assert(std::is_trivially_copyable<Status<void>>::value,
+              "Status<void> must be trivially copyable.");
+static_assert(sizeof(Status<void>) == sizeof(ErrorStatus),
+              "Status<void> must be the size of ErrorStatus.");
+
 }  // namespace nop
 
 #endif  // LIBNOP_INCLUDE_NOP_STATUS_H_
@@ -18,7 +18,10 @@
 #define LIBNOP_INCLUDE_NOP_TRAITS_IS_FUNGIBLE_H_
 
 #include <array>
+#include <bitset>
 #include <map>
+#include <memory>
+#include <string>
 #include <tuple>
 #include <type_traits>
 #include <unordered_map>
@@ -29,9 +32,19 @@
 #include <nop/base/members.h>
 #include <nop/base/table.h>
 #include <nop/base/utility.h>
+#include <nop/types/binary.h>
+#include <nop/types/cached.h>
+#include <nop/types/chunked_blob.h>
+#include <nop/types/interned.h>
+#include <nop/types/lazy_array.h>
 #include <nop/types/optional.h>
+#include <nop/types/raw_encoded.h>
+#include <nop/types/reduced_float.h>
 #include <nop/types/result.h>
+#include <nop/types/sequence.h>
+#include <nop/types/string_list.h>
 #include <nop/types/variant.h>
+#include <nop/types/view.h>
 
 // This header defines rules for which types have equivalent encodings. Types
 // with equivalent encodings my be legally substituted during serialization and
@@ -212,6 +225,21 @@ template <typename A, typename B>
 struct IsFungible<Optional<A>, Optional<B>>
     : IsFungible<std::decay_t<A>, std::decay_t<B>> {};
 
+// Compares pointers to A and B to see if A and B are fungible. A unique_ptr
+// uses the same format as an Optional.
+template <typename A, typename B>
+struct IsFungible<std::unique_ptr<A>, std::unique_ptr<B>>
+    : IsFungible<std::decay_t<A>, std::decay_t<B>> {};
+template <typename A, typename B>
+struct IsFungible<std::unique_ptr<A>, Optional<B>>
+    : IsFungible<std::decay_t<A>, std::decay_t<B>> {};
+template <typename A, typename B>
+struct IsFungible<Optional<A>, std::unique_ptr<B>>
+    : IsFungible<std::decay_t<A>, std::decay_t<B>> {};
+template <typename A, typename B>
+struct IsFungible<std::shared_ptr<A>, std::shared_ptr<B>>
+    : IsFungible<std::decay_t<A>, std::decay_t<B>> {};
+
 // Compares Entry<A> and Entry<B> to see if A and B are fungible.
 template <typename A, typename B, std::uint64_t Id, typename Type>
 struct IsFungible<Entry<A, Id, Type>, Entry<B, Id, Type>>
@@ -248,6 +276,178 @@ struct IsFungible<LogicalBuffer<A, SizeTypeA, IsUnboundedA, EnabledA>,
                   std::vector<B, AllocatorB>>
     : IsFungible<A, std::vector<B, AllocatorB>> {};
 
+// Compares the pointer member of a LogicalBuffer with the array member of
+// another LogicalBuffer or a std::vector to see if the element types are
+// fungible.
+template <typename A, typename B>
+struct IsFungible<A*, B*> : IsFungible<std::decay_t<A>, std::decay_t<B>> {};
+template <typename A, typename B, std::size_t Size>
+struct IsFungible<A*, B[Size]>
+    : IsFungible<std::decay_t<A>, std::decay_t<B>> {};
+template <typename A, typename B, std::size_t Size>
+struct IsFungible<A[Size], B*>
+    : IsFungible<std::decay_t<A>, std::decay_t<B>> {};
+template <typename A, typename B, std::size_t Size>
+struct IsFungible<A*, std::array<B, Size>>
+    : IsFungible<std::decay_t<A>, std::decay_t<B>> {};
+template <typename A, typename B, std::size_t Size>
+struct IsFungible<std::array<A, Size>, B*>
+    : IsFungible<std::decay_t<A>, std::decay_t<B>> {};
+template <typename A, typename B, typename Allocator>
+struct IsFungible<A*, std::vector<B, Allocator>>
+    : IsFungible<std::decay_t<A>, std::decay_t<B>> {};
+template <typename A, typename B, typename Allocator>
+struct IsFungible<std::vector<A, Allocator>, B*>
+    : IsFungible<std::decay_t<A>, std::decay_t<B>> {};
+
+// Binary<Container> is fungible with any type that is fungible with the
+// wrapped container.
+template <typename A, typename B>
+struct IsFungible<Binary<A>, Binary<B>> : IsFungible<A, B> {};
+template <typename A, typename B>
+struct IsFungible<Binary<A>, B> : IsFungible<A, B> {};
+template <typename A, typename B>
+struct IsFungible<A, Binary<B>> : IsFungible<A, B> {};
+
+// RawEncoded<T> is fungible with any type that is fungible with T. The mixed
+// Binary specializations resolve the ambiguity between the wrapper rules.
+template <typename A, typename B>
+struct IsFungible<RawEncoded<A>, RawEncoded<B>> : IsFungible<A, B> {};
+template <typename A, typename B>
+struct IsFungible<RawEncoded<A>, B> : IsFungible<A, B> {};
+template <typename A, typename B>
+struct IsFungible<A, RawEncoded<B>> : IsFungible<A, B> {};
+template <typename A, typename B>
+struct IsFungible<RawEncoded<A>, Binary<B>> : IsFungible<A, B> {};
+template <typename A, typename B>
+struct IsFungible<Binary<A>, RawEncoded<B>> : IsFungible<A, B> {};
+
+// Cached<T> is fungible with any type that is fungible with T. The mixed
+// specializations resolve the ambiguity between the wrapper rules.
+template <typename A, typename B>
+struct IsFungible<Cached<A>, Cached<B>> : IsFungible<A, B> {};
+template <typename A, typename B>
+struct IsFungible<Cached<A>, B> : IsFungible<A, B> {};
+template <typename A, typename B>
+struct IsFungible<A, Cached<B>> : IsFungible<A, B> {};
+template <typename A, typename B>
+struct IsFungible<Cached<A>, Binary<B>> : IsFungible<A, B> {};
+template <typename A, typename B>
+struct IsFungible<Binary<A>, Cached<B>> : IsFungible<A, B> {};
+template <typename A, typename B>
+struct IsFungible<Cached<A>, RawEncoded<B>> : IsFungible<A, B> {};
+template <typename A, typename B>
+struct IsFungible<RawEncoded<A>, Cached<B>> : IsFungible<A, B> {};
+
+// std::vector<bool> is bit-packed like std::bitset<N> and sequences of bool,
+// while std::array<bool, N> and bool arrays use one byte per flag.
+template <typename Allocator, std::size_t Size>
+struct IsFungible<std::vector<bool, Allocator>, std::bitset<Size>>
+    : std::true_type {};
+template <typename Allocator, std::size_t Size>
+struct IsFungible<std::bitset<Size>, std::vector<bool, Allocator>>
+    : std::true_type {};
+template <typename Allocator, std::size_t Size>
+struct IsFungible<std::vector<bool, Allocator>, std::array<bool, Size>>
+    : std::false_type {};
+template <typename Allocator, std::size_t Size>
+struct IsFungible<std::array<bool, Size>, std::vector<bool, Allocator>>
+    : std::false_type {};
+template <typename Allocator, std::size_t Size>
+struct IsFungible<bool[Size], std::vector<bool, Allocator>>
+    : std::false_type {};
+template <typename Allocator, std::size_t Size>
+struct IsFungible<std::vector<bool, Allocator>, bool[Size]>
+    : std::false_type {};
+
+// ChunkedBlob is fungible with byte vectors.
+template <typename Allocator>
+struct IsFungible<ChunkedBlob, std::vector<std::uint8_t, Allocator>>
+    : std::true_type {};
+template <typename Allocator>
+struct IsFungible<std::vector<std::uint8_t, Allocator>, ChunkedBlob>
+    : std::true_type {};
+
+// ReducedFloat is encoded as a vector of the 16-bit patterns of its elements.
+template <typename Container, FloatFormat Format, typename Allocator>
+struct IsFungible<ReducedFloat<Container, Format>,
+                  std::vector<std::uint16_t, Allocator>> : std::true_type {};
+template <typename Allocator, typename Container, FloatFormat Format>
+struct IsFungible<std::vector<std::uint16_t, Allocator>,
+                  ReducedFloat<Container, Format>> : std::true_type {};
+template <typename A, typename B, FloatFormat Format>
+struct IsFungible<ReducedFloat<A, Format>, ReducedFloat<B, Format>>
+    : IsFungible<A, B> {};
+
+// Range<Iterator> and Generator<T> are fungible with std::vector and with each
+// other when the element types are fungible.
+template <typename I, typename B, typename Allocator>
+struct IsFungible<Range<I>, std::vector<B, Allocator>>
+    : IsFungible<typename Range<I>::ValueType, B> {};
+template <typename A, typename Allocator, typename I>
+struct IsFungible<std::vector<A, Allocator>, Range<I>>
+    : IsFungible<A, typename Range<I>::ValueType> {};
+template <typename A, typename B, typename Allocator>
+struct IsFungible<Generator<A>, std::vector<B, Allocator>>
+    : IsFungible<A, B> {};
+template <typename A, typename Allocator, typename B>
+struct IsFungible<std::vector<A, Allocator>, Generator<B>>
+    : IsFungible<A, B> {};
+template <typename I, typename J>
+struct IsFungible<Range<I>, Range<J>>
+    : IsFungible<typename Range<I>::ValueType, typename Range<J>::ValueType> {};
+template <typename A, typename B>
+struct IsFungible<Generator<A>, Generator<B>> : IsFungible<A, B> {};
+template <typename I, typename B>
+struct IsFungible<Range<I>, Generator<B>>
+    : IsFungible<typename Range<I>::ValueType, B> {};
+template <typename A, typename J>
+struct IsFungible<Generator<A>, Range<J>>
+    : IsFungible<A, typename Range<J>::ValueType> {};
+
+// Compares BinaryView and std::vector to see if the element types are
+// fungible. Views share the encoding of the container they borrow from.
+template <typename A, typename B>
+struct IsFungible<BinaryView<A>, BinaryView<B>>
+    : IsFungible<std::decay_t<A>, std::decay_t<B>> {};
+template <typename A, typename B, typename Allocator>
+struct IsFungible<BinaryView<A>, std::vector<B, Allocator>>
+    : IsFungible<std::decay_t<A>, std::decay_t<B>> {};
+template <typename A, typename B, typename Allocator>
+struct IsFungible<std::vector<A, Allocator>, BinaryView<B>>
+    : IsFungible<std::decay_t<A>, std::decay_t<B>> {};
+
+// Compares LazyArray and std::vector to see if the element types are fungible.
+template <typename A, typename B>
+struct IsFungible<LazyArray<A>, LazyArray<B>>
+    : IsFungible<std::decay_t<A>, std::decay_t<B>> {};
+template <typename A, typename B, typename Allocator>
+struct IsFungible<LazyArray<A>, std::vector<B, Allocator>>
+    : IsFungible<std::decay_t<A>, std::decay_t<B>> {};
+template <typename A, typename B, typename Allocator>
+struct IsFungible<std::vector<A, Allocator>, LazyArray<B>>
+    : IsFungible<std::decay_t<A>, std::decay_t<B>> {};
+
+// StringView is fungible with std::string.
+template <typename Traits, typename Allocator>
+struct IsFungible<StringView, std::basic_string<char, Traits, Allocator>>
+    : std::true_type {};
+template <typename Traits, typename Allocator>
+struct IsFungible<std::basic_string<char, Traits, Allocator>, StringView>
+    : std::true_type {};
+
+// StringList is fungible with vectors of strings and string views.
+template <typename B, typename Allocator>
+struct IsFungible<StringList, std::vector<B, Allocator>>
+    : IsFungible<std::string, std::decay_t<B>> {};
+template <typename A, typename Allocator>
+struct IsFungible<std::vector<A, Allocator>, StringList>
+    : IsFungible<std::decay_t<A>, std::string> {};
+
+// Interned strings are fungible with each other when their strings are.
+template <typename A, typename B>
+struct IsFungible<Interned<A>, Interned<B>> : IsFungible<A, B> {};
+
 // Compares MemberList<A...> and MemberList<B...> to see if every
 // MemberPointer::Type in A is fungible with every MemberPointer::Type in B.
 template <typename... A, typename... B>
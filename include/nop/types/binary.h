@@ -0,0 +1,91 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_TYPES_BINARY_H_
+#define LIBNOP_INCLUDE_NOP_TYPES_BINARY_H_
+
+#include <type_traits>
+#include <utility>
+
+namespace nop {
+
+// Binary<Container> is a wrapper that opts a std::vector or std::array of
+// arithmetic or enumeration elements into the bulk BIN encoding. Integral
+// containers already use this encoding; the wrapper is primarily useful for
+// float, double and enum elements, including NOP_ENUM_FLAGS() types, which use
+// the ARY encoding by default with a prefix byte and a separate write for every
+// element.
+//
+// Enumerations are stored at the full width of their underlying type, so both
+// sides must agree on it. Declare the underlying type explicitly, as the
+// default for unscoped enumerations is implementation-defined.
+//
+// For compatibility, readers of Binary<Container> also accept the ARY encoding,
+// and readers of a plain std::vector or std::array of floating point or
+// enumeration elements accept the BIN encoding. This allows writers to switch
+// to Binary<Container> once all readers have been updated to this version of
+// the library.
+//
+// Example:
+//
+//   enum class State : std::uint8_t { Idle, Running, Stopped };
+//
+//   struct Frame {
+//     std::uint64_t timestamp;
+//     nop::Binary<std::vector<float>> samples;
+//     nop::Binary<std::vector<State>> states;
+//     NOP_STRUCTURE(Frame, timestamp, samples, states);
+//   };
+//
+template <typename Container>
+class Binary {
+  using ElementType = typename Container::value_type;
+  static_assert(std::is_arithmetic<ElementType>::value ||
+                    std::is_enum<ElementType>::value,
+                "Binary element type must be integral, floating point or an "
+                "enumeration.");
+
+ public:
+  using Type = Container;
+
+  constexpr Binary() = default;
+  constexpr Binary(const Binary&) = default;
+  constexpr Binary(Binary&&) = default;
+  constexpr Binary(const Container& value) : value_{value} {}
+  constexpr Binary(Container&& value) : value_{std::move(value)} {}
+
+  constexpr Binary& operator=(const Binary&) = default;
+  constexpr Binary& operator=(Binary&&) = default;
+
+  constexpr const Container& get() const { return value_; }
+  constexpr Container& get() { return value_; }
+  constexpr Container&& take() { return std::move(value_); }
+
+  constexpr const Container& operator*() const { return value_; }
+  constexpr Container& operator*() { return value_; }
+  constexpr const Container* operator->() const { return &value_; }
+  constexpr Container* operator->() { return &value_; }
+
+  bool operator==(const Binary& other) const { return value_ == other.value_; }
+  bool operator!=(const Binary& other) const { return value_ != other.value_; }
+
+ private:
+  Container value_{};
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_TYPES_BINARY_H_
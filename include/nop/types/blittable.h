@@ -0,0 +1,92 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_TYPES_BLITTABLE_H_
+#define LIBNOP_INCLUDE_NOP_TYPES_BLITTABLE_H_
+
+#include <utility>
+
+namespace nop {
+
+// Blittable<T> is a wrapper that opts a structure, std::pair or std::tuple, or
+// a std::vector or std::array of them, into an encoding that copies the fields
+// as a single block. The structure must be annotated with NOP_STRUCTURE or
+// NOP_EXTERNAL_STRUCTURE, be trivially copyable and standard layout, and list
+// all of its members in declaration order. Every member must be an integral or
+// floating point type other than bool, and the members must not leave any
+// padding. The elements of a pair or tuple must be integral or floating point
+// types other than bool. These requirements are checked at compile time.
+//
+// By default a structure is encoded member by member, with a prefix for the
+// structure and every member, and integers in their most compact form.
+// Blittable<T> instead writes the members at their full width as one BIN block,
+// preceded by a hash of the layout of the structure that the reader verifies.
+// On little-endian hosts the block of a structure is written and read with a
+// single copy. Pairs and tuples do not have a specified memory layout, so their
+// elements are packed in order through a small stack buffer instead, and they
+// encode the same as a structure with the same members.
+//
+// The blittable encoding is not compatible with the default encoding of the
+// structure, so both sides must use the wrapper.
+//
+// Example:
+//
+//   struct Tick {
+//     std::uint64_t timestamp;
+//     double price;
+//     std::uint32_t quantity;
+//     std::uint32_t venue;
+//     NOP_STRUCTURE(Tick, timestamp, price, quantity, venue);
+//   };
+//
+//   struct Snapshot {
+//     nop::Blittable<Tick> last;
+//     nop::Blittable<std::vector<Tick>> ticks;
+//     nop::Blittable<std::vector<std::pair<std::uint32_t, float>>> edges;
+//     NOP_STRUCTURE(Snapshot, last, ticks, edges);
+//   };
+//
+template <typename T>
+class Blittable {
+ public:
+  using Type = T;
+
+  Blittable() = default;
+  Blittable(const Blittable&) = default;
+  Blittable(Blittable&&) = default;
+  Blittable(const T& value) : value_{value} {}
+  Blittable(T&& value) : value_{std::move(value)} {}
+
+  Blittable& operator=(const Blittable&) = default;
+  Blittable& operator=(Blittable&&) = default;
+
+  const T& get() const { return value_; }
+  T& get() { return value_; }
+  T&& take() { return std::move(value_); }
+
+  const T& operator*() const { return value_; }
+  T& operator*() { return value_; }
+  const T* operator->() const { return &value_; }
+  T* operator->() { return &value_; }
+
+ private:
+  T value_{};
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_TYPES_BLITTABLE_H_
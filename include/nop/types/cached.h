@@ -0,0 +1,107 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_TYPES_CACHED_H_
+#define LIBNOP_INCLUDE_NOP_TYPES_CACHED_H_
+
+#include <memory>
+#include <mutex>
+#include <utility>
+
+#include <nop/base/raw_encoded.h>
+#include <nop/status.h>
+#include <nop/types/raw_encoded.h>
+
+namespace nop {
+
+// Cached<T> holds an immutable value of type T together with its encoding,
+// which is computed the first time the value is serialized and reused every
+// time after that. This is intended for values that are attached to many
+// messages without changing, such as a configuration section or a reference
+// dataset, where serializing the wrapper only copies the cached bytes instead
+// of running Encoding<T>::Size() and Write() again.
+//
+// Copies of a Cached<T> share the value and the cache, so they are cheap to
+// make and the encoding is computed once for all of them. The cache is
+// computed thread-safely and values may be serialized concurrently.
+//
+// Cached<T> is fungible with T and uses exactly the same format. Deserializing
+// replaces the value, whose encoding is computed again when it is next
+// serialized. Values whose encoding depends on the writer, such as handles,
+// fall back to being encoded normally each time.
+//
+// Example:
+//
+//   struct Response {
+//     nop::Cached<Config> config;
+//     std::string body;
+//     NOP_STRUCTURE(Response, config, body);
+//   };
+//
+//   const nop::Cached<Config> config{LoadConfig()};
+//   for (const auto& request : requests)
+//     status = serializer.Write(Response{config, Process(request)});
+//
+template <typename T>
+class Cached {
+ public:
+  using Type = T;
+
+  Cached() : Cached{T{}} {}
+  Cached(const Cached&) = default;
+  Cached(Cached&&) = default;
+  Cached(const T& value) : state_{std::make_shared<State>(T{value})} {}
+  Cached(T&& value) : state_{std::make_shared<State>(std::move(value))} {}
+
+  Cached& operator=(const Cached&) = default;
+  Cached& operator=(Cached&&) = default;
+
+  const T& get() const { return state_->value; }
+  const T& operator*() const { return state_->value; }
+  const T* operator->() const { return &state_->value; }
+
+  // Returns the encoding of the value, computing it on first use. The result
+  // is empty if the value could not be encoded on its own. The first use may
+  // be in the size pass of an enclosing table. EncodeRaw() writes through
+  // SerializerCommon::Write(), which gives the encoding an entry size cache of
+  // its own, so the sizes recorded for the enclosing table are unaffected.
+  const RawEncoded<T>& encoded() const {
+    std::call_once(state_->once, [this] {
+      auto status = EncodeRaw(state_->value);
+      if (status)
+        state_->encoded = status.take();
+    });
+    return state_->encoded;
+  }
+
+  bool operator==(const Cached& other) const { return get() == other.get(); }
+  bool operator!=(const Cached& other) const { return get() != other.get(); }
+
+ private:
+  struct State {
+    explicit State(T&& value) : value{std::move(value)} {}
+
+    const T value;
+    std::once_flag once;
+    RawEncoded<T> encoded;
+  };
+
+  std::shared_ptr<State> state_;
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_TYPES_CACHED_H_
@@ -0,0 +1,119 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_TYPES_CHUNKED_BLOB_H_
+#define LIBNOP_INCLUDE_NOP_TYPES_CHUNKED_BLOB_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <utility>
+
+#include <nop/status.h>
+
+namespace nop {
+
+// ChunkedBlob streams a large binary payload through a bounded buffer instead
+// of holding the whole payload in memory. When writing, the payload is pulled
+// from a source callback one chunk at a time; when reading, it is pushed to a
+// sink callback one chunk at a time. At most |chunk_size| bytes of the payload
+// are buffered at once, regardless of the size of the payload.
+//
+// ChunkedBlob uses the same wire format as std::vector<std::uint8_t>, with
+// which it is fungible, so either side of a connection may use a vector for
+// payloads that are small enough.
+//
+// Example:
+//
+//   // Sender: stream a disk image from a file.
+//   auto image = ChunkedBlob::FromSource(
+//       image_size, [fd](std::uint8_t* data, std::size_t size) {
+//         return ReadExactly(fd, data, size);
+//       });
+//   auto status = serializer.Write(image);
+//
+//   // Receiver: stream the image to a file, limited to 8 GiB.
+//   auto image = ChunkedBlob::ToSink(
+//       [fd](const std::uint8_t* data, std::size_t size) {
+//         return WriteExactly(fd, data, size);
+//       },
+//       8ull << 30);
+//   auto status = deserializer.Read(&image);
+//
+class ChunkedBlob {
+ public:
+  // Fills |data| with the next |size| bytes of the payload.
+  using Source = std::function<Status<void>(std::uint8_t* data,
+                                            std::size_t size)>;
+
+  // Consumes the next |size| bytes of the payload at |data|.
+  using Sink = std::function<Status<void>(const std::uint8_t* data,
+                                          std::size_t size)>;
+
+  // Default number of bytes buffered at a time.
+  enum : std::size_t { kDefaultChunkSize = 64 * 1024 };
+
+  ChunkedBlob() = default;
+
+  // Returns a blob that writes |size| bytes pulled from |source|.
+  static ChunkedBlob FromSource(std::uint64_t size, Source source,
+                                std::size_t chunk_size = kDefaultChunkSize) {
+    ChunkedBlob blob;
+    blob.size_ = size;
+    blob.source_ = std::move(source);
+    blob.chunk_size_ = chunk_size > 0 ? chunk_size : 1;
+    return blob;
+  }
+
+  // Returns a blob that reads a payload of up to |max_size| bytes into |sink|.
+  // Longer payloads fail with ErrorStatus::InvalidContainerLength before any
+  // bytes are passed to the sink.
+  static ChunkedBlob ToSink(
+      Sink sink,
+      std::uint64_t max_size = std::numeric_limits<std::uint64_t>::max(),
+      std::size_t chunk_size = kDefaultChunkSize) {
+    ChunkedBlob blob;
+    blob.sink_ = std::move(sink);
+    blob.max_size_ = max_size;
+    blob.chunk_size_ = chunk_size > 0 ? chunk_size : 1;
+    return blob;
+  }
+
+  // Returns the size of the payload to write, or of the last payload read.
+  std::uint64_t size() const { return size_; }
+
+  std::uint64_t max_size() const { return max_size_; }
+  std::size_t chunk_size() const { return chunk_size_; }
+
+  const Source& source() const { return source_; }
+  const Sink& sink() const { return sink_; }
+
+  // Records the size of a payload that is being read.
+  void set_size(std::uint64_t size) { size_ = size; }
+
+ private:
+  std::uint64_t size_{0};
+  std::uint64_t max_size_{std::numeric_limits<std::uint64_t>::max()};
+  std::size_t chunk_size_{kDefaultChunkSize};
+  Source source_;
+  Sink sink_;
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_TYPES_CHUNKED_BLOB_H_
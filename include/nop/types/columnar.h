@@ -0,0 +1,84 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_TYPES_COLUMNAR_H_
+#define LIBNOP_INCLUDE_NOP_TYPES_COLUMNAR_H_
+
+#include <utility>
+
+namespace nop {
+
+// Columnar<Container> is a wrapper that opts a std::vector of structures into
+// a column-oriented encoding. The element type must be a structure annotated
+// with NOP_STRUCTURE or NOP_EXTERNAL_STRUCTURE whose members are all integral
+// or floating point types, other than bool.
+//
+// By default each element of a vector of structures is encoded separately,
+// with a structure prefix, a member count, and a prefix for every member.
+// Columnar<Container> instead encodes each member of all of the elements as
+// one contiguous BIN column, which removes the per-element overhead and lets
+// each column be written and read in bulk. Members are stored at their full
+// width, so columns of small integers may be larger than the compact integer
+// encodings used by the rows.
+//
+// The columnar encoding is not compatible with the default encoding of the
+// vector, so both sides must use the wrapper.
+//
+// Example:
+//
+//   struct Point {
+//     std::uint64_t timestamp;
+//     double value;
+//     NOP_STRUCTURE(Point, timestamp, value);
+//   };
+//
+//   struct Series {
+//     std::string name;
+//     nop::Columnar<std::vector<Point>> points;
+//     NOP_STRUCTURE(Series, name, points);
+//   };
+//
+template <typename Container>
+class Columnar {
+ public:
+  using Type = Container;
+
+  Columnar() = default;
+  Columnar(const Columnar&) = default;
+  Columnar(Columnar&&) = default;
+  Columnar(const Container& value) : value_{value} {}
+  Columnar(Container&& value) : value_{std::move(value)} {}
+
+  Columnar& operator=(const Columnar&) = default;
+  Columnar& operator=(Columnar&&) = default;
+
+  const Container& get() const { return value_; }
+  Container& get() { return value_; }
+  Container&& take() { return std::move(value_); }
+
+  const Container& operator*() const { return value_; }
+  Container& operator*() { return value_; }
+  const Container* operator->() const { return &value_; }
+  Container* operator->() { return &value_; }
+
+ private:
+  Container value_{};
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_TYPES_COLUMNAR_H_
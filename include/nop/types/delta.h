@@ -0,0 +1,76 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_TYPES_DELTA_H_
+#define LIBNOP_INCLUDE_NOP_TYPES_DELTA_H_
+
+namespace nop {
+
+//
+// Delta<T> encodes the changes from a baseline value of structure or table
+// type T to a new value, instead of the whole value. Members are identified by
+// their index in the member list of a structure and by their entry id in a
+// table, so only members that differ from the baseline are written. Reading
+// patches the members of a target value in place and leaves the others as
+// they were.
+//
+// Members are compared with operator== and changed members are sent whole;
+// nested structures are not diffed recursively. Both sides must agree on the
+// baseline, for example the last state acknowledged by the receiver.
+//
+// Example:
+//
+//   // Sender.
+//   auto status = serializer.Write(nop::Delta<State>{last_sent, current});
+//   last_sent = current;
+//
+//   // Receiver.
+//   nop::Delta<State> delta{&replica};
+//   auto status = deserializer.Read(&delta);
+//
+template <typename T>
+class Delta {
+ public:
+  using Type = T;
+
+  Delta() = default;
+  Delta(const Delta&) = default;
+
+  // Constructs a delta for writing the changes from |baseline| to |value|.
+  // Both must remain valid while the delta is in use.
+  constexpr Delta(const T& baseline, const T& value)
+      : baseline_{&baseline}, value_{&value} {}
+
+  // Constructs a delta for reading changes into |target|.
+  constexpr explicit Delta(T* target)
+      : baseline_{target}, value_{target}, target_{target} {}
+
+  Delta& operator=(const Delta&) = default;
+
+  constexpr const T* baseline() const { return baseline_; }
+  constexpr const T* value() const { return value_; }
+  constexpr T* target() const { return target_; }
+
+ private:
+  const T* baseline_{nullptr};
+  const T* value_{nullptr};
+  T* target_{nullptr};
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_TYPES_DELTA_H_
@@ -17,6 +17,7 @@
 #ifndef LIBNOP_INCLUDE_NOP_TYPES_DETAIL_LOGICAL_BUFFER_H_
 #define LIBNOP_INCLUDE_NOP_TYPES_DETAIL_LOGICAL_BUFFER_H_
 
+#include <limits>
 #include <type_traits>
 
 namespace nop {
@@ -32,6 +33,8 @@ struct IsLogicalBufferPair<std::array<T, Length>, SizeType> : std::true_type {};
 template <typename T, typename SizeType, std::size_t Length>
 struct IsLogicalBufferPair<const std::array<T, Length>, SizeType>
     : std::true_type {};
+template <typename T, typename SizeType>
+struct IsLogicalBufferPair<T*, SizeType> : std::true_type {};
 
 // Enable if BufferType and SizeType constitute a valid logical buffer pair.
 template <typename BufferType, typename SizeType>
@@ -109,6 +112,64 @@ class LogicalBuffer<BufferType, SizeType, IsUnbounded_,
   SizeType& size_;
 };
 
+// Captures references to the pointer and size members of a user-defined
+// structure that are grouped into a logical buffer over memory owned outside of
+// the structure, such as a DMA or shared memory region.
+//
+// Elements are encoded directly from the memory the pointer refers to. When
+// decoding, the behavior depends on the constness of the element type:
+//
+//  * Pointers to non-const elements refer to a caller-supplied destination of
+//    size() elements. The elements are decoded directly into the destination
+//    and size() is set to the number of elements decoded. Arrays longer than
+//    the destination fail with ErrorStatus::InvalidContainerLength.
+//  * Pointers to const elements are bound to the bytes of the reader, which
+//    must support borrowing, without copying. Only integral elements may be
+//    borrowed, and the reader's input must remain valid while the structure is
+//    in use.
+//
+template <typename T, typename SizeType, bool IsUnbounded_>
+class LogicalBuffer<T*, SizeType, IsUnbounded_,
+                    EnableIfLogicalBufferPair<T*, SizeType>> {
+ public:
+  using ValueType = T;
+  enum : bool { IsUnbounded = IsUnbounded_ };
+  enum : bool { IsBorrowed = std::is_const<T>::value };
+
+  static_assert(
+      std::is_integral<SizeType>::value,
+      "The size member of a logical buffer pair must be an integral type.");
+  static_assert(!IsBorrowed || std::is_integral<T>::value,
+                "Logical buffers that borrow from the reader must have "
+                "integral value types!");
+
+  constexpr LogicalBuffer(T*& data, SizeType& size)
+      : data_{data}, size_{size} {}
+  constexpr LogicalBuffer(const LogicalBuffer&) = default;
+  constexpr LogicalBuffer& operator=(const LogicalBuffer&) = default;
+
+  constexpr ValueType& operator[](std::size_t index) { return data_[index]; }
+  constexpr const ValueType& operator[](std::size_t index) const {
+    return data_[index];
+  }
+
+  constexpr T*& data() { return data_; }
+  constexpr T* data() const { return data_; }
+
+  constexpr SizeType& size() { return size_; }
+  constexpr const SizeType& size() const { return size_; }
+
+  constexpr ValueType* begin() { return data_; }
+  constexpr const ValueType* begin() const { return data_; }
+
+  constexpr ValueType* end() { return data_ + size_; }
+  constexpr const ValueType* end() const { return data_ + size_; }
+
+ private:
+  T*& data_;
+  SizeType& size_;
+};
+
 }  // namespace nop
 
 #endif  // LIBNOP_INCLUDE_NOP_TYPES_DETAIL_LOGICAL_BUFFER_H_
@@ -0,0 +1,185 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_TYPES_FLAT_MAP_H_
+#define LIBNOP_INCLUDE_NOP_TYPES_FLAT_MAP_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace nop {
+
+// FlatMap is an associative container that stores its entries in a vector
+// sorted by key. Lookups are binary searches over contiguous memory, and
+// insertions and erasures move the entries that follow, which favors maps
+// that are built once and then mostly read, as decoded messages typically are.
+//
+// Unlike std::map, the value type is std::pair<Key, T> with a mutable key;
+// modifying the key of an entry in place breaks the ordering of the map.
+// Iterators are invalidated by insertion and erasure.
+//
+// The encoding is the same as std::map, and decoding builds the map from the
+// sorted input in linear time. See base/flat.h.
+template <typename Key, typename T, typename Compare = std::less<Key>,
+          typename Allocator = std::allocator<std::pair<Key, T>>>
+class FlatMap {
+ public:
+  using key_type = Key;
+  using mapped_type = T;
+  using value_type = std::pair<Key, T>;
+  using key_compare = Compare;
+  using allocator_type = Allocator;
+  using container_type = std::vector<value_type, Allocator>;
+  using size_type = typename container_type::size_type;
+  using iterator = typename container_type::iterator;
+  using const_iterator = typename container_type::const_iterator;
+
+  FlatMap() = default;
+  FlatMap(const FlatMap&) = default;
+  FlatMap(FlatMap&&) = default;
+  FlatMap(std::initializer_list<value_type> values) {
+    replace(container_type{values});
+  }
+
+  FlatMap& operator=(const FlatMap&) = default;
+  FlatMap& operator=(FlatMap&&) = default;
+
+  iterator begin() { return entries_.begin(); }
+  iterator end() { return entries_.end(); }
+  const_iterator begin() const { return entries_.begin(); }
+  const_iterator end() const { return entries_.end(); }
+  const_iterator cbegin() const { return entries_.cbegin(); }
+  const_iterator cend() const { return entries_.cend(); }
+
+  bool empty() const { return entries_.empty(); }
+  size_type size() const { return entries_.size(); }
+  size_type capacity() const { return entries_.capacity(); }
+  void reserve(size_type size) { entries_.reserve(size); }
+  void clear() { entries_.clear(); }
+
+  key_compare key_comp() const { return compare_; }
+
+  iterator lower_bound(const Key& key) {
+    return std::lower_bound(entries_.begin(), entries_.end(), key,
+                            KeyCompare{compare_});
+  }
+  const_iterator lower_bound(const Key& key) const {
+    return std::lower_bound(entries_.begin(), entries_.end(), key,
+                            KeyCompare{compare_});
+  }
+
+  iterator find(const Key& key) {
+    auto position = lower_bound(key);
+    return Matches(position, key) ? position : entries_.end();
+  }
+  const_iterator find(const Key& key) const {
+    auto position = lower_bound(key);
+    return Matches(position, key) ? position : entries_.end();
+  }
+
+  size_type count(const Key& key) const { return find(key) != end() ? 1 : 0; }
+
+  // Inserts |value| unless an entry with the same key exists. Returns the
+  // position of the entry with the key and whether |value| was inserted.
+  std::pair<iterator, bool> insert(value_type value) {
+    auto position = lower_bound(value.first);
+    if (Matches(position, value.first))
+      return {position, false};
+    return {entries_.insert(position, std::move(value)), true};
+  }
+
+  template <typename... Args>
+  std::pair<iterator, bool> emplace(Args&&... args) {
+    return insert(value_type(std::forward<Args>(args)...));
+  }
+
+  // Returns the value with |key|, inserting a default constructed value if the
+  // key is not present.
+  T& operator[](const Key& key) {
+    auto position = lower_bound(key);
+    if (!Matches(position, key))
+      position = entries_.emplace(position, key, T{});
+    return position->second;
+  }
+
+  iterator erase(const_iterator position) { return entries_.erase(position); }
+  size_type erase(const Key& key) {
+    auto position = find(key);
+    if (position == end())
+      return 0;
+    entries_.erase(position);
+    return 1;
+  }
+
+  // Moves the underlying entries out, leaving the map empty.
+  container_type extract() && {
+    container_type entries = std::move(entries_);
+    entries_.clear();
+    return entries;
+  }
+
+  // Replaces the entries of the map with |entries|, which are sorted by key
+  // unless they already are. Of entries with equal keys only the first is
+  // kept. Takes linear time for sorted input.
+  void replace(container_type&& entries) {
+    entries_ = std::move(entries);
+    const KeyCompare compare{compare_};
+    if (!std::is_sorted(entries_.begin(), entries_.end(), compare))
+      std::stable_sort(entries_.begin(), entries_.end(), compare);
+
+    auto last = std::unique(
+        entries_.begin(), entries_.end(),
+        [&compare](const value_type& a, const value_type& b) {
+          return !compare(a, b) && !compare(b, a);
+        });
+    entries_.erase(last, entries_.end());
+  }
+
+  bool operator==(const FlatMap& other) const {
+    return entries_ == other.entries_;
+  }
+  bool operator!=(const FlatMap& other) const { return !(*this == other); }
+
+ private:
+  // Compares entries and keys by key.
+  struct KeyCompare {
+    Compare compare;
+
+    bool operator()(const value_type& a, const value_type& b) const {
+      return compare(a.first, b.first);
+    }
+    bool operator()(const value_type& a, const Key& b) const {
+      return compare(a.first, b);
+    }
+  };
+
+  bool Matches(const_iterator position, const Key& key) const {
+    return position != entries_.end() && !compare_(key, position->first);
+  }
+
+  container_type entries_;
+  Compare compare_{};
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_TYPES_FLAT_MAP_H_
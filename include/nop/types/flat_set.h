@@ -0,0 +1,149 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_TYPES_FLAT_SET_H_
+#define LIBNOP_INCLUDE_NOP_TYPES_FLAT_SET_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace nop {
+
+// FlatSet is a set that stores its elements in a sorted vector. Like FlatMap,
+// it trades the cost of insertion and erasure for compact storage and fast
+// lookups. Elements are only accessible through const iterators, so that the
+// ordering is preserved. Iterators are invalidated by insertion and erasure.
+//
+// The encoding is the same as std::set, and decoding builds the set from the
+// sorted input in linear time. See base/flat.h.
+template <typename Key, typename Compare = std::less<Key>,
+          typename Allocator = std::allocator<Key>>
+class FlatSet {
+ public:
+  using key_type = Key;
+  using value_type = Key;
+  using key_compare = Compare;
+  using allocator_type = Allocator;
+  using container_type = std::vector<Key, Allocator>;
+  using size_type = typename container_type::size_type;
+  using iterator = typename container_type::const_iterator;
+  using const_iterator = typename container_type::const_iterator;
+
+  FlatSet() = default;
+  FlatSet(const FlatSet&) = default;
+  FlatSet(FlatSet&&) = default;
+  FlatSet(std::initializer_list<Key> values) {
+    replace(container_type{values});
+  }
+
+  FlatSet& operator=(const FlatSet&) = default;
+  FlatSet& operator=(FlatSet&&) = default;
+
+  const_iterator begin() const { return elements_.begin(); }
+  const_iterator end() const { return elements_.end(); }
+  const_iterator cbegin() const { return elements_.cbegin(); }
+  const_iterator cend() const { return elements_.cend(); }
+
+  bool empty() const { return elements_.empty(); }
+  size_type size() const { return elements_.size(); }
+  size_type capacity() const { return elements_.capacity(); }
+  void reserve(size_type size) { elements_.reserve(size); }
+  void clear() { elements_.clear(); }
+
+  key_compare key_comp() const { return compare_; }
+
+  const_iterator lower_bound(const Key& key) const {
+    return std::lower_bound(elements_.begin(), elements_.end(), key, compare_);
+  }
+
+  const_iterator find(const Key& key) const {
+    auto position = lower_bound(key);
+    return Matches(position, key) ? position : elements_.end();
+  }
+
+  size_type count(const Key& key) const { return find(key) != end() ? 1 : 0; }
+
+  // Inserts |value| unless an equal element exists. Returns the position of the
+  // equal element and whether |value| was inserted.
+  std::pair<const_iterator, bool> insert(Key value) {
+    auto position = lower_bound(value);
+    if (Matches(position, value))
+      return {position, false};
+    return {elements_.insert(position, std::move(value)), true};
+  }
+
+  template <typename... Args>
+  std::pair<const_iterator, bool> emplace(Args&&... args) {
+    return insert(Key(std::forward<Args>(args)...));
+  }
+
+  const_iterator erase(const_iterator position) {
+    return elements_.erase(position);
+  }
+  size_type erase(const Key& key) {
+    auto position = find(key);
+    if (position == end())
+      return 0;
+    elements_.erase(position);
+    return 1;
+  }
+
+  // Moves the underlying elements out, leaving the set empty.
+  container_type extract() && {
+    container_type elements = std::move(elements_);
+    elements_.clear();
+    return elements;
+  }
+
+  // Replaces the elements of the set with |elements|, which are sorted unless
+  // they already are. Of equal elements only the first is kept. Takes linear
+  // time for sorted input.
+  void replace(container_type&& elements) {
+    elements_ = std::move(elements);
+    if (!std::is_sorted(elements_.begin(), elements_.end(), compare_))
+      std::stable_sort(elements_.begin(), elements_.end(), compare_);
+
+    const Compare& compare = compare_;
+    auto last = std::unique(elements_.begin(), elements_.end(),
+                            [&compare](const Key& a, const Key& b) {
+                              return !compare(a, b) && !compare(b, a);
+                            });
+    elements_.erase(last, elements_.end());
+  }
+
+  bool operator==(const FlatSet& other) const {
+    return elements_ == other.elements_;
+  }
+  bool operator!=(const FlatSet& other) const { return !(*this == other); }
+
+ private:
+  bool Matches(const_iterator position, const Key& key) const {
+    return position != elements_.end() && !compare_(key, *position);
+  }
+
+  container_type elements_;
+  Compare compare_{};
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_TYPES_FLAT_SET_H_
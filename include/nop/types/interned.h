@@ -0,0 +1,146 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_TYPES_INTERNED_H_
+#define LIBNOP_INCLUDE_NOP_TYPES_INTERNED_H_
+
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include <nop/traits/is_detected.h>
+#include <nop/types/view.h>
+
+namespace nop {
+
+// Index of a string in the string table of a message.
+using StringReference = std::uint64_t;
+
+// Returned by InterningWriter::InternString() when a string is not in the
+// table yet and must be defined in full.
+enum : StringReference { kNewStringReference = ~StringReference{0} };
+
+// Evaluates to true if Writer provides the InternString() method required to
+// write Interned<String> values. Writers that wrap another writer forward the
+// method only when the underlying writer provides it.
+template <typename Writer>
+using WriterInternStringTest = decltype(std::declval<Writer&>().InternString(
+    std::declval<StringView>()));
+template <typename Writer>
+using WriterInternsStrings = IsDetected<WriterInternStringTest, Writer>;
+
+// Evaluates to true if Reader provides the DefineString() and GetString()
+// methods required to read Interned<String> values.
+template <typename Reader>
+using ReaderDefineStringTest = decltype(std::declval<Reader&>().DefineString(
+    std::declval<StringView>()));
+template <typename Reader>
+using ReaderGetStringTest = decltype(std::declval<Reader&>().GetString(
+    std::declval<StringReference>()));
+template <typename Reader>
+using ReaderInternsStrings = IsDetected<ReaderDefineStringTest, Reader>;
+
+namespace detail {
+
+// Determines whether String may be used with Interned<String>.
+template <typename String>
+struct IsInternable : std::false_type {};
+template <typename Traits, typename Allocator>
+struct IsInternable<std::basic_string<char, Traits, Allocator>>
+    : std::true_type {};
+template <>
+struct IsInternable<StringView> : std::true_type {};
+
+}  // namespace detail
+
+// Interned<String> is a wrapper that opts a std::string or StringView into
+// dictionary encoding within a message. The first occurrence of each distinct
+// string defines an entry in a string table, and later occurrences of the same
+// string are encoded as a small reference to the entry. Messages that repeat
+// the same strings many times, such as category names or keys in a vector of
+// records, shrink accordingly.
+//
+// The string table is kept by the writer and the reader, so interned strings
+// must be serialized with an InterningWriter and deserialized with an
+// InterningReader. The table covers everything written through the same
+// writer until it is cleared, which is usually a single message. Readers that
+// can borrow from their input decode each definition without copying it, and
+// Interned<StringView> values decoded from such readers refer directly into the
+// input for both definitions and references.
+//
+// Because references depend on every earlier definition, values containing
+// interned strings must be read in order. SkipValue() and the table encoding,
+// when it skips an entry the reader does not know, add the definitions they
+// skip to the table of an InterningReader, so that later references still
+// resolve. Readers that skip values by length without a string table, such as
+// the readers of older versions of a table, misnumber the entries after each
+// skipped definition; interned strings that later values refer to should only
+// be defined in table entries that every reader knows.
+//
+// Example:
+//
+//   struct Record {
+//     std::uint64_t timestamp;
+//     nop::Interned<std::string> category;
+//     NOP_STRUCTURE(Record, timestamp, category);
+//   };
+//
+//   nop::VectorWriter vector_writer;
+//   nop::Serializer<nop::InterningWriter<nop::VectorWriter>> serializer{
+//       &vector_writer};
+//   auto status = serializer.Write(records);
+//
+template <typename String>
+class Interned {
+  static_assert(detail::IsInternable<String>::value,
+                "Interned string type must be std::string or StringView.");
+
+ public:
+  using Type = String;
+
+  Interned() = default;
+  Interned(const Interned&) = default;
+  Interned(Interned&&) = default;
+  Interned(const String& value) : value_{value} {}
+  Interned(String&& value) : value_{std::move(value)} {}
+
+  Interned& operator=(const Interned&) = default;
+  Interned& operator=(Interned&&) = default;
+
+  const String& get() const { return value_; }
+  String& get() { return value_; }
+  String&& take() { return std::move(value_); }
+
+  const String& operator*() const { return value_; }
+  String& operator*() { return value_; }
+  const String* operator->() const { return &value_; }
+  String* operator->() { return &value_; }
+
+  bool operator==(const Interned& other) const {
+    return value_ == other.value_;
+  }
+  bool operator!=(const Interned& other) const {
+    return value_ != other.value_;
+  }
+
+ private:
+  String value_{};
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_TYPES_INTERNED_H_
@@ -0,0 +1,220 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_TYPES_LAZY_ARRAY_H_
+#define LIBNOP_INCLUDE_NOP_TYPES_LAZY_ARRAY_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#include <nop/base/encoding.h>
+#include <nop/base/skip.h>
+#include <nop/utility/pedantic_buffer_reader.h>
+
+namespace nop {
+
+namespace detail {
+
+// Elements of a LazyArray that may be located by index: arithmetic elements,
+// which may be in the BIN encoding, and elements with a fixed encoded size.
+template <typename T>
+struct LazyArrayRandomAccess
+    : std::integral_constant<bool, std::is_arithmetic<T>::value ||
+                                       HasFixedEncodingSize<T>::value> {};
+
+}  // namespace detail
+
+// LazyArray<T> deserializes the encoding of a std::vector<T> by recording where
+// the elements are located and how many there are, without decoding them.
+// Elements are decoded as the caller iterates over them, so that a search that
+// stops at the first match does not pay for the rest of the array. When the
+// elements have a fixed encoded size, or are integral or floating point values
+// in the BIN encoding, they may also be decoded at random.
+//
+// Arrays of elements without a fixed encoded size are walked with SkipValue()
+// during deserialization to find the end of the array, which is much cheaper
+// than decoding them but not free.
+//
+// Like LazyTable, LazyArray refers to the bytes of the reader it was read from,
+// which must support borrowing. The reader's input must remain valid while the
+// array is in use. Elements are decoded with a bounds-checked reader over the
+// array bytes, so elements that hold handles are not supported.
+//
+// LazyArray is fungible with std::vector<T>. Serializing a LazyArray writes
+// the recorded bytes verbatim, which allows an array to be relayed without
+// decoding it.
+//
+// Example:
+//
+//   nop::Deserializer<nop::BufferReader> deserializer{data, size};
+//   nop::LazyArray<Order> orders;
+//   auto status = deserializer.Read(&orders);
+//   if (!status)
+//     return status;
+//
+//   auto cursor = orders.begin();
+//   Order order;
+//   while (!cursor.done()) {
+//     status = cursor.Next(&order);
+//     if (!status)
+//       return status;
+//     else if (order.price > limit)
+//       return Fill(order);
+//   }
+//
+template <typename T>
+class LazyArray {
+  static_assert(!std::is_same<T, bool>::value,
+                "LazyArray does not support the bit-packed encoding of "
+                "std::vector<bool>.");
+
+ public:
+  using ValueType = T;
+
+  // Decodes the elements of a LazyArray in order.
+  class Cursor {
+   public:
+    Cursor() = default;
+
+    // Decodes the next element into |value|. Returns
+    // ErrorStatus::ReadLimitReached when there are no more elements.
+    Status<void> Next(T* value) {
+      if (done())
+        return ErrorStatus::ReadLimitReached;
+
+      auto status = binary_ ? ReadBinary(value, std::is_arithmetic<T>{})
+                            : Encoding<T>::Read(value, &reader_);
+      if (!status)
+        return status;
+
+      index_++;
+      return {};
+    }
+
+    // Advances past the next element without decoding it.
+    Status<void> Skip() {
+      if (done())
+        return ErrorStatus::ReadLimitReached;
+
+      auto status = binary_ ? reader_.Skip(sizeof(T)) : SkipValue(&reader_);
+      if (!status)
+        return status;
+
+      index_++;
+      return {};
+    }
+
+    // Returns true when all of the elements have been visited.
+    bool done() const { return index_ == count_; }
+
+    // Returns the index of the next element.
+    std::size_t index() const { return index_; }
+
+   private:
+    friend class LazyArray;
+
+    Cursor(const std::uint8_t* data, std::size_t size, std::size_t count,
+           bool binary)
+        : reader_{data, size}, count_{count}, binary_{binary} {}
+
+    // Only arithmetic elements are read from the BIN encoding.
+    Status<void> ReadBinary(T* value, std::true_type) {
+      return ReadElements(value, value + 1, &reader_);
+    }
+    Status<void> ReadBinary(T* /*value*/, std::false_type) {
+      return ErrorStatus::UnexpectedEncodingType;
+    }
+
+    PedanticBufferReader reader_;
+    std::size_t index_{0};
+    std::size_t count_{0};
+    bool binary_{false};
+  };
+
+  LazyArray() = default;
+  LazyArray(const LazyArray&) = default;
+  LazyArray& operator=(const LazyArray&) = default;
+
+  std::size_t size() const { return count_; }
+  bool empty() const { return count_ == 0; }
+
+  // Returns a cursor positioned at the first element.
+  Cursor begin() const { return {data_, size_, count_, binary_}; }
+
+  // Decodes the element at |index| into |value|. Only available for elements
+  // that may be located without visiting the preceding elements.
+  template <typename U = T,
+            typename Enabled =
+                std::enable_if_t<detail::LazyArrayRandomAccess<U>::value>>
+  Status<void> Get(std::size_t index, T* value) const {
+    if (index >= count_)
+      return ErrorStatus::ReadLimitReached;
+
+    const std::size_t element_size =
+        binary_ ? sizeof(T) : FixedEncodingSize<T>::value;
+    Cursor cursor{data_ + index * element_size, element_size, 1, binary_};
+    return cursor.Next(value);
+  }
+
+  // Decodes the elements in order, passing each to |op| until |op| returns
+  // false.
+  template <typename Op>
+  Status<void> ForEach(Op op) const {
+    Cursor cursor = begin();
+    T value{};
+    while (!cursor.done()) {
+      auto status = cursor.Next(&value);
+      if (!status)
+        return status;
+      else if (!op(static_cast<const T&>(value)))
+        break;
+    }
+    return {};
+  }
+
+  // Decodes all of the elements into |values|.
+  template <typename Allocator>
+  Status<void> Decode(std::vector<T, Allocator>* values) const {
+    values->clear();
+    values->reserve(count_);
+    return ForEach([values](const T& value) {
+      values->push_back(value);
+      return true;
+    });
+  }
+
+  // Returns the encoded bytes of the elements.
+  const std::uint8_t* data() const { return data_; }
+  std::size_t data_size() const { return size_; }
+
+  void clear() { *this = LazyArray{}; }
+
+ private:
+  template <typename, typename>
+  friend struct Encoding;
+
+  const std::uint8_t* data_{nullptr};
+  std::size_t size_{0};
+  std::size_t count_{0};
+  bool binary_{false};
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_TYPES_LAZY_ARRAY_H_
@@ -0,0 +1,163 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_TYPES_LAZY_TABLE_H_
+#define LIBNOP_INCLUDE_NOP_TYPES_LAZY_TABLE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include <nop/base/encoding.h>
+#include <nop/base/id_index.h>
+#include <nop/table.h>
+#include <nop/utility/pedantic_buffer_reader.h>
+
+namespace nop {
+
+// LazyTable<Table> deserializes the encoding of a table by recording where the
+// binary container of each entry is located, without decoding the entries.
+// Entries are decoded on demand, the first time they are requested. This is
+// useful when only a few entries of a large table are of interest, for
+// example to route a message based on a header entry.
+//
+// Like BinaryView and StringView, LazyTable refers to the bytes of the reader
+// it was read from, which must support borrowing. The reader's input must
+// remain valid until the entries of interest have been decoded. Entries are
+// decoded with a bounds-checked reader over the entry bytes, so entries that
+// hold handles are not supported.
+//
+// LazyTable only supports deserialization; serialize the table type itself.
+//
+// Example:
+//
+//   nop::Deserializer<nop::BufferReader> deserializer{data, size};
+//   nop::LazyTable<Message> message;
+//   auto status = deserializer.Read(&message);
+//   if (!status)
+//     return status;
+//
+//   status = message.Decode(&Message::route);
+//   if (!status)
+//     return status;
+//
+//   if (message.table().route)
+//     Forward(message.table().route.get());
+//
+template <typename Table>
+class LazyTable {
+  using EntryList = typename EntryListTraits<Table>::EntryList;
+  enum : std::size_t { Count = EntryList::Count };
+
+ public:
+  LazyTable() = default;
+  LazyTable(const LazyTable&) = default;
+  LazyTable& operator=(const LazyTable&) = default;
+
+  // Returns true if the encoding contained the given entry.
+  template <typename T, std::uint64_t Id>
+  bool Contains(Entry<T, Id, ActiveEntry> Table::*/*member*/) const {
+    return locations_[PositionOf<Id>()].present;
+  }
+
+  // Decodes the given entry into the underlying table, if the encoding
+  // contained the entry and it has not already been decoded. Entries that are
+  // not in the encoding remain empty.
+  //
+  // Returns an error if the entry bytes are not a valid encoding of the entry.
+  template <typename T, std::uint64_t Id>
+  Status<void> Decode(Entry<T, Id, ActiveEntry> Table::*member) {
+    Location& location = locations_[PositionOf<Id>()];
+    if (!location.present || location.decoded)
+      return {};
+
+    // The entry bytes may include padding following the value, which is
+    // ignored.
+    Entry<T, Id, ActiveEntry>& entry = table_.*member;
+    entry = T{};
+    PedanticBufferReader reader{location.data, location.size};
+    auto status = Encoding<T>::Read(&entry.get(), &reader);
+    if (!status) {
+      entry.clear();
+      return status;
+    }
+
+    location.decoded = true;
+    return {};
+  }
+
+  // Returns the underlying table. Only entries that have been decoded are
+  // non-empty.
+  const Table& table() const { return table_; }
+
+  void clear() {
+    for (Location& location : locations_)
+      location = Location{};
+    table_ = Table{};
+  }
+
+ private:
+  template <typename, typename>
+  friend struct Encoding;
+
+  struct Location {
+    const std::uint8_t* data{nullptr};
+    std::size_t size{0};
+    bool present{false};
+    bool decoded{false};
+  };
+
+  template <std::size_t... Is>
+  static constexpr detail::IdIndex<Count> MakeIndex(
+      std::index_sequence<Is...>) {
+    return {
+        static_cast<std::uint64_t>(EntryList::template At<Is>::Type::Id)...};
+  }
+
+  template <std::uint64_t Id>
+  static constexpr std::size_t PositionOf() {
+    constexpr std::size_t position =
+        MakeIndex(std::make_index_sequence<Count>{}).Find(Id);
+    static_assert(position < Count, "The entry is not a member of the table.");
+    return position;
+  }
+
+  // Records the location of the bytes of the entry with the given id. Entries
+  // with unknown ids are ignored.
+  Status<void> SetEntry(std::uint64_t id, const void* data, std::size_t size) {
+    static constexpr detail::IdIndex<Count> kIndex =
+        MakeIndex(std::make_index_sequence<Count>{});
+    const std::size_t position = kIndex.Find(id);
+    if (position == Count)
+      return {};
+
+    Location& location = locations_[position];
+    if (location.present)
+      return ErrorStatus::DuplicateTableEntry;
+
+    location.data = static_cast<const std::uint8_t*>(data);
+    location.size = size;
+    location.present = true;
+    return {};
+  }
+
+  Location locations_[Count]{};
+  Table table_{};
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_TYPES_LAZY_TABLE_H_
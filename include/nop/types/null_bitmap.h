@@ -0,0 +1,90 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_TYPES_NULL_BITMAP_H_
+#define LIBNOP_INCLUDE_NOP_TYPES_NULL_BITMAP_H_
+
+#include <cstdint>
+#include <utility>
+
+namespace nop {
+
+// NullBitmap<Container> is a wrapper that opts a std::vector of Optional<T>
+// elements into a columnar encoding: a bitmap of which elements are present,
+// followed by the present values packed together. Integral, floating point and
+// enumeration values are packed in bulk as one BIN payload; other values are
+// encoded one after the other as an array.
+//
+// By default each element of a vector of optionals is encoded with its own
+// prefix, and the integral fast path is not available. Vectors that are mostly
+// empty, such as rows of optional features, shrink to one bit per empty
+// element.
+//
+// The bitmap costs one bit per element, so readers that check sizes against
+// their input only accept eight elements per byte of input. Readers that
+// cannot check, such as stream readers, would accept any size, so the decoded
+// size is also limited to max_size() elements, kDefaultMaxSize unless set
+// otherwise. Set a limit suited to the data before reading untrusted input.
+//
+// The null bitmap encoding is not compatible with the default encoding of the
+// vector, so both sides must use the wrapper.
+//
+// Example:
+//
+//   struct Features {
+//     std::uint64_t id;
+//     nop::NullBitmap<std::vector<nop::Optional<float>>> values;
+//     NOP_STRUCTURE(Features, id, values);
+//   };
+//
+template <typename Container>
+class NullBitmap {
+ public:
+  using Type = Container;
+
+  // The default limit on the number of decoded elements.
+  enum : std::uint64_t { kDefaultMaxSize = 16 * 1024 * 1024 };
+
+  NullBitmap() = default;
+  NullBitmap(const NullBitmap&) = default;
+  NullBitmap(NullBitmap&&) = default;
+  NullBitmap(const Container& value) : value_{value} {}
+  NullBitmap(Container&& value) : value_{std::move(value)} {}
+
+  NullBitmap& operator=(const NullBitmap&) = default;
+  NullBitmap& operator=(NullBitmap&&) = default;
+
+  const Container& get() const { return value_; }
+  Container& get() { return value_; }
+  Container&& take() { return std::move(value_); }
+
+  const Container& operator*() const { return value_; }
+  Container& operator*() { return value_; }
+  const Container* operator->() const { return &value_; }
+  Container* operator->() { return &value_; }
+
+  // Limits the number of elements decoded into this value.
+  std::uint64_t max_size() const { return max_size_; }
+  void set_max_size(std::uint64_t max_size) { max_size_ = max_size; }
+
+ private:
+  Container value_{};
+  std::uint64_t max_size_{kDefaultMaxSize};
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_TYPES_NULL_BITMAP_H_
@@ -0,0 +1,85 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_TYPES_PACKED_H_
+#define LIBNOP_INCLUDE_NOP_TYPES_PACKED_H_
+
+#include <type_traits>
+#include <utility>
+
+namespace nop {
+
+// Packed<Container> is a wrapper that opts a std::vector of integers into a
+// compressed encoding: the differences between consecutive elements are
+// zigzag encoded and bit-packed in blocks, each with the smallest bit width
+// that holds all of the differences in the block.
+//
+// Sorted ids, timestamps, counters, and other slowly changing sequences have
+// small differences and shrink to a few bits per element. Arbitrary values
+// still round trip exactly, at a cost of at most a few bits per element more
+// than their full width.
+//
+// The packed encoding is not compatible with the default encoding of the
+// vector, so both sides must use the wrapper.
+//
+// Example:
+//
+//   struct Index {
+//     nop::Packed<std::vector<std::uint64_t>> ids;
+//     nop::Packed<std::vector<std::int64_t>> timestamps;
+//     NOP_STRUCTURE(Index, ids, timestamps);
+//   };
+//
+template <typename Container>
+class Packed {
+  using ElementType = typename Container::value_type;
+  static_assert(std::is_integral<ElementType>::value &&
+                    !std::is_same<ElementType, bool>::value,
+                "Packed element type must be an integral type other than "
+                "bool.");
+
+ public:
+  using Type = Container;
+
+  Packed() = default;
+  Packed(const Packed&) = default;
+  Packed(Packed&&) = default;
+  Packed(const Container& value) : value_{value} {}
+  Packed(Container&& value) : value_{std::move(value)} {}
+
+  Packed& operator=(const Packed&) = default;
+  Packed& operator=(Packed&&) = default;
+
+  const Container& get() const { return value_; }
+  Container& get() { return value_; }
+  Container&& take() { return std::move(value_); }
+
+  const Container& operator*() const { return value_; }
+  Container& operator*() { return value_; }
+  const Container* operator->() const { return &value_; }
+  Container* operator->() { return &value_; }
+
+  bool operator==(const Packed& other) const { return value_ == other.value_; }
+  bool operator!=(const Packed& other) const { return value_ != other.value_; }
+
+ private:
+  Container value_{};
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_TYPES_PACKED_H_
@@ -0,0 +1,88 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_TYPES_RAW_ENCODED_H_
+#define LIBNOP_INCLUDE_NOP_TYPES_RAW_ENCODED_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace nop {
+
+// RawEncoded<T> holds the bytes of an encoded value of type T. It serializes
+// by writing the bytes verbatim and deserializes by capturing the bytes of the
+// next value without decoding it, which allows a sub-message to be encoded
+// once and embedded in many messages, or to be received and relayed later
+// without being decoded and encoded again.
+//
+// RawEncoded<T> is fungible with T, so it may be used in place of T in
+// structures and interface method signatures. The bytes are trusted to be a
+// valid encoding of T when writing; reading only checks that the prefix of the
+// value matches T and that the value is well formed.
+//
+// Example:
+//
+//   // Encode the header table once.
+//   auto header = EncodeRaw(HeaderTable{...});
+//
+//   struct Response {
+//     RawEncoded<HeaderTable> header;
+//     std::string body;
+//     NOP_STRUCTURE(Response, header, body);
+//   };
+//
+template <typename T>
+class RawEncoded {
+ public:
+  using Type = T;
+
+  RawEncoded() = default;
+  RawEncoded(const RawEncoded&) = default;
+  RawEncoded(RawEncoded&&) = default;
+
+  // Takes |bytes|, which must hold exactly one encoded value of type T.
+  explicit RawEncoded(std::vector<std::uint8_t> bytes)
+      : bytes_{std::move(bytes)} {}
+
+  RawEncoded& operator=(const RawEncoded&) = default;
+  RawEncoded& operator=(RawEncoded&&) = default;
+
+  const std::uint8_t* data() const { return bytes_.data(); }
+  std::size_t size() const { return bytes_.size(); }
+
+  // Returns true if this instance holds no value. Empty instances may not be
+  // serialized.
+  bool empty() const { return bytes_.empty(); }
+
+  const std::vector<std::uint8_t>& bytes() const { return bytes_; }
+  std::vector<std::uint8_t>&& take() { return std::move(bytes_); }
+
+  bool operator==(const RawEncoded& other) const {
+    return bytes_ == other.bytes_;
+  }
+  bool operator!=(const RawEncoded& other) const {
+    return bytes_ != other.bytes_;
+  }
+
+ private:
+  std::vector<std::uint8_t> bytes_;
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_TYPES_RAW_ENCODED_H_
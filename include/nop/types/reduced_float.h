@@ -0,0 +1,90 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_TYPES_REDUCED_FLOAT_H_
+#define LIBNOP_INCLUDE_NOP_TYPES_REDUCED_FLOAT_H_
+
+#include <type_traits>
+#include <utility>
+
+namespace nop {
+
+// 16-bit floating point formats for ReducedFloat.
+enum class FloatFormat {
+  // IEEE 754 binary16: 5 exponent bits and 10 mantissa bits.
+  Half,
+  // bfloat16: the upper 16 bits of a float, with 8 exponent bits and 7
+  // mantissa bits.
+  BFloat16,
+};
+
+// ReducedFloat<Container, Format> is a lossy wrapper that stores a std::vector
+// or std::array of float in a 16-bit floating point format on the wire,
+// halving its size. Elements are rounded to the nearest representable value,
+// with ties to even; infinities and NaNs are preserved. IEEE half precision
+// keeps more precision over a narrower range, overflowing to infinity above
+// 65504, while bfloat16 keeps the full range of float with less precision.
+//
+// Use the Half<Container> and BFloat16<Container> aliases.
+//
+// Example:
+//
+//   struct Features {
+//     std::uint64_t id;
+//     nop::BFloat16<std::vector<float>> embedding;
+//     NOP_STRUCTURE(Features, id, embedding);
+//   };
+//
+template <typename Container, FloatFormat Format>
+class ReducedFloat {
+  static_assert(std::is_same<typename Container::value_type, float>::value,
+                "ReducedFloat element type must be float.");
+
+ public:
+  using Type = Container;
+
+  ReducedFloat() = default;
+  ReducedFloat(const ReducedFloat&) = default;
+  ReducedFloat(ReducedFloat&&) = default;
+  ReducedFloat(const Container& value) : value_{value} {}
+  ReducedFloat(Container&& value) : value_{std::move(value)} {}
+
+  ReducedFloat& operator=(const ReducedFloat&) = default;
+  ReducedFloat& operator=(ReducedFloat&&) = default;
+
+  const Container& get() const { return value_; }
+  Container& get() { return value_; }
+  Container&& take() { return std::move(value_); }
+
+  const Container& operator*() const { return value_; }
+  Container& operator*() { return value_; }
+  const Container* operator->() const { return &value_; }
+  Container* operator->() { return &value_; }
+
+ private:
+  Container value_{};
+};
+
+template <typename Container>
+using Half = ReducedFloat<Container, FloatFormat::Half>;
+
+template <typename Container>
+using BFloat16 = ReducedFloat<Container, FloatFormat::BFloat16>;
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_TYPES_REDUCED_FLOAT_H_
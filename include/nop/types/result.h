@@ -19,6 +19,8 @@
 
 #include <type_traits>
 
+#include <nop/utility/compiler.h>
+
 namespace nop {
 
 // Result is a template type that contains either an error value of type
@@ -189,7 +191,10 @@ class Result {
   State state_;
 };
 
-// Specialization of Result for void types.
+// Specialization of Result for void types. This specialization holds only the
+// error value and is trivially copyable, so that it is passed and returned in
+// a register like the underlying enum. Copying and moving are the same
+// operation: a moved-from Result retains its error.
 template <typename ErrorEnum>
 class Result<ErrorEnum, void> {
   static_assert(std::is_enum<ErrorEnum>::value,
@@ -198,27 +203,19 @@ class Result<ErrorEnum, void> {
  public:
   constexpr Result() : error_{ErrorEnum::None} {}
   constexpr Result(ErrorEnum error) : error_{error} {}
-  constexpr Result(const Result& other) : error_{other.error_} {}
-  constexpr Result(Result&& other) : error_{other.error_} { other.clear(); }
+  constexpr Result(const Result& other) = default;
+  constexpr Result(Result&& other) = default;
 
   ~Result() = default;
 
-  constexpr Result& operator=(const Result& other) {
-    if (this != &other) {
-      error_ = other.error_;
-    }
-    return *this;
-  }
-  constexpr Result& operator=(Result&& other) {
-    if (this != &other) {
-      error_ = other.error_;
-      other.clear();
-    }
-    return *this;
-  }
+  constexpr Result& operator=(const Result& other) = default;
+  constexpr Result& operator=(Result&& other) = default;
 
   constexpr bool has_error() const { return error_ != ErrorEnum::None; }
-  constexpr explicit operator bool() const { return !has_error(); }
+
+  // Errors are rare: hint that callers branching on the result take the
+  // success path, keeping the error handling out of line.
+  constexpr explicit operator bool() const { return NOP_LIKELY(!has_error()); }
 
   constexpr ErrorEnum error() const { return error_; }
 
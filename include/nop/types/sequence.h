@@ -0,0 +1,122 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_TYPES_SEQUENCE_H_
+#define LIBNOP_INCLUDE_NOP_TYPES_SEQUENCE_H_
+
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+
+#include <nop/status.h>
+
+namespace nop {
+
+//
+// Range<Iterator> and Generator<T> serialize a sequence of elements in the
+// same format as std::vector<T>, without first collecting the elements into a
+// container. They are fungible with std::vector<T>, so the receiver reads them
+// back into a vector, and they may be used in place of std::vector<T> in
+// structures and interface method signatures on the sending side. Sequences
+// of bool are bit-packed like std::vector<bool>. Both are write-only.
+//
+// For writers that prepare for the size of the value, computing the size
+// visits every element before writing. Writers that do not need to be
+// prepared, such as StreamWriter and FdWriter, visit each element once.
+//
+
+// Range<Iterator> serializes the elements of [begin, end). The iterators must
+// be forward iterators and remain valid while the range is serialized.
+//
+// Example:
+//
+//   std::set<std::string> names = ...;
+//   auto status = serializer.Write(MakeRange(names));
+//
+template <typename Iterator>
+class Range {
+ public:
+  using ValueType =
+      std::decay_t<typename std::iterator_traits<Iterator>::value_type>;
+
+  Range() = default;
+  Range(Iterator begin, Iterator end) : begin_{begin}, end_{end} {}
+
+  Iterator begin() const { return begin_; }
+  Iterator end() const { return end_; }
+
+  std::size_t size() const {
+    return static_cast<std::size_t>(std::distance(begin_, end_));
+  }
+
+ private:
+  Iterator begin_{};
+  Iterator end_{};
+};
+
+template <typename Iterator>
+Range<Iterator> MakeRange(Iterator begin, Iterator end) {
+  return {begin, end};
+}
+
+template <typename Container>
+Range<typename Container::const_iterator> MakeRange(
+    const Container& container) {
+  return {container.cbegin(), container.cend()};
+}
+
+// Generator<T> serializes |count| elements produced on demand by a callback,
+// which stores element |index| in |element| or returns an error that aborts
+// serialization. Elements are requested in order. The callback must be
+// deterministic when the generator is written to a writer that prepares for
+// the size of the value, because the elements are then produced twice:
+// once to compute the size and once to write them.
+//
+// Example:
+//
+//   Generator<Row> rows{table.row_count(), [&](std::size_t index, Row* row) {
+//     return table.ReadRow(index, row);
+//   }};
+//   auto status = serializer.Write(rows);
+//
+template <typename T>
+class Generator {
+ public:
+  using ValueType = T;
+  using Producer = std::function<Status<void>(std::size_t index, T* element)>;
+
+  Generator() = default;
+  Generator(std::size_t count, Producer producer)
+      : count_{count}, producer_{std::move(producer)} {}
+
+  // Stores element |index| in |element|.
+  Status<void> Produce(std::size_t index, T* element) const {
+    return producer_(index, element);
+  }
+
+  std::size_t size() const { return count_; }
+
+ private:
+  std::size_t count_{0};
+  Producer producer_;
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_TYPES_SEQUENCE_H_
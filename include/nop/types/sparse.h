@@ -0,0 +1,96 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_TYPES_SPARSE_H_
+#define LIBNOP_INCLUDE_NOP_TYPES_SPARSE_H_
+
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+namespace nop {
+
+// Sparse<Container> is a wrapper that opts a std::vector of integral or
+// floating point elements into a run-length encoding of its zeros. The
+// elements are encoded as alternating runs of zeros, stored as a count, and
+// runs of other elements, stored at full width. Vectors that are mostly zero,
+// such as histograms and sparse feature vectors, shrink to the size of their
+// non-zero elements.
+//
+// An element is zero when all of its bytes are zero, so negative zero floating
+// point elements round trip exactly.
+//
+// Because a short encoding may describe a very large vector, the decoded size
+// is limited to max_size() elements, kDefaultMaxSize unless set otherwise. Set
+// a limit suited to the data before reading untrusted input.
+//
+// The sparse encoding is not compatible with the default encoding of the
+// vector, so both sides must use the wrapper.
+//
+// Example:
+//
+//   nop::Sparse<std::vector<std::uint32_t>> histogram{std::move(counts)};
+//   auto status = serializer.Write(histogram);
+//
+//   nop::Sparse<std::vector<std::uint32_t>> received;
+//   received.set_max_size(1 << 20);
+//   status = deserializer.Read(&received);
+//
+template <typename Container>
+class Sparse {
+  using ElementType = typename Container::value_type;
+  static_assert(std::is_arithmetic<ElementType>::value &&
+                    !std::is_same<ElementType, bool>::value,
+                "Sparse element type must be integral or floating point, "
+                "other than bool.");
+
+ public:
+  using Type = Container;
+
+  // The default limit on the number of decoded elements.
+  enum : std::uint64_t { kDefaultMaxSize = 16 * 1024 * 1024 };
+
+  Sparse() = default;
+  Sparse(const Sparse&) = default;
+  Sparse(Sparse&&) = default;
+  Sparse(const Container& value) : value_{value} {}
+  Sparse(Container&& value) : value_{std::move(value)} {}
+
+  Sparse& operator=(const Sparse&) = default;
+  Sparse& operator=(Sparse&&) = default;
+
+  const Container& get() const { return value_; }
+  Container& get() { return value_; }
+  Container&& take() { return std::move(value_); }
+
+  const Container& operator*() const { return value_; }
+  Container& operator*() { return value_; }
+  const Container* operator->() const { return &value_; }
+  Container* operator->() { return &value_; }
+
+  // Limits the number of elements decoded into this value.
+  std::uint64_t max_size() const { return max_size_; }
+  void set_max_size(std::uint64_t max_size) { max_size_ = max_size; }
+
+ private:
+  Container value_{};
+  std::uint64_t max_size_{kDefaultMaxSize};
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_TYPES_SPARSE_H_
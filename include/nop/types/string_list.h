@@ -0,0 +1,171 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_TYPES_STRING_LIST_H_
+#define LIBNOP_INCLUDE_NOP_TYPES_STRING_LIST_H_
+
+#include <cstddef>
+#include <cstring>
+#include <initializer_list>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <nop/types/view.h>
+#include <nop/utility/default_init_allocator.h>
+
+namespace nop {
+
+// StringList is a list of strings stored in a single block of characters with
+// an array of end offsets. It serializes exactly like std::vector<std::string>
+// and is fungible with it, but decoding does not allocate a separate block for
+// every string: the characters of all strings are appended to the one block,
+// and the offsets array is reserved once from the encoded count.
+//
+// clear() and decoding over an existing list retain the capacity of both
+// blocks, so a list that is reused for each message reaches a steady state
+// where decoding does not allocate at all. Elements are returned as StringView
+// and remain valid until the list is modified.
+//
+// Example:
+//
+//   struct Event {
+//     std::uint64_t timestamp;
+//     nop::StringList tags;
+//     NOP_STRUCTURE(Event, timestamp, tags);
+//   };
+//
+//   for (nop::StringView tag : event.tags)
+//     Handle(tag);
+//
+class StringList {
+ public:
+  // Input iterator over the strings of the list.
+  class Iterator {
+   public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type = StringView;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = StringView;
+
+    Iterator() = default;
+
+    StringView operator*() const { return (*list_)[index_]; }
+
+    Iterator& operator++() {
+      index_++;
+      return *this;
+    }
+    Iterator operator++(int) {
+      Iterator iterator = *this;
+      index_++;
+      return iterator;
+    }
+
+    bool operator==(const Iterator& other) const {
+      return index_ == other.index_;
+    }
+    bool operator!=(const Iterator& other) const { return !(*this == other); }
+
+   private:
+    friend class StringList;
+    Iterator(const StringList* list, std::size_t index)
+        : list_{list}, index_{index} {}
+
+    const StringList* list_{nullptr};
+    std::size_t index_{0};
+  };
+
+  StringList() = default;
+  StringList(const StringList&) = default;
+  StringList(StringList&&) = default;
+  StringList(std::initializer_list<StringView> strings)
+      : StringList{strings.begin(), strings.end()} {}
+
+  // Builds a list from a range of values convertible to StringView, such as
+  // the elements of a std::vector<std::string>.
+  template <typename InputIterator>
+  StringList(InputIterator begin, InputIterator end) {
+    for (; begin != end; ++begin)
+      push_back(*begin);
+  }
+
+  StringList& operator=(const StringList&) = default;
+  StringList& operator=(StringList&&) = default;
+
+  std::size_t size() const { return ends_.size(); }
+  bool empty() const { return ends_.empty(); }
+
+  // Returns the total number of characters in all of the strings.
+  std::size_t size_bytes() const { return characters_.size(); }
+
+  StringView operator[](std::size_t index) const {
+    const std::size_t begin = index == 0 ? 0 : ends_[index - 1];
+    return {characters_.data() + begin, ends_[index] - begin};
+  }
+
+  Iterator begin() const { return {this, 0}; }
+  Iterator end() const { return {this, size()}; }
+
+  // Appends a copy of |string| to the list.
+  void push_back(StringView string) {
+    characters_.insert(characters_.end(), string.begin(), string.end());
+    ends_.push_back(characters_.size());
+  }
+
+  // Reserves storage for |count| strings with |size_bytes| characters in total.
+  void reserve(std::size_t count, std::size_t size_bytes) {
+    ends_.reserve(count);
+    characters_.reserve(size_bytes);
+  }
+
+  // Removes all of the strings, retaining the allocated storage.
+  void clear() {
+    ends_.clear();
+    characters_.clear();
+  }
+
+  // Copies the strings into a vector of owning strings.
+  std::vector<std::string> ToVector() const {
+    std::vector<std::string> strings;
+    strings.reserve(size());
+    for (StringView string : *this)
+      strings.push_back(string.ToString());
+    return strings;
+  }
+
+  bool operator==(const StringList& other) const {
+    return ends_ == other.ends_ &&
+           (characters_.empty() ||
+            std::memcmp(characters_.data(), other.characters_.data(),
+                        characters_.size()) == 0);
+  }
+  bool operator!=(const StringList& other) const { return !(*this == other); }
+
+ private:
+  template <typename, typename>
+  friend struct Encoding;
+
+  // Characters are not initialized before decoding overwrites them.
+  std::vector<char, DefaultInitAllocator<char>> characters_;
+  std::vector<std::size_t> ends_;
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_TYPES_STRING_LIST_H_
@@ -0,0 +1,84 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_TYPES_TIME_DELTAS_H_
+#define LIBNOP_INCLUDE_NOP_TYPES_TIME_DELTAS_H_
+
+#include <utility>
+
+namespace nop {
+
+// TimeDeltas<Container> is a wrapper that opts a std::vector of
+// std::chrono::time_point or std::chrono::duration values with an integral
+// representation into a compact encoding: the first element is stored in full
+// as the base, and every other element as its offset from the base.
+//
+// Timestamps of a batch of events are typically close to each other, so the
+// offsets fit the short integer encodings even when the timestamps themselves
+// need the full 64 bits. Each element is still decoded independently of the
+// others, other than the base.
+//
+// The delta encoding is not compatible with the default encoding of the
+// vector, so both sides must use the wrapper.
+//
+// Example:
+//
+//   using Clock = std::chrono::system_clock;
+//
+//   struct EventBatch {
+//     nop::TimeDeltas<std::vector<Clock::time_point>> timestamps;
+//     std::vector<std::uint32_t> codes;
+//     NOP_STRUCTURE(EventBatch, timestamps, codes);
+//   };
+//
+template <typename Container>
+class TimeDeltas {
+ public:
+  using Type = Container;
+
+  TimeDeltas() = default;
+  TimeDeltas(const TimeDeltas&) = default;
+  TimeDeltas(TimeDeltas&&) = default;
+  TimeDeltas(const Container& value) : value_{value} {}
+  TimeDeltas(Container&& value) : value_{std::move(value)} {}
+
+  TimeDeltas& operator=(const TimeDeltas&) = default;
+  TimeDeltas& operator=(TimeDeltas&&) = default;
+
+  const Container& get() const { return value_; }
+  Container& get() { return value_; }
+  Container&& take() { return std::move(value_); }
+
+  const Container& operator*() const { return value_; }
+  Container& operator*() { return value_; }
+  const Container* operator->() const { return &value_; }
+  Container* operator->() { return &value_; }
+
+  bool operator==(const TimeDeltas& other) const {
+    return value_ == other.value_;
+  }
+  bool operator!=(const TimeDeltas& other) const {
+    return value_ != other.value_;
+  }
+
+ private:
+  Container value_{};
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_TYPES_TIME_DELTAS_H_
@@ -0,0 +1,136 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_TYPES_VIEW_H_
+#define LIBNOP_INCLUDE_NOP_TYPES_VIEW_H_
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace nop {
+
+//
+// Borrowed types that refer to a range of memory owned by something else.
+//
+// BinaryView<T> and StringView serialize exactly like std::vector<T> and
+// std::string, respectively, but deserialize without copying the payload:
+// when the reader supports borrowing, the view is set to point directly into
+// the reader's input. This is intended for readers over memory that outlives
+// the decoded values, such as BufferReader and MmapReader. The referenced
+// memory must remain valid for as long as the view is in use.
+//
+
+// Borrowed view of a contiguous range of integral elements.
+//
+// Views decoded from an arbitrary input may not be suitably aligned for T.
+// Element access through operator[] and CopyTo() is safe for any alignment;
+// callers that dereference data() directly must ensure the alignment
+// themselves.
+template <typename T>
+class BinaryView {
+  static_assert(std::is_integral<T>::value,
+                "BinaryView element type must be integral.");
+
+ public:
+  using ValueType = T;
+
+  constexpr BinaryView() = default;
+  constexpr BinaryView(const BinaryView&) = default;
+  constexpr BinaryView(const T* data, std::size_t size)
+      : data_{data}, size_{size} {}
+  template <typename Allocator>
+  BinaryView(const std::vector<T, Allocator>& vector)
+      : data_{vector.data()}, size_{vector.size()} {}
+
+  constexpr BinaryView& operator=(const BinaryView&) = default;
+
+  constexpr const T* data() const { return data_; }
+  constexpr std::size_t size() const { return size_; }
+  constexpr std::size_t size_bytes() const { return size_ * sizeof(T); }
+  constexpr bool empty() const { return size_ == 0; }
+
+  constexpr const T* begin() const { return data_; }
+  constexpr const T* end() const { return data_ + size_; }
+
+  T operator[](std::size_t index) const {
+    T value;
+    std::memcpy(&value, data_ + index, sizeof(T));
+    return value;
+  }
+
+  // Copies the elements into an owning vector.
+  std::vector<T> CopyTo() const {
+    std::vector<T> vector(size_);
+    if (size_ != 0)
+      std::memcpy(vector.data(), data_, size_bytes());
+    return vector;
+  }
+
+  bool operator==(const BinaryView& other) const {
+    return size_ == other.size_ &&
+           (size_ == 0 || std::memcmp(data_, other.data_, size_bytes()) == 0);
+  }
+  bool operator!=(const BinaryView& other) const { return !(*this == other); }
+
+ private:
+  const T* data_{nullptr};
+  std::size_t size_{0};
+};
+
+// Borrowed view of a range of characters.
+class StringView {
+ public:
+  constexpr StringView() = default;
+  constexpr StringView(const StringView&) = default;
+  constexpr StringView(const char* data, std::size_t size)
+      : data_{data}, size_{size} {}
+  StringView(const char* string) : data_{string}, size_{std::strlen(string)} {}
+  template <typename Traits, typename Allocator>
+  StringView(const std::basic_string<char, Traits, Allocator>& string)
+      : data_{string.data()}, size_{string.size()} {}
+
+  constexpr StringView& operator=(const StringView&) = default;
+
+  constexpr const char* data() const { return data_; }
+  constexpr std::size_t size() const { return size_; }
+  constexpr std::size_t length() const { return size_; }
+  constexpr bool empty() const { return size_ == 0; }
+
+  constexpr const char* begin() const { return data_; }
+  constexpr const char* end() const { return data_ + size_; }
+
+  constexpr char operator[](std::size_t index) const { return data_[index]; }
+
+  // Copies the characters into an owning string.
+  std::string ToString() const { return {data_, size_}; }
+
+  bool operator==(const StringView& other) const {
+    return size_ == other.size_ &&
+           (size_ == 0 || std::memcmp(data_, other.data_, size_) == 0);
+  }
+  bool operator!=(const StringView& other) const { return !(*this == other); }
+
+ private:
+  const char* data_{nullptr};
+  std::size_t size_{0};
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_TYPES_VIEW_H_
@@ -0,0 +1,117 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_ANY_WRITER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_ANY_WRITER_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include <nop/base/serializer.h>
+#include <nop/base/utility.h>
+#include <nop/status.h>
+
+namespace nop {
+
+// AnyWriter is a type-erased writer that forwards every operation to a writer
+// of any type through a table of function pointers. Encoders instantiated for
+// AnyWriter are compiled once and shared by all writer types, trading an
+// indirect call per write for code size. This suits large types on cold paths,
+// such as configuration or diagnostics messages, particularly when combined
+// with NOP_DECLARE_ENCODING from nop/extern_encoding.h.
+//
+// Values of arithmetic type are forwarded to the underlying writer as bytes.
+// Handles are not supported.
+//
+// Example:
+//
+//   Status<void> WriteConfig(const Config& config, AnyWriter writer) {
+//     return Serializer<AnyWriter*>{&writer}.Write(config);
+//   }
+//
+//   StreamWriter<std::ostream*> stream_writer{&stream};
+//   auto status = WriteConfig(config, AnyWriter{&stream_writer});
+//
+class AnyWriter {
+ public:
+  AnyWriter() = default;
+  AnyWriter(const AnyWriter&) = default;
+  template <typename Writer>
+  AnyWriter(Writer* writer) : writer_{writer}, ops_{&OpsFor<Writer>()} {}
+
+  AnyWriter& operator=(const AnyWriter&) = default;
+
+  // Always prepare, since the needs of the underlying writer are not known.
+  static constexpr bool kNeedsPrepare = true;
+
+  Status<void> Prepare(std::size_t size) {
+    return ops_->prepare(writer_, size);
+  }
+
+  Status<void> Write(std::uint8_t byte) { return ops_->write(writer_, byte); }
+
+  template <typename T, typename Enable = EnableIfArithmetic<T>>
+  Status<void> Write(const T* begin, const T* end) {
+    return ops_->write_bytes(writer_,
+                             reinterpret_cast<const std::uint8_t*>(begin),
+                             reinterpret_cast<const std::uint8_t*>(end));
+  }
+
+  Status<void> Skip(std::size_t padding_bytes,
+                    std::uint8_t padding_value = 0x00) {
+    return ops_->skip(writer_, padding_bytes, padding_value);
+  }
+
+  explicit operator bool() const { return writer_ != nullptr; }
+
+ private:
+  struct Ops {
+    Status<void> (*prepare)(void* writer, std::size_t size);
+    Status<void> (*write)(void* writer, std::uint8_t byte);
+    Status<void> (*write_bytes)(void* writer, const std::uint8_t* begin,
+                                const std::uint8_t* end);
+    Status<void> (*skip)(void* writer, std::size_t padding_bytes,
+                         std::uint8_t padding_value);
+  };
+
+  template <typename Writer>
+  static const Ops& OpsFor() {
+    static const Ops ops{
+        [](void* writer, std::size_t size) {
+          return static_cast<Writer*>(writer)->Prepare(size);
+        },
+        [](void* writer, std::uint8_t byte) {
+          return static_cast<Writer*>(writer)->Write(byte);
+        },
+        [](void* writer, const std::uint8_t* begin, const std::uint8_t* end) {
+          return static_cast<Writer*>(writer)->Write(begin, end);
+        },
+        [](void* writer, std::size_t padding_bytes,
+           std::uint8_t padding_value) {
+          return static_cast<Writer*>(writer)->Skip(padding_bytes,
+                                                    padding_value);
+        }};
+    return ops;
+  }
+
+  void* writer_{nullptr};
+  const Ops* ops_{nullptr};
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_ANY_WRITER_H_
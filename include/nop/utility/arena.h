@@ -0,0 +1,213 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_ARENA_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_ARENA_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+namespace nop {
+
+//
+// Arena is a monotonic allocator: allocations bump a pointer within large
+// blocks and are never freed individually. All of the memory is released at
+// once when the arena is reset or destroyed. Decoding a message into
+// containers that allocate from an arena avoids the cost of a general purpose
+// allocator for every nested string and vector, and frees the whole message
+// in time proportional to the number of blocks rather than the number of
+// allocations.
+//
+// Containers use the arena through ArenaAllocator. Since the deserializer
+// default-constructs elements before decoding into them, a default-constructed
+// ArenaAllocator binds to the arena of the innermost active ArenaScope on the
+// current thread, or to the global heap when there is none. Deserializer
+// installs a scope for the duration of Read(value, arena):
+//
+//   template <typename T>
+//   using ArenaVector = std::vector<T, nop::ArenaAllocator<T>>;
+//   using ArenaString =
+//       std::basic_string<char, std::char_traits<char>,
+//                         nop::ArenaAllocator<char>>;
+//
+//   struct Request {
+//     ArenaString name;
+//     ArenaVector<ArenaString> arguments;
+//     NOP_STRUCTURE(Request, name, arguments);
+//   };
+//
+//   nop::Arena arena;
+//   Request request{ArenaString{&arena}, ArenaVector<ArenaString>{&arena}};
+//   auto status = deserializer.Read(&request, &arena);
+//
+// Values allocated from an arena must be destroyed before the arena is reset.
+// Arena is not thread safe.
+//
+class Arena {
+ public:
+  enum : std::size_t { kDefaultBlockSize = 4096 };
+
+  explicit Arena(std::size_t block_size = kDefaultBlockSize)
+      : block_size_{block_size} {}
+  Arena(const Arena&) = delete;
+  ~Arena() { Reset(); }
+
+  Arena& operator=(const Arena&) = delete;
+
+  // Returns |size| bytes of storage aligned to |alignment|, which must be a
+  // power of two no greater than alignof(std::max_align_t). Throws
+  // std::bad_alloc when the storage cannot be allocated.
+  void* Allocate(std::size_t size, std::size_t alignment) {
+    std::size_t offset = (offset_ + alignment - 1) & ~(alignment - 1);
+    if (!head_ || offset > head_->size || head_->size - offset < size) {
+      AddBlock(size);
+      offset = 0;
+    }
+
+    offset_ = offset + size;
+    allocated_ += size;
+    return head_->data() + offset;
+  }
+
+  // Releases all of the memory allocated from the arena.
+  void Reset() {
+    while (head_) {
+      Block* next = head_->next;
+      ::operator delete(head_);
+      head_ = next;
+    }
+    offset_ = 0;
+    allocated_ = 0;
+  }
+
+  // Returns the number of bytes allocated from the arena since the last reset.
+  std::size_t allocated() const { return allocated_; }
+
+  // Returns the arena of the innermost active ArenaScope on the current
+  // thread, or nullptr when there is none.
+  static Arena* Current() { return CurrentSlot(); }
+
+ private:
+  friend class ArenaScope;
+
+  struct alignas(std::max_align_t) Block {
+    Block* next;
+    std::size_t size;
+
+    std::uint8_t* data() { return reinterpret_cast<std::uint8_t*>(this + 1); }
+  };
+
+  static Arena*& CurrentSlot() {
+    static thread_local Arena* current = nullptr;
+    return current;
+  }
+
+  void AddBlock(std::size_t size) {
+    const std::size_t block_size = size > block_size_ ? size : block_size_;
+    if (block_size > std::numeric_limits<std::size_t>::max() - sizeof(Block))
+      throw std::bad_alloc{};
+
+    Block* block =
+        static_cast<Block*>(::operator new(sizeof(Block) + block_size));
+    block->next = head_;
+    block->size = block_size;
+    head_ = block;
+  }
+
+  std::size_t block_size_;
+  Block* head_{nullptr};
+  std::size_t offset_{0};
+  std::size_t allocated_{0};
+};
+
+// Makes |arena| the current arena of the thread for the lifetime of the scope.
+// Scopes may be nested; the previous arena is restored on destruction.
+class ArenaScope {
+ public:
+  explicit ArenaScope(Arena* arena) : previous_{Arena::CurrentSlot()} {
+    Arena::CurrentSlot() = arena;
+  }
+  ArenaScope(const ArenaScope&) = delete;
+  ~ArenaScope() { Arena::CurrentSlot() = previous_; }
+
+  ArenaScope& operator=(const ArenaScope&) = delete;
+
+ private:
+  Arena* previous_;
+};
+
+// Standard allocator that allocates from an Arena, or from the global heap
+// when it is not bound to an arena. Deallocation is a no-op for arena memory.
+// Allocators compare equal when they are bound to the same arena, and they
+// propagate when containers are moved or swapped, so that moving elements
+// between containers of the same arena never copies.
+template <typename T>
+class ArenaAllocator {
+ public:
+  using value_type = T;
+  using propagate_on_container_copy_assignment = std::false_type;
+  using propagate_on_container_move_assignment = std::true_type;
+  using propagate_on_container_swap = std::true_type;
+
+  // Binds to the current arena of the thread, if any.
+  ArenaAllocator() noexcept : arena_{Arena::Current()} {}
+  ArenaAllocator(Arena* arena) noexcept : arena_{arena} {}
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U>& other) noexcept
+      : arena_{other.arena()} {}
+
+  T* allocate(std::size_t count) {
+    if (!arena_)
+      return std::allocator<T>{}.allocate(count);
+    else if (count > std::numeric_limits<std::size_t>::max() / sizeof(T))
+      throw std::bad_alloc{};
+    else
+      return static_cast<T*>(arena_->Allocate(count * sizeof(T), alignof(T)));
+  }
+
+  void deallocate(T* pointer, std::size_t count) noexcept {
+    if (!arena_)
+      std::allocator<T>{}.deallocate(pointer, count);
+  }
+
+  Arena* arena() const { return arena_; }
+
+  // Copies of containers bind to the current arena rather than the arena of
+  // the source, so that copying a value out of an arena is safe.
+  ArenaAllocator select_on_container_copy_construction() const {
+    return ArenaAllocator{};
+  }
+
+ private:
+  Arena* arena_;
+};
+
+template <typename T, typename U>
+bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) {
+  return a.arena() == b.arena();
+}
+template <typename T, typename U>
+bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) {
+  return a.arena() != b.arena();
+}
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_ARENA_H_
@@ -20,10 +20,15 @@
 #include <cstddef>
 #include <cstdint>
 #include <iterator>
+#include <memory>
+#include <utility>
 
 #include <nop/base/encoding.h>
 #include <nop/base/handle.h>
+#include <nop/base/pointer.h>
 #include <nop/base/utility.h>
+#include <nop/types/interned.h>
+#include <nop/utility/reuse_storage.h>
 
 namespace nop {
 
@@ -92,6 +97,26 @@ class BoundedReader {
     return {};
   }
 
+  // Only available when the underlying reader supports borrowing.
+  template <typename R = Reader, typename Enabled = ReaderBorrowTest<R>>
+  constexpr Status<void> Borrow(std::size_t size, const void** data) {
+    if (size > (size_ - index_))
+      return ErrorStatus::ReadLimitReached;
+
+    auto status = reader_->Borrow(size, data);
+    if (!status)
+      return status;
+
+    index_ += size;
+    return {};
+  }
+
+  static constexpr bool kReuseStorage = ReaderReusesStorage<Reader>::value;
+  static constexpr bool kBorrowToCopy = ReaderBorrowsToCopy<Reader>::value;
+
+  // Returns the number of bytes that may still be read within the limit.
+  constexpr std::size_t remaining() const { return size_ - index_; }
+
   // Skips any bytes remaining in the limit set at construction.
   constexpr Status<void> ReadPadding() {
     const std::size_t padding_bytes = size_ - index_;
@@ -103,9 +128,46 @@ class BoundedReader {
     return {};
   }
 
+  // Forwards the profiling hooks of the underlying reader, so that values
+  // nested in table entries are profiled.
+  static constexpr bool kProfileEncodings = ProfilesEncodings<Reader>::value;
+
+  template <typename T>
+  void EnterEncoding() {
+    reader_->template EnterEncoding<T>();
+  }
+
+  template <typename T>
+  void ExitEncoding(const Status<void>& status) {
+    reader_->template ExitEncoding<T>(status);
+  }
+
   template <typename HandleType>
   constexpr Status<HandleType> GetHandle(HandleReference handle_reference) {
-    return reader_->GetHandle(handle_reference);
+    return reader_->template GetHandle<HandleType>(handle_reference);
+  }
+
+  // Forwards the string and pointer tables of the underlying reader, so that
+  // Interned<String> and std::shared_ptr values may be nested in table entries.
+  template <typename R = Reader, typename Enabled = ReaderDefineStringTest<R>>
+  Status<void> DefineString(StringView string) {
+    return reader_->DefineString(string);
+  }
+
+  template <typename R = Reader, typename Enabled = ReaderGetStringTest<R>>
+  Status<StringView> GetString(StringReference reference) {
+    return reader_->GetString(reference);
+  }
+
+  template <typename R = Reader, typename Enabled = ReaderDefinePointerTest<R>>
+  Status<void> DefinePointer(std::shared_ptr<void> pointer, PointerType type) {
+    return reader_->DefinePointer(std::move(pointer), type);
+  }
+
+  template <typename R = Reader, typename Enabled = ReaderGetPointerTest<R>>
+  Status<std::shared_ptr<void>> GetPointer(PointerReference reference,
+                                           PointerType type) {
+    return reader_->GetPointer(reference, type);
   }
 
   constexpr bool empty() const { return index_ == size_; }
@@ -20,10 +20,15 @@
 #include <cstddef>
 #include <cstdint>
 #include <iterator>
+#include <memory>
 
 #include <nop/base/encoding.h>
 #include <nop/base/handle.h>
+#include <nop/base/pointer.h>
 #include <nop/base/utility.h>
+#include <nop/types/interned.h>
+#include <nop/utility/canonical.h>
+#include <nop/utility/exact_table_entries.h>
 
 namespace nop {
 
@@ -103,11 +108,54 @@ class BoundedWriter {
     return {};
   }
 
+  // Preserve the canonical mode of the underlying writer.
+  static constexpr bool kCanonical = WriterIsCanonical<Writer>::value;
+
+  // Forwards patching to the underlying writer. Offsets are relative to the
+  // start of the underlying writer, rather than the bounded region.
+  static constexpr bool kExactTableEntries =
+      WriterExactTableEntries<Writer>::value;
+
+  constexpr std::size_t offset() const { return writer_->offset(); }
+
+  constexpr Status<void> Patch(std::size_t offset, const std::uint8_t* begin,
+                               const std::uint8_t* end) {
+    return writer_->Patch(offset, begin, end);
+  }
+
+  // Forwards the profiling hooks of the underlying writer, so that values
+  // nested in table entries are profiled.
+  static constexpr bool kProfileEncodings = ProfilesEncodings<Writer>::value;
+
+  template <typename T>
+  void EnterEncoding(const T& value) {
+    writer_->template EnterEncoding<T>(value);
+  }
+
+  template <typename T>
+  void ExitEncoding(const Status<void>& status) {
+    writer_->template ExitEncoding<T>(status);
+  }
+
   template <typename HandleType>
-  constexpr Status<HandleType> PushHandle(const HandleType& handle) {
+  constexpr Status<HandleReference> PushHandle(const HandleType& handle) {
     return writer_->PushHandle(handle);
   }
 
+  // Forwards the string and pointer tables of the underlying writer, so that
+  // Interned<String> and std::shared_ptr values may be nested in table entries.
+  template <typename W = Writer, typename Enabled = WriterInternStringTest<W>>
+  Status<StringReference> InternString(StringView string) {
+    return writer_->InternString(string);
+  }
+
+  template <typename T, typename W = Writer,
+            typename Enabled = WriterInternPointerTest<W>>
+  Status<PointerReference> InternPointer(const std::shared_ptr<T>& pointer,
+                                         PointerType type) {
+    return writer_->InternPointer(pointer, type);
+  }
+
   constexpr std::size_t size() const { return index_; }
   constexpr std::size_t capacity() const { return size_; }
 
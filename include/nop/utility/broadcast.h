@@ -0,0 +1,329 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_BROADCAST_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_BROADCAST_H_
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <nop/base/serializer.h>
+#include <nop/status.h>
+#include <nop/utility/vector_writer.h>
+
+namespace nop {
+
+// SharedMessage is an immutable serialized message in a reference-counted
+// buffer. Copies share the buffer, so a message that is encoded once may be
+// queued for any number of destinations without copying or encoding it again.
+//
+// Example:
+//
+//   auto message = SharedMessage::Encode(update);
+//   if (!message)
+//     return message.error();
+//
+//   for (auto& writer : writers)
+//     message.get().WriteTo(&writer);
+//
+class SharedMessage {
+ public:
+  SharedMessage() = default;
+
+  // Takes |bytes|, which hold one or more complete serialized values.
+  explicit SharedMessage(std::vector<std::uint8_t> bytes)
+      : buffer_{std::make_shared<const std::vector<std::uint8_t>>(
+            std::move(bytes))} {}
+
+  // Serializes |value| into a new message.
+  template <typename T>
+  static Status<SharedMessage> Encode(const T& value) {
+    VectorWriter writer;
+    auto status = SerializerCommon::Write(value, &writer);
+    if (!status)
+      return status.error();
+
+    return SharedMessage{writer.Take()};
+  }
+
+  // Writes the message to |writer| as one prepared write.
+  template <typename Writer>
+  Status<void> WriteTo(Writer* writer) const {
+    auto status = writer->Prepare(size());
+    if (!status)
+      return status;
+
+    return writer->Write(data(), data() + size());
+  }
+
+  const std::uint8_t* data() const {
+    return buffer_ ? buffer_->data() : nullptr;
+  }
+  std::size_t size() const { return buffer_ ? buffer_->size() : 0; }
+  bool empty() const { return size() == 0; }
+
+  // Returns the number of messages sharing the buffer.
+  long use_count() const { return buffer_.use_count(); }
+
+ private:
+  std::shared_ptr<const std::vector<std::uint8_t>> buffer_;
+};
+
+// FdBroadcaster delivers SharedMessages to many file descriptors, such as the
+// sockets of the subscribers of a topic, without blocking on slow
+// destinations. Each destination has a queue of pending messages; Publish()
+// appends the message to every queue and immediately writes as much of each
+// queue as the destination accepts, gathering the queued messages into one
+// writev()-style call per destination.
+//
+// A destination whose queue would grow beyond |max_queued_bytes| drops the
+// message instead, and a destination whose fd reports an error other than
+// EAGAIN stops receiving messages. Both are reported per destination, so that
+// the caller can disconnect slow or failed subscribers. Destinations with
+// queued bytes are flushed by calling Flush() when their fds become writable.
+//
+// Destination fds are switched to non-blocking mode and are not owned by the
+// broadcaster. Sockets are written with MSG_NOSIGNAL, so that a closed peer
+// results in an error instead of SIGPIPE. This class is not thread safe.
+//
+// Example:
+//
+//   FdBroadcaster broadcaster;
+//   broadcaster.Add(subscriber_fd);
+//
+//   auto message = SharedMessage::Encode(update);
+//   auto result = broadcaster.Publish(message.get());
+//   if (result.dropped != 0 || result.failed != 0)
+//     DisconnectSlowSubscribers(&broadcaster);
+//
+class FdBroadcaster {
+ public:
+  // Default limit on the bytes queued for each destination.
+  enum : std::size_t { kDefaultMaxQueuedBytes = 4 * 1024 * 1024 };
+
+  // Summary of a call to Publish() or Flush().
+  struct Result {
+    std::size_t written{0};  // Destinations whose queue was fully written.
+    std::size_t queued{0};   // Destinations with bytes still queued.
+    std::size_t dropped{0};  // Destinations that dropped the message.
+    std::size_t failed{0};   // Destinations that have failed.
+  };
+
+  // State of a single destination.
+  struct Stats {
+    std::size_t queued_bytes{0};
+    std::size_t queued_messages{0};
+    std::size_t dropped_messages{0};
+    ErrorStatus error{ErrorStatus::None};
+  };
+
+  explicit FdBroadcaster(std::size_t max_queued_bytes = kDefaultMaxQueuedBytes)
+      : max_queued_bytes_{max_queued_bytes} {}
+
+  FdBroadcaster(const FdBroadcaster&) = delete;
+  void operator=(const FdBroadcaster&) = delete;
+
+  // Adds |fd| as a destination and switches it to non-blocking mode.
+  Status<void> Add(int fd) {
+    const int flags = ::fcntl(fd, F_GETFL);
+    if (flags < 0 || ::fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0)
+      return ErrorStatus::IOError;
+
+    destinations_[fd];
+    return {};
+  }
+
+  // Removes |fd| and discards the messages queued for it.
+  void Remove(int fd) { destinations_.erase(fd); }
+
+  // Queues |message| for every destination that has not failed and writes as
+  // much as possible without blocking.
+  Result Publish(const SharedMessage& message) {
+    Result result;
+    for (auto& entry : destinations_) {
+      Destination& destination = entry.second;
+      if (destination.stats.error != ErrorStatus::None) {
+        result.failed++;
+        continue;
+      }
+
+      if (destination.stats.queued_bytes + message.size() >
+          max_queued_bytes_) {
+        destination.stats.dropped_messages++;
+        result.dropped++;
+      } else if (!message.empty()) {
+        destination.queue.push_back(message);
+        destination.stats.queued_bytes += message.size();
+        destination.stats.queued_messages++;
+      }
+
+      Transmit(entry.first, &destination, &result);
+    }
+    return result;
+  }
+
+  // Writes as much of the queue of every destination as possible without
+  // blocking.
+  Result Flush() {
+    Result result;
+    for (auto& entry : destinations_) {
+      if (entry.second.stats.error != ErrorStatus::None)
+        result.failed++;
+      else
+        Transmit(entry.first, &entry.second, &result);
+    }
+    return result;
+  }
+
+  // Writes as much of the queue of |fd| as possible without blocking.
+  Result Flush(int fd) {
+    Result result;
+    auto search = destinations_.find(fd);
+    if (search != destinations_.end()) {
+      if (search->second.stats.error != ErrorStatus::None)
+        result.failed++;
+      else
+        Transmit(fd, &search->second, &result);
+    }
+    return result;
+  }
+
+  // Returns the state of |fd|, or ErrorStatus::ProtocolError if |fd| is not a
+  // destination.
+  Status<Stats> GetStats(int fd) const {
+    auto search = destinations_.find(fd);
+    if (search == destinations_.end())
+      return ErrorStatus::ProtocolError;
+    else
+      return search->second.stats;
+  }
+
+  // Calls |callback| with the fd and Stats of each destination.
+  template <typename Callback>
+  void ForEach(Callback&& callback) const {
+    for (const auto& entry : destinations_)
+      callback(entry.first, entry.second.stats);
+  }
+
+  std::size_t size() const { return destinations_.size(); }
+  std::size_t max_queued_bytes() const { return max_queued_bytes_; }
+
+ private:
+  struct Destination {
+    std::deque<SharedMessage> queue;
+    std::size_t offset{0};  // Bytes of the front message already written.
+    bool is_socket{true};
+    Stats stats;
+  };
+
+  // Writes the queue of |destination| until it is empty or the fd would block,
+  // and records the outcome in |result|.
+  void Transmit(int fd, Destination* destination, Result* result) {
+    while (!destination->queue.empty()) {
+      iovecs_.clear();
+      std::size_t offset = destination->offset;
+      for (const SharedMessage& message : destination->queue) {
+        if (iovecs_.size() == IOV_MAX)
+          break;
+
+        iovecs_.push_back({const_cast<std::uint8_t*>(message.data()) + offset,
+                           message.size() - offset});
+        offset = 0;
+      }
+
+      const ssize_t ret = Write(fd, destination);
+      if (ret < 0) {
+        if (errno == EINTR) {
+          continue;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+          result->queued++;
+          return;
+        }
+
+        Fail(destination, ErrorStatus::IOError);
+        result->failed++;
+        return;
+      } else if (ret == 0) {
+        Fail(destination, ErrorStatus::WriteLimitReached);
+        result->failed++;
+        return;
+      }
+
+      Advance(destination, ret);
+    }
+    result->written++;
+  }
+
+  // Writes the gathered iovecs, falling back to writev() for fds that are not
+  // sockets.
+  ssize_t Write(int fd, Destination* destination) {
+    const int count = static_cast<int>(iovecs_.size());
+    if (destination->is_socket) {
+      msghdr message = {};
+      message.msg_iov = iovecs_.data();
+      message.msg_iovlen = count;
+      const ssize_t ret = ::sendmsg(fd, &message, MSG_NOSIGNAL);
+      if (ret >= 0 || errno != ENOTSOCK)
+        return ret;
+
+      destination->is_socket = false;
+    }
+    return ::writev(fd, iovecs_.data(), count);
+  }
+
+  // Releases the messages that were completely written by a transfer of
+  // |transferred| bytes.
+  static void Advance(Destination* destination, std::size_t transferred) {
+    destination->stats.queued_bytes -= transferred;
+    transferred += destination->offset;
+    while (!destination->queue.empty() &&
+           transferred >= destination->queue.front().size()) {
+      transferred -= destination->queue.front().size();
+      destination->queue.pop_front();
+      destination->stats.queued_messages--;
+    }
+    destination->offset = transferred;
+  }
+
+  static void Fail(Destination* destination, ErrorStatus error) {
+    destination->stats.error = error;
+    destination->stats.queued_bytes = 0;
+    destination->stats.queued_messages = 0;
+    destination->queue.clear();
+    destination->offset = 0;
+  }
+
+  std::size_t max_queued_bytes_;
+  std::unordered_map<int, Destination> destinations_;
+  std::vector<iovec> iovecs_;
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_BROADCAST_H_
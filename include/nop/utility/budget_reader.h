@@ -0,0 +1,254 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_BUDGET_READER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_BUDGET_READER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+#include <nop/base/encoding.h>
+#include <nop/base/handle.h>
+#include <nop/base/pointer.h>
+#include <nop/base/skip.h>
+#include <nop/base/utility.h>
+#include <nop/types/interned.h>
+#include <nop/utility/reuse_storage.h>
+
+namespace nop {
+
+// Limits on the resources a BudgetReader allows decoding to consume.
+struct DecodeBudget {
+  // Maximum number of bytes of decoded storage. See BudgetReader.
+  std::size_t max_bytes{std::numeric_limits<std::size_t>::max()};
+
+  // Maximum number of encoded values, top-level and nested, including each
+  // element of every container and the length prefixes of containers.
+  std::size_t max_values{std::numeric_limits<std::size_t>::max()};
+
+  // Maximum nesting depth of values. A top-level integer has depth one, and the
+  // length prefix of a container is nested in the container.
+  std::size_t max_depth{kDefaultMaxValueDepth};
+};
+
+// BudgetReader is a reader type that wraps another reader pointer and bounds
+// the memory and work a single decode may cause, as a defense against hostile
+// input that is valid in size but expensive to decode, such as deeply nested
+// variants or maps with millions of tiny elements.
+//
+// The reader observes the entry to every value through the encoding hooks of
+// kProfileEncodings, and charges the budget as follows:
+//
+//  * Each value counts against |max_values| and adds sizeof(T) bytes of storage
+//    for its type T.
+//  * Each bulk payload checked with Ensure(), such as the characters of a
+//    string or the elements of an integral vector, adds its size in bytes.
+//  * Each nested value counts against |max_depth| while it is being decoded.
+//
+// The charged bytes bound the storage the decoded value can hold, up to the
+// growth factor of its containers. BudgetReader does not report the bytes
+// remaining in the input, so that containers grow as their elements are
+// decoded and charged instead of reserving storage up front.
+//
+// Once a limit is exceeded every subsequent operation fails, so the decode
+// stops at the next read with ErrorStatus::BudgetExceeded, or with
+// ErrorStatus::DepthLimitReached for the depth limit. Call Reset() before
+// decoding the next message with the same budget.
+//
+// Example:
+//
+//   DecodeBudget budget;
+//   budget.max_bytes = 1 << 20;
+//   budget.max_values = 10000;
+//   budget.max_depth = 16;
+//
+//   BufferReader buffer_reader{data, size};
+//   BudgetReader<BufferReader> budget_reader{&buffer_reader, budget};
+//   Deserializer<BudgetReader<BufferReader>*> deserializer{&budget_reader};
+//   auto status = deserializer.Read(&request);
+//
+template <typename Reader>
+class BudgetReader {
+ public:
+  BudgetReader() = default;
+  BudgetReader(Reader* reader, const DecodeBudget& budget)
+      : reader_{reader}, budget_{budget} {}
+
+  BudgetReader(const BudgetReader&) = delete;
+  void operator=(const BudgetReader&) = delete;
+
+  static constexpr bool kProfileEncodings = true;
+
+  template <typename T>
+  void EnterEncoding() {
+    depth_++;
+    values_++;
+    if (depth_ > budget_.max_depth)
+      Fail(ErrorStatus::DepthLimitReached);
+    else if (values_ > budget_.max_values)
+      Fail(ErrorStatus::BudgetExceeded);
+    else
+      Charge(sizeof(T));
+
+    Enter<T>(ProfilesEncodings<Reader>{});
+  }
+
+  template <typename T>
+  void ExitEncoding(const Status<void>& status) {
+    depth_--;
+    Exit<T>(status, ProfilesEncodings<Reader>{});
+  }
+
+  Status<void> Ensure(std::size_t size) {
+    Charge(size);
+    if (!status_)
+      return status_;
+    return reader_->Ensure(size);
+  }
+
+  Status<void> Read(std::uint8_t* byte) {
+    if (!status_)
+      return status_;
+    return reader_->Read(byte);
+  }
+
+  template <typename T, typename Enable = EnableIfArithmetic<T>>
+  Status<void> Read(T* begin, T* end) {
+    if (!status_)
+      return status_;
+    return reader_->Read(begin, end);
+  }
+
+  Status<void> Skip(std::size_t padding_bytes) {
+    if (!status_)
+      return status_;
+    return reader_->Skip(padding_bytes);
+  }
+
+  // Only available when the underlying reader supports borrowing.
+  template <typename R = Reader, typename Enabled = ReaderBorrowTest<R>>
+  Status<void> Borrow(std::size_t size, const void** data) {
+    if (!status_)
+      return status_;
+    return reader_->Borrow(size, data);
+  }
+
+  static constexpr bool kReuseStorage = ReaderReusesStorage<Reader>::value;
+  static constexpr bool kBorrowToCopy = ReaderBorrowsToCopy<Reader>::value;
+
+  template <typename HandleType>
+  Status<HandleType> GetHandle(HandleReference handle_reference) {
+    if (!status_)
+      return status_.error();
+    return reader_->template GetHandle<HandleType>(handle_reference);
+  }
+
+  // The string and pointer tables are kept by the underlying reader; these
+  // methods fail once the budget is exceeded, like the other operations.
+  template <typename R = Reader, typename Enabled = ReaderDefineStringTest<R>>
+  Status<void> DefineString(StringView string) {
+    if (!status_)
+      return status_.error();
+    return reader_->DefineString(string);
+  }
+
+  template <typename R = Reader, typename Enabled = ReaderGetStringTest<R>>
+  Status<StringView> GetString(StringReference reference) {
+    if (!status_)
+      return status_.error();
+    return reader_->GetString(reference);
+  }
+
+  template <typename R = Reader, typename Enabled = ReaderDefinePointerTest<R>>
+  Status<void> DefinePointer(std::shared_ptr<void> pointer, PointerType type) {
+    if (!status_)
+      return status_.error();
+    return reader_->DefinePointer(std::move(pointer), type);
+  }
+
+  template <typename R = Reader, typename Enabled = ReaderGetPointerTest<R>>
+  Status<std::shared_ptr<void>> GetPointer(PointerReference reference,
+                                           PointerType type) {
+    if (!status_)
+      return status_.error();
+    return reader_->GetPointer(reference, type);
+  }
+
+  // Clears the resources charged so far, so that the next message is decoded
+  // with the full budget.
+  void Reset() {
+    status_ = {};
+    bytes_ = 0;
+    values_ = 0;
+    depth_ = 0;
+  }
+
+  // Returns the error that stopped decoding, or success if the budget has not
+  // been exceeded.
+  Status<void> status() const { return status_; }
+
+  // Returns the resources charged since construction or the last Reset().
+  std::size_t bytes() const { return bytes_; }
+  std::size_t values() const { return values_; }
+
+  const DecodeBudget& budget() const { return budget_; }
+  const Reader* reader() const { return reader_; }
+  Reader* reader() { return reader_; }
+
+ private:
+  void Fail(ErrorStatus error) {
+    if (status_)
+      status_ = error;
+  }
+
+  void Charge(std::size_t size) {
+    if (size > budget_.max_bytes - bytes_)
+      Fail(ErrorStatus::BudgetExceeded);
+    else
+      bytes_ += size;
+  }
+
+  // Forwards the hooks to underlying readers that also observe encodings.
+  template <typename T>
+  void Enter(std::true_type) {
+    reader_->template EnterEncoding<T>();
+  }
+  template <typename T>
+  void Enter(std::false_type) {}
+
+  template <typename T>
+  void Exit(const Status<void>& status, std::true_type) {
+    reader_->template ExitEncoding<T>(status);
+  }
+  template <typename T>
+  void Exit(const Status<void>& /*status*/, std::false_type) {}
+
+  Reader* reader_{nullptr};
+  DecodeBudget budget_;
+  Status<void> status_;
+  std::size_t bytes_{0};
+  std::size_t values_{0};
+  std::size_t depth_{0};
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_BUDGET_READER_H_
@@ -0,0 +1,261 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_BUFFER_POOL_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_BUFFER_POOL_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include <nop/status.h>
+#include <nop/types/optional.h>
+#include <nop/types/thread_local.h>
+#include <nop/utility/vector_writer.h>
+
+namespace nop {
+
+// BufferPool is a per-thread pool of byte buffers that retain their capacity
+// between uses. It allows serializers and deserializers that are constructed
+// for each request to reach a steady state where they do not allocate.
+//
+// To keep a single large message from pinning memory indefinitely, the pool
+// tracks the high-water mark of the sizes actually used in each window of
+// |trim_interval| releases. Buffers with more than twice the greater of the
+// high-water marks of the current and previous windows are freed instead of
+// retained, which leaves room for geometric growth while returning the memory
+// used by an outlier to the allocator within two windows once the sizes drop
+// back down.
+//
+// Most code uses the pool indirectly through PooledWriter and PooledBuffer.
+class BufferPool {
+ public:
+  // Default limits of the pool.
+  enum : std::size_t { kDefaultMaxBuffers = 4, kDefaultTrimInterval = 64 };
+
+  BufferPool() = default;
+  BufferPool(BufferPool&&) = default;
+  BufferPool& operator=(BufferPool&&) = default;
+
+  // Returns the pool of the calling thread.
+  static BufferPool& Get() {
+    return ThreadLocal<BufferPool, ThreadLocalTypeSlot<BufferPool>>{InPlace{}}
+        .Get();
+  }
+
+  // Sets the maximum number of idle buffers to retain and the number of
+  // releases in each high-water mark window.
+  void SetLimits(std::size_t max_buffers, std::size_t trim_interval) {
+    max_buffers_ = max_buffers;
+    trim_interval_ = trim_interval > 0 ? trim_interval : 1;
+    Trim();
+  }
+
+  // Takes a buffer from the pool, or returns an empty buffer if the pool is
+  // empty. The contents of the buffer are unspecified.
+  std::vector<std::uint8_t> Acquire() {
+    if (buffers_.empty())
+      return {};
+
+    std::vector<std::uint8_t> buffer = std::move(buffers_.back());
+    buffers_.pop_back();
+    return buffer;
+  }
+
+  // Returns |buffer| to the pool. |used_size| is the largest number of bytes
+  // the buffer held while in use, which feeds the high-water mark.
+  void Release(std::vector<std::uint8_t>&& buffer, std::size_t used_size) {
+    // Moved-from owners release buffers without storage.
+    if (buffer.capacity() == 0)
+      return;
+
+    if (used_size > high_water_)
+      high_water_ = used_size;
+
+    if (++releases_ >= trim_interval_) {
+      previous_high_water_ = high_water_;
+      high_water_ = 0;
+      releases_ = 0;
+      Trim();
+    }
+
+    if (buffer.capacity() > limit() || buffers_.size() >= max_buffers_)
+      return;
+
+    buffers_.push_back(std::move(buffer));
+  }
+
+  // Frees the buffers that exceed the current limits.
+  void Trim() {
+    const std::size_t max_capacity = limit();
+    std::size_t count = 0;
+    for (std::size_t i = 0; i < buffers_.size(); i++) {
+      if (buffers_[i].capacity() <= max_capacity && count < max_buffers_) {
+        if (i != count)
+          buffers_[count] = std::move(buffers_[i]);
+        count++;
+      }
+    }
+    buffers_.resize(count);
+  }
+
+  // Frees all idle buffers.
+  void Clear() { buffers_.clear(); }
+
+  // Returns the largest capacity of buffer that the pool retains.
+  std::size_t limit() const {
+    return 2 * (high_water_ > previous_high_water_ ? high_water_
+                                                   : previous_high_water_);
+  }
+
+  // Returns the number of idle buffers in the pool.
+  std::size_t size() const { return buffers_.size(); }
+
+  // Returns the total capacity of the idle buffers in the pool.
+  std::size_t retained() const {
+    std::size_t total = 0;
+    for (const auto& buffer : buffers_)
+      total += buffer.capacity();
+    return total;
+  }
+
+ private:
+  BufferPool(const BufferPool&) = delete;
+  void operator=(const BufferPool&) = delete;
+
+  std::vector<std::vector<std::uint8_t>> buffers_;
+  std::size_t max_buffers_{kDefaultMaxBuffers};
+  std::size_t trim_interval_{kDefaultTrimInterval};
+  std::size_t releases_{0};
+  std::size_t high_water_{0};
+  std::size_t previous_high_water_{0};
+};
+
+// PooledWriter is a VectorWriter that takes its storage from the BufferPool of
+// the constructing thread and returns it to the pool of the destroying thread.
+//
+// Example:
+//
+//   Status<void> SendReply(const Reply& reply) {
+//     Serializer<PooledWriter> serializer;
+//     auto status = serializer.Write(reply);
+//     if (!status)
+//       return status;
+//
+//     const auto& writer = serializer.writer();
+//     return Send(writer.data(), writer.size());
+//   }
+//
+class PooledWriter : public VectorWriter {
+ public:
+  PooledWriter() : VectorWriter{BufferPool::Get().Acquire()} {}
+  PooledWriter(PooledWriter&& other) { *this = std::move(other); }
+  ~PooledWriter() { Release(); }
+
+  PooledWriter& operator=(PooledWriter&& other) {
+    if (this != &other) {
+      Release();
+      VectorWriter::operator=(std::move(other));
+      high_water_ = other.high_water_;
+      other.TakeStorage();
+      other.high_water_ = 0;
+    }
+    return *this;
+  }
+
+  Status<void> Prepare(std::size_t size) {
+    if (offset() + size > high_water_)
+      high_water_ = offset() + size;
+    return VectorWriter::Prepare(size);
+  }
+
+ private:
+  PooledWriter(const PooledWriter&) = delete;
+  void operator=(const PooledWriter&) = delete;
+
+  void Release() {
+    if (offset() > high_water_)
+      high_water_ = offset();
+    BufferPool::Get().Release(TakeStorage(), high_water_);
+    high_water_ = 0;
+  }
+
+  std::size_t high_water_{0};
+};
+
+// PooledBuffer is a byte buffer taken from the BufferPool of the constructing
+// thread and returned to the pool of the destroying thread. It is intended for
+// input that is received into memory and then decoded with a BufferReader.
+//
+// Example:
+//
+//   PooledBuffer buffer{message_size};
+//   auto status = Receive(buffer.data(), buffer.size());
+//   if (!status)
+//     return status;
+//
+//   Deserializer<BufferReader> deserializer{buffer.data(), buffer.size()};
+//   return deserializer.Read(&request);
+//
+class PooledBuffer {
+ public:
+  PooledBuffer() : buffer_{BufferPool::Get().Acquire()} { buffer_.clear(); }
+  explicit PooledBuffer(std::size_t size) : PooledBuffer{} { resize(size); }
+  PooledBuffer(PooledBuffer&& other) { *this = std::move(other); }
+  ~PooledBuffer() { Release(); }
+
+  PooledBuffer& operator=(PooledBuffer&& other) {
+    if (this != &other) {
+      Release();
+      buffer_ = std::move(other.buffer_);
+      high_water_ = other.high_water_;
+      other.buffer_.clear();
+      other.high_water_ = 0;
+    }
+    return *this;
+  }
+
+  // Resizes the buffer. The contents of the buffer beyond the previous size are
+  // unspecified.
+  void resize(std::size_t size) {
+    buffer_.resize(size);
+    if (size > high_water_)
+      high_water_ = size;
+  }
+
+  const std::uint8_t* data() const { return buffer_.data(); }
+  std::uint8_t* data() { return buffer_.data(); }
+  std::size_t size() const { return buffer_.size(); }
+  std::size_t capacity() const { return buffer_.capacity(); }
+
+ private:
+  PooledBuffer(const PooledBuffer&) = delete;
+  void operator=(const PooledBuffer&) = delete;
+
+  void Release() {
+    BufferPool::Get().Release(std::move(buffer_), high_water_);
+    buffer_ = {};
+    high_water_ = 0;
+  }
+
+  std::vector<std::uint8_t> buffer_;
+  std::size_t high_water_{0};
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_BUFFER_POOL_H_
@@ -71,6 +71,22 @@ class BufferReader {
     return {};
   }
 
+  // Returns a pointer to the next |size| bytes of the buffer without advancing
+  // past them. Used to decode arrays of fixed size elements from known offsets.
+  Status<void> Peek(std::size_t /*size*/, const void** data) const {
+    *data = buffer_ + index_;
+    return {};
+  }
+
+  // Returns a pointer to the next |size| bytes of the buffer and advances past
+  // them. Used to decode borrowed types, such as BinaryView and StringView,
+  // without copying.
+  Status<void> Borrow(std::size_t size, const void** data) {
+    *data = buffer_ + index_;
+    index_ += size;
+    return {};
+  }
+
   bool empty() const { return index_ == size_; }
 
   std::size_t remaining() const { return size_ - index_; }
@@ -72,6 +72,18 @@ class BufferWriter {
     return {};
   }
 
+  // Overwrites previously written bytes; see ExactTableEntries.
+  Status<void> Patch(std::size_t offset, const std::uint8_t* begin,
+                     const std::uint8_t* end) {
+    const std::size_t length_bytes = end - begin;
+    if (offset > index_ || length_bytes > index_ - offset)
+      return ErrorStatus::WriteLimitReached;
+
+    std::memcpy(&buffer_[offset], begin, length_bytes);
+    return {};
+  }
+
+  std::size_t offset() const { return index_; }
   std::size_t size() const { return index_; }
   std::size_t capacity() const { return size_; }
 
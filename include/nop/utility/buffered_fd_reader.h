@@ -0,0 +1,209 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_BUFFERED_FD_READER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_BUFFERED_FD_READER_H_
+
+#include <errno.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include <nop/status.h>
+
+namespace nop {
+
+// BufferedFdReader is a reader type that wraps around a UNIX file descriptor
+// and reads ahead into a userspace buffer. Each refill requests as many bytes
+// as fit in the free space of the buffer, so small values are usually served
+// without a syscall. Reads that are at least as large as the buffer bypass it
+// and are read directly into the destination.
+//
+// Ensure() is used as a refill hint: when the requested size fits in the buffer
+// the reader blocks until that many bytes are buffered, so that the following
+// reads are satisfied from memory. Because the reader has no knowledge of the
+// total length of the input, Ensure() is not a bounds check for requests larger
+// than the buffer.
+//
+// The reader takes ownerhip of the fd and automatically closes it when
+// destroyed, unless it is released.
+class BufferedFdReader {
+ public:
+  enum : std::size_t { kDefaultBufferSize = 4096 };
+
+  BufferedFdReader() : buffer_(kDefaultBufferSize) {}
+
+  // Constructs a reader for |fd| with a buffer of |buffer_size| bytes. The
+  // buffer size must be non-zero.
+  BufferedFdReader(int fd, std::size_t buffer_size = kDefaultBufferSize)
+      : fd_{fd}, buffer_(buffer_size) {}
+  BufferedFdReader(const BufferedFdReader&) = delete;
+  BufferedFdReader(BufferedFdReader&& other) : BufferedFdReader{} {
+    *this = std::move(other);
+  }
+
+  ~BufferedFdReader() { Clear(); }
+
+  BufferedFdReader& operator=(const BufferedFdReader&) = delete;
+  BufferedFdReader& operator=(BufferedFdReader&& other) {
+    if (this != &other) {
+      Clear();
+      std::swap(fd_, other.fd_);
+      std::swap(buffer_, other.buffer_);
+      std::swap(begin_, other.begin_);
+      std::swap(end_, other.end_);
+    }
+    return *this;
+  }
+
+  void Clear() {
+    ::close(fd_);
+    fd_ = -1;
+    begin_ = end_ = 0;
+  }
+
+  // Releases the fd without closing it. Bytes that have been read ahead into
+  // the buffer are discarded.
+  int Release() {
+    const int released_fd = fd_;
+    fd_ = -1;
+    begin_ = end_ = 0;
+    return released_fd;
+  }
+
+  Status<void> Ensure(std::size_t size) {
+    if (size <= available() || size > buffer_.size())
+      return {};
+    else
+      return Fill(size);
+  }
+
+  Status<void> Read(std::uint8_t* byte) {
+    if (begin_ == end_) {
+      auto status = Fill(1);
+      if (!status)
+        return status;
+    }
+
+    *byte = buffer_[begin_++];
+    return {};
+  }
+
+  Status<void> Read(void* begin, void* end) {
+    std::uint8_t* begin_byte = static_cast<std::uint8_t*>(begin);
+    std::uint8_t* end_byte = static_cast<std::uint8_t*>(end);
+
+    // Drain what is already buffered.
+    std::size_t count =
+        std::min<std::size_t>(end_byte - begin_byte, available());
+    std::memcpy(begin_byte, buffer_.data() + begin_, count);
+    begin_byte += count;
+    begin_ += count;
+
+    const std::size_t length_bytes = end_byte - begin_byte;
+    if (length_bytes == 0)
+      return {};
+
+    // Large payloads are read directly to avoid an extra copy.
+    if (length_bytes >= buffer_.size())
+      return ReadFd(begin_byte, end_byte);
+
+    auto status = Fill(length_bytes);
+    if (!status)
+      return status;
+
+    std::memcpy(begin_byte, buffer_.data() + begin_, length_bytes);
+    begin_ += length_bytes;
+    return {};
+  }
+
+  Status<void> Skip(std::size_t padding_bytes) {
+    while (true) {
+      const std::size_t count = std::min(padding_bytes, available());
+      begin_ += count;
+      padding_bytes -= count;
+
+      if (padding_bytes == 0)
+        return {};
+
+      auto status = Fill(1);
+      if (!status)
+        return status;
+    }
+  }
+
+  int fd() const { return fd_; }
+
+  // Returns the number of bytes read ahead into the buffer but not consumed.
+  std::size_t available() const { return end_ - begin_; }
+  std::size_t capacity() const { return buffer_.size(); }
+
+ private:
+  // Reads from the fd until at least |size| bytes are buffered. |size| must not
+  // exceed the buffer capacity.
+  Status<void> Fill(std::size_t size) {
+    // Move the unconsumed bytes to the front of the buffer to make space.
+    if (begin_ != 0) {
+      std::memmove(buffer_.data(), buffer_.data() + begin_, available());
+      end_ -= begin_;
+      begin_ = 0;
+    }
+
+    while (end_ < size) {
+      const ssize_t ret =
+          ::read(fd_, buffer_.data() + end_, buffer_.size() - end_);
+      if (ret > 0)
+        end_ += ret;
+      else if (ret == 0)
+        return ErrorStatus::ReadLimitReached;
+      else if (errno != EINTR)
+        return ErrorStatus::IOError;
+      // Otherwise interrupted by signal, try again.
+    }
+
+    return {};
+  }
+
+  Status<void> ReadFd(std::uint8_t* begin, std::uint8_t* end) {
+    while (begin < end) {
+      const ssize_t ret = ::read(fd_, begin, end - begin);
+      if (ret > 0)
+        begin += ret;
+      else if (ret == 0)
+        return ErrorStatus::ReadLimitReached;
+      else if (errno != EINTR)
+        return ErrorStatus::IOError;
+      // Otherwise interrupted by signal, try again.
+    }
+
+    return {};
+  }
+
+  int fd_{-1};
+  std::vector<std::uint8_t> buffer_;
+  std::size_t begin_{0};
+  std::size_t end_{0};
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_BUFFERED_FD_READER_H_
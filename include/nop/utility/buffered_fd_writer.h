@@ -0,0 +1,196 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_BUFFERED_FD_WRITER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_BUFFERED_FD_WRITER_H_
+
+#include <errno.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include <nop/status.h>
+
+namespace nop {
+
+// BufferedFdWriter is a writer type that wraps around a UNIX file descriptor
+// and coalesces writes in a userspace buffer. Bytes are only passed to the
+// kernel when the buffer fills, when Prepare() requests more space than is
+// left in the buffer, or when Flush() is called. Payloads that are larger than
+// the buffer bypass it and are written directly to the fd.
+//
+// Users must call Flush() after a complete message has been serialized when
+// the peer expects to receive it promptly, such as in a request/response
+// protocol. Any remaining bytes are flushed when the writer is destroyed.
+//
+// The writer takes ownerhip of the fd and automatically closes it when
+// destroyed, unless it is released.
+class BufferedFdWriter {
+ public:
+  enum : std::size_t { kDefaultBufferSize = 4096 };
+
+  BufferedFdWriter() : buffer_(kDefaultBufferSize) {}
+
+  // Constructs a writer for |fd| with a buffer of |buffer_size| bytes. The
+  // buffer size must be non-zero.
+  BufferedFdWriter(int fd, std::size_t buffer_size = kDefaultBufferSize)
+      : fd_{fd}, buffer_(buffer_size) {}
+  BufferedFdWriter(const BufferedFdWriter&) = delete;
+  BufferedFdWriter(BufferedFdWriter&& other) : BufferedFdWriter{} {
+    *this = std::move(other);
+  }
+
+  ~BufferedFdWriter() { Clear(); }
+
+  BufferedFdWriter& operator=(const BufferedFdWriter&) = delete;
+  BufferedFdWriter& operator=(BufferedFdWriter&& other) {
+    if (this != &other) {
+      Clear();
+      std::swap(fd_, other.fd_);
+      std::swap(buffer_, other.buffer_);
+      std::swap(index_, other.index_);
+    }
+    return *this;
+  }
+
+  // Flushes any buffered bytes and closes the fd.
+  void Clear() {
+    if (fd_ >= 0)
+      Flush();
+    ::close(fd_);
+    fd_ = -1;
+    index_ = 0;
+  }
+
+  // Releases the fd without closing it. Buffered bytes that have not been
+  // flushed are discarded.
+  int Release() {
+    const int released_fd = fd_;
+    fd_ = -1;
+    index_ = 0;
+    return released_fd;
+  }
+
+  // Flushes the buffer when the upcoming write would not fit in the remaining
+  // buffer space. This keeps messages that fit in the buffer contiguous so that
+  // they are written with a single syscall.
+  Status<void> Prepare(std::size_t size) {
+    if (size > buffer_.size() - index_)
+      return Flush();
+    else
+      return {};
+  }
+
+  Status<void> Write(std::uint8_t byte) {
+    if (index_ == buffer_.size()) {
+      auto status = Flush();
+      if (!status)
+        return status;
+    }
+
+    buffer_[index_++] = byte;
+    return {};
+  }
+
+  Status<void> Write(const void* begin, const void* end) {
+    const std::uint8_t* begin_byte = static_cast<const std::uint8_t*>(begin);
+    const std::uint8_t* end_byte = static_cast<const std::uint8_t*>(end);
+    const std::size_t length_bytes = end_byte - begin_byte;
+
+    if (length_bytes <= buffer_.size() - index_) {
+      std::memcpy(buffer_.data() + index_, begin_byte, length_bytes);
+      index_ += length_bytes;
+      return {};
+    }
+
+    auto status = Flush();
+    if (!status)
+      return status;
+
+    // Large payloads are written directly to avoid an extra copy.
+    if (length_bytes >= buffer_.size())
+      return WriteFd(begin_byte, end_byte);
+
+    std::memcpy(buffer_.data(), begin_byte, length_bytes);
+    index_ = length_bytes;
+    return {};
+  }
+
+  Status<void> Skip(std::size_t padding_bytes,
+                    std::uint8_t padding_value = 0x00) {
+    while (padding_bytes > 0) {
+      if (index_ == buffer_.size()) {
+        auto status = Flush();
+        if (!status)
+          return status;
+      }
+
+      const std::size_t count =
+          std::min(padding_bytes, buffer_.size() - index_);
+      std::memset(buffer_.data() + index_, padding_value, count);
+      index_ += count;
+      padding_bytes -= count;
+    }
+
+    return {};
+  }
+
+  // Writes all buffered bytes to the fd.
+  Status<void> Flush() {
+    if (index_ == 0)
+      return {};
+
+    auto status = WriteFd(buffer_.data(), buffer_.data() + index_);
+    index_ = 0;
+    return status;
+  }
+
+  int fd() const { return fd_; }
+
+  // Returns the number of bytes waiting in the buffer.
+  std::size_t size() const { return index_; }
+  std::size_t capacity() const { return buffer_.size(); }
+
+ private:
+  Status<void> WriteFd(const std::uint8_t* begin, const std::uint8_t* end) {
+    while (begin < end) {
+      const ssize_t ret = ::write(fd_, begin, end - begin);
+      if (ret > 0)
+        begin += ret;
+      else if (ret == 0)
+        return ErrorStatus::WriteLimitReached;
+      else if (errno != EINTR)
+        return ErrorStatus::IOError;
+      // Otherwise interrupted by signal, try again.
+    }
+
+    return {};
+  }
+
+  int fd_{-1};
+  std::vector<std::uint8_t> buffer_;
+  std::size_t index_{0};
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_BUFFERED_FD_WRITER_H_
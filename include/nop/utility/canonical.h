@@ -0,0 +1,71 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_CANONICAL_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_CANONICAL_H_
+
+#include <type_traits>
+
+#include <nop/traits/void.h>
+
+namespace nop {
+
+// By default, equal values may have more than one encoding: unordered
+// containers are written in the iteration order of the hash table, which
+// depends on the insertion history, and table entries are padded when the
+// size of an entry is overestimated. Writers may request the canonical
+// encoding instead, which is the same for all equal values, by defining:
+//
+//   static constexpr bool kCanonical = true;
+//
+// In canonical mode:
+//   * Unordered map and set entries are written in ascending key order, which
+//     matches the encoding of the equivalent std::map or std::set. The key
+//     type must support std::less.
+//   * Integers use the smallest encoding that holds the value. This is always
+//     the case; the mode does not change the integer encodings.
+//   * Table entry lengths are exact and use the smallest encoding. Entries
+//     with overestimated sizes, such as those containing handles or shared
+//     references, would need padding and fail with ErrorStatus::ProtocolError.
+//     Canonical writers never patch entry lengths.
+//
+// The canonical encoding is a valid encoding that any reader accepts.
+//
+// Writers opt in with Canonical, or define the member directly, as done by
+// HashingWriter:
+//
+//   nop::Serializer<nop::Canonical<nop::VectorWriter>> serializer;
+//
+template <typename Writer, typename Enabled = void>
+struct WriterIsCanonical : std::false_type {};
+template <typename Writer>
+struct WriterIsCanonical<Writer, Void<decltype(Writer::kCanonical)>>
+    : std::integral_constant<bool, Writer::kCanonical> {};
+
+// Opts a writer into the canonical encoding.
+template <typename Writer>
+class Canonical : public Writer {
+ public:
+  using Writer::Writer;
+
+  static constexpr bool kCanonical = true;
+  static constexpr bool kExactTableEntries = false;
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_CANONICAL_H_
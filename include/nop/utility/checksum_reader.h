@@ -0,0 +1,222 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_CHECKSUM_READER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_CHECKSUM_READER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+#include <nop/base/encoding.h>
+#include <nop/base/handle.h>
+#include <nop/base/pointer.h>
+#include <nop/base/utility.h>
+#include <nop/types/interned.h>
+#include <nop/utility/checksum_writer.h>
+#include <nop/utility/crc32c.h>
+#include <nop/utility/endian.h>
+#include <nop/utility/reuse_storage.h>
+
+namespace nop {
+
+// ChecksumReader is a reader type that wraps another reader pointer and
+// verifies the frames written by ChecksumWriter as they are read.
+//
+// The checksum is computed incrementally from the data passed to the
+// encodings. The read that consumes the last byte of a frame also reads and
+// verifies the checksum, and returns ErrorStatus::ProtocolError on a mismatch,
+// so a deserializer fails on a corrupted message before returning it. Reading
+// a value that spans the end of a frame returns ErrorStatus::ReadLimitReached.
+//
+// Example:
+//
+//   FdReader fd_reader{journal_fd};
+//   Deserializer<ChecksumReader<FdReader>> deserializer{&fd_reader};
+//   auto status = deserializer.Read(&record);
+//
+template <typename Reader>
+class ChecksumReader {
+ public:
+  ChecksumReader() = default;
+  ChecksumReader(const ChecksumReader&) = default;
+  ChecksumReader(Reader* reader) : reader_{reader} {}
+
+  ChecksumReader& operator=(const ChecksumReader&) = default;
+
+  Status<void> Ensure(std::size_t size) {
+    // The size of the next frame is not known until its header is read.
+    if (remaining_ == 0)
+      return {};
+    else if (size > remaining_)
+      return ErrorStatus::ReadLimitReached;
+    else
+      return reader_->Ensure(size);
+  }
+
+  Status<void> Read(std::uint8_t* byte) { return Read(byte, byte + 1); }
+
+  template <typename T, typename Enable = EnableIfArithmetic<T>>
+  Status<void> Read(T* begin, T* end) {
+    const std::size_t size = (end - begin) * sizeof(T);
+    auto status = Begin(size);
+    if (!status || size == 0)
+      return status;
+
+    status = reader_->Read(begin, end);
+    if (!status)
+      return status;
+
+    crc_ = Crc32c::Extend(crc_, begin, size);
+    return Advance(size);
+  }
+
+  Status<void> Skip(std::size_t padding_bytes) {
+    auto status = Begin(padding_bytes);
+    if (!status)
+      return status;
+
+    // Skipped bytes are covered by the checksum, so they are read in chunks.
+    std::uint8_t padding[64];
+    while (padding_bytes > 0) {
+      const std::size_t length =
+          padding_bytes < sizeof(padding) ? padding_bytes : sizeof(padding);
+      status = reader_->Read(padding, padding + length);
+      if (!status)
+        return status;
+
+      crc_ = Crc32c::Extend(crc_, padding, length);
+      padding_bytes -= length;
+      status = Advance(length);
+      if (!status)
+        return status;
+    }
+
+    return {};
+  }
+
+  // Only available when the underlying reader supports borrowing.
+  template <typename R = Reader, typename Enabled = ReaderBorrowTest<R>>
+  Status<void> Borrow(std::size_t size, const void** data) {
+    auto status = Begin(size);
+    if (!status)
+      return status;
+
+    status = reader_->Borrow(size, data);
+    if (!status)
+      return status;
+
+    crc_ = Crc32c::Extend(crc_, *data, size);
+    return size != 0 ? Advance(size) : Status<void>{};
+  }
+
+  static constexpr bool kReuseStorage = ReaderReusesStorage<Reader>::value;
+  static constexpr bool kBorrowToCopy = ReaderBorrowsToCopy<Reader>::value;
+
+  template <typename HandleType>
+  Status<HandleType> GetHandle(HandleReference handle_reference) {
+    return reader_->template GetHandle<HandleType>(handle_reference);
+  }
+
+  // Interned strings and shared pointers are resolved by the underlying reader.
+  template <typename R = Reader, typename Enabled = ReaderDefineStringTest<R>>
+  Status<void> DefineString(StringView string) {
+    return reader_->DefineString(string);
+  }
+
+  template <typename R = Reader, typename Enabled = ReaderGetStringTest<R>>
+  Status<StringView> GetString(StringReference reference) {
+    return reader_->GetString(reference);
+  }
+
+  template <typename R = Reader, typename Enabled = ReaderDefinePointerTest<R>>
+  Status<void> DefinePointer(std::shared_ptr<void> pointer, PointerType type) {
+    return reader_->DefinePointer(std::move(pointer), type);
+  }
+
+  template <typename R = Reader, typename Enabled = ReaderGetPointerTest<R>>
+  Status<std::shared_ptr<void>> GetPointer(PointerReference reference,
+                                           PointerType type) {
+    return reader_->GetPointer(reference, type);
+  }
+
+  // Returns the number of bytes that remain in the current frame.
+  std::size_t remaining() const { return remaining_; }
+
+  const Reader* reader() const { return reader_; }
+  Reader* reader() { return reader_; }
+
+ private:
+  // Starts the next frame if the current frame is complete, and checks that
+  // |size| bytes remain in the frame.
+  Status<void> Begin(std::size_t size) {
+    if (size == 0)
+      return {};
+
+    while (remaining_ == 0) {
+      std::uint32_t header;
+      auto status = reader_->Read(&header, &header + 1);
+      if (!status)
+        return status;
+
+      crc_ = Crc32c::Extend(0, &header, sizeof(header));
+      remaining_ = HostEndian<std::uint32_t>::FromLittle(header);
+
+      // Empty frames carry only a checksum.
+      if (remaining_ == 0) {
+        status = Verify();
+        if (!status)
+          return status;
+      }
+    }
+
+    if (size > remaining_)
+      return ErrorStatus::ReadLimitReached;
+    else
+      return {};
+  }
+
+  // Consumes |size| bytes of the frame and verifies the checksum when the frame
+  // is complete.
+  Status<void> Advance(std::size_t size) {
+    remaining_ -= size;
+    if (remaining_ != 0)
+      return {};
+    else
+      return Verify();
+  }
+
+  Status<void> Verify() {
+    std::uint32_t trailer;
+    auto status = reader_->Read(&trailer, &trailer + 1);
+    if (!status)
+      return status;
+
+    if (HostEndian<std::uint32_t>::FromLittle(trailer) != crc_)
+      return ErrorStatus::ProtocolError;
+    else
+      return {};
+  }
+
+  Reader* reader_{nullptr};
+  std::size_t remaining_{0};
+  std::uint32_t crc_{0};
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_CHECKSUM_READER_H_
@@ -0,0 +1,198 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_CHECKSUM_WRITER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_CHECKSUM_WRITER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+
+#include <nop/base/encoding.h>
+#include <nop/base/handle.h>
+#include <nop/base/pointer.h>
+#include <nop/base/utility.h>
+#include <nop/types/interned.h>
+#include <nop/utility/crc32c.h>
+#include <nop/utility/endian.h>
+
+namespace nop {
+
+//
+// Checksummed frame format:
+//
+// +-----------+---//----+-------------+
+// | U32LE: L  | L BYTES | U32LE: CRC  |
+// +-----------+---//----+-------------+
+//
+// Where L is the size of the serialized message and CRC is the CRC32C of the
+// length header and the message, so that a corrupted length is detected as
+// well as corrupted data.
+//
+
+enum : std::size_t {
+  kChecksumFrameHeaderSize = sizeof(std::uint32_t),
+  kChecksumFrameTrailerSize = sizeof(std::uint32_t),
+};
+
+// ChecksumWriter is a writer type that wraps another writer pointer and frames
+// each message with its length and a CRC32C checksum. Read the data back with
+// ChecksumReader.
+//
+// The checksum is computed incrementally as the encodings write to the
+// underlying writer, so the message is not buffered or read a second time. The
+// length of each message is taken from the size passed to Prepare() by the
+// serializer; writing outside of a prepared message, or beyond the prepared
+// size, returns ErrorStatus::WriteLimitReached.
+//
+// Patching previously written data would invalidate the running checksum, so
+// tables written through this writer use the padded entry format regardless of
+// the underlying writer.
+//
+// Example:
+//
+//   FdWriter fd_writer{journal_fd};
+//   Serializer<ChecksumWriter<FdWriter>> serializer{&fd_writer};
+//   auto status = serializer.Write(record);
+//
+template <typename Writer>
+class ChecksumWriter {
+ public:
+  ChecksumWriter() = default;
+  ChecksumWriter(const ChecksumWriter&) = default;
+  ChecksumWriter(Writer* writer) : writer_{writer} {}
+
+  ChecksumWriter& operator=(const ChecksumWriter&) = default;
+
+  // Starts a frame of |size| bytes. Within a frame, only checks that |size|
+  // bytes remain.
+  Status<void> Prepare(std::size_t size) {
+    if (remaining_ != 0) {
+      if (size > remaining_)
+        return ErrorStatus::WriteLimitReached;
+      else
+        return {};
+    }
+
+    if (size == 0)
+      return {};
+    else if (size > std::numeric_limits<std::uint32_t>::max())
+      return ErrorStatus::WriteLimitReached;
+
+    auto status = writer_->Prepare(kChecksumFrameHeaderSize + size +
+                                   kChecksumFrameTrailerSize);
+    if (!status)
+      return status;
+
+    const std::uint32_t header = HostEndian<std::uint32_t>::ToLittle(
+        static_cast<std::uint32_t>(size));
+    status = writer_->Write(&header, &header + 1);
+    if (!status)
+      return status;
+
+    crc_ = Crc32c::Extend(0, &header, sizeof(header));
+    remaining_ = size;
+    return {};
+  }
+
+  Status<void> Write(std::uint8_t byte) { return Write(&byte, &byte + 1); }
+
+  template <typename T, typename Enable = EnableIfArithmetic<T>>
+  Status<void> Write(const T* begin, const T* end) {
+    const std::size_t size = (end - begin) * sizeof(T);
+    if (size == 0)
+      return {};
+    else if (size > remaining_)
+      return ErrorStatus::WriteLimitReached;
+
+    auto status = writer_->Write(begin, end);
+    if (!status)
+      return status;
+
+    crc_ = Crc32c::Extend(crc_, begin, size);
+    return Advance(size);
+  }
+
+  Status<void> Skip(std::size_t padding_bytes,
+                    std::uint8_t padding_value = 0x00) {
+    if (padding_bytes == 0)
+      return {};
+    else if (padding_bytes > remaining_)
+      return ErrorStatus::WriteLimitReached;
+
+    auto status = writer_->Skip(padding_bytes, padding_value);
+    if (!status)
+      return status;
+
+    std::uint8_t padding[64];
+    std::memset(padding, padding_value, sizeof(padding));
+    for (std::size_t count = padding_bytes; count > 0;) {
+      const std::size_t length =
+          count < sizeof(padding) ? count : sizeof(padding);
+      crc_ = Crc32c::Extend(crc_, padding, length);
+      count -= length;
+    }
+
+    return Advance(padding_bytes);
+  }
+
+  template <typename HandleType>
+  Status<HandleReference> PushHandle(const HandleType& handle) {
+    return writer_->PushHandle(handle);
+  }
+
+  // Interned strings and shared pointers are resolved by the underlying writer;
+  // the references they produce are checksummed like any other bytes.
+  template <typename W = Writer, typename Enabled = WriterInternStringTest<W>>
+  Status<StringReference> InternString(StringView string) {
+    return writer_->InternString(string);
+  }
+
+  template <typename T, typename W = Writer,
+            typename Enabled = WriterInternPointerTest<W>>
+  Status<PointerReference> InternPointer(const std::shared_ptr<T>& pointer,
+                                         PointerType type) {
+    return writer_->InternPointer(pointer, type);
+  }
+
+  // Returns the number of bytes that remain in the current frame.
+  std::size_t remaining() const { return remaining_; }
+
+  const Writer* writer() const { return writer_; }
+  Writer* writer() { return writer_; }
+
+ private:
+  // Consumes |size| bytes of the frame and writes the checksum when the frame
+  // is complete.
+  Status<void> Advance(std::size_t size) {
+    remaining_ -= size;
+    if (remaining_ != 0)
+      return {};
+
+    const std::uint32_t trailer = HostEndian<std::uint32_t>::ToLittle(crc_);
+    return writer_->Write(&trailer, &trailer + 1);
+  }
+
+  Writer* writer_{nullptr};
+  std::size_t remaining_{0};
+  std::uint32_t crc_{0};
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_CHECKSUM_WRITER_H_
@@ -34,4 +34,48 @@
 #define NOP_FALLTHROUGH
 #endif
 
+// Compatability with compilers that do not support __has_builtin.
+#ifndef __has_builtin
+#define __has_builtin(x) 0
+#endif
+
+// Evaluates to true when the enclosing constexpr function is evaluated as part
+// of a constant expression. Runtime-only optimizations use this to avoid
+// operations that are not allowed in constant expressions. When the compiler
+// does not provide a means to detect constant evaluation this always evaluates
+// to true, disabling such optimizations.
+#if __has_builtin(__builtin_is_constant_evaluated)
+#define NOP_IS_CONSTANT_EVALUATED() __builtin_is_constant_evaluated()
+#else
+#define NOP_IS_CONSTANT_EVALUATED() true
+#endif
+
+// Selects implementations that expand parameter packs with C++17 fold
+// expressions over those that recurse through one overload per element, which
+// reduces the instantiation depth and code size of wide structures and tables.
+#if __cplusplus >= 201703L && defined(__cpp_fold_expressions)
+#define NOP_HAS_FOLD_EXPRESSIONS 1
+#else
+#define NOP_HAS_FOLD_EXPRESSIONS 0
+#endif
+
+// Branch prediction hints for conditions that are almost always true or false,
+// such as the status of an operation. The hints move the unlikely branch out of
+// the hot path.
+#if __has_builtin(__builtin_expect) || defined(__GNUC__)
+#define NOP_LIKELY(condition) __builtin_expect(!!(condition), 1)
+#define NOP_UNLIKELY(condition) __builtin_expect(!!(condition), 0)
+#else
+#define NOP_LIKELY(condition) (condition)
+#define NOP_UNLIKELY(condition) (condition)
+#endif
+
+// Hints that the cache line containing |address| will be read soon. Used to
+// request input ahead of the cursor when decoding long runs of elements.
+#if __has_builtin(__builtin_prefetch) || defined(__GNUC__)
+#define NOP_PREFETCH(address) __builtin_prefetch(address)
+#else
+#define NOP_PREFETCH(address) static_cast<void>(address)
+#endif
+
 #endif  // LIBNOP_INCLUDE_NOP_UTILITY_COMPILER_H_
@@ -0,0 +1,168 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_COMPRESSING_WRITER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_COMPRESSING_WRITER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <nop/base/encoding.h>
+#include <nop/base/utility.h>
+#include <nop/utility/compression.h>
+#include <nop/utility/endian.h>
+
+namespace nop {
+
+// CompressingWriter is a writer type that wraps another writer pointer and
+// compresses the data written to it in frames, using the frame format and
+// codecs described in compression.h. Read the data back with
+// DecompressingReader.
+//
+// Data is buffered until the end of each message and then written to the
+// underlying writer as one frame, so that every message is complete and
+// decodable as soon as the serializer returns. The end of a message is
+// determined from the size passed to Prepare() by the serializer. Messages
+// larger than kMaxCompressionFrameSize are split across multiple frames. Data
+// written outside of a prepared message is buffered until Flush() is called.
+//
+// Example:
+//
+//   FdWriter fd_writer{fd};
+//   Serializer<CompressingWriter<FdWriter>> serializer{&fd_writer};
+//   auto status = serializer.Write(message);
+//
+template <typename Writer, typename Codec = Lz4Codec>
+class CompressingWriter {
+ public:
+  CompressingWriter() = default;
+  CompressingWriter(Writer* writer) : writer_{writer} {}
+
+  CompressingWriter(const CompressingWriter&) = delete;
+  void operator=(const CompressingWriter&) = delete;
+
+  // Starts a message of |size| bytes, or extends the current message.
+  Status<void> Prepare(std::size_t size) {
+    message_remaining_ += size;
+    return {};
+  }
+
+  Status<void> Write(std::uint8_t byte) { return Write(&byte, &byte + 1); }
+
+  template <typename T, typename Enable = EnableIfArithmetic<T>>
+  Status<void> Write(const T* begin, const T* end) {
+    const std::uint8_t* data = reinterpret_cast<const std::uint8_t*>(begin);
+    return Append((end - begin) * sizeof(T), [&data](std::uint8_t* out,
+                                                     std::size_t length) {
+      std::memcpy(out, data, length);
+      data += length;
+    });
+  }
+
+  Status<void> Skip(std::size_t padding_bytes,
+                    std::uint8_t padding_value = 0x00) {
+    return Append(padding_bytes,
+                  [padding_value](std::uint8_t* out, std::size_t length) {
+                    std::memset(out, padding_value, length);
+                  });
+  }
+
+  // Writes the buffered data to the underlying writer as a frame.
+  Status<void> Flush() {
+    if (buffer_.empty())
+      return {};
+
+    const std::size_t raw_size = buffer_.size();
+    compressed_.resize(kCompressionFrameHeaderSize +
+                       Codec::MaxCompressedSize(raw_size));
+    std::size_t stored_size = Codec::Compress(
+        buffer_.data(), raw_size,
+        compressed_.data() + kCompressionFrameHeaderSize);
+
+    // Store incompressible data as-is.
+    const std::uint8_t* stored = compressed_.data() +
+                                 kCompressionFrameHeaderSize;
+    if (stored_size == 0 || stored_size >= raw_size) {
+      stored = buffer_.data();
+      stored_size = raw_size;
+    }
+
+    std::uint32_t header[2] = {
+        HostEndian<std::uint32_t>::ToLittle(
+            static_cast<std::uint32_t>(raw_size)),
+        HostEndian<std::uint32_t>::ToLittle(
+            static_cast<std::uint32_t>(stored_size))};
+
+    auto status = writer_->Prepare(sizeof(header) + stored_size);
+    if (status)
+      status = writer_->Write(header, header + 2);
+    if (status)
+      status = writer_->Write(stored, stored + stored_size);
+
+    raw_bytes_ += raw_size;
+    compressed_bytes_ += sizeof(header) + stored_size;
+    buffer_.clear();
+    return status;
+  }
+
+  // Returns the number of bytes passed to the writer and the number of bytes
+  // written to the underlying writer, including frame headers.
+  std::uint64_t raw_bytes() const { return raw_bytes_; }
+  std::uint64_t compressed_bytes() const { return compressed_bytes_; }
+
+  const Writer* writer() const { return writer_; }
+  Writer* writer() { return writer_; }
+
+ private:
+  template <typename Op>
+  Status<void> Append(std::size_t length, Op op) {
+    while (length > 0) {
+      const std::size_t space = kMaxCompressionFrameSize - buffer_.size();
+      const std::size_t count = length < space ? length : space;
+      const std::size_t offset = buffer_.size();
+      buffer_.resize(offset + count);
+      op(buffer_.data() + offset, count);
+      length -= count;
+
+      // Zero is both the end of a message and outside of any message. The
+      // latter only flushes full frames.
+      const bool in_message = message_remaining_ != 0;
+      message_remaining_ -=
+          count < message_remaining_ ? count : message_remaining_;
+      if ((in_message && message_remaining_ == 0) ||
+          buffer_.size() == kMaxCompressionFrameSize) {
+        auto status = Flush();
+        if (!status)
+          return status;
+      }
+    }
+
+    return {};
+  }
+
+  Writer* writer_{nullptr};
+  std::vector<std::uint8_t> buffer_;
+  std::vector<std::uint8_t> compressed_;
+  std::size_t message_remaining_{0};
+  std::uint64_t raw_bytes_{0};
+  std::uint64_t compressed_bytes_{0};
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_COMPRESSING_WRITER_H_
@@ -0,0 +1,254 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_COMPRESSION_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_COMPRESSION_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace nop {
+
+//
+// Compression codecs and frame format for CompressingWriter and
+// DecompressingReader.
+//
+// A codec is a type with the following static members:
+//
+//   // Returns the largest compressed size of |size| bytes of input.
+//   static std::size_t MaxCompressedSize(std::size_t size);
+//
+//   // Compresses |size| bytes at |data| into |output|, which holds at least
+//   // MaxCompressedSize(size) bytes. Returns the compressed size, or zero if
+//   // the input cannot be compressed.
+//   static std::size_t Compress(const std::uint8_t* data, std::size_t size,
+//                               std::uint8_t* output);
+//
+//   // Decompresses |size| bytes at |data| into exactly |output_size| bytes at
+//   // |output|. Returns false if the input is malformed or does not decompress
+//   // to exactly |output_size| bytes.
+//   static bool Decompress(const std::uint8_t* data, std::size_t size,
+//                          std::uint8_t* output, std::size_t output_size);
+//
+// This allows other compression libraries, such as zstd, to be plugged in
+// where they are available. The library provides Lz4Codec, which has no
+// external dependencies.
+//
+// Compressed streams are a sequence of frames:
+//
+// +-------------+----------------+---//----+
+// | UINT32LE: R | UINT32LE: S    | S BYTES |
+// +-------------+----------------+---//----+
+//
+// Where R is the size of the uncompressed frame data, which is at most
+// kMaxCompressionFrameSize, and S is the size of the stored data. When S equals
+// R the data is stored uncompressed, otherwise it is compressed with the codec.
+//
+
+enum : std::size_t {
+  kCompressionFrameHeaderSize = 8,
+  kMaxCompressionFrameSize = 1 << 20,
+};
+
+// Codec that implements the LZ4 block format with a single-probe hash table,
+// which favors speed over compression ratio. Compressed blocks are compatible
+// with LZ4_decompress_safe() of the reference implementation, and vice versa.
+struct Lz4Codec {
+  static std::size_t MaxCompressedSize(std::size_t size) {
+    return size + size / 255 + 16;
+  }
+
+  static std::size_t Compress(const std::uint8_t* data, std::size_t size,
+                              std::uint8_t* output) {
+    std::uint32_t table[kHashSize] = {};
+    std::uint8_t* out = output;
+    std::size_t anchor = 0;
+
+    if (size >= kMinInputSize) {
+      const std::size_t match_start_limit = size - kMatchFindLimit;
+      const std::size_t match_end_limit = size - kLastLiterals;
+      std::size_t index = 1;
+      std::size_t misses = 0;
+
+      while (index < match_start_limit) {
+        const std::uint32_t sequence = Load32(data + index);
+        const std::uint32_t hash = Hash(sequence);
+        const std::size_t candidate = table[hash];
+        table[hash] = static_cast<std::uint32_t>(index);
+
+        if (index - candidate > kMaxOffset ||
+            Load32(data + candidate) != sequence) {
+          // Skip through incompressible data progressively faster.
+          index += 1 + (misses++ >> kSkipTrigger);
+          continue;
+        }
+
+        std::size_t length = kMinMatch;
+        while (index + length < match_end_limit &&
+               data[candidate + length] == data[index + length]) {
+          length++;
+        }
+
+        out = WriteSequence(out, data + anchor, index - anchor,
+                            index - candidate, length);
+        index += length;
+        anchor = index;
+        misses = 0;
+      }
+    }
+
+    // The last sequence holds the remaining literals and no match.
+    out = WriteLength(out, size - anchor, 0);
+    std::memcpy(out, data + anchor, size - anchor);
+    out += size - anchor;
+    return out - output;
+  }
+
+  static bool Decompress(const std::uint8_t* data, std::size_t size,
+                         std::uint8_t* output, std::size_t output_size) {
+    std::size_t in = 0;
+    std::size_t out = 0;
+
+    while (in < size) {
+      const std::uint8_t token = data[in++];
+
+      std::size_t literals = token >> 4;
+      if (!ReadLength(data, size, &in, &literals))
+        return false;
+      if (literals > size - in || literals > output_size - out)
+        return false;
+
+      std::memcpy(output + out, data + in, literals);
+      in += literals;
+      out += literals;
+
+      // The last sequence ends after its literals.
+      if (in == size)
+        return out == output_size;
+
+      if (size - in < 2)
+        return false;
+      const std::size_t offset = data[in] | (data[in + 1] << 8);
+      in += 2;
+      if (offset == 0 || offset > out)
+        return false;
+
+      std::size_t length = token & 0xf;
+      if (!ReadLength(data, size, &in, &length))
+        return false;
+      length += kMinMatch;
+      if (length > output_size - out)
+        return false;
+
+      // Matches may overlap the bytes they produce.
+      const std::uint8_t* match = output + out - offset;
+      if (offset >= length) {
+        std::memcpy(output + out, match, length);
+      } else {
+        for (std::size_t i = 0; i < length; i++)
+          output[out + i] = match[i];
+      }
+      out += length;
+    }
+
+    return false;
+  }
+
+ private:
+  enum : std::size_t {
+    kHashBits = 12,
+    kHashSize = 1 << kHashBits,
+    kMinMatch = 4,
+    kLastLiterals = 5,
+    kMatchFindLimit = 12,
+    kMinInputSize = kMatchFindLimit + 1,
+    kMaxOffset = 65535,
+    kSkipTrigger = 6,
+  };
+
+  static std::uint32_t Load32(const std::uint8_t* data) {
+    std::uint32_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+  }
+
+  static std::uint32_t Hash(std::uint32_t sequence) {
+    return (sequence * 2654435761u) >> (32 - kHashBits);
+  }
+
+  // Writes a token with the given literal length and match length nibble,
+  // followed by the extra literal length bytes.
+  static std::uint8_t* WriteLength(std::uint8_t* out, std::size_t literals,
+                                   std::uint8_t match_nibble) {
+    if (literals >= 15) {
+      *out++ = 0xf0 | match_nibble;
+      out = WriteExtraLength(out, literals - 15);
+    } else {
+      *out++ = static_cast<std::uint8_t>(literals << 4) | match_nibble;
+    }
+    return out;
+  }
+
+  static std::uint8_t* WriteExtraLength(std::uint8_t* out, std::size_t length) {
+    while (length >= 255) {
+      *out++ = 255;
+      length -= 255;
+    }
+    *out++ = static_cast<std::uint8_t>(length);
+    return out;
+  }
+
+  static std::uint8_t* WriteSequence(std::uint8_t* out,
+                                     const std::uint8_t* literals,
+                                     std::size_t literal_length,
+                                     std::size_t offset, std::size_t length) {
+    const std::size_t match_length = length - kMinMatch;
+    const std::uint8_t match_nibble =
+        match_length >= 15 ? 0xf : static_cast<std::uint8_t>(match_length);
+
+    out = WriteLength(out, literal_length, match_nibble);
+    std::memcpy(out, literals, literal_length);
+    out += literal_length;
+
+    *out++ = static_cast<std::uint8_t>(offset);
+    *out++ = static_cast<std::uint8_t>(offset >> 8);
+
+    if (match_length >= 15)
+      out = WriteExtraLength(out, match_length - 15);
+    return out;
+  }
+
+  // Adds the extra length bytes that follow a nibble of 15 to |length|.
+  static bool ReadLength(const std::uint8_t* data, std::size_t size,
+                         std::size_t* in, std::size_t* length) {
+    if (*length != 15)
+      return true;
+
+    std::uint8_t byte;
+    do {
+      if (*in >= size)
+        return false;
+      byte = data[(*in)++];
+      *length += byte;
+    } while (byte == 255);
+    return true;
+  }
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_COMPRESSION_H_
@@ -0,0 +1,197 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_CONCURRENT_SERIALIZER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_CONCURRENT_SERIALIZER_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <nop/base/encoding.h>
+#include <nop/base/serializer.h>
+#include <nop/status.h>
+#include <nop/utility/unchecked_buffer_writer.h>
+
+namespace nop {
+
+// ConcurrentSerializer lets any number of threads serialize messages into one
+// shared contiguous buffer at the same time, such as an outbound batch buffer.
+//
+// Each call to Write() computes the encoded size of the value, reserves a
+// region of exactly that size by atomically advancing the shared cursor, and
+// then encodes the value into the region without holding any lock. Messages
+// are therefore contiguous and do not interleave, although their order in the
+// buffer is the order in which the reservations were made rather than the
+// order in which the encodings finish.
+//
+// Reservations never advance the cursor past the end of the buffer, so a
+// message that does not fit fails with ErrorStatus::WriteLimitReached without
+// consuming space, and smaller messages may still fit after it.
+//
+// The consumer must not read the buffer while writes are in progress. Once the
+// producers are done with a batch, committed() equals size() and the first
+// size() bytes hold the messages. A write that fails after its region was
+// reserved fills the region with zero padding, which does not decode as the
+// intended message, and sets failed(); the batch should then be discarded.
+//
+// Example:
+//
+//   std::vector<std::uint8_t> buffer(kBatchSize);
+//   ConcurrentSerializer serializer{buffer.data(), buffer.size()};
+//
+//   // On each worker thread:
+//   auto status = serializer.Write(message);
+//
+//   // After the workers are joined:
+//   Send(serializer.data(), serializer.size());
+//   serializer.Reset();
+//
+class ConcurrentSerializer {
+ public:
+  ConcurrentSerializer() = default;
+  template <std::size_t Size>
+  ConcurrentSerializer(std::uint8_t (&buffer)[Size])
+      : buffer_{buffer}, capacity_{Size} {}
+  ConcurrentSerializer(void* buffer, std::size_t size)
+      : buffer_{static_cast<std::uint8_t*>(buffer)}, capacity_{size} {}
+
+  ConcurrentSerializer(const ConcurrentSerializer&) = delete;
+  void operator=(const ConcurrentSerializer&) = delete;
+
+  // Returns the encoded size of |value| in bytes.
+  template <typename T>
+  std::size_t GetSize(const T& value) const {
+    return Encoding<T>::Size(value);
+  }
+
+  // Serializes |value| into a newly reserved region of the buffer. May be
+  // called from any number of threads concurrently.
+  template <typename T>
+  Status<void> Write(const T& value) {
+    RegionWriter writer{this};
+    auto status = SerializerCommon::Write(value, &writer);
+    return writer.Finish(status);
+  }
+
+  // Serializes the values in the range [|first|, |last|) into a single region
+  // reserved for the whole batch. May be called from any number of threads
+  // concurrently.
+  template <typename Iterator>
+  Status<void> WriteMany(Iterator first, Iterator last) {
+    RegionWriter writer{this};
+    auto status = SerializerCommon::WriteMany(first, last, &writer);
+    return writer.Finish(status);
+  }
+
+  // Resets the buffer to empty. Must not be called concurrently with writes.
+  void Reset() {
+    cursor_.store(0, std::memory_order_relaxed);
+    committed_.store(0, std::memory_order_relaxed);
+    failed_.store(false, std::memory_order_relaxed);
+  }
+
+  const std::uint8_t* data() const { return buffer_; }
+
+  // Returns the number of bytes reserved by writes.
+  std::size_t size() const { return cursor_.load(std::memory_order_acquire); }
+
+  // Returns the number of bytes in regions that writes have finished with.
+  // Acquires the contents of those regions.
+  std::size_t committed() const {
+    return committed_.load(std::memory_order_acquire);
+  }
+
+  std::size_t capacity() const { return capacity_; }
+
+  // Returns true if a write failed after reserving its region.
+  bool failed() const { return failed_.load(std::memory_order_acquire); }
+
+ private:
+  // Writer over the region reserved for a single call to Write(). Prepare()
+  // makes the reservation and the value is encoded through an unchecked
+  // writer over the region.
+  class RegionWriter {
+   public:
+    explicit RegionWriter(ConcurrentSerializer* serializer)
+        : serializer_{serializer} {}
+
+    Status<void> Prepare(std::size_t size) {
+      auto status = serializer_->Reserve(size);
+      if (!status)
+        return status.error();
+
+      offset_ = status.get();
+      size_ = size;
+      return {};
+    }
+
+    UncheckedBufferWriter Unchecked(std::size_t size) {
+      std::uint8_t* region = serializer_->buffer_ + offset_;
+      return UncheckedBufferWriter{region, region + size};
+    }
+
+    void Commit(const UncheckedBufferWriter& writer) {
+      written_ = writer.cursor() - (serializer_->buffer_ + offset_);
+    }
+
+    // Completes the region. Sizes are exact for the encodings this writer
+    // supports, so a short region indicates an error.
+    Status<void> Finish(Status<void> status) {
+      if (size_ == 0)
+        return status;
+
+      if (status && written_ != size_)
+        status = ErrorStatus::ProtocolError;
+      if (!status) {
+        std::memset(serializer_->buffer_ + offset_, 0, size_);
+        serializer_->failed_.store(true, std::memory_order_relaxed);
+      }
+
+      serializer_->committed_.fetch_add(size_, std::memory_order_release);
+      return status;
+    }
+
+   private:
+    ConcurrentSerializer* serializer_;
+    std::size_t offset_{0};
+    std::size_t size_{0};
+    std::size_t written_{0};
+  };
+
+  // Reserves |size| bytes and returns the offset of the region.
+  Status<std::size_t> Reserve(std::size_t size) {
+    std::size_t offset = cursor_.load(std::memory_order_relaxed);
+    do {
+      if (size > capacity_ - offset)
+        return ErrorStatus::WriteLimitReached;
+    } while (!cursor_.compare_exchange_weak(offset, offset + size,
+                                            std::memory_order_relaxed));
+    return offset;
+  }
+
+  std::uint8_t* buffer_{nullptr};
+  std::size_t capacity_{0};
+  std::atomic<std::size_t> cursor_{0};
+  std::atomic<std::size_t> committed_{0};
+  std::atomic<bool> failed_{false};
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_CONCURRENT_SERIALIZER_H_
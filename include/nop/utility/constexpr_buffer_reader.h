@@ -0,0 +1,136 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_CONSTEXPR_BUFFER_READER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_CONSTEXPR_BUFFER_READER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include <nop/base/encoding.h>
+#include <nop/base/utility.h>
+#include <nop/utility/compiler.h>
+#include <nop/utility/endian.h>
+
+namespace nop {
+
+// A reader type that supports constexpr deserialization from a byte buffer,
+// the counterpart of ConstexprBufferWriter. When the compiler can detect
+// constant evaluation, runtime reads copy elements with memcpy like
+// BufferReader, so the same reader type may be used in both contexts. Like
+// PedanticBufferReader, every operation is bounds checked.
+class ConstexprBufferReader {
+ public:
+  constexpr ConstexprBufferReader() = default;
+  constexpr ConstexprBufferReader(const ConstexprBufferReader&) = default;
+  template <std::size_t Size>
+  constexpr ConstexprBufferReader(const std::uint8_t (&buffer)[Size])
+      : buffer_{buffer}, size_{Size} {}
+  constexpr ConstexprBufferReader(const std::uint8_t* buffer, std::size_t size)
+      : buffer_{buffer}, size_{size} {}
+
+  constexpr ConstexprBufferReader& operator=(const ConstexprBufferReader&) =
+      default;
+
+  constexpr Status<void> Ensure(std::size_t size) {
+    if (size_ - index_ < size)
+      return ErrorStatus::ReadLimitReached;
+    else
+      return {};
+  }
+
+  constexpr Status<void> Read(std::uint8_t* byte) {
+    if (index_ < size_) {
+      *byte = buffer_[index_++];
+      return {};
+    } else {
+      return ErrorStatus::ReadLimitReached;
+    }
+  }
+
+  template <typename T, typename Enable = EnableIfArithmetic<T>>
+  constexpr Status<void> Read(T* begin, T* end) {
+    const std::size_t length = end - begin;
+    const std::size_t length_bytes = length * sizeof(T);
+
+    if (length_bytes > (size_ - index_))
+      return ErrorStatus::ReadLimitReached;
+
+    ReadElements(begin, length, std::is_integral<T>{});
+    index_ += length_bytes;
+    return {};
+  }
+
+  constexpr Status<void> Skip(std::size_t padding_bytes) {
+    auto status = Ensure(padding_bytes);
+    if (!status)
+      return status;
+
+    index_ += padding_bytes;
+    return {};
+  }
+
+  constexpr bool empty() const { return index_ == size_; }
+
+  constexpr std::size_t remaining() const { return size_ - index_; }
+  constexpr std::size_t capacity() const { return size_; }
+
+ private:
+  // Integer elements are stored in little-endian order, which matches their
+  // memory representation on little-endian hosts, so runtime reads copy the
+  // elements in bulk.
+  template <typename T>
+  constexpr void ReadElements(T* begin, std::size_t length,
+                              std::true_type /*is_integral*/) {
+    if (kLittleEndianHost && !NOP_IS_CONSTANT_EVALUATED()) {
+      std::memcpy(begin, &buffer_[index_], length * sizeof(T));
+    } else {
+      for (std::size_t i = 0; i < length; i++)
+        begin[i] = ReadElement<T>(i * sizeof(T));
+    }
+  }
+
+  // Floating point elements can only be read at runtime.
+  template <typename T>
+  void ReadElements(T* begin, std::size_t length,
+                    std::false_type /*is_integral*/) {
+    std::memcpy(begin, &buffer_[index_], length * sizeof(T));
+  }
+
+  // Reads an integer element from the byte buffer with constexpr-compatible
+  // conversions to larger integer types.
+  template <typename T>
+  constexpr T ReadElement(std::size_t offset) const {
+    using Unsigned = std::make_unsigned_t<T>;
+    Unsigned value = 0;
+    for (std::size_t i = 0; i < sizeof(T); i++) {
+      value |= static_cast<Unsigned>(
+          static_cast<Unsigned>(buffer_[index_ + offset + i]) << (8 * i));
+    }
+    return static_cast<T>(value);
+  }
+
+  const std::uint8_t* buffer_{nullptr};
+  std::size_t size_{0};
+  std::size_t index_{0};
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_CONSTEXPR_BUFFER_READER_H_
@@ -19,15 +19,22 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
+#include <type_traits>
 
 #include <nop/base/encoding.h>
 #include <nop/base/utility.h>
+#include <nop/utility/compiler.h>
+#include <nop/utility/endian.h>
 
 namespace nop {
 
-// A writer type that supports constexpr serialization into a byte buffer. This
-// type is sub-optimal for non-constexpr serialization: use BufferWriter or
-// PedanticBufferWriter for runtime serialization into a byte buffer.
+// A writer type that supports constexpr serialization into a byte buffer. When
+// the compiler can detect constant evaluation, runtime writes copy elements
+// with memcpy like BufferWriter, so the same writer type may be used in both
+// contexts. Otherwise, this type is sub-optimal for non-constexpr
+// serialization: use BufferWriter or PedanticBufferWriter for runtime
+// serialization into a byte buffer.
 class ConstexprBufferWriter {
  public:
   constexpr ConstexprBufferWriter() = default;
@@ -66,9 +73,7 @@ class ConstexprBufferWriter {
     if (length_bytes > (size_ - index_))
       return ErrorStatus::WriteLimitReached;
 
-    for (std::size_t i = 0; i < length; i++)
-      WriteElement(begin[i], i * element_size);
-
+    WriteElements(begin, length, std::is_integral<T>{});
     index_ += length_bytes;
     return {};
   }
@@ -79,6 +84,12 @@ class ConstexprBufferWriter {
     if (!status)
       return status;
 
+    if (!NOP_IS_CONSTANT_EVALUATED()) {
+      std::memset(&buffer_[index_], padding_value, padding_bytes);
+      index_ += padding_bytes;
+      return {};
+    }
+
     while (padding_bytes) {
       buffer_[index_++] = padding_value;
       padding_bytes--;
@@ -91,6 +102,27 @@ class ConstexprBufferWriter {
   constexpr std::size_t capacity() const { return size_; }
 
  private:
+  // Integer elements are stored in little-endian order, which matches their
+  // memory representation on little-endian hosts, so runtime writes copy the
+  // elements in bulk.
+  template <typename T>
+  constexpr void WriteElements(const T* begin, std::size_t length,
+                               std::true_type /*is_integral*/) {
+    if (kLittleEndianHost && !NOP_IS_CONSTANT_EVALUATED()) {
+      std::memcpy(&buffer_[index_], begin, length * sizeof(T));
+    } else {
+      for (std::size_t i = 0; i < length; i++)
+        WriteElement(begin[i], i * sizeof(T));
+    }
+  }
+
+  // Floating point elements can only be written at runtime.
+  template <typename T>
+  void WriteElements(const T* begin, std::size_t length,
+                     std::false_type /*is_integral*/) {
+    std::memcpy(&buffer_[index_], begin, length * sizeof(T));
+  }
+
   // Write an integer element to the byte buffer with constexpr-compatible
   // conversions from larger integer types.
   constexpr void WriteElement(std::uint8_t value, std::size_t offset) {
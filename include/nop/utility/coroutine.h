@@ -0,0 +1,184 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_COROUTINE_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_COROUTINE_H_
+
+// Coroutine support requires C++20. This header is empty in earlier language
+// modes, so that it may be included unconditionally.
+#if defined(__cpp_impl_coroutine) && defined(__cpp_concepts)
+#define NOP_HAS_COROUTINES 1
+
+#include <concepts>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+#include <nop/status.h>
+
+namespace nop {
+
+// Task<T> is a lazily started coroutine that produces a value of type T. A
+// task is started by awaiting it from another coroutine, which is resumed
+// with the value when the task completes, or by calling Start() from ordinary
+// code, after which done() and result() report the outcome.
+//
+// The library reports errors through Status<T> rather than exceptions, so
+// exceptions that escape a task terminate the program.
+template <typename T>
+class [[nodiscard]] Task {
+ public:
+  static_assert(!std::is_void<T>::value, "Task<void> is not supported.");
+
+  struct promise_type {
+    std::optional<T> value;
+    std::coroutine_handle<> continuation;
+
+    Task get_return_object() {
+      return Task{std::coroutine_handle<promise_type>::from_promise(*this)};
+    }
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+
+    // Resumes the awaiting coroutine, if any, by symmetric transfer.
+    struct FinalAwaiter {
+      bool await_ready() noexcept { return false; }
+      std::coroutine_handle<> await_suspend(
+          std::coroutine_handle<promise_type> handle) noexcept {
+        auto continuation = handle.promise().continuation;
+        return continuation ? continuation : std::noop_coroutine();
+      }
+      void await_resume() noexcept {}
+    };
+
+    FinalAwaiter final_suspend() noexcept { return {}; }
+
+    template <typename U>
+    void return_value(U&& result) {
+      value.emplace(std::forward<U>(result));
+    }
+
+    void unhandled_exception() noexcept { std::terminate(); }
+  };
+
+  Task(Task&& other) noexcept
+      : handle_{std::exchange(other.handle_, nullptr)} {}
+  Task& operator=(Task&& other) noexcept {
+    if (this != &other) {
+      Destroy();
+      handle_ = std::exchange(other.handle_, nullptr);
+    }
+    return *this;
+  }
+  ~Task() { Destroy(); }
+
+  Task(const Task&) = delete;
+  void operator=(const Task&) = delete;
+
+  auto operator co_await() && noexcept {
+    struct Awaiter {
+      std::coroutine_handle<promise_type> handle;
+
+      bool await_ready() const noexcept { return handle.done(); }
+      std::coroutine_handle<> await_suspend(
+          std::coroutine_handle<> continuation) noexcept {
+        handle.promise().continuation = continuation;
+        return handle;
+      }
+      T await_resume() { return std::move(*handle.promise().value); }
+    };
+    return Awaiter{handle_};
+  }
+
+  // Runs the task from ordinary code until it completes or first suspends.
+  void Start() {
+    if (!handle_.done())
+      handle_.resume();
+  }
+
+  bool done() const { return handle_.done(); }
+
+  // Returns the result of a completed task.
+  const T& result() const { return *handle_.promise().value; }
+  T& result() { return *handle_.promise().value; }
+
+ private:
+  explicit Task(std::coroutine_handle<promise_type> handle) : handle_{handle} {}
+
+  void Destroy() {
+    if (handle_)
+      handle_.destroy();
+  }
+
+  std::coroutine_handle<promise_type> handle_;
+};
+
+namespace detail {
+
+template <typename T>
+concept Awaiter = requires(T awaiter, std::coroutine_handle<> handle) {
+  { awaiter.await_ready() } -> std::convertible_to<bool>;
+  awaiter.await_suspend(handle);
+  awaiter.await_resume();
+};
+
+template <typename T>
+decltype(auto) GetAwaiter(T&& awaitable) {
+  if constexpr (requires { std::forward<T>(awaitable).operator co_await(); })
+    return std::forward<T>(awaitable).operator co_await();
+  else
+    return std::forward<T>(awaitable);
+}
+
+}  // namespace detail
+
+// Satisfied by types that can be awaited to produce a value convertible to
+// Result.
+template <typename T, typename Result>
+concept AwaitableOf = requires(T&& awaitable) {
+  { detail::GetAwaiter(std::forward<T>(awaitable)) } -> detail::Awaiter;
+  {
+    detail::GetAwaiter(std::forward<T>(awaitable)).await_resume()
+  } -> std::convertible_to<Result>;
+};
+
+// Coroutine-friendly counterpart of the Reader concept, for transports that
+// suspend the calling coroutine instead of blocking a thread. Read() returns
+// an awaitable that completes with success once exactly |size| bytes are
+// stored at |data|, or with the error of the transport.
+template <typename T>
+concept AsyncReader = requires(T& reader, std::uint8_t* data,
+                               std::size_t size) {
+  { reader.Read(data, size) } -> AwaitableOf<Status<void>>;
+};
+
+// Coroutine-friendly counterpart of the Writer concept. Write() returns an
+// awaitable that completes once all |size| bytes at |data| are written.
+template <typename T>
+concept AsyncWriter = requires(T& writer, const std::uint8_t* data,
+                               std::size_t size) {
+  { writer.Write(data, size) } -> AwaitableOf<Status<void>>;
+};
+
+}  // namespace nop
+
+#endif  // defined(__cpp_impl_coroutine) && defined(__cpp_concepts)
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_COROUTINE_H_
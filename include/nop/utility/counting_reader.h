@@ -0,0 +1,126 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_COUNTING_READER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_COUNTING_READER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+#include <nop/base/encoding.h>
+#include <nop/base/handle.h>
+#include <nop/base/pointer.h>
+#include <nop/base/utility.h>
+#include <nop/types/interned.h>
+#include <nop/utility/io_stats.h>
+#include <nop/utility/reuse_storage.h>
+
+namespace nop {
+
+// CountingReader is a reader type that wraps another reader pointer and
+// transparently passes every operation to it, while accumulating the number of
+// calls, the bytes read, a histogram of read sizes and, optionally, the time
+// spent in the underlying reader in IoStats. See CountingWriter.
+template <typename Reader, typename Clock = NoClock>
+class CountingReader {
+ public:
+  CountingReader() = default;
+  CountingReader(const CountingReader&) = default;
+  CountingReader(Reader* reader) : reader_{reader} {}
+
+  CountingReader& operator=(const CountingReader&) = default;
+
+  Status<void> Ensure(std::size_t size) {
+    stats_.prepare_calls++;
+    stats_.prepared_bytes += size;
+    return detail::MeasureIo<Clock>(&stats_,
+                                    [&] { return reader_->Ensure(size); });
+  }
+
+  Status<void> Read(std::uint8_t* byte) {
+    detail::CountTransfer(&stats_, 1);
+    return detail::MeasureIo<Clock>(&stats_,
+                                    [&] { return reader_->Read(byte); });
+  }
+
+  template <typename T, typename Enable = EnableIfArithmetic<T>>
+  Status<void> Read(T* begin, T* end) {
+    detail::CountTransfer(&stats_, (end - begin) * sizeof(T));
+    return detail::MeasureIo<Clock>(&stats_,
+                                    [&] { return reader_->Read(begin, end); });
+  }
+
+  Status<void> Skip(std::size_t padding_bytes) {
+    stats_.skip_calls++;
+    stats_.skipped_bytes += padding_bytes;
+    return detail::MeasureIo<Clock>(
+        &stats_, [&] { return reader_->Skip(padding_bytes); });
+  }
+
+  // Only available when the underlying reader supports borrowing.
+  template <typename R = Reader, typename Enabled = ReaderBorrowTest<R>>
+  Status<void> Borrow(std::size_t size, const void** data) {
+    detail::CountTransfer(&stats_, size);
+    stats_.borrowed_bytes += size;
+    return detail::MeasureIo<Clock>(
+        &stats_, [&] { return reader_->Borrow(size, data); });
+  }
+
+  static constexpr bool kReuseStorage = ReaderReusesStorage<Reader>::value;
+  static constexpr bool kBorrowToCopy = ReaderBorrowsToCopy<Reader>::value;
+
+  template <typename HandleType>
+  Status<HandleType> GetHandle(HandleReference handle_reference) {
+    return reader_->template GetHandle<HandleType>(handle_reference);
+  }
+
+  template <typename R = Reader, typename Enabled = ReaderDefineStringTest<R>>
+  Status<void> DefineString(StringView string) {
+    return reader_->DefineString(string);
+  }
+
+  template <typename R = Reader, typename Enabled = ReaderGetStringTest<R>>
+  Status<StringView> GetString(StringReference reference) {
+    return reader_->GetString(reference);
+  }
+
+  template <typename R = Reader, typename Enabled = ReaderDefinePointerTest<R>>
+  Status<void> DefinePointer(std::shared_ptr<void> pointer, PointerType type) {
+    return reader_->DefinePointer(std::move(pointer), type);
+  }
+
+  template <typename R = Reader, typename Enabled = ReaderGetPointerTest<R>>
+  Status<std::shared_ptr<void>> GetPointer(PointerReference reference,
+                                           PointerType type) {
+    return reader_->GetPointer(reference, type);
+  }
+
+  const IoStats& stats() const { return stats_; }
+  void ResetStats() { stats_.Reset(); }
+
+  const Reader* reader() const { return reader_; }
+  Reader* reader() { return reader_; }
+
+ private:
+  Reader* reader_{nullptr};
+  IoStats stats_;
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_COUNTING_READER_H_
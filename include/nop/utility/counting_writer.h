@@ -0,0 +1,137 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_COUNTING_WRITER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_COUNTING_WRITER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include <nop/base/encoding.h>
+#include <nop/base/handle.h>
+#include <nop/base/pointer.h>
+#include <nop/base/serializer.h>
+#include <nop/base/utility.h>
+#include <nop/types/interned.h>
+#include <nop/utility/canonical.h>
+#include <nop/utility/exact_table_entries.h>
+#include <nop/utility/io_stats.h>
+
+namespace nop {
+
+// CountingWriter is a writer type that wraps another writer pointer and
+// transparently passes every operation to it, while accumulating the number of
+// calls, the bytes written, a histogram of write sizes and, optionally, the
+// time spent in the underlying writer in IoStats. The counters are cheap enough
+// to leave enabled in production builds. Timing is disabled with the default
+// NoClock; use SteadyClock or CycleClock to enable it.
+//
+// Example:
+//
+//   FdWriter fd_writer{fd};
+//   Serializer<CountingWriter<FdWriter>> serializer{&fd_writer};
+//   auto status = serializer.Write(message);
+//   ...
+//   const IoStats& stats = serializer.writer().stats();
+//
+template <typename Writer, typename Clock = NoClock>
+class CountingWriter {
+ public:
+  CountingWriter() = default;
+  CountingWriter(const CountingWriter&) = default;
+  CountingWriter(Writer* writer) : writer_{writer} {}
+
+  CountingWriter& operator=(const CountingWriter&) = default;
+
+  // Preserve the preparation behavior of the underlying writer.
+  static constexpr bool kNeedsPrepare = WriterNeedsPrepare<Writer>::value;
+
+  Status<void> Prepare(std::size_t size) {
+    stats_.prepare_calls++;
+    stats_.prepared_bytes += size;
+    return detail::MeasureIo<Clock>(&stats_,
+                                    [&] { return writer_->Prepare(size); });
+  }
+
+  Status<void> Write(std::uint8_t byte) {
+    detail::CountTransfer(&stats_, 1);
+    return detail::MeasureIo<Clock>(&stats_,
+                                    [&] { return writer_->Write(byte); });
+  }
+
+  template <typename T, typename Enable = EnableIfArithmetic<T>>
+  Status<void> Write(const T* begin, const T* end) {
+    detail::CountTransfer(&stats_, (end - begin) * sizeof(T));
+    return detail::MeasureIo<Clock>(
+        &stats_, [&] { return writer_->Write(begin, end); });
+  }
+
+  Status<void> Skip(std::size_t padding_bytes,
+                    std::uint8_t padding_value = 0x00) {
+    stats_.skip_calls++;
+    stats_.skipped_bytes += padding_bytes;
+    return detail::MeasureIo<Clock>(&stats_, [&] {
+      return writer_->Skip(padding_bytes, padding_value);
+    });
+  }
+
+  // Preserve the canonical mode of the underlying writer.
+  static constexpr bool kCanonical = WriterIsCanonical<Writer>::value;
+
+  // Forwards patching to the underlying writer. Patches are not counted as
+  // writes.
+  static constexpr bool kExactTableEntries =
+      WriterExactTableEntries<Writer>::value;
+
+  std::size_t offset() const { return writer_->offset(); }
+
+  Status<void> Patch(std::size_t offset, const std::uint8_t* begin,
+                     const std::uint8_t* end) {
+    return writer_->Patch(offset, begin, end);
+  }
+
+  template <typename HandleType>
+  Status<HandleReference> PushHandle(const HandleType& handle) {
+    return writer_->PushHandle(handle);
+  }
+
+  template <typename W = Writer, typename Enabled = WriterInternStringTest<W>>
+  Status<StringReference> InternString(StringView string) {
+    return writer_->InternString(string);
+  }
+
+  template <typename T, typename W = Writer,
+            typename Enabled = WriterInternPointerTest<W>>
+  Status<PointerReference> InternPointer(const std::shared_ptr<T>& pointer,
+                                         PointerType type) {
+    return writer_->InternPointer(pointer, type);
+  }
+
+  const IoStats& stats() const { return stats_; }
+  void ResetStats() { stats_.Reset(); }
+
+  const Writer* writer() const { return writer_; }
+  Writer* writer() { return writer_; }
+
+ private:
+  Writer* writer_{nullptr};
+  IoStats stats_;
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_COUNTING_WRITER_H_
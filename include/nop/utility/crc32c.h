@@ -0,0 +1,163 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_CRC32C_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_CRC32C_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <nop/utility/endian.h>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define NOP_CRC32C_X86
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
+
+namespace nop {
+
+// CRC32C (Castagnoli) checksum, as used by iSCSI, ext4 and many storage
+// formats.
+//
+// Uses the SSE4.2 crc32 instruction on x86-64 processors that support it,
+// which is detected at runtime, and the ARMv8 CRC32 instructions when the
+// target enables them. Other targets use a portable slicing-by-8
+// implementation.
+//
+// Example of computing the checksum of data that arrives in pieces:
+//
+//   std::uint32_t crc = 0;
+//   crc = Crc32c::Extend(crc, first, first_size);
+//   crc = Crc32c::Extend(crc, second, second_size);
+//
+class Crc32c {
+ public:
+  // Returns the checksum of the data covered by |crc|, which is the checksum of
+  // the preceding data or zero, followed by |size| bytes at |data|.
+  static std::uint32_t Extend(std::uint32_t crc, const void* data,
+                              std::size_t size) {
+    const std::uint8_t* bytes = static_cast<const std::uint8_t*>(data);
+#if defined(NOP_CRC32C_X86)
+    if (HasSse42())
+      return ~ExtendSse42(~crc, bytes, size);
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+    return ~ExtendArm(~crc, bytes, size);
+#endif
+    return ~ExtendPortable(~crc, bytes, size);
+  }
+
+  static std::uint32_t Compute(const void* data, std::size_t size) {
+    return Extend(0, data, size);
+  }
+
+  // Portable implementation, exposed for testing. Operates on the raw register
+  // value rather than the finalized checksum.
+  static std::uint32_t ExtendPortable(std::uint32_t crc,
+                                      const std::uint8_t* data,
+                                      std::size_t size) {
+    const Tables& tables = GetTables();
+    if (kLittleEndianHost) {
+      while (size >= 8) {
+        std::uint32_t low, high;
+        std::memcpy(&low, data, sizeof(low));
+        std::memcpy(&high, data + 4, sizeof(high));
+        low ^= crc;
+        crc = tables.t[7][low & 0xff] ^ tables.t[6][(low >> 8) & 0xff] ^
+              tables.t[5][(low >> 16) & 0xff] ^ tables.t[4][low >> 24] ^
+              tables.t[3][high & 0xff] ^ tables.t[2][(high >> 8) & 0xff] ^
+              tables.t[1][(high >> 16) & 0xff] ^ tables.t[0][high >> 24];
+        data += 8;
+        size -= 8;
+      }
+    }
+
+    while (size-- > 0)
+      crc = tables.t[0][(crc ^ *data++) & 0xff] ^ (crc >> 8);
+    return crc;
+  }
+
+ private:
+  struct Tables {
+    std::uint32_t t[8][256];
+  };
+
+  static const Tables& GetTables() {
+    static const Tables tables = [] {
+      // Reflected Castagnoli polynomial.
+      const std::uint32_t polynomial = 0x82f63b78;
+      Tables tables;
+      for (std::uint32_t i = 0; i < 256; i++) {
+        std::uint32_t crc = i;
+        for (int bit = 0; bit < 8; bit++)
+          crc = (crc >> 1) ^ ((crc & 1) ? polynomial : 0);
+        tables.t[0][i] = crc;
+      }
+      for (std::size_t k = 1; k < 8; k++) {
+        for (std::size_t i = 0; i < 256; i++) {
+          const std::uint32_t previous = tables.t[k - 1][i];
+          tables.t[k][i] = (previous >> 8) ^ tables.t[0][previous & 0xff];
+        }
+      }
+      return tables;
+    }();
+    return tables;
+  }
+
+#if defined(NOP_CRC32C_X86)
+  static bool HasSse42() {
+    static const bool has_sse42 = __builtin_cpu_supports("sse4.2");
+    return has_sse42;
+  }
+
+  __attribute__((target("sse4.2"))) static std::uint32_t ExtendSse42(
+      std::uint32_t crc, const std::uint8_t* data, std::size_t size) {
+    std::uint64_t crc64 = crc;
+    while (size >= 8) {
+      std::uint64_t word;
+      std::memcpy(&word, data, sizeof(word));
+      crc64 = __builtin_ia32_crc32di(crc64, word);
+      data += 8;
+      size -= 8;
+    }
+
+    crc = static_cast<std::uint32_t>(crc64);
+    while (size-- > 0)
+      crc = __builtin_ia32_crc32qi(crc, *data++);
+    return crc;
+  }
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+  static std::uint32_t ExtendArm(std::uint32_t crc, const std::uint8_t* data,
+                                 std::size_t size) {
+    while (size >= 8) {
+      std::uint64_t word;
+      std::memcpy(&word, data, sizeof(word));
+      crc = __crc32cd(crc, word);
+      data += 8;
+      size -= 8;
+    }
+
+    while (size-- > 0)
+      crc = __crc32cb(crc, *data++);
+    return crc;
+  }
+#endif
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_CRC32C_H_
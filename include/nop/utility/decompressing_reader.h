@@ -0,0 +1,137 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_DECOMPRESSING_READER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_DECOMPRESSING_READER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <nop/base/encoding.h>
+#include <nop/base/utility.h>
+#include <nop/utility/compression.h>
+#include <nop/utility/endian.h>
+
+namespace nop {
+
+// DecompressingReader is a reader type that wraps another reader pointer and
+// decompresses frames written by CompressingWriter with the same Codec. Frames
+// are read from the underlying reader as data is needed, so a message is
+// decoded as soon as the frames that contain it are available.
+//
+// Frames that are malformed, or that claim a size larger than
+// kMaxCompressionFrameSize, result in ErrorStatus::ProtocolError.
+template <typename Reader, typename Codec = Lz4Codec>
+class DecompressingReader {
+ public:
+  DecompressingReader() = default;
+  DecompressingReader(Reader* reader) : reader_{reader} {}
+
+  DecompressingReader(const DecompressingReader&) = delete;
+  void operator=(const DecompressingReader&) = delete;
+
+  // The input is a stream: frames may still arrive, so there is no limit to
+  // check in advance.
+  Status<void> Ensure(std::size_t /*size*/) { return {}; }
+
+  Status<void> Read(std::uint8_t* byte) { return Read(byte, byte + 1); }
+
+  template <typename T, typename Enable = EnableIfArithmetic<T>>
+  Status<void> Read(T* begin, T* end) {
+    std::uint8_t* data = reinterpret_cast<std::uint8_t*>(begin);
+    return Consume((end - begin) * sizeof(T),
+                   [&data](const std::uint8_t* in, std::size_t length) {
+                     std::memcpy(data, in, length);
+                     data += length;
+                   });
+  }
+
+  Status<void> Skip(std::size_t padding_bytes) {
+    return Consume(padding_bytes, [](const std::uint8_t*, std::size_t) {});
+  }
+
+  // Returns true if all of the data of the frames read so far is consumed.
+  bool empty() const { return index_ == buffer_.size(); }
+
+  const Reader* reader() const { return reader_; }
+  Reader* reader() { return reader_; }
+
+ private:
+  template <typename Op>
+  Status<void> Consume(std::size_t length, Op op) {
+    while (length > 0) {
+      if (empty()) {
+        auto status = ReadFrame();
+        if (!status)
+          return status;
+      }
+
+      const std::size_t available = buffer_.size() - index_;
+      const std::size_t count = length < available ? length : available;
+      op(buffer_.data() + index_, count);
+      index_ += count;
+      length -= count;
+    }
+
+    return {};
+  }
+
+  Status<void> ReadFrame() {
+    std::uint32_t header[2];
+    auto status = reader_->Read(header, header + 2);
+    if (!status)
+      return status;
+
+    const std::size_t raw_size =
+        HostEndian<std::uint32_t>::FromLittle(header[0]);
+    const std::size_t stored_size =
+        HostEndian<std::uint32_t>::FromLittle(header[1]);
+    if (raw_size > kMaxCompressionFrameSize || stored_size > raw_size ||
+        raw_size == 0) {
+      return ErrorStatus::ProtocolError;
+    }
+
+    buffer_.resize(raw_size);
+    index_ = 0;
+    if (stored_size == raw_size)
+      return reader_->Read(buffer_.data(), buffer_.data() + raw_size);
+
+    compressed_.resize(stored_size);
+    status =
+        reader_->Read(compressed_.data(), compressed_.data() + stored_size);
+    if (!status)
+      return status;
+
+    if (!Codec::Decompress(compressed_.data(), stored_size, buffer_.data(),
+                           raw_size)) {
+      buffer_.clear();
+      return ErrorStatus::ProtocolError;
+    }
+
+    return {};
+  }
+
+  Reader* reader_{nullptr};
+  std::vector<std::uint8_t> buffer_;
+  std::vector<std::uint8_t> compressed_;
+  std::size_t index_{0};
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_DECOMPRESSING_READER_H_
@@ -0,0 +1,81 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_DEFAULT_INIT_ALLOCATOR_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_DEFAULT_INIT_ALLOCATOR_H_
+
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace nop {
+
+// Allocator adaptor that default-initializes elements constructed without
+// arguments, instead of value-initializing them. For arithmetic elements this
+// means that std::vector::resize() leaves new elements uninitialized rather
+// than zero-filling them.
+//
+// Deserializing a vector resizes it to the decoded length and then reads the
+// elements over the new storage. With this allocator, the storage of large
+// arrays is only written once:
+//
+//   template <typename T>
+//   using UninitializedVector = std::vector<T, nop::DefaultInitAllocator<T>>;
+//
+//   struct Blob {
+//     UninitializedVector<std::uint32_t> data;
+//     NOP_STRUCTURE(Blob, data);
+//   };
+//
+// Vectors of single byte elements and strings already skip the initialization
+// when the reader supports Borrow(), such as BufferReader.
+template <typename T, typename Allocator = std::allocator<T>>
+class DefaultInitAllocator : public Allocator {
+  using Traits = std::allocator_traits<Allocator>;
+
+ public:
+  template <typename U>
+  struct rebind {
+    using other = DefaultInitAllocator<
+        U, typename Traits::template rebind_alloc<U>>;
+  };
+
+  using Allocator::Allocator;
+
+  DefaultInitAllocator() = default;
+  DefaultInitAllocator(const Allocator& allocator) : Allocator{allocator} {}
+
+  template <typename U, typename UAllocator>
+  DefaultInitAllocator(const DefaultInitAllocator<U, UAllocator>& other)
+      : Allocator{static_cast<const UAllocator&>(other)} {}
+
+  template <typename U>
+  void construct(U* pointer) noexcept(
+      std::is_nothrow_default_constructible<U>::value) {
+    ::new (static_cast<void*>(pointer)) U;
+  }
+
+  template <typename U, typename... Args>
+  void construct(U* pointer, Args&&... args) {
+    Traits::construct(static_cast<Allocator&>(*this), pointer,
+                      std::forward<Args>(args)...);
+  }
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_DEFAULT_INIT_ALLOCATOR_H_
@@ -0,0 +1,90 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_ENCODE_CONSTANT_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_ENCODE_CONSTANT_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include <nop/base/encoding.h>
+#include <nop/base/serializer.h>
+#include <nop/status.h>
+#include <nop/utility/constexpr_buffer_writer.h>
+
+namespace nop {
+
+namespace detail {
+
+// Not constexpr: reaching a call during constant evaluation makes the
+// evaluation fail, reporting encoding errors at compile time.
+inline void ConstantEncodingFailed(ErrorStatus /*error*/) {}
+
+template <std::size_t Size, std::size_t... Is>
+constexpr std::array<std::uint8_t, Size> ToArray(
+    const std::uint8_t (&buffer)[Size], std::index_sequence<Is...>) {
+  return {{buffer[Is]...}};
+}
+
+}  // namespace detail
+
+// Encodes |value| into an array of |Size| bytes in a constant expression,
+// suitable for embedding fixed messages in the binary instead of encoding
+// them at runtime. |Size| must be at least Encoding<T>::Size(value); bytes
+// beyond the encoding are zero. Encoding errors, including a short buffer,
+// fail the constant evaluation.
+//
+// Example:
+//
+//   constexpr Handshake MakeHandshake() { ... }
+//   constexpr auto kHandshake = nop::EncodeConstant<
+//       nop::Encoding<Handshake>::Size(MakeHandshake())>(MakeHandshake());
+//
+template <std::size_t Size, typename T>
+constexpr std::array<std::uint8_t, Size> EncodeConstant(const T& value) {
+  std::uint8_t buffer[Size]{};
+  Serializer<ConstexprBufferWriter> serializer{buffer, Size};
+  auto status = serializer.Write(value);
+  if (!status)
+    detail::ConstantEncodingFailed(status.error());
+
+  return detail::ToArray(buffer, std::make_index_sequence<Size>{});
+}
+
+// Encodes the constant |Value| into an array sized exactly by
+// Encoding<T>::Size(Value). |Value| must be an object with static storage
+// duration and linkage, such as a namespace-scope constexpr variable.
+//
+// Example:
+//
+//   constexpr Capabilities kCapabilities{...};
+//   constexpr auto kCapabilitiesMessage =
+//       nop::EncodeConstant<Capabilities, kCapabilities>();
+//
+//   auto status = writer.Write(kCapabilitiesMessage.begin(),
+//                              kCapabilitiesMessage.end());
+//
+template <typename T, const T& Value>
+constexpr std::array<std::uint8_t, Encoding<T>::Size(Value)> EncodeConstant() {
+  return EncodeConstant<Encoding<T>::Size(Value)>(Value);
+}
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_ENCODE_CONSTANT_H_
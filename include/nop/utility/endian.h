@@ -17,6 +17,7 @@
 #ifndef LIBNOP_INCLUDE_NOP_UTILITY_ENDIAN_H_
 #define LIBNOP_INCLUDE_NOP_UTILITY_ENDIAN_H_
 
+#include <cstddef>
 #include <cstdint>
 #include <type_traits>
 #include <utility>
@@ -50,8 +51,21 @@
 // instruction, depending on the host endianness.
 //
 
+// Evaluates to 1 when the host stores integers in big-endian byte order. Hosts
+// that do not report their byte order are assumed to be little-endian.
+#if defined(__BYTE_ORDER__) && defined(__ORDER_BIG_ENDIAN__) && \
+    __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define NOP_BIG_ENDIAN_HOST 1
+#else
+#define NOP_BIG_ENDIAN_HOST 0
+#endif
+
 namespace nop {
 
+// True when the host byte order matches the little-endian wire format, in
+// which case arithmetic values are written and read without conversion.
+constexpr bool kLittleEndianHost = !NOP_BIG_ENDIAN_HOST;
+
 // Base type for endian conversions to host endianness.
 template <typename T, typename Enable = void>
 struct HostEndian;
@@ -85,6 +99,24 @@ struct HostEndian<T, std::enable_if_t<std::is_integral<T>::value>> {
   // Returns the given host-endian value in little endianness.
   static constexpr T ToLittle(T value) { return FromLittle(value); }
 
+  // Bulk versions of the conversions above. Each converts the |count| values
+  // at |in| and stores the results at |out|, which may be the same as |in|.
+  // The loops are simple enough for compilers to vectorize into byte shuffles.
+  static void FromBig(const T* in, std::size_t count, T* out) {
+    for (std::size_t i = 0; i < count; i++)
+      out[i] = FromBig(in[i]);
+  }
+  static void ToBig(const T* in, std::size_t count, T* out) {
+    FromBig(in, count, out);
+  }
+  static void FromLittle(const T* in, std::size_t count, T* out) {
+    for (std::size_t i = 0; i < count; i++)
+      out[i] = FromLittle(in[i]);
+  }
+  static void ToLittle(const T* in, std::size_t count, T* out) {
+    FromLittle(in, count, out);
+  }
+
  private:
   // Allow other specializations to access private members.
   template <typename, typename>
@@ -136,8 +168,8 @@ struct HostEndian<T, std::enable_if_t<std::is_floating_point<T>::value>> {
     union {
       Integral value;
       T native;
-    } output{HostEndian<Integral>::FromLittle(input.data,
-                                              std::make_index_sequence<N>{})};
+    } output{HostEndian<Integral>::FromBig(input.data,
+                                           std::make_index_sequence<N>{})};
     return output.native;
   }
 
@@ -153,14 +185,30 @@ struct HostEndian<T, std::enable_if_t<std::is_floating_point<T>::value>> {
     union {
       Integral value;
       T native;
-    } output{HostEndian<Integral>::FromBig(input.data,
-                                           std::make_index_sequence<N>{})};
+    } output{HostEndian<Integral>::FromLittle(input.data,
+                                              std::make_index_sequence<N>{})};
     return output.native;
   }
 
   // Returns the given host-endian value in little endianness.
   static constexpr T ToLittle(T value) { return FromLittle(value); }
 
+  // Bulk conversions, as for integral types.
+  static void FromBig(const T* in, std::size_t count, T* out) {
+    for (std::size_t i = 0; i < count; i++)
+      out[i] = FromBig(in[i]);
+  }
+  static void ToBig(const T* in, std::size_t count, T* out) {
+    FromBig(in, count, out);
+  }
+  static void FromLittle(const T* in, std::size_t count, T* out) {
+    for (std::size_t i = 0; i < count; i++)
+      out[i] = FromLittle(in[i]);
+  }
+  static void ToLittle(const T* in, std::size_t count, T* out) {
+    FromLittle(in, count, out);
+  }
+
  private:
   // Type matching utility to map from floating point to integral type of the
   // same size. The type long double is not included because there is no well
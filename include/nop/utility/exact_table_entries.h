@@ -0,0 +1,71 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_EXACT_TABLE_ENTRIES_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_EXACT_TABLE_ENTRIES_H_
+
+#include <type_traits>
+
+#include <nop/traits/void.h>
+
+namespace nop {
+
+// Table entries are written with the length computed by Size() followed by the
+// entry value. Since a few encodings, such as Handle, overestimate their size,
+// the entry is padded out to the length written before it. Writers that can
+// revise bytes already written may opt in to exact entry lengths instead, by
+// defining the following members:
+//
+//   // Returns the number of bytes written so far.
+//   std::size_t offset() const;
+//
+//   // Overwrites the bytes previously written at |offset| with the bytes from
+//   // |begin| until reaching |end|.
+//   Status<void> Patch(std::size_t offset, const std::uint8_t* begin,
+//                      const std::uint8_t* end);
+//
+//   static constexpr bool kExactTableEntries = true;
+//
+// The table encoding then writes each entry without padding and replaces the
+// estimated length with the actual length, encoded in the same number of bytes
+// so that the bytes already written do not move. The entry length may therefore
+// use a wider integer encoding than necessary, which readers accept.
+//
+// BufferWriter, VectorWriter and UnixSocketWriter support patching. Since exact
+// entry lengths change the encoding produced, these writers opt in with
+// ExactTableEntries:
+//
+//   nop::Serializer<nop::ExactTableEntries<nop::VectorWriter>> serializer;
+//
+template <typename Writer, typename Enabled = void>
+struct WriterExactTableEntries : std::false_type {};
+template <typename Writer>
+struct WriterExactTableEntries<Writer,
+                               Void<decltype(Writer::kExactTableEntries)>>
+    : std::integral_constant<bool, Writer::kExactTableEntries> {};
+
+// Opts a writer that supports patching into exact table entry lengths.
+template <typename Writer>
+class ExactTableEntries : public Writer {
+ public:
+  using Writer::Writer;
+
+  static constexpr bool kExactTableEntries = true;
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_EXACT_TABLE_ENTRIES_H_
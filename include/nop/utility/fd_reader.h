@@ -88,6 +88,17 @@ class FdReader {
     return {};
   }
 
+  Status<void> Skip(std::size_t padding_bytes) {
+    std::uint8_t padding;
+    for (std::size_t i = 0; i < padding_bytes; i++) {
+      auto status = Read(&padding);
+      if (!status)
+        return status;
+    }
+
+    return {};
+  }
+
  private:
   int fd_{-1};
 };
@@ -56,6 +56,9 @@ class FdWriter {
     return released_fd;
   }
 
+  // This writer ignores the size passed to Prepare().
+  static constexpr bool kNeedsPrepare = false;
+
   Status<void> Prepare(std::size_t) { return {}; }
 
   Status<void> Write(std::uint8_t byte) {
@@ -85,6 +88,17 @@ class FdWriter {
     return {};
   }
 
+  Status<void> Skip(std::size_t padding_bytes,
+                    std::uint8_t padding_value = 0x00) {
+    for (std::size_t i = 0; i < padding_bytes; i++) {
+      auto status = Write(padding_value);
+      if (!status)
+        return status;
+    }
+
+    return {};
+  }
+
  private:
   int fd_{-1};
 };
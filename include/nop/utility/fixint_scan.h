@@ -0,0 +1,59 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_FIXINT_SCAN_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_FIXINT_SCAN_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace nop {
+
+// Returns the number of consecutive fixint bytes at the start of the |size|
+// bytes at |data|. A byte is a fixint unless its two most significant bits are
+// 10, which covers the positive fixints 0x00-0x7f and the negative fixints
+// 0xc0-0xff.
+//
+// The bytes are tested eight at a time using word operations, which keeps the
+// scan portable while still processing runs of fixints in bulk.
+inline std::size_t CountFixInts(const std::uint8_t* data, std::size_t size) {
+  constexpr std::uint64_t kHighBits = 0xc0c0c0c0c0c0c0c0ULL;
+  constexpr std::uint64_t kMsb = 0x8080808080808080ULL;
+  constexpr std::uint64_t kLsb = 0x0101010101010101ULL;
+
+  std::size_t count = 0;
+  while (size - count >= sizeof(std::uint64_t)) {
+    std::uint64_t word;
+    std::memcpy(&word, data + count, sizeof(word));
+
+    // Bytes that are not fixints become zero; detect any zero byte.
+    const std::uint64_t bits = (word & kHighBits) ^ kMsb;
+    if ((bits - kLsb) & ~bits & kMsb)
+      break;
+
+    count += sizeof(std::uint64_t);
+  }
+
+  while (count < size && (data[count] & 0xc0) != 0x80)
+    count++;
+
+  return count;
+}
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_FIXINT_SCAN_H_
@@ -0,0 +1,122 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_FRAME_READER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_FRAME_READER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <nop/base/serializer.h>
+#include <nop/status.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/endian.h>
+#include <nop/utility/frame_writer.h>
+#include <nop/utility/pedantic_buffer_reader.h>
+
+namespace nop {
+
+// FrameReader reads the length-prefixed frames written by FrameWriter from an
+// underlying reader. Each frame is pulled into memory with one read of the
+// header and one read of the payload, and is then decoded from memory. Frames
+// may also be read into caller-provided buffers, for example to hand them to
+// worker threads that decode in parallel.
+//
+// Frames that claim a length larger than the maximum passed to the constructor
+// result in ErrorStatus::ProtocolError before any memory is allocated for them.
+//
+// Example:
+//
+//   FdReader fd_reader{socket_fd};
+//   FrameReader<FdReader> frame_reader{&fd_reader};
+//
+//   Request request;
+//   auto status = frame_reader.Read(&request);
+//
+template <typename Reader>
+class FrameReader {
+ public:
+  // Default limit on the length of a frame.
+  enum : std::size_t { kDefaultMaxFrameSize = 64 * 1024 * 1024 };
+
+  FrameReader() = default;
+  FrameReader(Reader* reader, std::size_t max_frame_size = kDefaultMaxFrameSize)
+      : reader_{reader}, max_frame_size_{max_frame_size} {}
+
+  FrameReader(const FrameReader&) = delete;
+  void operator=(const FrameReader&) = delete;
+
+  // Reads the payload of the next frame into |frame|, replacing its contents.
+  // The capacity of |frame| is reused.
+  Status<void> ReadFrame(std::vector<std::uint8_t>* frame) {
+    std::uint32_t header;
+    auto status = reader_->Read(&header, &header + 1);
+    if (!status)
+      return status;
+
+    const std::size_t length = HostEndian<std::uint32_t>::FromLittle(header);
+    if (length > max_frame_size_)
+      return ErrorStatus::ProtocolError;
+
+    frame->resize(length);
+    return reader_->Read(frame->data(), frame->data() + length);
+  }
+
+  // Reads the next frame into the internal buffer and returns a reader over its
+  // payload. The reader is valid until the next frame is read. BufferReader
+  // only checks bounds in Ensure(), so use it to decode trusted frames.
+  Status<BufferReader> Next() {
+    auto status = ReadFrame(&buffer_);
+    if (!status)
+      return status.error();
+
+    return BufferReader{buffer_.data(), buffer_.size()};
+  }
+
+  // Reads the next frame and decodes |value| from it with bounds checks, so
+  // that truncated or malicious frames are rejected. Returns
+  // ErrorStatus::ProtocolError if the message does not fill the frame.
+  template <typename T>
+  Status<void> Read(T* value) {
+    auto status = ReadFrame(&buffer_);
+    if (!status)
+      return status;
+
+    PedanticBufferReader frame_reader{buffer_.data(), buffer_.size()};
+    status = Deserializer<PedanticBufferReader*>{&frame_reader}.Read(value);
+    if (!status)
+      return status;
+    else if (!frame_reader.empty())
+      return ErrorStatus::ProtocolError;
+    else
+      return {};
+  }
+
+  std::size_t max_frame_size() const { return max_frame_size_; }
+
+  const Reader* reader() const { return reader_; }
+  Reader* reader() { return reader_; }
+
+ private:
+  Reader* reader_{nullptr};
+  std::size_t max_frame_size_{kDefaultMaxFrameSize};
+  std::vector<std::uint8_t> buffer_;
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_FRAME_READER_H_
@@ -0,0 +1,126 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_FRAME_WRITER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_FRAME_WRITER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+#include <nop/base/serializer.h>
+#include <nop/status.h>
+#include <nop/utility/endian.h>
+#include <nop/utility/vector_writer.h>
+
+namespace nop {
+
+//
+// Length-prefixed frame format:
+//
+// +-----------+---//----+
+// | U32LE: L  | L BYTES |
+// +-----------+---//----+
+//
+// Where L is the size of the serialized message in the frame. Frames contain
+// exactly one message.
+//
+
+enum : std::size_t { kFrameHeaderSize = sizeof(std::uint32_t) };
+
+namespace detail {
+
+// Discards the contents of |buffer| and reserves space for a frame header.
+inline void BeginFrame(VectorWriter* buffer) {
+  buffer->Reset();
+  buffer->Prepare(kFrameHeaderSize);
+  buffer->Skip(kFrameHeaderSize);
+}
+
+// Backfills the frame header of |buffer| with the length of the data written
+// to it since BeginFrame().
+inline Status<void> EndFrame(VectorWriter* buffer) {
+  const std::size_t length = buffer->size() - kFrameHeaderSize;
+  if (length > std::numeric_limits<std::uint32_t>::max())
+    return ErrorStatus::WriteLimitReached;
+
+  const std::uint32_t header =
+      HostEndian<std::uint32_t>::ToLittle(static_cast<std::uint32_t>(length));
+  const std::uint8_t* header_bytes =
+      reinterpret_cast<const std::uint8_t*>(&header);
+  return buffer->Patch(0, header_bytes, header_bytes + sizeof(header));
+}
+
+}  // namespace detail
+
+// FrameWriter serializes each value into an internal buffer after a
+// placeholder for the frame header, backfills the header with the resulting
+// length, and then writes the complete frame to the underlying writer with a
+// single Prepare() and Write(). A reader can therefore find the end of each
+// message without parsing it; see FrameReader.
+//
+// The internal buffer is retained between messages, so a long-lived frame
+// writer reaches a steady state where writing a message does not allocate.
+//
+// Example:
+//
+//   FdWriter fd_writer{socket_fd};
+//   FrameWriter<FdWriter> frame_writer{&fd_writer};
+//   auto status = frame_writer.Write(reply);
+//
+template <typename Writer>
+class FrameWriter {
+ public:
+  FrameWriter() = default;
+  FrameWriter(Writer* writer) : writer_{writer} {}
+
+  FrameWriter(const FrameWriter&) = delete;
+  void operator=(const FrameWriter&) = delete;
+
+  // Serializes |value| and writes it to the underlying writer as one frame.
+  template <typename T>
+  Status<void> Write(const T& value) {
+    detail::BeginFrame(&buffer_);
+    auto status = SerializerCommon::Write(value, &buffer_);
+    if (!status)
+      return status;
+
+    status = detail::EndFrame(&buffer_);
+    if (!status)
+      return status;
+
+    status = writer_->Prepare(buffer_.size());
+    if (!status)
+      return status;
+
+    return writer_->Write(buffer_.data(), buffer_.data() + buffer_.size());
+  }
+
+  // Returns the last frame written, including its header.
+  const std::uint8_t* data() const { return buffer_.data(); }
+  std::size_t size() const { return buffer_.size(); }
+
+  const Writer* writer() const { return writer_; }
+  Writer* writer() { return writer_; }
+
+ private:
+  Writer* writer_{nullptr};
+  VectorWriter buffer_;
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_FRAME_WRITER_H_
@@ -0,0 +1,162 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_HANDLE_TABLE_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_HANDLE_TABLE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#include <nop/status.h>
+#include <nop/traits/is_template_base_of.h>
+#include <nop/types/handle.h>
+
+namespace nop {
+
+// HandleTableWriter adds a message-scoped handle table to a writer type that
+// does not otherwise support handles, such as VectorWriter or BufferWriter.
+//
+// Each valid handle pushed while encoding a message is appended to a single
+// vector, and its reference is its index in the vector. References are encoded
+// with the smallest integer encoding, which takes one byte for the first 128
+// handles of a message. Empty handles are encoded as kEmptyHandleReference and
+// take no slot. The transport then passes all of the handles of the message at
+// once, for example in one sendmsg() call, together with the bytes.
+// UnixSocketWriter follows the same scheme.
+//
+// Handles are referenced, not owned: they must remain open until the message
+// has been sent. Type is the value type of the handles, such as int for file
+// descriptors.
+//
+// Example:
+//
+//   Serializer<HandleTableWriter<VectorWriter>> serializer;
+//   auto status = serializer.Write(message);
+//   if (!status)
+//     return status;
+//
+//   auto& writer = serializer.writer();
+//   status = Send(writer.data(), writer.size(), writer.handles());
+//   writer.Reset();
+//   writer.ClearHandles();
+//
+template <typename Writer, typename Type = int>
+class HandleTableWriter : public Writer {
+ public:
+  using Writer::Writer;
+
+  template <typename HandleType>
+  Status<HandleReference> PushHandle(const HandleType& handle) {
+    static_assert(std::is_same<typename HandleType::Type, Type>::value,
+                  "The handle type does not match the handle table.");
+
+    if (!handle)
+      return {kEmptyHandleReference};
+
+    handles_.push_back(handle.get());
+    return {static_cast<HandleReference>(handles_.size() - 1)};
+  }
+
+  // Reserves space for |count| handles, for messages with many handles.
+  void ReserveHandles(std::size_t count) { handles_.reserve(count); }
+
+  // Removes the handles of the current message, retaining the capacity of the
+  // table.
+  void ClearHandles() { handles_.clear(); }
+
+  // Returns the handles pushed since the last call to ClearHandles(), in the
+  // order of their references.
+  const std::vector<Type>& handles() const { return handles_; }
+  std::size_t handle_count() const { return handles_.size(); }
+
+ private:
+  std::vector<Type> handles_;
+};
+
+// HandleTableReader is the reader counterpart of HandleTableWriter. The
+// transport sets the handles received with a message before it is read, and
+// references are resolved by direct index into them.
+//
+// The reader does not own the handles. Decoding a UniqueHandle type claims the
+// handle and transfers its ownership to the value, after which the handle
+// cannot be referenced again; decoding an unmanaged Handle type borrows it.
+// The transport remains responsible for the handles that were not claimed; see
+// claimed().
+//
+// Example:
+//
+//   Deserializer<HandleTableReader<BufferReader>> deserializer{data, size};
+//   deserializer.reader().SetHandles(fds, fd_count);
+//   auto status = deserializer.Read(&message);
+//   for (std::size_t i = 0; i < fd_count; i++) {
+//     if (!deserializer.reader().claimed(i))
+//       ::close(fds[i]);
+//   }
+//
+template <typename Reader, typename Type = int>
+class HandleTableReader : public Reader {
+ public:
+  using Reader::Reader;
+
+  // Sets the handles of the next message to read. The table refers to the
+  // |count| handles at |handles|, which must remain valid while the message is
+  // read.
+  void SetHandles(const Type* handles, std::size_t count) {
+    handles_ = handles;
+    count_ = count;
+    claimed_.assign(count, 0);
+  }
+  void SetHandles(const std::vector<Type>& handles) {
+    SetHandles(handles.data(), handles.size());
+  }
+
+  template <typename HandleType>
+  Status<HandleType> GetHandle(HandleReference handle_reference) {
+    static_assert(std::is_same<typename HandleType::Type, Type>::value,
+                  "The handle type does not match the handle table.");
+
+    if (handle_reference == kEmptyHandleReference)
+      return HandleType{};
+    if (handle_reference < 0 ||
+        static_cast<std::size_t>(handle_reference) >= count_ ||
+        claimed_[handle_reference]) {
+      return ErrorStatus::InvalidHandleReference;
+    }
+
+    const std::size_t index = static_cast<std::size_t>(handle_reference);
+    if (IsTemplateBaseOf<UniqueHandle, HandleType>::value)
+      claimed_[index] = 1;
+    return HandleType{handles_[index]};
+  }
+
+  // Returns true if the handle at |index| was claimed by a UniqueHandle.
+  bool claimed(std::size_t index) const {
+    return index < count_ && claimed_[index];
+  }
+
+  std::size_t handle_count() const { return count_; }
+
+ private:
+  const Type* handles_{nullptr};
+  std::size_t count_{0};
+  std::vector<std::uint8_t> claimed_;
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_HANDLE_TABLE_H_
@@ -0,0 +1,119 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_HASHING_WRITER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_HASHING_WRITER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <nop/base/encoding.h>
+#include <nop/base/serializer.h>
+#include <nop/base/utility.h>
+#include <nop/status.h>
+#include <nop/utility/sip_hash.h>
+
+namespace nop {
+
+// HashingWriter is a writer type that computes a hash of the canonical
+// encoding of the values written to it, without storing the encoded bytes.
+// Since equal values have the same canonical encoding, the hash identifies the
+// content of a value and may be compared with a hash computed earlier, or
+// elsewhere, to detect whether the value changed. See Canonical for the
+// requirements of the canonical encoding.
+//
+// Hash is a streaming hash function, SipHash-2-4 with 64-bit output by
+// default, constructed from two 64-bit keys. Use SipHashStream<128> for a
+// 128-bit hash. Hashes are only comparable when computed with the same keys.
+//
+// Example:
+//
+//   Serializer<HashingWriter<>> serializer;
+//   auto status = serializer.Write(state);
+//   if (status && serializer.writer().hash() != last_sent_hash)
+//     SendState(state);
+//
+template <typename Hash = SipHashStream<64>>
+class HashingWriter {
+ public:
+  using Result = typename Hash::Result;
+
+  HashingWriter() : HashingWriter{0, 0} {}
+  HashingWriter(std::uint64_t k0, std::uint64_t k1) : hash_{k0, k1} {}
+
+  // This writer ignores the size passed to Prepare().
+  static constexpr bool kNeedsPrepare = false;
+
+  // This writer only produces canonical encodings.
+  static constexpr bool kCanonical = true;
+
+  Status<void> Prepare(std::size_t /*size*/) { return {}; }
+
+  Status<void> Write(std::uint8_t byte) {
+    hash_.Update(&byte, sizeof(byte));
+    return {};
+  }
+
+  template <typename T, typename Enable = EnableIfArithmetic<T>>
+  Status<void> Write(const T* begin, const T* end) {
+    hash_.Update(begin, (end - begin) * sizeof(T));
+    return {};
+  }
+
+  Status<void> Skip(std::size_t padding_bytes,
+                    std::uint8_t padding_value = 0x00) {
+    std::uint8_t padding[64];
+    std::memset(padding, padding_value, sizeof(padding));
+    while (padding_bytes > 0) {
+      const std::size_t length =
+          padding_bytes < sizeof(padding) ? padding_bytes : sizeof(padding);
+      hash_.Update(padding, length);
+      padding_bytes -= length;
+    }
+    return {};
+  }
+
+  // Returns the hash of the bytes written since construction or the last call
+  // to Reset().
+  Result hash() const { return hash_.Finish(); }
+
+  // Returns the number of bytes hashed.
+  std::size_t size() const { return hash_.length(); }
+
+  // Restarts the hash with the same keys.
+  void Reset() { hash_.Reset(); }
+
+ private:
+  Hash hash_;
+};
+
+// Returns the 64-bit content hash of |value|, keyed with |k0| and |k1|.
+template <typename T>
+Status<std::uint64_t> ContentHash(const T& value, std::uint64_t k0 = 0,
+                                  std::uint64_t k1 = 0) {
+  Serializer<HashingWriter<>> serializer{k0, k1};
+  auto status = serializer.Write(value);
+  if (!status)
+    return status.error();
+
+  return serializer.writer().hash();
+}
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_HASHING_WRITER_H_
@@ -0,0 +1,385 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_INCREMENTAL_DECODER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_INCREMENTAL_DECODER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include <nop/base/encoding.h>
+#include <nop/base/pointer.h>
+#include <nop/base/serializer.h>
+#include <nop/base/skip.h>
+#include <nop/status.h>
+#include <nop/utility/pedantic_buffer_reader.h>
+
+namespace nop {
+
+namespace detail {
+
+// ValueScanner finds the end of one encoded value in input that arrives in
+// pieces. Unlike SkipValue(), which recurses and needs the whole value up
+// front, the scanner keeps its position in the nesting of containers,
+// structures, variants, tables, and extensions on an explicit stack, so
+// scanning resumes where it left off when more input arrives. Each byte is
+// scanned once, except that a prefix together with its length or count is
+// rescanned if it was cut short, which is bounded by a few bytes.
+class ValueScanner {
+ public:
+  explicit ValueScanner(std::size_t max_depth = kDefaultMaxValueDepth)
+      : max_depth_{max_depth} {
+    Reset();
+  }
+
+  // Starts scanning a new value.
+  void Reset() {
+    stack_.clear();
+    stack_.push_back({Kind::Values, 1});
+    skip_ = 0;
+  }
+
+  // Advances |offset| through |data| of |size| bytes, which must contain the
+  // bytes passed to earlier calls since Reset(). Returns true when |offset| is
+  // at the end of the value and false when more input is needed.
+  Status<bool> Scan(const std::uint8_t* data, std::size_t size,
+                    std::size_t* offset) {
+    while (true) {
+      if (skip_ > 0) {
+        const std::size_t available = size - *offset;
+        const std::size_t count = skip_ < available ? skip_ : available;
+        *offset += count;
+        skip_ -= count;
+        if (skip_ > 0)
+          return false;
+      }
+
+      while (!stack_.empty() && stack_.back().remaining == 0)
+        stack_.pop_back();
+      if (stack_.empty())
+        return true;
+
+      PedanticBufferReader reader{data + *offset, size - *offset};
+      auto status = stack_.back().kind == Kind::Values
+                        ? ScanValueHeader(&reader)
+                        : ScanTableEntryHeader(&reader);
+      if (status.error() == ErrorStatus::ReadLimitReached)
+        return false;
+      else if (!status)
+        return status.error();
+
+      *offset += reader.capacity() - reader.remaining();
+    }
+  }
+
+ private:
+  enum class Kind { Values, TableEntries };
+
+  struct Frame {
+    Kind kind;
+    std::uint64_t remaining;
+  };
+
+  // Reads the id and length of a table entry, whose value is skipped by
+  // length as in SkipValue().
+  Status<void> ScanTableEntryHeader(PedanticBufferReader* reader) {
+    std::uint64_t id = 0;
+    auto status = Encoding<std::uint64_t>::Read(&id, reader);
+    if (!status)
+      return status;
+
+    SizeType length = 0;
+    status = Encoding<SizeType>::Read(&length, reader);
+    if (!status)
+      return status;
+
+    stack_.back().remaining--;
+    skip_ = length;
+    return {};
+  }
+
+  // Reads the prefix of a value and the lengths or counts that follow it. The
+  // scanner state changes only when the whole header was available.
+  Status<void> ScanValueHeader(PedanticBufferReader* reader) {
+    std::uint8_t byte;
+    auto status = reader->Read(&byte);
+    if (!status)
+      return status;
+
+    const EncodingByte prefix = static_cast<EncodingByte>(byte);
+    std::uint64_t skip = 0;
+    Frame child{Kind::Values, 0};
+
+    switch (prefix) {
+      case EncodingByte::Nil:
+        break;
+
+      case EncodingByte::Binary:
+      case EncodingByte::String: {
+        SizeType length = 0;
+        status = Encoding<SizeType>::Read(&length, reader);
+        skip = length;
+        break;
+      }
+
+      case EncodingByte::Array:
+      case EncodingByte::Structure:
+        status = Encoding<SizeType>::Read(&child.remaining, reader);
+        break;
+
+      case EncodingByte::Map: {
+        SizeType count = 0;
+        status = Encoding<SizeType>::Read(&count, reader);
+        if (status && count > std::numeric_limits<std::uint64_t>::max() / 2)
+          return ErrorStatus::InvalidContainerLength;
+        child.remaining = 2 * count;
+        break;
+      }
+
+      case EncodingByte::Variant: {
+        std::int32_t index = 0;
+        status = Encoding<std::int32_t>::Read(&index, reader);
+        child.remaining = 1;
+        break;
+      }
+
+      case EncodingByte::Table: {
+        std::uint64_t hash = 0;
+        status = Encoding<std::uint64_t>::Read(&hash, reader);
+        if (status)
+          status = Encoding<SizeType>::Read(&child.remaining, reader);
+        child.kind = Kind::TableEntries;
+        break;
+      }
+
+      case EncodingByte::Error:
+        status = SkipValue(reader);
+        break;
+
+      case EncodingByte::Handle:
+        status = SkipValue(reader);
+        if (status)
+          status = SkipValue(reader);
+        break;
+
+      // The string table value is a single definition or reference, and the
+      // pointer table reference is followed by a definition when it is new.
+      case EncodingByte::Extension: {
+        std::uint8_t type = 0;
+        status = Encoding<std::uint8_t>::Read(&type, reader);
+        if (!status)
+          break;
+
+        if (type == static_cast<std::uint8_t>(ExtensionType::StringTable)) {
+          child.remaining = 1;
+        } else if (type ==
+                   static_cast<std::uint8_t>(ExtensionType::SharedPointer)) {
+          PointerReference reference = 0;
+          status = Encoding<PointerReference>::Read(&reference, reader);
+          child.remaining = reference == kNewPointerReference ? 1 : 0;
+        } else {
+          return ErrorStatus::UnexpectedEncodingType;
+        }
+        break;
+      }
+
+      default: {
+        const int size = NumberPayloadSize(prefix);
+        if (size < 0)
+          return ErrorStatus::UnexpectedEncodingType;
+        skip = size;
+        break;
+      }
+    }
+    if (!status)
+      return status;
+
+    stack_.back().remaining--;
+    skip_ = skip;
+    if (child.remaining > 0) {
+      if (stack_.size() >= max_depth_)
+        return ErrorStatus::DepthLimitReached;
+      stack_.push_back(child);
+    }
+    return {};
+  }
+
+  // Returns the number of payload bytes of a number, or -1 if |prefix| is not
+  // a number.
+  static int NumberPayloadSize(EncodingByte prefix) {
+    switch (prefix) {
+      case EncodingByte::U8:
+      case EncodingByte::I8:
+        return 1;
+      case EncodingByte::U16:
+      case EncodingByte::I16:
+        return 2;
+      case EncodingByte::U32:
+      case EncodingByte::I32:
+      case EncodingByte::F32:
+        return 4;
+      case EncodingByte::U64:
+      case EncodingByte::I64:
+      case EncodingByte::F64:
+        return 8;
+      default:
+        return prefix <= EncodingByte::PositiveFixIntMax ||
+                       prefix >= EncodingByte::NegativeFixIntMin
+                   ? 0
+                   : -1;
+    }
+  }
+
+  std::size_t max_depth_;
+  std::vector<Frame> stack_;
+  std::uint64_t skip_{0};
+};
+
+}  // namespace detail
+
+// IncrementalDecoder decodes values of type T from a byte stream that arrives
+// in pieces, such as a non-blocking socket. Feed() accepts whatever bytes have
+// been received and reports whether a complete value is available, so that an
+// event loop never blocks waiting for the rest of a message and never rescans
+// the part of a message it has already seen.
+//
+// The decoder scans the structure of the value as bytes arrive, using the
+// prefixes and lengths of the format, and buffers the bytes of the value.
+// Once the last byte has arrived the value is decoded from memory in a single
+// pass with bounds checks. Feed() consumes input only up to the end of the
+// current value, so back-to-back messages are separated without framing.
+//
+// Values larger than |max_size| bytes result in ErrorStatus::ProtocolError,
+// which bounds the memory used for untrusted input. Errors are sticky until
+// Reset().
+//
+// Example:
+//
+//   IncrementalDecoder<Request> decoder;
+//
+//   // Whenever the socket is readable:
+//   const ssize_t count = ::recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+//   std::size_t offset = 0;
+//   while (offset < count) {
+//     auto status = decoder.Feed(buffer + offset, count - offset);
+//     if (!status)
+//       return status.error();
+//
+//     offset += status.get();
+//     if (decoder.complete()) {
+//       Request request;
+//       status = decoder.Decode(&request);
+//       ...
+//     }
+//   }
+//
+template <typename T>
+class IncrementalDecoder {
+ public:
+  // Default limit on the encoded size of a value.
+  enum : std::size_t { kDefaultMaxSize = 64 * 1024 * 1024 };
+
+  IncrementalDecoder(std::size_t max_size = kDefaultMaxSize,
+                     std::size_t max_depth = kDefaultMaxValueDepth)
+      : max_size_{max_size}, scanner_{max_depth} {}
+
+  // Consumes bytes from |data| up to the end of the current value. Returns the
+  // number of bytes consumed, which is less than |size| only when the value
+  // completed before the end of the input. Consumes nothing once a value is
+  // complete and has not been decoded yet.
+  Status<std::size_t> Feed(const void* data, std::size_t size) {
+    if (!error_)
+      return error_.error();
+    if (complete_)
+      return 0;
+
+    const std::size_t previous_size = buffer_.size();
+    std::size_t append_size = max_size_ - previous_size;
+    if (size < append_size)
+      append_size = size;
+
+    const std::uint8_t* bytes = static_cast<const std::uint8_t*>(data);
+    buffer_.insert(buffer_.end(), bytes, bytes + append_size);
+
+    auto status = scanner_.Scan(buffer_.data(), buffer_.size(), &offset_);
+    if (!status) {
+      error_ = status.error();
+      return status.error();
+    } else if (!status.get()) {
+      if (buffer_.size() == max_size_ && size > append_size) {
+        error_ = ErrorStatus::ProtocolError;
+        return ErrorStatus::ProtocolError;
+      }
+      return append_size;
+    }
+
+    // The value may end before the bytes appended by this call.
+    complete_ = true;
+    buffer_.resize(offset_);
+    return offset_ - previous_size;
+  }
+
+  // Returns true when a complete value has been received.
+  bool complete() const { return complete_; }
+
+  // Decodes the complete value into |value| and starts the next value. Returns
+  // ErrorStatus::ReadLimitReached if the value is not complete yet.
+  Status<void> Decode(T* value) {
+    if (!error_)
+      return error_;
+    if (!complete_)
+      return ErrorStatus::ReadLimitReached;
+
+    PedanticBufferReader reader{buffer_.data(), buffer_.size()};
+    auto status = Deserializer<PedanticBufferReader*>{&reader}.Read(value);
+    if (status && !reader.empty())
+      status = ErrorStatus::ProtocolError;
+
+    Reset();
+    return status;
+  }
+
+  // Discards the buffered bytes and any error and starts a new value. The
+  // capacity of the buffer is retained.
+  void Reset() {
+    buffer_.clear();
+    offset_ = 0;
+    complete_ = false;
+    error_ = {};
+    scanner_.Reset();
+  }
+
+  // Returns the bytes of the value received so far.
+  const std::uint8_t* data() const { return buffer_.data(); }
+  std::size_t size() const { return buffer_.size(); }
+
+  std::size_t max_size() const { return max_size_; }
+
+ private:
+  std::size_t max_size_;
+  detail::ValueScanner scanner_;
+  std::vector<std::uint8_t> buffer_;
+  std::size_t offset_{0};
+  bool complete_{false};
+  Status<void> error_;
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_INCREMENTAL_DECODER_H_
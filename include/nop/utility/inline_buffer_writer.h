@@ -0,0 +1,187 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_INLINE_BUFFER_WRITER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_INLINE_BUFFER_WRITER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include <nop/base/encoding.h>
+#include <nop/base/utility.h>
+
+namespace nop {
+
+// InlineBufferWriter is a writer type that serializes into |Capacity| bytes of
+// storage held inside the writer, and spills to a heap buffer only when
+// Prepare() requests more than fits. Declared on the stack, it serializes small
+// messages without touching the allocator, while large messages grow
+// geometrically in the same way as VectorWriter. The serialized data is
+// contiguous in either case.
+//
+// As with BufferWriter, bounds are only checked in Prepare(), which makes this
+// type safe for use with the library-provided Serializer types.
+//
+// Example:
+//
+//   Serializer<InlineBufferWriter<256>> serializer;
+//   auto status = serializer.Write(message);
+//   if (!status)
+//     return status;
+//
+//   const auto& writer = serializer.writer();
+//   return Send(writer.data(), writer.size());
+//
+template <std::size_t Capacity>
+class InlineBufferWriter {
+ public:
+  static_assert(Capacity > 0, "Capacity must be greater than zero.");
+
+  InlineBufferWriter() = default;
+  InlineBufferWriter(InlineBufferWriter&& other) { *this = std::move(other); }
+
+  InlineBufferWriter& operator=(InlineBufferWriter&& other) {
+    if (this != &other) {
+      heap_ = std::move(other.heap_);
+      index_ = other.index_;
+      if (other.is_inline()) {
+        std::memcpy(inline_, other.inline_, other.index_);
+        buffer_ = inline_;
+        capacity_ = Capacity;
+      } else {
+        buffer_ = heap_.data();
+        capacity_ = heap_.size();
+      }
+      other.Release();
+    }
+    return *this;
+  }
+
+  Status<void> Prepare(std::size_t size) {
+    if (size > capacity_ - index_)
+      Grow(index_ + size);
+    return {};
+  }
+
+  Status<void> Write(std::uint8_t byte) { return Write(&byte, &byte + 1); }
+
+  template <typename T, typename Enable = EnableIfArithmetic<T>>
+  Status<void> Write(const T* begin, const T* end) {
+    const std::size_t element_size = sizeof(T);
+    const std::size_t length = end - begin;
+    const std::size_t length_bytes = length * element_size;
+
+    std::memcpy(&buffer_[index_], begin, length_bytes);
+    index_ += length_bytes;
+    return {};
+  }
+
+  Status<void> Skip(std::size_t padding_bytes,
+                    std::uint8_t padding_value = 0x00) {
+    std::memset(&buffer_[index_], padding_value, padding_bytes);
+    index_ += padding_bytes;
+    return {};
+  }
+
+  // Overwrites previously written bytes; see ExactTableEntries.
+  Status<void> Patch(std::size_t offset, const std::uint8_t* begin,
+                     const std::uint8_t* end) {
+    const std::size_t length_bytes = end - begin;
+    if (offset > index_ || length_bytes > index_ - offset)
+      return ErrorStatus::WriteLimitReached;
+
+    std::memcpy(&buffer_[offset], begin, length_bytes);
+    return {};
+  }
+
+  // Discards the serialized data. Heap storage is kept for reuse; call Shrink()
+  // to return to the inline storage.
+  void Reset() { index_ = 0; }
+
+  // Moves the serialized data back into the inline storage and frees the heap
+  // storage, if the data fits.
+  void Shrink() {
+    if (is_inline() || index_ > Capacity)
+      return;
+
+    std::memcpy(inline_, heap_.data(), index_);
+    Release(index_);
+  }
+
+  // Returns the serialized data as a vector, moving the heap storage out of the
+  // writer when it has spilled. The writer is left empty.
+  std::vector<std::uint8_t> Take() {
+    std::vector<std::uint8_t> data;
+    if (is_inline()) {
+      data.assign(inline_, inline_ + index_);
+    } else {
+      heap_.resize(index_);
+      data.swap(heap_);
+    }
+    Release();
+    return data;
+  }
+
+  const std::uint8_t* data() const { return buffer_; }
+  std::uint8_t* data() { return buffer_; }
+
+  std::size_t offset() const { return index_; }
+  std::size_t size() const { return index_; }
+  std::size_t capacity() const { return capacity_; }
+
+  // Returns true if the data is in the inline storage.
+  bool is_inline() const { return buffer_ == inline_; }
+
+ private:
+  InlineBufferWriter(const InlineBufferWriter&) = delete;
+  void operator=(const InlineBufferWriter&) = delete;
+
+  void Grow(std::size_t required_size) {
+    std::size_t new_size = capacity_ * 2;
+    if (new_size < required_size)
+      new_size = required_size;
+
+    if (is_inline()) {
+      heap_.resize(new_size);
+      std::memcpy(heap_.data(), inline_, index_);
+    } else {
+      heap_.resize(new_size);
+    }
+    buffer_ = heap_.data();
+    capacity_ = new_size;
+  }
+
+  // Switches back to empty inline storage, keeping |size| bytes.
+  void Release(std::size_t size = 0) {
+    heap_ = {};
+    buffer_ = inline_;
+    capacity_ = Capacity;
+    index_ = size;
+  }
+
+  std::uint8_t* buffer_{inline_};
+  std::size_t capacity_{Capacity};
+  std::size_t index_{0};
+  std::vector<std::uint8_t> heap_;
+  std::uint8_t inline_[Capacity];
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_INLINE_BUFFER_WRITER_H_
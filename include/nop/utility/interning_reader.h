@@ -0,0 +1,164 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_INTERNING_READER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_INTERNING_READER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <nop/base/encoding.h>
+#include <nop/base/handle.h>
+#include <nop/base/pointer.h>
+#include <nop/base/utility.h>
+#include <nop/types/interned.h>
+#include <nop/utility/reuse_storage.h>
+
+namespace nop {
+
+// InterningReader is a reader type that wraps another reader pointer and
+// rebuilds the string and pointer tables written by InterningWriter, resolving
+// references of Interned<String> and std::shared_ptr values to the strings and
+// objects defined earlier in the input. Every other operation passes through to
+// the underlying reader.
+//
+// When the underlying reader can borrow, the table refers to the definitions
+// in the input without copying them, and the input must remain valid while the
+// reader is in use. Otherwise each definition is copied once into the table.
+//
+// Call ClearStrings() and ClearPointers() between messages, matching the
+// writer.
+//
+// Example:
+//
+//   BufferReader buffer_reader{data, size};
+//   Deserializer<InterningReader<BufferReader>> deserializer{&buffer_reader};
+//   auto status = deserializer.Read(&records);
+//
+template <typename Reader>
+class InterningReader {
+ public:
+  InterningReader() = default;
+  InterningReader(InterningReader&&) = default;
+  InterningReader(Reader* reader) : reader_{reader} {}
+
+  InterningReader& operator=(InterningReader&&) = default;
+
+  Status<void> Ensure(std::size_t size) { return reader_->Ensure(size); }
+
+  Status<void> Read(std::uint8_t* byte) { return reader_->Read(byte); }
+
+  template <typename T, typename Enable = EnableIfArithmetic<T>>
+  Status<void> Read(T* begin, T* end) {
+    return reader_->Read(begin, end);
+  }
+
+  Status<void> Skip(std::size_t padding_bytes) {
+    return reader_->Skip(padding_bytes);
+  }
+
+  // Only available when the underlying reader supports borrowing.
+  template <typename R = Reader, typename Enabled = ReaderBorrowTest<R>>
+  Status<void> Borrow(std::size_t size, const void** data) {
+    return reader_->Borrow(size, data);
+  }
+
+  static constexpr bool kReuseStorage = ReaderReusesStorage<Reader>::value;
+  static constexpr bool kBorrowToCopy = ReaderBorrowsToCopy<Reader>::value;
+
+  template <typename HandleType>
+  Status<HandleType> GetHandle(HandleReference handle_reference) {
+    return reader_->template GetHandle<HandleType>(handle_reference);
+  }
+
+  // Adds |string| to the table. When the underlying reader can borrow,
+  // |string| must refer into its input.
+  Status<void> DefineString(StringView string) {
+    if (ReaderCanBorrow<Reader>::value) {
+      strings_.push_back(string);
+    } else {
+      storage_.emplace_back(string.data(), string.size());
+      strings_.emplace_back(storage_.back());
+    }
+    return {};
+  }
+
+  // Returns the string at |reference| in the table.
+  Status<StringView> GetString(StringReference reference) const {
+    if (reference >= strings_.size())
+      return ErrorStatus::InvalidReference;
+    else
+      return strings_[reference];
+  }
+
+  // Empties the string table.
+  void ClearStrings() {
+    strings_.clear();
+    storage_.clear();
+  }
+
+  // Returns the number of strings in the table.
+  std::size_t string_count() const { return strings_.size(); }
+
+  // Adds |pointer| to an object of type |type| to the pointer table.
+  Status<void> DefinePointer(std::shared_ptr<void> pointer, PointerType type) {
+    pointers_.emplace_back(std::move(pointer), type);
+    return {};
+  }
+
+  // Returns the object at |reference| in the pointer table, which must have
+  // type |type|.
+  Status<std::shared_ptr<void>> GetPointer(PointerReference reference,
+                                           PointerType type) const {
+    if (reference < 0 ||
+        static_cast<std::uint64_t>(reference) >= pointers_.size() ||
+        pointers_[reference].second != type) {
+      return ErrorStatus::InvalidReference;
+    } else {
+      return pointers_[reference].first;
+    }
+  }
+
+  // Empties the pointer table.
+  void ClearPointers() { pointers_.clear(); }
+
+  // Returns the number of objects in the pointer table.
+  std::size_t pointer_count() const { return pointers_.size(); }
+
+  const Reader* reader() const { return reader_; }
+  Reader* reader() { return reader_; }
+
+ private:
+  InterningReader(const InterningReader&) = delete;
+  void operator=(const InterningReader&) = delete;
+
+  Reader* reader_{nullptr};
+  std::vector<StringView> strings_;
+
+  // Copies of the definitions when the underlying reader cannot borrow.
+  std::deque<std::string> storage_;
+
+  std::vector<std::pair<std::shared_ptr<void>, PointerType>> pointers_;
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_INTERNING_READER_H_
@@ -0,0 +1,203 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_INTERNING_WRITER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_INTERNING_WRITER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <nop/base/encoding.h>
+#include <nop/base/handle.h>
+#include <nop/base/pointer.h>
+#include <nop/base/serializer.h>
+#include <nop/base/utility.h>
+#include <nop/types/interned.h>
+#include <nop/utility/canonical.h>
+#include <nop/utility/exact_table_entries.h>
+
+namespace nop {
+
+namespace detail {
+
+// FNV-1a hash of the characters of a StringView, for tables keyed by views.
+struct StringViewHash {
+  std::size_t operator()(StringView string) const {
+    std::uint64_t hash = 0xcbf29ce484222325ULL;
+    for (char c : string) {
+      hash ^= static_cast<std::uint8_t>(c);
+      hash *= 0x100000001b3ULL;
+    }
+    return static_cast<std::size_t>(hash);
+  }
+};
+
+// Hash of the address and type of an object, for tables of shared pointers.
+struct PointerKeyHash {
+  std::size_t operator()(const std::pair<const void*, PointerType>& key) const {
+    const std::hash<const void*> hash;
+    return hash(key.first) ^ (hash(key.second) * 31);
+  }
+};
+
+}  // namespace detail
+
+// InterningWriter is a writer type that wraps another writer pointer and keeps
+// the string table used by Interned<String> values and the pointer table used
+// by std::shared_ptr: the first occurrence of each distinct string or object is
+// written in full, and later occurrences are written as references to it.
+// Every other operation passes through to the underlying writer. Read the data
+// back with InterningReader.
+//
+// The tables cover everything written through the writer, so call
+// ClearStrings() and ClearPointers() between messages that are decoded
+// independently. The pointer table holds a reference to each object until it
+// is cleared, so that the address of an object is not reused for another
+// object while the table refers to it.
+//
+// Example:
+//
+//   VectorWriter vector_writer;
+//   Serializer<InterningWriter<VectorWriter>> serializer{&vector_writer};
+//   auto status = serializer.Write(records);
+//
+template <typename Writer>
+class InterningWriter {
+ public:
+  // Maximum number of strings in the table, which bounds the size of the
+  // references to U32.
+  enum : std::size_t { kMaxStrings = 0xffffffff };
+
+  InterningWriter() = default;
+  InterningWriter(InterningWriter&&) = default;
+  InterningWriter(Writer* writer) : writer_{writer} {}
+
+  InterningWriter& operator=(InterningWriter&&) = default;
+
+  // Preserve the preparation behavior of the underlying writer.
+  static constexpr bool kNeedsPrepare = WriterNeedsPrepare<Writer>::value;
+
+  Status<void> Prepare(std::size_t size) { return writer_->Prepare(size); }
+
+  Status<void> Write(std::uint8_t byte) { return writer_->Write(byte); }
+
+  template <typename T, typename Enable = EnableIfArithmetic<T>>
+  Status<void> Write(const T* begin, const T* end) {
+    return writer_->Write(begin, end);
+  }
+
+  Status<void> Skip(std::size_t padding_bytes,
+                    std::uint8_t padding_value = 0x00) {
+    return writer_->Skip(padding_bytes, padding_value);
+  }
+
+  // Preserve the canonical mode of the underlying writer.
+  static constexpr bool kCanonical = WriterIsCanonical<Writer>::value;
+
+  static constexpr bool kExactTableEntries =
+      WriterExactTableEntries<Writer>::value;
+
+  std::size_t offset() const { return writer_->offset(); }
+
+  Status<void> Patch(std::size_t offset, const std::uint8_t* begin,
+                     const std::uint8_t* end) {
+    return writer_->Patch(offset, begin, end);
+  }
+
+  template <typename HandleType>
+  Status<HandleReference> PushHandle(const HandleType& handle) {
+    return writer_->PushHandle(handle);
+  }
+
+  // Returns the index of an earlier occurrence of |string| in the table, or
+  // adds a copy of |string| to the table and returns kNewStringReference.
+  Status<StringReference> InternString(StringView string) {
+    auto search = index_.find(string);
+    if (search != index_.end())
+      return search->second;
+    else if (strings_.size() >= kMaxStrings)
+      return ErrorStatus::WriteLimitReached;
+
+    strings_.emplace_back(string.data(), string.size());
+    index_.emplace(StringView{strings_.back()}, strings_.size() - 1);
+    return kNewStringReference;
+  }
+
+  // Empties the string table.
+  void ClearStrings() {
+    index_.clear();
+    strings_.clear();
+  }
+
+  // Returns the number of strings in the table.
+  std::size_t string_count() const { return strings_.size(); }
+
+  // Returns the index of an earlier occurrence of the object of type |type| at
+  // |pointer| in the table, or adds |pointer| to the table and returns
+  // kNewPointerReference.
+  template <typename T>
+  Status<PointerReference> InternPointer(const std::shared_ptr<T>& pointer,
+                                         PointerType type) {
+    const auto key =
+        std::make_pair(static_cast<const void*>(pointer.get()), type);
+    auto search = pointer_index_.find(key);
+    if (search != pointer_index_.end())
+      return search->second;
+
+    pointer_index_.emplace(key, pointers_.size());
+    pointers_.push_back(pointer);
+    return kNewPointerReference;
+  }
+
+  // Empties the pointer table, releasing the references to the objects.
+  void ClearPointers() {
+    pointer_index_.clear();
+    pointers_.clear();
+  }
+
+  // Returns the number of objects in the pointer table.
+  std::size_t pointer_count() const { return pointers_.size(); }
+
+  const Writer* writer() const { return writer_; }
+  Writer* writer() { return writer_; }
+
+ private:
+  InterningWriter(const InterningWriter&) = delete;
+  void operator=(const InterningWriter&) = delete;
+
+  Writer* writer_{nullptr};
+
+  // The index refers to the copies of the strings owned by the deque, which
+  // does not move its elements as it grows.
+  std::deque<std::string> strings_;
+  std::unordered_map<StringView, StringReference, detail::StringViewHash>
+      index_;
+
+  std::vector<std::shared_ptr<const void>> pointers_;
+  std::unordered_map<std::pair<const void*, PointerType>, PointerReference,
+                     detail::PointerKeyHash>
+      pointer_index_;
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_INTERNING_WRITER_H_
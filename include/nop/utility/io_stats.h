@@ -0,0 +1,161 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_IO_STATS_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_IO_STATS_H_
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace nop {
+
+// Counters accumulated by CountingWriter and CountingReader.
+//
+// Comparing the counters tells where the time of a channel goes: many small
+// transfers to a syscall-backed writer or reader indicate that it is syscall
+// bound, large transfer sizes with high |ticks| indicate copy bound, and few
+// ticks relative to the total time spent serializing indicate encode bound.
+struct IoStats {
+  // Number of buckets in the transfer size histogram.
+  enum : std::size_t { kSizeBuckets = 24 };
+
+  // Calls to Prepare() for writers or Ensure() for readers, and the total size
+  // passed to them.
+  std::uint64_t prepare_calls{0};
+  std::uint64_t prepared_bytes{0};
+
+  // Calls to Write() for writers or Read() and Borrow() for readers, and the
+  // total number of bytes transferred by them.
+  std::uint64_t transfer_calls{0};
+  std::uint64_t transferred_bytes{0};
+
+  // Bytes that were transferred by Borrow() without copying.
+  std::uint64_t borrowed_bytes{0};
+
+  // Calls to Skip() and the total number of bytes skipped.
+  std::uint64_t skip_calls{0};
+  std::uint64_t skipped_bytes{0};
+
+  // Calls to the underlying writer or reader that returned an error.
+  std::uint64_t errors{0};
+
+  // Time spent in the underlying writer or reader, in units of the Clock of the
+  // counting type. Always zero with NoClock.
+  std::uint64_t ticks{0};
+
+  // Histogram of transfer sizes. See SizeBucket().
+  std::array<std::uint64_t, kSizeBuckets> transfer_sizes{};
+
+  // Returns the histogram bucket for a transfer of |size| bytes: bucket 0 holds
+  // empty transfers and bucket N holds transfers of [2^(N-1), 2^N) bytes, with
+  // the last bucket also holding all larger transfers.
+  static constexpr std::size_t SizeBucket(std::size_t size) {
+    std::size_t bucket = 0;
+    while (size != 0 && bucket < kSizeBuckets - 1) {
+      size >>= 1;
+      bucket++;
+    }
+    return bucket;
+  }
+
+  std::uint64_t calls() const {
+    return prepare_calls + transfer_calls + skip_calls;
+  }
+  std::uint64_t bytes() const { return transferred_bytes + skipped_bytes; }
+
+  void Reset() { *this = IoStats{}; }
+
+  IoStats& operator+=(const IoStats& other) {
+    prepare_calls += other.prepare_calls;
+    prepared_bytes += other.prepared_bytes;
+    transfer_calls += other.transfer_calls;
+    transferred_bytes += other.transferred_bytes;
+    borrowed_bytes += other.borrowed_bytes;
+    skip_calls += other.skip_calls;
+    skipped_bytes += other.skipped_bytes;
+    errors += other.errors;
+    ticks += other.ticks;
+    for (std::size_t i = 0; i < kSizeBuckets; i++)
+      transfer_sizes[i] += other.transfer_sizes[i];
+    return *this;
+  }
+};
+
+//
+// Clocks for the timing counters of CountingWriter and CountingReader.
+//
+
+// Disables timing. The counting types do not read any clock.
+struct NoClock {
+  static constexpr bool kEnabled = false;
+  static std::uint64_t Now() { return 0; }
+};
+
+// Measures time in nanoseconds with std::chrono::steady_clock.
+struct SteadyClock {
+  static constexpr bool kEnabled = true;
+  static std::uint64_t Now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+};
+
+// Measures time in CPU timestamp counter cycles where available, which is
+// cheaper to read than SteadyClock. Falls back to SteadyClock elsewhere.
+struct CycleClock {
+  static constexpr bool kEnabled = true;
+  static std::uint64_t Now() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#elif defined(__aarch64__)
+    std::uint64_t value;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(value));
+    return value;
+#else
+    return SteadyClock::Now();
+#endif
+  }
+};
+
+namespace detail {
+
+// Runs |op| and adds its duration according to Clock to |stats|, and counts
+// the error if it fails.
+template <typename Clock, typename Op>
+auto MeasureIo(IoStats* stats, Op op) -> decltype(op()) {
+  const std::uint64_t start = Clock::kEnabled ? Clock::Now() : 0;
+  auto status = op();
+  if (Clock::kEnabled)
+    stats->ticks += Clock::Now() - start;
+  if (!status)
+    stats->errors++;
+  return status;
+}
+
+// Records a transfer of |size| bytes in |stats|.
+inline void CountTransfer(IoStats* stats, std::size_t size) {
+  stats->transfer_calls++;
+  stats->transferred_bytes += size;
+  stats->transfer_sizes[IoStats::SizeBucket(size)]++;
+}
+
+}  // namespace detail
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_IO_STATS_H_
@@ -0,0 +1,413 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_IO_URING_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_IO_URING_H_
+
+#include <errno.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
+#include <nop/status.h>
+
+namespace nop {
+
+namespace detail {
+
+// An asynchronous operation queued on an IoUring. |complete| is called from
+// IoUring::Wait() or IoUring::Poll() with the result of the operation: the
+// number of bytes transferred, or a negative errno value.
+struct IoUringOperation {
+  void (*complete)(void* context, int result);
+  void* context;
+};
+
+}  // namespace detail
+
+// Identifies the file an IoUring operation applies to: either a plain fd or an
+// index into the table registered with IoUring::RegisterFiles(). Registered
+// files save the kernel from looking up and reference counting the fd for
+// every operation.
+struct IoUringFile {
+  IoUringFile(int fd) : fd{fd} {}
+
+  static IoUringFile Fixed(int index) {
+    IoUringFile file{index};
+    file.fixed = true;
+    return file;
+  }
+
+  int fd;
+  bool fixed{false};
+};
+
+// IoUring is a minimal Linux io_uring instance, driven with raw system calls so
+// that it does not depend on liburing. Any number of readers and writers may
+// queue operations on the same ring; the queued operations are handed to the
+// kernel together with a single io_uring_enter() call when the ring is
+// submitted or waited on.
+//
+// Registered buffers and files may be used by passing a buffer index to
+// QueueRead()/QueueWrite() and an IoUringFile::Fixed() target respectively.
+//
+// An IoUring is not thread safe; completions are dispatched on the thread that
+// calls Wait() or Poll().
+//
+// Example:
+//
+//   auto ring = IoUring::Create();
+//   IoUringWriter journal{&ring.get(), journal_fd};
+//   IoUringWriter socket{&ring.get(), socket_fd};
+//
+//   Serializer<IoUringWriter*>{&journal}.Write(record);
+//   Serializer<IoUringWriter*>{&socket}.Write(record);
+//   journal.Submit();
+//   socket.Submit();
+//
+//   // Both writes are submitted with one system call.
+//   ring.get().Submit();
+//
+class IoUring {
+ public:
+  // Default number of submission queue entries.
+  enum : unsigned { kDefaultEntries = 64 };
+
+  IoUring() = default;
+  IoUring(const IoUring&) = delete;
+  IoUring(IoUring&& other) { *this = std::move(other); }
+
+  ~IoUring() { Clear(); }
+
+  IoUring& operator=(const IoUring&) = delete;
+  IoUring& operator=(IoUring&& other) {
+    if (this != &other) {
+      Clear();
+      std::swap(fd_, other.fd_);
+      std::swap(sq_ring_, other.sq_ring_);
+      std::swap(sq_ring_size_, other.sq_ring_size_);
+      std::swap(cq_ring_, other.cq_ring_);
+      std::swap(cq_ring_size_, other.cq_ring_size_);
+      std::swap(sqes_, other.sqes_);
+      std::swap(sqes_size_, other.sqes_size_);
+      std::swap(sq_, other.sq_);
+      std::swap(cq_, other.cq_);
+      std::swap(sq_tail_, other.sq_tail_);
+      std::swap(queued_, other.queued_);
+      std::swap(in_flight_, other.in_flight_);
+    }
+    return *this;
+  }
+
+  // Creates a ring with at least |entries| submission queue entries. Returns
+  // ErrorStatus::IOError if the kernel does not support io_uring or the ring
+  // cannot be mapped.
+  static Status<IoUring> Create(unsigned entries = kDefaultEntries) {
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+
+    IoUring ring;
+    ring.fd_ =
+        static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+    if (ring.fd_ < 0)
+      return ErrorStatus::IOError;
+
+    ring.sq_ring_size_ =
+        params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring.cq_ring_size_ =
+        params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    const bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap) {
+      if (ring.cq_ring_size_ > ring.sq_ring_size_)
+        ring.sq_ring_size_ = ring.cq_ring_size_;
+      ring.cq_ring_size_ = 0;
+    }
+
+    ring.sq_ring_ = Map(ring.fd_, ring.sq_ring_size_, IORING_OFF_SQ_RING);
+    if (!ring.sq_ring_)
+      return ErrorStatus::IOError;
+
+    if (!single_mmap) {
+      ring.cq_ring_ = Map(ring.fd_, ring.cq_ring_size_, IORING_OFF_CQ_RING);
+      if (!ring.cq_ring_)
+        return ErrorStatus::IOError;
+    }
+
+    ring.sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    ring.sqes_ = static_cast<io_uring_sqe*>(
+        Map(ring.fd_, ring.sqes_size_, IORING_OFF_SQES));
+    if (!ring.sqes_)
+      return ErrorStatus::IOError;
+
+    std::uint8_t* sq_ring = static_cast<std::uint8_t*>(ring.sq_ring_);
+    std::uint8_t* cq_ring =
+        static_cast<std::uint8_t*>(single_mmap ? ring.sq_ring_ : ring.cq_ring_);
+
+    ring.sq_.head = reinterpret_cast<unsigned*>(sq_ring + params.sq_off.head);
+    ring.sq_.tail = reinterpret_cast<unsigned*>(sq_ring + params.sq_off.tail);
+    ring.sq_.mask = *reinterpret_cast<unsigned*>(sq_ring +
+                                                 params.sq_off.ring_mask);
+    ring.sq_.entries = params.sq_entries;
+    ring.sq_.array =
+        reinterpret_cast<unsigned*>(sq_ring + params.sq_off.array);
+
+    ring.cq_.head = reinterpret_cast<unsigned*>(cq_ring + params.cq_off.head);
+    ring.cq_.tail = reinterpret_cast<unsigned*>(cq_ring + params.cq_off.tail);
+    ring.cq_.mask = *reinterpret_cast<unsigned*>(cq_ring +
+                                                 params.cq_off.ring_mask);
+    ring.cq_.entries = params.cq_entries;
+    ring.cq_.cqes =
+        reinterpret_cast<io_uring_cqe*>(cq_ring + params.cq_off.cqes);
+
+    ring.sq_tail_ = *ring.sq_.tail;
+    return {std::move(ring)};
+  }
+
+  // Registers |count| fds, which operations may then refer to by index with
+  // IoUringFile::Fixed().
+  Status<void> RegisterFiles(const int* fds, std::size_t count) {
+    return Register(IORING_REGISTER_FILES, fds, count);
+  }
+
+  Status<void> UnregisterFiles() {
+    return Register(IORING_UNREGISTER_FILES, nullptr, 0);
+  }
+
+  // Registers |count| buffers, which the kernel pins and maps once instead of
+  // for every operation. Operations on memory within a registered buffer may
+  // pass its index to QueueRead()/QueueWrite().
+  Status<void> RegisterBuffers(const iovec* buffers, std::size_t count) {
+    return Register(IORING_REGISTER_BUFFERS, buffers, count);
+  }
+
+  Status<void> UnregisterBuffers() {
+    return Register(IORING_UNREGISTER_BUFFERS, nullptr, 0);
+  }
+
+  // Queues a read of up to |size| bytes from |file| at |offset| into |data|.
+  // An offset of -1 reads from the current file position, which is also what
+  // pipes and sockets require. |buffer_index| selects a registered buffer that
+  // contains |data|, or -1 for none. |operation| must remain valid until it
+  // completes.
+  Status<void> QueueRead(IoUringFile file, void* data, std::size_t size,
+                         std::int64_t offset,
+                         detail::IoUringOperation* operation,
+                         int buffer_index = -1) {
+    return Queue(buffer_index < 0 ? IORING_OP_READ : IORING_OP_READ_FIXED,
+                 file, data, size, offset, operation, buffer_index);
+  }
+
+  // Queues a write of up to |size| bytes from |data| to |file| at |offset|.
+  // The arguments have the same meaning as for QueueRead().
+  Status<void> QueueWrite(IoUringFile file, const void* data, std::size_t size,
+                          std::int64_t offset,
+                          detail::IoUringOperation* operation,
+                          int buffer_index = -1) {
+    return Queue(buffer_index < 0 ? IORING_OP_WRITE : IORING_OP_WRITE_FIXED,
+                 file, const_cast<void*>(data), size, offset, operation,
+                 buffer_index);
+  }
+
+  // Hands all queued operations to the kernel with one system call. Returns
+  // the number of operations submitted.
+  Status<std::size_t> Submit() { return Enter(0); }
+
+  // Submits the queued operations, blocks until at least |count| operations
+  // have completed, and dispatches all available completions. Returns the
+  // number of completions dispatched. Returns immediately if no operations
+  // are pending.
+  Status<std::size_t> Wait(unsigned count = 1) {
+    if (count > in_flight_ + queued_)
+      count = static_cast<unsigned>(in_flight_ + queued_);
+
+    auto status = Enter(count);
+    if (!status)
+      return status.error();
+
+    return Poll();
+  }
+
+  // Dispatches the available completions without blocking. Returns the number
+  // of completions dispatched.
+  Status<std::size_t> Poll() {
+    std::size_t count = 0;
+    unsigned head = *cq_.head;
+    while (head != __atomic_load_n(cq_.tail, __ATOMIC_ACQUIRE)) {
+      const io_uring_cqe& cqe = cq_.cqes[head & cq_.mask];
+      auto* operation =
+          reinterpret_cast<detail::IoUringOperation*>(cqe.user_data);
+      const int result = cqe.res;
+      head++;
+      __atomic_store_n(cq_.head, head, __ATOMIC_RELEASE);
+      in_flight_--;
+      count++;
+
+      // The completion may queue follow-up operations on this ring.
+      operation->complete(operation->context, result);
+    }
+    return count;
+  }
+
+  // Closes the ring. Operations that are still in flight are cancelled
+  // without dispatching their completions.
+  void Clear() {
+    if (sqes_)
+      ::munmap(sqes_, sqes_size_);
+    if (cq_ring_)
+      ::munmap(cq_ring_, cq_ring_size_);
+    if (sq_ring_)
+      ::munmap(sq_ring_, sq_ring_size_);
+    if (fd_ >= 0)
+      ::close(fd_);
+
+    fd_ = -1;
+    sq_ring_ = cq_ring_ = nullptr;
+    sqes_ = nullptr;
+    queued_ = in_flight_ = 0;
+  }
+
+  bool is_open() const { return fd_ >= 0; }
+  int fd() const { return fd_; }
+
+  // Returns the number of operations queued but not yet submitted.
+  std::size_t queued() const { return queued_; }
+
+  // Returns the number of operations submitted but not yet dispatched.
+  std::size_t in_flight() const { return in_flight_; }
+
+ private:
+  struct SubmissionQueue {
+    unsigned* head{nullptr};
+    unsigned* tail{nullptr};
+    unsigned* array{nullptr};
+    unsigned mask{0};
+    unsigned entries{0};
+  };
+
+  struct CompletionQueue {
+    unsigned* head{nullptr};
+    unsigned* tail{nullptr};
+    io_uring_cqe* cqes{nullptr};
+    unsigned mask{0};
+    unsigned entries{0};
+  };
+
+  static void* Map(int fd, std::size_t size, off_t offset) {
+    void* address = ::mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                           MAP_SHARED | MAP_POPULATE, fd, offset);
+    return address == MAP_FAILED ? nullptr : address;
+  }
+
+  Status<void> Register(unsigned opcode, const void* arg, std::size_t count) {
+    const long ret = ::syscall(__NR_io_uring_register, fd_, opcode, arg,
+                               static_cast<unsigned>(count));
+    if (ret < 0)
+      return ErrorStatus::IOError;
+    else
+      return {};
+  }
+
+  Status<void> Queue(std::uint8_t opcode, IoUringFile file, void* data,
+                     std::size_t size, std::int64_t offset,
+                     detail::IoUringOperation* operation, int buffer_index) {
+    if (size > UINT32_MAX)
+      return ErrorStatus::InvalidContainerLength;
+
+    // Make room by submitting when the submission queue is full. Completions
+    // are bounded by the completion queue, which the kernel sizes to twice
+    // the submission queue and does not drop on overflow.
+    if (sq_tail_ - __atomic_load_n(sq_.head, __ATOMIC_ACQUIRE) >=
+        sq_.entries) {
+      auto status = Submit();
+      if (!status)
+        return status.error();
+    }
+
+    const unsigned index = sq_tail_ & sq_.mask;
+    io_uring_sqe& sqe = sqes_[index];
+    std::memset(&sqe, 0, sizeof(sqe));
+    sqe.opcode = opcode;
+    sqe.fd = file.fd;
+    sqe.flags = file.fixed ? IOSQE_FIXED_FILE : 0;
+    sqe.addr = reinterpret_cast<std::uint64_t>(data);
+    sqe.len = static_cast<std::uint32_t>(size);
+    sqe.off = static_cast<std::uint64_t>(offset);
+    sqe.user_data = reinterpret_cast<std::uint64_t>(operation);
+    if (buffer_index >= 0)
+      sqe.buf_index = static_cast<std::uint16_t>(buffer_index);
+
+    sq_.array[index] = index;
+    sq_tail_++;
+    __atomic_store_n(sq_.tail, sq_tail_, __ATOMIC_RELEASE);
+    queued_++;
+    return {};
+  }
+
+  Status<std::size_t> Enter(unsigned min_complete) {
+    std::size_t submitted = 0;
+    while (queued_ > 0 || min_complete > 0) {
+      const unsigned flags = min_complete > 0 ? IORING_ENTER_GETEVENTS : 0;
+      const long ret =
+          ::syscall(__NR_io_uring_enter, fd_, static_cast<unsigned>(queued_),
+                    min_complete, flags, nullptr, 0);
+      if (ret < 0) {
+        if (errno == EINTR)
+          continue;
+
+        // The kernel is waiting for completions to be reaped before it
+        // accepts more submissions.
+        if ((errno == EBUSY || errno == EAGAIN) && in_flight_ > 0) {
+          Poll();
+          continue;
+        }
+        return ErrorStatus::IOError;
+      } else if (ret == 0 && min_complete == 0) {
+        break;
+      }
+
+      queued_ -= ret;
+      in_flight_ += ret;
+      submitted += ret;
+      min_complete = 0;
+    }
+    return submitted;
+  }
+
+  int fd_{-1};
+  void* sq_ring_{nullptr};
+  std::size_t sq_ring_size_{0};
+  void* cq_ring_{nullptr};
+  std::size_t cq_ring_size_{0};
+  io_uring_sqe* sqes_{nullptr};
+  std::size_t sqes_size_{0};
+  SubmissionQueue sq_;
+  CompletionQueue cq_;
+  unsigned sq_tail_{0};
+  std::size_t queued_{0};
+  std::size_t in_flight_{0};
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_IO_URING_H_
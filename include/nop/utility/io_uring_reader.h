@@ -0,0 +1,235 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_IO_URING_READER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_IO_URING_READER_H_
+
+#include <errno.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <nop/base/serializer.h>
+#include <nop/status.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/endian.h>
+#include <nop/utility/frame_writer.h>
+#include <nop/utility/io_uring.h>
+#include <nop/utility/pedantic_buffer_reader.h>
+
+namespace nop {
+
+// IoUringFrameReader reads the length-prefixed frames written by FrameWriter
+// from a file or socket asynchronously through an IoUring. It is the
+// asynchronous counterpart of FrameReader.
+//
+// Start() queues the read of the next frame on the ring without making a
+// system call, so that many readers sharing a ring can be submitted together
+// and the kernel fills their frames in parallel. Short reads are continued
+// until the whole frame has arrived. Next() and Read() start the read if
+// necessary and wait for the frame to complete before decoding it from
+// memory.
+//
+// |offset| has the same meaning as for IoUringWriter. Frames that claim a
+// length larger than |max_frame_size| result in ErrorStatus::ProtocolError
+// before any memory is allocated for them.
+//
+// Example:
+//
+//   for (auto& reader : readers)
+//     reader->Start();
+//   ring.Submit();
+//
+//   for (auto& reader : readers) {
+//     Request request;
+//     auto status = reader->Read(&request);
+//     ...
+//   }
+//
+class IoUringFrameReader {
+ public:
+  // Default limit on the length of a frame.
+  enum : std::size_t { kDefaultMaxFrameSize = 64 * 1024 * 1024 };
+
+  IoUringFrameReader(IoUring* ring, IoUringFile file, std::int64_t offset = -1,
+                     std::size_t max_frame_size = kDefaultMaxFrameSize)
+      : ring_{ring},
+        file_{file},
+        offset_{offset},
+        max_frame_size_{max_frame_size} {}
+
+  ~IoUringFrameReader() { Wait(); }
+
+  IoUringFrameReader(const IoUringFrameReader&) = delete;
+  void operator=(const IoUringFrameReader&) = delete;
+
+  // Queues the read of the next frame unless a frame is already being read or
+  // is ready. Returns the error of an earlier read if one failed.
+  Status<void> Start() {
+    if (!error_)
+      return error_;
+    if (state_ != State::Idle)
+      return {};
+
+    state_ = State::Header;
+    received_ = 0;
+    return Issue();
+  }
+
+  // Waits for the frame being read to complete. Returns the error of the read
+  // if it failed.
+  Status<void> Wait() {
+    while (error_ && (state_ == State::Header || state_ == State::Payload)) {
+      auto status = ring_->Wait();
+      if (!status)
+        return status.error();
+    }
+    return error_;
+  }
+
+  // Returns true if a frame has completed and not yet been consumed.
+  bool ready() const { return state_ == State::Ready; }
+
+  // Reads the next frame and returns a reader over its payload. The reader is
+  // valid until the next frame is started. BufferReader only checks bounds in
+  // Ensure(), so use it to decode trusted frames.
+  Status<BufferReader> Next() {
+    auto status = Take();
+    if (!status)
+      return status.error();
+
+    return BufferReader{frame_.data(), frame_.size()};
+  }
+
+  // Reads the next frame and decodes |value| from it with bounds checks.
+  // Returns ErrorStatus::ProtocolError if the message does not fill the frame.
+  template <typename T>
+  Status<void> Read(T* value) {
+    auto status = Take();
+    if (!status)
+      return status;
+
+    PedanticBufferReader frame_reader{frame_.data(), frame_.size()};
+    status = Deserializer<PedanticBufferReader*>{&frame_reader}.Read(value);
+    if (!status)
+      return status;
+    else if (!frame_reader.empty())
+      return ErrorStatus::ProtocolError;
+    else
+      return {};
+  }
+
+  std::size_t max_frame_size() const { return max_frame_size_; }
+  IoUring* ring() const { return ring_; }
+
+ private:
+  enum class State { Idle, Header, Payload, Ready };
+
+  static void OnComplete(void* context, int result) {
+    static_cast<IoUringFrameReader*>(context)->Complete(result);
+  }
+
+  // Starts the frame if necessary, waits for it, and marks it consumed.
+  Status<void> Take() {
+    auto status = Start();
+    if (status)
+      status = Wait();
+    if (!status)
+      return status;
+
+    state_ = State::Idle;
+    return {};
+  }
+
+  Status<void> Issue() {
+    std::uint8_t* data;
+    std::size_t size;
+    if (state_ == State::Header) {
+      data = reinterpret_cast<std::uint8_t*>(&header_) + received_;
+      size = sizeof(header_) - received_;
+    } else {
+      data = frame_.data() + received_;
+      size = frame_.size() - received_;
+    }
+
+    auto status = ring_->QueueRead(file_, data, size, offset_, &operation_);
+    if (!status)
+      Fail(status.error());
+    return status;
+  }
+
+  void Complete(int result) {
+    if (result == -EINTR || result == -EAGAIN) {
+      Issue();
+      return;
+    } else if (result < 0) {
+      Fail(ErrorStatus::IOError);
+      return;
+    } else if (result == 0) {
+      Fail(ErrorStatus::ReadLimitReached);
+      return;
+    }
+
+    received_ += result;
+    if (offset_ >= 0)
+      offset_ += result;
+
+    if (state_ == State::Header) {
+      if (received_ < sizeof(header_)) {
+        Issue();
+        return;
+      }
+
+      const std::size_t length = HostEndian<std::uint32_t>::FromLittle(header_);
+      if (length > max_frame_size_) {
+        Fail(ErrorStatus::ProtocolError);
+        return;
+      }
+
+      frame_.resize(length);
+      received_ = 0;
+      state_ = State::Payload;
+    }
+
+    if (received_ < frame_.size())
+      Issue();
+    else
+      state_ = State::Ready;
+  }
+
+  void Fail(ErrorStatus error) {
+    error_ = error;
+    state_ = State::Idle;
+  }
+
+  IoUring* ring_;
+  IoUringFile file_;
+  std::int64_t offset_;
+  std::size_t max_frame_size_;
+  detail::IoUringOperation operation_{&OnComplete, this};
+
+  State state_{State::Idle};
+  std::uint32_t header_{0};
+  std::size_t received_{0};
+  std::vector<std::uint8_t> frame_;
+  Status<void> error_;
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_IO_URING_READER_H_
@@ -0,0 +1,195 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_IO_URING_WRITER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_IO_URING_WRITER_H_
+
+#include <errno.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <utility>
+#include <vector>
+
+#include <nop/status.h>
+#include <nop/utility/io_uring.h>
+#include <nop/utility/vector_writer.h>
+
+namespace nop {
+
+// IoUringWriter is a writer type that serializes into memory and writes the
+// result to a file or socket asynchronously through an IoUring.
+//
+// Everything written between calls to Submit() forms a frame. Submit() queues
+// the frame on the ring without making a system call, so that frames from many
+// writers sharing a ring are handed to the kernel together by IoUring::Submit()
+// or IoUring::Wait(). Frames are written in order, one at a time, and short
+// writes are continued until the whole frame has been written, so a frame is
+// never interleaved with other output to the same file. Serialization may
+// continue into the next frame while earlier frames are in flight.
+//
+// When |offset| is not -1 the frames are written at consecutive positions
+// starting there, which suits journals opened without O_APPEND. Otherwise they
+// are written at the current file position, as pipes and sockets require.
+//
+// The writer does not own the fd and must outlive its in-flight frames; the
+// destructor waits for them.
+//
+// Example:
+//
+//   IoUringWriter writer{&ring, socket_fd};
+//   FrameWriter<IoUringWriter> frame_writer{&writer};
+//
+//   for (const auto& message : messages) {
+//     auto status = frame_writer.Write(message);
+//     if (status)
+//       status = writer.Submit();
+//     if (!status)
+//       return status;
+//   }
+//
+//   return writer.Wait();
+//
+class IoUringWriter {
+ public:
+  IoUringWriter(IoUring* ring, IoUringFile file, std::int64_t offset = -1)
+      : ring_{ring}, file_{file}, offset_{offset} {}
+
+  ~IoUringWriter() { Wait(); }
+
+  IoUringWriter(const IoUringWriter&) = delete;
+  void operator=(const IoUringWriter&) = delete;
+
+  Status<void> Prepare(std::size_t size) { return buffer_.Prepare(size); }
+  Status<void> Write(std::uint8_t byte) { return buffer_.Write(byte); }
+
+  template <typename T>
+  Status<void> Write(const T* begin, const T* end) {
+    return buffer_.Write(begin, end);
+  }
+
+  Status<void> Skip(std::size_t padding_bytes,
+                    std::uint8_t padding_value = 0x00) {
+    return buffer_.Skip(padding_bytes, padding_value);
+  }
+
+  // Queues the data written since the last call as a frame. Returns the error
+  // of an earlier frame if one failed, in which case nothing more is written.
+  Status<void> Submit() {
+    if (!error_)
+      return error_;
+    if (buffer_.size() == 0)
+      return {};
+
+    frames_.push_back(std::move(buffer_));
+    if (free_.empty()) {
+      buffer_ = VectorWriter{};
+    } else {
+      buffer_ = std::move(free_.back());
+      free_.pop_back();
+      buffer_.Reset();
+    }
+
+    if (frames_.size() == 1)
+      return Issue();
+    else
+      return {};
+  }
+
+  // Submits any queued operations on the ring and blocks until all frames
+  // submitted by this writer have been written. Returns the first error.
+  Status<void> Wait() {
+    while (!frames_.empty() && error_) {
+      auto status = ring_->Wait();
+      if (!status)
+        return status.error();
+    }
+    return error_;
+  }
+
+  // Returns the number of submitted frames that have not been fully written.
+  std::size_t pending() const { return frames_.size(); }
+
+  Status<void> status() const { return error_; }
+  IoUring* ring() const { return ring_; }
+
+ private:
+  enum : std::size_t { kMaxFreeFrames = 4 };
+
+  static void OnComplete(void* context, int result) {
+    static_cast<IoUringWriter*>(context)->Complete(result);
+  }
+
+  Status<void> Issue() {
+    const VectorWriter& frame = frames_.front();
+    auto status =
+        ring_->QueueWrite(file_, frame.data() + written_,
+                          frame.size() - written_, offset_, &operation_);
+    if (!status)
+      Fail(status.error());
+    return status;
+  }
+
+  void Complete(int result) {
+    if (result == -EINTR || result == -EAGAIN) {
+      Issue();
+      return;
+    } else if (result < 0) {
+      Fail(ErrorStatus::IOError);
+      return;
+    } else if (result == 0) {
+      Fail(ErrorStatus::WriteLimitReached);
+      return;
+    }
+
+    written_ += result;
+    if (offset_ >= 0)
+      offset_ += result;
+
+    if (written_ == frames_.front().size()) {
+      if (free_.size() < kMaxFreeFrames)
+        free_.push_back(std::move(frames_.front()));
+      frames_.pop_front();
+      written_ = 0;
+    }
+
+    if (!frames_.empty())
+      Issue();
+  }
+
+  void Fail(ErrorStatus error) {
+    error_ = error;
+    frames_.clear();
+    written_ = 0;
+  }
+
+  IoUring* ring_;
+  IoUringFile file_;
+  std::int64_t offset_;
+  detail::IoUringOperation operation_{&OnComplete, this};
+
+  VectorWriter buffer_;
+  std::deque<VectorWriter> frames_;
+  std::vector<VectorWriter> free_;
+  std::size_t written_{0};
+  Status<void> error_;
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_IO_URING_WRITER_H_
@@ -0,0 +1,187 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_LATENCY_HISTOGRAM_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_LATENCY_HISTOGRAM_H_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace nop {
+
+// LatencyHistogram is a log-linear histogram in the style of HdrHistogram: each
+// power of two range of values is divided into kSubBuckets linear buckets, so
+// that every recorded value is known to within 1 / kSubBuckets of its value
+// (12.5%) over the whole 64-bit range with a fixed number of counters. Values
+// smaller than kSubBuckets are recorded exactly.
+//
+// Recording a value is a constant time index computation and an increment, and
+// histograms are merged by adding their counters.
+class LatencyHistogram {
+ public:
+  // Number of linear buckets per power of two, which sets the precision.
+  enum : std::size_t { kSubBucketBits = 3, kSubBuckets = 1 << kSubBucketBits };
+
+  // Total number of buckets covering all 64-bit values.
+  enum : std::size_t { kBuckets = (64 - kSubBucketBits + 1) * kSubBuckets };
+
+  // Returns the index of the bucket that holds |value|.
+  static constexpr std::size_t BucketIndex(std::uint64_t value) {
+    if (value < kSubBuckets)
+      return static_cast<std::size_t>(value);
+
+    const std::size_t exponent = Log2(value);
+    const std::size_t shift = exponent - kSubBucketBits;
+    const std::size_t sub_bucket =
+        static_cast<std::size_t>(value >> shift) & (kSubBuckets - 1);
+    return (shift + 1) * kSubBuckets + sub_bucket;
+  }
+
+  // Returns the largest value that is held by the bucket at |index|.
+  static constexpr std::uint64_t BucketUpperBound(std::size_t index) {
+    if (index < kSubBuckets)
+      return index;
+
+    const std::size_t shift = index / kSubBuckets - 1;
+    const std::uint64_t lower = static_cast<std::uint64_t>(
+                                    kSubBuckets + index % kSubBuckets)
+                                << shift;
+    return lower + ((std::uint64_t{1} << shift) - 1);
+  }
+
+  void Record(std::uint64_t value) { Record(value, 1); }
+
+  void Record(std::uint64_t value, std::uint64_t count) {
+    counts_[BucketIndex(value)] += count;
+    count_ += count;
+    sum_ += value * count;
+    if (value > max_)
+      max_ = value;
+  }
+
+  // Returns the upper bound of the bucket containing the value at |quantile|,
+  // between 0 and 1, of the recorded values, or zero if the histogram is empty.
+  std::uint64_t Percentile(double quantile) const {
+    if (count_ == 0)
+      return 0;
+
+    std::uint64_t rank = static_cast<std::uint64_t>(quantile * count_ + 0.5);
+    if (rank == 0)
+      rank = 1;
+    if (rank > count_)
+      rank = count_;
+
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < kBuckets; i++) {
+      seen += counts_[i];
+      if (seen >= rank)
+        return BucketUpperBound(i) < max_ ? BucketUpperBound(i) : max_;
+    }
+    return max_;
+  }
+
+  std::uint64_t count() const { return count_; }
+  std::uint64_t sum() const { return sum_; }
+  std::uint64_t max() const { return max_; }
+  double mean() const {
+    return count_ ? static_cast<double>(sum_) / count_ : 0.0;
+  }
+
+  // Returns the number of values recorded in the bucket at |index|.
+  std::uint64_t bucket(std::size_t index) const { return counts_[index]; }
+
+  void Reset() { *this = LatencyHistogram{}; }
+
+  LatencyHistogram& operator+=(const LatencyHistogram& other) {
+    for (std::size_t i = 0; i < kBuckets; i++)
+      counts_[i] += other.counts_[i];
+    count_ += other.count_;
+    sum_ += other.sum_;
+    if (other.max_ > max_)
+      max_ = other.max_;
+    return *this;
+  }
+
+ private:
+  friend class AtomicLatencyHistogram;
+
+  static constexpr std::size_t Log2(std::uint64_t value) {
+#if defined(__GNUC__) || defined(__clang__)
+    return 63 - __builtin_clzll(value);
+#else
+    std::size_t log2 = 0;
+    while (value >>= 1)
+      log2++;
+    return log2;
+#endif
+  }
+
+  std::array<std::uint64_t, kBuckets> counts_{};
+  std::uint64_t count_{0};
+  std::uint64_t sum_{0};
+  std::uint64_t max_{0};
+};
+
+// AtomicLatencyHistogram is a LatencyHistogram that one thread records into
+// while any number of other threads take snapshots of it. Recording uses only
+// relaxed loads and stores, without read-modify-write instructions, so it must
+// not be called from more than one thread at a time; give each recording
+// thread its own histogram and merge the snapshots instead.
+class AtomicLatencyHistogram {
+ public:
+  AtomicLatencyHistogram() = default;
+
+  AtomicLatencyHistogram(const AtomicLatencyHistogram&) = delete;
+  void operator=(const AtomicLatencyHistogram&) = delete;
+
+  void Record(std::uint64_t value) {
+    Increment(&counts_[LatencyHistogram::BucketIndex(value)], 1);
+    Increment(&count_, 1);
+    Increment(&sum_, value);
+    if (value > max_.load(std::memory_order_relaxed))
+      max_.store(value, std::memory_order_relaxed);
+  }
+
+  // Returns a copy of the histogram. The copy is not an atomic snapshot: values
+  // recorded concurrently may be reflected in some counters but not others.
+  LatencyHistogram Snapshot() const {
+    LatencyHistogram histogram;
+    for (std::size_t i = 0; i < LatencyHistogram::kBuckets; i++)
+      histogram.counts_[i] = counts_[i].load(std::memory_order_relaxed);
+    histogram.count_ = count_.load(std::memory_order_relaxed);
+    histogram.sum_ = sum_.load(std::memory_order_relaxed);
+    histogram.max_ = max_.load(std::memory_order_relaxed);
+    return histogram;
+  }
+
+ private:
+  static void Increment(std::atomic<std::uint64_t>* counter,
+                        std::uint64_t value) {
+    counter->store(counter->load(std::memory_order_relaxed) + value,
+                   std::memory_order_relaxed);
+  }
+
+  std::array<std::atomic<std::uint64_t>, LatencyHistogram::kBuckets> counts_{};
+  std::atomic<std::uint64_t> count_{0};
+  std::atomic<std::uint64_t> sum_{0};
+  std::atomic<std::uint64_t> max_{0};
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_LATENCY_HISTOGRAM_H_
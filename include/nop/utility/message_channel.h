@@ -0,0 +1,299 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_MESSAGE_CHANNEL_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_MESSAGE_CHANNEL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <utility>
+
+#include <nop/base/serializer.h>
+#include <nop/status.h>
+#include <nop/types/optional.h>
+#include <nop/types/thread_local.h>
+#include <nop/utility/vector_writer.h>
+
+namespace nop {
+
+namespace detail {
+
+// A serialized message queued on a MessageChannel.
+struct ChannelFrame {
+  ChannelFrame* next{nullptr};
+  VectorWriter writer;
+};
+
+// Per-thread cache of frames, so that a producer reaches a steady state where
+// sending a message does not allocate.
+class ChannelFrameCache {
+ public:
+  // Maximum number of idle frames retained by each thread.
+  enum : std::size_t { kMaxFrames = 16 };
+
+  ChannelFrameCache() = default;
+  ChannelFrameCache(ChannelFrameCache&& other) { *this = std::move(other); }
+  ~ChannelFrameCache() { Trim(0); }
+
+  ChannelFrameCache& operator=(ChannelFrameCache&& other) {
+    if (this != &other) {
+      Trim(0);
+      std::swap(head_, other.head_);
+      std::swap(count_, other.count_);
+    }
+    return *this;
+  }
+
+  // Takes a frame from the cache, refilling the cache from |list| when it is
+  // empty. Allocates a new frame when both are empty.
+  ChannelFrame* Take(std::atomic<ChannelFrame*>* list) {
+    if (head_ == nullptr) {
+      // Taking the whole list at once avoids the ABA problem of popping single
+      // nodes from a shared stack.
+      ChannelFrame* frame = list->exchange(nullptr, std::memory_order_acquire);
+      while (frame) {
+        ChannelFrame* next = frame->next;
+        Put(frame);
+        frame = next;
+      }
+    }
+
+    if (head_ == nullptr)
+      return new ChannelFrame;
+
+    ChannelFrame* frame = head_;
+    head_ = frame->next;
+    frame->next = nullptr;
+    count_--;
+    return frame;
+  }
+
+  // Returns |frame| to the cache, or deletes it when the cache is full.
+  void Put(ChannelFrame* frame) {
+    if (count_ >= kMaxFrames) {
+      delete frame;
+    } else {
+      frame->next = head_;
+      head_ = frame;
+      count_++;
+    }
+  }
+
+  // Deletes frames until at most |count| remain.
+  void Trim(std::size_t count) {
+    while (count_ > count) {
+      ChannelFrame* frame = head_;
+      head_ = frame->next;
+      delete frame;
+      count_--;
+    }
+  }
+
+ private:
+  ChannelFrame* head_{nullptr};
+  std::size_t count_{0};
+};
+
+}  // namespace detail
+
+// MessageChannel funnels messages from any number of producer threads into a
+// single Writer owned by a consumer thread.
+//
+// Producers call Send(), which serializes the message into a buffer owned by
+// the calling thread, without holding any lock, and then pushes the completed
+// frame onto a lock-free queue. The consumer calls Drain() or Flush() to write
+// the queued frames to the writer in the order they were sent. Serialization
+// therefore runs concurrently on all producer threads, and the only
+// synchronization between producers is a single compare-and-swap per message.
+//
+// Each frame is a complete serialized message, so the output of the writer is
+// a sequence of messages that a Deserializer reads back with one Read() call
+// per message. Frame buffers are recycled from the consumer back to the
+// producers and retain their capacity.
+//
+// Example:
+//
+//   MessageChannel<StreamWriter<std::ostream*>> channel{&stream};
+//
+//   // On each worker thread:
+//   auto status = channel.Send(message);
+//
+//   // On the writer thread:
+//   while (true) {
+//     auto status = channel.Drain();
+//     if (!status || status.get() == 0)
+//       break;  // Write error or closed channel.
+//   }
+//
+template <typename Writer>
+class MessageChannel {
+ public:
+  template <typename... Args>
+  MessageChannel(Args&&... args) : writer_{std::forward<Args>(args)...} {}
+
+  ~MessageChannel() {
+    Delete(queue_.exchange(nullptr));
+    Delete(free_.exchange(nullptr));
+    Delete(pending_);
+  }
+
+  MessageChannel(const MessageChannel&) = delete;
+  void operator=(const MessageChannel&) = delete;
+
+  // Serializes |value| and queues it for the consumer. May be called from any
+  // number of threads concurrently. Returns ErrorStatus::WriteLimitReached when
+  // the channel is closed.
+  template <typename T>
+  Status<void> Send(const T& value) {
+    if (closed_.load(std::memory_order_relaxed))
+      return ErrorStatus::WriteLimitReached;
+
+    FrameCache& cache = ThreadFrameCache{InPlace{}}.Get();
+    detail::ChannelFrame* frame = cache.Take(&free_);
+
+    frame->writer.Reset();
+    auto status = Serializer<VectorWriter*>{&frame->writer}.Write(value);
+    if (!status) {
+      cache.Put(frame);
+      return status;
+    }
+
+    Push(&queue_, frame);
+
+    // Wake the consumer if it is blocked in Drain(). The sequentially
+    // consistent push above and load here pair with those in Drain(), so that
+    // either the consumer observes the frame or the producer observes the
+    // waiting consumer.
+    if (waiting_.load())
+      Notify();
+    return {};
+  }
+
+  // Writes all queued frames to the writer without blocking. Returns the number
+  // of frames written. If a write fails the error is returned and the
+  // remaining frames stay queued for the next call.
+  Status<std::size_t> Flush() {
+    Collect();
+
+    std::size_t count = 0;
+    while (pending_) {
+      detail::ChannelFrame* frame = pending_;
+      const VectorWriter& frame_writer = frame->writer;
+
+      auto status = writer_.Prepare(frame_writer.size());
+      if (status) {
+        status = writer_.Write(frame_writer.data(),
+                               frame_writer.data() + frame_writer.size());
+      }
+      if (!status)
+        return status.error();
+
+      pending_ = frame->next;
+      frame->next = nullptr;
+      Push(&free_, frame);
+      count++;
+    }
+
+    return count;
+  }
+
+  // Blocks until frames are queued or the channel is closed, then writes all
+  // queued frames to the writer. Returns the number of frames written, which is
+  // zero only when the channel is closed and empty.
+  Status<std::size_t> Drain() {
+    if (!pending_ && !queue_.load()) {
+      std::unique_lock<std::mutex> lock{mutex_};
+      waiting_.store(true);
+      condition_.wait(lock, [this] {
+        return queue_.load() != nullptr || closed_.load();
+      });
+      waiting_.store(false);
+    }
+
+    return Flush();
+  }
+
+  // Closes the channel: subsequent calls to Send() fail, and Drain() returns
+  // once the frames that are already queued have been written.
+  void Close() {
+    closed_.store(true);
+    Notify();
+  }
+
+  bool is_closed() const { return closed_.load(); }
+
+  const Writer& writer() const { return writer_; }
+  Writer& writer() { return writer_; }
+
+ private:
+  using FrameCache = detail::ChannelFrameCache;
+  using ThreadFrameCache =
+      ThreadLocal<FrameCache, ThreadLocalTypeSlot<detail::ChannelFrame>>;
+
+  static void Push(std::atomic<detail::ChannelFrame*>* list,
+                   detail::ChannelFrame* frame) {
+    frame->next = list->load(std::memory_order_relaxed);
+    while (!list->compare_exchange_weak(frame->next, frame)) {
+    }
+  }
+
+  static void Delete(detail::ChannelFrame* frame) {
+    while (frame) {
+      detail::ChannelFrame* next = frame->next;
+      delete frame;
+      frame = next;
+    }
+  }
+
+  // Moves newly queued frames to the end of the pending list. The queue is a
+  // stack, so the frames are reversed to restore the order they were sent in.
+  void Collect() {
+    detail::ChannelFrame* frame = queue_.exchange(nullptr);
+    detail::ChannelFrame* reversed = nullptr;
+    while (frame) {
+      detail::ChannelFrame* next = frame->next;
+      frame->next = reversed;
+      reversed = frame;
+      frame = next;
+    }
+
+    detail::ChannelFrame** tail = &pending_;
+    while (*tail)
+      tail = &(*tail)->next;
+    *tail = reversed;
+  }
+
+  void Notify() {
+    std::lock_guard<std::mutex> lock{mutex_};
+    condition_.notify_one();
+  }
+
+  Writer writer_;
+  std::atomic<detail::ChannelFrame*> queue_{nullptr};
+  std::atomic<detail::ChannelFrame*> free_{nullptr};
+  detail::ChannelFrame* pending_{nullptr};
+
+  std::atomic<bool> closed_{false};
+  std::atomic<bool> waiting_{false};
+  std::mutex mutex_;
+  std::condition_variable condition_;
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_MESSAGE_CHANNEL_H_
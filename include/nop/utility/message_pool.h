@@ -0,0 +1,201 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_MESSAGE_POOL_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_MESSAGE_POOL_H_
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <nop/status.h>
+#include <nop/types/optional.h>
+#include <nop/types/thread_local.h>
+
+namespace nop {
+
+// MessagePool is a pool of default constructed messages of type T that are
+// handed out for deserialization and returned with the capacity of their
+// nested strings, vectors, and maps intact. Decoding a message of similar shape
+// into a returned object then reuses that capacity instead of allocating,
+// especially with a reader that opts into ReuseStorage.
+//
+// Messages are handed out as move-only Handles that return the message to the
+// pool when destroyed. A pool is not synchronized and must outlive its handles.
+// Alternatively, MessagePool<T>::Local() returns a pool per thread; handles
+// from thread pools return their messages to the pool of the destroying thread,
+// so that messages may be decoded on one thread and released on another.
+//
+// Objects are returned to the pool as they are; any state of a message that
+// is not overwritten by decoding is retained.
+//
+// Example:
+//
+//   using Pool = nop::MessagePool<Order>;
+//
+//   Status<void> HandleOrder(const std::uint8_t* data, std::size_t size) {
+//     nop::Deserializer<nop::ReuseStorage<nop::BufferReader>> deserializer{
+//         data, size};
+//     auto order = Pool::Local().Read(&deserializer);
+//     if (!order)
+//       return order.error();
+//
+//     return Submit(std::move(order.get()));
+//   }
+//
+template <typename T>
+class MessagePool {
+ public:
+  // Default maximum number of idle messages retained by a pool.
+  enum : std::size_t { kDefaultMaxIdle = 64 };
+
+  // Owns a message taken from a pool, and returns it to the pool when
+  // destroyed.
+  class Handle {
+   public:
+    Handle() = default;
+    Handle(Handle&& other) { *this = std::move(other); }
+    ~Handle() { Release(); }
+
+    Handle& operator=(Handle&& other) {
+      if (this != &other) {
+        Release();
+        message_ = std::move(other.message_);
+        pool_ = other.pool_;
+        other.pool_ = nullptr;
+      }
+      return *this;
+    }
+
+    const T& operator*() const { return *message_; }
+    T& operator*() { return *message_; }
+    const T* operator->() const { return message_.get(); }
+    T* operator->() { return message_.get(); }
+    const T* get() const { return message_.get(); }
+    T* get() { return message_.get(); }
+
+    explicit operator bool() const { return message_ != nullptr; }
+
+    // Returns the message to its pool early, leaving the handle empty.
+    void reset() { Release(); }
+
+   private:
+    friend class MessagePool;
+
+    Handle(std::unique_ptr<T> message, MessagePool* pool)
+        : message_{std::move(message)}, pool_{pool} {}
+
+    Handle(const Handle&) = delete;
+    void operator=(const Handle&) = delete;
+
+    void Release() {
+      if (message_) {
+        MessagePool* pool = pool_ ? pool_ : &MessagePool::Local();
+        pool->Put(std::move(message_));
+      }
+      pool_ = nullptr;
+    }
+
+    std::unique_ptr<T> message_;
+    // Null for messages of thread pools, which return to the pool of the
+    // destroying thread.
+    MessagePool* pool_{nullptr};
+  };
+
+  MessagePool() = default;
+  explicit MessagePool(std::size_t max_idle) : max_idle_{max_idle} {}
+  MessagePool(MessagePool&&) = default;
+  MessagePool& operator=(MessagePool&&) = default;
+
+  // Returns the pool of the calling thread.
+  static MessagePool& Local() {
+    return ThreadLocal<LocalPool, ThreadLocalTypeSlot<MessagePool>>{InPlace{}}
+        .Get()
+        .pool;
+  }
+
+  // Takes an idle message from the pool, or constructs a new one if the pool is
+  // empty.
+  Handle Acquire() {
+    std::unique_ptr<T> message;
+    if (idle_.empty()) {
+      message.reset(new T{});
+    } else {
+      message = std::move(idle_.back());
+      idle_.pop_back();
+    }
+    return {std::move(message), is_local_ ? nullptr : this};
+  }
+
+  // Acquires a message and reads it from |deserializer|. The message is
+  // returned to the pool if the read fails.
+  template <typename Deserializer>
+  Status<Handle> Read(Deserializer* deserializer) {
+    Handle handle = Acquire();
+    auto status = deserializer->Read(handle.get());
+    if (!status)
+      return status.error();
+    return {std::move(handle)};
+  }
+
+  // Constructs idle messages until the pool holds |count|, up to the maximum.
+  void Reserve(std::size_t count) {
+    if (count > max_idle_)
+      count = max_idle_;
+    idle_.reserve(count);
+    while (idle_.size() < count)
+      idle_.emplace_back(new T{});
+  }
+
+  // Sets the maximum number of idle messages and frees any in excess.
+  void SetMaxIdle(std::size_t max_idle) {
+    max_idle_ = max_idle;
+    if (idle_.size() > max_idle_)
+      idle_.resize(max_idle_);
+  }
+
+  // Frees all idle messages.
+  void Clear() { idle_.clear(); }
+
+  // Returns the number of idle messages in the pool.
+  std::size_t size() const { return idle_.size(); }
+  std::size_t max_idle() const { return max_idle_; }
+
+ private:
+  MessagePool(const MessagePool&) = delete;
+  void operator=(const MessagePool&) = delete;
+
+  // Wrapper that marks the pool of each thread.
+  struct LocalPool {
+    LocalPool() { pool.is_local_ = true; }
+    MessagePool pool;
+  };
+
+  void Put(std::unique_ptr<T> message) {
+    if (idle_.size() < max_idle_)
+      idle_.push_back(std::move(message));
+  }
+
+  std::vector<std::unique_ptr<T>> idle_;
+  std::size_t max_idle_{kDefaultMaxIdle};
+  bool is_local_{false};
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_MESSAGE_POOL_H_
@@ -0,0 +1,191 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_MMAP_READER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_MMAP_READER_H_
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <utility>
+
+#include <nop/base/encoding.h>
+#include <nop/base/utility.h>
+#include <nop/utility/fixint_scan.h>
+
+namespace nop {
+
+// MmapReader is a reader type that maps a file read-only into memory and
+// deserializes directly from the mapping. Pages are faulted in by the kernel
+// as they are touched, so the cost of decoding is proportional to the parts of
+// the file that are actually read rather than the size of the file.
+//
+// The reader supports borrowing, which allows BinaryView and StringView values
+// to reference the mapped bytes directly instead of copying them. Such views
+// remain valid for as long as the reader, or a reader it is moved into, is
+// alive.
+//
+// Because the mapping is usually untrusted input from disk, every operation is
+// bounds-checked, as in PedanticBufferReader.
+class MmapReader {
+ public:
+  MmapReader() = default;
+  MmapReader(const MmapReader&) = delete;
+  MmapReader(MmapReader&& other) { *this = std::move(other); }
+
+  ~MmapReader() { Clear(); }
+
+  MmapReader& operator=(const MmapReader&) = delete;
+  MmapReader& operator=(MmapReader&& other) {
+    if (this != &other) {
+      Clear();
+      std::swap(buffer_, other.buffer_);
+      std::swap(size_, other.size_);
+      std::swap(index_, other.index_);
+    }
+    return *this;
+  }
+
+  // Maps the file at |path|. Returns ErrorStatus::IOError if the file cannot be
+  // opened or mapped.
+  static Status<MmapReader> Open(const std::string& path) {
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+      return ErrorStatus::IOError;
+
+    auto status = Map(fd);
+    ::close(fd);
+    return status;
+  }
+
+  // Maps the entire file referred to by |fd|. The fd is not retained and may be
+  // closed after this call returns.
+  static Status<MmapReader> Map(int fd) {
+    struct stat stat_buf;
+    if (::fstat(fd, &stat_buf) < 0)
+      return ErrorStatus::IOError;
+
+    MmapReader reader;
+    reader.size_ = static_cast<std::size_t>(stat_buf.st_size);
+
+    // Empty files cannot be mapped; leave the reader empty.
+    if (reader.size_ == 0)
+      return {std::move(reader)};
+
+    void* address =
+        ::mmap(nullptr, reader.size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (address == MAP_FAILED)
+      return ErrorStatus::IOError;
+
+    reader.buffer_ = static_cast<const std::uint8_t*>(address);
+    return {std::move(reader)};
+  }
+
+  // Unmaps the file. Views borrowed from the reader become invalid.
+  void Clear() {
+    if (buffer_)
+      ::munmap(const_cast<std::uint8_t*>(buffer_), size_);
+    buffer_ = nullptr;
+    size_ = 0;
+    index_ = 0;
+  }
+
+  Status<void> Ensure(std::size_t size) {
+    if (size_ - index_ < size)
+      return ErrorStatus::ReadLimitReached;
+    else
+      return {};
+  }
+
+  Status<void> Read(std::uint8_t* byte) { return Read(byte, byte + 1); }
+
+  template <typename T, typename Enable = EnableIfArithmetic<T>>
+  Status<void> Read(T* begin, T* end) {
+    const std::size_t element_size = sizeof(T);
+    const std::size_t length = end - begin;
+    const std::size_t length_bytes = length * element_size;
+
+    if (length_bytes > (size_ - index_))
+      return ErrorStatus::ReadLimitReached;
+
+    std::memcpy(begin, buffer_ + index_, length_bytes);
+    index_ += length_bytes;
+    return {};
+  }
+
+  Status<void> Skip(std::size_t padding_bytes) {
+    if (padding_bytes > (size_ - index_))
+      return ErrorStatus::ReadLimitReached;
+
+    index_ += padding_bytes;
+    return {};
+  }
+
+  // Returns a pointer to the next |size| bytes of the mapping and advances past
+  // them.
+  Status<void> Borrow(std::size_t size, const void** data) {
+    if (size > (size_ - index_))
+      return ErrorStatus::ReadLimitReached;
+
+    *data = buffer_ + index_;
+    index_ += size;
+    return {};
+  }
+
+  // Repositions the reader at |offset| bytes from the start of the mapping.
+  // This is useful to decode a record at a known position without reading the
+  // records that precede it.
+  Status<void> Seek(std::size_t offset) {
+    if (offset > size_)
+      return ErrorStatus::ReadLimitReached;
+
+    index_ = offset;
+    return {};
+  }
+
+  // Advances past up to |max_count| consecutive fixint values and returns the
+  // number skipped. Used by ValidateValue() and SkipValue() to walk runs of
+  // small integers in bulk.
+  std::size_t SkipFixInts(std::size_t max_count) {
+    const std::size_t remaining = size_ - index_;
+    const std::size_t count = CountFixInts(
+        buffer_ + index_, max_count < remaining ? max_count : remaining);
+    index_ += count;
+    return count;
+  }
+
+  bool empty() const { return index_ == size_; }
+
+  const std::uint8_t* data() const { return buffer_; }
+  std::size_t offset() const { return index_; }
+  std::size_t remaining() const { return size_ - index_; }
+  std::size_t capacity() const { return size_; }
+
+ private:
+  const std::uint8_t* buffer_{nullptr};
+  std::size_t size_{0};
+  std::size_t index_{0};
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_MMAP_READER_H_
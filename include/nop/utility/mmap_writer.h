@@ -0,0 +1,256 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_MMAP_WRITER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_MMAP_WRITER_H_
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <utility>
+
+#include <nop/base/encoding.h>
+#include <nop/base/utility.h>
+
+namespace nop {
+
+// MmapWriter is a writer type that serializes directly into a shared mapping of
+// an output file, avoiding the copies through a stream buffer and the write()
+// system calls of StreamWriter and FdWriter.
+//
+// The file is extended and remapped in the Prepare() method to fit the size
+// computed by the Serializer, after which Write() and Skip() copy without
+// bounds checks, in the same way as VectorWriter. Space is reserved in whole
+// extents of at least |extent| bytes, so that an unbounded sequence of values
+// remaps the file a bounded number of times per gigabyte written. On Linux the
+// space is allocated with posix_fallocate(), which avoids faulting in sparse
+// pages and reports a full disk up front instead of with SIGBUS on access.
+//
+// Close() truncates the file to the bytes actually written. The destructor
+// closes the writer if Close() was not called, ignoring errors.
+//
+// Example:
+//
+//   auto writer = MmapWriter::Open("export.bin");
+//   if (!writer)
+//     return writer.error();
+//
+//   Serializer<MmapWriter> serializer{writer.take()};
+//   for (const auto& record : records) {
+//     auto status = serializer.Write(record);
+//     if (!status)
+//       return status;
+//   }
+//   return serializer.writer().Close();
+//
+class MmapWriter {
+ public:
+  // Default size of the extents used to grow the file.
+  enum : std::size_t { kDefaultExtent = 64 * 1024 * 1024 };
+
+  MmapWriter() = default;
+  MmapWriter(const MmapWriter&) = delete;
+  MmapWriter(MmapWriter&& other) { *this = std::move(other); }
+
+  ~MmapWriter() { Close(); }
+
+  MmapWriter& operator=(const MmapWriter&) = delete;
+  MmapWriter& operator=(MmapWriter&& other) {
+    if (this != &other) {
+      Close();
+      std::swap(fd_, other.fd_);
+      std::swap(buffer_, other.buffer_);
+      std::swap(capacity_, other.capacity_);
+      std::swap(index_, other.index_);
+      std::swap(extent_, other.extent_);
+    }
+    return *this;
+  }
+
+  // Creates or truncates the file at |path| for writing. Returns
+  // ErrorStatus::IOError if the file cannot be opened.
+  static Status<MmapWriter> Open(const std::string& path,
+                                 std::size_t extent = kDefaultExtent) {
+    const int fd =
+        ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+      return ErrorStatus::IOError;
+
+    return Adopt(fd, extent);
+  }
+
+  // Takes ownership of |fd|, which must be open for reading and writing. Output
+  // starts at the beginning of the file and the file is truncated to the output
+  // on Close().
+  static Status<MmapWriter> Adopt(int fd, std::size_t extent = kDefaultExtent) {
+    MmapWriter writer;
+    writer.fd_ = fd;
+    writer.extent_ = RoundUpToPage(extent > 0 ? extent : 1);
+    return {std::move(writer)};
+  }
+
+  Status<void> Prepare(std::size_t size) {
+    if (size > capacity_ - index_)
+      return Grow(index_ + size);
+    else
+      return {};
+  }
+
+  Status<void> Write(std::uint8_t byte) { return Write(&byte, &byte + 1); }
+
+  template <typename T, typename Enable = EnableIfArithmetic<T>>
+  Status<void> Write(const T* begin, const T* end) {
+    const std::size_t element_size = sizeof(T);
+    const std::size_t length = end - begin;
+    const std::size_t length_bytes = length * element_size;
+
+    std::memcpy(buffer_ + index_, begin, length_bytes);
+    index_ += length_bytes;
+    return {};
+  }
+
+  Status<void> Skip(std::size_t padding_bytes,
+                    std::uint8_t padding_value = 0x00) {
+    std::memset(buffer_ + index_, padding_value, padding_bytes);
+    index_ += padding_bytes;
+    return {};
+  }
+
+  // Overwrites previously written bytes; see ExactTableEntries.
+  Status<void> Patch(std::size_t offset, const std::uint8_t* begin,
+                     const std::uint8_t* end) {
+    const std::size_t length_bytes = end - begin;
+    if (offset > index_ || length_bytes > index_ - offset)
+      return ErrorStatus::WriteLimitReached;
+
+    std::memcpy(buffer_ + offset, begin, length_bytes);
+    return {};
+  }
+
+  // Writes the output to the file and waits for it to reach the storage
+  // device, for example at a checkpoint of a long export.
+  Status<void> Sync() {
+    if (buffer_ && ::msync(buffer_, capacity_, MS_SYNC) < 0)
+      return ErrorStatus::IOError;
+    else
+      return {};
+  }
+
+  // Unmaps the file, truncates it to the bytes written and closes it. The
+  // writer is left empty. Returns ErrorStatus::IOError if the file cannot be
+  // truncated or closed.
+  Status<void> Close() {
+    if (fd_ < 0)
+      return {};
+
+    bool ok = true;
+    if (buffer_)
+      ok = ::munmap(buffer_, capacity_) == 0;
+    ok = ::ftruncate(fd_, static_cast<off_t>(index_)) == 0 && ok;
+    ok = ::close(fd_) == 0 && ok;
+
+    fd_ = -1;
+    buffer_ = nullptr;
+    capacity_ = 0;
+    index_ = 0;
+
+    if (ok)
+      return {};
+    else
+      return ErrorStatus::IOError;
+  }
+
+  bool is_open() const { return fd_ >= 0; }
+
+  const std::uint8_t* data() const { return buffer_; }
+  std::uint8_t* data() { return buffer_; }
+
+  std::size_t offset() const { return index_; }
+  std::size_t size() const { return index_; }
+  std::size_t capacity() const { return capacity_; }
+  std::size_t extent() const { return extent_; }
+
+ private:
+  static std::size_t RoundUpToPage(std::size_t size) {
+    const std::size_t page_size =
+        static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+    return (size + page_size - 1) / page_size * page_size;
+  }
+
+  // Extends the file to at least |required_size| bytes, rounded up to whole
+  // extents, and maps the new size. The existing mapping remains valid until
+  // the new one is established, so the writer is unchanged on failure.
+  Status<void> Grow(std::size_t required_size) {
+    if (fd_ < 0)
+      return ErrorStatus::WriteLimitReached;
+
+    std::size_t new_capacity = capacity_ + extent_;
+    if (new_capacity < required_size)
+      new_capacity = (required_size + extent_ - 1) / extent_ * extent_;
+
+    auto status = Reserve(new_capacity);
+    if (!status)
+      return status;
+
+    void* address = ::mmap(nullptr, new_capacity, PROT_READ | PROT_WRITE,
+                           MAP_SHARED, fd_, 0);
+    if (address == MAP_FAILED)
+      return ErrorStatus::IOError;
+
+    // Both mappings share the pages of the file, so the bytes written so far
+    // are visible through the new mapping.
+    if (buffer_)
+      ::munmap(buffer_, capacity_);
+
+    buffer_ = static_cast<std::uint8_t*>(address);
+    capacity_ = new_capacity;
+    return {};
+  }
+
+  // Sets the size of the file to |size| bytes, allocating the storage where
+  // supported.
+  Status<void> Reserve(std::size_t size) {
+#if defined(__linux__)
+    // File systems without fallocate() support fall back to a sparse file.
+    const int error = ::posix_fallocate(fd_, 0, static_cast<off_t>(size));
+    if (error == 0)
+      return {};
+    else if (error != EINVAL && error != EOPNOTSUPP)
+      return ErrorStatus::IOError;
+#endif
+    if (::ftruncate(fd_, static_cast<off_t>(size)) < 0)
+      return ErrorStatus::IOError;
+    else
+      return {};
+  }
+
+  int fd_{-1};
+  std::uint8_t* buffer_{nullptr};
+  std::size_t capacity_{0};
+  std::size_t index_{0};
+  std::size_t extent_{kDefaultExtent};
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_MMAP_WRITER_H_
@@ -0,0 +1,280 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_PAGE_BUFFER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_PAGE_BUFFER_H_
+
+#include <linux/mempolicy.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include <nop/base/encoding.h>
+#include <nop/base/utility.h>
+#include <nop/status.h>
+
+namespace nop {
+
+// Options for the memory backing a PageBuffer.
+struct PageBufferOptions {
+  // Back the buffer with huge pages to reduce TLB misses. Explicit huge pages
+  // (MAP_HUGETLB) are used when the system has them reserved; otherwise the
+  // buffer is rounded up to the huge page size and transparent huge pages are
+  // requested with madvise().
+  bool huge_pages{false};
+
+  // Prefer the NUMA node of the CPU that allocates the buffer, so that the
+  // pages are local to the threads running there.
+  bool local_node{false};
+};
+
+namespace detail {
+
+// Size of the huge pages requested by PageBuffer.
+enum : std::size_t { kHugePageSize = std::size_t{2} << 20 };
+
+// Returns the CPU and NUMA node that the calling thread is running on, or zero
+// when they cannot be determined.
+inline void GetCpuAndNode(unsigned* cpu, unsigned* node) {
+  *cpu = 0;
+  *node = 0;
+  if (::syscall(SYS_getcpu, cpu, node, nullptr) != 0) {
+    *cpu = 0;
+    *node = 0;
+  }
+}
+
+}  // namespace detail
+
+// PageBuffer is a move-only byte buffer mapped directly from the kernel, with
+// optional huge page backing and NUMA placement; see PageBufferOptions. The
+// size is rounded up to whole pages. The memory is zero-filled when it is
+// first touched.
+class PageBuffer {
+ public:
+  PageBuffer() = default;
+  PageBuffer(PageBuffer&& other) { *this = std::move(other); }
+  ~PageBuffer() { Clear(); }
+
+  PageBuffer& operator=(PageBuffer&& other) {
+    if (this != &other) {
+      Clear();
+      std::swap(data_, other.data_);
+      std::swap(size_, other.size_);
+      std::swap(huge_, other.huge_);
+      std::swap(node_, other.node_);
+      std::swap(cpu_, other.cpu_);
+    }
+    return *this;
+  }
+
+  // Maps a buffer of at least |size| bytes. Returns ErrorStatus::SystemError
+  // if the memory cannot be mapped. Huge pages and NUMA placement are best
+  // effort: if the system does not support them the buffer is still mapped.
+  static Status<PageBuffer> Allocate(std::size_t size,
+                                     PageBufferOptions options = {}) {
+    const std::size_t page_size = options.huge_pages
+                                      ? std::size_t{detail::kHugePageSize}
+                                      : static_cast<std::size_t>(
+                                            ::sysconf(_SC_PAGESIZE));
+    size = size == 0 ? page_size
+                     : (size + page_size - 1) / page_size * page_size;
+
+    PageBuffer buffer;
+    void* data = MAP_FAILED;
+    if (options.huge_pages) {
+      data = ::mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+      buffer.huge_ = data != MAP_FAILED;
+    }
+    if (data == MAP_FAILED) {
+      data = ::mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (data == MAP_FAILED)
+        return ErrorStatus::SystemError;
+      if (options.huge_pages)
+        ::madvise(data, size, MADV_HUGEPAGE);
+    }
+
+    unsigned cpu, node;
+    detail::GetCpuAndNode(&cpu, &node);
+    buffer.data_ = static_cast<std::uint8_t*>(data);
+    buffer.size_ = size;
+    buffer.cpu_ = cpu;
+
+    // Bind before the pages are touched, since placement is decided when a
+    // page is first faulted in.
+    if (options.local_node) {
+      const std::size_t kBitsPerWord = sizeof(unsigned long) * 8;
+      unsigned long mask[4] = {};
+      if (node < sizeof(mask) * 8) {
+        mask[node / kBitsPerWord] = 1ul << (node % kBitsPerWord);
+        if (::syscall(SYS_mbind, data, size, MPOL_PREFERRED, mask,
+                      sizeof(mask) * 8, 0) == 0) {
+          buffer.node_ = static_cast<int>(node);
+        }
+      }
+    }
+
+    return {std::move(buffer)};
+  }
+
+  // Unmaps the buffer.
+  void Clear() {
+    if (data_)
+      ::munmap(data_, size_);
+    data_ = nullptr;
+    size_ = 0;
+    huge_ = false;
+    node_ = -1;
+    cpu_ = 0;
+  }
+
+  std::uint8_t* data() const { return data_; }
+  std::size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  // Returns true if the buffer is backed by explicit huge pages.
+  bool huge() const { return huge_; }
+
+  // Returns the NUMA node the buffer is bound to, or -1 if it is not bound.
+  int node() const { return node_; }
+
+  // Returns the CPU that allocated the buffer.
+  unsigned cpu() const { return cpu_; }
+
+ private:
+  PageBuffer(const PageBuffer&) = delete;
+  void operator=(const PageBuffer&) = delete;
+
+  std::uint8_t* data_{nullptr};
+  std::size_t size_{0};
+  bool huge_{false};
+  int node_{-1};
+  unsigned cpu_{0};
+};
+
+// PageBufferPool caches PageBuffers per CPU core. Mapping memory and faulting
+// in fresh pages is expensive, so writers that are constructed for each
+// message take their buffers from a pool. The pool may be shared by any
+// number of threads.
+//
+// A buffer is taken from the cache of the core the calling thread runs on and
+// is returned to the cache of the core that allocated it, so that a buffer
+// bound to a NUMA node is only reused by the cores of that node, even when the
+// thread that releases it has migrated.
+class PageBufferPool {
+ public:
+  // Default limits of the pool.
+  enum : std::size_t { kDefaultMaxBuffersPerCore = 4 };
+
+  explicit PageBufferPool(
+      PageBufferOptions options = {},
+      std::size_t max_buffers_per_core = kDefaultMaxBuffersPerCore)
+      : options_{options},
+        max_buffers_{max_buffers_per_core},
+        core_count_{CoreCount()},
+        cores_{new Core[core_count_]} {}
+
+  PageBufferPool(const PageBufferPool&) = delete;
+  void operator=(const PageBufferPool&) = delete;
+
+  // Takes a buffer of at least |size| bytes from the cache of the current
+  // core, or allocates one if the cache has none that is large enough.
+  Status<PageBuffer> Acquire(std::size_t size) {
+    unsigned cpu, node;
+    detail::GetCpuAndNode(&cpu, &node);
+
+    Core& core = cores_[cpu % core_count_];
+    {
+      std::lock_guard<std::mutex> lock{core.mutex};
+      for (auto it = core.buffers.begin(); it != core.buffers.end(); ++it) {
+        if (it->size() >= size) {
+          PageBuffer buffer = std::move(*it);
+          core.buffers.erase(it);
+          return {std::move(buffer)};
+        }
+      }
+    }
+
+    return PageBuffer::Allocate(size, options_);
+  }
+
+  // Returns |buffer| to the cache of the core that allocated it, or unmaps it
+  // if that cache is full.
+  void Release(PageBuffer buffer) {
+    if (buffer.empty())
+      return;
+
+    Core& core = cores_[buffer.cpu() % core_count_];
+    std::lock_guard<std::mutex> lock{core.mutex};
+    if (core.buffers.size() < max_buffers_)
+      core.buffers.push_back(std::move(buffer));
+  }
+
+  // Unmaps all cached buffers.
+  void Clear() {
+    for (std::size_t i = 0; i < core_count_; i++) {
+      std::vector<PageBuffer> buffers;
+      std::lock_guard<std::mutex> lock{cores_[i].mutex};
+      buffers.swap(cores_[i].buffers);
+    }
+  }
+
+  // Returns the number of cached buffers over all cores.
+  std::size_t size() const {
+    std::size_t count = 0;
+    for (std::size_t i = 0; i < core_count_; i++) {
+      std::lock_guard<std::mutex> lock{cores_[i].mutex};
+      count += cores_[i].buffers.size();
+    }
+    return count;
+  }
+
+  const PageBufferOptions& options() const { return options_; }
+
+ private:
+  // Cache of a single core, padded to avoid false sharing between cores.
+  // Over-aligned allocation requires C++17, so the padding is explicit.
+  struct Core {
+    mutable std::mutex mutex;
+    std::vector<PageBuffer> buffers;
+    char padding[64];
+  };
+
+  static std::size_t CoreCount() {
+    const long count = ::sysconf(_SC_NPROCESSORS_CONF);
+    return count > 0 ? static_cast<std::size_t>(count) : 1;
+  }
+
+  PageBufferOptions options_;
+  std::size_t max_buffers_;
+  std::size_t core_count_;
+  std::unique_ptr<Core[]> cores_;
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_PAGE_BUFFER_H_
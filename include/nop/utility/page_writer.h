@@ -0,0 +1,159 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_PAGE_WRITER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_PAGE_WRITER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
+#include <nop/base/encoding.h>
+#include <nop/base/utility.h>
+#include <nop/status.h>
+#include <nop/utility/page_buffer.h>
+
+namespace nop {
+
+// PageWriter is a growable writer like VectorWriter whose storage is a
+// PageBuffer, optionally backed by huge pages and bound to the NUMA node of
+// the core that serializes into it; see PageBufferOptions. It is intended for
+// large encodes, such as snapshots, where remote memory and TLB misses limit
+// the bandwidth of the copy into the buffer.
+//
+// Buffers are taken from a PageBufferPool when one is given, and returned to it
+// when the writer grows or is destroyed. Otherwise they are mapped and unmapped
+// directly with the options given to the writer.
+//
+// Example:
+//
+//   PageBufferPool pool{{/*huge_pages=*/true, /*local_node=*/true}};
+//
+//   // On each worker thread:
+//   Serializer<PageWriter> serializer{&pool};
+//   auto status = serializer.Write(snapshot);
+//
+class PageWriter {
+ public:
+  PageWriter() = default;
+  explicit PageWriter(PageBufferOptions options) : options_{options} {}
+  explicit PageWriter(PageBufferPool* pool)
+      : pool_{pool}, options_{pool->options()} {}
+  PageWriter(PageWriter&& other) { *this = std::move(other); }
+  ~PageWriter() { Release(); }
+
+  PageWriter& operator=(PageWriter&& other) {
+    if (this != &other) {
+      Release();
+      buffer_ = std::move(other.buffer_);
+      pool_ = other.pool_;
+      options_ = other.options_;
+      index_ = other.index_;
+      other.index_ = 0;
+    }
+    return *this;
+  }
+
+  // Grows the buffer to fit |size| more bytes. Returns ErrorStatus::SystemError
+  // if the memory cannot be mapped.
+  Status<void> Prepare(std::size_t size) {
+    if (size > buffer_.size() - index_)
+      return Grow(index_ + size);
+    return {};
+  }
+
+  Status<void> Write(std::uint8_t byte) { return Write(&byte, &byte + 1); }
+
+  template <typename T, typename Enable = EnableIfArithmetic<T>>
+  Status<void> Write(const T* begin, const T* end) {
+    const std::size_t length_bytes = (end - begin) * sizeof(T);
+    std::memcpy(buffer_.data() + index_, begin, length_bytes);
+    index_ += length_bytes;
+    return {};
+  }
+
+  Status<void> Skip(std::size_t padding_bytes,
+                    std::uint8_t padding_value = 0x00) {
+    std::memset(buffer_.data() + index_, padding_value, padding_bytes);
+    index_ += padding_bytes;
+    return {};
+  }
+
+  // Overwrites previously written bytes; see ExactTableEntries.
+  Status<void> Patch(std::size_t offset, const std::uint8_t* begin,
+                     const std::uint8_t* end) {
+    const std::size_t length_bytes = end - begin;
+    if (offset > index_ || length_bytes > index_ - offset)
+      return ErrorStatus::WriteLimitReached;
+
+    std::memcpy(buffer_.data() + offset, begin, length_bytes);
+    return {};
+  }
+
+  // Discards the serialized data while keeping the storage for reuse.
+  void Reset() { index_ = 0; }
+
+  const std::uint8_t* data() const { return buffer_.data(); }
+  std::uint8_t* data() { return buffer_.data(); }
+
+  std::size_t offset() const { return index_; }
+  std::size_t size() const { return index_; }
+  std::size_t capacity() const { return buffer_.size(); }
+
+  const PageBuffer& buffer() const { return buffer_; }
+
+ private:
+  PageWriter(const PageWriter&) = delete;
+  void operator=(const PageWriter&) = delete;
+
+  Status<void> Grow(std::size_t required_size) {
+    std::size_t new_size = buffer_.size() * 2;
+    if (new_size < required_size)
+      new_size = required_size;
+
+    auto status = pool_ ? pool_->Acquire(new_size)
+                        : PageBuffer::Allocate(new_size, options_);
+    if (!status)
+      return status.error();
+
+    PageBuffer buffer = status.take();
+    if (index_ != 0)
+      std::memcpy(buffer.data(), buffer_.data(), index_);
+
+    std::swap(buffer, buffer_);
+    if (pool_)
+      pool_->Release(std::move(buffer));
+    return {};
+  }
+
+  void Release() {
+    if (pool_)
+      pool_->Release(std::move(buffer_));
+    buffer_.Clear();
+    index_ = 0;
+  }
+
+  PageBuffer buffer_;
+  PageBufferPool* pool_{nullptr};
+  PageBufferOptions options_;
+  std::size_t index_{0};
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_PAGE_WRITER_H_
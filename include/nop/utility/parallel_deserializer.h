@@ -0,0 +1,164 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_PARALLEL_DESERIALIZER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_PARALLEL_DESERIALIZER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#include <nop/base/encoding.h>
+#include <nop/base/serializer.h>
+#include <nop/base/skip.h>
+#include <nop/status.h>
+#include <nop/utility/parallel_serializer.h>
+#include <nop/utility/pedantic_buffer_reader.h>
+#include <nop/utility/thread_pool.h>
+
+namespace nop {
+
+// ParallelDeserialize() decodes a vector of non-integral elements from a
+// buffer on the workers of a ThreadPool. It is the counterpart of
+// ParallelSerialize(), but accepts any ARY encoding of the vector, regardless
+// of how it was written.
+//
+// The ARY format has no offset table, so the boundaries of the chunks of
+// |chunk_elements| elements are first located with one pass of SkipValue()
+// over the elements, which walks the prefixes and lengths without decoding.
+// The vector is then resized and the chunks are decoded concurrently, each
+// into its own range of elements.
+//
+// Decoding uses PedanticBufferReader, so the input may be untrusted: every
+// element must lie within the buffer, the chunk boundaries found by the scan
+// must agree with the decoded elements, and the vector is only resized after
+// the scan has found all of the elements.
+//
+// Example:
+//
+//   ThreadPool pool;
+//   std::vector<Record> records;
+//   auto status = ParallelDeserialize(&pool, snapshot.data(), snapshot.size(),
+//                                     &records);
+//
+
+// Decodes a vector from the |size| bytes at |data| into |value| in parallel on
+// |pool|. Returns the number of bytes consumed. If an element fails to decode,
+// the first error in element order is returned and the contents of |value| are
+// unspecified. A BIN encoding of a floating point vector is decoded with a
+// single copy.
+template <typename T, typename Allocator>
+Status<std::size_t> ParallelDeserialize(
+    ThreadPool* pool, const void* data, std::size_t size,
+    std::vector<T, Allocator>* value,
+    std::size_t chunk_elements = kDefaultParallelChunkElements) {
+  using Type = std::vector<T, Allocator>;
+  static_assert(!std::is_integral<T>::value,
+                "Vectors of integral elements are decoded with a single copy "
+                "and do not benefit from parallel deserialization.");
+
+  if (chunk_elements == 0)
+    chunk_elements = 1;
+
+  PedanticBufferReader reader{data, size};
+  std::uint8_t prefix_byte = 0;
+  auto status = reader.Read(&prefix_byte);
+  if (!status)
+    return status.error();
+
+  const EncodingByte prefix = static_cast<EncodingByte>(prefix_byte);
+  if (!Encoding<Type>::Match(prefix)) {
+    return ErrorStatus::UnexpectedEncodingType;
+  } else if (prefix != EncodingByte::Array) {
+    status = Encoding<Type>::ReadPayload(prefix, value, &reader);
+    if (!status)
+      return status.error();
+    return size - reader.remaining();
+  }
+
+  SizeType count = 0;
+  status = Encoding<SizeType>::Read(&count, &reader);
+  if (!status)
+    return status.error();
+  else if (count > reader.remaining())
+    return ErrorStatus::InvalidContainerLength;
+
+  // Locate the start of each chunk, followed by the end of the last chunk.
+  const std::size_t chunk_count = (count + chunk_elements - 1) / chunk_elements;
+  std::vector<std::size_t> offsets;
+  offsets.reserve(chunk_count + 1);
+  for (SizeType i = 0; i < count; i++) {
+    if (i % chunk_elements == 0)
+      offsets.push_back(size - reader.remaining());
+
+    status = SkipValue(&reader);
+    if (!status)
+      return status.error();
+  }
+  offsets.push_back(size - reader.remaining());
+
+  value->clear();
+  value->resize(count);
+
+  const std::uint8_t* bytes = static_cast<const std::uint8_t*>(data);
+  std::vector<Status<void>> statuses(chunk_count);
+  ParallelFor(pool, chunk_count, [&](std::size_t chunk) {
+    PedanticBufferReader chunk_reader{bytes + offsets[chunk],
+                                      offsets[chunk + 1] - offsets[chunk]};
+    const std::size_t begin = chunk * chunk_elements;
+    const std::size_t end =
+        begin + chunk_elements < count ? begin + chunk_elements : count;
+
+    Status<void> chunk_status;
+    for (std::size_t i = begin; chunk_status && i < end; i++)
+      chunk_status = Encoding<T>::Read(&(*value)[i], &chunk_reader);
+
+    // The elements must end exactly where the scan found the next chunk.
+    if (chunk_status && !chunk_reader.empty())
+      chunk_status = ErrorStatus::ProtocolError;
+    statuses[chunk] = chunk_status;
+  });
+
+  for (const auto& chunk_status : statuses) {
+    if (!chunk_status)
+      return chunk_status.error();
+  }
+
+  return offsets.back();
+}
+
+// Decodes a vector from |buffer| into |value| in parallel on |pool|. Returns
+// ErrorStatus::ProtocolError if |buffer| holds more than the vector.
+template <typename T, typename Allocator>
+Status<void> ParallelDeserialize(
+    ThreadPool* pool, const std::vector<std::uint8_t>& buffer,
+    std::vector<T, Allocator>* value,
+    std::size_t chunk_elements = kDefaultParallelChunkElements) {
+  auto status = ParallelDeserialize(pool, buffer.data(), buffer.size(), value,
+                                    chunk_elements);
+  if (!status)
+    return status.error();
+  else if (status.get() != buffer.size())
+    return ErrorStatus::ProtocolError;
+  else
+    return {};
+}
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_PARALLEL_DESERIALIZER_H_
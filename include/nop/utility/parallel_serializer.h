@@ -0,0 +1,208 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_PARALLEL_SERIALIZER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_PARALLEL_SERIALIZER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#include <nop/base/encoding.h>
+#include <nop/base/serializer.h>
+#include <nop/status.h>
+#include <nop/utility/buffer_writer.h>
+#include <nop/utility/thread_pool.h>
+
+namespace nop {
+
+// Default number of elements encoded by each task.
+enum : std::size_t { kDefaultParallelChunkElements = 4096 };
+
+namespace detail {
+
+// Divides a vector into chunks of elements and computes the offset of each
+// chunk in the encoding of the vector.
+template <typename T, typename Allocator>
+struct ParallelVectorLayout {
+  using Type = std::vector<T, Allocator>;
+
+  static_assert(!std::is_integral<T>::value,
+                "Vectors of integral elements are encoded with a single copy "
+                "and do not benefit from parallel serialization.");
+
+  ParallelVectorLayout(ThreadPool* pool, const Type& value,
+                       std::size_t chunk_elements)
+      : chunk_elements{chunk_elements > 0 ? chunk_elements : 1},
+        chunk_count{(value.size() + this->chunk_elements - 1) /
+                    this->chunk_elements},
+        offsets(chunk_count + 1) {
+    header_size = BaseEncodingSize(EncodingByte::Array) +
+                  Encoding<SizeType>::Size(value.size());
+
+    // Chunks of fixed size elements have a size that is known up front.
+    if (HasFixedEncodingSize<T>::value) {
+      for (std::size_t i = 0; i < chunk_count; i++) {
+        offsets[i + 1] =
+            (End(value, i) - Begin(i)) * FixedEncodingSize<T>::value;
+      }
+    } else {
+      ParallelFor(pool, chunk_count, [this, &value](std::size_t chunk) {
+        std::size_t size = 0;
+        for (std::size_t i = Begin(chunk); i < End(value, chunk); i++)
+          size += Encoding<T>::Size(value[i]);
+        offsets[chunk + 1] = size;
+      });
+    }
+
+    offsets[0] = header_size;
+    for (std::size_t i = 0; i < chunk_count; i++)
+      offsets[i + 1] += offsets[i];
+  }
+
+  std::size_t Begin(std::size_t chunk) const { return chunk * chunk_elements; }
+  std::size_t End(const Type& value, std::size_t chunk) const {
+    const std::size_t end = Begin(chunk) + chunk_elements;
+    return end < value.size() ? end : value.size();
+  }
+
+  // Returns the total encoded size of the vector.
+  std::size_t size() const { return offsets[chunk_count]; }
+
+  std::size_t chunk_elements;
+  std::size_t chunk_count;
+  std::size_t header_size;
+
+  // Offsets of the chunks in the output, followed by the total size.
+  std::vector<std::size_t> offsets;
+};
+
+// Encodes |value| according to |layout| into |buffer|, which must hold at
+// least layout.size() bytes.
+template <typename T, typename Allocator>
+Status<void> ParallelWrite(ThreadPool* pool,
+                           const std::vector<T, Allocator>& value,
+                           const ParallelVectorLayout<T, Allocator>& layout,
+                           std::uint8_t* buffer) {
+  BufferWriter header{buffer, layout.header_size};
+  auto status = header.Write(static_cast<std::uint8_t>(EncodingByte::Array));
+  if (status)
+    status = Encoding<SizeType>::Write(value.size(), &header);
+  if (!status)
+    return status;
+
+  std::vector<Status<void>> statuses(layout.chunk_count);
+  ParallelFor(pool, layout.chunk_count, [&](std::size_t chunk) {
+    const std::size_t chunk_size =
+        layout.offsets[chunk + 1] - layout.offsets[chunk];
+    BufferWriter writer{buffer + layout.offsets[chunk], chunk_size};
+
+    Status<void> chunk_status;
+    for (std::size_t i = layout.Begin(chunk);
+         chunk_status && i < layout.End(value, chunk); i++) {
+      chunk_status = Encoding<T>::Write(value[i], &writer);
+    }
+
+    // An element that writes a different number of bytes than its Size()
+    // would corrupt the neighboring chunk.
+    if (chunk_status && writer.size() != chunk_size)
+      chunk_status = ErrorStatus::WriteLimitReached;
+    statuses[chunk] = chunk_status;
+  });
+
+  for (const auto& chunk_status : statuses) {
+    if (!chunk_status)
+      return chunk_status;
+  }
+  return {};
+}
+
+}  // namespace detail
+
+// Returns the encoded size of |value|, computing the sizes of the elements
+// in parallel on |pool|.
+template <typename T, typename Allocator>
+std::size_t ParallelSize(
+    ThreadPool* pool, const std::vector<T, Allocator>& value,
+    std::size_t chunk_elements = kDefaultParallelChunkElements) {
+  return detail::ParallelVectorLayout<T, Allocator>{pool, value,
+                                                    chunk_elements}
+      .size();
+}
+
+// ParallelSerialize() encodes a large vector of non-integral elements on the
+// workers of a ThreadPool, producing the same bytes as serializing the vector
+// with a Serializer:
+//
+// +-----+---------+-----//------+
+// | ARY | INT64:N | N ELEMENTS |
+// +-----+---------+-----//------+
+//
+// The elements are divided into chunks of |chunk_elements|. The encoded size
+// of each chunk is computed in parallel, the sizes are prefix-summed into
+// offsets, and each chunk is then encoded concurrently into its own disjoint
+// region of the output buffer.
+//
+// Vectors of integral elements use the BIN encoding, which is a single copy,
+// and gain nothing from running in parallel; they are rejected at compile
+// time. Elements must not contain handles, because the chunks are encoded with
+// BufferWriter, which has no handle support.
+//
+// Example:
+//
+//   ThreadPool pool;
+//   std::vector<std::uint8_t> snapshot;
+//   auto status = ParallelSerialize(&pool, state.records, &snapshot);
+//
+
+// Encodes |value| into the |size| bytes at |buffer| in parallel on |pool|.
+// Returns the number of bytes written, or ErrorStatus::WriteLimitReached if
+// the buffer is too small. If an element fails to encode, the first error in
+// element order is returned and the contents of the buffer are unspecified.
+template <typename T, typename Allocator>
+Status<std::size_t> ParallelSerialize(
+    ThreadPool* pool, const std::vector<T, Allocator>& value,
+    std::uint8_t* buffer, std::size_t size,
+    std::size_t chunk_elements = kDefaultParallelChunkElements) {
+  const detail::ParallelVectorLayout<T, Allocator> layout{pool, value,
+                                                          chunk_elements};
+  if (layout.size() > size)
+    return ErrorStatus::WriteLimitReached;
+
+  auto status = detail::ParallelWrite(pool, value, layout, buffer);
+  if (!status)
+    return status.error();
+  else
+    return layout.size();
+}
+
+// Encodes |value| in parallel on |pool|, replacing the contents of |buffer|.
+template <typename T, typename Allocator>
+Status<void> ParallelSerialize(
+    ThreadPool* pool, const std::vector<T, Allocator>& value,
+    std::vector<std::uint8_t>* buffer,
+    std::size_t chunk_elements = kDefaultParallelChunkElements) {
+  const detail::ParallelVectorLayout<T, Allocator> layout{pool, value,
+                                                          chunk_elements};
+  buffer->resize(layout.size());
+  return detail::ParallelWrite(pool, value, layout, buffer->data());
+}
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_PARALLEL_SERIALIZER_H_
@@ -23,6 +23,7 @@
 
 #include <nop/base/encoding.h>
 #include <nop/base/utility.h>
+#include <nop/utility/fixint_scan.h>
 
 namespace nop {
 
@@ -75,6 +76,39 @@ class PedanticBufferReader {
     return {};
   }
 
+  // Returns a pointer to the next |size| bytes of the buffer without advancing
+  // past them. Used to decode arrays of fixed size elements from known offsets.
+  Status<void> Peek(std::size_t size, const void** data) const {
+    if (size > (size_ - index_))
+      return ErrorStatus::ReadLimitReached;
+
+    *data = buffer_ + index_;
+    return {};
+  }
+
+  // Returns a pointer to the next |size| bytes of the buffer and advances past
+  // them. Used to decode borrowed types, such as BinaryView and StringView,
+  // without copying.
+  Status<void> Borrow(std::size_t size, const void** data) {
+    if (size > (size_ - index_))
+      return ErrorStatus::ReadLimitReached;
+
+    *data = buffer_ + index_;
+    index_ += size;
+    return {};
+  }
+
+  // Advances past up to |max_count| consecutive fixint values and returns the
+  // number skipped. Used by ValidateValue() and SkipValue() to walk runs of
+  // small integers in bulk.
+  std::size_t SkipFixInts(std::size_t max_count) {
+    const std::size_t remaining = size_ - index_;
+    const std::size_t count = CountFixInts(
+        buffer_ + index_, max_count < remaining ? max_count : remaining);
+    index_ += count;
+    return count;
+  }
+
   bool empty() const { return index_ == size_; }
 
   std::size_t remaining() const { return size_ - index_; }
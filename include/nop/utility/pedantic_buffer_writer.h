@@ -25,6 +25,7 @@
 #include <nop/base/encoding.h>
 #include <nop/base/handle.h>
 #include <nop/base/utility.h>
+#include <nop/utility/unchecked_buffer_writer.h>
 
 namespace nop {
 
@@ -32,6 +33,11 @@ namespace nop {
 // type is similar to BufferWriter, with additional bounds checks in the Write()
 // and Skip() methods. Use this type if your use case requires direct
 // interaction with the writer outside of the library-provided Serializer.
+//
+// The Serializer checks the size of each value once, with Prepare(), and then
+// encodes the value with an UncheckedBufferWriter over the prepared space,
+// which replaces the index arithmetic of every write with a comparison against
+// the end of that space.
 class PedanticBufferWriter {
  public:
   PedanticBufferWriter() = default;
@@ -82,6 +88,17 @@ class PedanticBufferWriter {
     return {};
   }
 
+  // Returns a writer over the |size| bytes at the current position, which must
+  // have been checked with Prepare(size).
+  UncheckedBufferWriter Unchecked(std::size_t size) {
+    return UncheckedBufferWriter{buffer_ + index_, buffer_ + index_ + size};
+  }
+
+  // Advances past the bytes written to |writer|.
+  void Commit(const UncheckedBufferWriter& writer) {
+    index_ = writer.cursor() - buffer_;
+  }
+
   std::size_t size() const { return index_; }
   std::size_t capacity() const { return size_; }
 
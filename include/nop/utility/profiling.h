@@ -0,0 +1,505 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_PROFILING_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_PROFILING_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <nop/base/encoding.h>
+#include <nop/base/handle.h>
+#include <nop/base/pointer.h>
+#include <nop/base/serializer.h>
+#include <nop/base/utility.h>
+#include <nop/traits/void.h>
+#include <nop/types/interned.h>
+#include <nop/utility/canonical.h>
+#include <nop/utility/exact_table_entries.h>
+#include <nop/utility/io_stats.h>
+#include <nop/utility/reuse_storage.h>
+
+namespace nop {
+
+namespace detail {
+
+// Extracts the type name between |begin_marker| and the last occurrence of
+// |end_marker| in the function |signature|.
+inline std::string ParseTypeName(const std::string& signature,
+                                 const std::string& begin_marker,
+                                 const std::string& end_marker) {
+  const std::size_t begin = signature.find(begin_marker);
+  std::size_t end = signature.rfind(end_marker);
+  if (begin == std::string::npos || end == std::string::npos || end < begin)
+    return "unknown";
+
+  // GCC appends the definitions of type aliases after a semicolon.
+  const std::size_t start = begin + begin_marker.size();
+  const std::size_t semicolon = signature.find(';', start);
+  if (semicolon != std::string::npos && semicolon < end)
+    end = semicolon;
+  return signature.substr(start, end - start);
+}
+
+}  // namespace detail
+
+// Returns a human-readable name for type T, derived from the signature of this
+// function as reported by the compiler. Does not require RTTI.
+template <typename T>
+const char* TypeName() {
+#if defined(__clang__) || defined(__GNUC__)
+  static const std::string name =
+      detail::ParseTypeName(__PRETTY_FUNCTION__, "T = ", "]");
+#elif defined(_MSC_VER)
+  static const std::string name =
+      detail::ParseTypeName(__FUNCSIG__, "TypeName<", ">(");
+#else
+  static const std::string name = "unknown";
+#endif
+  return name.c_str();
+}
+
+// Describes the entry to or exit from the encoding of a value.
+struct EncodingEvent {
+  // Name of the type being encoded, as returned by TypeName<T>().
+  const char* type_name;
+
+  // Nesting depth of the value, where top-level values have depth zero.
+  std::size_t depth;
+
+  // Number of bytes written or read by the encoding of the value, including
+  // nested values. Always zero on entry.
+  std::size_t bytes;
+
+  // Whether the encoding succeeded. Always true on entry.
+  bool ok;
+
+  // Size of the value estimated by Encoding<T>::Size(), when writing for a
+  // profiler that requests estimates; see ProfilerEstimatesSizes. Zero
+  // otherwise.
+  std::size_t estimate;
+};
+
+// Trait that determines whether ProfilingWriter computes the estimated size of
+// every value for a profiler. Profilers opt in by defining:
+//
+//   static constexpr bool kEstimateSizes = true;
+//
+// Estimating the size of each value repeats the size computation at every level
+// of nesting, so profilers that only measure time should not opt in.
+template <typename Profiler, typename Enabled = void>
+struct ProfilerEstimatesSizes : std::false_type {};
+template <typename Profiler>
+struct ProfilerEstimatesSizes<Profiler,
+                              Void<decltype(Profiler::kEstimateSizes)>>
+    : std::integral_constant<bool, Profiler::kEstimateSizes> {};
+
+// ProfilingWriter is a writer type that wraps another writer pointer and
+// reports the entry to and exit from the encoding of every value, top-level
+// and nested, to a Profiler with the following interface:
+//
+//   void Enter(const EncodingEvent& event);
+//   void Exit(const EncodingEvent& event);
+//
+// All other operations are passed to the underlying writer. Profiling has no
+// cost for writers other than ProfilingWriter: the hooks are selected at
+// compile time by the kProfileEncodings option. See EncodingProfile for a
+// profiler that aggregates the cost of serialization by type, and
+// SizeEstimateProfile for one that compares estimated and actual sizes.
+//
+// Example:
+//
+//   EncodingProfile<> profile;
+//   ProfilingWriter<VectorWriter, EncodingProfile<>> profiling_writer{
+//       &vector_writer, &profile};
+//   Serializer<decltype(profiling_writer)*> serializer{&profiling_writer};
+//   auto status = serializer.Write(message);
+//   ...
+//   profile.WriteFolded(&std::cout);
+//
+template <typename Writer, typename Profiler>
+class ProfilingWriter {
+ public:
+  ProfilingWriter() = default;
+  ProfilingWriter(Writer* writer, Profiler* profiler)
+      : writer_{writer}, profiler_{profiler} {}
+
+  ProfilingWriter(const ProfilingWriter&) = delete;
+  void operator=(const ProfilingWriter&) = delete;
+
+  static constexpr bool kNeedsPrepare = WriterNeedsPrepare<Writer>::value;
+  static constexpr bool kProfileEncodings = true;
+
+  template <typename T>
+  void EnterEncoding(const T& value) {
+    const std::size_t estimate =
+        Estimate(value, ProfilerEstimatesSizes<Profiler>{});
+    profiler_->Enter({TypeName<T>(), starts_.size(), 0, true, estimate});
+    starts_.push_back({bytes_, estimate});
+  }
+
+  template <typename T>
+  void ExitEncoding(const Status<void>& status) {
+    const Start start = starts_.back();
+    starts_.pop_back();
+    profiler_->Exit({TypeName<T>(), starts_.size(), bytes_ - start.bytes,
+                     static_cast<bool>(status), start.estimate});
+  }
+
+  Status<void> Prepare(std::size_t size) { return writer_->Prepare(size); }
+
+  Status<void> Write(std::uint8_t byte) {
+    bytes_ += 1;
+    return writer_->Write(byte);
+  }
+
+  template <typename T, typename Enable = EnableIfArithmetic<T>>
+  Status<void> Write(const T* begin, const T* end) {
+    bytes_ += (end - begin) * sizeof(T);
+    return writer_->Write(begin, end);
+  }
+
+  Status<void> Skip(std::size_t padding_bytes,
+                    std::uint8_t padding_value = 0x00) {
+    bytes_ += padding_bytes;
+    return writer_->Skip(padding_bytes, padding_value);
+  }
+
+  // Preserve the canonical mode of the underlying writer.
+  static constexpr bool kCanonical = WriterIsCanonical<Writer>::value;
+
+  static constexpr bool kExactTableEntries =
+      WriterExactTableEntries<Writer>::value;
+
+  std::size_t offset() const { return writer_->offset(); }
+
+  Status<void> Patch(std::size_t offset, const std::uint8_t* begin,
+                     const std::uint8_t* end) {
+    return writer_->Patch(offset, begin, end);
+  }
+
+  template <typename HandleType>
+  Status<HandleReference> PushHandle(const HandleType& handle) {
+    return writer_->PushHandle(handle);
+  }
+
+  template <typename W = Writer, typename Enabled = WriterInternStringTest<W>>
+  Status<StringReference> InternString(StringView string) {
+    return writer_->InternString(string);
+  }
+
+  template <typename T, typename W = Writer,
+            typename Enabled = WriterInternPointerTest<W>>
+  Status<PointerReference> InternPointer(const std::shared_ptr<T>& pointer,
+                                         PointerType type) {
+    return writer_->InternPointer(pointer, type);
+  }
+
+  const Writer* writer() const { return writer_; }
+  Writer* writer() { return writer_; }
+
+ private:
+  struct Start {
+    std::size_t bytes;
+    std::size_t estimate;
+  };
+
+  template <typename T>
+  static std::size_t Estimate(const T& value, std::true_type) {
+    return Encoding<T>::Size(value);
+  }
+  template <typename T>
+  static std::size_t Estimate(const T& /*value*/, std::false_type) {
+    return 0;
+  }
+
+  Writer* writer_{nullptr};
+  Profiler* profiler_{nullptr};
+  std::size_t bytes_{0};
+  std::vector<Start> starts_;
+};
+
+// ProfilingReader is the reader counterpart of ProfilingWriter.
+template <typename Reader, typename Profiler>
+class ProfilingReader {
+ public:
+  ProfilingReader() = default;
+  ProfilingReader(Reader* reader, Profiler* profiler)
+      : reader_{reader}, profiler_{profiler} {}
+
+  ProfilingReader(const ProfilingReader&) = delete;
+  void operator=(const ProfilingReader&) = delete;
+
+  static constexpr bool kProfileEncodings = true;
+
+  template <typename T>
+  void EnterEncoding() {
+    profiler_->Enter({TypeName<T>(), starts_.size(), 0, true, 0});
+    starts_.push_back(bytes_);
+  }
+
+  template <typename T>
+  void ExitEncoding(const Status<void>& status) {
+    const std::size_t start = starts_.back();
+    starts_.pop_back();
+    profiler_->Exit({TypeName<T>(), starts_.size(), bytes_ - start,
+                     static_cast<bool>(status), 0});
+  }
+
+  Status<void> Ensure(std::size_t size) { return reader_->Ensure(size); }
+
+  Status<void> Read(std::uint8_t* byte) {
+    bytes_ += 1;
+    return reader_->Read(byte);
+  }
+
+  template <typename T, typename Enable = EnableIfArithmetic<T>>
+  Status<void> Read(T* begin, T* end) {
+    bytes_ += (end - begin) * sizeof(T);
+    return reader_->Read(begin, end);
+  }
+
+  Status<void> Skip(std::size_t padding_bytes) {
+    bytes_ += padding_bytes;
+    return reader_->Skip(padding_bytes);
+  }
+
+  // Only available when the underlying reader supports borrowing.
+  template <typename R = Reader, typename Enabled = ReaderBorrowTest<R>>
+  Status<void> Borrow(std::size_t size, const void** data) {
+    bytes_ += size;
+    return reader_->Borrow(size, data);
+  }
+
+  static constexpr bool kReuseStorage = ReaderReusesStorage<Reader>::value;
+  static constexpr bool kBorrowToCopy = ReaderBorrowsToCopy<Reader>::value;
+
+  template <typename HandleType>
+  Status<HandleType> GetHandle(HandleReference handle_reference) {
+    return reader_->template GetHandle<HandleType>(handle_reference);
+  }
+
+  template <typename R = Reader, typename Enabled = ReaderDefineStringTest<R>>
+  Status<void> DefineString(StringView string) {
+    return reader_->DefineString(string);
+  }
+
+  template <typename R = Reader, typename Enabled = ReaderGetStringTest<R>>
+  Status<StringView> GetString(StringReference reference) {
+    return reader_->GetString(reference);
+  }
+
+  template <typename R = Reader, typename Enabled = ReaderDefinePointerTest<R>>
+  Status<void> DefinePointer(std::shared_ptr<void> pointer, PointerType type) {
+    return reader_->DefinePointer(std::move(pointer), type);
+  }
+
+  template <typename R = Reader, typename Enabled = ReaderGetPointerTest<R>>
+  Status<std::shared_ptr<void>> GetPointer(PointerReference reference,
+                                           PointerType type) {
+    return reader_->GetPointer(reference, type);
+  }
+
+  const Reader* reader() const { return reader_; }
+  Reader* reader() { return reader_; }
+
+ private:
+  Reader* reader_{nullptr};
+  Profiler* profiler_{nullptr};
+  std::size_t bytes_{0};
+  std::vector<std::size_t> starts_;
+};
+
+// EncodingProfile is a profiler for ProfilingWriter and ProfilingReader that
+// aggregates the number of values, bytes and time per stack of nested types,
+// such as "Message;std::vector<Item>;Item". The stacks can be written in the
+// folded format accepted by flame graph tools.
+//
+// Time is measured with Clock; see io_stats.h.
+template <typename Clock = SteadyClock>
+class EncodingProfile {
+ public:
+  struct Entry {
+    // Number of values encoded with this stack.
+    std::uint64_t count{0};
+    // Number of those that failed.
+    std::uint64_t errors{0};
+    // Bytes of the values, including nested values.
+    std::uint64_t bytes{0};
+    // Time spent in the values, including nested values.
+    std::uint64_t ticks{0};
+    // Time spent in the values, excluding nested values.
+    std::uint64_t self_ticks{0};
+  };
+
+  void Enter(const EncodingEvent& event) {
+    Frame frame;
+    frame.path_length = path_.size();
+    if (!path_.empty())
+      path_ += ';';
+    path_ += event.type_name;
+    frames_.push_back(frame);
+    frames_.back().start = Clock::Now();
+  }
+
+  void Exit(const EncodingEvent& event) {
+    const std::uint64_t end = Clock::Now();
+    const Frame frame = frames_.back();
+    frames_.pop_back();
+
+    const std::uint64_t ticks = end - frame.start;
+    Entry& entry = entries_[path_];
+    entry.count++;
+    entry.errors += event.ok ? 0 : 1;
+    entry.bytes += event.bytes;
+    entry.ticks += ticks;
+    entry.self_ticks += ticks - frame.child_ticks;
+
+    if (!frames_.empty())
+      frames_.back().child_ticks += ticks;
+    path_.resize(frame.path_length);
+  }
+
+  const std::map<std::string, Entry>& entries() const { return entries_; }
+
+  void Clear() {
+    entries_.clear();
+    frames_.clear();
+    path_.clear();
+  }
+
+  // Writes one line per stack with the self time, in the folded stack format:
+  //
+  //   Message;std::vector<Item>;Item 1234
+  //
+  void WriteFolded(std::ostream* stream) const {
+    for (const auto& entry : entries_)
+      *stream << entry.first << ' ' << entry.second.self_ticks << '\n';
+  }
+
+ private:
+  struct Frame {
+    std::size_t path_length{0};
+    std::uint64_t start{0};
+    std::uint64_t child_ticks{0};
+  };
+
+  std::map<std::string, Entry> entries_;
+  std::vector<Frame> frames_;
+  std::string path_;
+};
+
+// SizeEstimateProfile is a profiler for ProfilingWriter that compares the size
+// of each value estimated by Encoding<T>::Size() with the number of bytes
+// actually written, aggregated by type across any number of writes. Estimates
+// above the actual size over-reserve the buffers prepared for a message, and
+// pad the table entries that contain them unless the writer uses
+// ExactTableEntries; estimates below the actual size indicate a broken
+// encoding. Values count toward the types of all of the values enclosing them.
+//
+// Example:
+//
+//   SizeEstimateProfile profile;
+//   ProfilingWriter<VectorWriter, SizeEstimateProfile> profiling_writer{
+//       &vector_writer, &profile};
+//   Serializer<decltype(profiling_writer)*> serializer{&profiling_writer};
+//   for (const auto& message : workload)
+//     serializer.Write(message);
+//   profile.WriteReport(&std::cout);
+//
+class SizeEstimateProfile {
+ public:
+  struct Entry {
+    // Number of values of this type written successfully.
+    std::uint64_t count{0};
+    // Sum of the estimated sizes of the values.
+    std::uint64_t estimated{0};
+    // Sum of the bytes actually written for the values.
+    std::uint64_t actual{0};
+    // Number of values for which the estimate exceeded the actual size.
+    std::uint64_t overestimates{0};
+    // Number of values for which the actual size exceeded the estimate.
+    std::uint64_t underestimates{0};
+
+    // Returns the number of bytes by which the estimates exceeded the actual
+    // sizes.
+    std::uint64_t waste() const {
+      return estimated > actual ? estimated - actual : 0;
+    }
+  };
+
+  static constexpr bool kEstimateSizes = true;
+
+  void Enter(const EncodingEvent& /*event*/) {}
+
+  void Exit(const EncodingEvent& event) {
+    if (!event.ok)
+      return;
+
+    Entry& entry = entries_[event.type_name];
+    entry.count++;
+    entry.estimated += event.estimate;
+    entry.actual += event.bytes;
+    entry.overestimates += event.estimate > event.bytes ? 1 : 0;
+    entry.underestimates += event.estimate < event.bytes ? 1 : 0;
+  }
+
+  const std::map<std::string, Entry>& entries() const { return entries_; }
+
+  void Clear() { entries_.clear(); }
+
+  // Writes one line per type that was overestimated or underestimated, in
+  // order of decreasing waste:
+  //
+  //   nop::Handle<FileHandlePolicy> count=10 estimated=110 actual=30 waste=80
+  //
+  void WriteReport(std::ostream* stream) const {
+    std::vector<const std::pair<const std::string, Entry>*> sorted;
+    for (const auto& entry : entries_) {
+      if (entry.second.overestimates || entry.second.underestimates)
+        sorted.push_back(&entry);
+    }
+    std::stable_sort(sorted.begin(), sorted.end(),
+                     [](const auto* a, const auto* b) {
+                       return a->second.waste() > b->second.waste();
+                     });
+
+    for (const auto* entry : sorted) {
+      *stream << entry->first << " count=" << entry->second.count
+              << " estimated=" << entry->second.estimated
+              << " actual=" << entry->second.actual
+              << " waste=" << entry->second.waste();
+      if (entry->second.underestimates)
+        *stream << " underestimates=" << entry->second.underestimates;
+      *stream << '\n';
+    }
+  }
+
+ private:
+  std::map<std::string, Entry> entries_;
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_PROFILING_H_
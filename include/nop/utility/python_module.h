@@ -0,0 +1,283 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_PYTHON_MODULE_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_PYTHON_MODULE_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <nop/base/macros.h>
+#include <nop/structure.h>
+#include <nop/traits/is_detected.h>
+#include <nop/types/binary.h>
+#include <nop/types/optional.h>
+#include <nop/utility/wire_view.h>
+
+namespace nop {
+
+//
+// Support for decoding libnop messages from Python in place, without copying
+// them into ctypes structures. A shared library exports a schema of its
+// structures and a C function that describes an encoded value at a given
+// address; the python/nop_view.py module uses both to present a buffer as
+// lazily decoded objects whose numeric vectors are NumPy arrays or
+// memoryviews pointing into the buffer.
+//
+// Structures are exported by naming their members with NOP_PYTHON_STRUCTURE,
+// at namespace scope after the type is annotated, and the shared library
+// defines its exported functions with NOP_PYTHON_MODULE, from one source file.
+// The members must be public, since their names are checked against the
+// annotation of the type.
+//
+// Example:
+//
+//   struct Sample {
+//     std::uint64_t timestamp;
+//     std::vector<float> values;
+//     NOP_STRUCTURE(Sample, timestamp, values);
+//   };
+//   NOP_PYTHON_STRUCTURE(Sample, timestamp, values);
+//
+//   NOP_PYTHON_MODULE(Sample);
+//
+// And in Python:
+//
+//   module = nop_view.Module('./libsamples.so')
+//   sample = module.view('Sample', data)
+//   sample.values.mean()
+//
+
+// The member names of a structure, returned by the function defined by
+// NOP_PYTHON_STRUCTURE.
+struct PythonStructure {
+  const char* name;
+  const char* const* members;
+  std::size_t count;
+};
+
+// C compatible description of an encoded value, filled in by the function
+// nop_python_inspect() defined by NOP_PYTHON_MODULE. See WireValue.
+struct PythonWireValue {
+  std::uint64_t count;
+  std::uint64_t header;
+  std::uint64_t size;
+  std::uint64_t stride;
+  std::int64_t integer;
+  std::uint64_t unsigned_integer;
+  double real;
+  std::uint8_t prefix;
+  std::uint8_t kind;
+};
+
+namespace detail {
+
+template <typename T>
+using PythonStructureTest =
+    decltype(NOP__GetPythonStructure(static_cast<T*>(nullptr)));
+
+template <typename T>
+using HasPythonStructure = IsDetected<PythonStructureTest, T>;
+
+// Appends the Python literal describing type T to a schema. Types without a
+// more specific description are decoded generically.
+template <typename T, typename Enabled = void>
+struct PythonType {
+  static void Describe(std::string* schema) { *schema += "'any'"; }
+};
+
+template <>
+struct PythonType<bool> {
+  static void Describe(std::string* schema) { *schema += "'bool'"; }
+};
+
+template <typename T>
+struct PythonType<T, std::enable_if_t<std::is_integral<T>::value &&
+                                      !std::is_same<T, bool>::value>> {
+  static void Describe(std::string* schema) {
+    *schema += std::is_signed<T>::value ? "'i" : "'u";
+    *schema += std::to_string(sizeof(T));
+    *schema += "'";
+  }
+};
+
+template <typename T>
+struct PythonType<T, std::enable_if_t<std::is_floating_point<T>::value>> {
+  static void Describe(std::string* schema) {
+    *schema += "'f";
+    *schema += std::to_string(sizeof(T));
+    *schema += "'";
+  }
+};
+
+template <typename T>
+struct PythonType<T, std::enable_if_t<std::is_enum<T>::value>>
+    : PythonType<std::underlying_type_t<T>> {};
+
+template <typename Traits, typename Allocator>
+struct PythonType<std::basic_string<char, Traits, Allocator>> {
+  static void Describe(std::string* schema) { *schema += "'str'"; }
+};
+
+template <typename T>
+struct PythonType<T, std::enable_if_t<HasPythonStructure<T>::value>> {
+  static void Describe(std::string* schema) {
+    *schema += "'";
+    *schema += NOP__GetPythonStructure(static_cast<T*>(nullptr)).name;
+    *schema += "'";
+  }
+};
+
+template <typename T>
+struct PythonType<Optional<T>> {
+  static void Describe(std::string* schema) {
+    *schema += "('optional', ";
+    PythonType<T>::Describe(schema);
+    *schema += ")";
+  }
+};
+
+// Sequences of integral and floating point values are presented as arrays;
+// other sequences as lists.
+template <typename T>
+struct PythonSequence {
+  static void Describe(std::string* schema) {
+    using Element = std::remove_cv_t<T>;
+    const bool numeric = (std::is_arithmetic<Element>::value ||
+                          std::is_enum<Element>::value) &&
+                         !std::is_same<Element, bool>::value;
+    *schema += numeric ? "('array', " : "('list', ";
+    PythonType<Element>::Describe(schema);
+    *schema += ")";
+  }
+};
+
+template <typename T, typename Allocator>
+struct PythonType<std::vector<T, Allocator>,
+                  std::enable_if_t<!std::is_same<T, bool>::value>>
+    : PythonSequence<T> {};
+
+template <typename T, std::size_t Length>
+struct PythonType<std::array<T, Length>> : PythonSequence<T> {};
+
+template <typename T, std::size_t Length>
+struct PythonType<T[Length]> : PythonSequence<T> {};
+
+template <typename Container>
+struct PythonType<Binary<Container>>
+    : PythonSequence<typename Container::value_type> {};
+
+template <typename MemberList, std::size_t... Is>
+void DescribePythonMembers(const PythonStructure& structure,
+                           std::string* schema, std::index_sequence<Is...>) {
+  (void)std::initializer_list<int>{
+      (*schema += "('", *schema += structure.members[Is], *schema += "', ",
+       PythonType<typename MemberList::template At<Is>::Type>::Describe(schema),
+       *schema += "), ", 0)...};
+}
+
+template <typename T>
+void DescribePythonStructure(std::string* schema) {
+  static_assert(HasPythonStructure<T>::value,
+                "Exported types must be named with NOP_PYTHON_STRUCTURE.");
+  using MemberList = typename MemberListTraits<T>::MemberList;
+
+  const PythonStructure structure =
+      NOP__GetPythonStructure(static_cast<T*>(nullptr));
+  *schema += "'";
+  *schema += structure.name;
+  *schema += "': (";
+  DescribePythonMembers<MemberList>(
+      structure, schema, std::make_index_sequence<MemberList::Count>{});
+  *schema += "), ";
+}
+
+}  // namespace detail
+
+// Returns the schema of the structures Types as a Python dictionary literal,
+// mapping each structure name to a tuple of (member name, type) pairs.
+template <typename... Types>
+std::string PythonSchema() {
+  std::string schema = "{";
+  (void)std::initializer_list<int>{
+      (detail::DescribePythonStructure<Types>(&schema), 0)...};
+  schema += "}";
+  return schema;
+}
+
+// Fills |value| with the description of the encoded value at the start of the
+// |size| bytes at |data|. Returns zero or the negated ErrorStatus.
+inline int InspectPythonValue(const void* data, std::size_t size,
+                              PythonWireValue* value) {
+  auto status = InspectValue(data, size);
+  if (!status)
+    return -static_cast<int>(status.error());
+
+  const WireValue& wire = status.get();
+  value->count = wire.count;
+  value->header = wire.header;
+  value->size = wire.size;
+  value->stride = wire.stride;
+  value->integer = wire.integer;
+  value->unsigned_integer = wire.unsigned_integer;
+  value->real = wire.real;
+  value->prefix = static_cast<std::uint8_t>(wire.prefix);
+  value->kind = static_cast<std::uint8_t>(wire.kind);
+  return 0;
+}
+
+}  // namespace nop
+
+// Names the members of |type| for export to Python. The members must be
+// listed in the same order as in the NOP_STRUCTURE or NOP_EXTERNAL_STRUCTURE
+// annotation of the type. Must be invoked at namespace scope, in the namespace
+// of the type.
+#define NOP_PYTHON_STRUCTURE(type, ... /*members*/)                        \
+  inline ::nop::PythonStructure NOP__GetPythonStructure [[gnu::used]] (    \
+      type*) {                                                             \
+    using Members = ::nop::MemberList<_NOP_MEMBER_LIST(type, __VA_ARGS__)>; \
+    static_assert(                                                         \
+        std::is_same<Members,                                              \
+                     ::nop::MemberListTraits<type>::MemberList>::value,    \
+        "Python member names must match the members of the structure.");   \
+    static const char* const kMembers[] = {                                \
+        NOP_MAP(_NOP_PYTHON_MEMBER_NAME, __VA_ARGS__)};                    \
+    return {#type, kMembers, sizeof(kMembers) / sizeof(kMembers[0])};      \
+  }
+
+// Defines the C functions used by python/nop_view.py to load the schema of the
+// structures |types| and to inspect encoded values. Must be invoked once, at
+// global scope, in the shared library.
+#define NOP_PYTHON_MODULE(... /*types*/)                                     \
+  extern "C" [[gnu::visibility("default")]] const char* nop_python_schema() { \
+    static const std::string schema = ::nop::PythonSchema<__VA_ARGS__>();    \
+    return schema.c_str();                                                   \
+  }                                                                          \
+  extern "C" [[gnu::visibility("default")]] int nop_python_inspect(          \
+      const void* data, std::size_t size, ::nop::PythonWireValue* value) {   \
+    return ::nop::InspectPythonValue(data, size, value);                     \
+  }
+
+// Returns the name of a member, or of the first member of a logical buffer
+// pair.
+#define _NOP_PYTHON_MEMBER_NAME(...) _NOP_PYTHON_FIRST_NAME(__VA_ARGS__)
+#define _NOP_PYTHON_FIRST_NAME(member, ...) #member
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_PYTHON_MODULE_H_
@@ -0,0 +1,473 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_RECORD_LOG_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_RECORD_LOG_H_
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <utility>
+
+#include <nop/base/serializer.h>
+#include <nop/status.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/endian.h>
+#include <nop/utility/frame_writer.h>
+#include <nop/utility/pedantic_buffer_reader.h>
+#include <nop/utility/vector_writer.h>
+
+namespace nop {
+
+//
+// Record log format:
+//
+// The log file is a sequence of length-prefixed frames, in the format written
+// by FrameWriter, each holding one serialized record:
+//
+// +-----------+---//----+-----------+---//----+
+// | U32LE: L0 | L0 BYTES | U32LE: L1 | L1 BYTES | ...
+// +-----------+---//----+-----------+---//----+
+//
+// The sidecar index file, named by appending ".idx" to the path of the log,
+// holds one fixed-size entry per record with the offset of its frame in the
+// log and a caller-defined key:
+//
+// +--------------+-----------+
+// | U64LE:OFFSET | U64LE:KEY | ...
+// +--------------+-----------+
+//
+// Records are appended to the log before their index entries, so a crash may
+// leave a torn frame at the end of the log or a torn entry at the end of the
+// index. Opening the log for writing truncates both files back to the last
+// record that is complete in both.
+//
+
+namespace detail {
+
+enum : std::size_t { kRecordIndexEntrySize = 2 * sizeof(std::uint64_t) };
+
+inline std::string RecordIndexPath(const std::string& path) {
+  return path + ".idx";
+}
+
+// Writes all of |size| bytes at |data| to |fd|.
+inline Status<void> WriteFully(int fd, const void* data, std::size_t size) {
+  const std::uint8_t* bytes = static_cast<const std::uint8_t*>(data);
+  while (size > 0) {
+    const ssize_t ret = ::write(fd, bytes, size);
+    if (ret < 0) {
+      if (errno == EINTR)
+        continue;
+      return ErrorStatus::IOError;
+    } else if (ret == 0) {
+      return ErrorStatus::WriteLimitReached;
+    }
+
+    bytes += ret;
+    size -= ret;
+  }
+  return {};
+}
+
+// A read-only mapping of a whole file.
+class MappedFile {
+ public:
+  MappedFile() = default;
+  MappedFile(const MappedFile&) = delete;
+  MappedFile(MappedFile&& other) { *this = std::move(other); }
+  ~MappedFile() { Clear(); }
+
+  MappedFile& operator=(const MappedFile&) = delete;
+  MappedFile& operator=(MappedFile&& other) {
+    if (this != &other) {
+      Clear();
+      std::swap(data_, other.data_);
+      std::swap(size_, other.size_);
+    }
+    return *this;
+  }
+
+  static Status<MappedFile> Open(const std::string& path) {
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+      return ErrorStatus::IOError;
+
+    struct stat stat_buf;
+    MappedFile file;
+    if (::fstat(fd, &stat_buf) < 0) {
+      ::close(fd);
+      return ErrorStatus::IOError;
+    }
+
+    file.size_ = static_cast<std::size_t>(stat_buf.st_size);
+    if (file.size_ > 0) {
+      void* address =
+          ::mmap(nullptr, file.size_, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (address == MAP_FAILED) {
+        ::close(fd);
+        return ErrorStatus::IOError;
+      }
+      file.data_ = static_cast<const std::uint8_t*>(address);
+    }
+
+    ::close(fd);
+    return {std::move(file)};
+  }
+
+  void Clear() {
+    if (data_)
+      ::munmap(const_cast<std::uint8_t*>(data_), size_);
+    data_ = nullptr;
+    size_ = 0;
+  }
+
+  const std::uint8_t* data() const { return data_; }
+  std::size_t size() const { return size_; }
+
+ private:
+  const std::uint8_t* data_{nullptr};
+  std::size_t size_{0};
+};
+
+inline std::uint64_t LoadU64(const std::uint8_t* bytes) {
+  std::uint64_t value;
+  std::memcpy(&value, bytes, sizeof(value));
+  return HostEndian<std::uint64_t>::FromLittle(value);
+}
+
+inline std::uint32_t LoadU32(const std::uint8_t* bytes) {
+  std::uint32_t value;
+  std::memcpy(&value, bytes, sizeof(value));
+  return HostEndian<std::uint32_t>::FromLittle(value);
+}
+
+}  // namespace detail
+
+// RecordLogWriter appends serialized records to a record log and maintains
+// its offset index. Each record may carry a 64-bit key, such as a sequence
+// number or timestamp, which RecordLogReader::Find() searches when the keys
+// are non-decreasing.
+//
+// Example:
+//
+//   auto log = RecordLogWriter::Open("/var/log/events");
+//   if (!log)
+//     return log.error();
+//
+//   auto index = log.get().Append(event, event.sequence);
+//
+class RecordLogWriter {
+ public:
+  RecordLogWriter() = default;
+  RecordLogWriter(const RecordLogWriter&) = delete;
+  RecordLogWriter(RecordLogWriter&& other) { *this = std::move(other); }
+  ~RecordLogWriter() { Clear(); }
+
+  RecordLogWriter& operator=(const RecordLogWriter&) = delete;
+  RecordLogWriter& operator=(RecordLogWriter&& other) {
+    if (this != &other) {
+      Clear();
+      std::swap(log_fd_, other.log_fd_);
+      std::swap(index_fd_, other.index_fd_);
+      std::swap(log_size_, other.log_size_);
+      std::swap(count_, other.count_);
+      std::swap(buffer_, other.buffer_);
+    }
+    return *this;
+  }
+
+  // Opens the log at |path| for appending, creating the log and its index if
+  // necessary, and recovers from a torn final record. Returns
+  // ErrorStatus::IOError if the files cannot be opened and
+  // ErrorStatus::ProtocolError if the index does not match the log.
+  static Status<RecordLogWriter> Open(const std::string& path,
+                                      mode_t mode = 0644) {
+    RecordLogWriter writer;
+    writer.log_fd_ =
+        ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, mode);
+    writer.index_fd_ = ::open(detail::RecordIndexPath(path).c_str(),
+                              O_RDWR | O_CREAT | O_CLOEXEC, mode);
+    if (writer.log_fd_ < 0 || writer.index_fd_ < 0)
+      return ErrorStatus::IOError;
+
+    auto status = writer.Recover();
+    if (!status)
+      return status.error();
+
+    return {std::move(writer)};
+  }
+
+  // Serializes |value| and appends it to the log with |key|. Returns the
+  // number of the record.
+  template <typename T>
+  Status<std::uint64_t> Append(const T& value, std::uint64_t key = 0) {
+    detail::BeginFrame(&buffer_);
+    auto status = SerializerCommon::Write(value, &buffer_);
+    if (status)
+      status = detail::EndFrame(&buffer_);
+    if (!status)
+      return status.error();
+
+    return AppendFrame(buffer_.data(), buffer_.size(), key);
+  }
+
+  // Flushes the log and the index to stable storage.
+  Status<void> Sync() {
+    if (::fdatasync(log_fd_) < 0 || ::fdatasync(index_fd_) < 0)
+      return ErrorStatus::IOError;
+    return {};
+  }
+
+  void Clear() {
+    if (log_fd_ >= 0)
+      ::close(log_fd_);
+    if (index_fd_ >= 0)
+      ::close(index_fd_);
+    log_fd_ = index_fd_ = -1;
+    log_size_ = count_ = 0;
+  }
+
+  // Returns the number of records in the log.
+  std::uint64_t size() const { return count_; }
+
+ private:
+  Status<std::uint64_t> AppendFrame(const std::uint8_t* frame,
+                                    std::size_t size, std::uint64_t key) {
+    std::uint64_t entry[2] = {HostEndian<std::uint64_t>::ToLittle(log_size_),
+                              HostEndian<std::uint64_t>::ToLittle(key)};
+
+    auto status = detail::WriteFully(log_fd_, frame, size);
+    if (status)
+      status = detail::WriteFully(index_fd_, entry, sizeof(entry));
+    if (!status) {
+      // Drop the partial record so that the next append starts cleanly.
+      Truncate();
+      return status.error();
+    }
+
+    log_size_ += size;
+    return count_++;
+  }
+
+  // Truncates the files to the records accounted for and positions them for
+  // appending.
+  Status<void> Truncate() {
+    if (::ftruncate(log_fd_, log_size_) < 0 ||
+        ::ftruncate(index_fd_, count_ * detail::kRecordIndexEntrySize) < 0 ||
+        ::lseek(log_fd_, 0, SEEK_END) < 0 ||
+        ::lseek(index_fd_, 0, SEEK_END) < 0) {
+      return ErrorStatus::IOError;
+    }
+    return {};
+  }
+
+  Status<void> Recover() {
+    struct stat log_stat;
+    struct stat index_stat;
+    if (::fstat(log_fd_, &log_stat) < 0 || ::fstat(index_fd_, &index_stat) < 0)
+      return ErrorStatus::IOError;
+
+    const std::uint64_t actual_log_size = log_stat.st_size;
+    std::uint64_t entries = index_stat.st_size / detail::kRecordIndexEntrySize;
+
+    // Drop index entries whose records are not complete in the log, starting
+    // from the end.
+    while (entries > 0) {
+      std::uint8_t entry[detail::kRecordIndexEntrySize];
+      const off_t position = (entries - 1) * detail::kRecordIndexEntrySize;
+      if (::pread(index_fd_, entry, sizeof(entry), position) !=
+          static_cast<ssize_t>(sizeof(entry))) {
+        return ErrorStatus::IOError;
+      }
+
+      const std::uint64_t offset = detail::LoadU64(entry);
+      std::uint8_t header[kFrameHeaderSize];
+      if (offset + kFrameHeaderSize <= actual_log_size) {
+        if (::pread(log_fd_, header, sizeof(header), offset) !=
+            static_cast<ssize_t>(sizeof(header))) {
+          return ErrorStatus::IOError;
+        }
+
+        const std::uint64_t end =
+            offset + kFrameHeaderSize + detail::LoadU32(header);
+        if (end <= actual_log_size) {
+          log_size_ = end;
+          break;
+        }
+      } else if (offset > actual_log_size) {
+        return ErrorStatus::ProtocolError;
+      }
+      entries--;
+    }
+
+    count_ = entries;
+    return Truncate();
+  }
+
+  int log_fd_{-1};
+  int index_fd_{-1};
+  std::uint64_t log_size_{0};
+  std::uint64_t count_{0};
+  VectorWriter buffer_;
+};
+
+// RecordLogReader maps a record log and its index into memory and provides
+// random access to the records: finding record N takes one index lookup, and
+// records are decoded directly from the mapping. Records appended after the
+// reader is opened are not visible to it.
+//
+// Because the files are usually untrusted input from disk, every access to
+// the mapping is bounds-checked, and Read() decodes with PedanticBufferReader.
+//
+// Example:
+//
+//   auto log = RecordLogReader::Open("/var/log/events");
+//   if (!log)
+//     return log.error();
+//
+//   // Replay from a checkpoint.
+//   auto start = log.get().Find(checkpoint_sequence);
+//   for (std::size_t i = start.get(); i < log.get().size(); i++) {
+//     Event event;
+//     auto status = log.get().Read(i, &event);
+//     ...
+//   }
+//
+class RecordLogReader {
+ public:
+  RecordLogReader() = default;
+  RecordLogReader(RecordLogReader&&) = default;
+  RecordLogReader& operator=(RecordLogReader&&) = default;
+
+  // Maps the log at |path| and its index. Returns ErrorStatus::IOError if the
+  // files cannot be opened or mapped.
+  static Status<RecordLogReader> Open(const std::string& path) {
+    auto log = detail::MappedFile::Open(path);
+    if (!log)
+      return log.error();
+
+    auto index = detail::MappedFile::Open(detail::RecordIndexPath(path));
+    if (!index)
+      return index.error();
+
+    RecordLogReader reader;
+    reader.log_ = log.take();
+    reader.index_ = index.take();
+    return {std::move(reader)};
+  }
+
+  // Returns the number of records in the index.
+  std::size_t size() const {
+    return index_.size() / detail::kRecordIndexEntrySize;
+  }
+
+  // Returns the key of record |index|, which must be less than size().
+  std::uint64_t key(std::size_t index) const {
+    return detail::LoadU64(Entry(index) + sizeof(std::uint64_t));
+  }
+
+  // Returns the index of the first record with a key not less than |key|, or
+  // size() if there is none. The keys must be non-decreasing.
+  std::size_t Find(std::uint64_t key) const {
+    std::size_t first = 0;
+    std::size_t count = size();
+    while (count > 0) {
+      const std::size_t step = count / 2;
+      if (this->key(first + step) < key) {
+        first += step + 1;
+        count -= step + 1;
+      } else {
+        count = step;
+      }
+    }
+    return first;
+  }
+
+  // Returns a reader over the payload of record |index|, valid for the
+  // lifetime of this reader. BufferReader only checks bounds in Ensure(), so
+  // use it to decode trusted records. Returns ErrorStatus::ReadLimitReached if
+  // |index| is out of range and ErrorStatus::ProtocolError if the record
+  // extends beyond the end of the log.
+  Status<BufferReader> Get(std::size_t index) const {
+    const std::uint8_t* data = nullptr;
+    std::size_t size = 0;
+    auto status = Locate(index, &data, &size);
+    if (!status)
+      return status.error();
+
+    return BufferReader{data, size};
+  }
+
+  // Decodes record |index| into |value| with bounds checks. Returns
+  // ErrorStatus::ProtocolError if the record holds more than the value.
+  template <typename T>
+  Status<void> Read(std::size_t index, T* value) const {
+    const std::uint8_t* data = nullptr;
+    std::size_t size = 0;
+    auto status = Locate(index, &data, &size);
+    if (!status)
+      return status;
+
+    PedanticBufferReader reader{data, size};
+    status = Deserializer<PedanticBufferReader*>{&reader}.Read(value);
+    if (!status)
+      return status;
+    else if (!reader.empty())
+      return ErrorStatus::ProtocolError;
+    else
+      return {};
+  }
+
+ private:
+  const std::uint8_t* Entry(std::size_t index) const {
+    return index_.data() + index * detail::kRecordIndexEntrySize;
+  }
+
+  Status<void> Locate(std::size_t index, const std::uint8_t** data,
+                      std::size_t* size) const {
+    if (index >= this->size())
+      return ErrorStatus::ReadLimitReached;
+
+    const std::uint64_t offset = detail::LoadU64(Entry(index));
+    if (offset > log_.size() || log_.size() - offset < kFrameHeaderSize)
+      return ErrorStatus::ProtocolError;
+
+    const std::uint64_t length = detail::LoadU32(log_.data() + offset);
+    if (log_.size() - offset - kFrameHeaderSize < length)
+      return ErrorStatus::ProtocolError;
+
+    *data = log_.data() + offset + kFrameHeaderSize;
+    *size = static_cast<std::size_t>(length);
+    return {};
+  }
+
+  detail::MappedFile log_;
+  detail::MappedFile index_;
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_RECORD_LOG_H_
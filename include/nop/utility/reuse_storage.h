@@ -0,0 +1,65 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_REUSE_STORAGE_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_REUSE_STORAGE_H_
+
+#include <type_traits>
+
+#include <nop/traits/void.h>
+
+namespace nop {
+
+// By default, deserializing a std::vector, std::map, or std::unordered_map
+// clears the container and decodes every element into a newly constructed
+// value. Readers may opt in to reusing the storage of the elements already in
+// the container by defining the following member:
+//
+//   static constexpr bool kReuseStorage = true;
+//
+// The container encodings then decode into the existing elements in place, so
+// that nested strings and vectors keep their capacity, and only construct or
+// destroy elements for the difference in size. Map entries are reused when the
+// decoded key is already present. Decoding the same shaped message repeatedly
+// into one long-lived object then reaches a steady state without allocation.
+//
+// The decoded container holds the same elements in either mode. However, since
+// elements are overwritten in place, any state of an element that is not part
+// of its encoding is retained.
+//
+// Any reader may opt in with ReuseStorage:
+//
+//   nop::Deserializer<nop::ReuseStorage<nop::BufferReader>> deserializer{
+//       data, size};
+//
+template <typename Reader, typename Enabled = void>
+struct ReaderReusesStorage : std::false_type {};
+template <typename Reader>
+struct ReaderReusesStorage<Reader, Void<decltype(Reader::kReuseStorage)>>
+    : std::integral_constant<bool, Reader::kReuseStorage> {};
+
+// Opts a reader into reusing the storage of existing container elements.
+template <typename Reader>
+class ReuseStorage : public Reader {
+ public:
+  using Reader::Reader;
+
+  static constexpr bool kReuseStorage = true;
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_REUSE_STORAGE_H_
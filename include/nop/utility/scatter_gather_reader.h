@@ -0,0 +1,172 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_SCATTER_GATHER_READER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_SCATTER_GATHER_READER_H_
+
+#include <sys/uio.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <nop/base/encoding.h>
+#include <nop/base/utility.h>
+#include <nop/utility/compiler.h>
+
+namespace nop {
+
+// ScatterGatherReader is a reader type that decodes a message received into a
+// list of discontiguous iovec segments, such as fixed-size chunks taken from a
+// pool, without first copying the segments into a single buffer.
+//
+// Reads that fit in the current segment are a single bounds comparison and
+// copy, as with BufferReader; only reads that straddle a segment boundary take
+// the slower path that walks the segments. Bounds are checked in Ensure(), and
+// reads past the end of the input fail with ErrorStatus::ReadLimitReached.
+//
+// This reader does not provide Borrow(), since a borrowed range may not be
+// contiguous, so views such as StringView and BinaryView cannot be decoded with
+// it; strings and vectors are copied as usual.
+//
+// The segments and the memory they point to must remain valid while the reader
+// is in use.
+//
+// Example:
+//
+//   iovec segments[kMaxChunks];
+//   std::size_t count = ReceiveChunks(segments, kMaxChunks);
+//
+//   Deserializer<ScatterGatherReader> deserializer{segments, count};
+//   auto status = deserializer.Read(&message);
+//
+class ScatterGatherReader {
+ public:
+  ScatterGatherReader() = default;
+  ScatterGatherReader(const ScatterGatherReader&) = default;
+  template <std::size_t Count>
+  ScatterGatherReader(const iovec (&segments)[Count])
+      : ScatterGatherReader{segments, Count} {}
+  ScatterGatherReader(const iovec* segments, std::size_t count) {
+    Reset(segments, count);
+  }
+
+  ScatterGatherReader& operator=(const ScatterGatherReader&) = default;
+
+  // Starts reading from the beginning of |count| |segments|.
+  void Reset(const iovec* segments, std::size_t count) {
+    segment_ = segments;
+    last_ = segments + count;
+    rest_ = 0;
+    for (std::size_t i = 0; i < count; i++)
+      rest_ += segments[i].iov_len;
+
+    cursor_ = end_ = nullptr;
+    Advance();
+  }
+
+  Status<void> Ensure(std::size_t size) {
+    if (size > remaining())
+      return ErrorStatus::ReadLimitReached;
+    else
+      return {};
+  }
+
+  Status<void> Read(std::uint8_t* byte) {
+    if (NOP_UNLIKELY(cursor_ == end_))
+      return ReadSlow(byte, 1);
+
+    *byte = *cursor_++;
+    return {};
+  }
+
+  template <typename T, typename Enable = EnableIfArithmetic<T>>
+  Status<void> Read(T* begin, T* end) {
+    const std::size_t element_size = sizeof(T);
+    const std::size_t length = end - begin;
+    const std::size_t length_bytes = length * element_size;
+
+    if (NOP_UNLIKELY(length_bytes > static_cast<std::size_t>(end_ - cursor_)))
+      return ReadSlow(begin, length_bytes);
+
+    std::memcpy(begin, cursor_, length_bytes);
+    cursor_ += length_bytes;
+    return {};
+  }
+
+  Status<void> Skip(std::size_t padding_bytes) {
+    if (NOP_UNLIKELY(padding_bytes > static_cast<std::size_t>(end_ - cursor_)))
+      return ReadSlow(nullptr, padding_bytes);
+
+    cursor_ += padding_bytes;
+    return {};
+  }
+
+  bool empty() const { return remaining() == 0; }
+
+  // Returns the number of bytes left in all segments.
+  std::size_t remaining() const { return (end_ - cursor_) + rest_; }
+
+ private:
+  // Makes the next non-empty segment current, removing its size from rest_.
+  void Advance() {
+    while (segment_ != last_) {
+      const iovec& segment = *segment_++;
+      if (segment.iov_len == 0)
+        continue;
+
+      cursor_ = static_cast<const std::uint8_t*>(segment.iov_base);
+      end_ = cursor_ + segment.iov_len;
+      rest_ -= segment.iov_len;
+      return;
+    }
+  }
+
+  // Copies, or skips when |data| is nullptr, |size| bytes that extend past the
+  // current segment.
+  Status<void> ReadSlow(void* data, std::size_t size) {
+    if (size > remaining())
+      return ErrorStatus::ReadLimitReached;
+
+    std::uint8_t* out = static_cast<std::uint8_t*>(data);
+    while (size > 0) {
+      if (cursor_ == end_)
+        Advance();
+
+      std::size_t chunk = end_ - cursor_;
+      if (chunk > size)
+        chunk = size;
+
+      if (out) {
+        std::memcpy(out, cursor_, chunk);
+        out += chunk;
+      }
+      cursor_ += chunk;
+      size -= chunk;
+    }
+    return {};
+  }
+
+  const iovec* segment_{nullptr};
+  const iovec* last_{nullptr};
+  const std::uint8_t* cursor_{nullptr};
+  const std::uint8_t* end_{nullptr};
+  std::size_t rest_{0};
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_SCATTER_GATHER_READER_H_
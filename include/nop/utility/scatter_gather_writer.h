@@ -0,0 +1,225 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_SCATTER_GATHER_WRITER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_SCATTER_GATHER_WRITER_H_
+
+#include <errno.h>
+#include <limits.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <nop/base/encoding.h>
+#include <nop/base/utility.h>
+
+namespace nop {
+
+// ScatterGatherWriter is a writer type that collects a message as a list of
+// iovec segments instead of copying it into a single buffer. Small writes,
+// such as prefixes, lengths, and scalar values, are copied into an internal
+// buffer. Writes of at least |threshold| bytes, which are the payloads of
+// strings and integral vectors and arrays, are recorded by reference. The
+// complete message is then transmitted with a single writev() or sendmsg()
+// call.
+//
+// Because large payloads are referenced rather than copied, the values passed
+// to the Serializer must remain alive and unmodified until the message is sent
+// or the writer is reset.
+class ScatterGatherWriter {
+ public:
+  enum : std::size_t { kDefaultThreshold = 256 };
+
+  ScatterGatherWriter() = default;
+  explicit ScatterGatherWriter(std::size_t threshold)
+      : threshold_{threshold} {}
+  ScatterGatherWriter(const ScatterGatherWriter&) = delete;
+  ScatterGatherWriter(ScatterGatherWriter&&) = default;
+
+  ScatterGatherWriter& operator=(const ScatterGatherWriter&) = delete;
+  ScatterGatherWriter& operator=(ScatterGatherWriter&&) = default;
+
+  // This writer ignores the size passed to Prepare().
+  static constexpr bool kNeedsPrepare = false;
+
+  Status<void> Prepare(std::size_t /*size*/) { return {}; }
+
+  Status<void> Write(std::uint8_t byte) {
+    ExtendInline(1);
+    buffer_.push_back(byte);
+    size_ += 1;
+    return {};
+  }
+
+  template <typename T, typename Enable = EnableIfArithmetic<T>>
+  Status<void> Write(const T* begin, const T* end) {
+    const std::uint8_t* begin_byte =
+        reinterpret_cast<const std::uint8_t*>(begin);
+    const std::size_t length_bytes = (end - begin) * sizeof(T);
+
+    if (length_bytes == 0) {
+      return {};
+    } else if (length_bytes >= threshold_) {
+      segments_.push_back({begin_byte, 0, length_bytes});
+    } else {
+      ExtendInline(length_bytes);
+      buffer_.insert(buffer_.end(), begin_byte, begin_byte + length_bytes);
+    }
+
+    size_ += length_bytes;
+    return {};
+  }
+
+  Status<void> Skip(std::size_t padding_bytes,
+                    std::uint8_t padding_value = 0x00) {
+    ExtendInline(padding_bytes);
+    buffer_.insert(buffer_.end(), padding_bytes, padding_value);
+    size_ += padding_bytes;
+    return {};
+  }
+
+  // Writes the collected segments to |fd| with as few writev() calls as
+  // possible and resets the writer.
+  Status<void> WriteTo(int fd) {
+    return Transmit([fd](const iovec* iov, int count) {
+      return ::writev(fd, iov, count);
+    });
+  }
+
+  // Sends the collected segments on the socket |fd| with as few sendmsg() calls
+  // as possible and resets the writer.
+  Status<void> SendTo(int fd, int flags = 0) {
+    return Transmit([fd, flags](iovec* iov, int count) {
+      msghdr message = {};
+      message.msg_iov = iov;
+      message.msg_iovlen = count;
+      return ::sendmsg(fd, &message, flags);
+    });
+  }
+
+  // Copies the collected segments into a contiguous vector.
+  std::vector<std::uint8_t> Gather() const {
+    std::vector<std::uint8_t> data;
+    data.reserve(size_);
+    for (const Segment& segment : segments_) {
+      const std::uint8_t* begin = Resolve(segment);
+      data.insert(data.end(), begin, begin + segment.length);
+    }
+    return data;
+  }
+
+  // Discards the collected segments and any references to external payloads
+  // while keeping the internal storage for reuse.
+  void Reset() {
+    buffer_.clear();
+    segments_.clear();
+    size_ = 0;
+  }
+
+  // Returns the total number of bytes in the message.
+  std::size_t size() const { return size_; }
+
+  // Returns the number of iovec segments in the message.
+  std::size_t segment_count() const { return segments_.size(); }
+
+  std::size_t threshold() const { return threshold_; }
+
+ private:
+  // Describes a range of bytes either in the internal buffer, when |external|
+  // is nullptr, or in memory owned by the caller. Internal segments are stored
+  // as offsets because the internal buffer may be reallocated as it grows.
+  struct Segment {
+    const std::uint8_t* external;
+    std::size_t offset;
+    std::size_t length;
+  };
+
+  // Accounts for |length| bytes about to be appended to the internal buffer,
+  // extending the last segment when it is also internal.
+  void ExtendInline(std::size_t length) {
+    if (length == 0)
+      return;
+    else if (segments_.empty() || segments_.back().external != nullptr)
+      segments_.push_back({nullptr, buffer_.size(), length});
+    else
+      segments_.back().length += length;
+  }
+
+  const std::uint8_t* Resolve(const Segment& segment) const {
+    return segment.external ? segment.external
+                            : buffer_.data() + segment.offset;
+  }
+
+  // Builds the iovec array and invokes |op| until every byte is transmitted,
+  // handling partial transfers and the IOV_MAX limit.
+  template <typename Op>
+  Status<void> Transmit(Op&& op) {
+    iovecs_.clear();
+    for (const Segment& segment : segments_) {
+      if (segment.length != 0) {
+        iovecs_.push_back({const_cast<std::uint8_t*>(Resolve(segment)),
+                           segment.length});
+      }
+    }
+
+    std::size_t index = 0;
+    while (index < iovecs_.size()) {
+      const int count = static_cast<int>(
+          std::min<std::size_t>(iovecs_.size() - index, IOV_MAX));
+      const ssize_t ret = op(&iovecs_[index], count);
+      if (ret < 0) {
+        if (errno == EINTR)
+          continue;
+        Reset();
+        return ErrorStatus::IOError;
+      } else if (ret == 0) {
+        Reset();
+        return ErrorStatus::WriteLimitReached;
+      }
+
+      // Advance past the segments that were fully transferred and adjust the
+      // first partially transferred segment.
+      std::size_t transferred = ret;
+      while (transferred > 0 && transferred >= iovecs_[index].iov_len) {
+        transferred -= iovecs_[index].iov_len;
+        index++;
+      }
+      if (transferred > 0) {
+        iovecs_[index].iov_base =
+            static_cast<std::uint8_t*>(iovecs_[index].iov_base) + transferred;
+        iovecs_[index].iov_len -= transferred;
+      }
+    }
+
+    Reset();
+    return {};
+  }
+
+  std::size_t threshold_{kDefaultThreshold};
+  std::vector<std::uint8_t> buffer_;
+  std::vector<Segment> segments_;
+  std::vector<iovec> iovecs_;
+  std::size_t size_{0};
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_SCATTER_GATHER_WRITER_H_
@@ -0,0 +1,541 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_SHARED_RING_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_SHARED_RING_H_
+
+#include <errno.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <utility>
+
+#include <nop/base/encoding.h>
+#include <nop/base/utility.h>
+#include <nop/status.h>
+
+namespace nop {
+
+//
+// SharedRing is a single-producer/single-consumer byte ring in a shared memory
+// region, for low latency messaging between processes on the same host.
+// SharedRingWriter and SharedRingReader implement the writer and reader
+// interfaces over the two ends of a ring, so that values are serialized
+// directly into shared memory and deserialized directly out of it without
+// entering the kernel in the common case.
+//
+// The region is created with memfd_create() and shared with the peer process
+// by passing the fd, for example across fork() or over a UNIX domain socket.
+// The data area is mapped twice in succession, so that any span of up to the
+// capacity of the ring is contiguous in memory even when it wraps around the
+// end of the ring. This allows the writer to reserve contiguous space for a
+// message and the reader to borrow views of it.
+//
+// The positions of the writer and reader are published with atomic operations.
+// A side only sleeps, using a futex in the shared region, after spinning
+// briefly without progress; its peer only issues the wake system call when the
+// side has announced that it is sleeping.
+//
+// Example:
+//
+//   auto ring = nop::SharedRing::Create(1 << 20);
+//   const int fd = ring.get().fd();
+//   // ... pass |fd| to the peer, which calls nop::SharedRing::Map(fd) ...
+//   nop::Serializer<nop::SharedRingWriter> serializer{ring.take()};
+//   auto status = serializer.Write(message);
+//
+// Only one writer and one reader may use a ring at a time. This header is
+// specific to Linux.
+//
+class SharedRing {
+ public:
+  SharedRing() = default;
+  SharedRing(const SharedRing&) = delete;
+  SharedRing(SharedRing&& other) { *this = std::move(other); }
+
+  ~SharedRing() { Clear(); }
+
+  SharedRing& operator=(const SharedRing&) = delete;
+  SharedRing& operator=(SharedRing&& other) {
+    if (this != &other) {
+      Clear();
+      std::swap(fd_, other.fd_);
+      std::swap(header_, other.header_);
+      std::swap(data_, other.data_);
+      std::swap(capacity_, other.capacity_);
+    }
+    return *this;
+  }
+
+  // Creates a new ring with at least |capacity| bytes of data. The capacity is
+  // rounded up to a power of two multiple of the page size.
+  static Status<SharedRing> Create(std::size_t capacity) {
+    const std::size_t page_size = PageSize();
+    std::size_t rounded_capacity = page_size;
+    while (rounded_capacity < capacity)
+      rounded_capacity *= 2;
+
+    const int fd = static_cast<int>(
+        ::syscall(SYS_memfd_create, "nop-shared-ring", MFD_CLOEXEC));
+    if (fd < 0)
+      return ErrorStatus::IOError;
+
+    if (::ftruncate(fd, page_size + rounded_capacity) < 0) {
+      ::close(fd);
+      return ErrorStatus::IOError;
+    }
+
+    SharedRing ring;
+    auto status = ring.MapFd(fd, rounded_capacity);
+    if (!status) {
+      ::close(fd);
+      return status.error();
+    }
+
+    new (ring.header_) Header{};
+    ring.header_->capacity = rounded_capacity;
+    return {std::move(ring)};
+  }
+
+  // Maps the ring created by a peer and shared as |fd|. On success the ring
+  // takes ownership of the fd.
+  static Status<SharedRing> Map(int fd) {
+    const off_t size = ::lseek(fd, 0, SEEK_END);
+    const std::size_t page_size = PageSize();
+    if (size < 0 || static_cast<std::size_t>(size) <= page_size)
+      return ErrorStatus::IOError;
+
+    SharedRing ring;
+    auto status = ring.MapFd(fd, static_cast<std::size_t>(size) - page_size);
+    if (!status)
+      return status.error();
+
+    if (ring.header_->capacity != ring.capacity_)
+      return ErrorStatus::IOError;
+
+    return {std::move(ring)};
+  }
+
+  // Unmaps the ring and closes the fd.
+  void Clear() {
+    if (header_) {
+      ::munmap(header_, PageSize() + 2 * capacity_);
+      ::close(fd_);
+    }
+    fd_ = -1;
+    header_ = nullptr;
+    data_ = nullptr;
+    capacity_ = 0;
+  }
+
+  int fd() const { return fd_; }
+  std::size_t capacity() const { return capacity_; }
+
+ private:
+  friend class SharedRingWriter;
+  friend class SharedRingReader;
+
+  enum : int { kSpinCount = 1000 };
+
+  // Shared state at the start of the region. The positions are free-running
+  // byte counts; the fields written by each side are on separate cache lines.
+  struct Header {
+    alignas(64) std::atomic<std::uint64_t> head{0};
+    std::atomic<std::uint32_t> writer_waiting{0};
+    std::atomic<std::uint32_t> writer_closed{0};
+    alignas(64) std::atomic<std::uint64_t> tail{0};
+    std::atomic<std::uint32_t> reader_waiting{0};
+    std::atomic<std::uint32_t> reader_closed{0};
+    alignas(64) std::uint64_t capacity{0};
+  };
+
+  static std::size_t PageSize() {
+    return static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+  }
+
+  Status<void> MapFd(int fd, std::size_t capacity) {
+    const std::size_t page_size = PageSize();
+    const std::size_t size = page_size + 2 * capacity;
+
+    // Reserve the address space, then map the data area twice over it.
+    void* base =
+        ::mmap(nullptr, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED)
+      return ErrorStatus::IOError;
+
+    std::uint8_t* address = static_cast<std::uint8_t*>(base);
+    if (::mmap(address, page_size + capacity, PROT_READ | PROT_WRITE,
+               MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED ||
+        ::mmap(address + page_size + capacity, capacity,
+               PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd,
+               page_size) == MAP_FAILED) {
+      ::munmap(base, size);
+      return ErrorStatus::IOError;
+    }
+
+    fd_ = fd;
+    header_ = reinterpret_cast<Header*>(address);
+    data_ = address + page_size;
+    capacity_ = capacity;
+    return {};
+  }
+
+  // Waits until |ready| returns true or |closed| is set, spinning briefly
+  // before sleeping on |waiting|. The peer wakes the waiter with Wake().
+  template <typename Ready>
+  static void Wait(std::atomic<std::uint32_t>* waiting,
+                   const std::atomic<std::uint32_t>* closed, Ready ready) {
+    for (int i = 0; i < kSpinCount; i++) {
+      if (ready() || closed->load(std::memory_order_acquire))
+        return;
+    }
+
+    while (true) {
+      waiting->store(1);
+      if (ready() || closed->load()) {
+        waiting->store(0, std::memory_order_relaxed);
+        return;
+      }
+
+      ::syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(waiting),
+                FUTEX_WAIT, 1, nullptr, nullptr, 0);
+    }
+  }
+
+  static void Wake(std::atomic<std::uint32_t>* waiting) {
+    if (waiting->load() && waiting->exchange(0)) {
+      ::syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(waiting),
+                FUTEX_WAKE, 1, nullptr, nullptr, 0);
+    }
+  }
+
+  int fd_{-1};
+  Header* header_{nullptr};
+  std::uint8_t* data_{nullptr};
+  std::size_t capacity_{0};
+};
+
+// Writer for the producer end of a SharedRing.
+//
+// Prepare() waits for contiguous space for the upcoming message, up to the
+// capacity of the ring, and the bytes written are committed to the reader as
+// soon as the prepared size has been written. The serializer prepares the size
+// of each value, so every serialized value is committed upon completion.
+// Bytes written without a preceding Prepare() are committed by Flush(), or
+// whenever the writer must wait for the reader to free space. Values larger
+// than the ring are streamed through it in pieces.
+//
+// Destroying the writer closes its end of the ring: the reader fails with
+// ErrorStatus::ReadLimitReached after consuming the remaining bytes.
+class SharedRingWriter {
+ public:
+  SharedRingWriter() = default;
+  SharedRingWriter(SharedRing ring) : ring_{std::move(ring)} {
+    if (ring_.header_) {
+      head_ = committed_ = ring_.header_->head.load();
+      tail_ = ring_.header_->tail.load();
+    }
+  }
+  SharedRingWriter(const SharedRingWriter&) = delete;
+  SharedRingWriter(SharedRingWriter&& other) { *this = std::move(other); }
+
+  ~SharedRingWriter() { Clear(); }
+
+  SharedRingWriter& operator=(const SharedRingWriter&) = delete;
+  SharedRingWriter& operator=(SharedRingWriter&& other) {
+    if (this != &other) {
+      Clear();
+      std::swap(ring_, other.ring_);
+      std::swap(head_, other.head_);
+      std::swap(tail_, other.tail_);
+      std::swap(committed_, other.committed_);
+      std::swap(reserved_, other.reserved_);
+    }
+    return *this;
+  }
+
+  // Commits any bytes written and closes the writer end of the ring.
+  void Clear() {
+    if (ring_.header_) {
+      Flush();
+      ring_.header_->writer_closed.store(1);
+      SharedRing::Wake(&ring_.header_->reader_waiting);
+    }
+    ring_.Clear();
+    head_ = tail_ = committed_ = reserved_ = 0;
+  }
+
+  Status<void> Prepare(std::size_t size) {
+    reserved_ = head_ + size;
+    return WaitForSpace(size < ring_.capacity_ ? size : ring_.capacity_);
+  }
+
+  Status<void> Write(std::uint8_t byte) { return Write(&byte, &byte + 1); }
+
+  Status<void> Write(const void* begin, const void* end) {
+    const std::uint8_t* begin_byte = static_cast<const std::uint8_t*>(begin);
+    const std::uint8_t* end_byte = static_cast<const std::uint8_t*>(end);
+    return Fill(end_byte - begin_byte, [&begin_byte](std::uint8_t* data,
+                                                      std::size_t length) {
+      std::memcpy(data, begin_byte, length);
+      begin_byte += length;
+    });
+  }
+
+  Status<void> Skip(std::size_t padding_bytes,
+                    std::uint8_t padding_value = 0x00) {
+    return Fill(padding_bytes,
+                [padding_value](std::uint8_t* data, std::size_t length) {
+                  std::memset(data, padding_value, length);
+                });
+  }
+
+  // Makes all bytes written so far visible to the reader.
+  Status<void> Flush() {
+    if (committed_ != head_) {
+      committed_ = head_;
+      ring_.header_->head.store(head_);
+      SharedRing::Wake(&ring_.header_->reader_waiting);
+    }
+    return {};
+  }
+
+  const SharedRing& ring() const { return ring_; }
+
+ private:
+  std::size_t Space() const { return ring_.capacity_ - (head_ - tail_); }
+
+  Status<void> WaitForSpace(std::size_t size) {
+    if (Space() >= size)
+      return {};
+
+    SharedRing::Header* header = ring_.header_;
+    tail_ = header->tail.load(std::memory_order_acquire);
+    if (Space() >= size)
+      return {};
+
+    // Uncommitted bytes must be visible to the reader before waiting on it.
+    Flush();
+    SharedRing::Wait(&header->writer_waiting, &header->reader_closed, [&] {
+      tail_ = header->tail.load(std::memory_order_acquire);
+      return Space() >= size;
+    });
+
+    if (Space() >= size)
+      return {};
+    else
+      return ErrorStatus::WriteLimitReached;
+  }
+
+  template <typename Op>
+  Status<void> Fill(std::size_t length, Op op) {
+    while (length > 0) {
+      auto status = WaitForSpace(1);
+      if (!status)
+        return status;
+
+      const std::size_t space = Space();
+      const std::size_t count = length < space ? length : space;
+      op(ring_.data_ + (head_ & (ring_.capacity_ - 1)), count);
+      head_ += count;
+      length -= count;
+    }
+
+    if (head_ >= reserved_)
+      return Flush();
+    else
+      return {};
+  }
+
+  SharedRing ring_;
+  std::uint64_t head_{0};
+  std::uint64_t tail_{0};
+  std::uint64_t committed_{0};
+  std::uint64_t reserved_{0};
+};
+
+// Reader for the consumer end of a SharedRing.
+//
+// The reader supports Borrow(), which returns views directly into the ring for
+// BinaryView and StringView values of up to the capacity of the ring. Space is
+// returned to the writer as bytes are consumed, except after a borrow: borrowed
+// bytes, and those consumed after them, are held until Release() is called, so
+// that views remain valid until the message that contains them has been
+// processed. A message that contains borrowed values must therefore fit in the
+// ring.
+//
+// Destroying the reader closes its end of the ring: the writer fails with
+// ErrorStatus::WriteLimitReached when it would have to wait for space.
+class SharedRingReader {
+ public:
+  SharedRingReader() = default;
+  SharedRingReader(SharedRing ring) : ring_{std::move(ring)} {
+    if (ring_.header_)
+      head_ = tail_ = released_ = ring_.header_->tail.load();
+  }
+  SharedRingReader(const SharedRingReader&) = delete;
+  SharedRingReader(SharedRingReader&& other) { *this = std::move(other); }
+
+  ~SharedRingReader() { Clear(); }
+
+  SharedRingReader& operator=(const SharedRingReader&) = delete;
+  SharedRingReader& operator=(SharedRingReader&& other) {
+    if (this != &other) {
+      Clear();
+      std::swap(ring_, other.ring_);
+      std::swap(head_, other.head_);
+      std::swap(tail_, other.tail_);
+      std::swap(released_, other.released_);
+      std::swap(holding_, other.holding_);
+    }
+    return *this;
+  }
+
+  // Closes the reader end of the ring.
+  void Clear() {
+    if (ring_.header_) {
+      ring_.header_->reader_closed.store(1);
+      SharedRing::Wake(&ring_.header_->writer_waiting);
+    }
+    ring_.Clear();
+    head_ = tail_ = released_ = 0;
+    holding_ = false;
+  }
+
+  // The ring is a stream: data may still arrive, so there is no limit to check
+  // in advance.
+  Status<void> Ensure(std::size_t /*size*/) { return {}; }
+
+  Status<void> Read(std::uint8_t* byte) { return Read(byte, byte + 1); }
+
+  template <typename T, typename Enable = EnableIfArithmetic<T>>
+  Status<void> Read(T* begin, T* end) {
+    std::uint8_t* begin_byte = reinterpret_cast<std::uint8_t*>(begin);
+    return Consume((end - begin) * sizeof(T),
+                   [&begin_byte](const std::uint8_t* data,
+                                 std::size_t length) {
+                     std::memcpy(begin_byte, data, length);
+                     begin_byte += length;
+                   });
+  }
+
+  Status<void> Skip(std::size_t padding_bytes) {
+    return Consume(padding_bytes, [](const std::uint8_t*, std::size_t) {});
+  }
+
+  // Returns a pointer to the next |size| bytes of the ring and advances past
+  // them. The bytes remain valid until Release() is called.
+  Status<void> Borrow(std::size_t size, const void** data) {
+    if (size > ring_.capacity_)
+      return ErrorStatus::ReadLimitReached;
+
+    auto status = WaitForData(size);
+    if (!status)
+      return status;
+
+    *data = ring_.data_ + (tail_ & (ring_.capacity_ - 1));
+    tail_ += size;
+    holding_ = true;
+    return {};
+  }
+
+  // Borrowed bytes are retained until Release(), so strings and byte vectors
+  // are copied out of the ring instead of borrowed.
+  static constexpr bool kBorrowToCopy = false;
+
+  // Returns the space of all consumed bytes, including borrowed bytes, to the
+  // writer.
+  void Release() {
+    holding_ = false;
+    Publish();
+  }
+
+  const SharedRing& ring() const { return ring_; }
+
+ private:
+  std::size_t Available() const { return head_ - tail_; }
+
+  void Publish() {
+    if (released_ != tail_) {
+      released_ = tail_;
+      ring_.header_->tail.store(tail_);
+      SharedRing::Wake(&ring_.header_->writer_waiting);
+    }
+  }
+
+  Status<void> WaitForData(std::size_t size) {
+    if (Available() >= size)
+      return {};
+
+    SharedRing::Header* header = ring_.header_;
+    head_ = header->head.load(std::memory_order_acquire);
+    if (Available() >= size)
+      return {};
+
+    // Return consumed space before waiting so that the writer can proceed.
+    if (!holding_)
+      Publish();
+
+    SharedRing::Wait(&header->reader_waiting, &header->writer_closed, [&] {
+      head_ = header->head.load(std::memory_order_acquire);
+      return Available() >= size;
+    });
+
+    // The writer commits its final bytes before closing.
+    head_ = header->head.load(std::memory_order_acquire);
+    if (Available() >= size)
+      return {};
+    else
+      return ErrorStatus::ReadLimitReached;
+  }
+
+  template <typename Op>
+  Status<void> Consume(std::size_t length, Op op) {
+    while (length > 0) {
+      auto status = WaitForData(1);
+      if (!status)
+        return status;
+
+      const std::size_t available = Available();
+      const std::size_t count = length < available ? length : available;
+      op(ring_.data_ + (tail_ & (ring_.capacity_ - 1)), count);
+      tail_ += count;
+      length -= count;
+    }
+
+    // Return space in batches to limit traffic on the shared cache line.
+    if (!holding_ && tail_ - released_ >= ring_.capacity_ / 4)
+      Publish();
+    return {};
+  }
+
+  SharedRing ring_;
+  std::uint64_t head_{0};
+  std::uint64_t tail_{0};
+  std::uint64_t released_{0};
+  bool holding_{false};
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_SHARED_RING_H_
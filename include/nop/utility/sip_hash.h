@@ -18,9 +18,13 @@
 #define LIBNOP_INCLUDE_NOP_UTILITY_SIP_HASH_H_
 
 #include <array>
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
+#include <type_traits>
 
 #include <nop/utility/compiler.h>
+#include <nop/utility/endian.h>
 
 // A direct port of the SipHash C reference implementation.
 //
@@ -48,6 +52,7 @@ class BlockReader {
   BlockReader(const BlockReader&) = default;
   BlockReader& operator=(const BlockReader&) = default;
 
+  constexpr const ValueType* data() const { return data_; }
   constexpr std::size_t size() const { return size_; }
   constexpr ValueType operator[](const std::size_t index) const {
     return data_[index];
@@ -71,9 +76,37 @@ struct SipHash {
     return Compute(BlockReader<T>(buffer), k0, k1);
   }
 
+  // Hashes contiguous bytes. Outside of constant expressions, the bytes are
+  // hashed with ComputeFast().
+  template <typename T>
+  static constexpr std::uint64_t Compute(const BlockReader<T> buffer,
+                                         std::uint64_t k0, std::uint64_t k1) {
+    if (NOP_IS_CONSTANT_EVALUATED())
+      return ComputeBlocks(buffer, k0, k1);
+    else
+      return ComputeFast(buffer.data(), buffer.size(), k0, k1);
+  }
+
   template <typename BufferType>
   static constexpr std::uint64_t Compute(const BufferType buffer,
                                          std::uint64_t k0, std::uint64_t k1) {
+    return ComputeBlocks(buffer, k0, k1);
+  }
+
+  // Hashes |size| bytes at |data| a word at a time, using unaligned loads.
+  // Returns the same value as Compute(). Use SipHashStream to hash data that
+  // is not contiguous.
+  static std::uint64_t ComputeFast(const void* data, std::size_t size,
+                                   std::uint64_t k0, std::uint64_t k1);
+
+ private:
+  template <std::size_t Bits>
+  friend class SipHashStream;
+
+  template <typename BufferType>
+  static constexpr std::uint64_t ComputeBlocks(const BufferType buffer,
+                                               std::uint64_t k0,
+                                               std::uint64_t k1) {
     const std::size_t kBlockSize = sizeof(std::uint64_t);
     const std::size_t kLength = buffer.size();
     const std::size_t kLeftOver = kLength % kBlockSize;
@@ -138,7 +171,6 @@ struct SipHash {
     return b;
   }
 
- private:
   template <typename BufferType>
   static constexpr std::uint64_t ReadBlock(const BufferType buffer,
                                            const std::size_t offset) {
@@ -178,6 +210,144 @@ struct SipHash {
   }
 };
 
+// 128-bit hash value.
+struct Hash128 {
+  std::uint64_t low;
+  std::uint64_t high;
+
+  bool operator==(const Hash128& other) const {
+    return low == other.low && high == other.high;
+  }
+  bool operator!=(const Hash128& other) const { return !(*this == other); }
+};
+
+// Computes SipHash-2-4 incrementally, over data that is supplied in pieces of
+// any size. Bits selects the standard 64-bit output or the 128-bit variant.
+// The result is the same as hashing the concatenation of the pieces at once.
+//
+// Example:
+//
+//   SipHashStream<64> hash{k0, k1};
+//   hash.Update(header, header_size);
+//   hash.Update(body, body_size);
+//   const std::uint64_t value = hash.Finish();
+//
+template <std::size_t Bits>
+class SipHashStream {
+  static_assert(Bits == 64 || Bits == 128,
+                "SipHashStream supports 64-bit and 128-bit output.");
+
+ public:
+  using Result = std::conditional_t<Bits == 64, std::uint64_t, Hash128>;
+
+  SipHashStream(std::uint64_t k0, std::uint64_t k1) : k0_{k0}, k1_{k1} {
+    Reset();
+  }
+
+  // Restarts the hash with no data.
+  void Reset() {
+    v_[0] = 0x736f6d6570736575ULL ^ k0_;
+    v_[1] = 0x646f72616e646f6dULL ^ k1_;
+    v_[2] = 0x6c7967656e657261ULL ^ k0_;
+    v_[3] = 0x7465646279746573ULL ^ k1_;
+    if (Bits == 128)
+      v_[1] ^= 0xee;
+    tail_ = 0;
+    length_ = 0;
+  }
+
+  // Hashes |size| bytes at |data|.
+  void Update(const void* data, std::size_t size) {
+    const std::uint8_t* bytes = static_cast<const std::uint8_t*>(data);
+    std::size_t pending = length_ % kBlockSize;
+    length_ += size;
+
+    // Complete the block left over from the previous update.
+    if (pending != 0) {
+      while (size != 0 && pending != kBlockSize) {
+        tail_ |= static_cast<std::uint64_t>(*bytes++) << (8 * pending++);
+        size--;
+      }
+      if (pending != kBlockSize)
+        return;
+
+      Compress(tail_);
+      tail_ = 0;
+    }
+
+    for (; size >= kBlockSize; bytes += kBlockSize, size -= kBlockSize)
+      Compress(LoadBlock(bytes));
+
+    for (std::size_t i = 0; i < size; i++)
+      tail_ |= static_cast<std::uint64_t>(bytes[i]) << (8 * i);
+  }
+
+  // Returns the hash of the data supplied so far. More data may be supplied
+  // afterwards to extend the hash.
+  Result Finish() const {
+    std::uint64_t v[4] = {v_[0], v_[1], v_[2], v_[3]};
+    const std::uint64_t b = (static_cast<std::uint64_t>(length_) << 56) | tail_;
+
+    v[3] ^= b;
+    SipHash::Round(v);
+    SipHash::Round(v);
+    v[0] ^= b;
+
+    v[2] ^= Bits == 128 ? 0xee : 0xff;
+    for (int i = 0; i < 4; i++)
+      SipHash::Round(v);
+    return Output(v, std::integral_constant<bool, Bits == 128>{});
+  }
+
+  // Returns the number of bytes supplied since the hash was started.
+  std::uint64_t length() const { return length_; }
+
+ private:
+  enum : std::size_t { kBlockSize = sizeof(std::uint64_t) };
+
+  // Loads a little-endian block with a single, possibly unaligned, load.
+  static std::uint64_t LoadBlock(const std::uint8_t* bytes) {
+    std::uint64_t block;
+    std::memcpy(&block, bytes, sizeof(block));
+    return HostEndian<std::uint64_t>::FromLittle(block);
+  }
+
+  void Compress(std::uint64_t m) {
+    v_[3] ^= m;
+    SipHash::Round(v_);
+    SipHash::Round(v_);
+    v_[0] ^= m;
+  }
+
+  static std::uint64_t Output(std::uint64_t (&v)[4],
+                              std::false_type /*wide*/) {
+    return v[0] ^ v[1] ^ v[2] ^ v[3];
+  }
+
+  static Hash128 Output(std::uint64_t (&v)[4], std::true_type /*wide*/) {
+    Hash128 hash;
+    hash.low = v[0] ^ v[1] ^ v[2] ^ v[3];
+    v[1] ^= 0xdd;
+    for (int i = 0; i < 4; i++)
+      SipHash::Round(v);
+    hash.high = v[0] ^ v[1] ^ v[2] ^ v[3];
+    return hash;
+  }
+
+  std::uint64_t k0_;
+  std::uint64_t k1_;
+  std::uint64_t v_[4];
+  std::uint64_t tail_;
+  std::uint64_t length_;
+};
+
+inline std::uint64_t SipHash::ComputeFast(const void* data, std::size_t size,
+                                          std::uint64_t k0, std::uint64_t k1) {
+  SipHashStream<64> hash{k0, k1};
+  hash.Update(data, size);
+  return hash.Finish();
+}
+
 }  // namespace nop
 
 #endif  // LIBNOP_INCLUDE_NOP_UTILITY_SIP_HASH_H_
@@ -0,0 +1,136 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_SIZING_WRITER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_SIZING_WRITER_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include <nop/base/encoding.h>
+#include <nop/base/handle.h>
+#include <nop/base/serializer.h>
+#include <nop/base/utility.h>
+#include <nop/status.h>
+#include <nop/types/handle.h>
+#include <nop/utility/canonical.h>
+#include <nop/utility/exact_table_entries.h>
+
+namespace nop {
+
+// SizingWriter is a writer type that counts the bytes of the values written to
+// it without storing them. It computes the exact encoded size of values for
+// which Encoding<T>::Size() is only an upper bound, such as handles, whose
+// references are not known until they are pushed to the writer.
+//
+// Handle references are assigned the way UnixSocketWriter assigns them:
+// sequentially from |first_handle_reference| for valid handles, and
+// kEmptyHandleReference for empty ones. The size of a table depends on whether
+// its entries are padded, so SizingWriter adopts the canonical and exact table
+// entry modes of Writer, the type of the writer the value is destined for.
+//
+// Most code uses ExactEncodingSize() below.
+template <typename Writer>
+class SizingWriter {
+ public:
+  SizingWriter() = default;
+  explicit SizingWriter(HandleReference first_handle_reference)
+      : next_handle_reference_{first_handle_reference} {}
+
+  SizingWriter(const SizingWriter&) = default;
+  SizingWriter& operator=(const SizingWriter&) = default;
+
+  // Sizing needs no storage, so the serializer skips the size pass.
+  static constexpr bool kNeedsPrepare = false;
+
+  static constexpr bool kCanonical = WriterIsCanonical<Writer>::value;
+  static constexpr bool kExactTableEntries =
+      WriterExactTableEntries<Writer>::value;
+
+  Status<void> Prepare(std::size_t /*size*/) { return {}; }
+
+  Status<void> Write(std::uint8_t /*byte*/) {
+    size_ += 1;
+    return {};
+  }
+
+  template <typename T, typename Enable = EnableIfArithmetic<T>>
+  Status<void> Write(const T* begin, const T* end) {
+    size_ += (end - begin) * sizeof(T);
+    return {};
+  }
+
+  Status<void> Skip(std::size_t padding_bytes,
+                    std::uint8_t /*padding_value*/ = 0x00) {
+    size_ += padding_bytes;
+    return {};
+  }
+
+  std::size_t offset() const { return size_; }
+
+  // Patching does not change the size.
+  Status<void> Patch(std::size_t /*offset*/, const std::uint8_t* /*begin*/,
+                     const std::uint8_t* /*end*/) {
+    return {};
+  }
+
+  template <typename HandleType>
+  Status<HandleReference> PushHandle(const HandleType& handle) {
+    if (handle)
+      return {next_handle_reference_++};
+    else
+      return {kEmptyHandleReference};
+  }
+
+  // Returns the number of bytes written.
+  std::size_t size() const { return size_; }
+
+  void Clear() { size_ = 0; }
+
+ private:
+  std::size_t size_{0};
+  HandleReference next_handle_reference_{0};
+};
+
+// Returns the exact number of bytes that serializing |value| to a writer of
+// type Writer produces, where Serializer::GetSize() may overestimate. The value
+// is encoded once without storing the bytes, so this costs about as much as
+// serializing it; use it to right-size buffers or to measure the encoding,
+// rather than on every write.
+//
+// |first_handle_reference| is the reference the writer will assign to the next
+// valid handle, such as UnixSocketWriter::handle_count() when more values are
+// added to a message.
+//
+// Example:
+//
+//   auto size = ExactEncodingSize<UnixSocketWriter>(message);
+//   if (size && size.get() > kMaxMessageSize)
+//     return ErrorStatus::WriteLimitReached;
+//
+template <typename Writer, typename T>
+Status<std::size_t> ExactEncodingSize(
+    const T& value, HandleReference first_handle_reference = 0) {
+  SizingWriter<Writer> writer{first_handle_reference};
+  auto status = Serializer<SizingWriter<Writer>*>{&writer}.Write(value);
+  if (!status)
+    return status.error();
+  return {writer.size()};
+}
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_SIZING_WRITER_H_
@@ -28,6 +28,7 @@ namespace nop {
 // Reader template type that wraps STL input streams.
 //
 // Implements the basic reader interface on top of an STL input stream type.
+// See StreambufReader for a faster reader that bypasses the stream layer.
 //
 
 template <typename IStream>
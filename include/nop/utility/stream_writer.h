@@ -17,6 +17,7 @@
 #ifndef LIBNOP_INLCUDE_NOP_UTILITY_STREAM_WRITER_H_
 #define LIBNOP_INLCUDE_NOP_UTILITY_STREAM_WRITER_H_
 
+#include <algorithm>
 #include <cstdint>
 #include <ostream>
 
@@ -28,6 +29,7 @@ namespace nop {
 // Writer template type that wraps STL output streams.
 //
 // Implements the basic writer interface on top of an STL output stream type.
+// See StreambufWriter for a faster writer that bypasses the stream layer.
 //
 
 template <typename OStream>
@@ -38,6 +40,9 @@ class StreamWriter {
   StreamWriter(const StreamWriter&) = default;
   StreamWriter& operator=(const StreamWriter&) = default;
 
+  // This writer ignores the size passed to Prepare().
+  static constexpr bool kNeedsPrepare = false;
+
   Status<void> Prepare(std::size_t /*size*/) { return {}; }
 
   Status<void> Write(std::uint8_t byte) {
@@ -58,11 +63,23 @@ class StreamWriter {
 
   Status<void> Skip(std::size_t padding_bytes,
                     std::uint8_t padding_value = 0x00) {
-    for (std::size_t i = 0; i < padding_bytes; i++) {
-      stream_.put(padding_value);
+    // Write the padding in blocks to avoid checking the stream state for each
+    // byte.
+    using CharType = typename OStream::char_type;
+    CharType padding[kPaddingBlockSize];
+    std::fill(padding, padding + kPaddingBlockSize,
+              static_cast<CharType>(padding_value));
+
+    while (padding_bytes > 0) {
+      const std::size_t length = padding_bytes < kPaddingBlockSize
+                                     ? padding_bytes
+                                     : std::size_t{kPaddingBlockSize};
+      stream_.write(padding, length);
       auto status = ReturnStatus();
       if (!status)
         return status;
+
+      padding_bytes -= length;
     }
 
     return {};
@@ -73,6 +90,8 @@ class StreamWriter {
   OStream&& take() { return std::move(stream_); }
 
  private:
+  enum : std::size_t { kPaddingBlockSize = 64 };
+
   Status<void> ReturnStatus() {
     if (stream_.bad() || stream_.eof())
       return ErrorStatus::StreamError;
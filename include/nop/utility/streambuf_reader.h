@@ -0,0 +1,125 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_STREAMBUF_READER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_STREAMBUF_READER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <streambuf>
+
+#include <nop/status.h>
+
+namespace nop {
+
+//
+// Reader that reads directly from the std::streambuf of an input stream.
+//
+// Like StreambufWriter, this reader bypasses the sentry and state checks of
+// the stream layer and calls sbumpc() and sgetn() on the buffer, checking only
+// the number of characters returned. Skip() seeks when the buffer supports it
+// and otherwise reads and discards the padding in blocks.
+//
+// When constructed from a stream, reaching the end of the input sets eofbit
+// and failbit on the stream.
+//
+// Example:
+//
+//   std::istringstream stream{data};
+//   Deserializer<StreambufReader> deserializer{&stream};
+//   auto status = deserializer.Read(&message);
+//
+class StreambufReader {
+ public:
+  StreambufReader() = default;
+  StreambufReader(const StreambufReader&) = default;
+  explicit StreambufReader(std::streambuf* buffer) : buffer_{buffer} {}
+  explicit StreambufReader(std::istream* stream)
+      : buffer_{stream->rdbuf()}, stream_{stream} {}
+
+  StreambufReader& operator=(const StreambufReader&) = default;
+
+  Status<void> Ensure(std::size_t /*size*/) { return {}; }
+
+  Status<void> Read(std::uint8_t* byte) {
+    using Traits = std::streambuf::traits_type;
+    const Traits::int_type value = buffer_->sbumpc();
+    if (Traits::eq_int_type(value, Traits::eof()))
+      return Fail();
+
+    *byte = static_cast<std::uint8_t>(Traits::to_char_type(value));
+    return {};
+  }
+
+  Status<void> Read(void* begin, void* end) {
+    char* begin_char = static_cast<char*>(begin);
+    char* end_char = static_cast<char*>(end);
+    return Get(begin_char, end_char - begin_char);
+  }
+
+  Status<void> Skip(std::size_t padding_bytes) {
+    if (padding_bytes == 0)
+      return {};
+
+    const std::streampos position =
+        buffer_->pubseekoff(static_cast<std::streamoff>(padding_bytes),
+                            std::ios_base::cur, std::ios_base::in);
+    if (position != std::streampos(std::streamoff(-1)))
+      return {};
+
+    char padding[kPaddingBlockSize];
+    while (padding_bytes > 0) {
+      const std::size_t length =
+          padding_bytes < sizeof(padding) ? padding_bytes : sizeof(padding);
+      auto status = Get(padding, length);
+      if (!status)
+        return status;
+
+      padding_bytes -= length;
+    }
+
+    return {};
+  }
+
+  std::streambuf* buffer() const { return buffer_; }
+  std::istream* stream() const { return stream_; }
+
+ private:
+  enum : std::size_t { kPaddingBlockSize = 64 };
+
+  Status<void> Get(char* data, std::size_t length) {
+    if (static_cast<std::size_t>(buffer_->sgetn(
+            data, static_cast<std::streamsize>(length))) != length) {
+      return Fail();
+    }
+    return {};
+  }
+
+  Status<void> Fail() {
+    if (stream_)
+      stream_->setstate(std::ios_base::eofbit | std::ios_base::failbit);
+    return ErrorStatus::StreamError;
+  }
+
+  std::streambuf* buffer_{nullptr};
+  std::istream* stream_{nullptr};
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_STREAMBUF_READER_H_
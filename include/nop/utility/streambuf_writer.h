@@ -0,0 +1,127 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_STREAMBUF_WRITER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_STREAMBUF_WRITER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <streambuf>
+
+#include <nop/status.h>
+
+namespace nop {
+
+//
+// Writer that writes directly to the std::streambuf of an output stream.
+//
+// StreamWriter goes through the formatted stream layer, which constructs a
+// sentry and checks the stream state for every call and writes padding one
+// byte at a time. This writer calls sputc() and sputn() on the buffer instead
+// and only checks the number of characters that the buffer accepted. Padding
+// is written in blocks.
+//
+// When constructed from a stream, a failed write sets badbit on the stream so
+// that the failure is visible to code that checks the stream afterwards. The
+// stream state is not otherwise consulted or updated, and the buffer is not
+// flushed; call flush() on the stream when the message is complete if needed.
+//
+// Example:
+//
+//   std::ostringstream stream;
+//   Serializer<StreambufWriter> serializer{&stream};
+//   auto status = serializer.Write(message);
+//
+class StreambufWriter {
+ public:
+  StreambufWriter() = default;
+  StreambufWriter(const StreambufWriter&) = default;
+  explicit StreambufWriter(std::streambuf* buffer) : buffer_{buffer} {}
+  explicit StreambufWriter(std::ostream* stream)
+      : buffer_{stream->rdbuf()}, stream_{stream} {}
+
+  StreambufWriter& operator=(const StreambufWriter&) = default;
+
+  // This writer ignores the size passed to Prepare().
+  static constexpr bool kNeedsPrepare = false;
+
+  Status<void> Prepare(std::size_t /*size*/) { return {}; }
+
+  Status<void> Write(std::uint8_t byte) {
+    using Traits = std::streambuf::traits_type;
+    if (Traits::eq_int_type(buffer_->sputc(static_cast<char>(byte)),
+                            Traits::eof())) {
+      return Fail();
+    }
+    return {};
+  }
+
+  Status<void> Write(const void* begin, const void* end) {
+    const char* begin_char = static_cast<const char*>(begin);
+    const char* end_char = static_cast<const char*>(end);
+    return Put(begin_char, end_char - begin_char);
+  }
+
+  Status<void> Skip(std::size_t padding_bytes,
+                    std::uint8_t padding_value = 0x00) {
+    char padding[kPaddingBlockSize];
+    std::memset(padding, padding_value,
+                padding_bytes < sizeof(padding) ? padding_bytes
+                                                : sizeof(padding));
+
+    while (padding_bytes > 0) {
+      const std::size_t length =
+          padding_bytes < sizeof(padding) ? padding_bytes : sizeof(padding);
+      auto status = Put(padding, length);
+      if (!status)
+        return status;
+
+      padding_bytes -= length;
+    }
+
+    return {};
+  }
+
+  std::streambuf* buffer() const { return buffer_; }
+  std::ostream* stream() const { return stream_; }
+
+ private:
+  enum : std::size_t { kPaddingBlockSize = 64 };
+
+  Status<void> Put(const char* data, std::size_t length) {
+    if (static_cast<std::size_t>(buffer_->sputn(
+            data, static_cast<std::streamsize>(length))) != length) {
+      return Fail();
+    }
+    return {};
+  }
+
+  Status<void> Fail() {
+    if (stream_)
+      stream_->setstate(std::ios_base::badbit);
+    return ErrorStatus::StreamError;
+  }
+
+  std::streambuf* buffer_{nullptr};
+  std::ostream* stream_{nullptr};
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_STREAMBUF_WRITER_H_
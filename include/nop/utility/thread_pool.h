@@ -0,0 +1,322 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_THREAD_POOL_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_THREAD_POOL_H_
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace nop {
+
+// ThreadPool runs tasks on a fixed set of worker threads with work stealing.
+// Each worker owns a deque of tasks: tasks submitted from a worker are pushed
+// onto its own deque and popped in LIFO order, which keeps related work on the
+// same thread while it is still in cache, and idle workers steal the oldest
+// tasks from the other deques. Tasks submitted from other threads are spread
+// over the workers round-robin.
+//
+// The deques are guarded by per-worker locks, so submitting and running tasks
+// only contends with the occasional thief. Idle workers sleep until a task is
+// submitted.
+//
+// Destroying the pool runs the tasks that are still queued, including any they
+// submit, and then joins the workers.
+//
+// Example:
+//
+//   ThreadPool pool{4};
+//   pool.Submit([] { ProcessChunk(0); });
+//   pool.Submit([] { ProcessChunk(1); });
+//
+class ThreadPool {
+ public:
+  using Task = std::function<void()>;
+
+  // Starts |thread_count| workers, or one per hardware thread when
+  // |thread_count| is zero.
+  explicit ThreadPool(std::size_t thread_count = 0) {
+    if (thread_count == 0)
+      thread_count = std::thread::hardware_concurrency();
+    if (thread_count == 0)
+      thread_count = 1;
+
+    workers_.reserve(thread_count);
+    for (std::size_t i = 0; i < thread_count; i++)
+      workers_.emplace_back(new Worker);
+    for (std::size_t i = 0; i < thread_count; i++)
+      workers_[i]->thread = std::thread{[this, i] { Run(i); }};
+  }
+
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock{mutex_};
+      stopping_ = true;
+    }
+    condition_.notify_all();
+    for (auto& worker : workers_)
+      worker->thread.join();
+  }
+
+  ThreadPool(const ThreadPool&) = delete;
+  void operator=(const ThreadPool&) = delete;
+
+  // Queues |task| to run on one of the workers. May be called from any thread,
+  // including from tasks running on the pool.
+  void Submit(Task task) {
+    const Context& context = CurrentContext();
+    const std::size_t index =
+        context.pool == this
+            ? context.index
+            : next_worker_.fetch_add(1, std::memory_order_relaxed) %
+                  workers_.size();
+
+    // Count the task before queuing it so that the count never underflows
+    // when a worker takes the task immediately.
+    queued_.fetch_add(1);
+    {
+      Worker& worker = *workers_[index];
+      std::lock_guard<std::mutex> lock{worker.mutex};
+      worker.tasks.push_back(std::move(task));
+    }
+
+    // The sequentially consistent increment above and load here pair with
+    // those in Run(), so that either a sleeping worker observes the task or
+    // the submitter observes the sleeping worker.
+    if (sleeping_.load())
+      Notify();
+  }
+
+  // Returns the number of workers.
+  std::size_t size() const { return workers_.size(); }
+
+ private:
+  struct Worker {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+    std::thread thread;
+  };
+
+  // Identifies the pool and worker of the calling thread, if any.
+  struct Context {
+    const ThreadPool* pool{nullptr};
+    std::size_t index{0};
+  };
+
+  static Context& CurrentContext() {
+    static thread_local Context context;
+    return context;
+  }
+
+  void Run(std::size_t index) {
+    CurrentContext() = Context{this, index};
+
+    Task task;
+    while (true) {
+      if (Pop(index, &task) || Steal(index, &task)) {
+        queued_.fetch_sub(1);
+        task();
+        task = nullptr;
+        continue;
+      }
+
+      std::unique_lock<std::mutex> lock{mutex_};
+      sleeping_.fetch_add(1);
+      condition_.wait(lock,
+                      [this] { return queued_.load() > 0 || stopping_; });
+      sleeping_.fetch_sub(1);
+      if (stopping_ && queued_.load() == 0)
+        return;
+    }
+  }
+
+  // Takes the newest task from the deque of worker |index|.
+  bool Pop(std::size_t index, Task* task) {
+    Worker& worker = *workers_[index];
+    std::lock_guard<std::mutex> lock{worker.mutex};
+    if (worker.tasks.empty())
+      return false;
+
+    *task = std::move(worker.tasks.back());
+    worker.tasks.pop_back();
+    return true;
+  }
+
+  // Takes the oldest task from the deque of another worker, visiting the
+  // workers after |index| in turn.
+  bool Steal(std::size_t index, Task* task) {
+    for (std::size_t i = 1; i < workers_.size(); i++) {
+      Worker& worker = *workers_[(index + i) % workers_.size()];
+      std::lock_guard<std::mutex> lock{worker.mutex};
+      if (!worker.tasks.empty()) {
+        *task = std::move(worker.tasks.front());
+        worker.tasks.pop_front();
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void Notify() {
+    std::lock_guard<std::mutex> lock{mutex_};
+    condition_.notify_one();
+  }
+
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::atomic<std::size_t> next_worker_{0};
+  std::atomic<std::ptrdiff_t> queued_{0};
+  std::atomic<std::size_t> sleeping_{0};
+
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  bool stopping_{false};
+};
+
+// SerialExecutor runs tasks on a ThreadPool one at a time, in the order they
+// were submitted, without dedicating a thread to them. Independent executors
+// on the same pool run concurrently, which makes an executor per connection or
+// per object a cheap way to order related work while unrelated work proceeds
+// in parallel.
+//
+// At most kMaxBatch tasks run back to back before the executor yields its
+// worker, so that a busy executor does not starve the others.
+//
+// The executor must outlive its tasks; the destructor waits for them.
+class SerialExecutor {
+ public:
+  // Number of tasks run before yielding the worker.
+  enum : std::size_t { kMaxBatch = 32 };
+
+  explicit SerialExecutor(ThreadPool* pool) : pool_{pool} {}
+  ~SerialExecutor() { Wait(); }
+
+  SerialExecutor(const SerialExecutor&) = delete;
+  void operator=(const SerialExecutor&) = delete;
+
+  // Queues |task| to run after the tasks that were submitted before it.
+  void Submit(ThreadPool::Task task) {
+    bool start = false;
+    {
+      std::lock_guard<std::mutex> lock{mutex_};
+      tasks_.push_back(std::move(task));
+      if (!running_)
+        running_ = start = true;
+    }
+
+    if (start)
+      pool_->Submit([this] { Drain(); });
+  }
+
+  // Blocks until all of the submitted tasks have run. Must not be called from
+  // one of the tasks.
+  void Wait() {
+    std::unique_lock<std::mutex> lock{mutex_};
+    idle_.wait(lock, [this] { return !running_; });
+  }
+
+ private:
+  void Drain() {
+    for (std::size_t count = 0;; count++) {
+      ThreadPool::Task task;
+      {
+        std::lock_guard<std::mutex> lock{mutex_};
+        if (tasks_.empty()) {
+          running_ = false;
+          idle_.notify_all();
+          return;
+        } else if (count == kMaxBatch) {
+          break;
+        }
+
+        task = std::move(tasks_.front());
+        tasks_.pop_front();
+      }
+      task();
+    }
+
+    pool_->Submit([this] { Drain(); });
+  }
+
+  ThreadPool* pool_;
+  std::mutex mutex_;
+  std::condition_variable idle_;
+  std::deque<ThreadPool::Task> tasks_;
+  bool running_{false};
+};
+
+// Runs |function| once for each index in [0, |count|) on |pool| and the
+// calling thread, and returns when all of the calls have finished. Indices are
+// claimed dynamically, so uneven work balances across the workers.
+//
+// The calling thread claims indices alongside the workers rather than only
+// waiting for them, so ParallelFor() may be called from a task running on the
+// same pool without deadlocking, even when every other worker is busy.
+inline void ParallelFor(ThreadPool* pool, std::size_t count,
+                        const std::function<void(std::size_t)>& function) {
+  struct State {
+    const std::function<void(std::size_t)>* function;
+    std::size_t count;
+    std::atomic<std::size_t> next{0};
+    std::atomic<std::size_t> done{0};
+    std::mutex mutex;
+    std::condition_variable condition;
+
+    // Runs indices until none remain. Returns without touching |function|
+    // once every index has been claimed, so helpers that start late do not
+    // outlive the call.
+    void Run() {
+      std::size_t index;
+      while ((index = next.fetch_add(1)) < count) {
+        (*function)(index);
+        if (done.fetch_add(1) + 1 == count) {
+          std::lock_guard<std::mutex> lock{mutex};
+          condition.notify_all();
+        }
+      }
+    }
+  };
+
+  if (count == 0)
+    return;
+
+  // The helpers share ownership of the state because they may still be queued
+  // on the pool when the last index finishes.
+  auto state = std::make_shared<State>();
+  state->function = &function;
+  state->count = count;
+
+  const std::size_t helpers = std::min(pool->size(), count - 1);
+  for (std::size_t i = 0; i < helpers; i++)
+    pool->Submit([state] { state->Run(); });
+
+  state->Run();
+
+  std::unique_lock<std::mutex> lock{state->mutex};
+  state->condition.wait(lock, [&state] { return state->done == state->count; });
+}
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_THREAD_POOL_H_
@@ -0,0 +1,93 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_UNCHECKED_BUFFER_WRITER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_UNCHECKED_BUFFER_WRITER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <nop/base/encoding.h>
+#include <nop/base/utility.h>
+
+namespace nop {
+
+// A writer type that writes to a byte buffer through a bare cursor. It is the
+// unchecked writer that checked buffer writers hand to the Serializer once the
+// space for a value has been prepared; see WriterHasUnchecked. Instead of
+// tracking an index and capacity, each write only compares the cursor with the
+// end of the prepared space, so that an encoding whose Size() underestimates
+// its output fails with ErrorStatus::WriteLimitReached rather than writing past
+// the buffer.
+class UncheckedBufferWriter {
+ public:
+  UncheckedBufferWriter() = default;
+  UncheckedBufferWriter(const UncheckedBufferWriter&) = default;
+  UncheckedBufferWriter(std::uint8_t* cursor, std::uint8_t* end)
+      : cursor_{cursor}, end_{end} {}
+
+  UncheckedBufferWriter& operator=(const UncheckedBufferWriter&) = default;
+
+  // The space was prepared before this writer was created.
+  static constexpr bool kNeedsPrepare = false;
+
+  Status<void> Prepare(std::size_t /*size*/) { return {}; }
+
+  Status<void> Write(std::uint8_t byte) {
+    if (cursor_ == end_)
+      return ErrorStatus::WriteLimitReached;
+
+    *cursor_++ = byte;
+    return {};
+  }
+
+  template <typename T, typename Enable = EnableIfArithmetic<T>>
+  Status<void> Write(const T* begin, const T* end) {
+    const std::size_t length_bytes = (end - begin) * sizeof(T);
+    if (length_bytes > static_cast<std::size_t>(end_ - cursor_))
+      return ErrorStatus::WriteLimitReached;
+
+    std::memcpy(cursor_, begin, length_bytes);
+    cursor_ += length_bytes;
+    return {};
+  }
+
+  Status<void> Skip(std::size_t padding_bytes,
+                    std::uint8_t padding_value = 0x00) {
+    if (padding_bytes > static_cast<std::size_t>(end_ - cursor_))
+      return ErrorStatus::WriteLimitReached;
+
+    std::memset(cursor_, padding_value, padding_bytes);
+    cursor_ += padding_bytes;
+    return {};
+  }
+
+  // Returns the position of the next byte to write.
+  std::uint8_t* cursor() const { return cursor_; }
+
+  // Returns the end of the space this writer may write to.
+  std::uint8_t* end() const { return end_; }
+
+ private:
+  std::uint8_t* cursor_{nullptr};
+  std::uint8_t* end_{nullptr};
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_UNCHECKED_BUFFER_WRITER_H_
@@ -0,0 +1,247 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_UNIX_SOCKET_READER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_UNIX_SOCKET_READER_H_
+
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <nop/status.h>
+#include <nop/traits/is_template_base_of.h>
+#include <nop/types/file_handle.h>
+#include <nop/types/handle.h>
+#include <nop/utility/endian.h>
+#include <nop/utility/frame_writer.h>
+#include <nop/utility/pedantic_buffer_reader.h>
+#include <nop/utility/unix_socket_writer.h>
+
+namespace nop {
+
+// UnixSocketReader is a reader type that receives the messages and file
+// descriptors sent by UnixSocketWriter over a Unix domain stream socket.
+//
+// Receive() reads the next frame into memory together with the handles that
+// accompany it; the message is then decoded from memory with bounds checks.
+// Decoding a UniqueHandle type, such as UniqueFileHandle, transfers ownership
+// of the received handle to the value. Decoding an unmanaged Handle type,
+// such as FileHandle, borrows the handle, which remains open until the next
+// call to Receive(). Handles that the message does not claim are closed then
+// as well.
+//
+// Received handles have FD_CLOEXEC set. Frames that claim a length larger
+// than |max_message_size| result in ErrorStatus::ProtocolError.
+//
+// Example:
+//
+//   Deserializer<UnixSocketReader> deserializer{socket_fd};
+//   auto status = deserializer.reader().Receive();
+//   if (status)
+//     status = deserializer.Read(&frame_with_memfd);
+//
+class UnixSocketReader {
+ public:
+  // Default limit on the size of a message.
+  enum : std::size_t { kDefaultMaxMessageSize = 64 * 1024 * 1024 };
+
+  UnixSocketReader() = default;
+  UnixSocketReader(int fd,
+                   std::size_t max_message_size = kDefaultMaxMessageSize)
+      : fd_{fd}, max_message_size_{max_message_size} {}
+  UnixSocketReader(const UnixSocketReader&) = delete;
+  UnixSocketReader(UnixSocketReader&& other) { *this = std::move(other); }
+
+  ~UnixSocketReader() { Clear(); }
+
+  UnixSocketReader& operator=(const UnixSocketReader&) = delete;
+  UnixSocketReader& operator=(UnixSocketReader&& other) {
+    if (this != &other) {
+      Clear();
+      std::swap(fd_, other.fd_);
+      std::swap(max_message_size_, other.max_message_size_);
+      std::swap(buffer_, other.buffer_);
+      std::swap(handles_, other.handles_);
+      std::swap(reader_, other.reader_);
+    }
+    return *this;
+  }
+
+  void Clear() {
+    if (fd_ >= 0)
+      ::close(fd_);
+    fd_ = -1;
+    buffer_.clear();
+    handles_.clear();
+    reader_ = {};
+  }
+
+  int Release() {
+    const int released_fd = fd_;
+    fd_ = -1;
+    return released_fd;
+  }
+
+  // Receives the next message and its handles, replacing the previous
+  // message. Returns ErrorStatus::ReadLimitReached at the end of the stream.
+  Status<void> Receive() {
+    reader_ = {};
+    handles_.clear();
+
+    std::uint32_t header;
+    auto status = ReceiveBytes(&header, sizeof(header));
+    if (!status)
+      return status;
+
+    const std::size_t length = HostEndian<std::uint32_t>::FromLittle(header);
+    if (length > max_message_size_)
+      return ErrorStatus::ProtocolError;
+
+    buffer_.resize(length);
+    status = ReceiveBytes(buffer_.data(), length);
+    if (!status)
+      return status;
+
+    reader_ = PedanticBufferReader{buffer_.data(), buffer_.size()};
+    return {};
+  }
+
+  Status<void> Ensure(std::size_t size) { return reader_.Ensure(size); }
+  Status<void> Read(std::uint8_t* byte) { return reader_.Read(byte); }
+
+  template <typename T>
+  Status<void> Read(T* begin, T* end) {
+    return reader_.Read(begin, end);
+  }
+
+  Status<void> Skip(std::size_t padding_bytes) {
+    return reader_.Skip(padding_bytes);
+  }
+
+  // Views borrowed from the message remain valid until the next Receive().
+  Status<void> Borrow(std::size_t size, const void** data) {
+    return reader_.Borrow(size, data);
+  }
+
+  template <typename HandleType>
+  Status<HandleType> GetHandle(HandleReference handle_reference) {
+    static_assert(std::is_same<typename HandleType::Type, int>::value,
+                  "Only file descriptors may be received over a Unix socket.");
+
+    if (handle_reference == kEmptyHandleReference)
+      return HandleType{};
+    if (handle_reference < 0 ||
+        static_cast<std::size_t>(handle_reference) >= handles_.size() ||
+        !handles_[handle_reference]) {
+      return ErrorStatus::InvalidHandleReference;
+    }
+
+    return TakeHandle<HandleType>(&handles_[handle_reference],
+                                  IsTemplateBaseOf<UniqueHandle, HandleType>{});
+  }
+
+  // Returns true if the current message has been read completely.
+  bool empty() const { return reader_.empty(); }
+
+  // Returns the number of handles received with the current message.
+  std::size_t handle_count() const { return handles_.size(); }
+
+  std::size_t max_message_size() const { return max_message_size_; }
+  int fd() const { return fd_; }
+
+ private:
+  template <typename HandleType>
+  static HandleType TakeHandle(UniqueFileHandle* handle, std::true_type) {
+    return HandleType{handle->release()};
+  }
+
+  template <typename HandleType>
+  static HandleType TakeHandle(UniqueFileHandle* handle, std::false_type) {
+    return HandleType{handle->get()};
+  }
+
+  // Receives exactly |size| bytes, collecting any handles that arrive with
+  // them.
+  Status<void> ReceiveBytes(void* data, std::size_t size) {
+    std::uint8_t* bytes = static_cast<std::uint8_t*>(data);
+    const std::size_t control_size =
+        CMSG_SPACE(UnixSocketWriter::kMaxHandles * sizeof(int));
+    alignas(cmsghdr) std::uint8_t control[control_size];
+
+    while (size > 0) {
+      iovec iov{bytes, size};
+      msghdr message;
+      std::memset(&message, 0, sizeof(message));
+      message.msg_iov = &iov;
+      message.msg_iovlen = 1;
+      message.msg_control = control;
+      message.msg_controllen = control_size;
+
+      const ssize_t ret = ::recvmsg(fd_, &message, MSG_CMSG_CLOEXEC);
+      if (ret < 0) {
+        if (errno == EINTR)
+          continue;
+        return ErrorStatus::IOError;
+      } else if (ret == 0) {
+        return ErrorStatus::ReadLimitReached;
+      }
+
+      for (cmsghdr* header = CMSG_FIRSTHDR(&message); header != nullptr;
+           header = CMSG_NXTHDR(&message, header)) {
+        if (header->cmsg_level != SOL_SOCKET ||
+            header->cmsg_type != SCM_RIGHTS) {
+          continue;
+        }
+
+        const std::size_t count =
+            (header->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        for (std::size_t i = 0; i < count; i++) {
+          int fd;
+          std::memcpy(&fd, CMSG_DATA(header) + i * sizeof(int), sizeof(fd));
+          handles_.emplace_back(fd);
+        }
+      }
+
+      // Handles that did not fit were closed by the kernel.
+      if (message.msg_flags & MSG_CTRUNC)
+        return ErrorStatus::ProtocolError;
+
+      bytes += ret;
+      size -= ret;
+    }
+
+    return {};
+  }
+
+  int fd_{-1};
+  std::size_t max_message_size_{kDefaultMaxMessageSize};
+  std::vector<std::uint8_t> buffer_;
+  std::vector<UniqueFileHandle> handles_;
+  PedanticBufferReader reader_;
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_UNIX_SOCKET_READER_H_
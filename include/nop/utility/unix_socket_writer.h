@@ -0,0 +1,214 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_UNIX_SOCKET_WRITER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_UNIX_SOCKET_WRITER_H_
+
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <nop/status.h>
+#include <nop/types/handle.h>
+#include <nop/utility/frame_writer.h>
+#include <nop/utility/vector_writer.h>
+
+namespace nop {
+
+// UnixSocketWriter is a writer type that sends messages with file descriptors
+// over a Unix domain stream socket.
+//
+// The bytes of a message are accumulated in memory, and the file handles
+// pushed while encoding it are collected alongside. Send() then transmits the
+// message as a length-prefixed frame, in the format written by FrameWriter,
+// with all of its handles in one SCM_RIGHTS ancillary block attached to the
+// first byte of the frame. UnixSocketReader receives the frame and its handles
+// together, so no side channel is needed to pair them up.
+//
+// Pushed handles are referenced, not owned: they must stay open until Send()
+// returns, after which the receiver holds its own duplicates.
+//
+// Example:
+//
+//   Serializer<UnixSocketWriter> serializer{socket_fd};
+//   auto status = serializer.Write(frame_with_memfd);
+//   if (status)
+//     status = serializer.writer().Send();
+//
+class UnixSocketWriter {
+ public:
+  // Maximum number of handles per message, the kernel's SCM_MAX_FD.
+  enum : std::size_t { kMaxHandles = 253 };
+
+  UnixSocketWriter() { detail::BeginFrame(&buffer_); }
+  UnixSocketWriter(int fd) : fd_{fd} { detail::BeginFrame(&buffer_); }
+  UnixSocketWriter(const UnixSocketWriter&) = delete;
+  UnixSocketWriter(UnixSocketWriter&& other) { *this = std::move(other); }
+
+  ~UnixSocketWriter() { Clear(); }
+
+  UnixSocketWriter& operator=(const UnixSocketWriter&) = delete;
+  UnixSocketWriter& operator=(UnixSocketWriter&& other) {
+    if (this != &other) {
+      Clear();
+      std::swap(fd_, other.fd_);
+      std::swap(buffer_, other.buffer_);
+      std::swap(handles_, other.handles_);
+    }
+    return *this;
+  }
+
+  void Clear() {
+    if (fd_ >= 0)
+      ::close(fd_);
+    fd_ = -1;
+    Discard();
+  }
+
+  int Release() {
+    const int released_fd = fd_;
+    fd_ = -1;
+    return released_fd;
+  }
+
+  Status<void> Prepare(std::size_t size) { return buffer_.Prepare(size); }
+  Status<void> Write(std::uint8_t byte) { return buffer_.Write(byte); }
+
+  template <typename T>
+  Status<void> Write(const T* begin, const T* end) {
+    return buffer_.Write(begin, end);
+  }
+
+  Status<void> Skip(std::size_t padding_bytes,
+                    std::uint8_t padding_value = 0x00) {
+    return buffer_.Skip(padding_bytes, padding_value);
+  }
+
+  // Adds |handle| to the handles of the current message and returns its
+  // reference. Returns ErrorStatus::WriteLimitReached when the message already
+  // carries kMaxHandles handles.
+  template <typename HandleType>
+  Status<HandleReference> PushHandle(const HandleType& handle) {
+    static_assert(std::is_same<typename HandleType::Type, int>::value,
+                  "Only file descriptors may be sent over a Unix socket.");
+
+    if (!handle)
+      return {kEmptyHandleReference};
+    if (handles_.size() >= kMaxHandles)
+      return ErrorStatus::WriteLimitReached;
+
+    handles_.push_back(handle.get());
+    return {static_cast<HandleReference>(handles_.size() - 1)};
+  }
+
+  // Sends the current message and its handles, then starts a new message. The
+  // message is discarded if sending fails.
+  Status<void> Send() {
+    auto status = detail::EndFrame(&buffer_);
+    if (status)
+      status = SendFrame();
+
+    Discard();
+    return status;
+  }
+
+  // Discards the current message and its handles.
+  void Discard() {
+    detail::BeginFrame(&buffer_);
+    handles_.clear();
+  }
+
+  // Returns the number of bytes of the current message written so far.
+  std::size_t offset() const {
+    return buffer_.size() - kFrameHeaderSize;
+  }
+
+  // Overwrites bytes of the current message at |offset|, which is relative to
+  // the start of the message. Allows ExactTableEntries<UnixSocketWriter> to
+  // write table entries without padding.
+  Status<void> Patch(std::size_t offset, const std::uint8_t* begin,
+                     const std::uint8_t* end) {
+    return buffer_.Patch(offset + kFrameHeaderSize, begin, end);
+  }
+
+  // Returns the number of handles in the current message.
+  std::size_t handle_count() const { return handles_.size(); }
+
+  int fd() const { return fd_; }
+
+ private:
+  Status<void> SendFrame() {
+    const std::uint8_t* data = buffer_.data();
+    std::size_t remaining = buffer_.size();
+
+    const std::size_t control_size = CMSG_SPACE(kMaxHandles * sizeof(int));
+    alignas(cmsghdr) std::uint8_t control[control_size];
+
+    bool send_handles = !handles_.empty();
+    while (remaining > 0) {
+      iovec iov{const_cast<std::uint8_t*>(data), remaining};
+      msghdr message;
+      std::memset(&message, 0, sizeof(message));
+      message.msg_iov = &iov;
+      message.msg_iovlen = 1;
+
+      // The handles accompany the first chunk of the frame only.
+      if (send_handles) {
+        const std::size_t handles_size = handles_.size() * sizeof(int);
+        message.msg_control = control;
+        message.msg_controllen = CMSG_SPACE(handles_size);
+
+        cmsghdr* header = CMSG_FIRSTHDR(&message);
+        header->cmsg_level = SOL_SOCKET;
+        header->cmsg_type = SCM_RIGHTS;
+        header->cmsg_len = CMSG_LEN(handles_size);
+        std::memcpy(CMSG_DATA(header), handles_.data(), handles_size);
+      }
+
+      const ssize_t ret = ::sendmsg(fd_, &message, MSG_NOSIGNAL);
+      if (ret < 0) {
+        if (errno == EINTR)
+          continue;
+        return ErrorStatus::IOError;
+      } else if (ret == 0) {
+        return ErrorStatus::WriteLimitReached;
+      }
+
+      send_handles = false;
+      data += ret;
+      remaining -= ret;
+    }
+
+    return {};
+  }
+
+  int fd_{-1};
+  VectorWriter buffer_;
+  std::vector<int> handles_;
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_UNIX_SOCKET_WRITER_H_
@@ -0,0 +1,56 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_VALIDATE_BUFFER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_VALIDATE_BUFFER_H_
+
+#include <cstddef>
+
+#include <nop/base/skip.h>
+#include <nop/status.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/pedantic_buffer_reader.h>
+
+namespace nop {
+
+// Validates that the |size| bytes at |data| consist entirely of well formed
+// encoded values, as checked by ValidateValue(), and returns a BufferReader
+// over the buffer on success.
+//
+// This is intended for messages from untrusted peers: the buffer is walked
+// once with bounds checks on every access, and runs of fixints are scanned in
+// bulk. Malformed messages, including those with container lengths larger
+// than the buffer, are rejected before any decoding work or allocation takes
+// place. Validated buffers are then decoded with the lighter BufferReader.
+//
+// Validation does not check that the values match the types they are decoded
+// as; the Deserializer still checks the encoding of each value it reads.
+inline Status<BufferReader> ValidateBuffer(
+    const void* data, std::size_t size,
+    std::size_t max_depth = kDefaultMaxValueDepth) {
+  PedanticBufferReader reader{data, size};
+  while (!reader.empty()) {
+    auto status = ValidateValue(&reader, max_depth);
+    if (!status)
+      return status.error();
+  }
+
+  return BufferReader{data, size};
+}
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_VALIDATE_BUFFER_H_
@@ -0,0 +1,161 @@
+/*
+ * Copyright 2018 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_VECTOR_WRITER_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_VECTOR_WRITER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include <nop/base/encoding.h>
+#include <nop/base/utility.h>
+
+namespace nop {
+
+// VectorWriter is a writer type that serializes into an internal, growable byte
+// buffer. The buffer grows geometrically in the Prepare() method to fit the
+// size computed by the Serializer, after which Write() and Skip() copy without
+// bounds checks, in the same way as BufferWriter. This type is safe for use
+// with the library-provided Serializer types, which predicate serialization on
+// the result of Prepare().
+//
+// The buffer is retained across calls to Reset(), so that a long-lived writer
+// reaches a steady state where serializing a message does not allocate.
+class VectorWriter {
+ public:
+  VectorWriter() = default;
+  VectorWriter(const VectorWriter&) = default;
+  VectorWriter(VectorWriter&&) = default;
+
+  // Constructs a writer with at least |capacity| bytes of storage reserved.
+  explicit VectorWriter(std::size_t capacity) : buffer_(capacity) {}
+
+  // Constructs a writer that adopts the capacity of |storage|, for example a
+  // buffer taken from a BufferPool. The contents of |storage| are discarded.
+  explicit VectorWriter(std::vector<std::uint8_t>&& storage)
+      : buffer_(std::move(storage)) {
+    buffer_.resize(buffer_.capacity());
+  }
+
+  VectorWriter& operator=(const VectorWriter&) = default;
+  VectorWriter& operator=(VectorWriter&&) = default;
+
+  Status<void> Prepare(std::size_t size) {
+    if (size > buffer_.size() - index_)
+      Grow(index_ + size);
+    return {};
+  }
+
+  Status<void> Write(std::uint8_t byte) { return Write(&byte, &byte + 1); }
+
+  template <typename T, typename Enable = EnableIfArithmetic<T>>
+  Status<void> Write(const T* begin, const T* end) {
+    const std::size_t element_size = sizeof(T);
+    const std::size_t length = end - begin;
+    const std::size_t length_bytes = length * element_size;
+    if (length_bytes == 0)
+      return {};
+
+    std::memcpy(buffer_.data() + index_, begin, length_bytes);
+    index_ += length_bytes;
+    return {};
+  }
+
+  Status<void> Skip(std::size_t padding_bytes,
+                    std::uint8_t padding_value = 0x00) {
+    if (padding_bytes == 0)
+      return {};
+
+    std::memset(buffer_.data() + index_, padding_value, padding_bytes);
+    index_ += padding_bytes;
+    return {};
+  }
+
+  // Overwrites previously written bytes; see ExactTableEntries.
+  Status<void> Patch(std::size_t offset, const std::uint8_t* begin,
+                     const std::uint8_t* end) {
+    const std::size_t length_bytes = end - begin;
+    if (offset > index_ || length_bytes > index_ - offset)
+      return ErrorStatus::WriteLimitReached;
+
+    if (length_bytes != 0)
+      std::memcpy(buffer_.data() + offset, begin, length_bytes);
+    return {};
+  }
+
+  // Discards the serialized data while keeping the storage for reuse.
+  void Reset() { index_ = 0; }
+
+  // Discards the data written after |offset|, for example to roll back a
+  // partially serialized value.
+  void Truncate(std::size_t offset) {
+    if (offset < index_)
+      index_ = offset;
+  }
+
+  // Releases the storage that exceeds the currently serialized data.
+  void Shrink() {
+    buffer_.resize(index_);
+    buffer_.shrink_to_fit();
+  }
+
+  // Moves the serialized data out of the writer. The writer is left empty and
+  // without storage.
+  std::vector<std::uint8_t> Take() {
+    std::vector<std::uint8_t> data;
+    buffer_.resize(index_);
+    buffer_.swap(data);
+    index_ = 0;
+    return data;
+  }
+
+  // Moves the storage out of the writer, with its full capacity, for reuse by
+  // another writer. The writer is left empty and without storage.
+  std::vector<std::uint8_t> TakeStorage() {
+    std::vector<std::uint8_t> storage;
+    buffer_.swap(storage);
+    index_ = 0;
+    return storage;
+  }
+
+  const std::uint8_t* data() const { return buffer_.data(); }
+  std::uint8_t* data() { return buffer_.data(); }
+
+  std::size_t offset() const { return index_; }
+  std::size_t size() const { return index_; }
+  std::size_t capacity() const { return buffer_.size(); }
+
+ private:
+  void Grow(std::size_t required_size) {
+    // Grow geometrically to amortize the cost of reallocation and copying over
+    // repeated Prepare() calls on the same writer.
+    std::size_t new_size = buffer_.size() * 2;
+    if (new_size < required_size)
+      new_size = required_size;
+
+    buffer_.resize(new_size);
+  }
+
+  std::vector<std::uint8_t> buffer_;
+  std::size_t index_{0};
+};
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_VECTOR_WRITER_H_
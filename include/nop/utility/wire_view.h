@@ -0,0 +1,235 @@
+/*
+ * Copyright 2017 The Native Object Protocols Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBNOP_INCLUDE_NOP_UTILITY_WIRE_VIEW_H_
+#define LIBNOP_INCLUDE_NOP_UTILITY_WIRE_VIEW_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <nop/base/encoding.h>
+#include <nop/base/skip.h>
+#include <nop/status.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/endian.h>
+
+namespace nop {
+
+// Broad classes of encoded values reported by InspectValue().
+enum class WireKind : std::uint8_t {
+  Nil,
+  Integer,
+  Float,
+  String,
+  Binary,
+  Array,
+  Map,
+  Structure,
+  Other,
+};
+
+// Description of one encoded value, located by InspectValue() without
+// decoding the value and without copying it.
+struct WireValue {
+  EncodingByte prefix{EncodingByte::Nil};
+  WireKind kind{WireKind::Nil};
+
+  // Number of elements of an array, pairs of a map or members of a structure,
+  // or the number of payload bytes of a string or binary value.
+  std::uint64_t count{0};
+
+  // Number of bytes from the start of the value to its payload, or to its
+  // first element or member.
+  std::size_t header{0};
+
+  // Total number of encoded bytes of the value.
+  std::size_t size{0};
+
+  // For arrays of floating point values, which are encoded with a prefix for
+  // each element, the distance in bytes between consecutive elements. Zero for
+  // other values.
+  std::size_t stride{0};
+
+  // The value of integers and floating point values. Unsigned values greater
+  // than the maximum int64_t are stored in |unsigned_integer| only.
+  std::int64_t integer{0};
+  std::uint64_t unsigned_integer{0};
+  double real{0.0};
+};
+
+namespace detail {
+
+// Reads a little-endian value of type T from |data|.
+template <typename T>
+T LoadLittle(const std::uint8_t* data) {
+  T value;
+  std::memcpy(&value, data, sizeof(T));
+  return HostEndian<T>::FromLittle(value);
+}
+
+// Returns the number of payload bytes of the fixed width integer and floating
+// point |prefix|.
+inline std::size_t ScalarPayloadSize(EncodingByte prefix) {
+  switch (prefix) {
+    case EncodingByte::U8:
+    case EncodingByte::I8:
+      return 1;
+    case EncodingByte::U16:
+    case EncodingByte::I16:
+      return 2;
+    case EncodingByte::U32:
+    case EncodingByte::I32:
+    case EncodingByte::F32:
+      return 4;
+    case EncodingByte::U64:
+    case EncodingByte::I64:
+    case EncodingByte::F64:
+      return 8;
+    default:
+      return 0;
+  }
+}
+
+}  // namespace detail
+
+// Describes the encoded value at the start of the |size| bytes at |data|. The
+// whole value is checked to lie within the buffer; the elements of containers
+// are not otherwise validated. Elements and members are located by calling
+// InspectValue() again at |header| bytes into the value, and at the |size| of
+// each element after that.
+//
+// This interface is intended for consumers that navigate encoded data without
+// knowing the C++ types, such as bindings for other languages, and that want
+// to refer to payloads in place rather than copy them out.
+inline Status<WireValue> InspectValue(const void* data, std::size_t size) {
+  const std::uint8_t* bytes = static_cast<const std::uint8_t*>(data);
+  BufferReader reader{bytes, size};
+  auto status = SkipValue(&reader);
+  if (!status)
+    return status.error();
+
+  WireValue value;
+  value.size = size - reader.remaining();
+  value.prefix = static_cast<EncodingByte>(bytes[0]);
+  value.header = 1;
+
+  const EncodingByte prefix = value.prefix;
+  const std::uint8_t* payload = bytes + 1;
+  if (prefix <= EncodingByte::PositiveFixIntMax) {
+    value.kind = WireKind::Integer;
+    value.integer = bytes[0];
+    value.unsigned_integer = bytes[0];
+  } else if (prefix >= EncodingByte::NegativeFixIntMin) {
+    value.kind = WireKind::Integer;
+    value.integer = static_cast<std::int8_t>(bytes[0]);
+    value.unsigned_integer = static_cast<std::uint64_t>(value.integer);
+  } else if (prefix >= EncodingByte::U8 && prefix <= EncodingByte::I64) {
+    value.kind = WireKind::Integer;
+    switch (prefix) {
+      case EncodingByte::U8:
+        value.unsigned_integer = payload[0];
+        break;
+      case EncodingByte::U16:
+        value.unsigned_integer = detail::LoadLittle<std::uint16_t>(payload);
+        break;
+      case EncodingByte::U32:
+        value.unsigned_integer = detail::LoadLittle<std::uint32_t>(payload);
+        break;
+      case EncodingByte::U64:
+        value.unsigned_integer = detail::LoadLittle<std::uint64_t>(payload);
+        break;
+      case EncodingByte::I8:
+        value.integer = static_cast<std::int8_t>(payload[0]);
+        break;
+      case EncodingByte::I16:
+        value.integer = detail::LoadLittle<std::int16_t>(payload);
+        break;
+      case EncodingByte::I32:
+        value.integer = detail::LoadLittle<std::int32_t>(payload);
+        break;
+      default:
+        value.integer = detail::LoadLittle<std::int64_t>(payload);
+        break;
+    }
+    if (prefix <= EncodingByte::U64)
+      value.integer = static_cast<std::int64_t>(value.unsigned_integer);
+    else
+      value.unsigned_integer = static_cast<std::uint64_t>(value.integer);
+  } else if (prefix == EncodingByte::F32) {
+    value.kind = WireKind::Float;
+    value.real = detail::LoadLittle<float>(payload);
+  } else if (prefix == EncodingByte::F64) {
+    value.kind = WireKind::Float;
+    value.real = detail::LoadLittle<double>(payload);
+  } else if (prefix == EncodingByte::Nil) {
+    value.kind = WireKind::Nil;
+  } else if (prefix == EncodingByte::String ||
+             prefix == EncodingByte::Binary ||
+             prefix == EncodingByte::Array || prefix == EncodingByte::Map ||
+             prefix == EncodingByte::Structure) {
+    BufferReader header_reader{payload, size - 1};
+    SizeType count = 0;
+    status = Encoding<SizeType>::Read(&count, &header_reader);
+    if (!status)
+      return status.error();
+
+    value.count = count;
+    value.header = size - header_reader.remaining();
+    switch (prefix) {
+      case EncodingByte::String:
+        value.kind = WireKind::String;
+        break;
+      case EncodingByte::Binary:
+        value.kind = WireKind::Binary;
+        break;
+      case EncodingByte::Array:
+        value.kind = WireKind::Array;
+        break;
+      case EncodingByte::Map:
+        value.kind = WireKind::Map;
+        break;
+      default:
+        value.kind = WireKind::Structure;
+        break;
+    }
+  } else {
+    value.kind = WireKind::Other;
+  }
+
+  // Arrays of floating point values have a fixed stride when every element
+  // has the same prefix.
+  if (value.kind == WireKind::Array && value.count > 0) {
+    const EncodingByte element = static_cast<EncodingByte>(bytes[value.header]);
+    if (element == EncodingByte::F32 || element == EncodingByte::F64) {
+      const std::size_t stride = 1 + detail::ScalarPayloadSize(element);
+      if ((value.size - value.header) / stride == value.count &&
+          (value.size - value.header) % stride == 0) {
+        std::size_t offset = value.header;
+        while (offset < value.size && bytes[offset] == bytes[value.header])
+          offset += stride;
+        if (offset == value.size)
+          value.stride = stride;
+      }
+    }
+  }
+
+  return value;
+}
+
+}  // namespace nop
+
+#endif  // LIBNOP_INCLUDE_NOP_UTILITY_WIRE_VIEW_H_
@@ -0,0 +1,227 @@
+# Copyright 2018 The Native Object Protocols Authors
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+#
+# Zero-copy, lazy views of libnop messages.
+#
+# The structures of a message are described by a shared library built with
+# nop/utility/python_module.h, which exports the schema of the structures and
+# a function that locates encoded values in a buffer. Views decode members only
+# when they are accessed. Vectors of integral values, which are encoded as
+# contiguous little-endian binary data, are returned as NumPy arrays, or
+# memoryviews when NumPy is not available, that point into the source buffer.
+# Vectors of floating point values, which are encoded with a prefix on each
+# element, are returned as strided NumPy arrays that also point into the
+# buffer.
+#
+# The buffer must stay alive and unmodified while views of it are in use.
+#
+# Example:
+#
+#   module = nop_view.Module('./libsamples.so')
+#   sample = module.view('Sample', data)
+#   print(sample.timestamp, sample.values.mean())
+#
+
+import ast
+import ctypes
+
+try:
+  import numpy
+except ImportError:
+  numpy = None
+
+# Mirrors nop::WireKind.
+NIL, INTEGER, FLOAT, STRING, BINARY, ARRAY, MAP, STRUCTURE, OTHER = range(9)
+
+# Mirrors nop::PythonWireValue.
+class WireValue(ctypes.Structure):
+  _fields_ = (('count', ctypes.c_uint64), ('header', ctypes.c_uint64),
+              ('size', ctypes.c_uint64), ('stride', ctypes.c_uint64),
+              ('integer', ctypes.c_int64),
+              ('unsigned_integer', ctypes.c_uint64), ('real', ctypes.c_double),
+              ('prefix', ctypes.c_uint8), ('kind', ctypes.c_uint8))
+
+# Element type descriptors of the schema to struct module format characters.
+_FORMATS = {
+  'i1': 'b', 'u1': 'B', 'i2': 'h', 'u2': 'H', 'i4': 'i', 'u4': 'I',
+  'i8': 'q', 'u8': 'Q', 'f4': 'f', 'f8': 'd',
+}
+
+class DecodeError(Exception):
+  pass
+
+def _address(view):
+  """Returns the address of the contents of a contiguous byte memoryview."""
+  if not view.readonly:
+    return ctypes.addressof((ctypes.c_char * len(view)).from_buffer(view))
+  if isinstance(view.obj, bytes) and len(view) == len(view.obj):
+    return ctypes.cast(ctypes.c_char_p(view.obj), ctypes.c_void_p).value
+  if numpy is not None:
+    return numpy.frombuffer(view, numpy.uint8).ctypes.data
+  raise TypeError('Read-only buffers other than bytes require NumPy.')
+
+class Module(object):
+  """Schema and inspection functions loaded from a shared library."""
+
+  def __init__(self, path):
+    self._library = ctypes.CDLL(path)
+    self._library.nop_python_schema.restype = ctypes.c_char_p
+    self._library.nop_python_inspect.restype = ctypes.c_int
+    self._library.nop_python_inspect.argtypes = (
+        ctypes.c_void_p, ctypes.c_size_t, ctypes.POINTER(WireValue))
+    self.schema = ast.literal_eval(
+        self._library.nop_python_schema().decode('utf-8'))
+
+  def view(self, name, buffer, offset=0):
+    """Returns a lazy view of the structure |name| encoded in |buffer|."""
+    return _Buffer(self, buffer).decode(name, offset)
+
+class _Buffer(object):
+  """A source buffer and the decoding of values at offsets within it."""
+
+  def __init__(self, module, buffer):
+    self.module = module
+    self.view = memoryview(buffer).cast('B')
+    self.address = _address(self.view)
+
+  def inspect(self, offset):
+    value = WireValue()
+    error = self.module._library.nop_python_inspect(
+        self.address + offset, len(self.view) - offset, ctypes.byref(value))
+    if error != 0:
+      raise DecodeError('Failed to decode value at offset %d: error %d' %
+                        (offset, -error))
+    return value
+
+  def decode(self, descriptor, offset):
+    value = self.inspect(offset)
+    if isinstance(descriptor, tuple):
+      kind, element = descriptor
+      if kind == 'optional':
+        return None if value.kind == NIL else self.decode(element, offset)
+      if kind == 'array':
+        return self.array(element, offset, value)
+      return LazyList(self, element, offset, value)
+
+    if descriptor in self.module.schema:
+      if value.kind != STRUCTURE:
+        raise DecodeError('Expected %s at offset %d' % (descriptor, offset))
+      return LazyStruct(self, descriptor, offset, value)
+    if descriptor == 'any':
+      return self.decode_any(offset, value)
+    if descriptor == 'str':
+      return str(self.bytes(offset, value), 'utf-8')
+    if descriptor == 'bool':
+      return bool(value.integer)
+    if descriptor.startswith('u'):
+      return value.unsigned_integer
+    if descriptor.startswith('i'):
+      return value.integer
+    return value.real if value.kind == FLOAT else value.integer
+
+  def decode_any(self, offset, value):
+    if value.kind == NIL:
+      return None
+    if value.kind == INTEGER:
+      return value.integer
+    if value.kind == FLOAT:
+      return value.real
+    if value.kind == STRING:
+      return str(self.bytes(offset, value), 'utf-8')
+    if value.kind == BINARY:
+      return self.bytes(offset, value)
+    if value.kind in (ARRAY, STRUCTURE):
+      return LazyList(self, 'any', offset, value)
+    return self.view[offset:offset + value.size]
+
+  def bytes(self, offset, value):
+    """Returns the payload of a string or binary value without copying."""
+    return self.view[offset + value.header:offset + value.size]
+
+  def array(self, element, offset, value):
+    format = _FORMATS[element]
+    if value.kind == BINARY:
+      payload = self.bytes(offset, value)
+      if numpy is not None:
+        return numpy.frombuffer(payload, numpy.dtype('<' + format))
+      return payload.cast(format)
+    if value.kind == ARRAY and value.stride and numpy is not None:
+      # Skip the prefix of the first element and step over the prefix of each
+      # following element.
+      return numpy.ndarray(shape=(value.count,),
+                           dtype=numpy.dtype('<' + format),
+                           buffer=self.view, offset=offset + value.header + 1,
+                           strides=(value.stride,))
+    return list(LazyList(self, element, offset, value))
+
+class LazyList(object):
+  """Sequence of elements decoded on access."""
+
+  def __init__(self, buffer, element, offset, value):
+    self._buffer = buffer
+    self._element = element
+    self._count = value.count
+    # Offsets of the elements located so far.
+    self._offsets = [offset + value.header]
+
+  def _offset(self, index):
+    while len(self._offsets) <= index:
+      last = self._offsets[-1]
+      self._offsets.append(last + self._buffer.inspect(last).size)
+    return self._offsets[index]
+
+  def __len__(self):
+    return self._count
+
+  def __getitem__(self, index):
+    if index < 0:
+      index += self._count
+    if index < 0 or index >= self._count:
+      raise IndexError('Index out of range')
+    return self._buffer.decode(self._element, self._offset(index))
+
+  def __iter__(self):
+    for index in range(self._count):
+      yield self[index]
+
+class LazyStruct(object):
+  """Structure whose members are decoded on first access and then cached."""
+
+  def __init__(self, buffer, name, offset, value):
+    members = buffer.module.schema[name]
+    if value.count != len(members):
+      raise DecodeError('Expected %d members of %s, found %d' %
+                        (len(members), name, value.count))
+    self._name = name
+    self._members = LazyList(buffer, None, offset, value)
+    self._types = dict((member, (index, descriptor)) for index, (
+        member, descriptor) in enumerate(members))
+
+  def __getattr__(self, member):
+    if member.startswith('_') or member not in self._types:
+      raise AttributeError(member)
+    index, descriptor = self._types[member]
+    value = self._members._buffer.decode(descriptor,
+                                         self._members._offset(index))
+    setattr(self, member, value)
+    return value
+
+  def __dir__(self):
+    return sorted(self._types)
+
+  def __repr__(self):
+    return '%s{%s}' % (self._name, ', '.join(
+        '%s=%r' % (member, getattr(self, member))
+        for member, _ in self._members._buffer.module.schema[self._name]))
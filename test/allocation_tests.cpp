@@ -0,0 +1,365 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Allocation accounting tests. This file replaces the global allocation
+// functions to count the allocations made by each thread, so it is built into
+// its own executable, alloc_test, to keep the counting allocator out of the
+// other tests.
+//
+// Every writer is expected to encode without allocating once its buffer is
+// prepared, and decoding is expected to allocate exactly the storage of the
+// decoded value, or nothing at all when the storage is reused.
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <map>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <nop/serializer.h>
+#include <nop/structure.h>
+#include <nop/table.h>
+#include <nop/types/optional.h>
+#include <nop/types/variant.h>
+#include <nop/utility/buffer_pool.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/buffer_writer.h>
+#include <nop/utility/pedantic_buffer_reader.h>
+#include <nop/utility/pedantic_buffer_writer.h>
+#include <nop/utility/reuse_storage.h>
+#include <nop/utility/vector_writer.h>
+
+namespace {
+
+// Allocations made by the current thread.
+thread_local std::size_t g_allocation_count = 0;
+
+void* CountedAllocate(std::size_t size) {
+  g_allocation_count++;
+  if (void* pointer = std::malloc(size ? size : 1))
+    return pointer;
+  throw std::bad_alloc{};
+}
+
+}  // anonymous namespace
+
+void* operator new(std::size_t size) { return CountedAllocate(size); }
+void* operator new[](std::size_t size) { return CountedAllocate(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+  g_allocation_count++;
+  return std::malloc(size ? size : 1);
+}
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+  g_allocation_count++;
+  return std::malloc(size ? size : 1);
+}
+void operator delete(void* pointer) noexcept { std::free(pointer); }
+void operator delete[](void* pointer) noexcept { std::free(pointer); }
+void operator delete(void* pointer, std::size_t) noexcept {
+  std::free(pointer);
+}
+void operator delete[](void* pointer, std::size_t) noexcept {
+  std::free(pointer);
+}
+
+using nop::BufferReader;
+using nop::BufferWriter;
+using nop::Deserializer;
+using nop::Encoding;
+using nop::Entry;
+using nop::Optional;
+using nop::PedanticBufferReader;
+using nop::PedanticBufferWriter;
+using nop::PooledWriter;
+using nop::ReuseStorage;
+using nop::Serializer;
+using nop::Variant;
+using nop::VectorWriter;
+
+namespace {
+
+// Returns the number of allocations made by |op| on the calling thread.
+template <typename Op>
+std::size_t CountAllocations(Op op) {
+  const std::size_t start = g_allocation_count;
+  op();
+  return g_allocation_count - start;
+}
+
+// Strings longer than any small string optimization, so that each string
+// accounts for exactly one allocation.
+const std::string kLong = "a string that is too long to be stored inline";
+
+struct Record {
+  std::uint64_t id;
+  std::vector<std::uint8_t> payload;
+  std::string name;
+  NOP_STRUCTURE(Record, id, payload, name);
+};
+
+struct Settings {
+  Entry<std::uint32_t, 0> version;
+  Entry<std::string, 1> owner;
+  NOP_TABLE_NS("Settings", Settings, version, owner);
+};
+
+//
+// Cases. Each case defines the value to encode and the number of allocations
+// expected to decode it into a default constructed value.
+//
+
+struct IntegerCase {
+  static const char* Name() { return "Integer"; }
+  using Type = std::int64_t;
+  static Type Make() { return -123456789; }
+  enum : std::size_t { kDecodeAllocations = 0 };
+};
+
+struct StringCase {
+  static const char* Name() { return "String"; }
+  using Type = std::string;
+  static Type Make() { return kLong; }
+  enum : std::size_t { kDecodeAllocations = 1 };
+};
+
+struct IntegralVectorCase {
+  static const char* Name() { return "IntegralVector"; }
+  using Type = std::vector<std::uint32_t>;
+  static Type Make() { return Type(256, 0x12345678); }
+  enum : std::size_t { kDecodeAllocations = 1 };
+};
+
+struct StringVectorCase {
+  static const char* Name() { return "StringVector"; }
+  using Type = std::vector<std::string>;
+  static Type Make() { return {kLong, kLong, kLong}; }
+  enum : std::size_t { kDecodeAllocations = 4 };
+};
+
+struct ArrayCase {
+  static const char* Name() { return "Array"; }
+  using Type = std::array<std::uint16_t, 16>;
+  static Type Make() { return {{1, 2, 3, 4, 5}}; }
+  enum : std::size_t { kDecodeAllocations = 0 };
+};
+
+struct MapCase {
+  static const char* Name() { return "Map"; }
+  using Type = std::map<int, std::string>;
+  static Type Make() { return {{1, kLong}, {2, kLong}}; }
+  enum : std::size_t { kDecodeAllocations = 4 };
+};
+
+struct VariantCase {
+  static const char* Name() { return "Variant"; }
+  using Type = Variant<int, std::string>;
+  static Type Make() { return Type{kLong}; }
+  enum : std::size_t { kDecodeAllocations = 1 };
+};
+
+struct OptionalCase {
+  static const char* Name() { return "Optional"; }
+  using Type = Optional<std::vector<std::uint32_t>>;
+  static Type Make() { return {std::vector<std::uint32_t>(16, 7)}; }
+  enum : std::size_t { kDecodeAllocations = 1 };
+};
+
+struct StructureCase {
+  static const char* Name() { return "Structure"; }
+  using Type = Record;
+  static Type Make() { return {7, std::vector<std::uint8_t>(64, 1), kLong}; }
+  enum : std::size_t { kDecodeAllocations = 2 };
+};
+
+struct TableCase {
+  static const char* Name() { return "Table"; }
+  using Type = Settings;
+  static Type Make() {
+    Settings settings;
+    settings.version = 3;
+    settings.owner = kLong;
+    return settings;
+  }
+  enum : std::size_t { kDecodeAllocations = 1 };
+};
+
+//
+// Writers. Each fixture prepares its storage before the measured write.
+//
+
+class BufferWriterFixture {
+ public:
+  explicit BufferWriterFixture(std::size_t size) : buffer_(size) {}
+
+  template <typename T>
+  nop::Status<void> Write(const T& value) {
+    Serializer<BufferWriter> serializer{buffer_.data(), buffer_.size()};
+    return serializer.Write(value);
+  }
+
+ private:
+  std::vector<std::uint8_t> buffer_;
+};
+
+class PedanticBufferWriterFixture {
+ public:
+  explicit PedanticBufferWriterFixture(std::size_t size) : buffer_(size) {}
+
+  template <typename T>
+  nop::Status<void> Write(const T& value) {
+    Serializer<PedanticBufferWriter> serializer{buffer_.data(),
+                                                buffer_.size()};
+    return serializer.Write(value);
+  }
+
+ private:
+  std::vector<std::uint8_t> buffer_;
+};
+
+class VectorWriterFixture {
+ public:
+  explicit VectorWriterFixture(std::size_t size) : writer_{size} {}
+
+  template <typename T>
+  nop::Status<void> Write(const T& value) {
+    writer_.Reset();
+    return Serializer<VectorWriter*>{&writer_}.Write(value);
+  }
+
+ private:
+  VectorWriter writer_;
+};
+
+class PooledWriterFixture {
+ public:
+  explicit PooledWriterFixture(std::size_t /*size*/) {}
+
+  template <typename T>
+  nop::Status<void> Write(const T& value) {
+    Serializer<PooledWriter> serializer;
+    return serializer.Write(value);
+  }
+};
+
+template <typename Case, typename Writer>
+void ExpectWriteWithoutAllocation() {
+  SCOPED_TRACE(Case::Name());
+  const typename Case::Type value = Case::Make();
+  Writer writer{Encoding<typename Case::Type>::Size(value)};
+
+  // The first write warms up per-thread caches, such as the table entry size
+  // cache and the buffer pool.
+  ASSERT_TRUE(writer.Write(value));
+  EXPECT_EQ(0u, CountAllocations([&] { ASSERT_TRUE(writer.Write(value)); }));
+}
+
+template <typename Case>
+void ExpectWritesWithoutAllocation() {
+  ExpectWriteWithoutAllocation<Case, BufferWriterFixture>();
+  ExpectWriteWithoutAllocation<Case, PedanticBufferWriterFixture>();
+  ExpectWriteWithoutAllocation<Case, VectorWriterFixture>();
+  ExpectWriteWithoutAllocation<Case, PooledWriterFixture>();
+}
+
+template <typename T>
+std::vector<std::uint8_t> Encode(const T& value) {
+  Serializer<VectorWriter> serializer;
+  EXPECT_TRUE(serializer.Write(value));
+  return serializer.writer().Take();
+}
+
+template <typename Case, typename Reader>
+void ExpectDecodeAllocations() {
+  SCOPED_TRACE(Case::Name());
+  const std::vector<std::uint8_t> data = Encode(Case::Make());
+  typename Case::Type value;
+  const std::size_t count = CountAllocations([&] {
+    Deserializer<Reader> deserializer{data.data(), data.size()};
+    ASSERT_TRUE(deserializer.Read(&value));
+  });
+  EXPECT_EQ(static_cast<std::size_t>(Case::kDecodeAllocations), count);
+  EXPECT_EQ(data, Encode(value));
+}
+
+template <typename Case>
+void ExpectDecodesAllocate() {
+  ExpectDecodeAllocations<Case, BufferReader>();
+  ExpectDecodeAllocations<Case, PedanticBufferReader>();
+}
+
+// Decodes the value twice into the same object and expects the second decode
+// not to allocate.
+template <typename Case, typename Reader>
+void ExpectDecodeReusesStorage() {
+  SCOPED_TRACE(Case::Name());
+  const std::vector<std::uint8_t> data = Encode(Case::Make());
+  typename Case::Type value;
+  Deserializer<Reader> first{data.data(), data.size()};
+  ASSERT_TRUE(first.Read(&value));
+
+  EXPECT_EQ(0u, CountAllocations([&] {
+              Deserializer<Reader> deserializer{data.data(), data.size()};
+              ASSERT_TRUE(deserializer.Read(&value));
+            }));
+  EXPECT_EQ(data, Encode(value));
+}
+
+}  // anonymous namespace
+
+TEST(Allocation, Counter) {
+  EXPECT_EQ(1u, CountAllocations([] { delete new int{1}; }));
+  EXPECT_EQ(0u, CountAllocations([] {}));
+}
+
+TEST(Allocation, Write) {
+  ExpectWritesWithoutAllocation<IntegerCase>();
+  ExpectWritesWithoutAllocation<StringCase>();
+  ExpectWritesWithoutAllocation<IntegralVectorCase>();
+  ExpectWritesWithoutAllocation<StringVectorCase>();
+  ExpectWritesWithoutAllocation<ArrayCase>();
+  ExpectWritesWithoutAllocation<MapCase>();
+  ExpectWritesWithoutAllocation<VariantCase>();
+  ExpectWritesWithoutAllocation<OptionalCase>();
+  ExpectWritesWithoutAllocation<StructureCase>();
+  ExpectWritesWithoutAllocation<TableCase>();
+}
+
+TEST(Allocation, Read) {
+  ExpectDecodesAllocate<IntegerCase>();
+  ExpectDecodesAllocate<StringCase>();
+  ExpectDecodesAllocate<IntegralVectorCase>();
+  ExpectDecodesAllocate<StringVectorCase>();
+  ExpectDecodesAllocate<ArrayCase>();
+  ExpectDecodesAllocate<MapCase>();
+  ExpectDecodesAllocate<VariantCase>();
+  ExpectDecodesAllocate<OptionalCase>();
+  ExpectDecodesAllocate<StructureCase>();
+  ExpectDecodesAllocate<TableCase>();
+}
+
+TEST(Allocation, ReadReusesStorage) {
+  // Strings and integral vectors decode into their existing capacity.
+  ExpectDecodeReusesStorage<StringCase, BufferReader>();
+  ExpectDecodeReusesStorage<IntegralVectorCase, BufferReader>();
+  ExpectDecodeReusesStorage<IntegralVectorCase, PedanticBufferReader>();
+  ExpectDecodeReusesStorage<StructureCase, BufferReader>();
+
+  // Vectors of other elements decode over their existing elements when the
+  // reader opts in.
+  ExpectDecodeReusesStorage<StringVectorCase, ReuseStorage<BufferReader>>();
+}
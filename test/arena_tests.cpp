@@ -0,0 +1,134 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <nop/serializer.h>
+#include <nop/structure.h>
+#include <nop/utility/arena.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/vector_writer.h>
+
+using nop::Arena;
+using nop::ArenaAllocator;
+using nop::ArenaScope;
+using nop::BufferReader;
+using nop::Deserializer;
+using nop::Serializer;
+using nop::VectorWriter;
+
+namespace {
+
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+using ArenaString =
+    std::basic_string<char, std::char_traits<char>, ArenaAllocator<char>>;
+template <typename Key, typename T>
+using ArenaMap =
+    std::map<Key, T, std::less<Key>, ArenaAllocator<std::pair<const Key, T>>>;
+
+struct Request {
+  ArenaString name;
+  ArenaVector<ArenaString> arguments;
+  ArenaMap<int, ArenaVector<std::uint32_t>> values;
+  NOP_STRUCTURE(Request, name, arguments, values);
+};
+
+struct HeapRequest {
+  std::string name;
+  std::vector<std::string> arguments;
+  std::map<int, std::vector<std::uint32_t>> values;
+  NOP_STRUCTURE(HeapRequest, name, arguments, values);
+};
+
+}  // anonymous namespace
+
+TEST(Arena, Allocate) {
+  Arena arena{64};
+  EXPECT_EQ(0u, arena.allocated());
+
+  void* a = arena.Allocate(1, 1);
+  void* b = arena.Allocate(8, 8);
+  EXPECT_NE(a, b);
+  EXPECT_EQ(0u, reinterpret_cast<std::uintptr_t>(b) % 8);
+
+  // Allocations larger than the block size get a block of their own.
+  void* c = arena.Allocate(1000, 16);
+  EXPECT_EQ(0u, reinterpret_cast<std::uintptr_t>(c) % 16);
+  EXPECT_EQ(1009u, arena.allocated());
+
+  arena.Reset();
+  EXPECT_EQ(0u, arena.allocated());
+}
+
+TEST(Arena, Scope) {
+  Arena outer;
+  Arena inner;
+  EXPECT_EQ(nullptr, Arena::Current());
+  {
+    ArenaScope outer_scope{&outer};
+    EXPECT_EQ(&outer, Arena::Current());
+    EXPECT_EQ(&outer, ArenaAllocator<int>{}.arena());
+    {
+      ArenaScope inner_scope{&inner};
+      EXPECT_EQ(&inner, Arena::Current());
+    }
+    EXPECT_EQ(&outer, Arena::Current());
+  }
+  EXPECT_EQ(nullptr, Arena::Current());
+
+  // Allocators without an arena use the heap.
+  ArenaVector<int> heap_vector(100, 1);
+  EXPECT_EQ(nullptr, heap_vector.get_allocator().arena());
+}
+
+TEST(Arena, Deserialize) {
+  const std::string long_name(100, 'n');
+  HeapRequest source{long_name,
+                     {long_name, "b", long_name},
+                     {{1, {1, 2, 3}}, {2, std::vector<std::uint32_t>(50, 7)}}};
+
+  Serializer<VectorWriter> serializer;
+  ASSERT_TRUE(serializer.Write(source));
+  const std::vector<std::uint8_t> data = serializer.writer().Take();
+
+  Arena arena;
+  {
+    Request request{ArenaString{&arena}, ArenaVector<ArenaString>{&arena},
+                    ArenaMap<int, ArenaVector<std::uint32_t>>{&arena}};
+    Deserializer<BufferReader> deserializer{data.data(), data.size()};
+    ASSERT_TRUE(deserializer.Read(&request, &arena));
+    EXPECT_EQ(nullptr, Arena::Current());
+
+    EXPECT_EQ(long_name, request.name.c_str());
+    ASSERT_EQ(3u, request.arguments.size());
+    EXPECT_EQ("b", std::string{request.arguments[1].c_str()});
+    EXPECT_EQ(50u, request.values[2].size());
+
+    // Every nested container allocates from the arena.
+    for (const ArenaString& argument : request.arguments)
+      EXPECT_EQ(&arena, argument.get_allocator().arena());
+    for (const auto& entry : request.values)
+      EXPECT_EQ(&arena, entry.second.get_allocator().arena());
+    EXPECT_LT(long_name.size() * 3 + 50 * sizeof(std::uint32_t),
+              arena.allocated());
+  }
+  arena.Reset();
+}
@@ -0,0 +1,193 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <nop/rpc/async_method_receiver.h>
+#include <nop/rpc/async_method_sender.h>
+#include <nop/rpc/interface.h>
+#include <nop/serializer.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/fd_reader.h>
+#include <nop/utility/fd_writer.h>
+#include <nop/utility/pedantic_buffer_reader.h>
+#include <nop/utility/vector_writer.h>
+
+using nop::AsyncMethodReceiver;
+using nop::AsyncMethodSender;
+using nop::BindInterface;
+using nop::BufferReader;
+using nop::Deserializer;
+using nop::ErrorStatus;
+using nop::FdReader;
+using nop::FdWriter;
+using nop::Interface;
+using nop::PedanticBufferReader;
+using nop::Serializer;
+using nop::Status;
+using nop::VectorWriter;
+
+namespace {
+
+struct Calculator : Interface<Calculator> {
+  NOP_INTERFACE("io.github.eieio.test.Calculator");
+  NOP_METHOD(Sum, int(int a, int b));
+  NOP_METHOD(Repeat, std::string(const std::string& value, int count));
+  NOP_METHOD(Reset, void());
+  NOP_INTERFACE_API(Sum, Repeat, Reset);
+};
+
+auto BindCalculator() {
+  return BindInterface(
+      Calculator::Sum::Bind([](int a, int b) { return a + b; }),
+      Calculator::Repeat::Bind([](const std::string& value, int count) {
+        std::string result;
+        for (int i = 0; i < count; i++)
+          result += value;
+        return result;
+      }));
+}
+
+using BufferSender = AsyncMethodSender<Serializer<VectorWriter>,
+                                       Deserializer<PedanticBufferReader>>;
+
+}  // anonymous namespace
+
+TEST(AsyncMethodSender, OutOfOrder) {
+  Serializer<VectorWriter> request_serializer;
+  Deserializer<PedanticBufferReader> reply_deserializer;
+  BufferSender sender{&request_serializer, &reply_deserializer};
+
+  // Issue all of the calls before any reply is received.
+  auto sum = Calculator::Sum::InvokeAsync(&sender, 1, 2);
+  auto repeat = Calculator::Repeat::InvokeAsync(&sender, "ab", 3);
+  Status<int> callback_sum;
+  Calculator::Sum::InvokeAsync(
+      &sender, [&callback_sum](Status<int> status) { callback_sum = status; },
+      10, 20);
+  EXPECT_EQ(3u, sender.pending());
+
+  // Serve the calls, collecting each reply in a separate buffer.
+  const VectorWriter& requests = request_serializer.writer();
+  Deserializer<BufferReader> request_deserializer{requests.data(),
+                                                  requests.size()};
+  auto dispatcher = BindCalculator();
+  std::vector<std::uint8_t> replies[3];
+  for (auto& reply : replies) {
+    Serializer<VectorWriter> reply_serializer;
+    AsyncMethodReceiver<Serializer<VectorWriter>, Deserializer<BufferReader>>
+        receiver{&reply_serializer, &request_deserializer};
+    ASSERT_TRUE(dispatcher(&receiver));
+
+    const VectorWriter& writer = reply_serializer.writer();
+    reply.assign(writer.data(), writer.data() + writer.size());
+  }
+  EXPECT_TRUE(request_deserializer.reader().empty());
+
+  // Deliver the replies in reverse order.
+  std::vector<std::uint8_t> reversed;
+  for (int i = 2; i >= 0; i--)
+    reversed.insert(reversed.end(), replies[i].begin(), replies[i].end());
+  reply_deserializer =
+      Deserializer<PedanticBufferReader>{reversed.data(), reversed.size()};
+
+  ASSERT_TRUE(sender.ReceiveReply());
+  EXPECT_EQ(30, callback_sum.get());
+  ASSERT_TRUE(sender.ReceiveReply());
+  EXPECT_EQ("ababab", repeat.get().get());
+  ASSERT_TRUE(sender.ReceiveReply());
+  EXPECT_EQ(3, sum.get().get());
+  EXPECT_EQ(0u, sender.pending());
+
+  EXPECT_EQ(ErrorStatus::ReadLimitReached, sender.ReceiveReply().error());
+}
+
+TEST(AsyncMethodSender, Errors) {
+  Serializer<VectorWriter> request_serializer;
+  Deserializer<PedanticBufferReader> reply_deserializer;
+  BufferSender sender{&request_serializer, &reply_deserializer};
+
+  auto reset = Calculator::Reset::InvokeAsync(&sender);
+  auto sum = Calculator::Sum::InvokeAsync(&sender, 1, 2);
+
+  // Methods that return void reply with only the request id.
+  Serializer<VectorWriter> reply_serializer;
+  AsyncMethodReceiver<Serializer<VectorWriter>,
+                      Deserializer<PedanticBufferReader>>
+      receiver{&reply_serializer, &reply_deserializer};
+  ASSERT_TRUE(receiver.SendReturn());
+
+  // Replies to unknown requests are rejected.
+  ASSERT_TRUE(reply_serializer.Write(std::uint64_t{100}));
+
+  const VectorWriter& replies = reply_serializer.writer();
+  reply_deserializer =
+      Deserializer<PedanticBufferReader>{replies.data(), replies.size()};
+  ASSERT_TRUE(sender.ReceiveReply());
+  EXPECT_TRUE(reset.get());
+  EXPECT_EQ(ErrorStatus::ProtocolError, sender.ReceiveReply().error());
+
+  // Canceled calls complete with the given error.
+  EXPECT_EQ(1u, sender.pending());
+  sender.Cancel(ErrorStatus::IOError);
+  EXPECT_EQ(ErrorStatus::IOError, sum.get().error());
+  EXPECT_EQ(0u, sender.pending());
+}
+
+TEST(AsyncMethodSender, Pipelined) {
+  int request_pipe[2], reply_pipe[2];
+  ASSERT_EQ(0, ::pipe(request_pipe));
+  ASSERT_EQ(0, ::pipe(reply_pipe));
+
+  std::thread server{[&] {
+    Serializer<FdWriter> serializer{reply_pipe[1]};
+    Deserializer<FdReader> deserializer{request_pipe[0]};
+    AsyncMethodReceiver<Serializer<FdWriter>, Deserializer<FdReader>> receiver{
+        &serializer, &deserializer};
+    auto dispatcher = BindCalculator();
+    while (dispatcher(&receiver)) {
+    }
+  }};
+
+  Serializer<FdWriter> serializer{request_pipe[1]};
+  Deserializer<FdReader> deserializer{reply_pipe[0]};
+  AsyncMethodSender<Serializer<FdWriter>, Deserializer<FdReader>> sender{
+      &serializer, &deserializer};
+  std::thread reader{[&sender] {
+    while (sender.ReceiveReply()) {
+    }
+    sender.Cancel(ErrorStatus::IOError);
+  }};
+
+  const int kCount = 200;
+  std::vector<AsyncMethodSender<Serializer<FdWriter>,
+                                Deserializer<FdReader>>::Future<int>>
+      futures;
+  for (int i = 0; i < kCount; i++)
+    futures.push_back(Calculator::Sum::InvokeAsync(&sender, i, i));
+  for (int i = 0; i < kCount; i++)
+    EXPECT_EQ(2 * i, futures[i].get().get());
+
+  // Closing the request pipe stops the server, which closes the reply pipe.
+  serializer.writer().Clear();
+  server.join();
+  reader.join();
+  EXPECT_EQ(0u, sender.pending());
+}
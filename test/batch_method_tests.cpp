@@ -0,0 +1,172 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <nop/rpc/batch_method_receiver.h>
+#include <nop/rpc/batch_method_sender.h>
+#include <nop/rpc/interface.h>
+#include <nop/serializer.h>
+#include <nop/utility/counting_writer.h>
+#include <nop/utility/fd_reader.h>
+#include <nop/utility/fd_writer.h>
+
+using nop::BatchMethodReceiver;
+using nop::BatchMethodSender;
+using nop::BindInterface;
+using nop::CountingWriter;
+using nop::Deserializer;
+using nop::ErrorStatus;
+using nop::FdReader;
+using nop::FdWriter;
+using nop::Interface;
+using nop::Serializer;
+using nop::Status;
+
+namespace {
+
+struct Control : Interface<Control> {
+  NOP_INTERFACE("io.github.eieio.test.Control");
+  NOP_METHOD(SetWeight, int(const std::string& route, int weight));
+  NOP_METHOD(Clear, void());
+  NOP_METHOD(Unbound, int());
+  NOP_INTERFACE_API(SetWeight, Clear, Unbound);
+};
+
+using CountingSerializer = Serializer<CountingWriter<FdWriter>>;
+using FdDeserializer = Deserializer<FdReader>;
+using Sender = BatchMethodSender<CountingSerializer, FdDeserializer>;
+
+// Serves batches on a thread, counting the writes of the replies.
+class Server {
+ public:
+  Server(int request_fd, int reply_fd)
+      : request_fd_{request_fd}, reply_fd_{reply_fd} {
+    thread_ = std::thread{[this] { Run(); }};
+  }
+
+  // Waits for the client to disconnect and returns the number of batches.
+  std::size_t Join() {
+    thread_.join();
+    return batches_;
+  }
+
+  std::size_t reply_writes() const { return reply_writes_; }
+
+ private:
+  void Run() {
+    FdWriter fd_writer{reply_fd_};
+    CountingSerializer serializer{&fd_writer};
+    FdDeserializer deserializer{request_fd_};
+    BatchMethodReceiver<CountingSerializer, FdDeserializer> receiver{
+        &serializer, &deserializer};
+
+    int total = 0;
+    auto dispatcher = BindInterface(
+        Control::SetWeight::Bind([&total](const std::string& route,
+                                          int weight) {
+          total += weight;
+          return static_cast<int>(route.size()) + total;
+        }));
+
+    while (receiver.DispatchBatch(dispatcher))
+      batches_++;
+    reply_writes_ = serializer.writer().stats().transfer_calls;
+  }
+
+  int request_fd_;
+  int reply_fd_;
+  std::thread thread_;
+  std::size_t batches_{0};
+  std::size_t reply_writes_{0};
+};
+
+}  // anonymous namespace
+
+TEST(BatchMethodSender, Batch) {
+  int request_pipe[2], reply_pipe[2];
+  ASSERT_EQ(0, ::pipe(request_pipe));
+  ASSERT_EQ(0, ::pipe(reply_pipe));
+  Server server{request_pipe[0], reply_pipe[1]};
+
+  FdWriter fd_writer{request_pipe[1]};
+  CountingSerializer serializer{&fd_writer};
+  FdDeserializer deserializer{reply_pipe[0]};
+  Sender sender{&serializer, &deserializer, 16};
+
+  // Calls are only sent when the batch is flushed.
+  std::vector<Sender::Future<int>> futures;
+  for (int i = 0; i < 10; i++)
+    futures.push_back(Control::SetWeight::InvokeAsync(&sender, "route", 1));
+  EXPECT_EQ(10u, sender.pending());
+  EXPECT_EQ(0u, serializer.writer().stats().transfer_calls);
+
+  ASSERT_TRUE(sender.Flush());
+  EXPECT_EQ(0u, sender.pending());
+  EXPECT_EQ(1u, serializer.writer().stats().transfer_calls);
+  for (int i = 0; i < 10; i++)
+    EXPECT_EQ(5 + i + 1, futures[i].get().get());
+
+  // Full batches are flushed automatically.
+  futures.clear();
+  Status<int> last;
+  for (int i = 0; i < 39; i++)
+    futures.push_back(Control::SetWeight::InvokeAsync(&sender, "", 0));
+  Control::SetWeight::InvokeAsync(
+      &sender, [&last](Status<int> status) { last = status; }, "", 100);
+  EXPECT_EQ(8u, sender.pending());
+  EXPECT_EQ(3u, serializer.writer().stats().transfer_calls);
+  for (int i = 0; i < 32; i++)
+    EXPECT_EQ(10, futures[i].get().get());
+
+  ASSERT_TRUE(sender.Flush());
+  EXPECT_EQ(110, last.get());
+  EXPECT_TRUE(sender.Flush());
+  EXPECT_EQ(4u, serializer.writer().stats().transfer_calls);
+
+  fd_writer.Clear();
+  EXPECT_EQ(4u, server.Join());
+  EXPECT_EQ(4u, server.reply_writes());
+}
+
+TEST(BatchMethodSender, Errors) {
+  int request_pipe[2], reply_pipe[2];
+  ASSERT_EQ(0, ::pipe(request_pipe));
+  ASSERT_EQ(0, ::pipe(reply_pipe));
+  Server server{request_pipe[0], reply_pipe[1]};
+
+  FdWriter fd_writer{request_pipe[1]};
+  CountingSerializer serializer{&fd_writer};
+  FdDeserializer deserializer{reply_pipe[0]};
+  Sender sender{&serializer, &deserializer};
+
+  // A call to a method that is not bound fails the batch, and the server
+  // disconnects.
+  auto first = Control::SetWeight::InvokeAsync(&sender, "route", 1);
+  auto unbound = Control::Unbound::InvokeAsync(&sender);
+  auto clear = Control::Clear::InvokeAsync(&sender);
+  EXPECT_FALSE(sender.Flush());
+  EXPECT_FALSE(first.get());
+  EXPECT_FALSE(unbound.get());
+  EXPECT_FALSE(clear.get());
+
+  fd_writer.Clear();
+  EXPECT_EQ(0u, server.Join());
+}
@@ -0,0 +1,127 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <bitset>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <nop/base/skip.h>
+#include <nop/serializer.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/pedantic_buffer_reader.h>
+#include <nop/utility/stream_reader.h>
+#include <nop/utility/vector_writer.h>
+
+#include "test_utilities.h"
+
+using nop::Deserialize;
+using nop::Deserializer;
+using nop::ErrorStatus;
+using nop::FixedEncodingSize;
+using nop::Serialize;
+using nop::SkipValue;
+
+namespace {
+
+std::vector<bool> MakeFlags(std::size_t count) {
+  std::vector<bool> flags;
+  for (std::size_t i = 0; i < count; i++)
+    flags.push_back((i * 7919) % 3 == 0);
+  return flags;
+}
+
+}  // anonymous namespace
+
+TEST(Bits, Vector) {
+  for (std::size_t count : {0u, 1u, 8u, 63u, 64u, 65u, 2047u, 2048u, 5000u}) {
+    const auto flags = MakeFlags(count);
+    const auto data = Serialize(flags);
+    EXPECT_GE(5u + (count + 7) / 8 + 9u, data.size());
+
+    std::vector<bool> decoded(3, true);
+    ASSERT_TRUE(Deserialize(data, &decoded));
+    EXPECT_EQ(flags, decoded);
+
+    nop::BufferReader reader{data.data(), data.size()};
+    EXPECT_TRUE(SkipValue(&reader));
+    EXPECT_EQ(0u, reader.remaining());
+  }
+
+  // BIN, L = 3, N = 10, flags 0 and 9.
+  const std::vector<std::uint8_t> expected = {0xbc, 0x03, 0x0a, 0x01, 0x02};
+  std::vector<bool> flags(10, false);
+  flags[0] = flags[9] = true;
+  EXPECT_EQ(expected, Serialize(flags));
+}
+
+TEST(Bits, Bitset) {
+  std::bitset<100> flags;
+  for (std::size_t i = 0; i < flags.size(); i += 3)
+    flags.set(i);
+
+  const auto data = Serialize(flags);
+  EXPECT_EQ(FixedEncodingSize<std::bitset<100>>::value, data.size());
+  EXPECT_EQ(1u + 1u + 1u + 13u, data.size());
+
+  std::bitset<100> decoded;
+  decoded.set(1);
+  ASSERT_TRUE(Deserialize(data, &decoded));
+  EXPECT_EQ(flags, decoded);
+
+  // Bitsets and vectors of bool are interchangeable.
+  std::vector<bool> vector;
+  ASSERT_TRUE(Deserialize(data, &vector));
+  ASSERT_EQ(100u, vector.size());
+  for (std::size_t i = 0; i < flags.size(); i++)
+    EXPECT_EQ(flags[i], vector[i]);
+  EXPECT_EQ(data, Serialize(vector));
+
+  // The size must match.
+  std::bitset<99> smaller;
+  EXPECT_EQ(ErrorStatus::InvalidContainerLength,
+            Deserialize(data, &smaller).error());
+
+  // Readers without Borrow() work the same.
+  Deserializer<nop::StreamReader<std::stringstream>> deserializer{
+      std::string{data.begin(), data.end()}};
+  decoded.reset();
+  ASSERT_TRUE(deserializer.Read(&decoded));
+  EXPECT_EQ(flags, decoded);
+}
+
+TEST(Bits, Errors) {
+  std::vector<bool> flags;
+
+  // The length does not agree with the count.
+  EXPECT_EQ(ErrorStatus::InvalidContainerLength,
+            Deserialize(std::vector<std::uint8_t>{0xbc, 0x03, 0x20, 0x01, 0x02},
+                        &flags)
+                .error());
+
+  // The length extends beyond the input.
+  EXPECT_EQ(ErrorStatus::ReadLimitReached,
+            Deserialize(std::vector<std::uint8_t>{0xbc, 0x03, 0x0a, 0x01},
+                        &flags)
+                .error());
+
+  // Other BIN encodings are not a whole number of flags.
+  EXPECT_EQ(ErrorStatus::InvalidContainerLength,
+            Deserialize(Serialize(std::vector<int>{1, 2}), &flags).error());
+  EXPECT_EQ(ErrorStatus::UnexpectedEncodingType,
+            Deserialize(Serialize(std::vector<float>{1.0f}), &flags).error());
+}
@@ -0,0 +1,290 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <nop/base/skip.h>
+#include <nop/serializer.h>
+#include <nop/structure.h>
+#include <nop/types/blittable.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/pedantic_buffer_reader.h>
+#include <nop/utility/vector_writer.h>
+
+#include "test_utilities.h"
+
+using nop::Blittable;
+using nop::Deserialize;
+using nop::ErrorStatus;
+using nop::FixedEncodingSize;
+using nop::Serialize;
+using nop::SkipValue;
+
+namespace {
+
+struct Tick {
+  std::uint64_t timestamp;
+  double price;
+  std::uint32_t quantity;
+  std::int32_t venue;
+  NOP_STRUCTURE(Tick, timestamp, price, quantity, venue);
+
+  bool operator==(const Tick& other) const {
+    return timestamp == other.timestamp && price == other.price &&
+           quantity == other.quantity && venue == other.venue;
+  }
+};
+
+// Same size as Tick, with the signedness of the last two members swapped.
+struct SwappedTick {
+  std::uint64_t timestamp;
+  double price;
+  std::int32_t quantity;
+  std::uint32_t venue;
+  NOP_STRUCTURE(SwappedTick, timestamp, price, quantity, venue);
+};
+
+// Same members as the pair std::pair<std::uint32_t, std::uint32_t>.
+struct Edge {
+  std::uint32_t from;
+  std::uint32_t to;
+  NOP_STRUCTURE(Edge, from, to);
+};
+
+using EdgePair = std::pair<std::uint32_t, std::uint32_t>;
+using Sample = std::tuple<std::int64_t, float, std::uint8_t>;
+
+struct Snapshot {
+  Blittable<Tick> last;
+  Blittable<std::vector<Tick>> ticks;
+  NOP_STRUCTURE(Snapshot, last, ticks);
+};
+
+std::vector<Tick> MakeTicks(std::size_t count) {
+  std::vector<Tick> ticks;
+  for (std::size_t i = 0; i < count; i++) {
+    ticks.push_back({1500000000000 + i * 1000, 100.0 + i * 0.25,
+                     static_cast<std::uint32_t>(i * 7),
+                     static_cast<std::int32_t>(i % 5) - 2});
+  }
+  return ticks;
+}
+
+std::vector<EdgePair> MakeEdges(std::size_t count) {
+  std::vector<EdgePair> edges;
+  for (std::size_t i = 0; i < count; i++) {
+    edges.emplace_back(static_cast<std::uint32_t>(i),
+                       static_cast<std::uint32_t>(i * 31 + 0x10000));
+  }
+  return edges;
+}
+
+}  // anonymous namespace
+
+TEST(Blittable, LayoutHash) {
+  using nop::detail::BlittableLayout;
+  static_assert(BlittableLayout<Tick>::Hash() != 0, "");
+  static_assert(
+      BlittableLayout<Tick>::Hash() != BlittableLayout<SwappedTick>::Hash(),
+      "");
+  static_assert(FixedEncodingSize<Blittable<Tick>>::value ==
+                    1 + 1 + sizeof(std::uint64_t) + sizeof(Tick),
+                "");
+}
+
+TEST(Blittable, RoundTrip) {
+  const Tick tick = MakeTicks(2)[1];
+  const auto data = Serialize(Blittable<Tick>{tick});
+  ASSERT_EQ(FixedEncodingSize<Blittable<Tick>>::value, data.size());
+
+  Blittable<Tick> decoded;
+  ASSERT_TRUE(Deserialize(data, &decoded));
+  EXPECT_EQ(tick, decoded.get());
+
+  for (std::size_t count : {0u, 1u, 1000u}) {
+    const auto ticks = MakeTicks(count);
+    const auto data = Serialize(Blittable<std::vector<Tick>>{ticks});
+
+    Blittable<std::vector<Tick>> decoded{MakeTicks(3)};
+    ASSERT_TRUE(Deserialize(data, &decoded));
+    EXPECT_EQ(ticks, decoded.get());
+
+    nop::BufferReader reader{data.data(), data.size()};
+    EXPECT_TRUE(SkipValue(&reader));
+    EXPECT_EQ(0u, reader.remaining());
+  }
+
+  const Snapshot snapshot{tick, MakeTicks(10)};
+  Snapshot decoded_snapshot;
+  ASSERT_TRUE(Deserialize(Serialize(snapshot), &decoded_snapshot));
+  EXPECT_EQ(snapshot.last.get(), decoded_snapshot.last.get());
+  EXPECT_EQ(snapshot.ticks.get(), decoded_snapshot.ticks.get());
+}
+
+TEST(Blittable, Tuples) {
+  using nop::detail::BlittableLayout;
+  using nop::detail::BlittableTupleLayout;
+  static_assert(BlittableTupleLayout<EdgePair>::Hash() ==
+                    BlittableLayout<Edge>::Hash(),
+                "");
+  static_assert(BlittableTupleLayout<Sample>::Size() == 13, "");
+  static_assert(FixedEncodingSize<Blittable<Sample>>::value ==
+                    1 + 1 + sizeof(std::uint64_t) + 13,
+                "");
+  static_assert(FixedEncodingSize<Blittable<std::array<EdgePair, 4>>>::value ==
+                    1 + 1 + sizeof(std::uint64_t) + 4 * sizeof(Edge),
+                "");
+
+  const EdgePair edge{7, 0x12345678};
+  Blittable<EdgePair> decoded_edge;
+  ASSERT_TRUE(Deserialize(Serialize(Blittable<EdgePair>{edge}),
+                          &decoded_edge));
+  EXPECT_EQ(edge, decoded_edge.get());
+
+  const Sample sample{-1234567890123, 2.5f, 200};
+  Blittable<Sample> decoded_sample;
+  ASSERT_TRUE(Deserialize(Serialize(Blittable<Sample>{sample}),
+                          &decoded_sample));
+  EXPECT_EQ(sample, decoded_sample.get());
+
+  // Large enough to span several blocks, with a partial last block.
+  for (std::size_t count : {0u, 1u, 1000u}) {
+    const auto edges = MakeEdges(count);
+    const auto data = Serialize(Blittable<std::vector<EdgePair>>{edges});
+
+    Blittable<std::vector<EdgePair>> decoded{MakeEdges(3)};
+    ASSERT_TRUE(Deserialize(data, &decoded));
+    EXPECT_EQ(edges, decoded.get());
+
+    nop::BufferReader reader{data.data(), data.size()};
+    EXPECT_TRUE(SkipValue(&reader));
+    EXPECT_EQ(0u, reader.remaining());
+  }
+
+  std::array<Sample, 3> samples{};
+  for (std::size_t i = 0; i < samples.size(); i++)
+    samples[i] = Sample{-static_cast<std::int64_t>(i), i * 0.5f,
+                        static_cast<std::uint8_t>(i)};
+  const auto data = Serialize(Blittable<std::array<Sample, 3>>{samples});
+  ASSERT_EQ((FixedEncodingSize<Blittable<std::array<Sample, 3>>>::value),
+            data.size());
+
+  Blittable<std::array<Sample, 3>> decoded_samples;
+  ASSERT_TRUE(Deserialize(data, &decoded_samples));
+  EXPECT_EQ(samples, decoded_samples.get());
+
+  // Arrays and vectors share the encoding.
+  Blittable<std::vector<Sample>> decoded_vector;
+  ASSERT_TRUE(Deserialize(data, &decoded_vector));
+  EXPECT_EQ(std::vector<Sample>(samples.begin(), samples.end()),
+            decoded_vector.get());
+}
+
+TEST(Blittable, TupleFormat) {
+  // A pair encodes the same as a structure with the same members.
+  const auto edges = MakeEdges(100);
+  std::vector<Edge> structures;
+  for (const auto& edge : edges)
+    structures.push_back({edge.first, edge.second});
+  EXPECT_EQ(Serialize(Blittable<std::vector<Edge>>{structures}),
+            Serialize(Blittable<std::vector<EdgePair>>{edges}));
+  EXPECT_EQ(Serialize(Blittable<Edge>{structures[1]}),
+            Serialize(Blittable<EdgePair>{edges[1]}));
+
+  // Elements are packed in order in little-endian byte order.
+  const Sample sample{0x0102030405060708, 1.0f, 0xab};
+  std::vector<std::uint8_t> payload;
+  ASSERT_TRUE(Deserialize(Serialize(Blittable<Sample>{sample}), &payload));
+  const std::vector<std::uint8_t> expected{
+      0x08, 0x07, 0x06, 0x05, 0x04, 0x03, 0x02, 0x01,
+      0x00, 0x00, 0x80, 0x3f, 0xab};
+  EXPECT_EQ(expected, std::vector<std::uint8_t>(
+                          payload.begin() + sizeof(std::uint64_t),
+                          payload.end()));
+}
+
+TEST(Blittable, Format) {
+  const auto ticks = MakeTicks(3);
+  const auto data = Serialize(Blittable<std::vector<Tick>>{ticks});
+
+  // The encoding is a BIN block of the layout hash and the elements.
+  std::vector<std::uint8_t> payload;
+  ASSERT_TRUE(Deserialize(data, &payload));
+  ASSERT_EQ(sizeof(std::uint64_t) + 3 * sizeof(Tick), payload.size());
+
+  std::uint64_t hash = 0;
+  for (std::size_t i = 0; i < sizeof(hash); i++)
+    hash |= std::uint64_t{payload[i]} << (i * 8);
+  EXPECT_EQ(nop::detail::BlittableLayout<Tick>::Hash(), hash);
+
+  if (nop::kLittleEndianHost) {
+    EXPECT_EQ(0, std::memcmp(ticks.data(), payload.data() + sizeof(hash),
+                             3 * sizeof(Tick)));
+  }
+}
+
+TEST(Blittable, Errors) {
+  const auto data = Serialize(Blittable<Tick>{MakeTicks(1)[0]});
+
+  // A structure with a different layout.
+  Blittable<SwappedTick> swapped;
+  EXPECT_EQ(ErrorStatus::InvalidLayoutHash,
+            Deserialize(data, &swapped).error());
+  Blittable<std::vector<SwappedTick>> swapped_ticks;
+  EXPECT_EQ(ErrorStatus::InvalidLayoutHash,
+            Deserialize(Serialize(Blittable<std::vector<Tick>>{MakeTicks(2)}),
+                        &swapped_ticks)
+                .error());
+
+  // Lengths that do not match the elements.
+  Blittable<Tick> tick;
+  EXPECT_EQ(ErrorStatus::InvalidContainerLength,
+            Deserialize(Serialize(Blittable<std::vector<Tick>>{MakeTicks(2)}),
+                        &tick)
+                .error());
+  EXPECT_EQ(ErrorStatus::InvalidContainerLength,
+            Deserialize(Serialize(std::vector<std::uint8_t>{1, 2, 3}), &tick)
+                .error());
+
+  std::vector<std::uint8_t> payload;
+  ASSERT_TRUE(Deserialize(data, &payload));
+  payload.push_back(0);
+  Blittable<std::vector<Tick>> ticks;
+  EXPECT_EQ(ErrorStatus::InvalidContainerLength,
+            Deserialize(Serialize(payload), &ticks).error());
+
+  // Pairs and arrays with a different layout or length.
+  const auto edges = Serialize(Blittable<std::vector<EdgePair>>{MakeEdges(2)});
+  Blittable<std::pair<std::int32_t, std::uint32_t>> signed_edge;
+  EXPECT_EQ(ErrorStatus::InvalidLayoutHash,
+            Deserialize(edges, &signed_edge).error());
+  Blittable<std::array<EdgePair, 3>> edge_array;
+  EXPECT_EQ(ErrorStatus::InvalidContainerLength,
+            Deserialize(edges, &edge_array).error());
+
+  // Input that ends early.
+  const std::vector<std::uint8_t> truncated{data.begin(), data.end() - 1};
+  EXPECT_EQ(ErrorStatus::ReadLimitReached,
+            Deserialize(truncated, &tick).error());
+
+  EXPECT_EQ(ErrorStatus::UnexpectedEncodingType,
+            Deserialize(Serialize(MakeTicks(1)[0]), &tick).error());
+}
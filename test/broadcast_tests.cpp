@@ -0,0 +1,199 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <nop/serializer.h>
+#include <nop/utility/broadcast.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/vector_writer.h>
+
+using nop::BufferReader;
+using nop::Deserializer;
+using nop::ErrorStatus;
+using nop::FdBroadcaster;
+using nop::SharedMessage;
+using nop::VectorWriter;
+
+namespace {
+
+// Reads everything currently available on the non-blocking |fd|.
+std::vector<std::uint8_t> ReadAvailable(int fd) {
+  std::vector<std::uint8_t> data;
+  std::uint8_t buffer[4096];
+  while (true) {
+    const ssize_t ret = ::recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+    if (ret <= 0)
+      break;
+    data.insert(data.end(), buffer, buffer + ret);
+  }
+  return data;
+}
+
+struct SocketPair {
+  SocketPair() { EXPECT_EQ(0, ::socketpair(AF_UNIX, SOCK_STREAM, 0, fds)); }
+  ~SocketPair() {
+    ::close(fds[0]);
+    ::close(fds[1]);
+  }
+
+  int fds[2];
+};
+
+}  // anonymous namespace
+
+TEST(SharedMessage, Encode) {
+  auto message = SharedMessage::Encode(std::string{"foo"});
+  ASSERT_TRUE(message);
+  EXPECT_EQ(5u, message.get().size());
+  EXPECT_EQ(1, message.get().use_count());
+
+  // Copies share the encoded buffer.
+  SharedMessage copy = message.get();
+  EXPECT_EQ(2, message.get().use_count());
+  EXPECT_EQ(message.get().data(), copy.data());
+
+  VectorWriter writer;
+  ASSERT_TRUE(copy.WriteTo(&writer));
+  std::string value;
+  Deserializer<BufferReader> deserializer{writer.data(), writer.size()};
+  ASSERT_TRUE(deserializer.Read(&value));
+  EXPECT_EQ("foo", value);
+
+  EXPECT_TRUE(SharedMessage{}.empty());
+}
+
+TEST(FdBroadcaster, Publish) {
+  const int kDestinations = 8;
+  std::vector<SocketPair> sockets(kDestinations);
+  int pipe_fds[2];
+  ASSERT_EQ(0, ::pipe(pipe_fds));
+
+  FdBroadcaster broadcaster;
+  for (auto& pair : sockets)
+    ASSERT_TRUE(broadcaster.Add(pair.fds[0]));
+  ASSERT_TRUE(broadcaster.Add(pipe_fds[1]));
+  EXPECT_EQ(kDestinations + 1u, broadcaster.size());
+
+  auto first = SharedMessage::Encode(std::string{"first"});
+  auto second = SharedMessage::Encode(std::vector<int>{1, 2, 3});
+  ASSERT_TRUE(first && second);
+
+  auto result = broadcaster.Publish(first.get());
+  EXPECT_EQ(kDestinations + 1u, result.written);
+  EXPECT_EQ(0u, result.queued + result.dropped + result.failed);
+  result = broadcaster.Publish(second.get());
+  EXPECT_EQ(kDestinations + 1u, result.written);
+
+  // Every destination receives the same bytes, and the queues no longer
+  // reference the messages.
+  std::vector<std::uint8_t> expected{first.get().data(),
+                                     first.get().data() + first.get().size()};
+  expected.insert(expected.end(), second.get().data(),
+                  second.get().data() + second.get().size());
+  for (auto& pair : sockets)
+    EXPECT_EQ(expected, ReadAvailable(pair.fds[1]));
+  EXPECT_EQ(1, first.get().use_count());
+
+  std::vector<std::uint8_t> piped(expected.size());
+  ASSERT_EQ(static_cast<ssize_t>(piped.size()),
+            ::read(pipe_fds[0], piped.data(), piped.size()));
+  EXPECT_EQ(expected, piped);
+
+  ::close(pipe_fds[0]);
+  ::close(pipe_fds[1]);
+}
+
+TEST(FdBroadcaster, Backpressure) {
+  SocketPair fast;
+  SocketPair slow;
+  const std::size_t kMaxQueuedBytes = 256 * 1024;
+  FdBroadcaster broadcaster{kMaxQueuedBytes};
+  ASSERT_TRUE(broadcaster.Add(fast.fds[0]));
+  ASSERT_TRUE(broadcaster.Add(slow.fds[0]));
+
+  auto message = SharedMessage::Encode(std::vector<std::uint8_t>(16 * 1024));
+  ASSERT_TRUE(message);
+
+  // Publish until the slow destination, which is never read, drops a message.
+  std::size_t published = 0;
+  std::size_t fast_bytes = 0;
+  FdBroadcaster::Result result;
+  while (result.dropped == 0 && published < 1000) {
+    result = broadcaster.Publish(message.get());
+    published++;
+    fast_bytes += ReadAvailable(fast.fds[1]).size();
+  }
+  ASSERT_EQ(1u, result.dropped);
+  EXPECT_EQ(published * message.get().size(), fast_bytes);
+
+  auto stats = broadcaster.GetStats(slow.fds[0]);
+  ASSERT_TRUE(stats);
+  EXPECT_EQ(1u, stats.get().dropped_messages);
+  EXPECT_LT(0u, stats.get().queued_bytes);
+  EXPECT_GE(kMaxQueuedBytes, stats.get().queued_bytes);
+  EXPECT_EQ(0u, broadcaster.GetStats(fast.fds[0]).get().queued_bytes);
+
+  // Draining the slow destination and flushing delivers the queued messages.
+  std::size_t slow_bytes = 0;
+  for (int i = 0; i < 1000; i++) {
+    slow_bytes += ReadAvailable(slow.fds[1]).size();
+    result = broadcaster.Flush(slow.fds[0]);
+    if (result.written == 1)
+      break;
+  }
+  slow_bytes += ReadAvailable(slow.fds[1]).size();
+  EXPECT_EQ(1u, result.written);
+  EXPECT_EQ((published - 1) * message.get().size(), slow_bytes);
+  EXPECT_EQ(0u, broadcaster.GetStats(slow.fds[0]).get().queued_bytes);
+
+  EXPECT_FALSE(broadcaster.GetStats(-1));
+}
+
+TEST(FdBroadcaster, Failure) {
+  SocketPair open;
+  int closed[2];
+  ASSERT_EQ(0, ::socketpair(AF_UNIX, SOCK_STREAM, 0, closed));
+  ::close(closed[1]);
+
+  FdBroadcaster broadcaster;
+  ASSERT_TRUE(broadcaster.Add(open.fds[0]));
+  ASSERT_TRUE(broadcaster.Add(closed[0]));
+
+  // Writing to the closed peer fails instead of raising SIGPIPE.
+  auto message = SharedMessage::Encode(42);
+  ASSERT_TRUE(message);
+  auto result = broadcaster.Publish(message.get());
+  EXPECT_EQ(1u, result.written);
+  EXPECT_EQ(1u, result.failed);
+  EXPECT_EQ(ErrorStatus::IOError,
+            broadcaster.GetStats(closed[0]).get().error);
+
+  // Failed destinations are skipped until they are removed.
+  result = broadcaster.Publish(message.get());
+  EXPECT_EQ(1u, result.failed);
+  broadcaster.Remove(closed[0]);
+  result = broadcaster.Publish(message.get());
+  EXPECT_EQ(1u, result.written);
+  EXPECT_EQ(0u, result.failed);
+  EXPECT_EQ(3u, ReadAvailable(open.fds[1]).size());
+
+  ::close(closed[0]);
+}
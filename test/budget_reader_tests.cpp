@@ -0,0 +1,158 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <nop/serializer.h>
+#include <nop/structure.h>
+#include <nop/utility/budget_reader.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/vector_writer.h>
+
+#include "test_utilities.h"
+
+using nop::BudgetReader;
+using nop::BufferReader;
+using nop::DecodeBudget;
+using nop::Deserializer;
+using nop::ErrorStatus;
+using nop::Serialize;
+using nop::Status;
+
+namespace {
+
+struct Request {
+  std::uint32_t id;
+  std::string name;
+  std::vector<std::uint32_t> values;
+  NOP_STRUCTURE(Request, id, name, values);
+};
+
+template <typename T>
+Status<void> Deserialize(const std::vector<std::uint8_t>& data,
+                         const DecodeBudget& budget, T* value) {
+  BufferReader buffer_reader{data.data(), data.size()};
+  BudgetReader<BufferReader> reader{&buffer_reader, budget};
+  Deserializer<BudgetReader<BufferReader>*> deserializer{&reader};
+  return deserializer.Read(value);
+}
+
+}  // anonymous namespace
+
+TEST(BudgetReader, WithinBudget) {
+  const Request request{1, "name", {1, 2, 3}};
+  const auto data = Serialize(request);
+
+  BufferReader buffer_reader{data.data(), data.size()};
+  BudgetReader<BufferReader> reader{&buffer_reader, DecodeBudget{}};
+  Deserializer<BudgetReader<BufferReader>*> deserializer{&reader};
+
+  Request decoded;
+  ASSERT_TRUE(deserializer.Read(&decoded));
+  EXPECT_EQ("name", decoded.name);
+  EXPECT_EQ(request.values, decoded.values);
+  EXPECT_TRUE(reader.status());
+
+  // The structure and its member count, the three members, and the length
+  // prefixes of the string and the vector.
+  EXPECT_EQ(7u, reader.values());
+  EXPECT_EQ(sizeof(Request) + 3 * sizeof(std::uint64_t) +
+                sizeof(std::uint32_t) + sizeof(std::string) +
+                sizeof(std::vector<std::uint32_t>) + 4 +
+                3 * sizeof(std::uint32_t),
+            reader.bytes());
+}
+
+TEST(BudgetReader, Bytes) {
+  const auto data = Serialize(std::string(1000, 'x'));
+
+  DecodeBudget budget;
+  budget.max_bytes = 1000;
+  std::string decoded;
+  EXPECT_EQ(ErrorStatus::BudgetExceeded,
+            Deserialize(data, budget, &decoded).error());
+
+  budget.max_bytes = 1000 + sizeof(std::string) + sizeof(std::uint64_t);
+  EXPECT_TRUE(Deserialize(data, budget, &decoded));
+
+  // Empty elements are cheap to encode but not to decode.
+  const auto nested = Serialize(std::vector<std::vector<int>>(1000));
+  budget.max_bytes = 100 * sizeof(std::vector<int>);
+  std::vector<std::vector<int>> vectors;
+  EXPECT_EQ(ErrorStatus::BudgetExceeded,
+            Deserialize(nested, budget, &vectors).error());
+  EXPECT_GT(100u, vectors.size());
+}
+
+TEST(BudgetReader, Values) {
+  std::map<std::uint8_t, std::uint8_t> map;
+  for (int i = 0; i < 100; i++)
+    map.emplace(i, i);
+  const auto data = Serialize(map);
+
+  DecodeBudget budget;
+  budget.max_values = 100;
+  std::map<std::uint8_t, std::uint8_t> decoded;
+  EXPECT_EQ(ErrorStatus::BudgetExceeded,
+            Deserialize(data, budget, &decoded).error());
+  EXPECT_GT(50u, decoded.size());
+
+  // The map and its length prefix, and a key and value per element.
+  budget.max_values = 202;
+  EXPECT_TRUE(Deserialize(data, budget, &decoded));
+  EXPECT_EQ(map, decoded);
+}
+
+TEST(BudgetReader, Depth) {
+  using Nested = std::vector<std::vector<std::vector<int>>>;
+  const auto data = Serialize(Nested{{{7}}});
+
+  // The length prefix of the innermost vector is nested one level deeper.
+  DecodeBudget budget;
+  budget.max_depth = 3;
+  Nested decoded;
+  EXPECT_EQ(ErrorStatus::DepthLimitReached,
+            Deserialize(data, budget, &decoded).error());
+
+  budget.max_depth = 4;
+  ASSERT_TRUE(Deserialize(data, budget, &decoded));
+  EXPECT_EQ(7, decoded[0][0][0]);
+}
+
+TEST(BudgetReader, Reset) {
+  const auto data = Serialize(std::string(100, 'x'));
+
+  DecodeBudget budget;
+  budget.max_bytes = 200;
+  BufferReader buffer_reader{data.data(), data.size()};
+  BudgetReader<BufferReader> reader{&buffer_reader, budget};
+  Deserializer<BudgetReader<BufferReader>*> deserializer{&reader};
+
+  std::string decoded;
+  ASSERT_TRUE(deserializer.Read(&decoded));
+
+  // The budget covers a single message until it is reset.
+  buffer_reader = BufferReader{data.data(), data.size()};
+  EXPECT_EQ(ErrorStatus::BudgetExceeded, deserializer.Read(&decoded).error());
+  EXPECT_EQ(ErrorStatus::BudgetExceeded, reader.status().error());
+
+  reader.Reset();
+  buffer_reader = BufferReader{data.data(), data.size()};
+  EXPECT_TRUE(deserializer.Read(&decoded));
+}
@@ -0,0 +1,145 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <nop/serializer.h>
+#include <nop/utility/buffer_pool.h>
+#include <nop/utility/buffer_reader.h>
+
+using nop::BufferPool;
+using nop::BufferReader;
+using nop::Deserializer;
+using nop::PooledBuffer;
+using nop::PooledWriter;
+using nop::Serializer;
+
+namespace {
+
+// Runs |op| on a new thread, which has its own empty BufferPool.
+template <typename Op>
+void RunOnThread(Op op) {
+  std::thread thread{op};
+  thread.join();
+}
+
+}  // anonymous namespace
+
+TEST(BufferPool, Reuse) {
+  RunOnThread([] {
+    const std::string value(1000, 'x');
+    const std::uint8_t* data;
+    std::size_t capacity;
+
+    {
+      Serializer<PooledWriter> serializer;
+      ASSERT_TRUE(serializer.Write(value));
+      data = serializer.writer().data();
+      capacity = serializer.writer().capacity();
+    }
+    EXPECT_EQ(1u, BufferPool::Get().size());
+
+    // The next writer on this thread reuses the storage.
+    {
+      Serializer<PooledWriter> serializer;
+      EXPECT_EQ(0u, BufferPool::Get().size());
+      EXPECT_EQ(data, serializer.writer().data());
+      EXPECT_EQ(capacity, serializer.writer().capacity());
+
+      ASSERT_TRUE(serializer.Write(value));
+      EXPECT_EQ(data, serializer.writer().data());
+
+      std::string result;
+      Deserializer<BufferReader> deserializer{serializer.writer().data(),
+                                              serializer.writer().size()};
+      ASSERT_TRUE(deserializer.Read(&result));
+      EXPECT_EQ(value, result);
+    }
+
+    // Moved-from writers do not return storage to the pool.
+    {
+      PooledWriter writer;
+      PooledWriter other{std::move(writer)};
+      EXPECT_EQ(data, other.data());
+    }
+    EXPECT_EQ(1u, BufferPool::Get().size());
+  });
+}
+
+TEST(BufferPool, Buffer) {
+  RunOnThread([] {
+    const std::uint8_t* data;
+    {
+      PooledBuffer buffer{256};
+      EXPECT_EQ(256u, buffer.size());
+      data = buffer.data();
+    }
+
+    PooledBuffer buffer{100};
+    EXPECT_EQ(data, buffer.data());
+    EXPECT_EQ(100u, buffer.size());
+    EXPECT_LE(256u, buffer.capacity());
+
+    // Decode a message received into the buffer.
+    Serializer<PooledWriter> serializer;
+    ASSERT_TRUE(serializer.Write(std::vector<int>{1, 2, 3}));
+    buffer.resize(serializer.writer().size());
+    std::memcpy(buffer.data(), serializer.writer().data(), buffer.size());
+
+    std::vector<int> result;
+    Deserializer<BufferReader> deserializer{buffer.data(), buffer.size()};
+    ASSERT_TRUE(deserializer.Read(&result));
+    EXPECT_EQ((std::vector<int>{1, 2, 3}), result);
+  });
+}
+
+TEST(BufferPool, Trim) {
+  RunOnThread([] {
+    const std::size_t kInterval = 4;
+    BufferPool::Get().SetLimits(2, kInterval);
+
+    const std::string small(100, 's');
+    const std::string large(1 << 20, 'l');
+    auto write = [](const std::string& value) {
+      Serializer<PooledWriter> serializer;
+      ASSERT_TRUE(serializer.Write(value));
+    };
+
+    write(small);
+    write(large);
+    EXPECT_LE(large.size(), BufferPool::Get().retained());
+
+    // The large buffer is retained while it is within the high-water mark of
+    // the current or previous window, and freed after that.
+    for (std::size_t i = 0; i < 2 * kInterval; i++)
+      write(small);
+    EXPECT_EQ(1u, BufferPool::Get().size());
+    EXPECT_GT(large.size(), BufferPool::Get().retained());
+
+    // More idle buffers than the limit are not retained.
+    {
+      PooledBuffer a{10}, b{10}, c{10};
+    }
+    EXPECT_EQ(2u, BufferPool::Get().size());
+
+    BufferPool::Get().Clear();
+    EXPECT_EQ(0u, BufferPool::Get().size());
+  });
+}
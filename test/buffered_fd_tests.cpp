@@ -0,0 +1,184 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <nop/serializer.h>
+#include <nop/structure.h>
+#include <nop/table.h>
+#include <nop/utility/buffered_fd_reader.h>
+#include <nop/utility/buffered_fd_writer.h>
+
+using nop::BufferedFdReader;
+using nop::BufferedFdWriter;
+using nop::Deserializer;
+using nop::Entry;
+using nop::ErrorStatus;
+using nop::Serializer;
+using nop::Status;
+
+namespace {
+
+struct Message {
+  std::uint32_t id;
+  std::string name;
+  std::vector<std::uint8_t> data;
+  std::map<int, std::string> attributes;
+
+  bool operator==(const Message& other) const {
+    return id == other.id && name == other.name && data == other.data &&
+           attributes == other.attributes;
+  }
+
+  NOP_STRUCTURE(Message, id, name, data, attributes);
+};
+
+struct TableMessage {
+  Entry<std::string, 0> a;
+  Entry<std::vector<int>, 1> b;
+
+  NOP_TABLE(TableMessage, a, b);
+};
+
+struct Pipe {
+  Pipe() {
+    int fds[2];
+    EXPECT_EQ(0, pipe(fds));
+    read_fd = fds[0];
+    write_fd = fds[1];
+  }
+
+  int read_fd;
+  int write_fd;
+};
+
+}  // anonymous namespace
+
+TEST(BufferedFdWriter, CoalescesWrites) {
+  Pipe pipe;
+  Serializer<BufferedFdWriter> serializer{pipe.write_fd, 64u};
+  Deserializer<BufferedFdReader> deserializer{pipe.read_fd, 64u};
+
+  const Message message{10, "foo", {1, 2, 3}, {{1, "a"}, {2, "b"}}};
+  ASSERT_TRUE(serializer.Write(message));
+
+  // Nothing is written to the pipe until the writer is flushed.
+  EXPECT_EQ(serializer.GetSize(message), serializer.writer().size());
+  ASSERT_TRUE(serializer.writer().Flush());
+  EXPECT_EQ(0u, serializer.writer().size());
+
+  Message result;
+  ASSERT_TRUE(deserializer.Read(&result));
+  EXPECT_EQ(message, result);
+  EXPECT_EQ(0u, deserializer.reader().available());
+}
+
+TEST(BufferedFdWriter, PrepareFlushesWhenFull) {
+  Pipe pipe;
+  Serializer<BufferedFdWriter> serializer{pipe.write_fd, 16u};
+  Deserializer<BufferedFdReader> deserializer{pipe.read_fd, 16u};
+
+  ASSERT_TRUE(serializer.Write(std::string(10, 'a')));
+  EXPECT_EQ(12u, serializer.writer().size());
+
+  // The second string does not fit in the remaining space, so Prepare() flushes
+  // the first before buffering the second.
+  ASSERT_TRUE(serializer.Write(std::string(10, 'b')));
+  EXPECT_EQ(12u, serializer.writer().size());
+  ASSERT_TRUE(serializer.writer().Flush());
+
+  std::string result;
+  ASSERT_TRUE(deserializer.Read(&result));
+  EXPECT_EQ(std::string(10, 'a'), result);
+  ASSERT_TRUE(deserializer.Read(&result));
+  EXPECT_EQ(std::string(10, 'b'), result);
+}
+
+TEST(BufferedFdWriter, ExactlyFull) {
+  Pipe pipe;
+  Serializer<BufferedFdWriter> serializer{pipe.write_fd, 16u};
+  Deserializer<BufferedFdReader> deserializer{pipe.read_fd, 16u};
+
+  // A 14 byte vector encodes to 16 bytes, which fills both buffers exactly.
+  const std::vector<std::uint8_t> data(14, 0xaa);
+  ASSERT_TRUE(serializer.Write(data));
+  EXPECT_EQ(16u, serializer.writer().size());
+  ASSERT_TRUE(serializer.Write(std::uint8_t{1}));
+  ASSERT_TRUE(serializer.writer().Flush());
+
+  std::vector<std::uint8_t> result;
+  ASSERT_TRUE(deserializer.Read(&result));
+  EXPECT_EQ(data, result);
+  EXPECT_EQ(0u, deserializer.reader().available());
+
+  std::uint8_t value = 0;
+  ASSERT_TRUE(deserializer.Read(&value));
+  EXPECT_EQ(1u, value);
+}
+
+TEST(BufferedFdReader, LargePayload) {
+  Pipe pipe;
+  Message message{1, "large", std::vector<std::uint8_t>(1 << 20), {}};
+  for (std::size_t i = 0; i < message.data.size(); i++)
+    message.data[i] = static_cast<std::uint8_t>(i * 31);
+
+  // The pipe capacity is smaller than the payload, so write from a separate
+  // thread.
+  std::thread writer_thread{[&] {
+    Serializer<BufferedFdWriter> serializer{pipe.write_fd};
+    EXPECT_TRUE(serializer.Write(message));
+    EXPECT_TRUE(serializer.Write(message));
+  }};
+
+  Deserializer<BufferedFdReader> deserializer{pipe.read_fd};
+  Message result;
+  ASSERT_TRUE(deserializer.Read(&result));
+  EXPECT_EQ(message, result);
+  ASSERT_TRUE(deserializer.Read(&result));
+  EXPECT_EQ(message, result);
+
+  writer_thread.join();
+
+  // The writer closed its end of the pipe.
+  EXPECT_EQ(ErrorStatus::ReadLimitReached, deserializer.Read(&result).error());
+}
+
+TEST(BufferedFdReader, Table) {
+  Pipe pipe;
+  Serializer<BufferedFdWriter> serializer{pipe.write_fd, 8u};
+  Deserializer<BufferedFdReader> deserializer{pipe.read_fd, 8u};
+
+  TableMessage message;
+  message.a = std::string(20, 'x');
+  message.b = std::vector<int>{1, 2, 3, 4, 5, 6, 7, 8};
+  ASSERT_TRUE(serializer.Write(message));
+  ASSERT_TRUE(serializer.Write(std::string{"end"}));
+  ASSERT_TRUE(serializer.writer().Flush());
+
+  TableMessage result;
+  ASSERT_TRUE(deserializer.Read(&result));
+  EXPECT_EQ(message.a.get(), result.a.get());
+  EXPECT_EQ(message.b.get(), result.b.get());
+
+  std::string end;
+  ASSERT_TRUE(deserializer.Read(&end));
+  EXPECT_EQ("end", end);
+}
@@ -0,0 +1,222 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <nop/serializer.h>
+#include <nop/structure.h>
+#include <nop/table.h>
+#include <nop/types/cached.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/vector_writer.h>
+
+#include "test_utilities.h"
+
+using nop::BufferReader;
+using nop::Cached;
+using nop::Deserializer;
+using nop::Encoding;
+using nop::EncodingByte;
+using nop::EncodingIO;
+using nop::Entry;
+using nop::Serialize;
+using nop::Serializer;
+using nop::Status;
+using nop::VectorWriter;
+
+namespace {
+
+// Counts the number of times values of this type are encoded.
+struct Counted {
+  std::uint32_t value;
+  static int writes;
+  static int sizes;
+};
+int Counted::writes = 0;
+int Counted::sizes = 0;
+
+struct Config {
+  std::string name;
+  std::vector<std::uint32_t> limits;
+  NOP_STRUCTURE(Config, name, limits);
+};
+
+struct Response {
+  Cached<Config> config;
+  std::string body;
+  NOP_STRUCTURE(Response, config, body);
+};
+
+struct PlainResponse {
+  Config config;
+  std::string body;
+  NOP_STRUCTURE(PlainResponse, config, body);
+};
+
+struct InnerTable {
+  Entry<std::string, 0> name;
+  Entry<std::vector<std::uint32_t>, 1> limits;
+  NOP_TABLE_HASH(1, InnerTable, name, limits);
+};
+
+struct OuterTable {
+  Entry<int, 0> id;
+  Entry<Cached<InnerTable>, 1> inner;
+  Entry<std::string, 2> label;
+  NOP_TABLE_HASH(2, OuterTable, id, inner, label);
+};
+
+struct PlainOuterTable {
+  Entry<int, 0> id;
+  Entry<InnerTable, 1> inner;
+  Entry<std::string, 2> label;
+  NOP_TABLE_HASH(2, PlainOuterTable, id, inner, label);
+};
+
+}  // anonymous namespace
+
+namespace nop {
+
+template <>
+struct Encoding<Counted> : EncodingIO<Counted> {
+  static constexpr EncodingByte Prefix(const Counted& /*value*/) {
+    return EncodingByte::U32;
+  }
+
+  static std::size_t Size(const Counted& value) {
+    Counted::sizes++;
+    return BaseEncodingSize(Prefix(value));
+  }
+
+  static constexpr bool Match(EncodingByte prefix) {
+    return prefix == EncodingByte::U32;
+  }
+
+  template <typename Writer>
+  static Status<void> WritePayload(EncodingByte /*prefix*/,
+                                   const Counted& value, Writer* writer) {
+    Counted::writes++;
+    return writer->Write(&value.value, &value.value + 1);
+  }
+
+  template <typename Reader>
+  static Status<void> ReadPayload(EncodingByte /*prefix*/, Counted* value,
+                                  Reader* reader) {
+    return reader->Read(&value->value, &value->value + 1);
+  }
+};
+
+}  // namespace nop
+
+TEST(Cached, Reuse) {
+  Counted::writes = 0;
+  Counted::sizes = 0;
+
+  const Cached<std::vector<Counted>> value{
+      std::vector<Counted>{{1}, {2}, {3}}};
+  const auto data = Serialize(std::vector<Counted>{{1}, {2}, {3}});
+  EXPECT_EQ(3, Counted::writes);
+
+  // The value is encoded once, the first time it is used.
+  Counted::writes = 0;
+  Counted::sizes = 0;
+  for (int i = 0; i < 10; i++)
+    EXPECT_EQ(data, Serialize(value));
+  EXPECT_EQ(3, Counted::writes);
+
+  // Copies share the cache.
+  const Cached<std::vector<Counted>> copy = value;
+  EXPECT_EQ(data, Serialize(copy));
+  EXPECT_EQ(&value.encoded(), &copy.encoded());
+  EXPECT_EQ(3, Counted::writes);
+}
+
+TEST(Cached, Fungible) {
+  const Cached<Config> config{Config{"default", {1, 2, 3}}};
+  const Response response{config, "body"};
+  const PlainResponse plain{*config, "body"};
+
+  const auto data = Serialize(response);
+  EXPECT_EQ(Serialize(plain), data);
+
+  Response decoded;
+  Deserializer<BufferReader> deserializer{data.data(), data.size()};
+  ASSERT_TRUE(deserializer.Read(&decoded));
+  EXPECT_EQ("default", decoded.config->name);
+  EXPECT_EQ(config->limits, decoded.config->limits);
+  EXPECT_EQ("body", decoded.body);
+}
+
+TEST(Cached, NestedTable) {
+  InnerTable inner;
+  inner.name = std::string{"default"};
+  inner.limits = std::vector<std::uint32_t>{1, 2, 3};
+
+  PlainOuterTable plain;
+  plain.id = 1;
+  plain.inner = inner;
+  plain.label = std::string{"label"};
+  const auto expected = Serialize(plain);
+
+  // The inner table is first encoded while the size of the outer table is
+  // computed, which must not disturb the entry sizes recorded for the outer
+  // table.
+  OuterTable outer;
+  outer.id = 1;
+  outer.inner = Cached<InnerTable>{inner};
+  outer.label = std::string{"label"};
+  EXPECT_EQ(expected, Serialize(outer));
+
+  // Later writes use the cached encoding.
+  EXPECT_EQ(expected, Serialize(outer));
+  EXPECT_EQ(Serialize(std::vector<PlainOuterTable>{plain, plain}),
+            Serialize(std::vector<OuterTable>{outer, outer}));
+
+  OuterTable decoded;
+  Deserializer<BufferReader> deserializer{expected.data(), expected.size()};
+  ASSERT_TRUE(deserializer.Read(&decoded));
+  EXPECT_EQ(1, decoded.id.get());
+  EXPECT_EQ("default", decoded.inner.get()->name.get());
+  EXPECT_EQ(inner.limits.get(), decoded.inner.get()->limits.get());
+  EXPECT_EQ("label", decoded.label.get());
+}
+
+TEST(Cached, Concurrent) {
+  Counted::writes = 0;
+  const Cached<std::vector<Counted>> value{std::vector<Counted>(100, {7})};
+
+  std::vector<std::thread> threads;
+  std::vector<std::vector<std::uint8_t>> results(4);
+  for (auto& result : results) {
+    threads.emplace_back([&value, &result] {
+      Serializer<VectorWriter> serializer;
+      for (int i = 0; i < 100; i++) {
+        serializer.writer().Reset();
+        EXPECT_TRUE(serializer.Write(value));
+      }
+      result = serializer.writer().Take();
+    });
+  }
+  for (auto& thread : threads)
+    thread.join();
+
+  EXPECT_EQ(100, Counted::writes);
+  for (const auto& result : results)
+    EXPECT_EQ(results[0], result);
+}
@@ -0,0 +1,224 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <nop/rpc/channel_mux.h>
+#include <nop/rpc/interface.h>
+#include <nop/serializer.h>
+#include <nop/utility/fd_reader.h>
+#include <nop/utility/fd_writer.h>
+
+using nop::BindInterface;
+using nop::ChannelMux;
+using nop::Deserializer;
+using nop::ErrorStatus;
+using nop::FdReader;
+using nop::FdWriter;
+using nop::Interface;
+using nop::Serializer;
+using nop::Status;
+
+namespace {
+
+struct Calculator : Interface<Calculator> {
+  NOP_INTERFACE("io.github.eieio.test.Calculator");
+  NOP_METHOD(Sum, int(int a, int b));
+  NOP_INTERFACE_API(Sum);
+};
+
+struct Echo : Interface<Echo> {
+  NOP_INTERFACE("io.github.eieio.test.Echo");
+  NOP_METHOD(Repeat, std::string(const std::string& value, int count));
+  NOP_INTERFACE_API(Repeat);
+};
+
+using Mux = ChannelMux<Serializer<FdWriter>, Deserializer<FdReader>>;
+
+// One end of a connection made of a pair of pipes.
+struct Endpoint {
+  Endpoint(int write_fd, int read_fd, std::size_t window)
+      : serializer{write_fd}, deserializer{read_fd},
+        mux{&serializer, &deserializer, window} {}
+
+  Serializer<FdWriter> serializer;
+  Deserializer<FdReader> deserializer;
+  Mux mux;
+};
+
+struct Connection {
+  explicit Connection(std::size_t window = Mux::kDefaultWindow) {
+    int forward[2], backward[2];
+    EXPECT_EQ(0, ::pipe(forward));
+    EXPECT_EQ(0, ::pipe(backward));
+    client.reset(new Endpoint{forward[1], backward[0], window});
+    server.reset(new Endpoint{backward[1], forward[0], window});
+  }
+
+  std::unique_ptr<Endpoint> client;
+  std::unique_ptr<Endpoint> server;
+};
+
+// Reads frames until the connection is closed and then fails the channels.
+std::thread ReadFrames(Mux* mux) {
+  return std::thread{[mux] {
+    while (mux->Receive()) {
+    }
+    mux->Close(ErrorStatus::IOError);
+  }};
+}
+
+}  // anonymous namespace
+
+TEST(ChannelMux, Interfaces) {
+  Connection connection;
+  Mux& client = connection.client->mux;
+  Mux& server = connection.server->mux;
+
+  // Each channel dispatches its own interface bindings.
+  Mux::Channel* calculator = server.Open(1);
+  Mux::Channel* echo = server.Open(2);
+  std::thread calculator_server{[calculator] {
+    auto dispatcher = BindInterface(
+        Calculator::Sum::Bind([](int a, int b) { return a + b; }));
+    while (dispatcher(calculator)) {
+    }
+  }};
+  std::thread echo_server{[echo] {
+    auto dispatcher = BindInterface(
+        Echo::Repeat::Bind([](const std::string& value, int count) {
+          std::string result;
+          for (int i = 0; i < count; i++)
+            result += value;
+          return result;
+        }));
+    while (dispatcher(echo)) {
+    }
+  }};
+
+  Mux::Channel* calculator_client = client.Open(1);
+  Mux::Channel* echo_client = client.Open(2);
+  std::thread server_reader = ReadFrames(&server);
+  std::thread client_reader = ReadFrames(&client);
+
+  // Calls on different channels proceed concurrently.
+  const int kCount = 200;
+  std::thread sums{[calculator_client] {
+    for (int i = 0; i < kCount; i++)
+      EXPECT_EQ(2 * i, Calculator::Sum::Invoke(calculator_client, i, i).get());
+  }};
+  for (int i = 0; i < kCount; i++) {
+    EXPECT_EQ(std::string(i % 8, 'x'),
+              Echo::Repeat::Invoke(echo_client, "x", i % 8).get());
+  }
+  sums.join();
+
+  // Calls with unbound selectors stop the dispatcher of the channel, so the
+  // caller waits for a reply until the connection is closed.
+  Status<std::string> mismatch;
+  std::thread mismatch_caller{[calculator_client, &mismatch] {
+    mismatch = Echo::Repeat::Invoke(calculator_client, "x", 1);
+  }};
+  calculator_server.join();
+
+  // Closing the connection stops the readers and fails the waiting channels.
+  connection.client->serializer.writer().Clear();
+  server_reader.join();
+  echo_server.join();
+  connection.server->serializer.writer().Clear();
+  client_reader.join();
+  mismatch_caller.join();
+  EXPECT_EQ(ErrorStatus::IOError, mismatch.error());
+  EXPECT_TRUE(client.is_closed());
+}
+
+TEST(ChannelMux, FlowControl) {
+  // With a small window, a consumer that does not keep up stops the sender of
+  // its channel without affecting the other channels.
+  Connection connection{64};
+  Mux& client = connection.client->mux;
+  Mux& server = connection.server->mux;
+  Mux::Channel* slow = client.Open(1);
+  Mux::Channel* fast = client.Open(2);
+  Mux::Channel* slow_server = server.Open(1);
+  Mux::Channel* fast_server = server.Open(2);
+
+  const std::string value(20, 'x');
+  const std::size_t message_size = 22;
+  EXPECT_EQ(64u, slow->credit());
+  ASSERT_TRUE(slow->Send(value));
+  ASSERT_TRUE(slow->Send(value));
+  EXPECT_EQ(64u - 2 * message_size, slow->credit());
+  ASSERT_TRUE(fast->Send(value));
+
+  for (int i = 0; i < 3; i++)
+    ASSERT_TRUE(server.Receive());
+  EXPECT_EQ(2u, slow_server->queued());
+  EXPECT_EQ(1u, fast_server->queued());
+
+  // Draining the fast channel returns its credit in a credit-only frame.
+  auto message = fast_server->Receive();
+  ASSERT_TRUE(message);
+  std::string result;
+  ASSERT_TRUE(message.get()->Read(&result));
+  EXPECT_EQ(value, result);
+  ASSERT_TRUE(client.Receive());
+  EXPECT_EQ(64u, fast->credit());
+
+  // The slow channel blocks until its consumer frees enough of the window.
+  // Consuming less than half of the window while messages remain queued does
+  // not return credit.
+  std::thread sender{[slow, &value] { EXPECT_TRUE(slow->Send(value)); }};
+  ASSERT_TRUE(slow_server->Receive());
+  EXPECT_EQ(1u, slow_server->queued());
+  ASSERT_TRUE(slow_server->Receive());
+  ASSERT_TRUE(client.Receive());
+  sender.join();
+  EXPECT_EQ(64u - message_size, slow->credit());
+
+  ASSERT_TRUE(server.Receive());
+  EXPECT_EQ(1u, slow_server->queued());
+}
+
+TEST(ChannelMux, Errors) {
+  Connection connection{64};
+  Mux& client = connection.client->mux;
+  Mux& server = connection.server->mux;
+  Mux::Channel* channel = client.Open(1);
+  EXPECT_EQ(channel, client.Open(1));
+
+  // Messages larger than the window can never be sent.
+  EXPECT_EQ(ErrorStatus::WriteLimitReached,
+            channel->Send(std::string(64, 'x')).error());
+
+  // Frames for channels that are not open are rejected.
+  ASSERT_TRUE(channel->Send(1));
+  EXPECT_EQ(ErrorStatus::ProtocolError, server.Receive().error());
+
+  // Closing fails waiting and new calls, after the queued messages.
+  Mux::Channel* server_channel = server.Open(3);
+  ASSERT_TRUE(client.Open(3)->Send(2));
+  ASSERT_TRUE(server.Receive());
+  server.Close(ErrorStatus::IOError);
+  EXPECT_TRUE(server_channel->Receive());
+  EXPECT_EQ(ErrorStatus::IOError, server_channel->Receive().error());
+  EXPECT_EQ(ErrorStatus::IOError,
+            Calculator::Sum::Invoke(server_channel, 1, 2).error());
+}
@@ -0,0 +1,190 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <nop/serializer.h>
+#include <nop/table.h>
+#include <nop/utility/checksum_reader.h>
+#include <nop/utility/checksum_writer.h>
+#include <nop/utility/crc32c.h>
+#include <nop/utility/pedantic_buffer_reader.h>
+#include <nop/utility/vector_writer.h>
+
+using nop::ChecksumReader;
+using nop::ChecksumWriter;
+using nop::Crc32c;
+using nop::Deserializer;
+using nop::Entry;
+using nop::ErrorStatus;
+using nop::PedanticBufferReader;
+using nop::Serializer;
+using nop::VectorWriter;
+
+namespace {
+
+struct JournalRecord {
+  Entry<std::uint64_t, 0> sequence;
+  Entry<std::string, 1> key;
+  Entry<std::vector<std::uint8_t>, 2> value;
+  NOP_TABLE(JournalRecord, sequence, key, value);
+};
+
+JournalRecord MakeRecord(std::uint64_t sequence) {
+  JournalRecord record;
+  record.sequence = sequence;
+  record.key = "journal/" + std::to_string(sequence);
+  record.value = std::vector<std::uint8_t>(sequence * 10, 0xa5);
+  return record;
+}
+
+}  // anonymous namespace
+
+TEST(Crc32c, Compute) {
+  // Check values from RFC 3720, appendix B.4.
+  const std::uint8_t zeros[32] = {};
+  EXPECT_EQ(0x8a9136aau, Crc32c::Compute(zeros, sizeof(zeros)));
+
+  std::uint8_t ones[32];
+  std::memset(ones, 0xff, sizeof(ones));
+  EXPECT_EQ(0x62a8ab43u, Crc32c::Compute(ones, sizeof(ones)));
+
+  const char digits[] = "123456789";
+  EXPECT_EQ(0xe3069283u, Crc32c::Compute(digits, 9));
+  EXPECT_EQ(0u, Crc32c::Compute(digits, 0));
+
+  // Extending in pieces of every alignment matches a single computation.
+  std::mt19937 engine{7};
+  std::vector<std::uint8_t> data(1000);
+  for (auto& byte : data)
+    byte = static_cast<std::uint8_t>(engine());
+
+  const std::uint32_t expected = Crc32c::Compute(data.data(), data.size());
+  EXPECT_EQ(expected,
+            ~Crc32c::ExtendPortable(~0u, data.data(), data.size()));
+  for (std::size_t split = 0; split < 17; split++) {
+    std::uint32_t crc = Crc32c::Compute(data.data(), split);
+    crc = Crc32c::Extend(crc, data.data() + split, data.size() - split);
+    EXPECT_EQ(expected, crc);
+  }
+}
+
+TEST(ChecksumWriter, RoundTrip) {
+  const std::uint64_t kCount = 10;
+  VectorWriter vector_writer;
+  Serializer<ChecksumWriter<VectorWriter>> serializer{&vector_writer};
+
+  std::size_t expected_size = 0;
+  for (std::uint64_t i = 0; i < kCount; i++) {
+    const JournalRecord record = MakeRecord(i);
+    ASSERT_TRUE(serializer.Write(record));
+    expected_size += nop::kChecksumFrameHeaderSize +
+                     nop::Encoding<JournalRecord>::Size(record) +
+                     nop::kChecksumFrameTrailerSize;
+    EXPECT_EQ(expected_size, vector_writer.size());
+    EXPECT_EQ(0u, serializer.writer().remaining());
+  }
+
+  // The header holds the length of the first message and the trailer the
+  // checksum of the header and the message.
+  const std::size_t length = nop::Encoding<JournalRecord>::Size(MakeRecord(0));
+  std::uint32_t header, trailer;
+  std::memcpy(&header, vector_writer.data(), sizeof(header));
+  std::memcpy(&trailer, vector_writer.data() + sizeof(header) + length,
+              sizeof(trailer));
+  EXPECT_EQ(length, header);
+  EXPECT_EQ(Crc32c::Compute(vector_writer.data(), sizeof(header) + length),
+            trailer);
+
+  PedanticBufferReader buffer_reader{vector_writer.data(),
+                                     vector_writer.size()};
+  Deserializer<ChecksumReader<PedanticBufferReader>> deserializer{
+      &buffer_reader};
+  for (std::uint64_t i = 0; i < kCount; i++) {
+    JournalRecord record;
+    ASSERT_TRUE(deserializer.Read(&record));
+    EXPECT_EQ(i, record.sequence.get());
+    EXPECT_EQ(MakeRecord(i).key.get(), record.key.get());
+    EXPECT_EQ(MakeRecord(i).value.get(), record.value.get());
+    EXPECT_EQ(0u, deserializer.reader().remaining());
+  }
+  EXPECT_TRUE(buffer_reader.empty());
+
+  JournalRecord record;
+  EXPECT_EQ(ErrorStatus::ReadLimitReached, deserializer.Read(&record).error());
+}
+
+TEST(ChecksumWriter, Limits) {
+  VectorWriter vector_writer;
+  ChecksumWriter<VectorWriter> writer{&vector_writer};
+
+  // Data must be written within a prepared message.
+  EXPECT_EQ(ErrorStatus::WriteLimitReached, writer.Write(0x01).error());
+
+  ASSERT_TRUE(writer.Prepare(2));
+  EXPECT_EQ(ErrorStatus::WriteLimitReached, writer.Prepare(3).error());
+  ASSERT_TRUE(writer.Write(0x01));
+  EXPECT_EQ(ErrorStatus::WriteLimitReached, writer.Skip(2).error());
+  ASSERT_TRUE(writer.Skip(1, 0xff));
+  EXPECT_EQ(0u, writer.remaining());
+  EXPECT_EQ(10u, vector_writer.size());
+
+  PedanticBufferReader buffer_reader{vector_writer.data(),
+                                     vector_writer.size()};
+  ChecksumReader<PedanticBufferReader> reader{&buffer_reader};
+  std::uint8_t byte;
+  ASSERT_TRUE(reader.Read(&byte));
+  EXPECT_EQ(0x01, byte);
+  EXPECT_EQ(ErrorStatus::ReadLimitReached, reader.Ensure(2).error());
+  EXPECT_EQ(ErrorStatus::ReadLimitReached, reader.Skip(2).error());
+  ASSERT_TRUE(reader.Skip(1));
+  EXPECT_TRUE(buffer_reader.empty());
+}
+
+TEST(ChecksumReader, Corrupt) {
+  VectorWriter vector_writer;
+  Serializer<ChecksumWriter<VectorWriter>> serializer{&vector_writer};
+  ASSERT_TRUE(serializer.Write(MakeRecord(3)));
+  const std::vector<std::uint8_t> data(
+      vector_writer.data(), vector_writer.data() + vector_writer.size());
+
+  // Flipping any single bit of the payload or the checksum is detected.
+  for (std::size_t i = nop::kChecksumFrameHeaderSize; i < data.size(); i++) {
+    std::vector<std::uint8_t> corrupt = data;
+    corrupt[i] ^= 0x10;
+
+    PedanticBufferReader buffer_reader{corrupt.data(), corrupt.size()};
+    Deserializer<ChecksumReader<PedanticBufferReader>> deserializer{
+        &buffer_reader};
+    JournalRecord record;
+    EXPECT_FALSE(deserializer.Read(&record)) << "Corrupt byte: " << i;
+  }
+
+  // A corrupted length with an intact message fails the checksum.
+  std::vector<std::uint8_t> corrupt = data;
+  corrupt.insert(corrupt.end(), 4, 0x00);
+  corrupt[0] += 4;
+  PedanticBufferReader buffer_reader{corrupt.data(), corrupt.size()};
+  ChecksumReader<PedanticBufferReader> reader{&buffer_reader};
+  std::vector<std::uint8_t> payload(data.size() - 8 + 4);
+  EXPECT_EQ(ErrorStatus::ProtocolError,
+            reader.Read(payload.data(), payload.data() + payload.size())
+                .error());
+}
@@ -0,0 +1,149 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include <nop/base/skip.h>
+#include <nop/serializer.h>
+#include <nop/structure.h>
+#include <nop/types/time_deltas.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/pedantic_buffer_reader.h>
+#include <nop/utility/vector_writer.h>
+
+#include "test_utilities.h"
+
+using nop::Deserialize;
+using nop::EncodingByte;
+using nop::ErrorStatus;
+using nop::FixedEncodingSize;
+using nop::Serialize;
+using nop::SkipValue;
+using nop::TimeDeltas;
+
+using std::chrono::duration;
+using std::chrono::microseconds;
+using std::chrono::milliseconds;
+using std::chrono::nanoseconds;
+using std::chrono::seconds;
+using std::chrono::system_clock;
+using std::chrono::time_point;
+
+namespace {
+
+using TimePoint = time_point<system_clock, nanoseconds>;
+
+struct EventBatch {
+  TimeDeltas<std::vector<TimePoint>> timestamps;
+  std::vector<std::uint32_t> codes;
+  NOP_STRUCTURE(EventBatch, timestamps, codes);
+};
+
+std::vector<TimePoint> MakeTimestamps(std::size_t count) {
+  std::vector<TimePoint> timestamps;
+  const TimePoint base{nanoseconds{1500000000123456789}};
+  for (std::size_t i = 0; i < count; i++)
+    timestamps.push_back(base + microseconds{i * 250});
+  return timestamps;
+}
+
+}  // anonymous namespace
+
+TEST(Chrono, Duration) {
+  // Durations use the compact integer encodings of their counts.
+  EXPECT_EQ(std::vector<std::uint8_t>{5}, Serialize(seconds{5}));
+  EXPECT_EQ((std::vector<std::uint8_t>{0x85, 0x18, 0xfc}),
+            Serialize(milliseconds{-1000}));
+  EXPECT_EQ(9u, Serialize(nanoseconds{-0x7000000000000000}).size());
+
+  nanoseconds decoded;
+  ASSERT_TRUE(Deserialize(Serialize(nanoseconds{123456789}), &decoded));
+  EXPECT_EQ(nanoseconds{123456789}, decoded);
+
+  // Floating point counts use the floating point encodings.
+  const duration<double> fractional{1.5};
+  duration<double> decoded_fractional;
+  const auto data = Serialize(fractional);
+  EXPECT_EQ(static_cast<std::uint8_t>(EncodingByte::F64), data[0]);
+  ASSERT_TRUE(Deserialize(data, &decoded_fractional));
+  EXPECT_EQ(fractional, decoded_fractional);
+  static_assert(FixedEncodingSize<duration<double>>::value == 9, "");
+
+  // The encoding is interchangeable with the count.
+  std::int64_t count = 0;
+  ASSERT_TRUE(Deserialize(Serialize(microseconds{-42}), &count));
+  EXPECT_EQ(-42, count);
+  EXPECT_EQ(ErrorStatus::UnexpectedEncodingType,
+            Deserialize(Serialize(std::string{"x"}), &decoded).error());
+}
+
+TEST(Chrono, TimePoint) {
+  const TimePoint now = system_clock::now();
+  TimePoint decoded;
+  ASSERT_TRUE(Deserialize(Serialize(now), &decoded));
+  EXPECT_EQ(now, decoded);
+
+  const time_point<system_clock, seconds> epoch{seconds{2}};
+  EXPECT_EQ(std::vector<std::uint8_t>{2}, Serialize(epoch));
+}
+
+TEST(Chrono, TimeDeltas) {
+  for (std::size_t count : {0u, 1u, 2u, 100u}) {
+    const auto timestamps = MakeTimestamps(count);
+    const auto data = Serialize(TimeDeltas<std::vector<TimePoint>>{timestamps});
+
+    TimeDeltas<std::vector<TimePoint>> decoded{MakeTimestamps(3)};
+    ASSERT_TRUE(Deserialize(data, &decoded));
+    EXPECT_EQ(timestamps, decoded.get());
+
+    nop::BufferReader reader{data.data(), data.size()};
+    EXPECT_TRUE(SkipValue(&reader));
+    EXPECT_EQ(0u, reader.remaining());
+
+    // Offsets of up to a few milliseconds use the I32 encoding, rather than the
+    // full I64 encoding of each timestamp.
+    if (count > 1) {
+      EXPECT_EQ(1 + 1 + 9 + (count - 1) * 5, data.size());
+    }
+  }
+
+  // Offsets wrap around the range of the count.
+  const std::vector<nanoseconds> extremes{
+      nanoseconds{std::numeric_limits<std::int64_t>::max()},
+      nanoseconds{std::numeric_limits<std::int64_t>::min()}, nanoseconds{0}};
+  TimeDeltas<std::vector<nanoseconds>> decoded_extremes;
+  ASSERT_TRUE(Deserialize(Serialize(TimeDeltas<std::vector<nanoseconds>>{
+                              extremes}),
+                          &decoded_extremes));
+  EXPECT_EQ(extremes, decoded_extremes.get());
+
+  EventBatch batch{MakeTimestamps(10), std::vector<std::uint32_t>(10, 7)};
+  EventBatch decoded_batch;
+  ASSERT_TRUE(Deserialize(Serialize(batch), &decoded_batch));
+  EXPECT_EQ(batch.timestamps, decoded_batch.timestamps);
+
+  TimeDeltas<std::vector<TimePoint>> decoded;
+  EXPECT_EQ(ErrorStatus::UnexpectedEncodingType,
+            Deserialize(Serialize(std::vector<std::int64_t>{1, 2}), &decoded)
+                .error());
+  EXPECT_EQ(ErrorStatus::ReadLimitReached,
+            Deserialize(std::vector<std::uint8_t>{0xba, 0x02, 0x01}, &decoded)
+                .error());
+}
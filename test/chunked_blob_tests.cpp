@@ -0,0 +1,206 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <nop/serializer.h>
+#include <nop/structure.h>
+#include <nop/traits/is_fungible.h>
+#include <nop/types/chunked_blob.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/stream_reader.h>
+#include <nop/utility/stream_writer.h>
+#include <nop/utility/vector_writer.h>
+
+using nop::BufferReader;
+using nop::ChunkedBlob;
+using nop::Deserializer;
+using nop::ErrorStatus;
+using nop::IsFungible;
+using nop::Serializer;
+using nop::Status;
+using nop::StreamReader;
+using nop::StreamWriter;
+using nop::VectorWriter;
+
+namespace {
+
+struct Image {
+  std::string name;
+  ChunkedBlob data;
+  std::uint32_t checksum;
+  NOP_STRUCTURE(Image, name, data, checksum);
+};
+
+struct BufferedImage {
+  std::string name;
+  std::vector<std::uint8_t> data;
+  std::uint32_t checksum;
+  NOP_STRUCTURE(BufferedImage, name, data, checksum);
+};
+
+std::vector<std::uint8_t> MakePayload(std::size_t size) {
+  std::vector<std::uint8_t> payload(size);
+  for (std::size_t i = 0; i < size; i++)
+    payload[i] = static_cast<std::uint8_t>(i * 31 + (i >> 8));
+  return payload;
+}
+
+// Returns a blob that streams |payload|, recording the largest chunk.
+ChunkedBlob MakeSource(const std::vector<std::uint8_t>& payload,
+                       std::size_t chunk_size, std::size_t* max_chunk) {
+  auto offset = std::make_shared<std::size_t>(0);
+  return ChunkedBlob::FromSource(
+      payload.size(),
+      [&payload, offset, max_chunk](std::uint8_t* data, std::size_t size) {
+        std::copy(payload.begin() + *offset, payload.begin() + *offset + size,
+                  data);
+        *offset += size;
+        *max_chunk = std::max(*max_chunk, size);
+        return Status<void>{};
+      },
+      chunk_size);
+}
+
+// Returns a blob that appends to |payload|, recording the largest chunk.
+ChunkedBlob MakeSink(std::vector<std::uint8_t>* payload,
+                     std::size_t chunk_size, std::size_t* max_chunk,
+                     std::uint64_t max_size = UINT64_MAX) {
+  return ChunkedBlob::ToSink(
+      [payload, max_chunk](const std::uint8_t* data, std::size_t size) {
+        payload->insert(payload->end(), data, data + size);
+        *max_chunk = std::max(*max_chunk, size);
+        return Status<void>{};
+      },
+      max_size, chunk_size);
+}
+
+}  // anonymous namespace
+
+TEST(ChunkedBlob, Stream) {
+  const std::vector<std::uint8_t> payload = MakePayload(1024 * 1024 + 17);
+  const std::size_t kChunkSize = 4096;
+
+  // The stream writer does not prepare, so the payload is never buffered whole.
+  std::size_t max_source_chunk = 0;
+  Serializer<StreamWriter<std::stringstream>> serializer;
+  Image image{"disk", MakeSource(payload, kChunkSize, &max_source_chunk), 7};
+  ASSERT_TRUE(serializer.Write(image));
+  EXPECT_EQ(kChunkSize, max_source_chunk);
+
+  std::vector<std::uint8_t> received;
+  std::size_t max_sink_chunk = 0;
+  Deserializer<StreamReader<std::stringstream>> deserializer{
+      serializer.writer().stream().str()};
+  Image decoded{"", MakeSink(&received, kChunkSize, &max_sink_chunk), 0};
+  ASSERT_TRUE(deserializer.Read(&decoded));
+  EXPECT_EQ("disk", decoded.name);
+  EXPECT_EQ(7u, decoded.checksum);
+  EXPECT_EQ(payload.size(), decoded.data.size());
+  EXPECT_EQ(payload, received);
+  EXPECT_EQ(kChunkSize, max_sink_chunk);
+}
+
+TEST(ChunkedBlob, Fungible) {
+  EXPECT_TRUE((IsFungible<ChunkedBlob, std::vector<std::uint8_t>>::value));
+  EXPECT_TRUE((IsFungible<std::vector<std::uint8_t>, ChunkedBlob>::value));
+  EXPECT_TRUE((IsFungible<Image, BufferedImage>::value));
+  EXPECT_FALSE((IsFungible<ChunkedBlob, std::vector<std::uint16_t>>::value));
+
+  const std::vector<std::uint8_t> payload = MakePayload(10000);
+
+  // Blobs are read back as vectors.
+  std::size_t max_chunk = 0;
+  Serializer<VectorWriter> serializer;
+  ASSERT_TRUE(serializer.Write(Image{"a", MakeSource(payload, 999, &max_chunk),
+                                     1}));
+  Deserializer<BufferReader> deserializer{serializer.writer().data(),
+                                          serializer.writer().size()};
+  BufferedImage buffered;
+  ASSERT_TRUE(deserializer.Read(&buffered));
+  EXPECT_EQ(payload, buffered.data);
+
+  // Vectors are read as blobs. The buffer reader lends its input to the sink
+  // in chunks.
+  std::vector<std::uint8_t> received;
+  max_chunk = 0;
+  Deserializer<BufferReader> blob_deserializer{serializer.writer().data(),
+                                               serializer.writer().size()};
+  Image image{"", MakeSink(&received, 1000, &max_chunk), 0};
+  ASSERT_TRUE(blob_deserializer.Read(&image));
+  EXPECT_EQ(payload, received);
+  EXPECT_EQ(1000u, max_chunk);
+}
+
+TEST(ChunkedBlob, Errors) {
+  const std::vector<std::uint8_t> payload = MakePayload(100);
+  Serializer<VectorWriter> serializer;
+
+  // Blobs without a source or sink.
+  EXPECT_EQ(ErrorStatus::InvalidContainerLength,
+            serializer.Write(ChunkedBlob{}).error());
+  serializer.writer().Reset();
+  ASSERT_TRUE(serializer.Write(payload));
+  const std::vector<std::uint8_t> encoded = serializer.writer().Take();
+  {
+    Deserializer<BufferReader> deserializer{encoded.data(), encoded.size()};
+    ChunkedBlob blob;
+    EXPECT_EQ(ErrorStatus::InvalidContainerLength,
+              deserializer.Read(&blob).error());
+  }
+
+  // Payloads over the limit are rejected before reaching the sink.
+  {
+    std::vector<std::uint8_t> received;
+    std::size_t max_chunk = 0;
+    Deserializer<BufferReader> deserializer{encoded.data(), encoded.size()};
+    ChunkedBlob blob = MakeSink(&received, 16, &max_chunk, 99);
+    EXPECT_EQ(ErrorStatus::InvalidContainerLength,
+              deserializer.Read(&blob).error());
+    EXPECT_TRUE(received.empty());
+  }
+
+  // Sink and source errors abort the operation.
+  {
+    Deserializer<BufferReader> deserializer{encoded.data(), encoded.size()};
+    ChunkedBlob blob = ChunkedBlob::ToSink(
+        [](const std::uint8_t*, std::size_t) -> Status<void> {
+          return ErrorStatus::IOError;
+        });
+    EXPECT_EQ(ErrorStatus::IOError, deserializer.Read(&blob).error());
+
+    blob = ChunkedBlob::FromSource(
+        10, [](std::uint8_t*, std::size_t) -> Status<void> {
+          return ErrorStatus::IOError;
+        });
+    EXPECT_EQ(ErrorStatus::IOError, serializer.Write(blob).error());
+  }
+
+  // Truncated input.
+  {
+    std::vector<std::uint8_t> received;
+    std::size_t max_chunk = 0;
+    Deserializer<StreamReader<std::stringstream>> deserializer{std::string{
+        encoded.begin(), encoded.end() - 1}};
+    ChunkedBlob blob = MakeSink(&received, 16, &max_chunk);
+    EXPECT_FALSE(deserializer.Read(&blob));
+  }
+}
@@ -0,0 +1,152 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <vector>
+
+#include <nop/base/skip.h>
+#include <nop/serializer.h>
+#include <nop/structure.h>
+#include <nop/types/columnar.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/pedantic_buffer_reader.h>
+#include <nop/utility/vector_writer.h>
+
+#include "test_utilities.h"
+
+using nop::Binary;
+using nop::Columnar;
+using nop::Deserialize;
+using nop::ErrorStatus;
+using nop::Serialize;
+using nop::SkipValue;
+
+namespace {
+
+struct Point {
+  std::uint64_t timestamp;
+  double value;
+  std::int16_t flags;
+  NOP_STRUCTURE(Point, timestamp, value, flags);
+
+  bool operator==(const Point& other) const {
+    return timestamp == other.timestamp && value == other.value &&
+           flags == other.flags;
+  }
+};
+
+// The structure of arrays that the columnar encoding of Point corresponds to.
+struct PointColumns {
+  std::vector<std::uint64_t> timestamps;
+  Binary<std::vector<double>> values;
+  std::vector<std::int16_t> flags;
+  NOP_STRUCTURE(PointColumns, timestamps, values, flags);
+};
+
+struct Pair {
+  std::uint32_t first;
+  float second;
+  NOP_STRUCTURE(Pair, first, second);
+};
+
+struct Bytes {
+  std::vector<std::uint8_t> first;
+  std::vector<std::uint8_t> second;
+  NOP_STRUCTURE(Bytes, first, second);
+};
+
+std::vector<Point> MakePoints(std::size_t count) {
+  std::vector<Point> points;
+  for (std::size_t i = 0; i < count; i++) {
+    points.push_back({1500000000000 + i * 1000, i * 0.25,
+                      static_cast<std::int16_t>(i % 3 - 1)});
+  }
+  return points;
+}
+
+}  // anonymous namespace
+
+TEST(Columnar, RoundTrip) {
+  for (std::size_t count : {0u, 1u, 255u, 256u, 257u, 1000u}) {
+    const auto points = MakePoints(count);
+    const auto data = Serialize(Columnar<std::vector<Point>>{points});
+
+    Columnar<std::vector<Point>> decoded{MakePoints(3)};
+    ASSERT_TRUE(Deserialize(data, &decoded));
+    EXPECT_EQ(points, decoded.get());
+
+    // The encoding is a structure of BIN columns.
+    PointColumns columns;
+    ASSERT_TRUE(Deserialize(data, &columns));
+    ASSERT_EQ(count, columns.timestamps.size());
+    ASSERT_EQ(count, columns.values->size());
+    ASSERT_EQ(count, columns.flags.size());
+    for (std::size_t i = 0; i < count; i++) {
+      EXPECT_EQ(points[i].timestamp, columns.timestamps[i]);
+      EXPECT_EQ(points[i].value, columns.values.get()[i]);
+      EXPECT_EQ(points[i].flags, columns.flags[i]);
+    }
+    EXPECT_EQ(data, Serialize(columns));
+
+    nop::BufferReader reader{data.data(), data.size()};
+    EXPECT_TRUE(SkipValue(&reader));
+    EXPECT_EQ(0u, reader.remaining());
+  }
+
+  // The columns drop the per-element prefixes of the row encoding. Only
+  // small integers are encoded more compactly by the row encoding.
+  std::vector<Pair> pairs;
+  for (std::uint32_t i = 0; i < 1000; i++)
+    pairs.push_back({0x80000000u + i, i * 1.5f});
+  const auto data = Serialize(Columnar<std::vector<Pair>>{pairs});
+  EXPECT_LT(data.size(), Serialize(pairs).size() * 3 / 4);
+
+  Columnar<std::vector<Pair>> decoded;
+  ASSERT_TRUE(Deserialize(data, &decoded));
+  ASSERT_EQ(pairs.size(), decoded->size());
+  EXPECT_EQ(pairs[999].first, decoded.get()[999].first);
+  EXPECT_EQ(pairs[999].second, decoded.get()[999].second);
+}
+
+TEST(Columnar, Errors) {
+  Columnar<std::vector<Point>> points;
+
+  // Columns that disagree on the number of elements.
+  PointColumns columns;
+  columns.timestamps = {1, 2, 3};
+  columns.values = std::vector<double>{1.0, 2.0, 3.0};
+  columns.flags = {1, 2};
+  EXPECT_EQ(ErrorStatus::InvalidContainerLength,
+            Deserialize(Serialize(columns), &points).error());
+
+  // Columns that are not a whole number of elements.
+  Columnar<std::vector<Pair>> pairs;
+  EXPECT_EQ(ErrorStatus::InvalidContainerLength,
+            Deserialize(Serialize(Bytes{{1, 2, 3}, {4, 5, 6, 7}}), &pairs)
+                .error());
+
+  // Lengths beyond the end of the input.
+  EXPECT_EQ(ErrorStatus::ReadLimitReached,
+            Deserialize(std::vector<std::uint8_t>{0xb9, 0x02, 0xbc, 0x82, 0x00,
+                                                  0x00, 0x00, 0x10},
+                        &pairs)
+                .error());
+
+  EXPECT_EQ(ErrorStatus::InvalidMemberCount,
+            Deserialize(Serialize(Pair{1, 2.0f}), &points).error());
+  EXPECT_EQ(ErrorStatus::UnexpectedEncodingType,
+            Deserialize(Serialize(MakePoints(2)), &points).error());
+}
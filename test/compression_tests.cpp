@@ -0,0 +1,197 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <nop/serializer.h>
+#include <nop/table.h>
+#include <nop/utility/compressing_writer.h>
+#include <nop/utility/compression.h>
+#include <nop/utility/decompressing_reader.h>
+#include <nop/utility/pedantic_buffer_reader.h>
+#include <nop/utility/vector_writer.h>
+
+using nop::CompressingWriter;
+using nop::DecompressingReader;
+using nop::Deserializer;
+using nop::Entry;
+using nop::ErrorStatus;
+using nop::Lz4Codec;
+using nop::PedanticBufferReader;
+using nop::Serializer;
+using nop::VectorWriter;
+
+namespace {
+
+struct Replica {
+  Entry<std::uint64_t, 0> sequence;
+  Entry<std::vector<std::string>, 1> keys;
+  NOP_TABLE(Replica, sequence, keys);
+};
+
+Replica MakeReplica(std::uint64_t sequence, std::size_t count) {
+  Replica replica;
+  replica.sequence = sequence;
+  replica.keys = std::vector<std::string>{};
+  for (std::size_t i = 0; i < count; i++)
+    replica.keys.get().push_back("users/region-" + std::to_string(i % 8) +
+                                 "/account");
+  return replica;
+}
+
+std::vector<std::uint8_t> RoundTrip(const std::vector<std::uint8_t>& data,
+                                    std::size_t* compressed_size) {
+  std::vector<std::uint8_t> compressed(
+      Lz4Codec::MaxCompressedSize(data.size()));
+  *compressed_size =
+      Lz4Codec::Compress(data.data(), data.size(), compressed.data());
+
+  std::vector<std::uint8_t> result(data.size());
+  EXPECT_TRUE(Lz4Codec::Decompress(compressed.data(), *compressed_size,
+                                   result.data(), result.size()));
+  return result;
+}
+
+}  // anonymous namespace
+
+TEST(Lz4Codec, RoundTrip) {
+  std::size_t compressed_size;
+
+  const std::vector<std::uint8_t> empty;
+  EXPECT_EQ(empty, RoundTrip(empty, &compressed_size));
+  EXPECT_EQ(1u, compressed_size);
+
+  const std::vector<std::uint8_t> small{1, 2, 3, 4, 5};
+  EXPECT_EQ(small, RoundTrip(small, &compressed_size));
+
+  std::vector<std::uint8_t> repetitive;
+  for (int i = 0; i < 100000; i++)
+    repetitive.push_back(static_cast<std::uint8_t>("abcabcabd"[i % 9]));
+  EXPECT_EQ(repetitive, RoundTrip(repetitive, &compressed_size));
+  EXPECT_GT(repetitive.size() / 50, compressed_size);
+
+  // Long runs produce overlapping matches and long length encodings.
+  const std::vector<std::uint8_t> run(70000, 7);
+  EXPECT_EQ(run, RoundTrip(run, &compressed_size));
+
+  std::mt19937 engine{42};
+  std::vector<std::uint8_t> random(100000);
+  for (auto& byte : random)
+    byte = static_cast<std::uint8_t>(engine());
+  EXPECT_EQ(random, RoundTrip(random, &compressed_size));
+  EXPECT_GE(Lz4Codec::MaxCompressedSize(random.size()), compressed_size);
+}
+
+TEST(Lz4Codec, Malformed) {
+  std::vector<std::uint8_t> data(1000, 1);
+  std::vector<std::uint8_t> compressed(Lz4Codec::MaxCompressedSize(1000));
+  const std::size_t size =
+      Lz4Codec::Compress(data.data(), data.size(), compressed.data());
+  std::vector<std::uint8_t> output(data.size());
+
+  // Wrong output sizes and truncated input are rejected.
+  EXPECT_FALSE(Lz4Codec::Decompress(compressed.data(), size, output.data(),
+                                    output.size() - 1));
+  EXPECT_FALSE(Lz4Codec::Decompress(compressed.data(), size - 1,
+                                    output.data(), output.size()));
+  EXPECT_FALSE(
+      Lz4Codec::Decompress(compressed.data(), 0, output.data(), output.size()));
+
+  // Offsets beyond the start of the output are rejected.
+  const std::uint8_t bad_offset[] = {0x10, 'a', 0x02, 0x00, 0x00};
+  EXPECT_FALSE(Lz4Codec::Decompress(bad_offset, sizeof(bad_offset),
+                                    output.data(), 5));
+}
+
+TEST(CompressingWriter, Messages) {
+  const std::uint64_t kCount = 20;
+  VectorWriter vector_writer;
+  Serializer<CompressingWriter<VectorWriter>> serializer{&vector_writer};
+
+  std::size_t raw_size = 0;
+  for (std::uint64_t i = 0; i < kCount; i++) {
+    const Replica replica = MakeReplica(i, 200);
+    ASSERT_TRUE(serializer.Write(replica));
+    raw_size += nop::Encoding<Replica>::Size(replica);
+
+    // Each message is flushed as soon as it is complete.
+    EXPECT_EQ(raw_size, serializer.writer().raw_bytes());
+    EXPECT_EQ(vector_writer.size(), serializer.writer().compressed_bytes());
+  }
+  EXPECT_GT(raw_size / 5, vector_writer.size());
+
+  PedanticBufferReader buffer_reader{vector_writer.data(),
+                                     vector_writer.size()};
+  Deserializer<DecompressingReader<PedanticBufferReader>> deserializer{
+      &buffer_reader};
+  for (std::uint64_t i = 0; i < kCount; i++) {
+    Replica replica;
+    ASSERT_TRUE(deserializer.Read(&replica));
+    EXPECT_EQ(i, replica.sequence.get());
+    EXPECT_EQ(MakeReplica(i, 200).keys.get(), replica.keys.get());
+  }
+  EXPECT_TRUE(deserializer.reader().empty());
+  EXPECT_TRUE(buffer_reader.empty());
+
+  Replica replica;
+  EXPECT_EQ(ErrorStatus::ReadLimitReached, deserializer.Read(&replica).error());
+}
+
+TEST(CompressingWriter, LargeMessage) {
+  // Messages larger than the maximum frame size span multiple frames.
+  const Replica large = MakeReplica(1, 100000);
+  ASSERT_LT(nop::kMaxCompressionFrameSize, nop::Encoding<Replica>::Size(large));
+
+  VectorWriter vector_writer;
+  Serializer<CompressingWriter<VectorWriter>> serializer{&vector_writer};
+  ASSERT_TRUE(serializer.Write(large));
+
+  PedanticBufferReader buffer_reader{vector_writer.data(),
+                                     vector_writer.size()};
+  Deserializer<DecompressingReader<PedanticBufferReader>> deserializer{
+      &buffer_reader};
+  Replica replica;
+  ASSERT_TRUE(deserializer.Read(&replica));
+  EXPECT_EQ(large.keys.get(), replica.keys.get());
+}
+
+TEST(DecompressingReader, Corrupt) {
+  VectorWriter vector_writer;
+  Serializer<CompressingWriter<VectorWriter>> serializer{&vector_writer};
+  ASSERT_TRUE(serializer.Write(MakeReplica(1, 200)));
+
+  // Corrupt the claimed raw size of the frame.
+  std::vector<std::uint8_t> data(vector_writer.data(),
+                                 vector_writer.data() + vector_writer.size());
+  data[0] ^= 0x01;
+  PedanticBufferReader buffer_reader{data.data(), data.size()};
+  Deserializer<DecompressingReader<PedanticBufferReader>> deserializer{
+      &buffer_reader};
+  Replica replica;
+  EXPECT_EQ(ErrorStatus::ProtocolError, deserializer.Read(&replica).error());
+
+  // Oversized frames are rejected before allocating.
+  const std::uint8_t oversized[] = {0x00, 0x00, 0x00, 0x10,
+                                    0x00, 0x00, 0x00, 0x10};
+  PedanticBufferReader oversized_reader{oversized, sizeof(oversized)};
+  Deserializer<DecompressingReader<PedanticBufferReader>>
+      oversized_deserializer{&oversized_reader};
+  EXPECT_EQ(ErrorStatus::ProtocolError,
+            oversized_deserializer.Read(&replica).error());
+}
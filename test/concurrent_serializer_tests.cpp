@@ -0,0 +1,162 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <nop/serializer.h>
+#include <nop/structure.h>
+#include <nop/types/delta.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/concurrent_serializer.h>
+
+using nop::BufferReader;
+using nop::ConcurrentSerializer;
+using nop::Delta;
+using nop::Deserializer;
+using nop::ErrorStatus;
+
+namespace {
+
+struct Message {
+  std::uint32_t thread;
+  std::uint32_t sequence;
+  std::string payload;
+  NOP_STRUCTURE(Message, thread, sequence, payload);
+};
+
+struct State {
+  int value;
+  NOP_STRUCTURE(State, value);
+};
+
+// Decodes the messages in the committed part of the buffer.
+std::vector<Message> Decode(const ConcurrentSerializer& serializer) {
+  EXPECT_EQ(serializer.size(), serializer.committed());
+  Deserializer<BufferReader> deserializer{serializer.data(),
+                                          serializer.size()};
+  std::vector<Message> messages;
+  while (deserializer.reader().remaining() > 0) {
+    Message message;
+    auto status = deserializer.Read(&message);
+    EXPECT_TRUE(status) << status.GetErrorMessage();
+    if (!status)
+      break;
+    messages.push_back(message);
+  }
+  return messages;
+}
+
+}  // anonymous namespace
+
+TEST(ConcurrentSerializer, Write) {
+  std::vector<std::uint8_t> buffer(1024);
+  ConcurrentSerializer serializer{buffer.data(), buffer.size()};
+  EXPECT_EQ(0u, serializer.size());
+
+  const Message message{1, 2, "payload"};
+  ASSERT_TRUE(serializer.Write(message));
+  EXPECT_EQ(serializer.GetSize(message), serializer.size());
+  ASSERT_TRUE(serializer.Write(Message{3, 4, "other"}));
+
+  const auto messages = Decode(serializer);
+  ASSERT_EQ(2u, messages.size());
+  EXPECT_EQ("payload", messages[0].payload);
+  EXPECT_EQ(3u, messages[1].thread);
+  EXPECT_FALSE(serializer.failed());
+
+  serializer.Reset();
+  EXPECT_EQ(0u, serializer.size());
+  EXPECT_EQ(0u, serializer.committed());
+}
+
+TEST(ConcurrentSerializer, WriteMany) {
+  std::uint8_t buffer[256];
+  ConcurrentSerializer serializer{buffer};
+  EXPECT_EQ(sizeof(buffer), serializer.capacity());
+
+  const std::vector<Message> batch{{0, 0, "a"}, {0, 1, "b"}, {0, 2, "c"}};
+  ASSERT_TRUE(serializer.WriteMany(batch.begin(), batch.end()));
+  ASSERT_TRUE(serializer.WriteMany(batch.end(), batch.end()));
+
+  const auto messages = Decode(serializer);
+  ASSERT_EQ(3u, messages.size());
+  EXPECT_EQ("c", messages[2].payload);
+}
+
+TEST(ConcurrentSerializer, Full) {
+  std::uint8_t buffer[32];
+  ConcurrentSerializer serializer{buffer};
+
+  ASSERT_TRUE(serializer.Write(Message{0, 0, std::string(16, 'x')}));
+  const std::size_t size = serializer.size();
+
+  // A message that does not fit does not consume space.
+  EXPECT_EQ(ErrorStatus::WriteLimitReached,
+            serializer.Write(Message{0, 1, std::string(16, 'y')}).error());
+  EXPECT_EQ(size, serializer.size());
+  EXPECT_FALSE(serializer.failed());
+
+  ASSERT_TRUE(serializer.Write(Message{0, 2, "z"}));
+  EXPECT_EQ(2u, Decode(serializer).size());
+}
+
+TEST(ConcurrentSerializer, Failed) {
+  std::uint8_t buffer[32];
+  ConcurrentSerializer serializer{buffer};
+
+  // The delta fails to encode after its region is reserved.
+  EXPECT_EQ(ErrorStatus::InvalidReference,
+            serializer.Write(Delta<State>{}).error());
+  EXPECT_TRUE(serializer.failed());
+  EXPECT_EQ(serializer.size(), serializer.committed());
+  EXPECT_NE(0u, serializer.size());
+  for (std::size_t i = 0; i < serializer.size(); i++)
+    EXPECT_EQ(0u, buffer[i]);
+}
+
+TEST(ConcurrentSerializer, Threads) {
+  const std::uint32_t kThreads = 8;
+  const std::uint32_t kMessages = 1000;
+
+  std::vector<std::uint8_t> buffer(kThreads * kMessages * 64);
+  ConcurrentSerializer serializer{buffer.data(), buffer.size()};
+
+  std::vector<std::thread> threads;
+  for (std::uint32_t thread = 0; thread < kThreads; thread++) {
+    threads.emplace_back([&serializer, thread, kMessages] {
+      for (std::uint32_t i = 0; i < kMessages; i++) {
+        const Message message{thread, i, std::string(i % 32, 'a' + thread)};
+        EXPECT_TRUE(serializer.Write(message));
+      }
+    });
+  }
+  for (auto& thread : threads)
+    thread.join();
+
+  // Every message is intact, and the messages of each thread are in order.
+  const auto messages = Decode(serializer);
+  ASSERT_EQ(kThreads * kMessages, messages.size());
+
+  std::vector<std::uint32_t> next(kThreads, 0);
+  for (const auto& message : messages) {
+    ASSERT_LT(message.thread, kThreads);
+    EXPECT_EQ(next[message.thread]++, message.sequence);
+    EXPECT_EQ(std::string(message.sequence % 32, 'a' + message.thread),
+              message.payload);
+  }
+}
@@ -14,22 +14,31 @@
 
 #include <gtest/gtest.h>
 
+#include <array>
 #include <iterator>
 #include <vector>
 
 #include <nop/serializer.h>
 #include <nop/structure.h>
 #include <nop/table.h>
+#include <nop/utility/buffer_writer.h>
+#include <nop/utility/constexpr_buffer_reader.h>
 #include <nop/utility/constexpr_buffer_writer.h>
+#include <nop/utility/encode_constant.h>
 #include <nop/value.h>
 
 #include "test_utilities.h"
 
+using nop::BufferWriter;
+using nop::ConstexprBufferReader;
 using nop::ConstexprBufferWriter;
+using nop::Deserializer;
+using nop::EncodeConstant;
 using nop::Encoding;
 using nop::EncodingByte;
 using nop::Entry;
 using nop::Integer;
+using nop::ErrorStatus;
 using nop::Serializer;
 
 namespace {
@@ -139,6 +148,47 @@ constexpr auto SerializeBasicTableArray() {
 
 constexpr auto kSerializedBasicTableArray = SerializeBasicTableArray();
 
+template <typename T, std::size_t Size>
+constexpr T Deserialize(const Array<std::uint8_t, Size>& bytes) {
+  T value{};
+  Deserializer<ConstexprBufferReader> deserializer{bytes.data(), bytes.size()};
+  auto status = deserializer.Read(&value);
+  return status ? value : throw status;
+}
+
+constexpr BasicStruct kDeserializedBasicStruct =
+    Deserialize<BasicStruct>(kSerializedBasicStruct);
+static_assert(kDeserializedBasicStruct.a == kBasicStruct.a, "");
+static_assert(kDeserializedBasicStruct.b == kBasicStruct.b, "");
+
+constexpr auto kDeserializedBasicStructArray =
+    Deserialize<Array<BasicStruct, 3>>(kSerializedBasicStructArray);
+static_assert(kDeserializedBasicStructArray[2].b == 5, "");
+
+constexpr auto kEncodedBasicTableArray =
+    EncodeConstant<Array<BasicTable, 4>, kBasicTableArray>();
+static_assert(kEncodedBasicTableArray.size() ==
+                  EncodingSize(kBasicTableArray),
+              "");
+static_assert(kEncodedBasicTableArray[0] ==
+                  static_cast<std::uint8_t>(EncodingByte::Array),
+              "");
+
+// Values computed by constexpr functions are encoded with an explicit size.
+constexpr BasicStruct MakeBasicStruct() { return {1, 0x10000}; }
+constexpr auto kEncodedBasicStruct =
+    EncodeConstant<EncodingSize(MakeBasicStruct())>(MakeBasicStruct());
+constexpr auto kPaddedBasicStruct =
+    EncodeConstant<EncodingSize(MakeBasicStruct()) + 2>(MakeBasicStruct());
+
+struct Sample {
+  std::int16_t offset;
+  std::uint64_t timestamp;
+  Array<float, 3> position;
+  Array<std::int32_t, 4> values;
+  NOP_STRUCTURE(Sample, offset, timestamp, position, values);
+};
+
 }  // anonymous namespace
 
 TEST(Constexpr, SerializedData) {
@@ -192,3 +242,58 @@ TEST(Constexpr, SerializedData) {
     EXPECT_EQ(expected, actual);
   }
 }
+
+TEST(Constexpr, EncodeConstant) {
+  std::vector<std::uint8_t> actual{kEncodedBasicTableArray.begin(),
+                                   kEncodedBasicTableArray.end()};
+  std::vector<std::uint8_t> expected{std::begin(kSerializedBasicTableArray),
+                                     std::end(kSerializedBasicTableArray)};
+  EXPECT_EQ(expected, actual);
+
+  expected = Compose(EncodingByte::Structure, 2, 1, EncodingByte::U32,
+                     Integer<std::uint32_t>(0x10000));
+  actual = {kEncodedBasicStruct.begin(), kEncodedBasicStruct.end()};
+  EXPECT_EQ(expected, actual);
+
+  // Bytes beyond the encoding are zero.
+  expected.resize(expected.size() + 2, 0);
+  actual = {kPaddedBasicStruct.begin(), kPaddedBasicStruct.end()};
+  EXPECT_EQ(expected, actual);
+}
+
+TEST(Constexpr, Runtime) {
+  const Sample sample{-300,
+                      0x0102030405060708,
+                      {{1.5f, -2.0f, 3.25f}},
+                      {{-1, 0x7fffffff, 3, -0x70000000}}};
+
+  // The constexpr writer and reader also handle runtime values, including
+  // floating point elements, and agree with the runtime writer.
+  std::vector<std::uint8_t> buffer(Encoding<Sample>::Size(sample));
+  Serializer<ConstexprBufferWriter> serializer{buffer.data(), buffer.size()};
+  ASSERT_TRUE(serializer.Write(sample));
+  EXPECT_EQ(buffer.size(), serializer.writer().size());
+
+  std::vector<std::uint8_t> expected(buffer.size());
+  Serializer<BufferWriter> reference{expected.data(), expected.size()};
+  ASSERT_TRUE(reference.Write(sample));
+  EXPECT_EQ(expected, buffer);
+
+  Deserializer<ConstexprBufferReader> deserializer{buffer.data(),
+                                                   buffer.size()};
+  Sample copy{};
+  ASSERT_TRUE(deserializer.Read(&copy));
+  EXPECT_TRUE(deserializer.reader().empty());
+  EXPECT_EQ(sample.offset, copy.offset);
+  EXPECT_EQ(sample.timestamp, copy.timestamp);
+  EXPECT_EQ(sample.position, copy.position);
+  EXPECT_EQ(sample.values, copy.values);
+
+  // Reads are bounds checked.
+  Deserializer<ConstexprBufferReader> truncated{buffer.data(),
+                                                buffer.size() - 1};
+  EXPECT_EQ(ErrorStatus::ReadLimitReached, truncated.Read(&copy).error());
+
+  Serializer<ConstexprBufferWriter> overflow{buffer.data(), buffer.size() - 1};
+  EXPECT_EQ(ErrorStatus::WriteLimitReached, overflow.Write(sample).error());
+}
@@ -0,0 +1,285 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// These tests require C++20 and are built into a separate test executable.
+
+#include <gtest/gtest.h>
+
+#include <coroutine>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <nop/rpc/coroutine_method_receiver.h>
+#include <nop/rpc/coroutine_method_sender.h>
+#include <nop/rpc/interface.h>
+#include <nop/serializer.h>
+#include <nop/utility/coroutine.h>
+
+using nop::AsyncReader;
+using nop::AsyncWriter;
+using nop::BindInterface;
+using nop::CoroutineMethodReceiver;
+using nop::CoroutineMethodSender;
+using nop::ErrorStatus;
+using nop::Interface;
+using nop::Status;
+using nop::Task;
+
+namespace {
+
+// Single-threaded run queue of suspended coroutines that are ready to resume.
+class Scheduler {
+ public:
+  void Schedule(std::coroutine_handle<> handle) { ready_.push_back(handle); }
+
+  void Run() {
+    while (!ready_.empty()) {
+      auto handle = ready_.front();
+      ready_.pop_front();
+      handle.resume();
+    }
+  }
+
+ private:
+  std::deque<std::coroutine_handle<>> ready_;
+};
+
+// In-memory unidirectional byte pipe. Reads suspend until enough data is
+// written or the pipe is closed.
+class Pipe {
+ public:
+  explicit Pipe(Scheduler* scheduler) : scheduler_{scheduler} {}
+
+  auto Read(std::uint8_t* data, std::size_t size) {
+    struct Awaiter {
+      Pipe* pipe;
+      std::uint8_t* data;
+      std::size_t size;
+
+      bool await_ready() const { return pipe->Ready(size); }
+      void await_suspend(std::coroutine_handle<> handle) {
+        pipe->reader_ = handle;
+        pipe->wanted_ = size;
+      }
+      Status<void> await_resume() {
+        if (pipe->buffer_.size() < size)
+          return ErrorStatus::IOError;
+
+        for (std::size_t i = 0; i < size; i++) {
+          data[i] = pipe->buffer_.front();
+          pipe->buffer_.pop_front();
+        }
+        return {};
+      }
+    };
+    reads_++;
+    return Awaiter{this, data, size};
+  }
+
+  // Writes never block.
+  auto Write(const std::uint8_t* data, std::size_t size) {
+    struct Awaiter {
+      Status<void> status;
+
+      bool await_ready() const { return true; }
+      void await_suspend(std::coroutine_handle<>) {}
+      Status<void> await_resume() { return status; }
+    };
+
+    writes_++;
+    if (closed_)
+      return Awaiter{ErrorStatus::IOError};
+
+    buffer_.insert(buffer_.end(), data, data + size);
+    Wake();
+    return Awaiter{{}};
+  }
+
+  void Close() {
+    closed_ = true;
+    Wake();
+  }
+
+  std::size_t reads() const { return reads_; }
+  std::size_t writes() const { return writes_; }
+
+ private:
+  bool Ready(std::size_t size) const {
+    return closed_ || buffer_.size() >= size;
+  }
+
+  void Wake() {
+    if (reader_ && Ready(wanted_))
+      scheduler_->Schedule(std::exchange(reader_, nullptr));
+  }
+
+  Scheduler* scheduler_;
+  std::deque<std::uint8_t> buffer_;
+  std::coroutine_handle<> reader_;
+  std::size_t wanted_{0};
+  bool closed_{false};
+  std::size_t reads_{0};
+  std::size_t writes_{0};
+};
+
+static_assert(AsyncReader<Pipe>);
+static_assert(AsyncWriter<Pipe>);
+static_assert(!AsyncReader<int>);
+
+struct Calculator : Interface<Calculator> {
+  NOP_INTERFACE("io.github.eieio.test.CoroutineCalculator");
+  NOP_METHOD(Sum, int(int a, int b));
+  NOP_METHOD(Join, std::string(const std::vector<std::string>& parts));
+  NOP_METHOD(Unbound, int());
+  NOP_INTERFACE_API(Sum, Join, Unbound);
+};
+
+auto BindCalculator() {
+  return BindInterface(
+      Calculator::Sum::Bind([](int a, int b) { return a + b; }),
+      Calculator::Join::Bind([](const std::vector<std::string>& parts) {
+        std::string result;
+        for (const auto& part : parts)
+          result += part;
+        return result;
+      }));
+}
+
+// A connection between a client and a server over a pair of pipes.
+struct Session {
+  explicit Session(Scheduler* scheduler)
+      : requests{scheduler},
+        replies{scheduler},
+        sender{&requests, &replies},
+        receiver{&replies, &requests} {}
+
+  Pipe requests;
+  Pipe replies;
+  CoroutineMethodSender<Pipe, Pipe> sender;
+  CoroutineMethodReceiver<Pipe, Pipe> receiver;
+};
+
+Task<Status<int>> Client(CoroutineMethodSender<Pipe, Pipe>* sender, int id) {
+  int total = 0;
+  for (int i = 0; i < 3; i++) {
+    Status<int> sum = co_await Calculator::Sum::InvokeAsync(sender, id, i);
+    if (!sum)
+      co_return sum;
+    total += sum.get();
+  }
+
+  std::vector<std::string> parts{"a", "b", std::to_string(id)};
+  Status<std::string> joined =
+      co_await Calculator::Join::InvokeAsync(sender, parts);
+  if (!joined)
+    co_return joined.error();
+  else if (joined.get() != "ab" + std::to_string(id))
+    co_return ErrorStatus::ProtocolError;
+
+  co_return total;
+}
+
+// Serves calls until an error occurs and then closes the reply pipe.
+template <typename Dispatcher>
+Task<Status<void>> ServeAndClose(Session* session,
+                                 const Dispatcher* dispatcher) {
+  Status<void> status = co_await session->receiver.Serve(*dispatcher);
+  session->replies.Close();
+  co_return status;
+}
+
+}  // anonymous namespace
+
+TEST(Coroutine, Task) {
+  auto add = [](int a, int b) -> Task<int> { co_return a + b; };
+  auto chain = [&add]() -> Task<int> {
+    int sum = 0;
+    for (int i = 0; i < 1000; i++)
+      sum = co_await add(sum, 1);
+    co_return sum;
+  };
+
+  // Tasks are lazy, and complete when started if they do not suspend.
+  Task<int> task = chain();
+  EXPECT_FALSE(task.done());
+  task.Start();
+  ASSERT_TRUE(task.done());
+  EXPECT_EQ(1000, task.result());
+}
+
+TEST(CoroutineMethodSender, Sessions) {
+  const int kSessions = 100;
+  Scheduler scheduler;
+  auto dispatcher = BindCalculator();
+
+  // Many sessions are served concurrently on a single thread, each suspending
+  // while it waits for the other side.
+  std::vector<std::unique_ptr<Session>> sessions;
+  std::vector<Task<Status<void>>> servers;
+  std::vector<Task<Status<int>>> clients;
+  for (int i = 0; i < kSessions; i++) {
+    sessions.push_back(std::make_unique<Session>(&scheduler));
+    servers.push_back(sessions.back()->receiver.Serve(dispatcher));
+    clients.push_back(Client(&sessions.back()->sender, i));
+  }
+  for (int i = 0; i < kSessions; i++) {
+    servers[i].Start();
+    clients[i].Start();
+    EXPECT_FALSE(clients[i].done());
+  }
+  scheduler.Run();
+
+  for (int i = 0; i < kSessions; i++) {
+    ASSERT_TRUE(clients[i].done());
+    ASSERT_TRUE(clients[i].result()) << i;
+    EXPECT_EQ(3 * i + 3, clients[i].result().get());
+
+    // Each call and reply is a single write of a frame.
+    EXPECT_EQ(4u, sessions[i]->requests.writes());
+    EXPECT_EQ(4u, sessions[i]->replies.writes());
+    EXPECT_FALSE(servers[i].done());
+  }
+
+  // Closing the request pipe stops the server.
+  for (int i = 0; i < kSessions; i++)
+    sessions[i]->requests.Close();
+  scheduler.Run();
+  for (int i = 0; i < kSessions; i++) {
+    ASSERT_TRUE(servers[i].done());
+    EXPECT_EQ(ErrorStatus::IOError, servers[i].result().error());
+  }
+}
+
+TEST(CoroutineMethodSender, Errors) {
+  Scheduler scheduler;
+  Session session{&scheduler};
+  auto dispatcher = BindCalculator();
+
+  // Calls to methods that are not bound stop the server, which closes the
+  // connection.
+  auto server = ServeAndClose(&session, &dispatcher);
+  auto call = Calculator::Unbound::InvokeAsync(&session.sender);
+
+  server.Start();
+  call.Start();
+  scheduler.Run();
+
+  ASSERT_TRUE(server.done());
+  EXPECT_EQ(ErrorStatus::InvalidInterfaceMethod, server.result().error());
+  ASSERT_TRUE(call.done());
+  EXPECT_EQ(ErrorStatus::IOError, call.result().error());
+}
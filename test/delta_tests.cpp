@@ -0,0 +1,221 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include <gtest/gtest.h>
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <nop/serializer.h>
+#include <nop/structure.h>
+#include <nop/table.h>
+#include <nop/types/delta.h>
+#include <nop/utility/pedantic_buffer_reader.h>
+#include <nop/utility/vector_writer.h>
+
+#include "test_utilities.h"
+
+using nop::DeletedEntry;
+using nop::Delta;
+using nop::Deserializer;
+using nop::Entry;
+using nop::ErrorStatus;
+using nop::PedanticBufferReader;
+using nop::Serialize;
+using nop::Serializer;
+using nop::Status;
+using nop::VectorWriter;
+
+namespace {
+
+struct Position {
+  float x;
+  float y;
+
+  bool operator==(const Position& other) const {
+    return x == other.x && y == other.y;
+  }
+  NOP_STRUCTURE(Position, x, y);
+};
+
+struct State {
+  std::uint32_t id;
+  std::string name;
+  Position position;
+  std::vector<int> inventory;
+  std::array<char, 8> tag;
+  std::size_t tag_size;
+  NOP_STRUCTURE(State, id, name, position, inventory, (tag, tag_size));
+};
+
+struct Settings {
+  Entry<std::string, 0> owner;
+  Entry<std::uint32_t, 1> level;
+  Entry<std::vector<int>, 2> limits;
+  NOP_TABLE_NS("Settings", Settings, owner, level, limits);
+};
+
+// Newer version of Settings that deletes an entry and adds another.
+struct SettingsV2 {
+  Entry<std::string, 0> owner;
+  Entry<std::uint32_t, 1, DeletedEntry> level;
+  Entry<std::vector<int>, 2> limits;
+  Entry<std::string, 3> comment;
+  NOP_TABLE_NS("Settings", SettingsV2, owner, level, limits, comment);
+};
+
+State MakeState() {
+  return {7, "player", {1.0f, 2.0f}, {1, 2, 3}, {{'a', 'b', 'c'}}, 3};
+}
+
+template <typename T>
+Status<void> Apply(const std::vector<std::uint8_t>& data, T* target) {
+  PedanticBufferReader reader{data.data(), data.size()};
+  Delta<T> delta{target};
+  auto status = Deserializer<PedanticBufferReader*>{&reader}.Read(&delta);
+  if (status && !reader.empty())
+    return ErrorStatus::ProtocolError;
+  return status;
+}
+
+}  // anonymous namespace
+
+TEST(Delta, Unchanged) {
+  const State state = MakeState();
+  const auto data = Serialize(Delta<State>{state, state});
+
+  // MAP and a count of zero changes.
+  EXPECT_EQ((std::vector<std::uint8_t>{0xbb, 0x00}), data);
+
+  State target = MakeState();
+  ASSERT_TRUE(Apply(data, &target));
+  EXPECT_EQ(Serialize(state), Serialize(target));
+}
+
+TEST(Delta, Structure) {
+  const State baseline = MakeState();
+  State value = baseline;
+  value.name = "renamed";
+  value.position.y = 5.0f;
+
+  const auto data = Serialize(Delta<State>{baseline, value});
+  EXPECT_LT(data.size(), Serialize(value).size());
+
+  // Only the changed members are encoded, in member order.
+  EXPECT_EQ(0xbb, data[0]);
+  EXPECT_EQ(2, data[1]);
+  EXPECT_EQ(1, data[2]);
+
+  State target = baseline;
+  ASSERT_TRUE(Apply(data, &target));
+  EXPECT_EQ(Serialize(value), Serialize(target));
+}
+
+TEST(Delta, LogicalBuffer) {
+  const State baseline = MakeState();
+  State value = baseline;
+
+  // Bytes beyond the size in use are not part of the value.
+  value.tag[5] = 'z';
+  EXPECT_EQ((std::vector<std::uint8_t>{0xbb, 0x00}),
+            Serialize(Delta<State>{baseline, value}));
+
+  value.tag[1] = 'x';
+  const auto data = Serialize(Delta<State>{baseline, value});
+  EXPECT_EQ(1, data[1]);
+  EXPECT_EQ(4, data[2]);
+
+  State target = baseline;
+  ASSERT_TRUE(Apply(data, &target));
+  EXPECT_EQ('x', target.tag[1]);
+  EXPECT_EQ(3u, target.tag_size);
+
+  value.tag_size = 2;
+  target = baseline;
+  ASSERT_TRUE(Apply(Serialize(Delta<State>{baseline, value}), &target));
+  EXPECT_EQ(2u, target.tag_size);
+}
+
+TEST(Delta, Table) {
+  Settings baseline;
+  baseline.owner = "root";
+  baseline.level = 3;
+
+  Settings value = baseline;
+  value.level.clear();
+  value.limits = std::vector<int>{10, 20};
+
+  const auto data = Serialize(Delta<Settings>{baseline, value});
+  EXPECT_EQ(2, data[1]);
+  EXPECT_EQ(1, data[2]);
+
+  Settings target = baseline;
+  ASSERT_TRUE(Apply(data, &target));
+  EXPECT_EQ(Serialize(value), Serialize(target));
+  EXPECT_FALSE(target.level);
+  EXPECT_EQ("root", target.owner.get());
+
+  // Setting an entry back to the baseline value is also a change.
+  const auto revert = Serialize(Delta<Settings>{value, baseline});
+  ASSERT_TRUE(Apply(revert, &target));
+  EXPECT_EQ(Serialize(baseline), Serialize(target));
+}
+
+TEST(Delta, TableVersions) {
+  SettingsV2 baseline;
+  SettingsV2 value;
+  value.owner = "admin";
+  value.comment = "new";
+
+  // Older code skips entries it does not know.
+  Settings target;
+  target.level = 9;
+  ASSERT_TRUE(Apply(Serialize(Delta<SettingsV2>{baseline, value}), &target));
+  EXPECT_EQ("admin", target.owner.get());
+  EXPECT_EQ(9u, target.level.get());
+
+  // Newer code skips entries that were deleted.
+  Settings old_baseline;
+  Settings old_value;
+  old_value.level = 4;
+  old_value.limits = std::vector<int>{1};
+
+  SettingsV2 new_target;
+  ASSERT_TRUE(Apply(Serialize(Delta<Settings>{old_baseline, old_value}),
+                    &new_target));
+  EXPECT_EQ(std::vector<int>{1}, new_target.limits.get());
+}
+
+TEST(Delta, Errors) {
+  // Index beyond the member list of State.
+  const std::vector<std::uint8_t> data{0xbb, 0x01, 0x06, 0x00};
+  State target = MakeState();
+  EXPECT_EQ(ErrorStatus::InvalidMemberCount, Apply(data, &target).error());
+
+  // Truncated change.
+  const std::vector<std::uint8_t> truncated{0xbb, 0x01, 0x00};
+  EXPECT_EQ(ErrorStatus::ReadLimitReached,
+            Apply(truncated, &target).error());
+
+  // Deltas without a baseline or target.
+  Serializer<VectorWriter> serializer;
+  EXPECT_EQ(ErrorStatus::InvalidReference,
+            serializer.Write(Delta<State>{}).error());
+
+  PedanticBufferReader reader{data.data(), data.size()};
+  Delta<State> delta;
+  EXPECT_EQ(ErrorStatus::InvalidReference,
+            Deserializer<PedanticBufferReader*>{&reader}.Read(&delta).error());
+}
@@ -14,11 +14,106 @@
 
 #include <gtest/gtest.h>
 
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
 #include <nop/base/encoding.h>
+#include <nop/base/enum.h>
+#include <nop/utility/buffer_writer.h>
 
+using nop::BaseEncodingSize;
+using nop::BufferWriter;
 using nop::Encoding;
 using nop::EncodingByte;
 
+namespace {
+
+// Reference prefix selection by comparison against each range in turn.
+EncodingByte ReferencePrefix(std::uint64_t value) {
+  if (value < (1ULL << 7))
+    return static_cast<EncodingByte>(value);
+  else if (value < (1ULL << 8))
+    return EncodingByte::U8;
+  else if (value < (1ULL << 16))
+    return EncodingByte::U16;
+  else if (value < (1ULL << 32))
+    return EncodingByte::U32;
+  else
+    return EncodingByte::U64;
+}
+
+EncodingByte ReferencePrefix(std::int64_t value) {
+  if (value >= -64 && value <= 127)
+    return static_cast<EncodingByte>(value);
+  else if (value >= -128 && value <= 127)
+    return EncodingByte::I8;
+  else if (value >= -32768 && value <= 32767)
+    return EncodingByte::I16;
+  else if (value >= -2147483648LL && value <= 2147483647LL)
+    return EncodingByte::I32;
+  else
+    return EncodingByte::I64;
+}
+
+// Returns the values around every power of two and the fixint bounds.
+std::vector<std::uint64_t> BoundaryValues() {
+  std::vector<std::uint64_t> values{0, 1, 63, 64, 65, 127, 128, 192};
+  for (int shift = 1; shift < 64; shift++) {
+    const std::uint64_t power = 1ULL << shift;
+    for (std::uint64_t value : {power - 1, power, power + 1})
+      values.push_back(value);
+  }
+  values.push_back(std::numeric_limits<std::uint64_t>::max());
+  return values;
+}
+
+// Returns the reference encoding of |value|: the prefix followed by the low
+// bytes of the value in little-endian order.
+template <typename Wide>
+std::vector<std::uint8_t> ReferenceEncoding(Wide value) {
+  const EncodingByte prefix = ReferencePrefix(value);
+  const std::size_t payload_size = BaseEncodingSize(prefix) - 1;
+  const std::uint64_t bits = static_cast<std::uint64_t>(value);
+
+  std::vector<std::uint8_t> bytes{static_cast<std::uint8_t>(prefix)};
+  for (std::size_t i = 0; i < payload_size; i++)
+    bytes.push_back(static_cast<std::uint8_t>(bits >> (i * 8)));
+  return bytes;
+}
+
+// Checks that the values of T for every boundary value that fits in Integer,
+// the integer type that T is encoded as, are written in the reference encoding
+// and that the sizes match.
+template <typename T, typename Integer = T>
+void ExpectReferenceEncodings() {
+  using Wide = std::conditional_t<std::is_signed<Integer>::value, std::int64_t,
+                                  std::uint64_t>;
+  for (std::uint64_t bits : BoundaryValues()) {
+    for (Wide wide : {static_cast<Wide>(bits), static_cast<Wide>(0 - bits)}) {
+      const Integer integer = static_cast<Integer>(wide);
+      if (static_cast<Wide>(integer) != wide)
+        continue;
+      const T value = static_cast<T>(integer);
+
+      std::uint8_t buffer[16];
+      BufferWriter writer{buffer, sizeof(buffer)};
+      ASSERT_TRUE(Encoding<T>::Write(value, &writer));
+
+      const std::vector<std::uint8_t> expected = ReferenceEncoding(wide);
+      EXPECT_EQ(expected,
+                std::vector<std::uint8_t>(buffer, buffer + writer.size()))
+          << wide;
+      EXPECT_EQ(expected.size(), Encoding<T>::Size(value)) << wide;
+    }
+  }
+}
+
+enum class Signed : std::int16_t {};
+
+}  // anonymous namespace
+
 TEST(Encoding, bool) {
   EXPECT_EQ(EncodingByte::False, Encoding<bool>::Prefix(false));
   EXPECT_EQ(EncodingByte::True, Encoding<bool>::Prefix(true));
@@ -52,3 +147,21 @@ TEST(Encoding, uint8_t) {
   EXPECT_FALSE(Encoding<std::uint8_t>::Match(EncodingByte::U16));
   // TODO(eieio): Test all other values of EncodingByte?
 }
+
+TEST(Encoding, IntegerPrefixes) {
+  static_assert(Encoding<std::uint32_t>::Prefix(300) == EncodingByte::U16, "");
+  static_assert(Encoding<std::int64_t>::Prefix(-65) == EncodingByte::I8, "");
+  static_assert(Encoding<std::int16_t>::Size(-129) == 3, "");
+
+  ExpectReferenceEncodings<char, std::uint8_t>();
+  ExpectReferenceEncodings<std::uint8_t>();
+  ExpectReferenceEncodings<std::uint16_t>();
+  ExpectReferenceEncodings<std::uint32_t>();
+  ExpectReferenceEncodings<std::uint64_t>();
+  ExpectReferenceEncodings<std::int8_t>();
+  ExpectReferenceEncodings<std::int16_t>();
+  ExpectReferenceEncodings<std::int32_t>();
+  ExpectReferenceEncodings<std::int64_t>();
+  ExpectReferenceEncodings<std::size_t>();
+  ExpectReferenceEncodings<Signed, std::int16_t>();
+}
@@ -16,11 +16,18 @@
 
 #include <algorithm>
 #include <cstdint>
+#include <cstring>
 #include <type_traits>
+#include <vector>
 
+#include <nop/base/encoding.h>
 #include <nop/utility/endian.h>
 
 using nop::HostEndian;
+using nop::ReadElements;
+using nop::Status;
+using nop::WriteElements;
+using nop::kLittleEndianHost;
 
 namespace {
 
@@ -166,3 +173,81 @@ TEST(EndianTests, Big) {
               HostEndian<std::int64_t>::ToBig(0x7766554433221100LL));
   }
 }
+
+TEST(EndianTests, Bulk) {
+  std::vector<std::uint32_t> values;
+  for (std::uint32_t i = 0; i < 100; i++)
+    values.push_back(0x01020304u * i);
+
+  std::vector<std::uint32_t> big(values.size());
+  HostEndian<std::uint32_t>::ToBig(values.data(), values.size(), big.data());
+  for (std::size_t i = 0; i < values.size(); i++)
+    EXPECT_EQ(HostEndian<std::uint32_t>::ToBig(values[i]), big[i]) << i;
+
+  // Conversions may operate in place.
+  HostEndian<std::uint32_t>::FromBig(big.data(), big.size(), big.data());
+  EXPECT_EQ(values, big);
+
+  std::vector<std::int16_t> little = {1, -2, 0x1234, -0x1234};
+  std::vector<std::int16_t> host(little.size());
+  HostEndian<std::int16_t>::FromLittle(little.data(), little.size(),
+                                       host.data());
+  for (std::size_t i = 0; i < little.size(); i++)
+    EXPECT_EQ(HostEndian<std::int16_t>::FromLittle(little[i]), host[i]) << i;
+}
+
+// Counts the element ranges passed to Read() and Write().
+struct CountingIO {
+  template <typename T>
+  Status<void> Write(const T* /*begin*/, const T* /*end*/) {
+    calls++;
+    return {};
+  }
+
+  template <typename T>
+  Status<void> Read(T* /*begin*/, T* /*end*/) {
+    calls++;
+    return {};
+  }
+
+  int calls = 0;
+};
+
+TEST(EndianTests, EmptyElements) {
+  CountingIO io;
+  const std::vector<std::uint32_t> empty;
+  std::vector<std::uint32_t> values;
+
+  // Empty ranges, such as those of empty vectors, never reach the reader or
+  // writer, which would otherwise pass null pointers to memcpy.
+  EXPECT_TRUE(WriteElements(empty.data(), empty.data(), &io));
+  EXPECT_TRUE(ReadElements(values.data(), values.data(), &io));
+  EXPECT_EQ(0, io.calls);
+
+  std::uint32_t value = 0;
+  EXPECT_TRUE(WriteElements(&value, &value + 1, &io));
+  EXPECT_TRUE(ReadElements(&value, &value + 1, &io));
+  EXPECT_EQ(2, io.calls);
+}
+
+TEST(EndianTests, Float) {
+  const double value = 1.0;
+  std::uint8_t host_bytes[sizeof(value)];
+  std::memcpy(host_bytes, &value, sizeof(value));
+
+  const double big = HostEndian<double>::ToBig(value);
+  std::uint8_t big_bytes[sizeof(big)];
+  std::memcpy(big_bytes, &big, sizeof(big));
+  std::reverse(std::begin(big_bytes), std::end(big_bytes));
+  EXPECT_EQ(kLittleEndianHost,
+            std::equal(std::begin(host_bytes), std::end(host_bytes),
+                       std::begin(big_bytes)));
+
+  const double little = HostEndian<double>::ToLittle(value);
+  EXPECT_EQ(kLittleEndianHost,
+            std::memcmp(&little, &value, sizeof(value)) == 0);
+
+  EXPECT_EQ(value, HostEndian<double>::FromBig(big));
+  EXPECT_EQ(value, HostEndian<double>::FromLittle(little));
+  EXPECT_EQ(2.5f, HostEndian<float>::FromBig(HostEndian<float>::ToBig(2.5f)));
+}
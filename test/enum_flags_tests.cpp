@@ -14,9 +14,22 @@
 
 #include <gtest/gtest.h>
 
+#include <cstdint>
+#include <vector>
+
+#include <nop/serializer.h>
+#include <nop/types/binary.h>
 #include <nop/types/enum_flags.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/vector_writer.h>
 
+using nop::Binary;
+using nop::BufferReader;
+using nop::Deserializer;
+using nop::EncodingByte;
 using nop::IsEnumFlags;
+using nop::Serializer;
+using nop::VectorWriter;
 
 namespace {
 
@@ -30,6 +43,14 @@ enum class Flags {
 };
 NOP_ENUM_FLAGS(Flags);
 
+enum class ByteFlags : std::uint8_t {
+  None = 0b00,
+  A = 0b01,
+  B = 0b10,
+  C = 0b11,
+};
+NOP_ENUM_FLAGS(ByteFlags);
+
 struct UserType {
   enum class Flags {
     Foo = 0b001,
@@ -72,3 +93,22 @@ TEST(EnumFlags, Operators) {
   EXPECT_FALSE(!!Flags::None);
   EXPECT_TRUE(!!Flags::A);
 }
+
+TEST(EnumFlags, Binary) {
+  const std::vector<ByteFlags> flags{ByteFlags::A, ByteFlags::C,
+                                     ByteFlags::None, ByteFlags::B};
+
+  Serializer<VectorWriter> serializer;
+  ASSERT_TRUE(serializer.Write(Binary<std::vector<ByteFlags>>{flags}));
+  const std::vector<std::uint8_t> expected{
+      static_cast<std::uint8_t>(EncodingByte::Binary), 4, 0b01, 0b11, 0b00,
+      0b10};
+  const VectorWriter& writer = serializer.writer();
+  EXPECT_EQ(expected, std::vector<std::uint8_t>(writer.data(),
+                                                writer.data() + writer.size()));
+
+  std::vector<ByteFlags> decoded;
+  Deserializer<BufferReader> deserializer{writer.data(), writer.size()};
+  ASSERT_TRUE(deserializer.Read(&decoded));
+  EXPECT_EQ(flags, decoded);
+}
@@ -0,0 +1,116 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <vector>
+
+#include <nop/serializer.h>
+#include <nop/utility/any_writer.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/vector_writer.h>
+
+#include "extern_encoding_types.h"
+
+using extern_encoding::Config;
+using nop::AnyWriter;
+using nop::BufferReader;
+using nop::Deserializer;
+using nop::ErrorStatus;
+using nop::ExternReadEncoding;
+using nop::ExternWriteEncoding;
+using nop::Serializer;
+using nop::Status;
+using nop::VectorWriter;
+
+namespace {
+
+// Writer that fails every operation after writing |limit| bytes.
+struct LimitedWriter {
+  std::size_t limit;
+  std::vector<std::uint8_t> data;
+
+  Status<void> Prepare(std::size_t /*size*/) { return {}; }
+
+  Status<void> Write(std::uint8_t byte) { return Write(&byte, &byte + 1); }
+
+  Status<void> Write(const std::uint8_t* begin, const std::uint8_t* end) {
+    if (data.size() + (end - begin) > limit)
+      return ErrorStatus::WriteLimitReached;
+    data.insert(data.end(), begin, end);
+    return {};
+  }
+
+  Status<void> Skip(std::size_t padding_bytes, std::uint8_t padding_value) {
+    if (data.size() + padding_bytes > limit)
+      return ErrorStatus::WriteLimitReached;
+    data.insert(data.end(), padding_bytes, padding_value);
+    return {};
+  }
+};
+
+}  // anonymous namespace
+
+TEST(ExternEncoding, Traits) {
+  EXPECT_TRUE((ExternWriteEncoding<Config, AnyWriter>::value));
+  EXPECT_TRUE((ExternReadEncoding<Config, BufferReader>::value));
+  EXPECT_FALSE((ExternWriteEncoding<Config, VectorWriter>::value));
+  EXPECT_FALSE((ExternReadEncoding<Config, AnyWriter>::value));
+}
+
+TEST(ExternEncoding, RoundTrip) {
+  const Config config{"limits", {1, 2, 300000}, true};
+
+  // Encodings with the declared writer and reader are compiled in
+  // extern_encoding_instantiation.cpp; any other writer is compiled here.
+  VectorWriter vector_writer;
+  AnyWriter writer{&vector_writer};
+  ASSERT_TRUE(Serializer<AnyWriter*>{&writer}.Write(config));
+
+  VectorWriter expected;
+  ASSERT_TRUE(Serializer<VectorWriter*>{&expected}.Write(config));
+  EXPECT_EQ(std::vector<std::uint8_t>(expected.data(),
+                                      expected.data() + expected.size()),
+            std::vector<std::uint8_t>(vector_writer.data(),
+                                      vector_writer.data() +
+                                          vector_writer.size()));
+
+  Config decoded;
+  Deserializer<BufferReader> deserializer{vector_writer.data(),
+                                          vector_writer.size()};
+  ASSERT_TRUE(deserializer.Read(&decoded));
+  EXPECT_EQ(config.name, decoded.name);
+  EXPECT_EQ(config.limits, decoded.limits);
+  EXPECT_EQ(config.enabled, decoded.enabled);
+}
+
+TEST(AnyWriter, Forwarding) {
+  LimitedWriter limited{11, {}};
+  AnyWriter writer{&limited};
+  EXPECT_TRUE(writer);
+  EXPECT_FALSE(AnyWriter{});
+
+  const std::uint16_t values[] = {0x0201, 0x0403};
+  EXPECT_TRUE(writer.Prepare(16));
+  EXPECT_TRUE(writer.Write(0x10));
+  EXPECT_TRUE(writer.Write(values, values + 2));
+  EXPECT_TRUE(writer.Skip(2, 0xff));
+  EXPECT_EQ((std::vector<std::uint8_t>{0x10, 1, 2, 3, 4, 0xff, 0xff}),
+            limited.data);
+
+  EXPECT_EQ(ErrorStatus::WriteLimitReached, writer.Skip(5).error());
+  EXPECT_TRUE(writer.Skip(4));
+  EXPECT_EQ(ErrorStatus::WriteLimitReached, writer.Write(0x10).error());
+}
@@ -0,0 +1,41 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef LIBNOP_TEST_EXTERN_ENCODING_TYPES_H_
+#define LIBNOP_TEST_EXTERN_ENCODING_TYPES_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <nop/extern_encoding.h>
+#include <nop/structure.h>
+#include <nop/utility/any_writer.h>
+#include <nop/utility/buffer_reader.h>
+
+namespace extern_encoding {
+
+// Encoded by the instantiation in extern_encoding_instantiation.cpp.
+struct Config {
+  std::string name;
+  std::vector<std::uint32_t> limits;
+  bool enabled;
+  NOP_STRUCTURE(Config, name, limits, enabled);
+};
+
+}  // namespace extern_encoding
+
+NOP_DECLARE_ENCODING(extern_encoding::Config, AnyWriter, BufferReader);
+
+#endif  // LIBNOP_TEST_EXTERN_ENCODING_TYPES_H_
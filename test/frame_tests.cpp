@@ -0,0 +1,164 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <nop/serializer.h>
+#include <nop/structure.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/counting_reader.h>
+#include <nop/utility/frame_reader.h>
+#include <nop/utility/frame_writer.h>
+#include <nop/utility/pedantic_buffer_reader.h>
+#include <nop/utility/vector_writer.h>
+
+using nop::BufferReader;
+using nop::CountingReader;
+using nop::Deserializer;
+using nop::ErrorStatus;
+using nop::FrameReader;
+using nop::FrameWriter;
+using nop::PedanticBufferReader;
+using nop::VectorWriter;
+
+namespace {
+
+struct Request {
+  std::uint32_t id;
+  std::string method;
+  std::vector<std::uint32_t> arguments;
+  NOP_STRUCTURE(Request, id, method, arguments);
+};
+
+Request MakeRequest(std::uint32_t id) {
+  return {id, "method" + std::to_string(id),
+          std::vector<std::uint32_t>(id * 3, id)};
+}
+
+}  // anonymous namespace
+
+TEST(FrameWriter, RoundTrip) {
+  const std::uint32_t kCount = 8;
+  VectorWriter vector_writer;
+  FrameWriter<VectorWriter> frame_writer{&vector_writer};
+
+  std::size_t expected_size = 0;
+  for (std::uint32_t i = 0; i < kCount; i++) {
+    const Request request = MakeRequest(i);
+    ASSERT_TRUE(frame_writer.Write(request));
+
+    // The header is backfilled with the length of the message.
+    const std::size_t length = nop::Encoding<Request>::Size(request);
+    std::uint32_t header;
+    std::memcpy(&header, vector_writer.data() + expected_size,
+                sizeof(header));
+    EXPECT_EQ(length, header);
+    expected_size += nop::kFrameHeaderSize + length;
+    EXPECT_EQ(expected_size, vector_writer.size());
+    EXPECT_EQ(nop::kFrameHeaderSize + length, frame_writer.size());
+  }
+
+  // Each frame is pulled in with one read of the header and one of the
+  // payload.
+  PedanticBufferReader buffer_reader{vector_writer.data(),
+                                     vector_writer.size()};
+  CountingReader<PedanticBufferReader> counting_reader{&buffer_reader};
+  FrameReader<CountingReader<PedanticBufferReader>> frame_reader{
+      &counting_reader};
+  for (std::uint32_t i = 0; i < kCount; i++) {
+    Request request;
+    ASSERT_TRUE(frame_reader.Read(&request));
+    EXPECT_EQ(i, request.id);
+    EXPECT_EQ(MakeRequest(i).method, request.method);
+    EXPECT_EQ(MakeRequest(i).arguments, request.arguments);
+  }
+  EXPECT_EQ(2 * kCount, counting_reader.stats().transfer_calls);
+  EXPECT_TRUE(buffer_reader.empty());
+
+  Request request;
+  EXPECT_EQ(ErrorStatus::ReadLimitReached, frame_reader.Read(&request).error());
+}
+
+TEST(FrameReader, Frames) {
+  VectorWriter vector_writer;
+  FrameWriter<VectorWriter> frame_writer{&vector_writer};
+  ASSERT_TRUE(frame_writer.Write(MakeRequest(1)));
+  ASSERT_TRUE(frame_writer.Write(MakeRequest(2)));
+
+  PedanticBufferReader buffer_reader{vector_writer.data(),
+                                     vector_writer.size()};
+  FrameReader<PedanticBufferReader> frame_reader{&buffer_reader};
+
+  // Frames read into separate buffers may be decoded independently, for
+  // example by worker threads.
+  std::vector<std::uint8_t> first, second;
+  ASSERT_TRUE(frame_reader.ReadFrame(&first));
+  ASSERT_TRUE(frame_reader.ReadFrame(&second));
+
+  Request request;
+  Deserializer<BufferReader> deserializer{second.data(), second.size()};
+  ASSERT_TRUE(deserializer.Read(&request));
+  EXPECT_EQ(2u, request.id);
+  EXPECT_TRUE(deserializer.reader().empty());
+
+  BufferReader reader{first.data(), first.size()};
+  ASSERT_TRUE(Deserializer<BufferReader*>{&reader}.Read(&request));
+  EXPECT_EQ(1u, request.id);
+}
+
+TEST(FrameReader, Malformed) {
+  Request request;
+
+  // Oversized frames are rejected before allocating.
+  const std::uint8_t oversized[] = {0x01, 0x01, 0x00, 0x00, 0x00};
+  PedanticBufferReader oversized_reader{oversized, sizeof(oversized)};
+  FrameReader<PedanticBufferReader> oversized_frame_reader{&oversized_reader,
+                                                           256};
+  EXPECT_EQ(ErrorStatus::ProtocolError,
+            oversized_frame_reader.Read(&request).error());
+
+  // Messages must fill their frames.
+  VectorWriter vector_writer;
+  FrameWriter<VectorWriter> frame_writer{&vector_writer};
+  ASSERT_TRUE(frame_writer.Write(MakeRequest(3)));
+  std::vector<std::uint8_t> data(vector_writer.data(),
+                                 vector_writer.data() + vector_writer.size());
+  data[0] += 1;
+  data.push_back(0x00);
+  PedanticBufferReader padded_reader{data.data(), data.size()};
+  FrameReader<PedanticBufferReader> padded_frame_reader{&padded_reader};
+  EXPECT_EQ(ErrorStatus::ProtocolError,
+            padded_frame_reader.Read(&request).error());
+
+  // Messages that overrun their frames fail to decode.
+  data.pop_back();
+  data[0] -= 2;
+  PedanticBufferReader short_reader{data.data(), data.size()};
+  FrameReader<PedanticBufferReader> short_frame_reader{&short_reader};
+  EXPECT_EQ(ErrorStatus::ReadLimitReached,
+            short_frame_reader.Read(&request).error());
+
+  // Fixed-size values are bounds checked against the frame as well.
+  const std::uint8_t truncated[] = {0x01, 0x00, 0x00, 0x00, 0x83};
+  PedanticBufferReader truncated_reader{truncated, sizeof(truncated)};
+  FrameReader<PedanticBufferReader> truncated_frame_reader{&truncated_reader};
+  std::uint64_t integer;
+  EXPECT_EQ(ErrorStatus::ReadLimitReached,
+            truncated_frame_reader.Read(&integer).error());
+}
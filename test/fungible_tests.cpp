@@ -15,20 +15,31 @@
 #include <gtest/gtest.h>
 
 #include <array>
+#include <bitset>
+#include <list>
 
 #include <nop/base/logical_buffer.h>
 #include <nop/structure.h>
 #include <nop/traits/is_fungible.h>
+#include <nop/types/binary.h>
 #include <nop/types/optional.h>
 #include <nop/types/result.h>
+#include <nop/types/sequence.h>
 #include <nop/types/variant.h>
+#include <nop/types/view.h>
 #include <nop/value.h>
 
+using nop::Binary;
+using nop::BinaryView;
 using nop::Entry;
+using nop::Generator;
 using nop::IsFungible;
 using nop::LogicalBuffer;
 using nop::Optional;
+using nop::Range;
+using nop::RawEncoded;
 using nop::Result;
+using nop::StringView;
 using nop::Variant;
 
 // Test fungibility of basic arithmetic types.
@@ -542,6 +553,132 @@ using ResultB = Result<ErrorB, T>;
 
 }  // anonymous namespace
 
+TEST(FungibleTests, Binary) {
+  using A = Binary<std::vector<float>>;
+  using B = std::vector<float>;
+  using C = Binary<std::array<float, 4>>;
+  using D = std::vector<double>;
+
+  EXPECT_TRUE((IsFungible<A, A>::value));
+  EXPECT_TRUE((IsFungible<A, B>::value));
+  EXPECT_TRUE((IsFungible<B, A>::value));
+  EXPECT_TRUE((IsFungible<A, C>::value));
+  EXPECT_FALSE((IsFungible<A, D>::value));
+  EXPECT_FALSE((IsFungible<D, C>::value));
+}
+
+TEST(FungibleTests, View) {
+  using A = BinaryView<int>;
+  using B = std::vector<int>;
+  using C = BinaryView<short>;
+
+  EXPECT_TRUE((IsFungible<A, A>::value));
+  EXPECT_TRUE((IsFungible<A, B>::value));
+  EXPECT_TRUE((IsFungible<B, A>::value));
+  EXPECT_FALSE((IsFungible<A, C>::value));
+  EXPECT_FALSE((IsFungible<C, B>::value));
+
+  EXPECT_TRUE((IsFungible<StringView, StringView>::value));
+  EXPECT_TRUE((IsFungible<StringView, std::string>::value));
+  EXPECT_TRUE((IsFungible<std::string, StringView>::value));
+  EXPECT_FALSE((IsFungible<StringView, A>::value));
+}
+
+TEST(FungibleTests, RawEncoded) {
+  using A = RawEncoded<std::vector<int>>;
+  using B = std::vector<int>;
+  using C = std::array<int, 2>;
+
+  EXPECT_TRUE((IsFungible<A, A>::value));
+  EXPECT_TRUE((IsFungible<A, B>::value));
+  EXPECT_TRUE((IsFungible<B, A>::value));
+  EXPECT_TRUE((IsFungible<A, C>::value));
+  EXPECT_TRUE((IsFungible<A, RawEncoded<C>>::value));
+  EXPECT_TRUE((IsFungible<A, Binary<B>>::value));
+  EXPECT_TRUE((IsFungible<Binary<B>, A>::value));
+  EXPECT_FALSE((IsFungible<A, std::string>::value));
+  EXPECT_FALSE((IsFungible<std::vector<float>, A>::value));
+}
+
+TEST(FungibleTests, Sequence) {
+  using A = Range<std::list<int>::const_iterator>;
+  using B = Generator<int>;
+  using C = std::vector<int>;
+
+  EXPECT_TRUE((IsFungible<A, C>::value));
+  EXPECT_TRUE((IsFungible<C, A>::value));
+  EXPECT_TRUE((IsFungible<B, C>::value));
+  EXPECT_TRUE((IsFungible<C, B>::value));
+  EXPECT_TRUE((IsFungible<A, B>::value));
+  EXPECT_TRUE((IsFungible<A, Range<C::const_iterator>>::value));
+  EXPECT_FALSE((IsFungible<A, std::vector<float>>::value));
+  EXPECT_FALSE((IsFungible<Generator<std::string>, C>::value));
+}
+
+TEST(FungibleTests, Bits) {
+  using A = std::vector<bool>;
+  using B = std::bitset<8>;
+
+  EXPECT_TRUE((IsFungible<A, B>::value));
+  EXPECT_TRUE((IsFungible<B, A>::value));
+  EXPECT_TRUE((IsFungible<B, std::bitset<8>>::value));
+  EXPECT_FALSE((IsFungible<B, std::bitset<16>>::value));
+  EXPECT_FALSE((IsFungible<A, std::array<bool, 8>>::value));
+  EXPECT_FALSE((IsFungible<std::array<bool, 8>, A>::value));
+  EXPECT_FALSE((IsFungible<A, bool[8]>::value));
+  EXPECT_TRUE((IsFungible<Generator<bool>, A>::value));
+  EXPECT_TRUE((IsFungible<A, Range<A::const_iterator>>::value));
+  EXPECT_FALSE((IsFungible<Generator<bool>, std::vector<std::uint8_t>>::value));
+  EXPECT_TRUE((IsFungible<std::array<bool, 8>, bool[8]>::value));
+  EXPECT_FALSE((IsFungible<A, std::vector<std::uint8_t>>::value));
+}
+
+TEST(FungibleTests, Interned) {
+  EXPECT_TRUE((IsFungible<nop::Interned<std::string>,
+                          nop::Interned<nop::StringView>>::value));
+  EXPECT_FALSE((IsFungible<nop::Interned<std::string>, std::string>::value));
+  EXPECT_FALSE((IsFungible<std::string, nop::Interned<std::string>>::value));
+}
+
+TEST(FungibleTests, Cached) {
+  using A = nop::Cached<std::vector<int>>;
+  using B = std::vector<int>;
+  using C = nop::Cached<std::vector<float>>;
+
+  EXPECT_TRUE((IsFungible<A, B>::value));
+  EXPECT_TRUE((IsFungible<B, A>::value));
+  EXPECT_TRUE((IsFungible<A, nop::RawEncoded<B>>::value));
+  EXPECT_TRUE((IsFungible<nop::RawEncoded<B>, A>::value));
+  EXPECT_TRUE((IsFungible<A, Binary<B>>::value));
+  EXPECT_TRUE((IsFungible<Binary<B>, A>::value));
+  EXPECT_FALSE((IsFungible<A, C>::value));
+  EXPECT_FALSE((IsFungible<A, std::string>::value));
+}
+
+TEST(FungibleTests, Pointer) {
+  EXPECT_TRUE((IsFungible<std::unique_ptr<int>,
+                          std::unique_ptr<const int>>::value));
+  EXPECT_TRUE((IsFungible<std::unique_ptr<int>, nop::Optional<int>>::value));
+  EXPECT_TRUE((IsFungible<nop::Optional<int>, std::unique_ptr<int>>::value));
+  EXPECT_TRUE((IsFungible<std::shared_ptr<int>,
+                          std::shared_ptr<const int>>::value));
+  EXPECT_FALSE((IsFungible<std::shared_ptr<int>, std::unique_ptr<int>>::value));
+  EXPECT_FALSE((IsFungible<std::shared_ptr<int>, nop::Optional<int>>::value));
+  EXPECT_FALSE((IsFungible<std::unique_ptr<int>, int>::value));
+}
+
+TEST(FungibleTests, ReducedFloat) {
+  using A = nop::Half<std::vector<float>>;
+  using B = nop::BFloat16<std::vector<float>>;
+  using C = std::vector<std::uint16_t>;
+
+  EXPECT_TRUE((IsFungible<A, C>::value));
+  EXPECT_TRUE((IsFungible<C, B>::value));
+  EXPECT_TRUE((IsFungible<A, nop::Half<std::array<float, 4>>>::value));
+  EXPECT_FALSE((IsFungible<A, B>::value));
+  EXPECT_FALSE((IsFungible<A, std::vector<float>>::value));
+}
+
 TEST(FungibleTests, Result) {
   // Result<EnumA, A> and Result<EnumA, B> are fungible if A and B are fungible.
   EXPECT_TRUE((IsFungible<ResultA<int>, ResultA<int>>::value));
@@ -0,0 +1,133 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <vector>
+
+#include <nop/serializer.h>
+#include <nop/structure.h>
+#include <nop/types/file_handle.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/handle_table.h>
+#include <nop/utility/vector_writer.h>
+
+using nop::BufferReader;
+using nop::Deserializer;
+using nop::ErrorStatus;
+using nop::FileHandle;
+using nop::HandleTableReader;
+using nop::HandleTableWriter;
+using nop::Serializer;
+using nop::UniqueFileHandle;
+using nop::VectorWriter;
+
+namespace {
+
+struct SharedBuffers {
+  std::vector<FileHandle> planes;
+  UniqueFileHandle owner;
+  FileHandle none;
+  NOP_STRUCTURE(SharedBuffers, planes, owner, none);
+};
+
+enum : std::size_t { kPlaneCount = 30 };
+
+SharedBuffers MakeSharedBuffers() {
+  SharedBuffers buffers;
+  for (std::size_t i = 0; i < kPlaneCount; i++)
+    buffers.planes.emplace_back(static_cast<int>(100 + i));
+  buffers.owner = UniqueFileHandle::Open("/dev/null", O_RDONLY | O_CLOEXEC);
+  return buffers;
+}
+
+}  // anonymous namespace
+
+TEST(HandleTable, RoundTrip) {
+  SharedBuffers buffers = MakeSharedBuffers();
+  ASSERT_TRUE(buffers.owner);
+
+  Serializer<HandleTableWriter<VectorWriter>> serializer;
+  serializer.writer().ReserveHandles(kPlaneCount + 1);
+  ASSERT_TRUE(serializer.Write(buffers));
+
+  // Every valid handle is collected in order; the empty one takes no slot.
+  const std::vector<int>& handles = serializer.writer().handles();
+  ASSERT_EQ(kPlaneCount + 1, handles.size());
+  EXPECT_EQ(100, handles.front());
+  EXPECT_EQ(buffers.owner.get(), handles.back());
+
+  // References take one byte rather than the nine bytes estimated.
+  EXPECT_EQ(serializer.GetSize(buffers) - (kPlaneCount + 2) * 8,
+            serializer.writer().size());
+
+  const VectorWriter& writer = serializer.writer();
+  Deserializer<HandleTableReader<BufferReader>> deserializer{writer.data(),
+                                                             writer.size()};
+  deserializer.reader().SetHandles(handles);
+
+  SharedBuffers received;
+  ASSERT_TRUE(deserializer.Read(&received));
+  ASSERT_EQ(kPlaneCount, received.planes.size());
+  for (std::size_t i = 0; i < kPlaneCount; i++)
+    EXPECT_EQ(static_cast<int>(100 + i), received.planes[i].get());
+  EXPECT_FALSE(received.none);
+
+  // The unique handle takes ownership; borrowed handles are not claimed.
+  EXPECT_EQ(buffers.owner.get(), received.owner.get());
+  EXPECT_TRUE(deserializer.reader().claimed(kPlaneCount));
+  EXPECT_FALSE(deserializer.reader().claimed(0));
+  buffers.owner.release();
+
+  serializer.writer().ClearHandles();
+  EXPECT_EQ(0u, serializer.writer().handle_count());
+}
+
+TEST(HandleTable, Errors) {
+  SharedBuffers buffers = MakeSharedBuffers();
+  ASSERT_TRUE(buffers.owner);
+
+  Serializer<HandleTableWriter<VectorWriter>> serializer;
+  ASSERT_TRUE(serializer.Write(buffers));
+  const VectorWriter& writer = serializer.writer();
+  std::vector<int> handles = serializer.writer().handles();
+  buffers.owner.release();
+
+  // A unique handle can only be claimed once.
+  Deserializer<HandleTableReader<BufferReader>> deserializer{writer.data(),
+                                                             writer.size()};
+  deserializer.reader().SetHandles(handles);
+  SharedBuffers received;
+  ASSERT_TRUE(deserializer.Read(&received));
+
+  Deserializer<HandleTableReader<BufferReader>> again{writer.data(),
+                                                      writer.size()};
+  again.reader().SetHandles(handles);
+  again.reader().GetHandle<UniqueFileHandle>(kPlaneCount).take().release();
+  SharedBuffers duplicate;
+  EXPECT_EQ(ErrorStatus::InvalidHandleReference,
+            again.Read(&duplicate).error());
+
+  // References beyond the handles of the message are rejected.
+  handles.pop_back();
+  Deserializer<HandleTableReader<BufferReader>> missing{writer.data(),
+                                                        writer.size()};
+  missing.reader().SetHandles(handles);
+  SharedBuffers truncated;
+  EXPECT_EQ(ErrorStatus::InvalidHandleReference,
+            missing.Read(&truncated).error());
+}
@@ -0,0 +1,248 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <nop/serializer.h>
+#include <nop/structure.h>
+#include <nop/table.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/canonical.h>
+#include <nop/utility/hashing_writer.h>
+#include <nop/utility/vector_writer.h>
+
+using nop::BufferReader;
+using nop::Canonical;
+using nop::ContentHash;
+using nop::Deserializer;
+using nop::Encoding;
+using nop::EncodingByte;
+using nop::EncodingIO;
+using nop::Entry;
+using nop::ErrorStatus;
+using nop::Hash128;
+using nop::HashingWriter;
+using nop::Serializer;
+using nop::SipHashStream;
+using nop::Status;
+using nop::VectorWriter;
+using nop::WriterIsCanonical;
+
+namespace {
+
+// Overestimates its encoded size, like handles and shared references.
+struct Estimated {
+  std::uint32_t value;
+};
+
+struct State {
+  std::string name;
+  std::unordered_map<std::string, std::uint32_t> counters;
+  NOP_STRUCTURE(State, name, counters);
+};
+
+struct StateTable {
+  Entry<std::unordered_map<std::uint32_t, std::string>, 0> labels;
+  Entry<std::uint64_t, 1> version;
+  NOP_TABLE(StateTable, labels, version);
+};
+
+struct EstimatedTable {
+  Entry<Estimated, 0> estimated;
+  NOP_TABLE(EstimatedTable, estimated);
+};
+
+// Returns a map with the same elements as |map| inserted in reverse order and
+// with a different bucket count, which changes the iteration order.
+template <typename Map>
+Map Reversed(const Map& map) {
+  std::vector<typename Map::value_type> elements{map.begin(), map.end()};
+  Map reversed{elements.size() * 7};
+  for (auto i = elements.rbegin(); i != elements.rend(); ++i)
+    reversed.insert(*i);
+  return reversed;
+}
+
+template <typename T>
+std::vector<std::uint8_t> EncodeCanonical(const T& value) {
+  Serializer<Canonical<VectorWriter>> serializer;
+  EXPECT_TRUE(serializer.Write(value));
+  return serializer.writer().Take();
+}
+
+}  // anonymous namespace
+
+namespace nop {
+
+template <>
+struct Encoding<Estimated> : EncodingIO<Estimated> {
+  static constexpr EncodingByte Prefix(const Estimated& value) {
+    return Encoding<std::uint32_t>::Prefix(value.value);
+  }
+
+  static constexpr std::size_t Size(const Estimated& value) {
+    return Encoding<std::uint32_t>::Size(value.value) + 2;
+  }
+
+  static constexpr bool Match(EncodingByte prefix) {
+    return Encoding<std::uint32_t>::Match(prefix);
+  }
+
+  template <typename Writer>
+  static constexpr Status<void> WritePayload(EncodingByte prefix,
+                                             const Estimated& value,
+                                             Writer* writer) {
+    return Encoding<std::uint32_t>::WritePayload(prefix, value.value, writer);
+  }
+
+  template <typename Reader>
+  static constexpr Status<void> ReadPayload(EncodingByte prefix,
+                                            Estimated* value, Reader* reader) {
+    return Encoding<std::uint32_t>::ReadPayload(prefix, &value->value,
+                                                reader);
+  }
+};
+
+}  // namespace nop
+
+TEST(Canonical, Traits) {
+  EXPECT_FALSE(WriterIsCanonical<VectorWriter>::value);
+  EXPECT_TRUE(WriterIsCanonical<Canonical<VectorWriter>>::value);
+  EXPECT_TRUE(WriterIsCanonical<HashingWriter<>>::value);
+}
+
+TEST(Canonical, UnorderedMap) {
+  std::unordered_map<std::uint32_t, std::string> value;
+  std::map<std::uint32_t, std::string> ordered;
+  for (std::uint32_t i = 0; i < 100; i++) {
+    value.emplace(i * 7919 % 1000, std::to_string(i));
+    ordered.emplace(i * 7919 % 1000, std::to_string(i));
+  }
+
+  // The canonical encoding of an unordered map is that of the ordered map.
+  const std::vector<std::uint8_t> encoded = EncodeCanonical(value);
+  EXPECT_EQ(EncodeCanonical(ordered), encoded);
+  EXPECT_EQ(encoded, EncodeCanonical(Reversed(value)));
+
+  Deserializer<BufferReader> deserializer{encoded.data(), encoded.size()};
+  std::unordered_map<std::uint32_t, std::string> copy;
+  ASSERT_TRUE(deserializer.Read(&copy));
+  EXPECT_EQ(value, copy);
+}
+
+TEST(Canonical, Nested) {
+  State state;
+  state.name = "state";
+  for (std::uint32_t i = 0; i < 50; i++)
+    state.counters.emplace("counter" + std::to_string(i), i);
+
+  State reversed = state;
+  reversed.counters = Reversed(state.counters);
+  EXPECT_EQ(EncodeCanonical(state), EncodeCanonical(reversed));
+
+  // Maps nested in table entries are written through a BoundedWriter, which
+  // preserves the canonical mode.
+  StateTable table;
+  table.labels = std::unordered_map<std::uint32_t, std::string>{};
+  for (std::uint32_t i = 0; i < 50; i++)
+    table.labels.get().emplace(i * 31, std::to_string(i));
+  table.version = 3;
+
+  StateTable reversed_table = table;
+  reversed_table.labels = Reversed(table.labels.get());
+  EXPECT_EQ(EncodeCanonical(table), EncodeCanonical(reversed_table));
+}
+
+TEST(Canonical, TablePadding) {
+  EstimatedTable table;
+  table.estimated = Estimated{10};
+
+  // Padded entries are not canonical.
+  Serializer<Canonical<VectorWriter>> serializer;
+  EXPECT_EQ(ErrorStatus::ProtocolError, serializer.Write(table).error());
+
+  Serializer<VectorWriter> padded;
+  EXPECT_TRUE(padded.Write(table));
+
+  Serializer<HashingWriter<>> hashing;
+  EXPECT_EQ(ErrorStatus::ProtocolError, hashing.Write(table).error());
+}
+
+TEST(HashingWriter, Hash) {
+  State state;
+  state.name = "state";
+  for (std::uint32_t i = 0; i < 50; i++)
+    state.counters.emplace("counter" + std::to_string(i), i);
+
+  // The hash is the hash of the canonical encoding.
+  const std::vector<std::uint8_t> encoded = EncodeCanonical(state);
+  SipHashStream<64> reference{1, 2};
+  reference.Update(encoded.data(), encoded.size());
+
+  Serializer<HashingWriter<>> serializer{1u, 2u};
+  ASSERT_TRUE(serializer.Write(state));
+  EXPECT_EQ(reference.Finish(), serializer.writer().hash());
+  EXPECT_EQ(encoded.size(), serializer.writer().size());
+
+  auto hash = ContentHash(state, 1, 2);
+  ASSERT_TRUE(hash);
+  EXPECT_EQ(reference.Finish(), hash.get());
+
+  // Equal values have equal hashes, and different values different hashes.
+  State reversed = state;
+  reversed.counters = Reversed(state.counters);
+  EXPECT_EQ(hash.get(), ContentHash(reversed, 1, 2).get());
+
+  State changed = state;
+  changed.counters["counter0"] = 1;
+  EXPECT_NE(hash.get(), ContentHash(changed, 1, 2).get());
+  EXPECT_NE(hash.get(), ContentHash(state, 2, 1).get());
+
+  serializer.writer().Reset();
+  EXPECT_EQ(0u, serializer.writer().size());
+  ASSERT_TRUE(serializer.Write(state));
+  EXPECT_EQ(hash.get(), serializer.writer().hash());
+}
+
+TEST(HashingWriter, Hash128) {
+  State state;
+  state.name = "state";
+  state.counters.emplace("counter", 1);
+
+  const std::vector<std::uint8_t> encoded = EncodeCanonical(state);
+  SipHashStream<128> reference{1, 2};
+  reference.Update(encoded.data(), encoded.size());
+
+  Serializer<HashingWriter<SipHashStream<128>>> serializer{1u, 2u};
+  ASSERT_TRUE(serializer.Write(state));
+  const Hash128 hash = serializer.writer().hash();
+  EXPECT_EQ(reference.Finish(), hash);
+}
+
+TEST(HashingWriter, Padding) {
+  HashingWriter<> writer;
+  ASSERT_TRUE(writer.Skip(100, 0xaa));
+
+  const std::vector<std::uint8_t> padding(100, 0xaa);
+  SipHashStream<64> reference{0, 0};
+  reference.Update(padding.data(), padding.size());
+  EXPECT_EQ(reference.Finish(), writer.hash());
+  EXPECT_EQ(100u, writer.size());
+}
@@ -0,0 +1,193 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <nop/serializer.h>
+#include <nop/structure.h>
+#include <nop/table.h>
+#include <nop/types/optional.h>
+#include <nop/types/variant.h>
+#include <nop/utility/incremental_decoder.h>
+#include <nop/utility/vector_writer.h>
+
+using nop::Entry;
+using nop::ErrorStatus;
+using nop::IncrementalDecoder;
+using nop::Optional;
+using nop::Serializer;
+using nop::Variant;
+using nop::VectorWriter;
+
+namespace {
+
+struct Settings {
+  Entry<std::string, 0> name;
+  Entry<std::vector<int>, 1> values;
+  NOP_TABLE(Settings, name, values);
+};
+
+struct Message {
+  std::uint64_t id;
+  std::string text;
+  std::map<int, std::vector<std::string>> groups;
+  Variant<int, std::string> choice;
+  Variant<int, std::string> empty_choice;
+  Optional<double> ratio;
+  Settings settings;
+  std::vector<std::uint8_t> payload;
+  NOP_STRUCTURE(Message, id, text, groups, choice, empty_choice, ratio,
+                settings, payload);
+};
+
+Message MakeMessage(std::uint64_t id) {
+  Message message;
+  message.id = id;
+  message.text = std::string(40, 'm');
+  message.groups = {{-1, {"a", "bc"}}, {300, {}}, {70000, {"def"}}};
+  message.choice = std::string{"choice"};
+  message.ratio = 0.25;
+  message.settings.name = std::string{"settings"};
+  message.settings.values = std::vector<int>{1, -2, 300000};
+  message.payload = std::vector<std::uint8_t>(1000, 0x5a);
+  return message;
+}
+
+void ExpectEqual(const Message& expected, const Message& actual) {
+  EXPECT_EQ(expected.id, actual.id);
+  EXPECT_EQ(expected.text, actual.text);
+  EXPECT_EQ(expected.groups, actual.groups);
+  ASSERT_TRUE(actual.choice.is<std::string>());
+  EXPECT_EQ(*expected.choice.get<std::string>(),
+            *actual.choice.get<std::string>());
+  EXPECT_TRUE(actual.empty_choice.empty());
+  EXPECT_EQ(expected.ratio.get(), actual.ratio.get());
+  EXPECT_EQ(expected.settings.name.get(), actual.settings.name.get());
+  EXPECT_EQ(expected.settings.values.get(), actual.settings.values.get());
+  EXPECT_EQ(expected.payload, actual.payload);
+}
+
+std::vector<std::uint8_t> Encode(const Message& message) {
+  Serializer<VectorWriter> serializer;
+  EXPECT_TRUE(serializer.Write(message));
+  return serializer.writer().Take();
+}
+
+}  // anonymous namespace
+
+TEST(IncrementalDecoder, ByteAtATime) {
+  const Message message = MakeMessage(1);
+  const std::vector<std::uint8_t> data = Encode(message);
+
+  IncrementalDecoder<Message> decoder;
+  for (std::size_t i = 0; i < data.size(); i++) {
+    EXPECT_FALSE(decoder.complete());
+    auto status = decoder.Feed(&data[i], 1);
+    ASSERT_TRUE(status);
+    EXPECT_EQ(1u, status.get());
+  }
+  ASSERT_TRUE(decoder.complete());
+  EXPECT_EQ(data.size(), decoder.size());
+
+  // A completed value consumes no more input until it is decoded.
+  EXPECT_EQ(0u, decoder.Feed(data.data(), data.size()).get());
+
+  Message decoded;
+  ASSERT_TRUE(decoder.Decode(&decoded));
+  ExpectEqual(message, decoded);
+  EXPECT_FALSE(decoder.complete());
+  EXPECT_EQ(0u, decoder.size());
+}
+
+TEST(IncrementalDecoder, Stream) {
+  // Back-to-back messages split into chunks that do not line up with them.
+  std::vector<std::uint8_t> stream;
+  const std::size_t kMessages = 5;
+  for (std::size_t i = 0; i < kMessages; i++) {
+    const std::vector<std::uint8_t> data = Encode(MakeMessage(i));
+    stream.insert(stream.end(), data.begin(), data.end());
+  }
+
+  for (std::size_t chunk_size : {7u, 64u, 333u, 4096u}) {
+    IncrementalDecoder<Message> decoder;
+    std::vector<Message> decoded;
+    for (std::size_t offset = 0; offset < stream.size();) {
+      std::size_t chunk = stream.size() - offset;
+      if (chunk > chunk_size)
+        chunk = chunk_size;
+
+      const std::uint8_t* data = stream.data() + offset;
+      offset += chunk;
+      while (chunk > 0) {
+        auto status = decoder.Feed(data, chunk);
+        ASSERT_TRUE(status);
+        data += status.get();
+        chunk -= status.get();
+
+        if (decoder.complete()) {
+          decoded.emplace_back();
+          ASSERT_TRUE(decoder.Decode(&decoded.back()));
+        }
+      }
+    }
+
+    ASSERT_EQ(kMessages, decoded.size()) << chunk_size;
+    for (std::size_t i = 0; i < kMessages; i++)
+      ExpectEqual(MakeMessage(i), decoded[i]);
+  }
+}
+
+TEST(IncrementalDecoder, Errors) {
+  const std::vector<std::uint8_t> data = Encode(MakeMessage(1));
+  Message decoded;
+
+  IncrementalDecoder<Message> decoder{data.size() - 1};
+  EXPECT_EQ(ErrorStatus::ReadLimitReached, decoder.Decode(&decoded).error());
+  EXPECT_EQ(ErrorStatus::ProtocolError,
+            decoder.Feed(data.data(), data.size()).error());
+
+  // Errors persist until the decoder is reset.
+  EXPECT_EQ(ErrorStatus::ProtocolError, decoder.Feed(data.data(), 1).error());
+  decoder.Reset();
+  ASSERT_TRUE(decoder.Feed(data.data(), 1));
+
+  // Unknown prefixes.
+  IncrementalDecoder<int> invalid;
+  const std::uint8_t reserved = 0x8a;
+  EXPECT_EQ(ErrorStatus::UnexpectedEncodingType,
+            invalid.Feed(&reserved, 1).error());
+
+  // Nesting deeper than the limit.
+  IncrementalDecoder<std::vector<std::vector<int>>> shallow{1024, 1};
+  std::vector<std::uint8_t> nested;
+  {
+    Serializer<VectorWriter> serializer;
+    ASSERT_TRUE(serializer.Write(std::vector<std::vector<int>>{{1}}));
+    nested = serializer.writer().Take();
+  }
+  EXPECT_EQ(ErrorStatus::DepthLimitReached,
+            shallow.Feed(nested.data(), nested.size()).error());
+
+  // Values that scan but do not match the type fail to decode.
+  IncrementalDecoder<std::string> mismatch;
+  ASSERT_TRUE(mismatch.Feed(nested.data(), nested.size()));
+  ASSERT_TRUE(mismatch.complete());
+  EXPECT_EQ(ErrorStatus::UnexpectedEncodingType,
+            mismatch.Decode(&decoded.text).error());
+}
@@ -0,0 +1,330 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <nop/rpc/instrumented_receiver.h>
+#include <nop/rpc/interface.h>
+#include <nop/rpc/simple_method_receiver.h>
+#include <nop/serializer.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/latency_histogram.h>
+#include <nop/utility/vector_writer.h>
+
+using nop::AtomicLatencyHistogram;
+using nop::BindInterface;
+using nop::BufferReader;
+using nop::Deserializer;
+using nop::ErrorStatus;
+using nop::InstrumentedReceiver;
+using nop::Interface;
+using nop::InterfaceType;
+using nop::LatencyHistogram;
+using nop::MethodStats;
+using nop::MethodStatsTable;
+using nop::Serializer;
+using nop::SimpleMethodReceiver;
+using nop::VectorWriter;
+
+namespace {
+
+struct TestInterface : Interface<TestInterface> {
+  NOP_INTERFACE("io.github.eieio.InstrumentedTestInterface");
+
+  NOP_METHOD(Sum, int(int a, int b));
+  NOP_METHOD(Length, std::size_t(const std::string& string));
+  NOP_METHOD(Unbound, void());
+
+  NOP_INTERFACE_API(Sum, Length, Unbound);
+};
+
+// Clock that advances by a fixed step each time it is read.
+struct StepClock {
+  static constexpr bool kEnabled = true;
+  static std::uint64_t Now() { return now += 10; }
+  static std::uint64_t now;
+};
+
+std::uint64_t StepClock::now = 0;
+
+using MethodSelector = InterfaceType<TestInterface>::MethodSelector;
+
+template <typename Method>
+MethodSelector Selector() {
+  return static_cast<MethodSelector>(Method::Selector);
+}
+
+// Serializes a sequence of method selectors and argument tuples.
+template <typename... Values>
+std::vector<std::uint8_t> Calls(const Values&... values) {
+  Serializer<VectorWriter> serializer;
+  bool ok = true;
+  (void)std::initializer_list<int>{
+      (ok = ok && static_cast<bool>(serializer.Write(values)), 0)...};
+  EXPECT_TRUE(ok);
+  return serializer.writer().Take();
+}
+
+}  // anonymous namespace
+
+TEST(LatencyHistogram, Buckets) {
+  // Small values are recorded exactly.
+  for (std::uint64_t value = 0; value < LatencyHistogram::kSubBuckets;
+       value++) {
+    EXPECT_EQ(value, LatencyHistogram::BucketIndex(value));
+    EXPECT_EQ(value, LatencyHistogram::BucketUpperBound(value));
+  }
+
+  // Every value lies within its bucket, the buckets are contiguous and each
+  // bucket is within 1 / kSubBuckets of its values.
+  std::vector<std::uint64_t> values;
+  for (std::size_t shift = 0; shift < 64; shift++) {
+    const std::uint64_t power = std::uint64_t{1} << shift;
+    values.push_back(power);
+    values.push_back(power - 1);
+    values.push_back(power + 1);
+    values.push_back(power + power / 3);
+  }
+  values.push_back(~std::uint64_t{0});
+
+  for (std::uint64_t value : values) {
+    const std::size_t index = LatencyHistogram::BucketIndex(value);
+    ASSERT_LT(index, LatencyHistogram::kBuckets);
+    const std::uint64_t upper = LatencyHistogram::BucketUpperBound(index);
+    EXPECT_LE(value, upper) << value;
+    if (index > 0) {
+      const std::uint64_t lower =
+          LatencyHistogram::BucketUpperBound(index - 1) + 1;
+      EXPECT_GE(value, lower) << value;
+      EXPECT_LE(upper - lower, lower / LatencyHistogram::kSubBuckets) << value;
+    }
+  }
+  EXPECT_EQ(LatencyHistogram::kBuckets - 1,
+            LatencyHistogram::BucketIndex(~std::uint64_t{0}));
+  EXPECT_EQ(~std::uint64_t{0},
+            LatencyHistogram::BucketUpperBound(LatencyHistogram::kBuckets - 1));
+}
+
+TEST(LatencyHistogram, Percentile) {
+  LatencyHistogram histogram;
+  EXPECT_EQ(0u, histogram.count());
+  EXPECT_EQ(0u, histogram.Percentile(0.5));
+
+  for (std::uint64_t value = 1; value <= 1000; value++)
+    histogram.Record(value);
+
+  EXPECT_EQ(1000u, histogram.count());
+  EXPECT_EQ(500500u, histogram.sum());
+  EXPECT_EQ(1000u, histogram.max());
+  EXPECT_DOUBLE_EQ(500.5, histogram.mean());
+  EXPECT_EQ(1u, histogram.Percentile(0.0));
+  EXPECT_EQ(1000u, histogram.Percentile(1.0));
+
+  const std::uint64_t median = histogram.Percentile(0.5);
+  EXPECT_GE(median, 500u);
+  EXPECT_LE(median, 500u + 500u / LatencyHistogram::kSubBuckets);
+
+  const std::uint64_t p99 = histogram.Percentile(0.99);
+  EXPECT_GE(p99, 990u);
+  EXPECT_LE(p99, 1000u);
+
+  LatencyHistogram other;
+  other.Record(5000, 10);
+  histogram += other;
+  EXPECT_EQ(1010u, histogram.count());
+  EXPECT_EQ(5000u, histogram.max());
+  EXPECT_EQ(5000u, histogram.Percentile(1.0));
+  EXPECT_EQ(10u, histogram.bucket(LatencyHistogram::BucketIndex(5000)));
+
+  histogram.Reset();
+  EXPECT_EQ(0u, histogram.count());
+  EXPECT_EQ(0u, histogram.max());
+}
+
+TEST(LatencyHistogram, Atomic) {
+  AtomicLatencyHistogram atomic;
+  EXPECT_EQ(0u, atomic.Snapshot().count());
+
+  LatencyHistogram expected;
+  for (std::uint64_t value = 0; value < 100000; value += 7) {
+    atomic.Record(value);
+    expected.Record(value);
+  }
+
+  const LatencyHistogram snapshot = atomic.Snapshot();
+  EXPECT_EQ(expected.count(), snapshot.count());
+  EXPECT_EQ(expected.sum(), snapshot.sum());
+  EXPECT_EQ(expected.max(), snapshot.max());
+  for (std::size_t i = 0; i < LatencyHistogram::kBuckets; i++)
+    EXPECT_EQ(expected.bucket(i), snapshot.bucket(i));
+}
+
+TEST(InstrumentedReceiver, Stats) {
+  using Receiver = SimpleMethodReceiver<Serializer<VectorWriter>,
+                                        Deserializer<BufferReader>>;
+
+  auto bindings = BindInterface(
+      TestInterface::Sum::Bind([](int a, int b) { return a + b; }),
+      TestInterface::Length::Bind(
+          [](const std::string& string) { return string.size(); }));
+
+  const std::string kString(300, 'x');
+  const std::vector<std::uint8_t> input = Calls(
+      Selector<TestInterface::Sum>(), std::make_tuple(1, 2),
+      Selector<TestInterface::Length>(), std::make_tuple(kString),
+      Selector<TestInterface::Sum>(), std::make_tuple(3, 4),
+      Selector<TestInterface::Unbound>(), Selector<TestInterface::Length>());
+
+  MethodStatsTable table;
+  Serializer<VectorWriter> serializer;
+  Deserializer<BufferReader> deserializer{input.data(), input.size()};
+  Receiver receiver{&serializer, &deserializer};
+
+  {
+    InstrumentedReceiver<Receiver, StepClock> instrumented{&receiver, &table};
+    EXPECT_EQ(&receiver, &instrumented.receiver());
+
+    ASSERT_TRUE(instrumented.Dispatch(bindings));
+    ASSERT_TRUE(instrumented.Dispatch(bindings));
+    ASSERT_TRUE(instrumented.Dispatch(bindings));
+
+    auto status = instrumented.Dispatch(bindings);
+    ASSERT_FALSE(status);
+    EXPECT_EQ(ErrorStatus::InvalidInterfaceMethod, status.error());
+
+    // The arguments of the last call are missing.
+    status = bindings(&instrumented);
+    ASSERT_FALSE(status);
+
+    // The failed decode completes the call.
+    MethodStats length = table.Snapshot<TestInterface::Length>();
+    EXPECT_EQ(2u, length.calls);
+    EXPECT_EQ(0u, length.in_flight);
+    EXPECT_EQ(1u, length.errors);
+  }
+
+  // The replies are written to the wrapped receiver.
+  int sum = 0;
+  std::size_t length = 0;
+  Deserializer<BufferReader> replies{serializer.writer().data(),
+                                     serializer.writer().size()};
+  ASSERT_TRUE(replies.Read(&sum));
+  EXPECT_EQ(3, sum);
+  ASSERT_TRUE(replies.Read(&length));
+  EXPECT_EQ(kString.size(), length);
+  ASSERT_TRUE(replies.Read(&sum));
+  EXPECT_EQ(7, sum);
+
+  const auto snapshot = table.Snapshot();
+  ASSERT_EQ(3u, snapshot.size());
+
+  const MethodStats& sum_stats =
+      snapshot.at(static_cast<std::uint64_t>(Selector<TestInterface::Sum>()));
+  EXPECT_EQ(2u, sum_stats.calls);
+  EXPECT_EQ(0u, sum_stats.in_flight);
+  EXPECT_EQ(0u, sum_stats.errors);
+  using SumArgs = nop::Encoding<std::tuple<int, int>>;
+  EXPECT_EQ(SumArgs::Size(std::tuple<int, int>{1, 2}) +
+                SumArgs::Size(std::tuple<int, int>{3, 4}),
+            sum_stats.bytes_in);
+  EXPECT_EQ(nop::Encoding<int>::Size(3) + nop::Encoding<int>::Size(7),
+            sum_stats.bytes_out);
+
+  // The clock advances 10 ticks per reading: the decode and encode phases are
+  // bracketed by consecutive readings, and the handler phase by the end of the
+  // decode and the start of the encode.
+  for (const LatencyHistogram* histogram :
+       {&sum_stats.decode, &sum_stats.handler, &sum_stats.encode}) {
+    EXPECT_EQ(2u, histogram->count());
+    EXPECT_EQ(10u, histogram->max());
+    EXPECT_EQ(10u, histogram->Percentile(0.5));
+  }
+
+  const MethodStats& length_stats = snapshot.at(
+      static_cast<std::uint64_t>(Selector<TestInterface::Length>()));
+  EXPECT_EQ(2u, length_stats.calls);
+  EXPECT_EQ(1u, length_stats.errors);
+  EXPECT_EQ(nop::Encoding<std::tuple<std::string>>::Size(kString),
+            length_stats.bytes_in);
+  EXPECT_EQ(nop::Encoding<std::size_t>::Size(kString.size()),
+            length_stats.bytes_out);
+  EXPECT_EQ(1u, length_stats.decode.count());
+  EXPECT_EQ(1u, length_stats.encode.count());
+
+  // Unbound selectors are counted as errors.
+  const MethodStats& unbound_stats = snapshot.at(
+      static_cast<std::uint64_t>(Selector<TestInterface::Unbound>()));
+  EXPECT_EQ(1u, unbound_stats.calls);
+  EXPECT_EQ(0u, unbound_stats.in_flight);
+  EXPECT_EQ(1u, unbound_stats.errors);
+  EXPECT_EQ(0u, unbound_stats.decode.count());
+}
+
+TEST(InstrumentedReceiver, Threads) {
+  using Receiver = SimpleMethodReceiver<Serializer<VectorWriter>,
+                                        Deserializer<BufferReader>>;
+
+  auto bindings = BindInterface(
+      TestInterface::Sum::Bind([](int a, int b) { return a + b; }));
+
+  const int kThreads = 4;
+  const int kCalls = 1000;
+
+  std::vector<std::uint8_t> input;
+  for (int i = 0; i < kCalls; i++) {
+    const auto call =
+        Calls(Selector<TestInterface::Sum>(), std::make_tuple(i, i));
+    input.insert(input.end(), call.begin(), call.end());
+  }
+
+  MethodStatsTable table;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kThreads; i++) {
+    threads.emplace_back([&] {
+      Serializer<VectorWriter> serializer;
+      Deserializer<BufferReader> deserializer{input.data(), input.size()};
+      Receiver receiver{&serializer, &deserializer};
+      InstrumentedReceiver<Receiver> instrumented{&receiver, &table};
+      for (int j = 0; j < kCalls; j++)
+        EXPECT_TRUE(instrumented.Dispatch(bindings));
+    });
+  }
+
+  // Snapshots may be taken while the calls are recorded.
+  while (table.Snapshot<TestInterface::Sum>().calls <
+         static_cast<std::uint64_t>(kThreads * kCalls)) {
+    const MethodStats stats = table.Snapshot<TestInterface::Sum>();
+    EXPECT_LE(stats.in_flight, static_cast<std::uint64_t>(kThreads));
+    std::this_thread::yield();
+  }
+
+  for (auto& thread : threads)
+    thread.join();
+
+  const MethodStats stats = table.Snapshot<TestInterface::Sum>();
+  EXPECT_EQ(static_cast<std::uint64_t>(kThreads * kCalls), stats.calls);
+  EXPECT_EQ(0u, stats.in_flight);
+  EXPECT_EQ(0u, stats.errors);
+  EXPECT_EQ(static_cast<std::uint64_t>(kThreads * kCalls),
+            stats.handler.count());
+  EXPECT_EQ(static_cast<std::uint64_t>(kThreads) * input.size(),
+            stats.bytes_in + kThreads * kCalls *
+                                 nop::Encoding<MethodSelector>::Size(
+                                     Selector<TestInterface::Sum>()));
+}
@@ -15,6 +15,7 @@
 #include <gtest/gtest.h>
 
 #include <cstddef>
+#include <cstdint>
 #include <string>
 #include <type_traits>
 #include <vector>
@@ -24,12 +25,17 @@
 #include <nop/rpc/simple_method_sender.h>
 #include <nop/serializer.h>
 #include <nop/structure.h>
+#include <nop/types/view.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/vector_writer.h>
 
 #include "test_reader.h"
 #include "test_utilities.h"
 #include "test_writer.h"
 
+using nop::BinaryView;
 using nop::BindInterface;
+using nop::BufferReader;
 using nop::Compose;
 using nop::Deserializer;
 using nop::EncodingByte;
@@ -43,9 +49,11 @@ using nop::Serializer;
 using nop::SimpleMethodReceiver;
 using nop::SimpleMethodSender;
 using nop::Status;
+using nop::StringView;
 using nop::TestReader;
 using nop::TestWriter;
 using nop::Variant;
+using nop::VectorWriter;
 
 namespace {
 
@@ -78,6 +86,16 @@ struct TestInterface : Interface<TestInterface> {
 
 using MethodSelectorType = InterfaceType<TestInterface>::MethodSelector;
 
+struct IngestInterface : Interface<IngestInterface> {
+  NOP_INTERFACE("io.github.eieio.IngestInterface");
+
+  NOP_METHOD(Put, std::size_t(const std::string& key,
+                              const std::vector<std::uint8_t>& blob,
+                              const std::vector<std::string>& tags));
+
+  NOP_INTERFACE_API(Put);
+};
+
 // Define the method selector encoding type based on the type of MethodSelector.
 constexpr EncodingByte MethodSelectorEncoding = std::conditional_t<
     std::is_same<MethodSelectorType, std::uint64_t>::value,
@@ -267,3 +285,81 @@ TEST(InterfaceTests, Invoke) {
     writer.clear();
   }
 }
+
+TEST(InterfaceTests, BindOrder) {
+  TestReader reader;
+  TestWriter writer;
+  Deserializer<TestReader*> deserializer{&reader};
+  Serializer<TestWriter*> serializer{&writer};
+  auto receiver = MakeSimpleMethodReceiver(&serializer, &deserializer);
+
+  // Dispatch does not depend on the order the methods are bound in.
+  auto binding = BindInterface(
+      TestInterface::Length::Bind(
+          [](const std::string& string) { return string.size(); }),
+      TestInterface::Product::Bind([](int a, int b) { return a * b; }),
+      TestInterface::Sum::Bind([](int a, int b) { return a + b; }));
+
+  EXPECT_TRUE(binding.Match(TestInterface::Sum::Selector));
+  EXPECT_TRUE(binding.Match(TestInterface::Product::Selector));
+  EXPECT_TRUE(binding.Match(TestInterface::Length::Selector));
+  EXPECT_FALSE(binding.Match(TestInterface::Match::Selector));
+
+  reader.Set(
+      Compose(MethodSelectorEncoding,
+              Integer<MethodSelectorType>(TestInterface::Product::Selector),
+              EncodingByte::Array, 2, 3, 4));
+  ASSERT_TRUE(binding(&receiver));
+  EXPECT_EQ(Compose(12), writer.data());
+  writer.clear();
+
+  reader.Set(
+      Compose(MethodSelectorEncoding,
+              Integer<MethodSelectorType>(TestInterface::Length::Selector),
+              EncodingByte::Array, 1, EncodingByte::String, 3, "foo"));
+  ASSERT_TRUE(binding(&receiver));
+  EXPECT_EQ(Compose(3), writer.data());
+}
+
+TEST(InterfaceTests, BorrowedArgs) {
+  VectorWriter request;
+  Serializer<VectorWriter*> request_serializer{&request};
+
+  const std::vector<std::uint8_t> blob(1024, 0x5a);
+  ASSERT_TRUE(request_serializer.Write(IngestInterface::Put::Selector));
+  ASSERT_TRUE(request_serializer.Write(std::make_tuple(
+      StringView{"key"}, BinaryView<std::uint8_t>{blob},
+      std::vector<StringView>{"a", "bc"})));
+
+  const std::uint8_t* begin = request.data();
+  const std::uint8_t* end = request.data() + request.size();
+  auto within = [begin, end](const void* data) {
+    return data >= begin && data < end;
+  };
+
+  bool called = false;
+  auto binding = BindInterface(IngestInterface::Put::Bind(
+      [&](StringView key, BinaryView<std::uint8_t> blob_view,
+          const std::vector<StringView>& tags) {
+        called = true;
+        EXPECT_EQ(StringView{"key"}, key);
+        EXPECT_EQ(BinaryView<std::uint8_t>{blob}, blob_view);
+        EXPECT_EQ(2u, tags.size());
+
+        // The views alias the request instead of holding copies.
+        EXPECT_TRUE(within(key.data()));
+        EXPECT_TRUE(within(blob_view.data()));
+        for (const StringView& tag : tags)
+          EXPECT_TRUE(within(tag.data()));
+        return key.size() + blob_view.size();
+      }));
+
+  TestWriter writer;
+  Deserializer<BufferReader> deserializer{request.data(), request.size()};
+  Serializer<TestWriter*> serializer{&writer};
+  auto receiver = MakeSimpleMethodReceiver(&serializer, &deserializer);
+  ASSERT_TRUE(binding(&receiver));
+  EXPECT_TRUE(called);
+  EXPECT_EQ(Compose(EncodingByte::U16, Integer<std::uint16_t>(1027)),
+            writer.data());
+}
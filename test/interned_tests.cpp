@@ -0,0 +1,290 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <nop/serializer.h>
+#include <nop/structure.h>
+#include <nop/table.h>
+#include <nop/types/interned.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/incremental_decoder.h>
+#include <nop/utility/interning_reader.h>
+#include <nop/utility/interning_writer.h>
+#include <nop/utility/stream_reader.h>
+#include <nop/utility/vector_writer.h>
+
+using nop::BufferReader;
+using nop::DeletedEntry;
+using nop::Deserializer;
+using nop::Encoding;
+using nop::Entry;
+using nop::ErrorStatus;
+using nop::IncrementalDecoder;
+using nop::Interned;
+using nop::InterningReader;
+using nop::InterningWriter;
+using nop::Serializer;
+using nop::SkipValue;
+using nop::Status;
+using nop::StreamReader;
+using nop::StringView;
+using nop::ValidateValue;
+using nop::VectorWriter;
+
+namespace {
+
+struct Record {
+  std::uint32_t id;
+  Interned<std::string> category;
+  NOP_STRUCTURE(Record, id, category);
+};
+
+bool operator==(const Record& a, const Record& b) {
+  return a.id == b.id && a.category == b.category;
+}
+
+struct Catalog {
+  Entry<std::vector<Interned<std::string>>, 0> names;
+  Entry<Interned<std::string>, 1> primary;
+  NOP_TABLE_NS("Catalog", Catalog, names, primary);
+};
+
+// A later version of Catalog without the entry that defines the strings.
+struct CatalogPrimary {
+  Entry<std::vector<Interned<std::string>>, 0, DeletedEntry> names;
+  Entry<Interned<std::string>, 1> primary;
+  NOP_TABLE_NS("Catalog", CatalogPrimary, names, primary);
+};
+
+template <typename T>
+std::vector<std::uint8_t> Serialize(const T& value) {
+  VectorWriter vector_writer;
+  Serializer<InterningWriter<VectorWriter>> serializer{&vector_writer};
+  EXPECT_TRUE(serializer.Write(value));
+  EXPECT_LE(vector_writer.size(), Encoding<T>::Size(value));
+  return vector_writer.Take();
+}
+
+template <typename T>
+Status<void> Deserialize(const std::vector<std::uint8_t>& data, T* value) {
+  BufferReader buffer_reader{data.data(), data.size()};
+  Deserializer<InterningReader<BufferReader>> deserializer{&buffer_reader};
+  auto status = deserializer.Read(value);
+  if (status && buffer_reader.remaining() != 0)
+    return ErrorStatus::ProtocolError;
+  return status;
+}
+
+std::vector<Record> MakeRecords() {
+  const char* categories[] = {"network.request", "network.response",
+                              "storage.read", "storage.write"};
+  std::vector<Record> records;
+  for (std::uint32_t i = 0; i < 100; i++)
+    records.push_back({i, std::string{categories[i % 4]}});
+  return records;
+}
+
+}  // anonymous namespace
+
+TEST(Interned, Encoding) {
+  const std::vector<Interned<std::string>> value = {
+      std::string{"ab"}, std::string{"ab"}, std::string{"c"},
+      std::string{"ab"}};
+  EXPECT_EQ((std::vector<std::uint8_t>{0xba, 0x04, 0xbf, 0x00, 0xbd, 0x02,
+                                       'a', 'b', 0xbf, 0x00, 0x00, 0xbf,
+                                       0x00, 0xbd, 0x01, 'c', 0xbf, 0x00,
+                                       0x00}),
+            Serialize(value));
+}
+
+TEST(Interned, RoundTrip) {
+  const std::vector<Record> records = MakeRecords();
+  const auto data = Serialize(records);
+
+  // The plain encoding repeats every category in full.
+  Serializer<VectorWriter> plain_serializer;
+  std::vector<std::pair<std::uint32_t, std::string>> plain;
+  for (const auto& record : records)
+    plain.emplace_back(record.id, record.category.get());
+  ASSERT_TRUE(plain_serializer.Write(plain));
+  EXPECT_LT(2 * data.size(), plain_serializer.writer().size());
+
+  std::vector<Record> borrowed;
+  ASSERT_TRUE(Deserialize(data, &borrowed));
+  EXPECT_EQ(records, borrowed);
+
+  // Readers that cannot borrow copy each definition into the table.
+  StreamReader<std::stringstream> stream_reader{
+      std::string{data.begin(), data.end()}};
+  InterningReader<StreamReader<std::stringstream>> interning_reader{
+      &stream_reader};
+  Deserializer<decltype(interning_reader)*> deserializer{&interning_reader};
+  std::vector<Record> copied;
+  ASSERT_TRUE(deserializer.Read(&copied));
+  EXPECT_EQ(records, copied);
+  EXPECT_EQ(4u, interning_reader.string_count());
+}
+
+TEST(Interned, Views) {
+  const std::vector<Interned<std::string>> value = {
+      std::string{"foo"}, std::string{"bar"}, std::string{"foo"}};
+  const auto data = Serialize(value);
+
+  std::vector<Interned<StringView>> views;
+  ASSERT_TRUE(Deserialize(data, &views));
+  ASSERT_EQ(3u, views.size());
+  EXPECT_EQ(StringView{"foo"}, views[0].get());
+  EXPECT_EQ(StringView{"bar"}, views[1].get());
+
+  // References resolve to the definition in the input.
+  EXPECT_EQ(views[0]->data(), views[2]->data());
+  EXPECT_GE(views[0]->data(), reinterpret_cast<const char*>(data.data()));
+  EXPECT_LT(views[0]->data(),
+            reinterpret_cast<const char*>(data.data() + data.size()));
+}
+
+TEST(Interned, Tables) {
+  VectorWriter vector_writer;
+  Serializer<InterningWriter<VectorWriter>> serializer{&vector_writer};
+  const Interned<std::string> value{std::string{"foo"}};
+
+  ASSERT_TRUE(serializer.Write(value));
+  ASSERT_TRUE(serializer.Write(value));
+  EXPECT_EQ(1u, serializer.writer().string_count());
+
+  // Clearing the table defines the string again.
+  serializer.writer().ClearStrings();
+  ASSERT_TRUE(serializer.Write(value));
+  const std::vector<std::uint8_t> data = vector_writer.Take();
+  EXPECT_EQ((std::vector<std::uint8_t>{0xbf, 0x00, 0xbd, 0x03, 'f', 'o', 'o',
+                                       0xbf, 0x00, 0x00, 0xbf, 0x00, 0xbd,
+                                       0x03, 'f', 'o', 'o'}),
+            data);
+
+  BufferReader buffer_reader{data.data(), data.size()};
+  Deserializer<InterningReader<BufferReader>> deserializer{&buffer_reader};
+  Interned<std::string> decoded;
+  ASSERT_TRUE(deserializer.Read(&decoded));
+  ASSERT_TRUE(deserializer.Read(&decoded));
+  EXPECT_EQ(value, decoded);
+  deserializer.reader().ClearStrings();
+  ASSERT_TRUE(deserializer.Read(&decoded));
+  EXPECT_EQ(value, decoded);
+  EXPECT_EQ(1u, deserializer.reader().string_count());
+}
+
+TEST(Interned, Errors) {
+  Interned<std::string> value;
+
+  // Reference to an undefined string.
+  EXPECT_EQ(ErrorStatus::InvalidReference,
+            Deserialize(std::vector<std::uint8_t>{0xbf, 0x00, 0x00}, &value)
+                .error());
+
+  // Unknown extension type.
+  EXPECT_EQ(ErrorStatus::UnexpectedEncodingType,
+            Deserialize(std::vector<std::uint8_t>{0xbf, 0x01, 0x00}, &value)
+                .error());
+
+  // Neither a definition nor a reference.
+  EXPECT_EQ(ErrorStatus::UnexpectedEncodingType,
+            Deserialize(std::vector<std::uint8_t>{0xbf, 0x00, 0xbe}, &value)
+                .error());
+
+  // A plain string is not an interned string, and vice versa.
+  EXPECT_EQ(
+      ErrorStatus::UnexpectedEncodingType,
+      Deserialize(std::vector<std::uint8_t>{0xbd, 0x01, 'a'}, &value).error());
+  std::string string;
+  EXPECT_EQ(ErrorStatus::UnexpectedEncodingType,
+            Deserialize(std::vector<std::uint8_t>{0xbf, 0x00, 0xbd, 0x01, 'a'},
+                        &string)
+                .error());
+}
+
+TEST(Interned, TableEntries) {
+  Catalog catalog;
+  catalog.names = std::vector<Interned<std::string>>{std::string{"foo"},
+                                                     std::string{"bar"}};
+  catalog.primary = Interned<std::string>{std::string{"bar"}};
+  const auto data = Serialize(catalog);
+
+  Catalog decoded;
+  ASSERT_TRUE(Deserialize(data, &decoded));
+  EXPECT_EQ(catalog.names.get(), decoded.names.get());
+  EXPECT_EQ(catalog.primary.get(), decoded.primary.get());
+
+  // Skipping the entry that defines the strings still adds them to the table,
+  // so that the reference in the next entry resolves.
+  CatalogPrimary primary;
+  ASSERT_TRUE(Deserialize(data, &primary));
+  EXPECT_EQ(catalog.primary.get(), primary.primary.get());
+}
+
+TEST(Interned, Skip) {
+  VectorWriter vector_writer;
+  Serializer<InterningWriter<VectorWriter>> serializer{&vector_writer};
+  const std::vector<Interned<std::string>> value = {
+      std::string{"foo"}, std::string{"bar"}, std::string{"foo"}};
+  const Interned<std::string> reference{std::string{"bar"}};
+  ASSERT_TRUE(serializer.Write(value));
+  const std::size_t value_size = vector_writer.size();
+  ASSERT_TRUE(serializer.Write(reference));
+  const std::vector<std::uint8_t> data = vector_writer.Take();
+
+  BufferReader skip_reader{data.data(), data.size()};
+  ASSERT_TRUE(SkipValue(&skip_reader));
+  EXPECT_EQ(data.size() - value_size, skip_reader.remaining());
+
+  BufferReader validate_reader{data.data(), data.size()};
+  ASSERT_TRUE(ValidateValue(&validate_reader));
+  EXPECT_EQ(data.size() - value_size, validate_reader.remaining());
+
+  IncrementalDecoder<std::vector<Interned<std::string>>> decoder;
+  for (std::size_t i = 0; i < value_size; i++)
+    ASSERT_TRUE(decoder.Feed(&data[i], 1));
+  EXPECT_TRUE(decoder.complete());
+
+  // Skipping through an InterningReader defines the skipped strings, whether
+  // they are borrowed from the input or copied.
+  BufferReader buffer_reader{data.data(), data.size()};
+  Deserializer<InterningReader<BufferReader>> deserializer{&buffer_reader};
+  ASSERT_TRUE(SkipValue(&deserializer.reader()));
+  EXPECT_EQ(2u, deserializer.reader().string_count());
+  Interned<StringView> view;
+  ASSERT_TRUE(deserializer.Read(&view));
+  EXPECT_EQ(StringView{"bar"}, view.get());
+
+  StreamReader<std::stringstream> stream_reader{
+      std::string{data.begin(), data.end()}};
+  InterningReader<StreamReader<std::stringstream>> interning_reader{
+      &stream_reader};
+  ASSERT_TRUE(SkipValue(&interning_reader));
+  Interned<std::string> copied;
+  ASSERT_TRUE(Deserializer<decltype(interning_reader)*>{&interning_reader}.Read(
+      &copied));
+  EXPECT_EQ(reference, copied);
+
+  // Only the extension types with a defined format can be skipped.
+  const std::vector<std::uint8_t> unknown = {0xbf, 0x02, 0x00};
+  BufferReader unknown_reader{unknown.data(), unknown.size()};
+  EXPECT_EQ(ErrorStatus::UnexpectedEncodingType,
+            SkipValue(&unknown_reader).error());
+}
@@ -0,0 +1,223 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <fcntl.h>
+#include <gtest/gtest.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <nop/serializer.h>
+#include <nop/utility/frame_writer.h>
+#include <nop/utility/io_uring.h>
+#include <nop/utility/io_uring_reader.h>
+#include <nop/utility/io_uring_writer.h>
+
+using nop::ErrorStatus;
+using nop::FrameWriter;
+using nop::IoUring;
+using nop::IoUringFile;
+using nop::IoUringFrameReader;
+using nop::IoUringWriter;
+using nop::Serializer;
+
+namespace {
+
+struct Pipe {
+  Pipe() { EXPECT_EQ(0, ::pipe(fds)); }
+  ~Pipe() {
+    ::close(fds[0]);
+    ::close(fds[1]);
+  }
+
+  int read_fd() const { return fds[0]; }
+  int write_fd() const { return fds[1]; }
+
+  int fds[2];
+};
+
+// Returns an fd to an unlinked temporary file.
+int MakeTempFile() {
+  char path[] = "/tmp/nop_io_uring_XXXXXX";
+  const int fd = ::mkstemp(path);
+  EXPECT_LE(0, fd);
+  ::unlink(path);
+  return fd;
+}
+
+}  // anonymous namespace
+
+TEST(IoUring, BatchedSubmit) {
+  auto ring = IoUring::Create();
+  ASSERT_TRUE(ring);
+
+  Pipe first;
+  Pipe second;
+  IoUringWriter first_writer{&ring.get(), first.write_fd()};
+  IoUringWriter second_writer{&ring.get(), second.write_fd()};
+  FrameWriter<IoUringWriter> first_frames{&first_writer};
+  FrameWriter<IoUringWriter> second_frames{&second_writer};
+
+  ASSERT_TRUE(first_frames.Write(std::string{"first"}));
+  ASSERT_TRUE(second_frames.Write(std::vector<int>{1, 2, 3}));
+  ASSERT_TRUE(first_writer.Submit());
+  ASSERT_TRUE(second_writer.Submit());
+
+  // Queuing frames does not make a system call; both are submitted at once.
+  EXPECT_EQ(2u, ring.get().queued());
+  auto submitted = ring.get().Submit();
+  ASSERT_TRUE(submitted);
+  EXPECT_EQ(2u, submitted.get());
+
+  ASSERT_TRUE(first_writer.Wait());
+  ASSERT_TRUE(second_writer.Wait());
+  EXPECT_EQ(0u, ring.get().in_flight());
+
+  IoUringFrameReader first_reader{&ring.get(), first.read_fd()};
+  IoUringFrameReader second_reader{&ring.get(), second.read_fd()};
+  ASSERT_TRUE(first_reader.Start());
+  ASSERT_TRUE(second_reader.Start());
+  EXPECT_EQ(2u, ring.get().queued());
+
+  std::string string_value;
+  std::vector<int> vector_value;
+  ASSERT_TRUE(first_reader.Read(&string_value));
+  ASSERT_TRUE(second_reader.Read(&vector_value));
+  EXPECT_EQ("first", string_value);
+  EXPECT_EQ((std::vector<int>{1, 2, 3}), vector_value);
+}
+
+TEST(IoUring, WholeFrames) {
+  auto ring = IoUring::Create();
+  ASSERT_TRUE(ring);
+
+  // Frames larger than the pipe buffer complete through several short reads
+  // and writes.
+  Pipe pipe;
+  IoUringFrameReader reader{&ring.get(), pipe.read_fd()};
+  IoUringWriter writer{&ring.get(), pipe.write_fd()};
+  FrameWriter<IoUringWriter> frames{&writer};
+
+  const std::vector<std::uint8_t> large(256 * 1024, 0xa5);
+  const std::string small{"small"};
+  ASSERT_TRUE(reader.Start());
+  ASSERT_TRUE(frames.Write(large));
+  ASSERT_TRUE(writer.Submit());
+  ASSERT_TRUE(frames.Write(small));
+  ASSERT_TRUE(writer.Submit());
+  EXPECT_EQ(2u, writer.pending());
+
+  std::vector<std::uint8_t> large_value;
+  ASSERT_TRUE(reader.Read(&large_value));
+  EXPECT_EQ(large, large_value);
+
+  auto frame = reader.Next();
+  ASSERT_TRUE(frame);
+  std::string small_value;
+  ASSERT_TRUE(nop::Deserializer<nop::BufferReader*>{&frame.get()}.Read(
+      &small_value));
+  EXPECT_EQ(small, small_value);
+
+  ASSERT_TRUE(writer.Wait());
+  EXPECT_EQ(0u, writer.pending());
+}
+
+TEST(IoUring, RegisteredFilesAndBuffers) {
+  auto ring = IoUring::Create();
+  ASSERT_TRUE(ring);
+
+  const int fd = MakeTempFile();
+  ASSERT_TRUE(ring.get().RegisterFiles(&fd, 1));
+
+  // Frames written at explicit offsets through the registered file.
+  {
+    IoUringWriter writer{&ring.get(), IoUringFile::Fixed(0), 0};
+    FrameWriter<IoUringWriter> frames{&writer};
+    for (int i = 0; i < 8; i++) {
+      ASSERT_TRUE(frames.Write(i));
+      ASSERT_TRUE(writer.Submit());
+    }
+    ASSERT_TRUE(writer.Wait());
+  }
+
+  IoUringFrameReader reader{&ring.get(), IoUringFile::Fixed(0), 0};
+  for (int i = 0; i < 8; i++) {
+    int value = -1;
+    ASSERT_TRUE(reader.Read(&value));
+    EXPECT_EQ(i, value);
+  }
+  int value = -1;
+  EXPECT_EQ(ErrorStatus::ReadLimitReached, reader.Read(&value).error());
+
+  // Reads into a registered buffer.
+  std::vector<std::uint8_t> buffer(64);
+  iovec iov{buffer.data(), buffer.size()};
+  ASSERT_TRUE(ring.get().RegisterBuffers(&iov, 1));
+
+  int read_result = 0;
+  nop::detail::IoUringOperation operation{
+      [](void* context, int result) { *static_cast<int*>(context) = result; },
+      &read_result};
+  ASSERT_TRUE(ring.get().QueueRead(IoUringFile::Fixed(0), buffer.data(),
+                                   buffer.size(), 0, &operation, 0));
+  ASSERT_TRUE(ring.get().Wait());
+  EXPECT_EQ(8 * 5, read_result);
+  EXPECT_EQ(1u, buffer[0]);  // Length of the first frame.
+  EXPECT_EQ(0u, buffer[4]);  // Its FIXINT payload.
+
+  ASSERT_TRUE(ring.get().UnregisterBuffers());
+  ASSERT_TRUE(ring.get().UnregisterFiles());
+  ::close(fd);
+}
+
+TEST(IoUring, Errors) {
+  auto ring = IoUring::Create();
+  ASSERT_TRUE(ring);
+
+  // Writing to the read end of a pipe fails the writer.
+  Pipe pipe;
+  {
+    IoUringWriter writer{&ring.get(), pipe.read_fd()};
+    ASSERT_TRUE(Serializer<IoUringWriter*>{&writer}.Write(1));
+    ASSERT_TRUE(writer.Submit());
+    EXPECT_EQ(ErrorStatus::IOError, writer.Wait().error());
+    ASSERT_TRUE(Serializer<IoUringWriter*>{&writer}.Write(2));
+    EXPECT_EQ(ErrorStatus::IOError, writer.Submit().error());
+  }
+
+  // Oversized frames are rejected before the payload is read.
+  {
+    IoUringFrameReader reader{&ring.get(), pipe.read_fd(), -1, 16};
+    IoUringWriter writer{&ring.get(), pipe.write_fd()};
+    FrameWriter<IoUringWriter> frames{&writer};
+    ASSERT_TRUE(frames.Write(std::string(32, 'x')));
+    ASSERT_TRUE(writer.Submit());
+    ASSERT_TRUE(writer.Wait());
+
+    std::string value;
+    EXPECT_EQ(ErrorStatus::ProtocolError, reader.Read(&value).error());
+  }
+
+  // End of file before a complete frame.
+  Pipe empty;
+  ::close(empty.fds[1]);
+  empty.fds[1] = -1;
+  IoUringFrameReader reader{&ring.get(), empty.read_fd()};
+  int value;
+  EXPECT_EQ(ErrorStatus::ReadLimitReached, reader.Read(&value).error());
+}
@@ -0,0 +1,190 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <nop/serializer.h>
+#include <nop/structure.h>
+#include <nop/traits/is_fungible.h>
+#include <nop/types/binary.h>
+#include <nop/types/lazy_array.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/pedantic_buffer_reader.h>
+#include <nop/utility/vector_writer.h>
+
+#include "test_utilities.h"
+
+using nop::Binary;
+using nop::BufferReader;
+using nop::Deserialize;
+using nop::Deserializer;
+using nop::ErrorStatus;
+using nop::IsFungible;
+using nop::LazyArray;
+using nop::PedanticBufferReader;
+using nop::Serialize;
+
+namespace {
+
+struct Order {
+  std::uint32_t id;
+  std::string symbol;
+  NOP_STRUCTURE(Order, id, symbol);
+};
+
+bool operator==(const Order& a, const Order& b) {
+  return a.id == b.id && a.symbol == b.symbol;
+}
+
+}  // anonymous namespace
+
+TEST(LazyArray, Fungible) {
+  EXPECT_TRUE((IsFungible<LazyArray<int>, std::vector<int>>::value));
+  EXPECT_TRUE((IsFungible<std::vector<Order>, LazyArray<Order>>::value));
+  EXPECT_FALSE((IsFungible<LazyArray<int>, std::vector<Order>>::value));
+}
+
+TEST(LazyArray, Integral) {
+  const std::vector<std::uint32_t> values{1, 200, 70000, 0xffffffff};
+  const auto data = Serialize(values);
+
+  LazyArray<std::uint32_t> array;
+  ASSERT_TRUE(Deserialize(data, &array));
+  ASSERT_EQ(4u, array.size());
+  EXPECT_EQ(data.data() + data.size() - array.data_size(), array.data());
+
+  std::uint32_t value = 0;
+  ASSERT_TRUE(array.Get(2, &value));
+  EXPECT_EQ(70000u, value);
+  EXPECT_EQ(ErrorStatus::ReadLimitReached, array.Get(4, &value).error());
+
+  std::vector<std::uint32_t> decoded;
+  ASSERT_TRUE(array.Decode(&decoded));
+  EXPECT_EQ(values, decoded);
+
+  // Relaying the array writes the same bytes.
+  EXPECT_EQ(data, Serialize(array));
+}
+
+TEST(LazyArray, FloatingPoint) {
+  const std::vector<float> values{1.5f, -2.0f, 3.25f};
+
+  // Both the ARY and BIN encodings support random access.
+  const Binary<std::vector<float>> binary{values};
+  for (const auto& data : {Serialize(values), Serialize(binary)}) {
+    LazyArray<float> array;
+    ASSERT_TRUE(Deserialize(data, &array));
+    ASSERT_EQ(3u, array.size());
+
+    float value = 0;
+    ASSERT_TRUE(array.Get(1, &value));
+    EXPECT_EQ(-2.0f, value);
+    ASSERT_TRUE(array.Get(2, &value));
+    EXPECT_EQ(3.25f, value);
+
+    EXPECT_EQ(data, Serialize(array));
+  }
+}
+
+TEST(LazyArray, Variable) {
+  const std::vector<Order> orders{{1, "ABC"}, {2, "DEFGHIJ"}, {3, "K"}};
+  auto data = Serialize(orders);
+  data.push_back(0x2a);
+
+  Deserializer<BufferReader> deserializer{data.data(), data.size()};
+  LazyArray<Order> array;
+  ASSERT_TRUE(deserializer.Read(&array));
+  ASSERT_EQ(3u, array.size());
+
+  // The skipped elements leave the reader at the value that follows.
+  int trailer = 0;
+  ASSERT_TRUE(deserializer.Read(&trailer));
+  EXPECT_EQ(0x2a, trailer);
+
+  // Iteration stops without decoding the remaining elements.
+  std::vector<std::uint32_t> ids;
+  ASSERT_TRUE(array.ForEach([&ids](const Order& order) {
+    ids.push_back(order.id);
+    return order.id < 2;
+  }));
+  EXPECT_EQ((std::vector<std::uint32_t>{1, 2}), ids);
+
+  auto cursor = array.begin();
+  ASSERT_TRUE(cursor.Skip());
+  Order order;
+  ASSERT_TRUE(cursor.Next(&order));
+  EXPECT_EQ(orders[1], order);
+  ASSERT_TRUE(cursor.Next(&order));
+  EXPECT_TRUE(cursor.done());
+  EXPECT_EQ(3u, cursor.index());
+  EXPECT_EQ(ErrorStatus::ReadLimitReached, cursor.Next(&order).error());
+
+  std::vector<Order> decoded;
+  ASSERT_TRUE(array.Decode(&decoded));
+  EXPECT_EQ(orders, decoded);
+
+  data.pop_back();
+  EXPECT_EQ(data, Serialize(array));
+}
+
+TEST(LazyArray, Empty) {
+  LazyArray<std::uint16_t> integers;
+  LazyArray<std::string> strings;
+  EXPECT_TRUE(integers.empty());
+
+  // Empty arrays are written in the format of the equivalent vector.
+  EXPECT_EQ(Serialize(std::vector<std::uint16_t>{}), Serialize(integers));
+  EXPECT_EQ(Serialize(std::vector<std::string>{}), Serialize(strings));
+
+  std::vector<std::string> decoded;
+  ASSERT_TRUE(Deserialize(Serialize(strings), &decoded));
+  EXPECT_TRUE(decoded.empty());
+}
+
+TEST(LazyArray, Errors) {
+  // BIN length that is not a multiple of the element size.
+  const std::vector<std::uint8_t> odd{0xbc, 0x03, 0x01, 0x02, 0x03};
+  LazyArray<std::uint16_t> integers;
+  EXPECT_EQ(ErrorStatus::InvalidContainerLength,
+            Deserialize(odd, &integers).error());
+
+  // Truncated elements of both fixed and variable size.
+  auto data = Serialize(std::vector<double>{1.0, 2.0});
+  data.pop_back();
+  LazyArray<double> doubles;
+  EXPECT_EQ(ErrorStatus::ReadLimitReached,
+            (Deserialize<LazyArray<double>, PedanticBufferReader>(data,
+                                                                  &doubles)
+                 .error()));
+
+  data = Serialize(std::vector<std::string>{"one", "two"});
+  data.pop_back();
+  LazyArray<std::string> strings;
+  EXPECT_EQ(ErrorStatus::ReadLimitReached,
+            (Deserialize<LazyArray<std::string>, PedanticBufferReader>(
+                 data, &strings)
+                 .error()));
+
+  // Element count that overflows the byte size.
+  const std::vector<std::uint8_t> huge{0xba, 0x83, 0xff, 0xff, 0xff, 0xff,
+                                       0xff, 0xff, 0xff, 0xff};
+  EXPECT_EQ(ErrorStatus::ReadLimitReached,
+            (Deserialize<LazyArray<double>, PedanticBufferReader>(huge,
+                                                                  &doubles)
+                 .error()));
+}
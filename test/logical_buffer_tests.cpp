@@ -0,0 +1,175 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <nop/serializer.h>
+#include <nop/structure.h>
+#include <nop/traits/is_fungible.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/vector_writer.h>
+
+#include "test_utilities.h"
+
+using nop::BufferReader;
+using nop::Deserialize;
+using nop::Deserializer;
+using nop::ErrorStatus;
+using nop::IsFungible;
+using nop::Serialize;
+using nop::Serializer;
+using nop::Status;
+using nop::VectorWriter;
+
+namespace {
+
+// C structure describing a frame in memory owned outside of the structure.
+struct CFrame {
+  std::uint64_t timestamp;
+  std::uint16_t* pixels;
+  std::uint32_t pixel_count;
+};
+
+// C structure that borrows the pixels from the reader.
+struct CFrameView {
+  std::uint64_t timestamp;
+  const std::uint16_t* pixels;
+  std::uint32_t pixel_count;
+};
+
+NOP_EXTERNAL_STRUCTURE(CFrame, timestamp, (pixels, pixel_count));
+NOP_EXTERNAL_STRUCTURE(CFrameView, timestamp, (pixels, pixel_count));
+
+struct Frame {
+  std::uint64_t timestamp;
+  std::vector<std::uint16_t> pixels;
+  NOP_STRUCTURE(Frame, timestamp, pixels);
+};
+
+struct ArrayFrame {
+  std::uint64_t timestamp;
+  std::uint16_t pixels[8];
+  std::uint32_t pixel_count;
+  NOP_STRUCTURE(ArrayFrame, timestamp, (pixels, pixel_count));
+};
+
+struct Labels {
+  std::string* names;
+  std::size_t count;
+  NOP_STRUCTURE(Labels, (names, count));
+};
+
+struct LabelList {
+  std::vector<std::string> names;
+  NOP_STRUCTURE(LabelList, names);
+};
+
+template <typename T>
+Status<void> Deserialize(const std::uint8_t* data, std::size_t size,
+                         T* value) {
+  Deserializer<BufferReader> deserializer{data, size};
+  return deserializer.Read(value);
+}
+
+}  // anonymous namespace
+
+TEST(LogicalBuffer, PointerFungible) {
+  EXPECT_TRUE((IsFungible<CFrame, Frame>::value));
+  EXPECT_TRUE((IsFungible<CFrameView, CFrame>::value));
+  EXPECT_TRUE((IsFungible<ArrayFrame, CFrameView>::value));
+  EXPECT_FALSE((IsFungible<Labels, CFrame>::value));
+}
+
+TEST(LogicalBuffer, PointerWrite) {
+  std::uint16_t pixels[] = {1, 2, 3, 0xffff};
+  const CFrame frame{42, pixels, 4};
+
+  // Pointer buffers have the same format as arrays and vectors.
+  const Frame expected{42, {1, 2, 3, 0xffff}};
+  EXPECT_EQ(Serialize(expected), Serialize(frame));
+
+  std::string names[] = {"red", "green"};
+  const Labels labels{names, 2};
+  LabelList decoded;
+  ASSERT_TRUE(Deserialize(Serialize(labels), &decoded));
+  EXPECT_EQ((std::vector<std::string>{"red", "green"}), decoded.names);
+
+  // A null pointer may only describe an empty buffer.
+  const CFrame invalid{42, nullptr, 1};
+  Serializer<VectorWriter> serializer;
+  EXPECT_EQ(ErrorStatus::InvalidContainerLength,
+            serializer.Write(invalid).error());
+}
+
+TEST(LogicalBuffer, PointerReadIntoDestination) {
+  const auto data = Serialize(Frame{7, {10, 20, 30}});
+
+  // Elements are decoded directly into the destination, whose capacity is
+  // given by the size member.
+  std::array<std::uint16_t, 4> destination{};
+  CFrame frame{0, destination.data(), 4};
+  ASSERT_TRUE(Deserialize(data, &frame));
+  EXPECT_EQ(7u, frame.timestamp);
+  EXPECT_EQ(destination.data(), frame.pixels);
+  EXPECT_EQ(3u, frame.pixel_count);
+  EXPECT_EQ((std::array<std::uint16_t, 4>{{10, 20, 30, 0}}), destination);
+
+  frame.pixel_count = 2;
+  EXPECT_EQ(ErrorStatus::InvalidContainerLength,
+            Deserialize(data, &frame).error());
+
+  std::string names[3];
+  Labels labels{names, 3};
+  ASSERT_TRUE(Deserialize(Serialize(LabelList{{"a", "b"}}), &labels));
+  EXPECT_EQ(2u, labels.count);
+  EXPECT_EQ("b", names[1]);
+
+  Labels empty{nullptr, 0};
+  EXPECT_EQ(ErrorStatus::InvalidContainerLength,
+            Deserialize(Serialize(LabelList{{"a"}}), &empty).error());
+}
+
+TEST(LogicalBuffer, PointerBorrow) {
+  const auto encoded = Serialize(Frame{7, {10, 20, 30}});
+  std::vector<std::uint64_t> storage(encoded.size() / 8 + 2);
+  auto* aligned = reinterpret_cast<std::uint8_t*>(storage.data());
+
+  // The pixels are the last six bytes of the encoding. Shift the copy so that
+  // they start on a two-byte boundary.
+  const std::size_t payload_offset = encoded.size() - 6;
+  const std::size_t shift = payload_offset % 2;
+  std::copy(encoded.begin(), encoded.end(), aligned + shift);
+
+  CFrameView view{0, nullptr, 0};
+  ASSERT_TRUE(Deserialize(aligned + shift, encoded.size(), &view));
+  EXPECT_EQ(7u, view.timestamp);
+  EXPECT_EQ(3u, view.pixel_count);
+  EXPECT_EQ(reinterpret_cast<const std::uint16_t*>(aligned + shift +
+                                                   payload_offset),
+            view.pixels);
+  EXPECT_EQ(30u, view.pixels[2]);
+
+  // Relaying the view writes the same bytes.
+  EXPECT_EQ(encoded, Serialize(view));
+
+  // Misaligned elements cannot be borrowed.
+  std::copy(encoded.begin(), encoded.end(), aligned + shift + 1);
+  EXPECT_EQ(ErrorStatus::InvalidBufferAlignment,
+            Deserialize(aligned + shift + 1, encoded.size(), &view).error());
+}
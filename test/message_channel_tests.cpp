@@ -0,0 +1,120 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <nop/serializer.h>
+#include <nop/structure.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/message_channel.h>
+#include <nop/utility/vector_writer.h>
+
+using nop::BufferReader;
+using nop::Deserializer;
+using nop::ErrorStatus;
+using nop::MessageChannel;
+using nop::VectorWriter;
+
+namespace {
+
+struct Message {
+  std::uint32_t producer;
+  std::uint32_t sequence;
+  std::string payload;
+  NOP_STRUCTURE(Message, producer, sequence, payload);
+};
+
+}  // anonymous namespace
+
+TEST(MessageChannel, Flush) {
+  MessageChannel<VectorWriter> channel;
+
+  auto status = channel.Flush();
+  ASSERT_TRUE(status);
+  EXPECT_EQ(0u, status.get());
+
+  ASSERT_TRUE(channel.Send(Message{0, 1, "one"}));
+  ASSERT_TRUE(channel.Send(Message{0, 2, "two"}));
+  status = channel.Flush();
+  ASSERT_TRUE(status);
+  EXPECT_EQ(2u, status.get());
+
+  // Frames are written in the order they were sent.
+  Deserializer<BufferReader> deserializer{channel.writer().data(),
+                                          channel.writer().size()};
+  Message message;
+  ASSERT_TRUE(deserializer.Read(&message));
+  EXPECT_EQ(1u, message.sequence);
+  EXPECT_EQ("one", message.payload);
+  ASSERT_TRUE(deserializer.Read(&message));
+  EXPECT_EQ(2u, message.sequence);
+  EXPECT_EQ("two", message.payload);
+
+  channel.Close();
+  EXPECT_TRUE(channel.is_closed());
+  EXPECT_EQ(ErrorStatus::WriteLimitReached,
+            channel.Send(Message{0, 3, "three"}).error());
+}
+
+TEST(MessageChannel, Producers) {
+  const std::uint32_t kProducers = 4;
+  const std::uint32_t kCount = 2000;
+  MessageChannel<VectorWriter> channel;
+
+  std::thread consumer{[&channel] {
+    while (true) {
+      auto status = channel.Drain();
+      ASSERT_TRUE(status);
+      if (status.get() == 0)
+        break;
+    }
+  }};
+
+  std::vector<std::thread> producers;
+  for (std::uint32_t i = 0; i < kProducers; i++) {
+    producers.emplace_back([&channel, i, kCount] {
+      for (std::uint32_t j = 0; j < kCount; j++) {
+        ASSERT_TRUE(
+            channel.Send(Message{i, j, std::string(j % 32, 'a' + i)}));
+      }
+    });
+  }
+  for (auto& producer : producers)
+    producer.join();
+
+  channel.Close();
+  consumer.join();
+
+  // Every message arrives intact, and the messages of each producer arrive in
+  // the order they were sent.
+  Deserializer<BufferReader> deserializer{channel.writer().data(),
+                                          channel.writer().size()};
+  std::vector<std::uint32_t> next(kProducers, 0);
+  for (std::uint32_t i = 0; i < kProducers * kCount; i++) {
+    Message message;
+    ASSERT_TRUE(deserializer.Read(&message));
+    ASSERT_LT(message.producer, kProducers);
+    EXPECT_EQ(next[message.producer], message.sequence);
+    EXPECT_EQ(std::string(message.sequence % 32, 'a' + message.producer),
+              message.payload);
+    next[message.producer] = message.sequence + 1;
+  }
+  EXPECT_TRUE(deserializer.reader().empty());
+  EXPECT_EQ(std::vector<std::uint32_t>(kProducers, kCount), next);
+}
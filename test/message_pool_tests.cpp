@@ -0,0 +1,161 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <nop/serializer.h>
+#include <nop/structure.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/message_pool.h>
+#include <nop/utility/pedantic_buffer_reader.h>
+#include <nop/utility/reuse_storage.h>
+#include <nop/utility/vector_writer.h>
+
+using nop::BufferReader;
+using nop::Deserializer;
+using nop::ErrorStatus;
+using nop::MessagePool;
+using nop::ReuseStorage;
+using nop::Serializer;
+using nop::VectorWriter;
+
+namespace {
+
+struct Order {
+  std::string symbol;
+  std::vector<std::uint32_t> quantities;
+  NOP_STRUCTURE(Order, symbol, quantities);
+};
+
+std::vector<std::uint8_t> Serialize(const Order& order) {
+  Serializer<VectorWriter> serializer;
+  EXPECT_TRUE(serializer.Write(order));
+  return serializer.writer().Take();
+}
+
+// Runs |op| on a new thread, which has its own empty thread pools.
+template <typename Op>
+void RunOnThread(Op op) {
+  std::thread thread{op};
+  thread.join();
+}
+
+}  // anonymous namespace
+
+TEST(MessagePool, Reuse) {
+  MessagePool<Order> pool;
+  EXPECT_EQ(0u, pool.size());
+
+  const Order* message;
+  {
+    auto handle = pool.Acquire();
+    ASSERT_TRUE(handle);
+    message = handle.get();
+    handle->quantities.resize(100);
+  }
+  EXPECT_EQ(1u, pool.size());
+
+  // Messages are returned as they are, with their capacity.
+  auto handle = pool.Acquire();
+  EXPECT_EQ(0u, pool.size());
+  EXPECT_EQ(message, handle.get());
+  EXPECT_EQ(100u, handle->quantities.size());
+
+  auto moved = std::move(handle);
+  EXPECT_FALSE(handle);
+  EXPECT_EQ(message, moved.get());
+  moved.reset();
+  EXPECT_FALSE(moved);
+  EXPECT_EQ(1u, pool.size());
+}
+
+TEST(MessagePool, Read) {
+  const Order order{"NOP", std::vector<std::uint32_t>(64, 100)};
+  const auto data = Serialize(order);
+
+  MessagePool<Order> pool;
+  const std::uint32_t* quantities;
+  {
+    Deserializer<ReuseStorage<BufferReader>> deserializer{data.data(),
+                                                          data.size()};
+    auto message = pool.Read(&deserializer);
+    ASSERT_TRUE(message);
+    EXPECT_EQ(order.symbol, message.get()->symbol);
+    EXPECT_EQ(order.quantities, message.get()->quantities);
+    quantities = message.get()->quantities.data();
+  }
+
+  // Decoding into the returned message reuses its storage.
+  {
+    Deserializer<ReuseStorage<BufferReader>> deserializer{data.data(),
+                                                          data.size()};
+    auto message = pool.Read(&deserializer);
+    ASSERT_TRUE(message);
+    EXPECT_EQ(quantities, message.get()->quantities.data());
+    EXPECT_EQ(order.quantities, message.get()->quantities);
+  }
+
+  // Messages that fail to decode are returned to the pool.
+  const std::vector<std::uint8_t> truncated{data.begin(), data.begin() + 4};
+  nop::PedanticBufferReader reader{truncated.data(), truncated.size()};
+  Deserializer<nop::PedanticBufferReader*> deserializer{&reader};
+  EXPECT_EQ(ErrorStatus::ReadLimitReached,
+            pool.Read(&deserializer).error());
+  EXPECT_EQ(1u, pool.size());
+}
+
+TEST(MessagePool, Limits) {
+  MessagePool<Order> pool{2};
+  pool.Reserve(4);
+  EXPECT_EQ(2u, pool.size());
+
+  {
+    auto first = pool.Acquire();
+    auto second = pool.Acquire();
+    auto third = pool.Acquire();
+    EXPECT_EQ(0u, pool.size());
+  }
+  EXPECT_EQ(2u, pool.size());
+
+  pool.SetMaxIdle(1);
+  EXPECT_EQ(1u, pool.size());
+  pool.Clear();
+  EXPECT_EQ(0u, pool.size());
+}
+
+TEST(MessagePool, Local) {
+  RunOnThread([] {
+    MessagePool<Order>& pool = MessagePool<Order>::Local();
+    EXPECT_EQ(&pool, &MessagePool<Order>::Local());
+    EXPECT_EQ(0u, pool.size());
+
+    auto handle = pool.Acquire();
+
+    // Messages released on another thread return to the pool of that thread.
+    RunOnThread([&handle] {
+      handle.reset();
+      EXPECT_EQ(1u, MessagePool<Order>::Local().size());
+    });
+    EXPECT_EQ(0u, pool.size());
+
+    handle = pool.Acquire();
+    handle.reset();
+    EXPECT_EQ(1u, pool.size());
+  });
+}
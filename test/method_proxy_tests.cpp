@@ -0,0 +1,216 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <nop/rpc/interface.h>
+#include <nop/rpc/method_proxy.h>
+#include <nop/rpc/simple_method_receiver.h>
+#include <nop/rpc/simple_method_sender.h>
+#include <nop/serializer.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/fd_reader.h>
+#include <nop/utility/fd_writer.h>
+#include <nop/utility/vector_writer.h>
+
+using nop::BindInterface;
+using nop::BufferReader;
+using nop::Deserializer;
+using nop::ErrorStatus;
+using nop::FdReader;
+using nop::FdWriter;
+using nop::Interface;
+using nop::InterfaceType;
+using nop::MethodProxy;
+using nop::Serializer;
+using nop::Status;
+using nop::VectorWriter;
+
+namespace {
+
+struct Store : Interface<Store> {
+  NOP_INTERFACE("io.github.eieio.test.Store");
+  NOP_METHOD(Put, std::size_t(const std::string& key,
+                              const std::vector<std::uint8_t>& value));
+  NOP_METHOD(Get, std::vector<std::uint8_t>(const std::string& key));
+  NOP_INTERFACE_API(Put, Get);
+};
+
+using MethodSelector = InterfaceType<Store>::MethodSelector;
+using FdSerializer = Serializer<FdWriter>;
+using FdDeserializer = Deserializer<FdReader>;
+
+// Pair of pipes connecting the two ends of a channel.
+struct Channel {
+  Channel() {
+    int request_pipe[2], reply_pipe[2];
+    EXPECT_EQ(0, ::pipe(request_pipe));
+    EXPECT_EQ(0, ::pipe(reply_pipe));
+    client_serializer = FdSerializer{request_pipe[1]};
+    client_deserializer = FdDeserializer{reply_pipe[0]};
+    server_serializer = FdSerializer{reply_pipe[1]};
+    server_deserializer = FdDeserializer{request_pipe[0]};
+  }
+
+  FdSerializer client_serializer;
+  FdDeserializer client_deserializer;
+  FdSerializer server_serializer;
+  FdDeserializer server_deserializer;
+};
+
+// Serves the Store interface on a channel until the channel is closed,
+// counting the calls.
+void ServeBackend(Channel* channel, int* calls) {
+  auto dispatcher = BindInterface(
+      Store::Put::Bind([calls](const std::string& key,
+                               const std::vector<std::uint8_t>& value) {
+        ++*calls;
+        return key.size() + value.size();
+      }),
+      Store::Get::Bind([calls](const std::string& key) {
+        ++*calls;
+        return std::vector<std::uint8_t>(key.begin(), key.end());
+      }));
+
+  auto receiver = MakeSimpleMethodReceiver(&channel->server_serializer,
+                                           &channel->server_deserializer);
+  while (dispatcher(&receiver)) {
+  }
+}
+
+}  // anonymous namespace
+
+TEST(MethodProxy, Forward) {
+  Channel client_channel;
+  Channel put_channel;
+  Channel get_channel;
+
+  int put_calls = 0;
+  int get_calls = 0;
+  std::thread put_backend{[&] { ServeBackend(&put_channel, &put_calls); }};
+  std::thread get_backend{[&] { ServeBackend(&get_channel, &get_calls); }};
+
+  // Route each call to a backend by its selector alone.
+  std::thread proxy_thread{[&] {
+    MethodProxy<FdSerializer, FdDeserializer> proxy{
+        &client_channel.server_serializer,
+        &client_channel.server_deserializer};
+
+    MethodSelector method_selector;
+    while (proxy.GetMethodSelector(&method_selector)) {
+      Channel* backend = method_selector == Store::Put::Selector
+                             ? &put_channel
+                             : &get_channel;
+      ASSERT_TRUE(proxy.Forward(method_selector, &backend->client_serializer,
+                                &backend->client_deserializer));
+    }
+
+    // Closing the backend channels stops the backends.
+    put_channel.client_serializer = FdSerializer{};
+    get_channel.client_serializer = FdSerializer{};
+  }};
+
+  {
+    auto sender = MakeSimpleMethodSender(&client_channel.client_serializer,
+                                         &client_channel.client_deserializer);
+
+    const std::vector<std::uint8_t> value(64 * 1024, 0xa5);
+    Status<std::size_t> put_status = Store::Put::Invoke(&sender, "key", value);
+    ASSERT_TRUE(put_status);
+    EXPECT_EQ(3u + value.size(), put_status.get());
+
+    Status<std::vector<std::uint8_t>> get_status =
+        Store::Get::Invoke(&sender, "abc");
+    ASSERT_TRUE(get_status);
+    EXPECT_EQ((std::vector<std::uint8_t>{'a', 'b', 'c'}), get_status.get());
+
+    put_status = Store::Put::Invoke(&sender, "", std::vector<std::uint8_t>{});
+    ASSERT_TRUE(put_status);
+    EXPECT_EQ(0u, put_status.get());
+  }
+
+  client_channel.client_serializer = FdSerializer{};
+  proxy_thread.join();
+  put_backend.join();
+  get_backend.join();
+  EXPECT_EQ(2, put_calls);
+  EXPECT_EQ(1, get_calls);
+}
+
+TEST(MethodProxy, Errors) {
+  VectorWriter request;
+  Serializer<VectorWriter*> request_serializer{&request};
+  ASSERT_TRUE(request_serializer.Write(Store::Put::Selector));
+  ASSERT_TRUE(request_serializer.Write(
+      std::make_tuple(std::string{"key"}, std::vector<std::uint8_t>(64))));
+
+  // The arguments are relayed byte for byte.
+  {
+    Deserializer<BufferReader> deserializer{request.data(), request.size()};
+    Serializer<VectorWriter> serializer;
+    MethodProxy<Serializer<VectorWriter>, Deserializer<BufferReader>> proxy{
+        &serializer, &deserializer};
+
+    MethodSelector method_selector;
+    ASSERT_TRUE(proxy.GetMethodSelector(&method_selector));
+    EXPECT_EQ(Store::Put::Selector, method_selector);
+
+    Serializer<VectorWriter> backend_serializer;
+    ASSERT_TRUE(proxy.ForwardArgs(method_selector, &backend_serializer));
+    const VectorWriter& forwarded = backend_serializer.writer();
+    EXPECT_EQ(std::vector<std::uint8_t>(request.data(),
+                                        request.data() + request.size()),
+              std::vector<std::uint8_t>(forwarded.data(),
+                                        forwarded.data() + forwarded.size()));
+  }
+
+  // Arguments larger than the limit are not relayed.
+  {
+    Deserializer<BufferReader> deserializer{request.data(), request.size()};
+    Serializer<VectorWriter> serializer;
+    MethodProxy<Serializer<VectorWriter>, Deserializer<BufferReader>> proxy{
+        &serializer, &deserializer, 32};
+
+    MethodSelector method_selector;
+    ASSERT_TRUE(proxy.GetMethodSelector(&method_selector));
+
+    Serializer<VectorWriter> backend_serializer;
+    auto status = proxy.ForwardArgs(method_selector, &backend_serializer);
+    ASSERT_FALSE(status);
+    EXPECT_EQ(ErrorStatus::ReadLimitReached, status.error());
+    EXPECT_EQ(0u, backend_serializer.writer().size());
+  }
+
+  // Truncated arguments are not relayed.
+  {
+    Deserializer<BufferReader> deserializer{request.data(),
+                                            request.size() - 1};
+    Serializer<VectorWriter> serializer;
+    MethodProxy<Serializer<VectorWriter>, Deserializer<BufferReader>> proxy{
+        &serializer, &deserializer};
+
+    MethodSelector method_selector;
+    ASSERT_TRUE(proxy.GetMethodSelector(&method_selector));
+
+    Serializer<VectorWriter> backend_serializer;
+    EXPECT_FALSE(proxy.ForwardArgs(method_selector, &backend_serializer));
+    EXPECT_EQ(0u, backend_serializer.writer().size());
+  }
+}
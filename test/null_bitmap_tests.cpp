@@ -0,0 +1,176 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <nop/base/skip.h>
+#include <nop/serializer.h>
+#include <nop/types/null_bitmap.h>
+#include <nop/types/optional.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/pedantic_buffer_reader.h>
+#include <nop/utility/vector_writer.h>
+
+#include "test_utilities.h"
+
+using nop::Compose;
+using nop::Deserialize;
+using nop::EncodingByte;
+using nop::ErrorStatus;
+using nop::NullBitmap;
+using nop::Optional;
+using nop::Serialize;
+using nop::SkipValue;
+
+namespace {
+
+enum class Level : std::int16_t { Low = -1, Mid = 0, High = 300 };
+
+// Returns |count| optionals of which about |percent| are present, with values
+// returned by |make(index)|.
+template <typename T, typename Make>
+std::vector<Optional<T>> MakeOptionals(std::size_t count, unsigned percent,
+                                       Make make) {
+  std::mt19937 random{static_cast<std::mt19937::result_type>(count + percent)};
+  std::vector<Optional<T>> values(count);
+  for (std::size_t i = 0; i < count; i++) {
+    if (random() % 100 < percent)
+      values[i] = make(i);
+  }
+  return values;
+}
+
+template <typename T>
+void ExpectRoundTrip(const std::vector<Optional<T>>& values) {
+  const auto data = Serialize(NullBitmap<std::vector<Optional<T>>>{values});
+
+  // Decoding replaces the previous contents.
+  NullBitmap<std::vector<Optional<T>>> decoded{
+      std::vector<Optional<T>>(5, T{})};
+  ASSERT_TRUE(Deserialize(data, &decoded));
+  EXPECT_EQ(values, decoded.get());
+
+  nop::BufferReader reader{data.data(), data.size()};
+  EXPECT_TRUE(SkipValue(&reader));
+  EXPECT_EQ(0u, reader.remaining());
+}
+
+}  // anonymous namespace
+
+TEST(NullBitmap, RoundTrip) {
+  for (std::size_t count : {0, 1, 7, 63, 64, 65, 300, 1000}) {
+    for (unsigned percent : {0, 3, 50, 100}) {
+      SCOPED_TRACE(::testing::Message() << count << " " << percent);
+      ExpectRoundTrip(MakeOptionals<std::uint8_t>(
+          count, percent, [](std::size_t i) { return i % 251; }));
+      ExpectRoundTrip(MakeOptionals<std::int32_t>(
+          count, percent, [](std::size_t i) { return -70000 * int(i); }));
+      ExpectRoundTrip(MakeOptionals<double>(
+          count, percent, [](std::size_t i) { return i * 0.25; }));
+      ExpectRoundTrip(MakeOptionals<Level>(count, percent, [](std::size_t i) {
+        return i % 2 ? Level::Low : Level::High;
+      }));
+      ExpectRoundTrip(MakeOptionals<std::string>(
+          count, percent, [](std::size_t i) { return std::to_string(i); }));
+    }
+  }
+}
+
+TEST(NullBitmap, Format) {
+  // STC, two members: the bits 0b101 of three elements, then the two present
+  // values packed as BIN.
+  const std::vector<Optional<std::uint16_t>> numbers{5, {}, 7};
+  EXPECT_EQ(Compose(EncodingByte::Structure, 2, EncodingByte::Binary, 2, 3,
+                    0x05, EncodingByte::Binary, 4, 5, 0, 7, 0),
+            Serialize(NullBitmap<std::vector<Optional<std::uint16_t>>>{
+                numbers}));
+
+  // Other values are encoded as an array.
+  const std::vector<Optional<std::string>> strings{{}, std::string{"a"}};
+  EXPECT_EQ(Compose(EncodingByte::Structure, 2, EncodingByte::Binary, 2, 2,
+                    0x02, EncodingByte::Array, 1, EncodingByte::String, 1,
+                    "a"),
+            Serialize(NullBitmap<std::vector<Optional<std::string>>>{
+                strings}));
+
+  // Mostly missing numerics shrink to about a bit per element.
+  const auto features = MakeOptionals<float>(
+      10000, 2, [](std::size_t i) { return i * 0.5f; });
+  const auto bitmap =
+      Serialize(NullBitmap<std::vector<Optional<float>>>{features});
+  EXPECT_LT(bitmap.size() * 4, Serialize(features).size());
+  EXPECT_GT(10000u / 8 + 300 * sizeof(float), bitmap.size());
+}
+
+TEST(NullBitmap, Errors) {
+  NullBitmap<std::vector<Optional<std::uint16_t>>> value;
+
+  // The wrong number of members.
+  EXPECT_EQ(ErrorStatus::InvalidMemberCount,
+            Deserialize(Compose(EncodingByte::Structure, 1,
+                                EncodingByte::Binary, 2, 1, 0x01),
+                        &value)
+                .error());
+
+  // A bitmap that is not BIN.
+  EXPECT_EQ(ErrorStatus::UnexpectedEncodingType,
+            Deserialize(Compose(EncodingByte::Structure, 2,
+                                EncodingByte::Array, 0, EncodingByte::Binary,
+                                0),
+                        &value)
+                .error());
+
+  // Values that do not match the number of present elements.
+  EXPECT_EQ(ErrorStatus::InvalidContainerLength,
+            Deserialize(Compose(EncodingByte::Structure, 2,
+                                EncodingByte::Binary, 2, 2, 0x03,
+                                EncodingByte::Binary, 2, 5, 0),
+                        &value)
+                .error());
+
+  // Unpacked values that are not an array, or of the wrong length.
+  NullBitmap<std::vector<Optional<std::string>>> strings;
+  EXPECT_EQ(ErrorStatus::UnexpectedEncodingType,
+            Deserialize(Compose(EncodingByte::Structure, 2,
+                                EncodingByte::Binary, 2, 1, 0x00,
+                                EncodingByte::Binary, 0),
+                        &strings)
+                .error());
+  EXPECT_EQ(ErrorStatus::InvalidContainerLength,
+            Deserialize(Compose(EncodingByte::Structure, 2,
+                                EncodingByte::Binary, 2, 1, 0x00,
+                                EncodingByte::Array, 1, EncodingByte::String,
+                                0),
+                        &strings)
+                .error());
+
+  // A vector larger than the limit, which is finite by default.
+  EXPECT_EQ(NullBitmap<std::vector<Optional<std::uint16_t>>>::kDefaultMaxSize,
+            value.max_size());
+  const auto data = Serialize(NullBitmap<std::vector<Optional<std::uint16_t>>>{
+      std::vector<Optional<std::uint16_t>>(1000)});
+  value.set_max_size(999);
+  EXPECT_EQ(ErrorStatus::InvalidContainerLength,
+            Deserialize(data, &value).error());
+  value.set_max_size(1000);
+  EXPECT_TRUE(Deserialize(data, &value));
+  EXPECT_EQ(1000u, value->size());
+
+  EXPECT_EQ(ErrorStatus::UnexpectedEncodingType,
+            Deserialize(Serialize(std::string{"a"}), &value).error());
+}
@@ -0,0 +1,143 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <nop/base/skip.h>
+#include <nop/serializer.h>
+#include <nop/types/packed.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/pedantic_buffer_reader.h>
+#include <nop/utility/vector_writer.h>
+
+#include "test_utilities.h"
+
+using nop::Deserialize;
+using nop::ErrorStatus;
+using nop::Packed;
+using nop::Serialize;
+using nop::SkipValue;
+
+namespace {
+
+template <typename T>
+void ExpectRoundTrip(const std::vector<T>& values) {
+  const auto data = Serialize(Packed<std::vector<T>>{values});
+  Packed<std::vector<T>> decoded{std::vector<T>(5, 1)};
+  ASSERT_TRUE(Deserialize(data, &decoded));
+  EXPECT_EQ(values, decoded.get());
+
+  nop::BufferReader reader{data.data(), data.size()};
+  EXPECT_TRUE(SkipValue(&reader));
+  EXPECT_EQ(0u, reader.remaining());
+}
+
+}  // anonymous namespace
+
+TEST(Packed, RoundTrip) {
+  std::mt19937_64 random{42};
+
+  for (std::size_t count : {0u, 1u, 127u, 128u, 129u, 1000u}) {
+    std::vector<std::uint64_t> sorted;
+    std::vector<std::int64_t> noisy;
+    std::vector<std::uint64_t> uniform;
+    std::vector<std::int8_t> bytes;
+    std::vector<std::uint16_t> shorts;
+    std::uint64_t id = 1000000;
+    for (std::size_t i = 0; i < count; i++) {
+      id += random() % 16;
+      sorted.push_back(id);
+      noisy.push_back(static_cast<std::int64_t>(random() % 2001) - 1000);
+      uniform.push_back(random());
+      bytes.push_back(static_cast<std::int8_t>(random()));
+      shorts.push_back(static_cast<std::uint16_t>(random()));
+    }
+
+    ExpectRoundTrip(sorted);
+    ExpectRoundTrip(noisy);
+    ExpectRoundTrip(uniform);
+    ExpectRoundTrip(bytes);
+    ExpectRoundTrip(shorts);
+  }
+
+  // Extremes wrap in the width of the element type.
+  ExpectRoundTrip(std::vector<std::int64_t>{
+      0, std::numeric_limits<std::int64_t>::max(),
+      std::numeric_limits<std::int64_t>::min(), -1, 1,
+      std::numeric_limits<std::int64_t>::min()});
+  ExpectRoundTrip(std::vector<std::uint32_t>{
+      0xffffffffu, 0, 0xffffffffu, 0x80000000u, 7, 7, 7});
+  ExpectRoundTrip(std::vector<std::uint64_t>(300, 0xffffffffffffffffu));
+}
+
+TEST(Packed, Size) {
+  // Sorted ids with small gaps pack to a few bits per element.
+  std::vector<std::uint64_t> ids;
+  for (std::uint64_t i = 0; i < 10000; i++)
+    ids.push_back(0x123456789000 + i * 3);
+
+  const auto packed = Serialize(Packed<std::vector<std::uint64_t>>{ids});
+  const auto plain = Serialize(ids);
+  EXPECT_LT(packed.size() * 8, plain.size());
+
+  // Constant sequences pack to one byte per block.
+  const std::vector<std::uint32_t> constant(1280, 0);
+  EXPECT_EQ(1u + 1u + 1u + 2u + 10u,
+            Serialize(Packed<std::vector<std::uint32_t>>{constant}).size());
+}
+
+TEST(Packed, Errors) {
+  Packed<std::vector<std::uint32_t>> value;
+
+  // BIN, L = 3, N = 2, one block of width 65.
+  EXPECT_EQ(ErrorStatus::InvalidContainerLength,
+            Deserialize(std::vector<std::uint8_t>{0xbc, 0x03, 0x02, 0x41, 0x00},
+                        &value)
+                .error());
+
+  // More elements than the payload could hold.
+  EXPECT_EQ(ErrorStatus::InvalidContainerLength,
+            Deserialize(std::vector<std::uint8_t>{0xbc, 0x03, 0x80, 0xff, 0x00},
+                        &value)
+                .error());
+
+  // A block that extends beyond the payload.
+  EXPECT_EQ(ErrorStatus::InvalidContainerLength,
+            Deserialize(std::vector<std::uint8_t>{0xbc, 0x03, 0x02, 0x08, 0x01,
+                                                  0x02},
+                        &value)
+                .error());
+
+  // A payload with extra bytes after the last block.
+  EXPECT_EQ(ErrorStatus::InvalidContainerLength,
+            Deserialize(std::vector<std::uint8_t>{0xbc, 0x04, 0x01, 0x01, 0x01,
+                                                  0x00},
+                        &value)
+                .error());
+
+  // A length beyond the end of the input.
+  EXPECT_EQ(ErrorStatus::ReadLimitReached,
+            Deserialize(std::vector<std::uint8_t>{0xbc, 0x10, 0x01}, &value)
+                .error());
+
+  EXPECT_EQ(ErrorStatus::UnexpectedEncodingType,
+            Deserialize(Serialize(std::vector<std::string>{"a"}), &value)
+                .error());
+}
@@ -0,0 +1,225 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include <gtest/gtest.h>
+#include <sched.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <nop/serializer.h>
+#include <nop/structure.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/page_buffer.h>
+#include <nop/utility/page_writer.h>
+#include <nop/utility/vector_writer.h>
+
+using nop::BufferReader;
+using nop::Deserializer;
+using nop::PageBuffer;
+using nop::PageBufferOptions;
+using nop::PageBufferPool;
+using nop::PageWriter;
+using nop::Serializer;
+using nop::VectorWriter;
+
+namespace {
+
+struct Snapshot {
+  std::uint64_t version;
+  std::vector<std::string> names;
+  std::vector<std::uint32_t> values;
+  NOP_STRUCTURE(Snapshot, version, names, values);
+};
+
+Snapshot MakeSnapshot(std::size_t count) {
+  Snapshot snapshot{count, {}, {}};
+  for (std::size_t i = 0; i < count; i++) {
+    snapshot.names.push_back("name" + std::to_string(i));
+    snapshot.values.push_back(static_cast<std::uint32_t>(i * 7));
+  }
+  return snapshot;
+}
+
+std::vector<std::uint8_t> Encode(const Snapshot& snapshot) {
+  Serializer<VectorWriter> serializer;
+  EXPECT_TRUE(serializer.Write(snapshot));
+  return serializer.writer().Take();
+}
+
+// Pins the calling thread to the CPU it is running on for the lifetime of the
+// object.
+class PinToCurrentCpu {
+ public:
+  PinToCurrentCpu() {
+    ::sched_getaffinity(0, sizeof(saved_), &saved_);
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(::sched_getcpu(), &set);
+    ::sched_setaffinity(0, sizeof(set), &set);
+  }
+  ~PinToCurrentCpu() { ::sched_setaffinity(0, sizeof(saved_), &saved_); }
+
+ private:
+  cpu_set_t saved_;
+};
+
+}  // anonymous namespace
+
+TEST(PageBuffer, Allocate) {
+  const std::size_t page_size = ::sysconf(_SC_PAGESIZE);
+
+  auto status = PageBuffer::Allocate(1);
+  ASSERT_TRUE(status);
+  PageBuffer buffer = status.take();
+  EXPECT_EQ(page_size, buffer.size());
+  EXPECT_FALSE(buffer.huge());
+  EXPECT_EQ(-1, buffer.node());
+
+  // The memory is zero-filled and writable.
+  EXPECT_EQ(0u, buffer.data()[page_size - 1]);
+  buffer.data()[page_size - 1] = 0xff;
+
+  PageBuffer moved{std::move(buffer)};
+  EXPECT_TRUE(buffer.empty());
+  EXPECT_EQ(0xff, moved.data()[page_size - 1]);
+
+  moved.Clear();
+  EXPECT_TRUE(moved.empty());
+  EXPECT_EQ(nullptr, moved.data());
+}
+
+TEST(PageBuffer, Options) {
+  // Huge pages and NUMA placement are best effort, so the buffer is always
+  // allocated even when the system has no huge pages reserved.
+  PageBufferOptions options;
+  options.huge_pages = true;
+  options.local_node = true;
+
+  auto status = PageBuffer::Allocate(4096, options);
+  ASSERT_TRUE(status);
+  EXPECT_EQ(std::size_t{2} << 20, status.get().size());
+  EXPECT_GE(status.get().node(), -1);
+  status.get().data()[status.get().size() - 1] = 1;
+}
+
+TEST(PageBufferPool, Reuse) {
+  // Stay on one core so that the buffers come from the same cache.
+  PinToCurrentCpu pin;
+
+  PageBufferPool pool{{}, 2};
+  EXPECT_EQ(0u, pool.size());
+
+  auto status = pool.Acquire(10000);
+  ASSERT_TRUE(status);
+  const std::uint8_t* data = status.get().data();
+  pool.Release(status.take());
+  EXPECT_EQ(1u, pool.size());
+
+  // Smaller requests reuse the cached buffer; larger ones allocate.
+  status = pool.Acquire(5000);
+  ASSERT_TRUE(status);
+  EXPECT_EQ(data, status.get().data());
+
+  auto large = pool.Acquire(1 << 20);
+  ASSERT_TRUE(large);
+  EXPECT_LE(std::size_t{1} << 20, large.get().size());
+
+  // Each core retains a bounded number of buffers.
+  auto extra = pool.Acquire(100);
+  ASSERT_TRUE(extra);
+  pool.Release(status.take());
+  pool.Release(large.take());
+  pool.Release(extra.take());
+  EXPECT_GE(2u, pool.size());
+
+  pool.Clear();
+  EXPECT_EQ(0u, pool.size());
+}
+
+TEST(PageWriter, Write) {
+  const Snapshot snapshot = MakeSnapshot(10000);
+
+  Serializer<PageWriter> serializer;
+  ASSERT_TRUE(serializer.Write(snapshot));
+  EXPECT_LE(serializer.writer().size(), serializer.writer().capacity());
+
+  const auto expected = Encode(snapshot);
+  const auto& writer = serializer.writer();
+  ASSERT_EQ(expected.size(), writer.size());
+  EXPECT_EQ(expected,
+            std::vector<std::uint8_t>(writer.data(),
+                                      writer.data() + writer.size()));
+
+  Snapshot decoded;
+  Deserializer<BufferReader> deserializer{writer.data(), writer.size()};
+  ASSERT_TRUE(deserializer.Read(&decoded));
+  EXPECT_EQ(snapshot.names, decoded.names);
+}
+
+TEST(PageWriter, Grow) {
+  PageWriter writer;
+  std::vector<std::uint8_t> expected;
+  for (int i = 0; i < 20000; i++) {
+    const std::uint8_t byte = static_cast<std::uint8_t>(i);
+    ASSERT_TRUE(writer.Prepare(1));
+    ASSERT_TRUE(writer.Write(byte));
+    expected.push_back(byte);
+  }
+
+  ASSERT_EQ(expected.size(), writer.size());
+  EXPECT_EQ(expected, std::vector<std::uint8_t>(
+                          writer.data(), writer.data() + writer.size()));
+
+  writer.Reset();
+  EXPECT_EQ(0u, writer.size());
+  EXPECT_LE(expected.size(), writer.capacity());
+}
+
+TEST(PageWriter, Pool) {
+  PageBufferPool pool;
+  const Snapshot snapshot = MakeSnapshot(1000);
+  const auto expected = Encode(snapshot);
+
+  for (int i = 0; i < 4; i++) {
+    Serializer<PageWriter> serializer{&pool};
+    ASSERT_TRUE(serializer.Write(snapshot));
+    const auto& writer = serializer.writer();
+    EXPECT_EQ(expected,
+              std::vector<std::uint8_t>(writer.data(),
+                                        writer.data() + writer.size()));
+  }
+
+  // The buffers are returned to the pool when the writers are destroyed.
+  EXPECT_LE(1u, pool.size());
+
+  // Writers on other threads share the pool.
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; i++) {
+    threads.emplace_back([&pool, &snapshot, &expected] {
+      Serializer<PageWriter> serializer{&pool};
+      EXPECT_TRUE(serializer.Write(snapshot));
+      EXPECT_EQ(expected.size(), serializer.writer().size());
+    });
+  }
+  for (auto& thread : threads)
+    thread.join();
+
+  PageWriter writer{&pool};
+  PageWriter moved{std::move(writer)};
+  EXPECT_TRUE(moved.Prepare(16));
+  EXPECT_EQ(0u, writer.capacity());
+}
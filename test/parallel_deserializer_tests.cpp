@@ -0,0 +1,131 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <nop/serializer.h>
+#include <nop/structure.h>
+#include <nop/types/variant.h>
+#include <nop/utility/parallel_deserializer.h>
+#include <nop/utility/parallel_serializer.h>
+#include <nop/utility/thread_pool.h>
+#include <nop/utility/vector_writer.h>
+
+#include "test_utilities.h"
+
+using nop::ErrorStatus;
+using nop::ParallelDeserialize;
+using nop::ParallelSerialize;
+using nop::Serialize;
+using nop::ThreadPool;
+using nop::Variant;
+
+namespace {
+
+struct Record {
+  std::uint64_t id;
+  std::string name;
+  Variant<int, std::string> tag;
+  NOP_STRUCTURE(Record, id, name, tag);
+  bool operator==(const Record& other) const {
+    return id == other.id && name == other.name &&
+           tag.index() == other.tag.index();
+  }
+};
+
+std::vector<Record> MakeRecords(std::size_t count) {
+  std::vector<Record> records;
+  for (std::size_t i = 0; i < count; i++) {
+    Record record{i * 7919, std::string(i % 23, 'y'), {}};
+    if (i % 2)
+      record.tag = static_cast<int>(i);
+    else
+      record.tag = std::string{"tag"};
+    records.push_back(std::move(record));
+  }
+  return records;
+}
+
+}  // anonymous namespace
+
+TEST(ParallelDeserialize, RoundTrip) {
+  ThreadPool pool{4};
+
+  for (std::size_t count : {0u, 1u, 100u, 10000u}) {
+    const auto expected = MakeRecords(count);
+    std::vector<std::uint8_t> buffer;
+    ASSERT_TRUE(ParallelSerialize(&pool, expected, &buffer));
+
+    for (std::size_t chunk_elements : {0u, 1u, 7u, 4096u}) {
+      // Existing elements are replaced.
+      std::vector<Record> records = MakeRecords(3);
+      ASSERT_TRUE(
+          ParallelDeserialize(&pool, buffer, &records, chunk_elements));
+      EXPECT_EQ(expected, records);
+    }
+  }
+
+  // BIN encodings of floating point vectors are decoded with a copy.
+  const std::vector<float> floats(1000, 2.5f);
+  std::vector<float> decoded;
+  ASSERT_TRUE(ParallelDeserialize(
+      &pool, Serialize(nop::Binary<std::vector<float>>{floats}), &decoded));
+  EXPECT_EQ(floats, decoded);
+
+  std::vector<std::string> strings;
+  ASSERT_TRUE(ParallelDeserialize(
+      &pool, Serialize(std::vector<std::string>(500, "s")), &strings, 64));
+  EXPECT_EQ(std::vector<std::string>(500, "s"), strings);
+}
+
+TEST(ParallelDeserialize, Errors) {
+  ThreadPool pool{2};
+  const auto buffer = Serialize(MakeRecords(100));
+
+  std::vector<Record> records;
+  auto status =
+      ParallelDeserialize(&pool, buffer.data(), buffer.size(), &records, 8);
+  ASSERT_TRUE(status);
+  EXPECT_EQ(buffer.size(), status.get());
+
+  // Truncated input fails in the boundary scan.
+  status = ParallelDeserialize(&pool, buffer.data(), buffer.size() - 1,
+                               &records, 8);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::ReadLimitReached, status.error());
+
+  // Trailing bytes are reported by the vector overload.
+  auto padded = buffer;
+  padded.push_back(0);
+  EXPECT_EQ(ErrorStatus::ProtocolError,
+            ParallelDeserialize(&pool, padded, &records).error());
+
+  // Element counts larger than the input are rejected before allocating.
+  const std::vector<std::uint8_t> huge = {0xba, 0x82, 0xff, 0xff,
+                                          0xff, 0x0f, 0x00, 0x00};
+  EXPECT_EQ(ErrorStatus::InvalidContainerLength,
+            ParallelDeserialize(&pool, huge, &records).error());
+
+  // Elements that are well formed but of the wrong type fail in the decode.
+  const auto strings = Serialize(std::vector<std::string>(20, "s"));
+  EXPECT_EQ(ErrorStatus::UnexpectedEncodingType,
+            ParallelDeserialize(&pool, strings, &records, 4).error());
+
+  EXPECT_EQ(ErrorStatus::UnexpectedEncodingType,
+            ParallelDeserialize(&pool, Serialize(1), &records).error());
+}
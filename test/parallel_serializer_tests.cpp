@@ -0,0 +1,106 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <nop/serializer.h>
+#include <nop/structure.h>
+#include <nop/utility/parallel_serializer.h>
+#include <nop/utility/thread_pool.h>
+#include <nop/utility/vector_writer.h>
+
+#include "test_utilities.h"
+
+using nop::ErrorStatus;
+using nop::ParallelSerialize;
+using nop::ParallelSize;
+using nop::Serialize;
+using nop::ThreadPool;
+
+namespace {
+
+struct Record {
+  std::uint64_t id;
+  std::string name;
+  std::vector<float> values;
+  NOP_STRUCTURE(Record, id, name, values);
+};
+
+struct Point {
+  float x;
+  float y;
+  NOP_STRUCTURE(Point, x, y);
+};
+
+std::vector<Record> MakeRecords(std::size_t count) {
+  std::vector<Record> records;
+  for (std::size_t i = 0; i < count; i++) {
+    records.push_back({i * 1000003, std::string(i % 37, 'x'),
+                       std::vector<float>(i % 5, 1.5f)});
+  }
+  return records;
+}
+
+}  // anonymous namespace
+
+TEST(ParallelSerialize, Identical) {
+  ThreadPool pool{4};
+
+  for (std::size_t count : {0u, 1u, 100u, 10000u}) {
+    const auto records = MakeRecords(count);
+    const auto expected = Serialize(records);
+
+    for (std::size_t chunk_elements : {0u, 1u, 7u, 4096u}) {
+      std::vector<std::uint8_t> buffer;
+      ASSERT_TRUE(
+          ParallelSerialize(&pool, records, &buffer, chunk_elements));
+      EXPECT_EQ(expected, buffer);
+      EXPECT_EQ(expected.size(), ParallelSize(&pool, records, chunk_elements));
+    }
+  }
+
+  // Fixed size elements skip the size pass.
+  const std::vector<Point> points(5000, Point{1.0f, 2.0f});
+  std::vector<std::uint8_t> buffer;
+  ASSERT_TRUE(ParallelSerialize(&pool, points, &buffer, 64));
+  EXPECT_EQ(Serialize(points), buffer);
+
+  const std::vector<std::string> strings(3000, "string");
+  ASSERT_TRUE(ParallelSerialize(&pool, strings, &buffer, 100));
+  EXPECT_EQ(Serialize(strings), buffer);
+}
+
+TEST(ParallelSerialize, Buffer) {
+  ThreadPool pool{2};
+  const auto records = MakeRecords(1000);
+  const auto expected = Serialize(records);
+
+  std::vector<std::uint8_t> buffer(expected.size() + 10, 0xff);
+  auto status =
+      ParallelSerialize(&pool, records, buffer.data(), buffer.size(), 16);
+  ASSERT_TRUE(status);
+  EXPECT_EQ(expected.size(), status.get());
+  EXPECT_TRUE(std::equal(expected.begin(), expected.end(), buffer.begin()));
+  EXPECT_EQ(0xff, buffer[expected.size()]);
+
+  status = ParallelSerialize(&pool, records, buffer.data(),
+                             expected.size() - 1, 16);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::WriteLimitReached, status.error());
+}
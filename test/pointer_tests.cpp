@@ -0,0 +1,310 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <nop/serializer.h>
+#include <nop/structure.h>
+#include <nop/table.h>
+#include <nop/types/optional.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/incremental_decoder.h>
+#include <nop/utility/interning_reader.h>
+#include <nop/utility/interning_writer.h>
+#include <nop/utility/vector_writer.h>
+
+using nop::BufferReader;
+using nop::DeletedEntry;
+using nop::Deserializer;
+using nop::Encoding;
+using nop::Entry;
+using nop::ErrorStatus;
+using nop::IncrementalDecoder;
+using nop::InterningReader;
+using nop::InterningWriter;
+using nop::Optional;
+using nop::Serializer;
+using nop::SkipValue;
+using nop::Status;
+using nop::ValidateValue;
+using nop::VectorWriter;
+
+namespace {
+
+struct Mesh {
+  std::vector<float> vertices;
+  NOP_STRUCTURE(Mesh, vertices);
+};
+
+struct Node {
+  std::string name;
+  std::shared_ptr<const Mesh> mesh;
+  NOP_STRUCTURE(Node, name, mesh);
+};
+
+struct Group {
+  std::int32_t value;
+  std::vector<std::shared_ptr<Group>> children;
+  NOP_STRUCTURE(Group, value, children);
+};
+
+struct Scene {
+  Entry<std::vector<std::shared_ptr<const Mesh>>, 0> meshes;
+  Entry<std::shared_ptr<const Mesh>, 1> selected;
+  NOP_TABLE_NS("Scene", Scene, meshes, selected);
+};
+
+// A later version of Scene without the entry that defines the meshes.
+struct SceneSelection {
+  Entry<std::vector<std::shared_ptr<const Mesh>>, 0, DeletedEntry> meshes;
+  Entry<std::shared_ptr<const Mesh>, 1> selected;
+  NOP_TABLE_NS("Scene", SceneSelection, meshes, selected);
+};
+
+template <typename T>
+std::vector<std::uint8_t> Serialize(const T& value) {
+  VectorWriter vector_writer;
+  Serializer<InterningWriter<VectorWriter>> serializer{&vector_writer};
+  EXPECT_TRUE(serializer.Write(value));
+  EXPECT_LE(vector_writer.size(), Encoding<T>::Size(value));
+  return vector_writer.Take();
+}
+
+template <typename T>
+Status<void> Deserialize(const std::vector<std::uint8_t>& data, T* value) {
+  BufferReader buffer_reader{data.data(), data.size()};
+  Deserializer<InterningReader<BufferReader>> deserializer{&buffer_reader};
+  auto status = deserializer.Read(value);
+  if (status && buffer_reader.remaining() != 0)
+    return ErrorStatus::ProtocolError;
+  return status;
+}
+
+}  // anonymous namespace
+
+TEST(Pointer, UniquePtr) {
+  std::unique_ptr<std::string> value{new std::string{"foo"}};
+  std::unique_ptr<std::string> null;
+
+  // The format is the same as Optional.
+  const auto data = Serialize(value);
+  EXPECT_EQ(Serialize(Optional<std::string>{"foo"}), data);
+  EXPECT_EQ((std::vector<std::uint8_t>{0xbe}), Serialize(null));
+
+  std::unique_ptr<std::string> decoded;
+  ASSERT_TRUE(Deserialize(data, &decoded));
+  ASSERT_NE(nullptr, decoded);
+  EXPECT_EQ("foo", *decoded);
+
+  ASSERT_TRUE(Deserialize(std::vector<std::uint8_t>{0xbe}, &decoded));
+  EXPECT_EQ(nullptr, decoded);
+
+  // Plain writers and readers suffice for unique_ptr.
+  std::vector<std::unique_ptr<const std::int32_t>> values;
+  values.emplace_back(new std::int32_t{1});
+  values.emplace_back();
+  Serializer<VectorWriter> serializer;
+  ASSERT_TRUE(serializer.Write(values));
+  const auto plain_data = serializer.writer().Take();
+
+  std::vector<std::unique_ptr<const std::int32_t>> plain;
+  Deserializer<BufferReader> deserializer{plain_data.data(), plain_data.size()};
+  ASSERT_TRUE(deserializer.Read(&plain));
+  ASSERT_EQ(2u, plain.size());
+  ASSERT_NE(nullptr, plain[0]);
+  EXPECT_EQ(1, *plain[0]);
+  EXPECT_EQ(nullptr, plain[1]);
+}
+
+TEST(Pointer, SharedPtrEncoding) {
+  auto a = std::make_shared<std::int32_t>(5);
+  auto b = std::make_shared<std::int32_t>(7);
+  const std::vector<std::shared_ptr<std::int32_t>> value = {a, a, nullptr, b,
+                                                            b};
+  EXPECT_EQ((std::vector<std::uint8_t>{0xba, 0x05, 0xbf, 0x01, 0xff, 0x05,
+                                       0xbf, 0x01, 0x00, 0xbe, 0xbf, 0x01,
+                                       0xff, 0x07, 0xbf, 0x01, 0x01}),
+            Serialize(value));
+}
+
+TEST(Pointer, SharedPtrSharing) {
+  auto mesh = std::make_shared<const Mesh>(Mesh{std::vector<float>(1000, 1)});
+  std::vector<Node> nodes;
+  for (int i = 0; i < 100; i++)
+    nodes.push_back({"node" + std::to_string(i), i % 10 ? mesh : nullptr});
+
+  const auto data = Serialize(nodes);
+  EXPECT_LT(data.size(), 2 * Encoding<Mesh>::Size(*mesh));
+
+  std::vector<Node> decoded;
+  ASSERT_TRUE(Deserialize(data, &decoded));
+  ASSERT_EQ(100u, decoded.size());
+  ASSERT_NE(nullptr, decoded[1].mesh);
+  EXPECT_EQ(mesh->vertices, decoded[1].mesh->vertices);
+  for (int i = 0; i < 100; i++) {
+    EXPECT_EQ(nodes[i].name, decoded[i].name);
+    if (i % 10)
+      EXPECT_EQ(decoded[1].mesh, decoded[i].mesh);
+    else
+      EXPECT_EQ(nullptr, decoded[i].mesh);
+  }
+}
+
+TEST(Pointer, SharedPtrNested) {
+  // A diamond: both children share the same grandchild.
+  auto leaf = std::make_shared<Group>(Group{3, {}});
+  auto left = std::make_shared<Group>(Group{1, {leaf}});
+  auto right = std::make_shared<Group>(Group{2, {leaf, left}});
+  auto root = std::make_shared<Group>(Group{0, {left, right, leaf}});
+
+  VectorWriter vector_writer;
+  Serializer<InterningWriter<VectorWriter>> serializer{&vector_writer};
+  ASSERT_TRUE(serializer.Write(root));
+  EXPECT_EQ(4u, serializer.writer().pointer_count());
+  const auto data = vector_writer.Take();
+
+  BufferReader buffer_reader{data.data(), data.size()};
+  Deserializer<InterningReader<BufferReader>> deserializer{&buffer_reader};
+  std::shared_ptr<Group> decoded;
+  ASSERT_TRUE(deserializer.Read(&decoded));
+  EXPECT_EQ(4u, deserializer.reader().pointer_count());
+
+  ASSERT_NE(nullptr, decoded);
+  EXPECT_EQ(0, decoded->value);
+  ASSERT_EQ(3u, decoded->children.size());
+  const auto& decoded_left = decoded->children[0];
+  const auto& decoded_right = decoded->children[1];
+  const auto& decoded_leaf = decoded->children[2];
+  EXPECT_EQ(1, decoded_left->value);
+  EXPECT_EQ(2, decoded_right->value);
+  EXPECT_EQ(3, decoded_leaf->value);
+  EXPECT_EQ(decoded_leaf, decoded_left->children[0]);
+  EXPECT_EQ(decoded_leaf, decoded_right->children[0]);
+  EXPECT_EQ(decoded_left, decoded_right->children[1]);
+
+  // Clearing the tables defines the objects again.
+  serializer.writer().ClearPointers();
+  EXPECT_EQ(0u, serializer.writer().pointer_count());
+  deserializer.reader().ClearPointers();
+  EXPECT_EQ(0u, deserializer.reader().pointer_count());
+}
+
+TEST(Pointer, Errors) {
+  // Reference to an undefined object.
+  std::shared_ptr<std::int32_t> value;
+  EXPECT_EQ(ErrorStatus::InvalidReference,
+            Deserialize(std::vector<std::uint8_t>{0xbf, 0x01, 0x00}, &value)
+                .error());
+  EXPECT_EQ(ErrorStatus::InvalidReference,
+            Deserialize(std::vector<std::uint8_t>{0xbf, 0x01, 0xfe}, &value)
+                .error());
+
+  // Reference to an object of another type.
+  std::pair<std::shared_ptr<std::int32_t>, std::shared_ptr<std::string>> pair;
+  EXPECT_EQ(ErrorStatus::InvalidReference,
+            Deserialize(std::vector<std::uint8_t>{0xba, 0x02, 0xbf, 0x01, 0xff,
+                                                  0x05, 0xbf, 0x01, 0x00},
+                        &pair)
+                .error());
+
+  // Another extension type.
+  EXPECT_EQ(ErrorStatus::UnexpectedEncodingType,
+            Deserialize(std::vector<std::uint8_t>{0xbf, 0x00, 0x00}, &value)
+                .error());
+  EXPECT_EQ(ErrorStatus::UnexpectedEncodingType,
+            Deserialize(std::vector<std::uint8_t>{0xbf, 0x02, 0x00}, &value)
+                .error());
+
+  // A plain value is not a shared pointer.
+  EXPECT_EQ(ErrorStatus::UnexpectedEncodingType,
+            Deserialize(std::vector<std::uint8_t>{0x05}, &value).error());
+}
+
+TEST(Pointer, TableEntries) {
+  auto a = std::make_shared<const Mesh>(Mesh{{1, 2}});
+  auto b = std::make_shared<const Mesh>(Mesh{{3}});
+  Scene scene;
+  scene.meshes = std::vector<std::shared_ptr<const Mesh>>{a, b};
+  scene.selected = b;
+  const auto data = Serialize(scene);
+
+  Scene decoded;
+  ASSERT_TRUE(Deserialize(data, &decoded));
+  ASSERT_EQ(2u, decoded.meshes.get().size());
+  EXPECT_EQ(a->vertices, decoded.meshes.get()[0]->vertices);
+  EXPECT_EQ(decoded.meshes.get()[1], decoded.selected.get());
+
+  // The skipped entry reserves the entries of the meshes it defines, so the
+  // reference to one of them fails instead of resolving to another object.
+  SceneSelection selection;
+  EXPECT_EQ(ErrorStatus::InvalidReference,
+            Deserialize(data, &selection).error());
+
+  // Objects defined after the skipped entry keep their numbers.
+  scene.selected = std::make_shared<const Mesh>(Mesh{{4}});
+  ASSERT_TRUE(Deserialize(Serialize(scene), &selection));
+  EXPECT_EQ(scene.selected.get()->vertices, selection.selected.get()->vertices);
+}
+
+TEST(Pointer, Skip) {
+  auto a = std::make_shared<std::int32_t>(5);
+  auto b = std::make_shared<std::int32_t>(7);
+  VectorWriter vector_writer;
+  Serializer<InterningWriter<VectorWriter>> serializer{&vector_writer};
+  const std::vector<std::shared_ptr<std::int32_t>> value = {a, nullptr, a};
+  ASSERT_TRUE(serializer.Write(value));
+  const std::size_t value_size = vector_writer.size();
+  ASSERT_TRUE(serializer.Write(b));
+  ASSERT_TRUE(serializer.Write(b));
+  const std::vector<std::uint8_t> data = vector_writer.Take();
+
+  BufferReader skip_reader{data.data(), data.size()};
+  ASSERT_TRUE(SkipValue(&skip_reader));
+  EXPECT_EQ(data.size() - value_size, skip_reader.remaining());
+
+  BufferReader validate_reader{data.data(), data.size()};
+  ASSERT_TRUE(ValidateValue(&validate_reader));
+  EXPECT_EQ(data.size() - value_size, validate_reader.remaining());
+
+  IncrementalDecoder<std::vector<std::shared_ptr<std::int32_t>>> decoder;
+  for (std::size_t i = 0; i < value_size; i++)
+    ASSERT_TRUE(decoder.Feed(&data[i], 1));
+  EXPECT_TRUE(decoder.complete());
+
+  // Skipping through an InterningReader reserves the entry of the skipped
+  // object, so the reference to the object defined next resolves.
+  BufferReader buffer_reader{data.data(), data.size()};
+  Deserializer<InterningReader<BufferReader>> deserializer{&buffer_reader};
+  ASSERT_TRUE(SkipValue(&deserializer.reader()));
+  EXPECT_EQ(1u, deserializer.reader().pointer_count());
+  std::shared_ptr<std::int32_t> first;
+  std::shared_ptr<std::int32_t> second;
+  ASSERT_TRUE(deserializer.Read(&first));
+  ASSERT_TRUE(deserializer.Read(&second));
+  ASSERT_NE(nullptr, first);
+  EXPECT_EQ(7, *first);
+  EXPECT_EQ(first, second);
+
+  // Negative references other than a definition are invalid.
+  const std::vector<std::uint8_t> invalid = {0xbf, 0x01, 0xfe};
+  BufferReader invalid_reader{invalid.data(), invalid.size()};
+  EXPECT_EQ(ErrorStatus::InvalidReference,
+            ValidateValue(&invalid_reader).error());
+}
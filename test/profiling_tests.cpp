@@ -0,0 +1,243 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <nop/serializer.h>
+#include <nop/structure.h>
+#include <nop/table.h>
+#include <nop/types/file_handle.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/profiling.h>
+#include <nop/utility/vector_writer.h>
+
+#include "test_writer.h"
+
+using nop::BufferReader;
+using nop::Deserializer;
+using nop::EncodingEvent;
+using nop::EncodingProfile;
+using nop::Entry;
+using nop::FileHandle;
+using nop::ProfilesEncodings;
+using nop::ProfilingReader;
+using nop::ProfilingWriter;
+using nop::Serializer;
+using nop::SizeEstimateProfile;
+using nop::TestWriter;
+using nop::TypeName;
+using nop::VectorWriter;
+
+namespace {
+
+struct Point {
+  std::int32_t x;
+  std::int32_t y;
+  NOP_STRUCTURE(Point, x, y);
+};
+
+struct Shape {
+  std::string name;
+  std::vector<Point> points;
+  NOP_STRUCTURE(Shape, name, points);
+};
+
+struct Layer {
+  Entry<Shape, 0> shape;
+  NOP_TABLE(Layer, shape);
+};
+
+struct Buffers {
+  std::vector<FileHandle> handles;
+  NOP_STRUCTURE(Buffers, handles);
+};
+
+struct Attachment {
+  Entry<Buffers, 0> buffers;
+  NOP_TABLE(Attachment, buffers);
+};
+
+// Profiler that records every event.
+struct RecordingProfiler {
+  struct Record {
+    bool enter;
+    std::string type_name;
+    std::size_t depth;
+    std::size_t bytes;
+    bool ok;
+  };
+
+  void Enter(const EncodingEvent& event) {
+    records.push_back(
+        {true, event.type_name, event.depth, event.bytes, event.ok});
+  }
+  void Exit(const EncodingEvent& event) {
+    records.push_back(
+        {false, event.type_name, event.depth, event.bytes, event.ok});
+    EXPECT_EQ(0u, event.estimate);
+  }
+
+  std::vector<Record> records;
+};
+
+}  // anonymous namespace
+
+TEST(Profiling, TypeName) {
+  EXPECT_STREQ("int", TypeName<int>());
+  const std::string point_name = TypeName<Point>();
+  EXPECT_EQ("::Point", point_name.substr(point_name.size() - 7));
+  EXPECT_EQ(TypeName<Shape>(), TypeName<Shape>());
+}
+
+TEST(Profiling, Hooks) {
+  static_assert(!ProfilesEncodings<VectorWriter>::value,
+                "Writers do not profile unless they opt in.");
+
+  const Shape shape{"square", {{0, 0}, {0, 1}, {1, 1}, {1, 0}}};
+  VectorWriter vector_writer;
+  RecordingProfiler profiler;
+  ProfilingWriter<VectorWriter, RecordingProfiler> writer{&vector_writer,
+                                                          &profiler};
+  Serializer<decltype(writer)*> serializer{&writer};
+  ASSERT_TRUE(serializer.Write(shape));
+
+  // Shape, name, points, 4 * (Point, x, y) and the 7 length and member count
+  // headers of the structures and containers.
+  const auto& records = profiler.records;
+  ASSERT_EQ(2u * (3u + 4u * 3u + 7u), records.size());
+
+  EXPECT_TRUE(records.front().enter);
+  EXPECT_EQ(TypeName<Shape>(), records.front().type_name);
+  EXPECT_EQ(0u, records.front().depth);
+
+  EXPECT_FALSE(records.back().enter);
+  EXPECT_EQ(TypeName<Shape>(), records.back().type_name);
+  EXPECT_EQ(0u, records.back().depth);
+  EXPECT_EQ(vector_writer.size(), records.back().bytes);
+  EXPECT_TRUE(records.back().ok);
+
+  // The member count header of Shape, followed by the name.
+  EXPECT_EQ(TypeName<std::uint64_t>(), records[1].type_name);
+  EXPECT_EQ(1u, records[1].depth);
+  EXPECT_TRUE(records[3].enter);
+  EXPECT_EQ(TypeName<std::string>(), records[3].type_name);
+  EXPECT_EQ(1u, records[3].depth);
+  EXPECT_FALSE(records[6].enter);
+  EXPECT_EQ(TypeName<std::string>(), records[6].type_name);
+  EXPECT_EQ(1u + 1u + 6u, records[6].bytes);
+
+  EXPECT_EQ(TypeName<Point>(), records[10].type_name);
+  EXPECT_EQ(2u, records[10].depth);
+  EXPECT_EQ(TypeName<std::int32_t>(), records[13].type_name);
+  EXPECT_EQ(3u, records[13].depth);
+
+  // Decoding reports the same events.
+  BufferReader buffer_reader{vector_writer.data(), vector_writer.size()};
+  RecordingProfiler read_profiler;
+  ProfilingReader<BufferReader, RecordingProfiler> reader{&buffer_reader,
+                                                          &read_profiler};
+  Deserializer<decltype(reader)*> deserializer{&reader};
+  Shape result;
+  ASSERT_TRUE(deserializer.Read(&result));
+  EXPECT_EQ(shape.name, result.name);
+
+  ASSERT_EQ(records.size(), read_profiler.records.size());
+  for (std::size_t i = 0; i < records.size(); i++) {
+    EXPECT_EQ(records[i].enter, read_profiler.records[i].enter);
+    EXPECT_EQ(records[i].type_name, read_profiler.records[i].type_name);
+    EXPECT_EQ(records[i].depth, read_profiler.records[i].depth);
+    EXPECT_EQ(records[i].bytes, read_profiler.records[i].bytes);
+  }
+}
+
+TEST(Profiling, Profile) {
+  Layer layer;
+  layer.shape = Shape{"line", {{0, 0}, {1, 1}}};
+
+  VectorWriter vector_writer;
+  EncodingProfile<> profile;
+  ProfilingWriter<VectorWriter, EncodingProfile<>> writer{&vector_writer,
+                                                          &profile};
+  Serializer<decltype(writer)*> serializer{&writer};
+  ASSERT_TRUE(serializer.Write(layer));
+
+  // Values nested in table entries are profiled through the bounded writer.
+  const std::string layer_name = TypeName<Layer>();
+  const std::string point_path = layer_name + ";" + TypeName<Shape>() + ";" +
+                                 TypeName<std::vector<Point>>() + ";" +
+                                 TypeName<Point>();
+  const auto& entries = profile.entries();
+  ASSERT_EQ(1u, entries.count(layer_name));
+  EXPECT_EQ(1u, entries.at(layer_name).count);
+  EXPECT_EQ(vector_writer.size(), entries.at(layer_name).bytes);
+  EXPECT_LE(entries.at(layer_name).self_ticks, entries.at(layer_name).ticks);
+
+  ASSERT_EQ(1u, entries.count(point_path));
+  EXPECT_EQ(2u, entries.at(point_path).count);
+  EXPECT_EQ(2u * 4u, entries.at(point_path).bytes);
+  EXPECT_EQ(0u, entries.at(point_path).errors);
+
+  std::ostringstream folded;
+  profile.WriteFolded(&folded);
+  EXPECT_NE(std::string::npos, folded.str().find(point_path + " "));
+}
+
+TEST(Profiling, SizeEstimates) {
+  Attachment attachment;
+  attachment.buffers = Buffers{{FileHandle{3}, FileHandle{4}, FileHandle{}}};
+
+  TestWriter test_writer;
+  SizeEstimateProfile profile;
+  ProfilingWriter<TestWriter, SizeEstimateProfile> writer{&test_writer,
+                                                          &profile};
+  Serializer<decltype(writer)*> serializer{&writer};
+  ASSERT_TRUE(serializer.Write(attachment));
+  ASSERT_TRUE(serializer.Write(attachment));
+
+  // Handle references are estimated as I64 but fit in one byte.
+  const auto& entries = profile.entries();
+  const std::string handle_name = TypeName<FileHandle>();
+  ASSERT_EQ(1u, entries.count(handle_name));
+  const auto& handle = entries.at(handle_name);
+  EXPECT_EQ(6u, handle.count);
+  EXPECT_EQ(6u, handle.overestimates);
+  EXPECT_EQ(0u, handle.underestimates);
+  EXPECT_EQ(6u * 8u, handle.waste());
+
+  // The waste carries over to the enclosing values, except for the table,
+  // which pads the entry.
+  const auto& buffers = entries.at(TypeName<Buffers>());
+  EXPECT_EQ(2u, buffers.count);
+  EXPECT_EQ(6u * 8u, buffers.waste());
+  const auto& table = entries.at(TypeName<Attachment>());
+  EXPECT_EQ(test_writer.data().size(), table.actual);
+  EXPECT_EQ(0u, table.waste());
+
+  // Integer headers are estimated exactly.
+  const auto& header = entries.at(TypeName<std::uint64_t>());
+  EXPECT_EQ(0u, header.overestimates);
+  EXPECT_EQ(header.estimated, header.actual);
+
+  std::ostringstream report;
+  profile.WriteReport(&report);
+  const std::string text = report.str();
+  EXPECT_NE(std::string::npos, text.find(handle_name + " count=6 "));
+  EXPECT_NE(std::string::npos, text.find(TypeName<Buffers>()));
+  EXPECT_EQ(std::string::npos, text.find(TypeName<Attachment>()));
+}
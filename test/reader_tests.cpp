@@ -0,0 +1,682 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <nop/projection.h>
+#include <nop/serializer.h>
+#include <nop/structure.h>
+#include <nop/table.h>
+#include <nop/utility/bounded_reader.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/counting_reader.h>
+#include <nop/utility/default_init_allocator.h>
+#include <nop/utility/mmap_reader.h>
+#include <nop/utility/pedantic_buffer_reader.h>
+#include <nop/utility/reuse_storage.h>
+#include <nop/utility/scatter_gather_reader.h>
+#include <nop/utility/vector_writer.h>
+
+#include "test_utilities.h"
+
+using nop::Binary;
+using nop::BinaryView;
+using nop::BoundedReader;
+using nop::BufferReader;
+using nop::Compose;
+using nop::CountingReader;
+using nop::DefaultInitAllocator;
+using nop::Deserializer;
+using nop::Encoding;
+using nop::EncodingByte;
+using nop::Entry;
+using nop::ErrorStatus;
+using nop::LazyTable;
+using nop::MmapReader;
+using nop::PedanticBufferReader;
+using nop::ReuseStorage;
+using nop::ScatterGatherReader;
+using nop::Serialize;
+using nop::Serializer;
+using nop::StringView;
+using nop::VectorWriter;
+
+namespace {
+
+template <typename T>
+using UninitializedVector = std::vector<T, DefaultInitAllocator<T>>;
+
+struct Record {
+  std::uint64_t timestamp;
+  std::string name;
+  std::vector<std::uint16_t> samples;
+
+  NOP_STRUCTURE(Record, timestamp, name, samples);
+};
+
+struct RecordView {
+  std::uint64_t timestamp;
+  StringView name;
+  BinaryView<std::uint16_t> samples;
+
+  NOP_STRUCTURE(RecordView, timestamp, name, samples);
+};
+
+struct TableRecordView {
+  Entry<StringView, 0> name;
+  Entry<BinaryView<std::uint8_t>, 1> data;
+
+  NOP_TABLE(TableRecordView, name, data);
+};
+
+struct TableRecord {
+  Entry<std::string, 0> name;
+  Entry<std::vector<std::uint8_t>, 1> data;
+
+  NOP_TABLE(TableRecord, name, data);
+};
+
+struct Message {
+  Entry<std::string, 0> route;
+  Entry<std::vector<std::string>, 1> tags;
+  Entry<std::uint32_t, 2> priority;
+  Entry<Record, 3> record;
+
+  NOP_TABLE_HASH(7, Message, route, tags, priority, record);
+};
+
+struct MessageV2 {
+  Entry<std::string, 0> route;
+  Entry<std::uint32_t, 2> priority;
+  Entry<std::string, 4> extra;
+
+  NOP_TABLE_HASH(7, MessageV2, route, priority, extra);
+};
+
+// Creates a temporary file that is deleted when the object is destroyed.
+struct TempFile {
+  TempFile() {
+    char name[] = "/tmp/nop_reader_tests.XXXXXX";
+    fd = mkstemp(name);
+    EXPECT_LE(0, fd);
+    path = name;
+  }
+  ~TempFile() {
+    close(fd);
+    unlink(path.c_str());
+  }
+
+  void Write(const std::uint8_t* data, std::size_t size) {
+    EXPECT_EQ(static_cast<ssize_t>(size), write(fd, data, size));
+  }
+
+  int fd;
+  std::string path;
+};
+
+struct Inventory {
+  std::vector<std::string> names;
+  std::map<std::string, std::vector<int>> counts;
+  std::unordered_map<int, std::string> labels;
+
+  NOP_STRUCTURE(Inventory, names, counts, labels);
+
+  bool operator==(const Inventory& other) const {
+    return names == other.names && counts == other.counts &&
+           labels == other.labels;
+  }
+};
+
+// Structures with a fixed encoded size, one of them with a fungible member
+// that is written with the shorter BIN encoding.
+struct Sample {
+  double time;
+  std::array<float, 3> position;
+  NOP_STRUCTURE(Sample, time, position);
+
+  bool operator==(const Sample& other) const {
+    return time == other.time && position == other.position;
+  }
+};
+
+struct BinarySample {
+  double time;
+  Binary<std::array<float, 3>> position;
+  NOP_STRUCTURE(BinarySample, time, position);
+};
+
+// Splits |data| into segments of |chunk_size| bytes, with an empty segment
+// after each one.
+std::vector<iovec> Split(std::vector<std::uint8_t>* data,
+                         std::size_t chunk_size) {
+  std::vector<iovec> segments;
+  for (std::size_t offset = 0; offset < data->size(); offset += chunk_size) {
+    const std::size_t size = std::min(chunk_size, data->size() - offset);
+    segments.push_back({data->data() + offset, size});
+    segments.push_back({nullptr, 0});
+  }
+  return segments;
+}
+
+}  // anonymous namespace
+
+TEST(BinaryView, Encoding) {
+  const std::vector<std::uint16_t> samples{1, 2, 0x0300};
+  const std::vector<std::uint8_t> expected =
+      Compose(EncodingByte::Binary, 6, 1, 0, 2, 0, 0, 3);
+
+  Serializer<VectorWriter> serializer;
+  ASSERT_TRUE(serializer.Write(BinaryView<std::uint16_t>{samples}));
+  const std::vector<std::uint8_t> actual = serializer.writer().Take();
+  EXPECT_EQ(expected, actual);
+
+  // The view refers to the bytes of the reader's buffer.
+  Deserializer<BufferReader> deserializer{actual.data(), actual.size()};
+  BinaryView<std::uint16_t> view;
+  ASSERT_TRUE(deserializer.Read(&view));
+  EXPECT_EQ(3u, view.size());
+  EXPECT_EQ(static_cast<const void*>(&actual[2]),
+            static_cast<const void*>(view.data()));
+  EXPECT_EQ(samples, view.CopyTo());
+  EXPECT_EQ(0x0300, view[2]);
+
+  // Lengths that are not a multiple of the element size are rejected.
+  const std::vector<std::uint8_t> odd =
+      Compose(EncodingByte::Binary, 3, 1, 2, 3);
+  Deserializer<BufferReader> odd_deserializer{odd.data(), odd.size()};
+  EXPECT_EQ(ErrorStatus::InvalidContainerLength,
+            odd_deserializer.Read(&view).error());
+}
+
+TEST(StringView, Encoding) {
+  const std::vector<std::uint8_t> expected =
+      Compose(EncodingByte::String, 3, "foo");
+
+  Serializer<VectorWriter> serializer;
+  ASSERT_TRUE(serializer.Write(StringView{"foo"}));
+  const std::vector<std::uint8_t> actual = serializer.writer().Take();
+  EXPECT_EQ(expected, actual);
+
+  Deserializer<BufferReader> deserializer{actual.data(), actual.size()};
+  StringView view;
+  ASSERT_TRUE(deserializer.Read(&view));
+  EXPECT_EQ(StringView{"foo"}, view);
+  EXPECT_EQ("foo", view.ToString());
+
+  // Truncated input is rejected before borrowing.
+  Deserializer<BufferReader> truncated{actual.data(), actual.size() - 1};
+  EXPECT_EQ(ErrorStatus::ReadLimitReached, truncated.Read(&view).error());
+}
+
+TEST(MmapReader, Views) {
+  TempFile file;
+
+  Serializer<VectorWriter> serializer;
+  const Record record{1234, "session", {10, 20, 30, 40}};
+  ASSERT_TRUE(serializer.Write(record));
+
+  TableRecord table_record;
+  table_record.name = std::string{"table"};
+  table_record.data = std::vector<std::uint8_t>(100, 0x5a);
+  ASSERT_TRUE(serializer.Write(table_record));
+  file.Write(serializer.writer().data(), serializer.writer().size());
+
+  auto reader = MmapReader::Open(file.path);
+  ASSERT_TRUE(reader);
+  EXPECT_EQ(serializer.writer().size(), reader.get().capacity());
+
+  Deserializer<MmapReader> deserializer{reader.take()};
+  RecordView view;
+  ASSERT_TRUE(deserializer.Read(&view));
+  EXPECT_EQ(record.timestamp, view.timestamp);
+  EXPECT_EQ(record.name, view.name.ToString());
+  EXPECT_EQ(record.samples, view.samples.CopyTo());
+
+  // The views point into the mapping.
+  const std::uint8_t* begin = deserializer.reader().data();
+  const std::uint8_t* end = begin + deserializer.reader().capacity();
+  EXPECT_LE(begin, reinterpret_cast<const std::uint8_t*>(view.name.data()));
+  EXPECT_GT(end, reinterpret_cast<const std::uint8_t*>(view.samples.data()));
+
+  TableRecordView table_view;
+  ASSERT_TRUE(deserializer.Read(&table_view));
+  ASSERT_TRUE(table_view.name);
+  EXPECT_EQ(StringView{"table"}, table_view.name.get());
+  ASSERT_TRUE(table_view.data);
+  EXPECT_EQ(table_record.data.get(), table_view.data.get().CopyTo());
+  EXPECT_TRUE(deserializer.reader().empty());
+
+  // Reading past the end of the mapping fails cleanly.
+  EXPECT_EQ(ErrorStatus::ReadLimitReached, deserializer.Read(&view).error());
+
+  ASSERT_TRUE(deserializer.reader().Seek(0));
+  Record copy;
+  ASSERT_TRUE(deserializer.Read(&copy));
+  EXPECT_EQ(record.samples, copy.samples);
+}
+
+TEST(MmapReader, Errors) {
+  EXPECT_EQ(ErrorStatus::IOError,
+            MmapReader::Open("/nonexistent/nop/file").error());
+
+  TempFile file;
+  auto reader = MmapReader::Open(file.path);
+  ASSERT_TRUE(reader);
+  EXPECT_TRUE(reader.get().empty());
+
+  std::uint8_t byte;
+  EXPECT_EQ(ErrorStatus::ReadLimitReached, reader.get().Read(&byte).error());
+}
+
+TEST(LazyTable, Decode) {
+  Message message;
+  message.route = std::string{"primary"};
+  message.tags = std::vector<std::string>{"a", "b"};
+  message.record = Record{1, "record", {1, 2, 3}};
+
+  Serializer<VectorWriter> serializer;
+  ASSERT_TRUE(serializer.Write(message));
+  const std::vector<std::uint8_t> data = serializer.writer().Take();
+
+  Deserializer<BufferReader> deserializer{data.data(), data.size()};
+  LazyTable<Message> lazy;
+  ASSERT_TRUE(deserializer.Read(&lazy));
+  EXPECT_TRUE(deserializer.reader().empty());
+
+  // Entries are only decoded on request.
+  EXPECT_TRUE(lazy.Contains(&Message::route));
+  EXPECT_TRUE(lazy.Contains(&Message::record));
+  EXPECT_FALSE(lazy.Contains(&Message::priority));
+  EXPECT_FALSE(lazy.table().route);
+  EXPECT_FALSE(lazy.table().record);
+
+  ASSERT_TRUE(lazy.Decode(&Message::route));
+  ASSERT_TRUE(lazy.table().route);
+  EXPECT_EQ("primary", lazy.table().route.get());
+  EXPECT_FALSE(lazy.table().tags);
+
+  ASSERT_TRUE(lazy.Decode(&Message::record));
+  ASSERT_TRUE(lazy.table().record);
+  EXPECT_EQ(message.record.get().samples, lazy.table().record.get().samples);
+
+  // Absent entries remain empty.
+  ASSERT_TRUE(lazy.Decode(&Message::priority));
+  EXPECT_FALSE(lazy.table().priority);
+
+  // Unknown entries are skipped, as with eager decoding.
+  Deserializer<BufferReader> v2_deserializer{data.data(), data.size()};
+  LazyTable<MessageV2> lazy_v2;
+  ASSERT_TRUE(v2_deserializer.Read(&lazy_v2));
+  EXPECT_TRUE(v2_deserializer.reader().empty());
+  ASSERT_TRUE(lazy_v2.Decode(&MessageV2::route));
+  EXPECT_EQ("primary", lazy_v2.table().route.get());
+  EXPECT_FALSE(lazy_v2.Contains(&MessageV2::extra));
+}
+
+TEST(LazyTable, Errors) {
+  LazyTable<Message> lazy;
+
+  // Duplicate entries are detected while reading.
+  std::vector<std::uint8_t> data =
+      Compose(EncodingByte::Table, 7, 2, 2, 1, 5, 2, 1, 6);
+  Deserializer<BufferReader> duplicate{data.data(), data.size()};
+  EXPECT_EQ(ErrorStatus::DuplicateTableEntry, duplicate.Read(&lazy).error());
+
+  // Entry lengths that exceed the input are rejected before borrowing.
+  data = Compose(EncodingByte::Table, 7, 1, 2, 10, 5);
+  Deserializer<BufferReader> truncated{data.data(), data.size()};
+  EXPECT_EQ(ErrorStatus::ReadLimitReached, truncated.Read(&lazy).error());
+
+  // Invalid entry bytes are reported when the entry is decoded.
+  data = Compose(EncodingByte::Table, 7, 1, 0, 2, EncodingByte::String, 5);
+  Deserializer<BufferReader> invalid{data.data(), data.size()};
+  ASSERT_TRUE(invalid.Read(&lazy));
+  EXPECT_EQ(ErrorStatus::ReadLimitReached,
+            lazy.Decode(&Message::route).error());
+  EXPECT_FALSE(lazy.table().route);
+
+  data = Compose(EncodingByte::Table, 8, 0);
+  Deserializer<BufferReader> hash{data.data(), data.size()};
+  EXPECT_EQ(ErrorStatus::InvalidTableHash, hash.Read(&lazy).error());
+}
+
+TEST(Projection, Read) {
+  const Record record{1234, "session", {10, 20, 30, 40}};
+
+  Serializer<VectorWriter> serializer;
+  ASSERT_TRUE(serializer.Write(record));
+  ASSERT_TRUE(serializer.Write(record));
+  const std::vector<std::uint8_t> data = serializer.writer().Take();
+
+  // Only the projected members are decoded; the others are left untouched.
+  using RecordSummary = NOP_PROJECTION(Record, timestamp, samples);
+  Deserializer<BufferReader> deserializer{data.data(), data.size()};
+  Record value{0, "untouched", {}};
+  RecordSummary summary{&value};
+  ASSERT_TRUE(deserializer.Read(&summary));
+  EXPECT_EQ(record.timestamp, value.timestamp);
+  EXPECT_EQ("untouched", value.name);
+  EXPECT_EQ(record.samples, value.samples);
+
+  // The reader is positioned at the following value.
+  Record copy;
+  ASSERT_TRUE(deserializer.Read(&copy));
+  EXPECT_EQ(record.name, copy.name);
+  EXPECT_TRUE(deserializer.reader().empty());
+
+  // The member count must match the structure.
+  const std::vector<std::uint8_t> invalid =
+      Compose(EncodingByte::Structure, 2, 1, 2);
+  Deserializer<BufferReader> invalid_deserializer{invalid.data(),
+                                                  invalid.size()};
+  EXPECT_EQ(ErrorStatus::InvalidMemberCount,
+            invalid_deserializer.Read(&summary).error());
+}
+
+TEST(BufferReader, ReserveVector) {
+  std::vector<std::string> strings;
+  for (int i = 0; i < 1000; i++)
+    strings.push_back(std::to_string(i));
+
+  Serializer<VectorWriter> serializer;
+  ASSERT_TRUE(serializer.Write(strings));
+  std::vector<std::uint8_t> data = serializer.writer().Take();
+
+  // Readers that report the bytes remaining reserve the whole vector up front.
+  Deserializer<BufferReader> deserializer{data.data(), data.size()};
+  std::vector<std::string> decoded;
+  ASSERT_TRUE(deserializer.Read(&decoded));
+  EXPECT_EQ(strings, decoded);
+  EXPECT_EQ(strings.size(), decoded.capacity());
+
+  // Abusive sizes reserve no more than the remaining bytes could hold.
+  data = Compose(EncodingByte::Array, EncodingByte::U32, 0, 0, 0, 1,
+                 EncodingByte::F64, 0, 0, 0, 0, 0, 0, 0, 0);
+  Deserializer<PedanticBufferReader> abusive{data.data(), data.size()};
+  std::vector<double> values;
+  EXPECT_EQ(ErrorStatus::ReadLimitReached, abusive.Read(&values).error());
+  EXPECT_GE(1u, values.capacity());
+}
+
+TEST(BufferReader, FixedElementVector) {
+  std::vector<Sample> samples;
+  for (int i = 0; i < 1000; i++)
+    samples.push_back({i * 0.5, {{1.f * i, 2.f * i, 3.f * i}}});
+
+  // Readers that can peek decode fixed size elements from known offsets.
+  std::vector<std::uint8_t> data = Serialize(samples);
+  {
+    Deserializer<BufferReader> deserializer{data.data(), data.size()};
+    std::vector<Sample> decoded;
+    ASSERT_TRUE(deserializer.Read(&decoded));
+    EXPECT_EQ(samples, decoded);
+    EXPECT_TRUE(deserializer.reader().empty());
+  }
+  {
+    Deserializer<PedanticBufferReader> deserializer{data.data(), data.size()};
+    std::vector<Sample> decoded;
+    ASSERT_TRUE(deserializer.Read(&decoded));
+    EXPECT_EQ(samples, decoded);
+    EXPECT_TRUE(deserializer.reader().empty());
+  }
+
+  // Elements that do not occupy the fixed size fall back to decoding one
+  // element after the other from where the last fixed element ended.
+  data = Compose(EncodingByte::Array, 40);
+  std::vector<Sample> expected;
+  for (int i = 0; i < 40; i++) {
+    const Sample sample{i * 0.5, {{1.f, 2.f, 3.f}}};
+    expected.push_back(sample);
+
+    std::vector<std::uint8_t> element;
+    if (i == 20 || i == 37)
+      element = Serialize(BinarySample{sample.time, sample.position});
+    else
+      element = Serialize(sample);
+    data.insert(data.end(), element.begin(), element.end());
+  }
+  {
+    Deserializer<BufferReader> deserializer{data.data(), data.size()};
+    std::vector<Sample> decoded;
+    ASSERT_TRUE(deserializer.Read(&decoded));
+    EXPECT_EQ(expected, decoded);
+    EXPECT_TRUE(deserializer.reader().empty());
+  }
+
+  // Invalid and truncated elements report the same errors as the general loop.
+  data = Serialize(samples);
+  data[data.size() - 2 * Encoding<Sample>::Size(samples[0]) + 1] = 3;
+  {
+    Deserializer<PedanticBufferReader> deserializer{data.data(), data.size()};
+    std::vector<Sample> decoded;
+    EXPECT_EQ(ErrorStatus::InvalidMemberCount,
+              deserializer.Read(&decoded).error());
+    EXPECT_EQ(samples.size() - 2, decoded.size());
+  }
+
+  data = Serialize(samples);
+  data.pop_back();
+  {
+    Deserializer<PedanticBufferReader> deserializer{data.data(), data.size()};
+    std::vector<Sample> decoded;
+    EXPECT_EQ(ErrorStatus::ReadLimitReached,
+              deserializer.Read(&decoded).error());
+    EXPECT_EQ(samples.size() - 1, decoded.size());
+  }
+}
+
+TEST(ReuseStorage, Containers) {
+  const std::string long_a(64, 'a');
+  const std::string long_b(64, 'b');
+  const Inventory first{{long_a, long_b},
+                        {{"x", {1, 2, 3}}, {"y", {4}}},
+                        {{1, long_a}, {2, long_b}}};
+  const Inventory second{{long_b, long_a},
+                         {{"x", {5, 6}}, {"y", {7, 8, 9}}},
+                         {{1, long_b}, {2, long_a}}};
+
+  Inventory inventory;
+  std::vector<std::uint8_t> data = Serialize(first);
+  Deserializer<ReuseStorage<BufferReader>> deserializer{data.data(),
+                                                        data.size()};
+  ASSERT_TRUE(deserializer.Read(&inventory));
+  EXPECT_EQ(first, inventory);
+
+  // Decoding the same shape again reuses the nested storage.
+  const char* name = inventory.names[0].data();
+  const int* count = inventory.counts["x"].data();
+  const std::string* label = &inventory.labels[2];
+  const char* label_data = label->data();
+
+  data = Serialize(second);
+  deserializer = Deserializer<ReuseStorage<BufferReader>>{data.data(),
+                                                          data.size()};
+  ASSERT_TRUE(deserializer.Read(&inventory));
+  EXPECT_EQ(second, inventory);
+  EXPECT_EQ(name, inventory.names[0].data());
+  EXPECT_EQ(count, inventory.counts["x"].data());
+  EXPECT_EQ(label, &inventory.labels[2]);
+  EXPECT_EQ(label_data, inventory.labels[2].data());
+
+  // Elements and entries absent from the input are removed, and new ones are
+  // added.
+  const Inventory third{{long_a},
+                        {{"w", {1}}, {"y", {2}}, {"z", {3}}},
+                        {{2, long_a}, {3, long_b}, {4, ""}}};
+  data = Serialize(third);
+  deserializer = Deserializer<ReuseStorage<BufferReader>>{data.data(),
+                                                          data.size()};
+  ASSERT_TRUE(deserializer.Read(&inventory));
+  EXPECT_EQ(third, inventory);
+
+  const Inventory empty;
+  data = Serialize(empty);
+  deserializer = Deserializer<ReuseStorage<BufferReader>>{data.data(),
+                                                          data.size()};
+  ASSERT_TRUE(deserializer.Read(&inventory));
+  EXPECT_EQ(empty, inventory);
+}
+
+TEST(BufferReader, BorrowedPayloads) {
+  const std::string text(1000, 'x');
+  const std::vector<std::uint8_t> bytes(1000, 0xab);
+  const std::vector<std::uint32_t> words(1000, 0x01020304);
+
+  Serializer<VectorWriter> serializer;
+  ASSERT_TRUE(serializer.Write(text));
+  ASSERT_TRUE(serializer.Write(bytes));
+  ASSERT_TRUE(serializer.Write(words));
+  const std::vector<std::uint8_t> data = serializer.writer().Take();
+
+  Deserializer<BufferReader> deserializer{data.data(), data.size()};
+  std::string decoded_text = "old contents";
+  std::vector<std::uint8_t> decoded_bytes(10, 1);
+  UninitializedVector<std::uint32_t> decoded_words(10, 1);
+  ASSERT_TRUE(deserializer.Read(&decoded_text));
+  ASSERT_TRUE(deserializer.Read(&decoded_bytes));
+  ASSERT_TRUE(deserializer.Read(&decoded_words));
+  EXPECT_EQ(text, decoded_text);
+  EXPECT_EQ(bytes, decoded_bytes);
+  EXPECT_TRUE(std::equal(words.begin(), words.end(), decoded_words.begin(),
+                         decoded_words.end()));
+
+  // Bounded readers borrow from the underlying reader within their limit.
+  const std::size_t text_size = Encoding<std::string>::Size(text);
+  PedanticBufferReader reader{data.data(), data.size()};
+  BoundedReader<PedanticBufferReader> bounded{&reader, text_size - 1};
+  EXPECT_EQ(ErrorStatus::ReadLimitReached,
+            Encoding<std::string>::Read(&decoded_text, &bounded).error());
+
+  reader = PedanticBufferReader{data.data(), data.size()};
+  bounded = BoundedReader<PedanticBufferReader>{&reader, text_size};
+  decoded_text.clear();
+  ASSERT_TRUE(Encoding<std::string>::Read(&decoded_text, &bounded));
+  EXPECT_EQ(text, decoded_text);
+}
+
+TEST(CountingReader, Counts) {
+  const Record record{1, "name", {1, 2, 3}};
+  Serializer<VectorWriter> serializer;
+  ASSERT_TRUE(serializer.Write(record));
+  const VectorWriter& writer = serializer.writer();
+
+  BufferReader buffer_reader{writer.data(), writer.size()};
+  Deserializer<CountingReader<BufferReader>> deserializer{&buffer_reader};
+  Record result;
+  ASSERT_TRUE(deserializer.Read(&result));
+  EXPECT_EQ(record.name, result.name);
+  EXPECT_EQ(record.samples, result.samples);
+
+  // Every byte of the input passes through the counting reader.
+  EXPECT_EQ(writer.size(), deserializer.reader().stats().bytes());
+  EXPECT_EQ(0u, deserializer.reader().stats().errors);
+
+  // Borrowed payloads are counted as transfers without copying.
+  BufferReader view_reader{writer.data(), writer.size()};
+  Deserializer<CountingReader<BufferReader>> view_deserializer{&view_reader};
+  RecordView view;
+  ASSERT_TRUE(view_deserializer.Read(&view));
+  EXPECT_EQ(StringView{"name"}, view.name);
+  EXPECT_EQ(writer.size(), view_deserializer.reader().stats().bytes());
+  EXPECT_EQ(4u + 3u * sizeof(std::uint16_t),
+            view_deserializer.reader().stats().borrowed_bytes);
+
+  // Errors of the underlying reader are counted.
+  PedanticBufferReader short_reader{writer.data(), writer.size() - 1};
+  Deserializer<CountingReader<PedanticBufferReader>> short_deserializer{
+      &short_reader};
+  EXPECT_FALSE(short_deserializer.Read(&result));
+  EXPECT_LT(0u, short_deserializer.reader().stats().errors);
+}
+
+TEST(ScatterGatherReader, Read) {
+  Inventory inventory;
+  for (int i = 0; i < 100; i++) {
+    inventory.names.push_back("name" + std::to_string(i));
+    inventory.counts["count" + std::to_string(i)] = {i, i * 1000, -i};
+    inventory.labels[i * 100000] = std::string(i, 'x');
+  }
+  const Record record{0x123456789abcdef, "record", {1, 2, 3, 4, 5}};
+
+  Serializer<VectorWriter> serializer;
+  ASSERT_TRUE(serializer.Write(inventory));
+  ASSERT_TRUE(serializer.Write(record));
+  std::vector<std::uint8_t> data = serializer.writer().Take();
+
+  for (std::size_t chunk_size : {1, 2, 3, 7, 64, 4096, 1 << 20}) {
+    SCOPED_TRACE(chunk_size);
+    std::vector<iovec> segments = Split(&data, chunk_size);
+
+    Deserializer<ScatterGatherReader> deserializer{segments.data(),
+                                                   segments.size()};
+    EXPECT_EQ(data.size(), deserializer.reader().remaining());
+
+    Inventory decoded_inventory;
+    ASSERT_TRUE(deserializer.Read(&decoded_inventory));
+    EXPECT_EQ(inventory, decoded_inventory);
+
+    Record decoded_record;
+    ASSERT_TRUE(deserializer.Read(&decoded_record));
+    EXPECT_EQ(record.timestamp, decoded_record.timestamp);
+    EXPECT_EQ(record.name, decoded_record.name);
+    EXPECT_EQ(record.samples, decoded_record.samples);
+    EXPECT_TRUE(deserializer.reader().empty());
+  }
+}
+
+TEST(ScatterGatherReader, Errors) {
+  std::vector<std::uint8_t> data = Compose(EncodingByte::String, 5, "hello");
+  std::vector<iovec> segments = Split(&data, 2);
+
+  // Every truncation of the input fails instead of reading past the end.
+  for (std::size_t count = 0; count < segments.size() - 1; count++) {
+    Deserializer<ScatterGatherReader> deserializer{segments.data(), count};
+    std::string value;
+    EXPECT_EQ(ErrorStatus::ReadLimitReached, deserializer.Read(&value).error());
+  }
+
+  ScatterGatherReader reader{segments.data(), segments.size()};
+  EXPECT_EQ(data.size(), reader.remaining());
+  EXPECT_EQ(ErrorStatus::ReadLimitReached,
+            reader.Ensure(data.size() + 1).error());
+  EXPECT_TRUE(reader.Ensure(data.size()));
+
+  std::uint8_t bytes[4];
+  ASSERT_TRUE(reader.Skip(3));
+  ASSERT_TRUE(reader.Read(&bytes[0], &bytes[0] + 3));
+  EXPECT_EQ('e', bytes[0]);
+  EXPECT_EQ('l', bytes[1]);
+  EXPECT_EQ('l', bytes[2]);
+  EXPECT_EQ(ErrorStatus::ReadLimitReached,
+            reader.Read(&bytes[0], &bytes[0] + 2).error());
+  EXPECT_EQ(ErrorStatus::ReadLimitReached, reader.Skip(2).error());
+  ASSERT_TRUE(reader.Read(&bytes[3]));
+  EXPECT_EQ('o', bytes[3]);
+  EXPECT_TRUE(reader.empty());
+  EXPECT_EQ(ErrorStatus::ReadLimitReached, reader.Read(&bytes[0]).error());
+
+  ScatterGatherReader empty;
+  EXPECT_TRUE(empty.empty());
+  EXPECT_EQ(ErrorStatus::ReadLimitReached, empty.Read(&bytes[0]).error());
+}
@@ -0,0 +1,247 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+
+#include <nop/serializer.h>
+#include <nop/structure.h>
+#include <nop/utility/record_log.h>
+
+using nop::Deserializer;
+using nop::ErrorStatus;
+using nop::RecordLogReader;
+using nop::RecordLogWriter;
+using nop::Status;
+
+namespace {
+
+struct Event {
+  std::uint64_t sequence;
+  std::string name;
+  NOP_STRUCTURE(Event, sequence, name);
+};
+
+// Owns a temporary log path and removes the log and its index.
+class TemporaryLog {
+ public:
+  TemporaryLog() {
+    char path[] = "/tmp/nop_record_log_XXXXXX";
+    const int fd = ::mkstemp(path);
+    EXPECT_LE(0, fd);
+    ::close(fd);
+    path_ = path;
+  }
+
+  ~TemporaryLog() {
+    ::unlink(path_.c_str());
+    ::unlink(index_path().c_str());
+  }
+
+  const std::string& path() const { return path_; }
+  std::string index_path() const { return path_ + ".idx"; }
+
+ private:
+  std::string path_;
+};
+
+off_t FileSize(const std::string& path) {
+  struct stat stat_buf;
+  EXPECT_EQ(0, ::stat(path.c_str(), &stat_buf));
+  return stat_buf.st_size;
+}
+
+void AppendBytes(const std::string& path, const std::string& bytes) {
+  const int fd = ::open(path.c_str(), O_WRONLY | O_APPEND);
+  ASSERT_LE(0, fd);
+  EXPECT_EQ(static_cast<ssize_t>(bytes.size()),
+            ::write(fd, bytes.data(), bytes.size()));
+  ::close(fd);
+}
+
+Event MakeEvent(std::uint64_t sequence) {
+  return {sequence, "event" + std::to_string(sequence)};
+}
+
+}  // anonymous namespace
+
+TEST(RecordLog, RandomAccess) {
+  TemporaryLog log;
+  const std::size_t kCount = 1000;
+
+  {
+    auto writer = RecordLogWriter::Open(log.path());
+    ASSERT_TRUE(writer);
+    for (std::size_t i = 0; i < kCount; i++) {
+      auto status = writer.get().Append(MakeEvent(i), i * 10);
+      ASSERT_TRUE(status);
+      EXPECT_EQ(i, status.get());
+    }
+    EXPECT_EQ(kCount, writer.get().size());
+    EXPECT_TRUE(writer.get().Sync());
+  }
+
+  auto reader = RecordLogReader::Open(log.path());
+  ASSERT_TRUE(reader);
+  ASSERT_EQ(kCount, reader.get().size());
+
+  for (std::size_t i : {999u, 0u, 500u, 1u, 998u}) {
+    Event event;
+    ASSERT_TRUE(reader.get().Read(i, &event));
+    EXPECT_EQ(i, event.sequence);
+    EXPECT_EQ("event" + std::to_string(i), event.name);
+    EXPECT_EQ(i * 10, reader.get().key(i));
+
+    auto record = reader.get().Get(i);
+    ASSERT_TRUE(record);
+    Deserializer<nop::BufferReader*> deserializer{&record.get()};
+    Event borrowed;
+    ASSERT_TRUE(deserializer.Read(&borrowed));
+    EXPECT_EQ(i, borrowed.sequence);
+  }
+
+  EXPECT_EQ(0u, reader.get().Find(0));
+  EXPECT_EQ(50u, reader.get().Find(500));
+  EXPECT_EQ(51u, reader.get().Find(501));
+  EXPECT_EQ(kCount, reader.get().Find(kCount * 10));
+
+  // Reopening the writer appends after the existing records.
+  {
+    auto writer = RecordLogWriter::Open(log.path());
+    ASSERT_TRUE(writer);
+    EXPECT_EQ(kCount, writer.get().size());
+    auto status = writer.get().Append(MakeEvent(kCount), kCount * 10);
+    ASSERT_TRUE(status);
+    EXPECT_EQ(kCount, status.get());
+  }
+
+  // The existing reader does not see the new record; a new one does.
+  EXPECT_EQ(kCount, reader.get().size());
+  reader = RecordLogReader::Open(log.path());
+  ASSERT_TRUE(reader);
+  ASSERT_EQ(kCount + 1, reader.get().size());
+
+  Event event;
+  ASSERT_TRUE(reader.get().Read(kCount, &event));
+  EXPECT_EQ(kCount, event.sequence);
+}
+
+TEST(RecordLog, Recovery) {
+  TemporaryLog log;
+
+  off_t log_size;
+  {
+    auto writer = RecordLogWriter::Open(log.path());
+    ASSERT_TRUE(writer);
+    for (std::uint64_t i = 0; i < 3; i++)
+      ASSERT_TRUE(writer.get().Append(MakeEvent(i), i));
+    log_size = FileSize(log.path());
+  }
+
+  // A torn frame at the end of the log with no index entry and a torn entry at
+  // the end of the index.
+  AppendBytes(log.path(), std::string("\x10\x00\x00\x00\xb9", 5));
+  AppendBytes(log.index_path(), std::string(5, '\x00'));
+
+  {
+    auto writer = RecordLogWriter::Open(log.path());
+    ASSERT_TRUE(writer);
+    EXPECT_EQ(3u, writer.get().size());
+    EXPECT_EQ(log_size, FileSize(log.path()));
+    EXPECT_EQ(3 * 16, FileSize(log.index_path()));
+
+    ASSERT_TRUE(writer.get().Append(MakeEvent(3), 3));
+  }
+
+  // An index entry whose record never made it to the log.
+  std::string entry(16, '\x00');
+  const off_t end = FileSize(log.path());
+  for (int i = 0; i < 8; i++)
+    entry[i] = static_cast<char>((end + 100) >> (8 * i));
+  AppendBytes(log.index_path(), entry);
+
+  {
+    auto reader = RecordLogReader::Open(log.path());
+    ASSERT_TRUE(reader);
+    ASSERT_EQ(5u, reader.get().size());
+    Event event;
+    EXPECT_EQ(ErrorStatus::ProtocolError, reader.get().Read(4, &event).error());
+  }
+
+  // The writer refuses to recover an index that points past the log.
+  {
+    auto writer = RecordLogWriter::Open(log.path());
+    ASSERT_FALSE(writer);
+    EXPECT_EQ(ErrorStatus::ProtocolError, writer.error());
+  }
+
+  ASSERT_EQ(0, ::truncate(log.index_path().c_str(), 4 * 16));
+  auto reader = RecordLogReader::Open(log.path());
+  ASSERT_TRUE(reader);
+  ASSERT_EQ(4u, reader.get().size());
+  for (std::uint64_t i = 0; i < 4; i++) {
+    Event event;
+    ASSERT_TRUE(reader.get().Read(i, &event));
+    EXPECT_EQ(i, event.sequence);
+  }
+}
+
+TEST(RecordLog, Errors) {
+  TemporaryLog log;
+
+  EXPECT_EQ(ErrorStatus::IOError,
+            RecordLogWriter::Open("/nonexistent/dir/log").error());
+  EXPECT_EQ(ErrorStatus::IOError,
+            RecordLogReader::Open("/nonexistent/dir/log").error());
+
+  {
+    auto writer = RecordLogWriter::Open(log.path());
+    ASSERT_TRUE(writer);
+    ASSERT_TRUE(writer.get().Append(MakeEvent(0)));
+  }
+
+  auto reader = RecordLogReader::Open(log.path());
+  ASSERT_TRUE(reader);
+
+  Event event;
+  EXPECT_EQ(ErrorStatus::ReadLimitReached,
+            reader.get().Read(1, &event).error());
+  EXPECT_EQ(ErrorStatus::ReadLimitReached, reader.get().Get(1).error());
+
+  std::uint64_t sequence;
+  EXPECT_EQ(ErrorStatus::UnexpectedEncodingType,
+            reader.get().Read(0, &sequence).error());
+
+  // A record holding two values: FIXINT 1, FIXINT 2. Read() rejects the
+  // trailing byte.
+  const off_t offset = FileSize(log.path());
+  AppendBytes(log.path(), std::string("\x02\x00\x00\x00\x01\x02", 6));
+  std::string entry(16, '\x00');
+  entry[0] = static_cast<char>(offset);
+  AppendBytes(log.index_path(), entry);
+
+  reader = RecordLogReader::Open(log.path());
+  ASSERT_TRUE(reader);
+  ASSERT_EQ(2u, reader.get().size());
+  EXPECT_EQ(ErrorStatus::ProtocolError,
+            reader.get().Read(1, &sequence).error());
+  ASSERT_TRUE(reader.get().Get(1));
+  EXPECT_EQ(2u, reader.get().Get(1).get().remaining());
+}
@@ -0,0 +1,133 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include <nop/serializer.h>
+#include <nop/types/reduced_float.h>
+#include <nop/utility/pedantic_buffer_reader.h>
+#include <nop/utility/vector_writer.h>
+
+#include "test_utilities.h"
+
+using nop::BFloat16;
+using nop::Deserialize;
+using nop::ErrorStatus;
+using nop::Half;
+using nop::Serialize;
+
+namespace {
+
+// Returns the 16-bit patterns that |values| encode to.
+template <typename T>
+std::vector<std::uint16_t> Patterns(const std::vector<float>& values) {
+  std::vector<std::uint16_t> patterns;
+  EXPECT_TRUE(Deserialize(Serialize(T{values}), &patterns));
+  return patterns;
+}
+
+template <typename T>
+std::vector<float> RoundTrip(const std::vector<float>& values) {
+  T decoded;
+  EXPECT_TRUE(Deserialize(Serialize(T{values}), &decoded));
+  return decoded.get();
+}
+
+const float kInfinity = std::numeric_limits<float>::infinity();
+
+}  // anonymous namespace
+
+TEST(ReducedFloat, Half) {
+  EXPECT_EQ((std::vector<std::uint16_t>{0x0000, 0x8000, 0x3c00, 0xc000, 0x7bff,
+                                        0x7c00, 0xfc00, 0x0001, 0x0400}),
+            Patterns<Half<std::vector<float>>>(
+                {0.0f, -0.0f, 1.0f, -2.0f, 65504.0f, kInfinity, -kInfinity,
+                 std::ldexp(1.0f, -24), std::ldexp(1.0f, -14)}));
+
+  // Rounding to nearest even, overflow, and underflow.
+  EXPECT_EQ((std::vector<std::uint16_t>{0x3c00, 0x3c02, 0x3c01, 0x7c00,
+                                        0x7bff, 0x0000, 0x0001, 0x0002}),
+            Patterns<Half<std::vector<float>>>(
+                {1.0f + std::ldexp(1.0f, -11),
+                 1.0f + 3 * std::ldexp(1.0f, -11),
+                 1.0f + std::ldexp(1.0f, -11) + std::ldexp(1.0f, -20),
+                 65520.0f, 65519.0f, std::ldexp(1.0f, -25),
+                 std::ldexp(1.5f, -25), std::ldexp(1.5f, -24)}));
+
+  // Every half precision value round trips exactly.
+  std::vector<float> values;
+  for (std::uint32_t bits = 0; bits <= 0xffff; bits++) {
+    if ((bits & 0x7c00) != 0x7c00 || (bits & 0x3ff) == 0)
+      values.push_back(nop::detail::HalfToFloat(bits));
+  }
+  const auto decoded = RoundTrip<Half<std::vector<float>>>(values);
+  ASSERT_EQ(values.size(), decoded.size());
+  for (std::size_t i = 0; i < values.size(); i++) {
+    EXPECT_EQ(std::signbit(values[i]), std::signbit(decoded[i]));
+    EXPECT_EQ(values[i], decoded[i]);
+  }
+
+  EXPECT_TRUE(std::isnan(RoundTrip<Half<std::vector<float>>>(
+      {std::numeric_limits<float>::quiet_NaN()})[0]));
+}
+
+TEST(ReducedFloat, BFloat16) {
+  EXPECT_EQ((std::vector<std::uint16_t>{0x0000, 0x8000, 0x3f80, 0x7f80,
+                                        0x3f80, 0x3f82, 0x7f7f}),
+            Patterns<BFloat16<std::vector<float>>>(
+                {0.0f, -0.0f, 1.0f, kInfinity, 1.0f + std::ldexp(1.0f, -8),
+                 1.0f + 3 * std::ldexp(1.0f, -8),
+                 std::numeric_limits<float>::max() * 0.995f}));
+
+  const std::vector<float> values = {1.5f, -3.25f, 1e30f, -1e-30f, 0.0f};
+  const auto decoded = RoundTrip<BFloat16<std::vector<float>>>(values);
+  ASSERT_EQ(values.size(), decoded.size());
+  for (std::size_t i = 0; i < values.size(); i++)
+    EXPECT_NEAR(values[i], decoded[i], std::fabs(values[i]) / 128);
+
+  EXPECT_TRUE(std::isnan(RoundTrip<BFloat16<std::vector<float>>>(
+      {std::numeric_limits<float>::quiet_NaN()})[0]));
+}
+
+TEST(ReducedFloat, Containers) {
+  // The encoding is half the size of the BIN encoding of float.
+  const std::vector<float> values(1000, 0.5f);
+  EXPECT_EQ(2004u, Serialize(Half<std::vector<float>>{values}).size());
+  EXPECT_EQ(4004u, Serialize(nop::Binary<std::vector<float>>{values}).size());
+
+  BFloat16<std::array<float, 3>> array;
+  const auto data = Serialize(BFloat16<std::vector<float>>{{1.0f, 2.0f, 3.0f}});
+  ASSERT_TRUE(Deserialize(data, &array));
+  EXPECT_EQ((std::array<float, 3>{{1.0f, 2.0f, 3.0f}}), array.get());
+
+  BFloat16<std::array<float, 4>> mismatched;
+  EXPECT_EQ(ErrorStatus::InvalidContainerLength,
+            Deserialize(data, &mismatched).error());
+
+  Half<std::vector<float>> vector;
+  EXPECT_EQ(ErrorStatus::InvalidContainerLength,
+            Deserialize(std::vector<std::uint8_t>{0xbc, 0x03, 0x00, 0x00, 0x00},
+                        &vector)
+                .error());
+  EXPECT_EQ(ErrorStatus::ReadLimitReached,
+            Deserialize(std::vector<std::uint8_t>{0xbc, 0x04, 0x00, 0x00},
+                        &vector)
+                .error());
+}
@@ -269,12 +269,13 @@ TEST(Result, Constructor) {
   }
 
   {
+    // Result<E, void> is trivially copyable; moving copies the error.
     Result<TestError, void> other{TestError::ErrorA};
     Result<TestError, void> result{std::move(other)};
     EXPECT_TRUE(result.has_error());
     EXPECT_EQ(TestError::ErrorA, result.error());
-    EXPECT_FALSE(other.has_error());
-    EXPECT_EQ(TestError::None, other.error());
+    EXPECT_TRUE(other.has_error());
+    EXPECT_EQ(TestError::ErrorA, other.error());
   }
 
   {
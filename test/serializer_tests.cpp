@@ -16,18 +16,26 @@
 #include <gtest/gtest.h>
 
 #include <algorithm>
+#include <array>
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
 #include <functional>
+#include <iterator>
 #include <limits>
+#include <list>
 #include <memory>
+#include <set>
+#include <string>
+#include <tuple>
 #include <vector>
 
 #include <nop/base/utility.h>
 #include <nop/serializer.h>
 #include <nop/structure.h>
 #include <nop/table.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/pedantic_buffer_writer.h>
 #include <nop/value.h>
 
 #include "mock_reader.h"
@@ -37,18 +45,27 @@
 #include "test_writer.h"
 
 using nop::Append;
+using nop::Binary;
+using nop::BufferReader;
 using nop::Compose;
 using nop::DefaultHandlePolicy;
 using nop::DeletedEntry;
+using nop::DecodeRaw;
 using nop::Deserializer;
 using nop::EnableIfIntegral;
 using nop::Encoding;
+using nop::EncodeRaw;
 using nop::EncodingByte;
 using nop::Entry;
 using nop::ErrorStatus;
+using nop::FixedEncodingSize;
 using nop::Float;
+using nop::Generator;
 using nop::Handle;
 using nop::Integer;
+using nop::MakeRange;
+using nop::PedanticBufferWriter;
+using nop::RawEncoded;
 using nop::Serializer;
 using nop::Status;
 using nop::TestReader;
@@ -89,6 +106,11 @@ enum class EnumA : std::uint8_t {
   D = 255,
 };
 
+enum class EnumB : std::uint16_t {
+  A = 1,
+  B = 0x1234,
+};
+
 struct TestB {
   TestA a;
   EnumA b;
@@ -242,6 +264,52 @@ struct TableA2 {
   NOP_TABLE_HASH(15, TableA2, name, attributes, address);
 };
 
+struct TableB1 {
+  Entry<TableA1, 0> inner;
+  Entry<std::vector<TableA1>, 1> list;
+
+  NOP_TABLE_HASH(16, TableB1, inner, list);
+};
+
+struct TableB2 {
+  Entry<TableB1, 0> inner;
+  Entry<std::string, 1> label;
+
+  NOP_TABLE_HASH(17, TableB2, inner, label);
+};
+
+// Entry ids that are neither dense nor in declaration order.
+struct TableC {
+  Entry<std::uint32_t, 100> a;
+  Entry<std::uint32_t, 5> b;
+  Entry<std::uint32_t, (1ULL << 40)> c;
+  Entry<std::uint32_t, 1> d;
+
+  NOP_TABLE_HASH(18, TableC, a, b, c, d);
+};
+
+// Wraps a table with an encoding that serializes the table on its own to
+// compute its size, nesting a write in the size pass of an enclosing table.
+struct EncodedOnSize {
+  TableA1 value;
+};
+
+struct TableD1 {
+  Entry<int, 0> a;
+  Entry<EncodedOnSize, 1> b;
+  Entry<std::string, 2> c;
+
+  NOP_TABLE_HASH(19, TableD1, a, b, c);
+};
+
+struct TableD2 {
+  Entry<int, 0> a;
+  Entry<TableA1, 1> b;
+  Entry<std::string, 2> c;
+
+  NOP_TABLE_HASH(19, TableD2, a, b, c);
+};
+
 template <typename T>
 struct ValueWrapper {
   T value;
@@ -280,8 +348,55 @@ auto MakeCDynamicArray(const T (&data)[Size]) {
   return value;
 }
 
+struct FixedPoint {
+  float x;
+  float y;
+  bool valid;
+  std::array<std::uint16_t, 3> color;
+  NOP_STRUCTURE(FixedPoint, x, y, valid, color);
+};
+
+struct VariablePoint {
+  float x;
+  int id;
+  NOP_STRUCTURE(VariablePoint, x, id);
+};
+
 }  // anonymous namespace
 
+namespace nop {
+
+template <>
+struct Encoding<EncodedOnSize> : EncodingIO<EncodedOnSize> {
+  static constexpr EncodingByte Prefix(const EncodedOnSize& value) {
+    return Encoding<TableA1>::Prefix(value.value);
+  }
+
+  static std::size_t Size(const EncodedOnSize& value) {
+    TestWriter writer;
+    auto status = Serializer<TestWriter*>{&writer}.Write(value.value);
+    return status ? writer.data().size() : Encoding<TableA1>::Size(value.value);
+  }
+
+  static constexpr bool Match(EncodingByte prefix) {
+    return Encoding<TableA1>::Match(prefix);
+  }
+
+  template <typename Writer>
+  static Status<void> WritePayload(EncodingByte prefix,
+                                   const EncodedOnSize& value, Writer* writer) {
+    return Encoding<TableA1>::WritePayload(prefix, value.value, writer);
+  }
+
+  template <typename Reader>
+  static Status<void> ReadPayload(EncodingByte prefix, EncodedOnSize* value,
+                                  Reader* reader) {
+    return Encoding<TableA1>::ReadPayload(prefix, &value->value, reader);
+  }
+};
+
+}  // namespace nop
+
 #if 0
 // This test verifies that the compiler outputs a custom error message when an
 // unsupported type is pass to the serializer.
@@ -835,6 +950,261 @@ TEST(Deserializer, Vector) {
   }
 }
 
+TEST(Serializer, BinaryFloat) {
+  std::vector<std::uint8_t> expected;
+  TestWriter writer;
+  Serializer<TestWriter*> serializer{&writer};
+  Status<void> status;
+
+  {
+    Binary<std::vector<float>> value{{1.0f, 2.0f, 3.0f}};
+
+    status = serializer.Write(value);
+    ASSERT_TRUE(status);
+
+    expected = Compose(EncodingByte::Binary, 3 * sizeof(float), Float(1.0f),
+                       Float(2.0f), Float(3.0f));
+    EXPECT_EQ(expected, writer.data());
+    EXPECT_EQ(expected.size(), serializer.GetSize(value));
+    writer.clear();
+  }
+
+  {
+    Binary<std::array<double, 2>> value{{{1.0, 2.0}}};
+
+    status = serializer.Write(value);
+    ASSERT_TRUE(status);
+
+    expected = Compose(EncodingByte::Binary, 2 * sizeof(double), Float(1.0),
+                       Float(2.0));
+    EXPECT_EQ(expected, writer.data());
+    writer.clear();
+  }
+
+  {
+    Binary<std::vector<double>> value;
+
+    status = serializer.Write(value);
+    ASSERT_TRUE(status);
+
+    expected = Compose(EncodingByte::Binary, 0);
+    EXPECT_EQ(expected, writer.data());
+    writer.clear();
+  }
+}
+
+TEST(Deserializer, BinaryFloat) {
+  TestReader reader;
+  Deserializer<TestReader*> deserializer{&reader};
+  Status<void> status;
+
+  const std::vector<std::uint8_t> binary = Compose(
+      EncodingByte::Binary, 2 * sizeof(float), Float(1.0f), Float(2.0f));
+  const std::vector<std::uint8_t> array =
+      Compose(EncodingByte::Array, 2, EncodingByte::F32, Float(1.0f),
+              EncodingByte::F32, Float(2.0f));
+  const std::vector<float> expected = {1.0f, 2.0f};
+
+  // Binary<T> accepts both encodings.
+  {
+    reader.Set(binary);
+
+    Binary<std::vector<float>> value;
+    status = deserializer.Read(&value);
+    ASSERT_TRUE(status);
+    EXPECT_EQ(expected, value.get());
+  }
+
+  {
+    reader.Set(array);
+
+    Binary<std::vector<float>> value;
+    status = deserializer.Read(&value);
+    ASSERT_TRUE(status);
+    EXPECT_EQ(expected, value.get());
+  }
+
+  // Plain floating point containers accept the BIN encoding.
+  {
+    reader.Set(binary);
+
+    std::vector<float> value;
+    status = deserializer.Read(&value);
+    ASSERT_TRUE(status);
+    EXPECT_EQ(expected, value);
+  }
+
+  {
+    reader.Set(binary);
+
+    std::array<float, 2> value;
+    status = deserializer.Read(&value);
+    ASSERT_TRUE(status);
+    EXPECT_EQ(expected, std::vector<float>(value.begin(), value.end()));
+  }
+
+  {
+    reader.Set(binary);
+
+    std::array<float, 3> value;
+    status = deserializer.Read(&value);
+    EXPECT_EQ(ErrorStatus::InvalidContainerLength, status.error());
+  }
+
+  {
+    reader.Set(Compose(EncodingByte::Binary, 3, 1, 2, 3));
+
+    std::vector<float> value;
+    status = deserializer.Read(&value);
+    EXPECT_EQ(ErrorStatus::InvalidContainerLength, status.error());
+  }
+
+  // Non-floating point containers still reject the BIN encoding.
+  {
+    reader.Set(Compose(EncodingByte::Binary, 3, "abc"));
+
+    std::vector<std::string> value;
+    status = deserializer.Read(&value);
+    EXPECT_EQ(ErrorStatus::UnexpectedEncodingType, status.error());
+  }
+}
+
+TEST(Serializer, BinaryEnum) {
+  std::vector<std::uint8_t> expected;
+  TestWriter writer;
+  Serializer<TestWriter*> serializer{&writer};
+  Status<void> status;
+
+  {
+    Binary<std::vector<EnumB>> value{{EnumB::A, EnumB::B, EnumB::A}};
+
+    status = serializer.Write(value);
+    ASSERT_TRUE(status);
+
+    expected =
+        Compose(EncodingByte::Binary, 3 * sizeof(EnumB),
+                Integer<std::uint16_t>(1), Integer<std::uint16_t>(0x1234),
+                Integer<std::uint16_t>(1));
+    EXPECT_EQ(expected, writer.data());
+    EXPECT_EQ(expected.size(), serializer.GetSize(value));
+    writer.clear();
+  }
+
+  {
+    Binary<std::array<EnumA, 2>> value{{{EnumA::C, EnumA::A}}};
+
+    status = serializer.Write(value);
+    ASSERT_TRUE(status);
+
+    expected = Compose(EncodingByte::Binary, 2, 128, 1);
+    EXPECT_EQ(expected, writer.data());
+    EXPECT_EQ(expected.size(),
+              (FixedEncodingSize<Binary<std::array<EnumA, 2>>>::value));
+    writer.clear();
+  }
+
+  // Plain enumeration containers keep the ARY encoding.
+  {
+    std::vector<EnumA> value{EnumA::C, EnumA::A};
+
+    status = serializer.Write(value);
+    ASSERT_TRUE(status);
+
+    expected = Compose(EncodingByte::Array, 2, EncodingByte::U8, 128, 1);
+    EXPECT_EQ(expected, writer.data());
+    writer.clear();
+  }
+}
+
+TEST(Deserializer, BinaryEnum) {
+  TestReader reader;
+  Deserializer<TestReader*> deserializer{&reader};
+  Status<void> status;
+
+  const std::vector<std::uint8_t> binary =
+      Compose(EncodingByte::Binary, 2 * sizeof(EnumB),
+              Integer<std::uint16_t>(0x1234), Integer<std::uint16_t>(1));
+  const std::vector<std::uint8_t> array =
+      Compose(EncodingByte::Array, 2, EncodingByte::U16,
+              Integer<std::uint16_t>(0x1234), 1);
+  const std::vector<EnumB> expected = {EnumB::B, EnumB::A};
+
+  // Binary<T> and plain enumeration containers accept both encodings.
+  for (const auto& data : {binary, array}) {
+    reader.Set(data);
+    Binary<std::vector<EnumB>> binary_value;
+    status = deserializer.Read(&binary_value);
+    ASSERT_TRUE(status);
+    EXPECT_EQ(expected, binary_value.get());
+
+    reader.Set(data);
+    std::vector<EnumB> vector_value;
+    status = deserializer.Read(&vector_value);
+    ASSERT_TRUE(status);
+    EXPECT_EQ(expected, vector_value);
+
+    reader.Set(data);
+    std::array<EnumB, 2> array_value;
+    status = deserializer.Read(&array_value);
+    ASSERT_TRUE(status);
+    EXPECT_EQ(expected,
+              std::vector<EnumB>(array_value.begin(), array_value.end()));
+  }
+
+  {
+    reader.Set(binary);
+
+    std::array<EnumB, 3> value;
+    status = deserializer.Read(&value);
+    EXPECT_EQ(ErrorStatus::InvalidContainerLength, status.error());
+  }
+
+  {
+    reader.Set(Compose(EncodingByte::Binary, 3, 1, 2, 3));
+
+    std::vector<EnumB> value;
+    status = deserializer.Read(&value);
+    EXPECT_EQ(ErrorStatus::InvalidContainerLength, status.error());
+  }
+}
+
+TEST(Serializer, FixedEncodingSize) {
+  static_assert(FixedEncodingSize<bool>::value == 1, "");
+  static_assert(FixedEncodingSize<float>::value == 5, "");
+  static_assert(FixedEncodingSize<double>::value == 9, "");
+  static_assert(FixedEncodingSize<int>::value == 0, "");
+  static_assert(FixedEncodingSize<std::array<std::uint16_t, 3>>::value == 8,
+                "");
+  static_assert(FixedEncodingSize<std::array<float, 2>>::value == 12, "");
+  static_assert(FixedEncodingSize<std::array<int, 2>>::value == 10, "");
+  static_assert(FixedEncodingSize<std::array<std::string, 2>>::value == 0, "");
+  static_assert(FixedEncodingSize<std::pair<float, bool>>::value == 8, "");
+  static_assert(FixedEncodingSize<std::tuple<double, float>>::value == 16, "");
+  static_assert(FixedEncodingSize<FixedPoint>::value == 21, "");
+  static_assert(FixedEncodingSize<VariablePoint>::value == 0, "");
+  static_assert(FixedEncodingSize<std::vector<float>>::value == 0, "");
+
+  TestWriter writer;
+  Serializer<TestWriter*> serializer{&writer};
+
+  // The short-circuited sizes match the number of bytes written.
+  const std::vector<FixedPoint> points(300, FixedPoint{1.0f, 2.0f, true, {}});
+  ASSERT_TRUE(serializer.Write(points));
+  EXPECT_EQ(writer.data().size(), serializer.GetSize(points));
+  EXPECT_EQ(1u + 3u + 300u * 21u, writer.data().size());
+  writer.clear();
+
+  const std::array<FixedPoint, 2> point_array{};
+  ASSERT_TRUE(serializer.Write(point_array));
+  EXPECT_EQ(writer.data().size(), serializer.GetSize(point_array));
+  writer.clear();
+
+  const std::vector<VariablePoint> variable_points{{1.0f, 1}, {2.0f, 1000}};
+  ASSERT_TRUE(serializer.Write(variable_points));
+  EXPECT_EQ(writer.data().size(), serializer.GetSize(variable_points));
+  writer.clear();
+}
+
 TEST(Serializer, IntegerStdArrayFailOnPrepare) {
   MockWriter writer;
   Serializer<MockWriter*> serializer{&writer};
@@ -6635,6 +7005,25 @@ TEST(Serializer, TableA2FailOnWriteEntryStringPayload) {
   EXPECT_TRUE(status);
 }
 
+TEST(Deserializer, TableSparseIds) {
+  TestReader reader;
+  Deserializer<TestReader*> deserializer{&reader};
+
+  // Entries in a different order than declared, with an unknown id 6 that is
+  // skipped.
+  reader.Set(Compose(EncodingByte::Table, 18, 5, 1, 1, 4, EncodingByte::U64,
+                     Integer<std::uint64_t>(1ULL << 40), 1, 3, 6, 2, 0, 0, 5,
+                     1, 2, 100, 1, 1));
+
+  TableC value;
+  ASSERT_TRUE(deserializer.Read(&value));
+  ASSERT_TRUE(value.a && value.b && value.c && value.d);
+  EXPECT_EQ(1u, value.a.get());
+  EXPECT_EQ(2u, value.b.get());
+  EXPECT_EQ(3u, value.c.get());
+  EXPECT_EQ(4u, value.d.get());
+}
+
 TEST(Deserializer, TableFailOnReadPrefix) {
   MockReader reader;
   Deserializer<MockReader*> deserializer{&reader};
@@ -7010,6 +7399,78 @@ TEST(Serializer, Table) {
   }
 }
 
+TEST(Serializer, NestedTable) {
+  TestWriter writer;
+  Serializer<TestWriter*> serializer{&writer};
+
+  TableB1 inner;
+  inner.inner = TableA1{"Ron"};
+  inner.list = std::vector<TableA1>{TableA1{"Ron"}, TableA1{"Ron"}};
+
+  TableB2 value;
+  value.inner = std::move(inner);
+  value.label = std::string{"x"};
+
+  const auto a1 = Compose(EncodingByte::Table, 15, 1, 0, 5,
+                          EncodingByte::String, 3, "Ron");
+  const auto b1 = Compose(EncodingByte::Table, 16, 2, 0, 10, a1, 1, 22,
+                          EncodingByte::Array, 2, a1, a1);
+  const auto expected = Compose(EncodingByte::Table, 17, 2, 0, 39, b1, 1, 3,
+                                EncodingByte::String, 1, "x");
+
+  // Entry sizes recorded while computing the total size are used when writing
+  // the nested entries.
+  ASSERT_TRUE(serializer.Write(value));
+  EXPECT_EQ(expected, writer.data());
+  EXPECT_EQ(expected.size(), serializer.GetSize(value));
+  writer.clear();
+
+  // Each write records the sizes of the current value.
+  value.label = std::string{"xyz"};
+  ASSERT_TRUE(serializer.Write(value));
+  EXPECT_EQ(Compose(EncodingByte::Table, 17, 2, 0, 39, b1, 1, 5,
+                    EncodingByte::String, 3, "xyz"),
+            writer.data());
+  writer.clear();
+
+  // Writing a table directly with the encoding computes the entry sizes.
+  ASSERT_TRUE(nop::Encoding<TableB2>::Write(value, &writer));
+  EXPECT_EQ(Compose(EncodingByte::Table, 17, 2, 0, 39, b1, 1, 5,
+                    EncodingByte::String, 3, "xyz"),
+            writer.data());
+}
+
+TEST(Serializer, NestedWriteInTableSize) {
+  TestWriter writer;
+  Serializer<TestWriter*> serializer{&writer};
+
+  TableD1 value;
+  value.a = 1;
+  value.b = EncodedOnSize{TableA1{"Ron", {"a", "b"}}};
+  value.c = std::string{"x"};
+
+  TableD2 expected_value;
+  expected_value.a = 1;
+  expected_value.b = TableA1{"Ron", {"a", "b"}};
+  expected_value.c = std::string{"x"};
+
+  TestWriter expected;
+  ASSERT_TRUE(Serializer<TestWriter*>{&expected}.Write(expected_value));
+
+  // The size pass of the outer table serializes the inner table on its own.
+  // The nested write must not disturb the entry sizes recorded by the outer
+  // write.
+  ASSERT_TRUE(serializer.Write(value));
+  EXPECT_EQ(expected.data(), writer.data());
+  writer.clear();
+
+  ASSERT_TRUE(serializer.Write(std::vector<TableD1>{value, value}));
+  expected.clear();
+  ASSERT_TRUE(Serializer<TestWriter*>{&expected}.Write(
+      std::vector<TableD2>{expected_value, expected_value}));
+  EXPECT_EQ(expected.data(), writer.data());
+}
+
 TEST(Deserializer, Table) {
   TestReader reader;
   Deserializer<TestReader*> deserializer{&reader};
@@ -7358,6 +7819,68 @@ TEST(Deserializer, Variant) {
   }
 }
 
+TEST(Serializer, VariantManyElements) {
+  using Type = Variant<std::int8_t, std::uint8_t, std::int16_t, std::uint16_t,
+                       std::int32_t, std::uint32_t, std::int64_t,
+                       std::uint64_t, float, double, bool, std::string,
+                       std::vector<int>, std::vector<std::string>>;
+  TestWriter writer;
+  Serializer<TestWriter*> serializer{&writer};
+
+  {
+    Type value{std::vector<std::string>{"a", "b"}};
+    ASSERT_TRUE(serializer.Write(value));
+
+    const auto expected =
+        Compose(EncodingByte::Variant, 13, EncodingByte::Array, 2,
+                EncodingByte::String, 1, "a", EncodingByte::String, 1, "b");
+    EXPECT_EQ(expected, writer.data());
+    EXPECT_EQ(expected.size(), Encoding<Type>::Size(value));
+    writer.clear();
+  }
+
+  {
+    Type value{std::string{"foo"}};
+    ASSERT_TRUE(serializer.Write(value));
+
+    const auto expected =
+        Compose(EncodingByte::Variant, 11, EncodingByte::String, 3, "foo");
+    EXPECT_EQ(expected, writer.data());
+    EXPECT_EQ(expected.size(), Encoding<Type>::Size(value));
+    writer.clear();
+  }
+}
+
+TEST(Deserializer, VariantManyElements) {
+  using Type = Variant<std::int8_t, std::uint8_t, std::int16_t, std::uint16_t,
+                       std::int32_t, std::uint32_t, std::int64_t,
+                       std::uint64_t, float, double, bool, std::string,
+                       std::vector<int>, std::vector<std::string>>;
+  TestReader reader;
+  Deserializer<TestReader*> deserializer{&reader};
+
+  Type value{std::string{"foo"}};
+  reader.Set(Compose(EncodingByte::Variant, 13, EncodingByte::Array, 2,
+                     EncodingByte::String, 1, "a", EncodingByte::String, 1,
+                     "b", EncodingByte::Variant, 10, EncodingByte::True,
+                     EncodingByte::Variant, -1, EncodingByte::Nil,
+                     EncodingByte::Variant, 14));
+
+  ASSERT_TRUE(deserializer.Read(&value));
+  ASSERT_TRUE(value.is<std::vector<std::string>>());
+  EXPECT_EQ((std::vector<std::string>{"a", "b"}), std::get<13>(value));
+
+  ASSERT_TRUE(deserializer.Read(&value));
+  ASSERT_TRUE(value.is<bool>());
+  EXPECT_TRUE(std::get<bool>(value));
+
+  ASSERT_TRUE(deserializer.Read(&value));
+  EXPECT_TRUE(value.empty());
+
+  EXPECT_EQ(ErrorStatus::UnexpectedVariantType,
+            deserializer.Read(&value).error());
+}
+
 TEST(Serializer, Value) {
   std::vector<std::uint8_t> expected;
   TestWriter writer;
@@ -7813,3 +8336,299 @@ TEST(Deserializer, reference_wrapper) {
     EXPECT_EQ(expected, value);
   }
 }
+
+TEST(Serializer, RawEncoded) {
+  std::vector<std::uint8_t> expected;
+  TestWriter writer;
+  Serializer<TestWriter*> serializer{&writer};
+
+  {
+    auto raw = EncodeRaw(TestA{10, "foo"});
+    ASSERT_TRUE(raw);
+    expected =
+        Compose(EncodingByte::Structure, 2, 10, EncodingByte::String, 3, "foo");
+    EXPECT_EQ(expected, raw.get().bytes());
+    EXPECT_EQ(expected.size(), Encoding<RawEncoded<TestA>>::Size(raw.get()));
+
+    // The bytes are embedded verbatim, here as the first element of a pair.
+    ASSERT_TRUE(serializer.Write(std::make_pair(raw.get(), 20)));
+    expected = Compose(EncodingByte::Array, 2, EncodingByte::Structure, 2, 10,
+                       EncodingByte::String, 3, "foo", 20);
+    EXPECT_EQ(expected, writer.data());
+    writer.clear();
+  }
+
+  {
+    RawEncoded<TestA> empty;
+    auto status = serializer.Write(empty);
+    ASSERT_FALSE(status);
+    EXPECT_EQ(ErrorStatus::UnexpectedEncodingType, status.error());
+    writer.clear();
+  }
+}
+
+TEST(Deserializer, RawEncoded) {
+  TestReader reader;
+  Deserializer<TestReader*> deserializer{&reader};
+  Status<void> status;
+
+  {
+    const std::vector<std::uint8_t> encoded =
+        Compose(EncodingByte::Structure, 2, 10, EncodingByte::String, 3, "foo");
+    reader.Set(Compose(encoded, 20));
+
+    RawEncoded<TestA> raw;
+    status = deserializer.Read(&raw);
+    ASSERT_TRUE(status);
+    EXPECT_EQ(encoded, raw.bytes());
+
+    // The reader is left at the following value.
+    int value = 0;
+    ASSERT_TRUE(deserializer.Read(&value));
+    EXPECT_EQ(20, value);
+
+    TestA decoded;
+    ASSERT_TRUE(DecodeRaw(raw, &decoded));
+    EXPECT_EQ((TestA{10, "foo"}), decoded);
+  }
+
+  {
+    // Nested in an optional, the prefix is read before the raw value.
+    reader.Set(Compose(EncodingByte::String, 3, "bar"));
+    nop::Optional<RawEncoded<std::string>> raw;
+    status = deserializer.Read(&raw);
+    ASSERT_TRUE(status);
+    ASSERT_FALSE(raw.empty());
+    EXPECT_EQ(Compose(EncodingByte::String, 3, "bar"), raw.get().bytes());
+  }
+
+  {
+    // The prefix must match the encoded type.
+    reader.Set(Compose(EncodingByte::String, 3, "foo"));
+    RawEncoded<TestA> raw;
+    status = deserializer.Read(&raw);
+    ASSERT_FALSE(status);
+    EXPECT_EQ(ErrorStatus::UnexpectedEncodingType, status.error());
+  }
+
+  {
+    // Truncated values are rejected.
+    reader.Set(Compose(EncodingByte::Structure, 2, 10, EncodingByte::String, 3,
+                       "fo"));
+    RawEncoded<TestA> raw;
+    EXPECT_FALSE(deserializer.Read(&raw));
+  }
+}
+
+TEST(Serializer, Range) {
+  TestWriter writer;
+  Serializer<TestWriter*> serializer{&writer};
+
+  // Encodes the same as the equivalent vector.
+  auto expect_same_as_vector = [&](const auto& range, const auto& vector) {
+    using RangeType = std::decay_t<decltype(range)>;
+    using VectorType = std::decay_t<decltype(vector)>;
+    ASSERT_TRUE(serializer.Write(vector));
+    const std::vector<std::uint8_t> expected = writer.data();
+    writer.clear();
+
+    ASSERT_TRUE(serializer.Write(range));
+    EXPECT_EQ(expected, writer.data());
+    EXPECT_EQ(Encoding<VectorType>::Size(vector),
+              Encoding<RangeType>::Size(range));
+    writer.clear();
+  };
+
+  const std::list<std::string> strings{"a", "bc", std::string(300, 'd')};
+  expect_same_as_vector(
+      MakeRange(strings),
+      std::vector<std::string>{strings.begin(), strings.end()});
+
+  // Integral elements use the BIN encoding, written in batches.
+  std::set<std::uint32_t> integers;
+  for (std::uint32_t i = 0; i < 1000; i++)
+    integers.insert(i * 7);
+  expect_same_as_vector(
+      MakeRange(integers),
+      std::vector<std::uint32_t>{integers.begin(), integers.end()});
+
+  const std::vector<TestA> structures{{1, "a"}, {2, "b"}};
+  expect_same_as_vector(MakeRange(structures.begin() + 1, structures.end()),
+                        std::vector<TestA>{{2, "b"}});
+  expect_same_as_vector(MakeRange(std::vector<float>{}), std::vector<float>{});
+
+  // Flags are bit-packed like std::vector<bool>, across several batches.
+  std::vector<bool> flags;
+  for (std::size_t i = 0; i < 4100; i++)
+    flags.push_back(i % 3 == 0);
+  expect_same_as_vector(MakeRange(flags), flags);
+  expect_same_as_vector(MakeRange(flags.begin(), flags.begin() + 9),
+                        std::vector<bool>{flags.begin(), flags.begin() + 9});
+  expect_same_as_vector(MakeRange(std::vector<bool>{}), std::vector<bool>{});
+
+  // The receiving side reads a vector.
+  ASSERT_TRUE(serializer.Write(MakeRange(integers)));
+  TestReader reader;
+  reader.Set(writer.data());
+  std::vector<std::uint32_t> decoded;
+  ASSERT_TRUE(Deserializer<TestReader*>{&reader}.Read(&decoded));
+  EXPECT_EQ((std::vector<std::uint32_t>{integers.begin(), integers.end()}),
+            decoded);
+}
+
+TEST(Serializer, Generator) {
+  TestWriter writer;
+  Serializer<TestWriter*> serializer{&writer};
+
+  {
+    Generator<TestA> generator{3, [](std::size_t index, TestA* element) {
+                                 *element = TestA{static_cast<int>(index),
+                                                  std::string(index, 'x')};
+                                 return Status<void>{};
+                               }};
+    const std::vector<TestA> expected_value{{0, ""}, {1, "x"}, {2, "xx"}};
+    ASSERT_TRUE(serializer.Write(expected_value));
+    const std::vector<std::uint8_t> expected = writer.data();
+    writer.clear();
+
+    ASSERT_TRUE(serializer.Write(generator));
+    EXPECT_EQ(expected, writer.data());
+    EXPECT_EQ(expected.size(), Encoding<Generator<TestA>>::Size(generator));
+    writer.clear();
+  }
+
+  {
+    Generator<std::int16_t> generator{
+        600, [](std::size_t index, std::int16_t* element) {
+          *element = static_cast<std::int16_t>(-static_cast<int>(index));
+          return Status<void>{};
+        }};
+    std::vector<std::int16_t> expected_value;
+    for (int i = 0; i < 600; i++)
+      expected_value.push_back(static_cast<std::int16_t>(-i));
+    ASSERT_TRUE(serializer.Write(expected_value));
+    const std::vector<std::uint8_t> expected = writer.data();
+    writer.clear();
+
+    ASSERT_TRUE(serializer.Write(generator));
+    EXPECT_EQ(expected, writer.data());
+    writer.clear();
+  }
+
+  {
+    Generator<bool> generator{2050, [](std::size_t index, bool* element) {
+                                *element = index % 5 == 1;
+                                return Status<void>{};
+                              }};
+    std::vector<bool> expected_value;
+    for (std::size_t i = 0; i < 2050; i++)
+      expected_value.push_back(i % 5 == 1);
+
+    ASSERT_TRUE(serializer.Write(generator));
+    EXPECT_EQ(writer.data().size(), Encoding<Generator<bool>>::Size(generator));
+    TestReader reader;
+    reader.Set(writer.data());
+    std::vector<bool> decoded;
+    ASSERT_TRUE(Deserializer<TestReader*>{&reader}.Read(&decoded));
+    EXPECT_EQ(expected_value, decoded);
+    writer.clear();
+  }
+
+  {
+    // Errors from the producer abort serialization.
+    Generator<std::string> generator{
+        3, [](std::size_t index, std::string* element) -> Status<void> {
+          if (index == 2)
+            return ErrorStatus::IOError;
+          *element = "ok";
+          return {};
+        }};
+    EXPECT_EQ(ErrorStatus::IOError, serializer.Write(generator).error());
+  }
+}
+
+TEST(Serializer, WriteMany) {
+  const std::vector<TableA1> values{
+      TableA1{"alpha", std::vector<std::string>{"one", "two"}},
+      TableA1{"bravo"}, TableA1{std::vector<std::string>{"three"}}};
+
+  // The batch is the concatenation of the individual values.
+  TestWriter writer;
+  Serializer<TestWriter*> serializer{&writer};
+  for (const auto& value : values)
+    ASSERT_TRUE(serializer.Write(value));
+  const std::vector<std::uint8_t> expected = writer.data();
+  writer.clear();
+
+  ASSERT_TRUE(serializer.WriteMany(values.begin(), values.end()));
+  EXPECT_EQ(expected, writer.data());
+
+  // Writers with unchecked writes encode the whole batch unchecked.
+  std::vector<std::uint8_t> buffer(expected.size());
+  PedanticBufferWriter buffer_writer{buffer.data(), buffer.size()};
+  Serializer<PedanticBufferWriter*> buffer_serializer{&buffer_writer};
+  ASSERT_TRUE(buffer_serializer.WriteMany(values.begin(), values.end()));
+  EXPECT_EQ(expected.size(), buffer_writer.size());
+  EXPECT_EQ(expected, buffer);
+
+  // A batch that does not fit fails before writing.
+  buffer_writer = PedanticBufferWriter{buffer.data(), buffer.size() - 1};
+  EXPECT_EQ(ErrorStatus::WriteLimitReached,
+            buffer_serializer.WriteMany(values.begin(), values.end()).error());
+  EXPECT_EQ(0u, buffer_writer.size());
+}
+
+TEST(Serializer, WriteManyPreparesOnce) {
+  MockWriter writer;
+  Serializer<MockWriter*> serializer{&writer};
+
+  const std::uint32_t values[] = {1, 2, 300};
+  EXPECT_CALL(writer, Prepare(Eq(5U))).WillOnce(Return(Status<void>{}));
+  EXPECT_CALL(writer, Write(_)).WillRepeatedly(Return(Status<void>{}));
+  EXPECT_CALL(writer, Write(_, _)).WillRepeatedly(Return(Status<void>{}));
+  EXPECT_TRUE(serializer.WriteMany(std::begin(values), std::end(values)));
+}
+
+TEST(Deserializer, ReadMany) {
+  TestWriter writer;
+  Serializer<TestWriter*> serializer{&writer};
+  const std::vector<std::string> values{"one", "two", "three", "four"};
+  ASSERT_TRUE(serializer.WriteMany(values.begin(), values.end()));
+  const std::vector<std::uint8_t> data = writer.data();
+
+  {
+    // Readers that report their remaining bytes stop at the end of the input.
+    Deserializer<BufferReader> deserializer{data.data(), data.size()};
+    std::vector<std::string> decoded;
+    auto status = deserializer.ReadMany(std::back_inserter(decoded), 100);
+    ASSERT_TRUE(status);
+    EXPECT_EQ(4u, status.get());
+    EXPECT_EQ(values, decoded);
+  }
+
+  {
+    // The count limits the number of values read.
+    Deserializer<BufferReader> deserializer{data.data(), data.size()};
+    std::string decoded[3];
+    auto status = deserializer.ReadMany(&decoded[0], 3);
+    ASSERT_TRUE(status);
+    EXPECT_EQ(3u, status.get());
+    EXPECT_EQ("three", decoded[2]);
+
+    status = deserializer.ReadMany(&decoded[0], 3);
+    ASSERT_TRUE(status);
+    EXPECT_EQ(1u, status.get());
+    EXPECT_EQ("four", decoded[0]);
+  }
+
+  {
+    // Errors are returned after the values before them are assigned.
+    TestReader reader;
+    reader.Set(std::vector<std::uint8_t>(data.begin(), data.end() - 1));
+    Deserializer<TestReader*> deserializer{&reader};
+    std::vector<std::string> decoded;
+    auto status = deserializer.ReadMany(std::back_inserter(decoded), 4);
+    EXPECT_EQ(ErrorStatus::ReadLimitReached, status.error());
+    EXPECT_EQ(3u, decoded.size());
+  }
+}
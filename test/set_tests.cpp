@@ -0,0 +1,198 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <nop/serializer.h>
+#include <nop/types/flat_map.h>
+#include <nop/types/flat_set.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/canonical.h>
+#include <nop/utility/pedantic_buffer_reader.h>
+#include <nop/utility/reuse_storage.h>
+#include <nop/utility/vector_writer.h>
+
+#include "test_utilities.h"
+
+using nop::BufferReader;
+using nop::Canonical;
+using nop::Deserialize;
+using nop::Encoding;
+using nop::ErrorStatus;
+using nop::FlatMap;
+using nop::FlatSet;
+using nop::PedanticBufferReader;
+using nop::ReuseStorage;
+using nop::Serialize;
+using nop::VectorWriter;
+
+TEST(Set, Ordered) {
+  const std::set<std::string> set{"delta", "alpha", "charlie", "bravo"};
+  const auto data = Serialize(set);
+
+  // Sets use the encoding of a vector of the elements, in order.
+  std::vector<std::string> elements;
+  ASSERT_TRUE(Deserialize(data, &elements));
+  EXPECT_EQ((std::vector<std::string>{"alpha", "bravo", "charlie", "delta"}),
+            elements);
+
+  std::set<std::string> decoded{"stale"};
+  ASSERT_TRUE(Deserialize(data, &decoded));
+  EXPECT_EQ(set, decoded);
+
+  // Unordered input still decodes correctly.
+  const auto unordered = Serialize(
+      std::vector<std::string>{"delta", "alpha", "delta", "bravo"});
+  ASSERT_TRUE(Deserialize(unordered, &decoded));
+  EXPECT_EQ((std::set<std::string>{"alpha", "bravo", "delta"}), decoded);
+
+  std::multiset<std::string> multiset;
+  ASSERT_TRUE(Deserialize(unordered, &multiset));
+  EXPECT_EQ((std::multiset<std::string>{"alpha", "bravo", "delta", "delta"}),
+            multiset);
+  EXPECT_EQ(unordered.size(), Serialize(multiset).size());
+
+  EXPECT_EQ(ErrorStatus::UnexpectedEncodingType,
+            Deserialize(Serialize(std::string{"abc"}), &decoded).error());
+}
+
+TEST(Set, Unordered) {
+  std::unordered_set<std::uint32_t> set;
+  for (std::uint32_t i = 0; i < 100; i++)
+    set.insert(i * 7919 % 1000);
+
+  std::unordered_set<std::uint32_t> decoded{1, 2, 3};
+  ASSERT_TRUE(Deserialize(Serialize(set), &decoded));
+  EXPECT_EQ(set, decoded);
+  EXPECT_GE(decoded.bucket_count() * decoded.max_load_factor(), set.size());
+
+  // Canonical writers write the elements in order, matching std::set.
+  const std::set<std::uint32_t> ordered{set.begin(), set.end()};
+  EXPECT_EQ(Serialize(ordered),
+            (Serialize<decltype(set), Canonical<VectorWriter>>(set)));
+
+  std::unordered_multiset<std::uint32_t> multiset{5, 5, 6};
+  std::unordered_multiset<std::uint32_t> decoded_multiset;
+  ASSERT_TRUE(Deserialize(Serialize(multiset), &decoded_multiset));
+  EXPECT_EQ(multiset, decoded_multiset);
+
+  // The reservation is bounded by the input, rather than the encoded size.
+  const std::vector<std::uint8_t> abusive{0xba, 0x83, 0xff, 0xff, 0xff,
+                                          0xff, 0xff, 0xff, 0xff, 0x0f};
+  EXPECT_EQ(ErrorStatus::ReadLimitReached,
+            (Deserialize<decltype(decoded), PedanticBufferReader>(abusive,
+                                                                  &decoded)
+                 .error()));
+}
+
+TEST(Map, Hinted) {
+  std::map<std::uint32_t, std::string> map;
+  for (std::uint32_t i = 0; i < 100; i++)
+    map.emplace(i * 7919 % 1000, std::to_string(i));
+
+  std::map<std::uint32_t, std::string> decoded{{5000, "stale"}};
+  ASSERT_TRUE(Deserialize(Serialize(map), &decoded));
+  EXPECT_EQ(map, decoded);
+
+  std::unordered_map<std::uint32_t, std::string> unordered;
+  ASSERT_TRUE(Deserialize(Serialize(map), &unordered));
+  EXPECT_EQ(map.size(), unordered.size());
+  EXPECT_GE(unordered.bucket_count() * unordered.max_load_factor(), map.size());
+
+  // Out of order input still decodes correctly.
+  ASSERT_TRUE(Deserialize(Serialize(unordered), &decoded));
+  EXPECT_EQ(map, decoded);
+}
+
+TEST(FlatMap, Container) {
+  FlatMap<std::string, int> map{{"b", 2}, {"a", 1}, {"b", 3}};
+  ASSERT_EQ(2u, map.size());
+  EXPECT_EQ("a", map.begin()->first);
+  EXPECT_EQ(2, map.find("b")->second);
+  EXPECT_EQ(map.end(), map.find("c"));
+
+  EXPECT_TRUE(map.insert({"c", 3}).second);
+  EXPECT_FALSE(map.emplace("c", 4).second);
+  EXPECT_EQ(3, map["c"]);
+  map["0"] = 5;
+  EXPECT_EQ("0", map.begin()->first);
+  EXPECT_EQ(1u, map.erase("a"));
+  EXPECT_EQ(0u, map.erase("a"));
+  EXPECT_EQ(0u, map.count("a"));
+  EXPECT_EQ((FlatMap<std::string, int>{{"0", 5}, {"b", 2}, {"c", 3}}), map);
+
+  FlatSet<int> set{3, 1, 2, 3};
+  EXPECT_EQ((std::vector<int>{1, 2, 3}),
+            (std::vector<int>{set.begin(), set.end()}));
+  EXPECT_FALSE(set.insert(2).second);
+  EXPECT_TRUE(set.emplace(0).second);
+  EXPECT_EQ(0, *set.begin());
+  EXPECT_EQ(1u, set.erase(3));
+  EXPECT_EQ(set.end(), set.find(3));
+  EXPECT_EQ(3u, set.size());
+}
+
+TEST(FlatMap, Encoding) {
+  FlatMap<std::uint32_t, std::string> map;
+  std::map<std::uint32_t, std::string> expected;
+  for (std::uint32_t i = 0; i < 100; i++) {
+    map[i * 7919 % 1000] = std::to_string(i);
+    expected[i * 7919 % 1000] = std::to_string(i);
+  }
+
+  // Flat maps share the encoding of std::map.
+  const auto data = Serialize(map);
+  EXPECT_EQ(Serialize(expected), data);
+
+  FlatMap<std::uint32_t, std::string> decoded{{5000, "stale"}};
+  ASSERT_TRUE(Deserialize(data, &decoded));
+  EXPECT_EQ(map, decoded);
+
+  // Out of order input is sorted.
+  std::unordered_map<std::uint32_t, std::string> unordered{expected.begin(),
+                                                           expected.end()};
+  ASSERT_TRUE(Deserialize(Serialize(unordered), &decoded));
+  EXPECT_EQ(map, decoded);
+
+  // Readers that reuse storage decode over the existing entries.
+  const std::string* first = &decoded.begin()->second;
+  ASSERT_TRUE((Deserialize<decltype(decoded), ReuseStorage<BufferReader>>(
+      data, &decoded)));
+  EXPECT_EQ(map, decoded);
+  EXPECT_EQ(first, &decoded.begin()->second);
+
+  FlatSet<std::string> set{"delta", "alpha", "charlie"};
+  const auto set_data = Serialize(set);
+  EXPECT_EQ(Serialize(std::set<std::string>{set.begin(), set.end()}),
+            set_data);
+
+  FlatSet<std::string> decoded_set{"stale"};
+  ASSERT_TRUE(Deserialize(set_data, &decoded_set));
+  EXPECT_EQ(set, decoded_set);
+
+  ASSERT_TRUE(Deserialize(
+      Serialize(std::vector<std::string>{"b", "a", "b"}), &decoded_set));
+  EXPECT_EQ((FlatSet<std::string>{"a", "b"}), decoded_set);
+
+  EXPECT_EQ(ErrorStatus::UnexpectedEncodingType,
+            Deserialize(set_data, &decoded).error());
+}
@@ -0,0 +1,148 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <nop/serializer.h>
+#include <nop/structure.h>
+#include <nop/types/view.h>
+#include <nop/utility/shared_ring.h>
+
+using nop::Deserializer;
+using nop::ErrorStatus;
+using nop::Serializer;
+using nop::SharedRing;
+using nop::SharedRingReader;
+using nop::SharedRingWriter;
+using nop::StringView;
+
+namespace {
+
+struct Record {
+  std::uint64_t sequence;
+  std::string name;
+  std::vector<std::uint16_t> samples;
+  NOP_STRUCTURE(Record, sequence, name, samples);
+};
+
+struct RecordView {
+  std::uint64_t sequence;
+  StringView name;
+  std::vector<std::uint16_t> samples;
+  NOP_STRUCTURE(RecordView, sequence, name, samples);
+};
+
+Record MakeRecord(std::uint64_t sequence) {
+  // Every hundredth record is larger than the ring.
+  const std::size_t count = sequence % 100 == 0 ? 5000 : sequence % 7;
+  return {sequence, std::string(sequence % 13, 'a' + sequence % 26),
+          std::vector<std::uint16_t>(count,
+                                     static_cast<std::uint16_t>(sequence))};
+}
+
+}  // anonymous namespace
+
+TEST(SharedRing, Create) {
+  auto status = SharedRing::Create(1000);
+  ASSERT_TRUE(status);
+  EXPECT_LE(1000u, status.get().capacity());
+  EXPECT_EQ(0u, status.get().capacity() & (status.get().capacity() - 1));
+
+  // Mapping the fd in another ring reproduces the capacity.
+  auto mapped = SharedRing::Map(::dup(status.get().fd()));
+  ASSERT_TRUE(mapped);
+  EXPECT_EQ(status.get().capacity(), mapped.get().capacity());
+
+  EXPECT_FALSE(SharedRing::Map(-1));
+}
+
+TEST(SharedRing, Messages) {
+  auto status = SharedRing::Create(4096);
+  ASSERT_TRUE(status);
+  auto peer = SharedRing::Map(::dup(status.get().fd()));
+  ASSERT_TRUE(peer);
+
+  const std::uint64_t kCount = 2000;
+  std::thread producer{[&status, kCount] {
+    Serializer<SharedRingWriter> serializer{status.take()};
+    for (std::uint64_t i = 0; i < kCount; i++)
+      ASSERT_TRUE(serializer.Write(MakeRecord(i)));
+  }};
+
+  Deserializer<SharedRingReader> deserializer{peer.take()};
+  for (std::uint64_t i = 0; i < kCount; i++) {
+    Record record;
+    ASSERT_TRUE(deserializer.Read(&record)) << i;
+    const Record expected = MakeRecord(i);
+    EXPECT_EQ(expected.sequence, record.sequence);
+    EXPECT_EQ(expected.name, record.name);
+    EXPECT_EQ(expected.samples, record.samples);
+  }
+
+  // The closed writer end is reported after the last message.
+  producer.join();
+  Record record;
+  EXPECT_EQ(ErrorStatus::ReadLimitReached,
+            deserializer.Read(&record).error());
+}
+
+TEST(SharedRing, Borrow) {
+  // Borrowed bytes are held until the end of each message, so the ring must be
+  // able to hold the largest message.
+  auto status = SharedRing::Create(16384);
+  ASSERT_TRUE(status);
+  auto peer = SharedRing::Map(::dup(status.get().fd()));
+  ASSERT_TRUE(peer);
+
+  const std::uint64_t kCount = 1000;
+  std::thread producer{[&status, kCount] {
+    Serializer<SharedRingWriter> serializer{status.take()};
+    for (std::uint64_t i = 1; i <= kCount; i++)
+      ASSERT_TRUE(serializer.Write(MakeRecord(i)));
+  }};
+
+  Deserializer<SharedRingReader> deserializer{peer.take()};
+  for (std::uint64_t i = 1; i <= kCount; i++) {
+    RecordView view;
+    ASSERT_TRUE(deserializer.Read(&view)) << i;
+    const Record expected = MakeRecord(i);
+    EXPECT_EQ(expected.name, std::string(view.name.data(), view.name.size()));
+    EXPECT_EQ(expected.samples, view.samples);
+    deserializer.reader().Release();
+  }
+  producer.join();
+}
+
+TEST(SharedRing, ReaderClosed) {
+  auto status = SharedRing::Create(4096);
+  ASSERT_TRUE(status);
+  auto peer = SharedRing::Map(::dup(status.get().fd()));
+  ASSERT_TRUE(peer);
+
+  SharedRingWriter writer{status.take()};
+  { SharedRingReader reader{peer.take()}; }
+
+  // Writes succeed while there is space and fail once the writer would have
+  // to wait for the closed reader.
+  const std::vector<std::uint8_t> data(writer.ring().capacity(), 1);
+  EXPECT_TRUE(writer.Write(data.data(), data.data() + data.size()));
+  EXPECT_EQ(ErrorStatus::WriteLimitReached,
+            writer.Write(data.data(), data.data() + 1).error());
+}
@@ -19,7 +19,9 @@
 #include <nop/utility/sip_hash.h>
 
 using nop::BlockReader;
+using nop::Hash128;
 using nop::SipHash;
+using nop::SipHashStream;
 
 namespace {
 
@@ -123,3 +125,72 @@ TEST(SipHash, Vectors) {
         SipHash::Compute(BlockReader<std::uint8_t>(input.data(), i), k0, k1));
   }
 }
+
+TEST(SipHash, Stream) {
+  const std::uint64_t k0 = 0x0706050403020100;
+  const std::uint64_t k1 = 0x0f0e0d0c0b0a0908;
+
+  std::array<std::uint8_t, kMaxLength> input;
+  for (std::size_t i = 0; i < kMaxLength; i++)
+    input[i] = i;
+
+  // Every split of each input into two updates matches the reference.
+  for (std::size_t i = 0; i < kMaxLength; i++) {
+    for (std::size_t split = 0; split <= i; split++) {
+      SipHashStream<64> hash{k0, k1};
+      hash.Update(input.data(), split);
+      hash.Update(input.data() + split, i - split);
+      EXPECT_EQ(VectorToInt(kVectors[i]), hash.Finish());
+      EXPECT_EQ(i, hash.length());
+    }
+  }
+
+  // Byte-at-a-time updates.
+  SipHashStream<64> hash{k0, k1};
+  for (std::size_t i = 0; i < kMaxLength; i++) {
+    EXPECT_EQ(VectorToInt(kVectors[i]), hash.Finish());
+    hash.Update(&input[i], 1);
+  }
+
+  hash.Reset();
+  EXPECT_EQ(0u, hash.length());
+  EXPECT_EQ(VectorToInt(kVectors[0]), hash.Finish());
+}
+
+TEST(SipHash, Stream128) {
+  const std::uint64_t k0 = 0x0706050403020100;
+  const std::uint64_t k1 = 0x0f0e0d0c0b0a0908;
+  const std::uint8_t input[] = {0x00};
+
+  // Reference vectors of SipHash-2-4 with 128-bit output.
+  SipHashStream<128> hash{k0, k1};
+  Hash128 expected{0xe6a825ba047f81a3ULL, 0x930255c71472f66dULL};
+  EXPECT_EQ(expected, hash.Finish());
+
+  hash.Update(input, sizeof(input));
+  expected = {0x44af996bd8c187daULL, 0x45fc229b11597634ULL};
+  EXPECT_EQ(expected, hash.Finish());
+}
+
+TEST(SipHash, ComputeFast) {
+  const std::uint64_t k0 = 0x0706050403020100;
+  const std::uint64_t k1 = 0x0f0e0d0c0b0a0908;
+
+  // Hash from each alignment to exercise unaligned loads.
+  std::array<std::uint8_t, kMaxLength + 8> storage;
+  for (std::size_t align = 0; align < 8; align++) {
+    std::uint8_t* input = storage.data() + align;
+    for (std::size_t i = 0; i < kMaxLength; i++) {
+      input[i] = i;
+      EXPECT_EQ(VectorToInt(kVectors[i]),
+                SipHash::ComputeFast(input, i, k0, k1));
+    }
+  }
+
+  // Compute() dispatches to the fast path at runtime, with the same result as
+  // at compile time. The hash includes the string terminator.
+  const char kInput[] = "abcdefghijklmnopqrstuvwxyz";
+  const std::uint64_t runtime =
+      SipHash::Compute(BlockReader<char>(kInput, sizeof(kInput)), 0, 0);
+  EXPECT_EQ(17955292667519703601ULL, runtime);
+}
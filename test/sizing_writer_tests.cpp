@@ -0,0 +1,117 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <nop/serializer.h>
+#include <nop/structure.h>
+#include <nop/table.h>
+#include <nop/types/file_handle.h>
+#include <nop/utility/canonical.h>
+#include <nop/utility/exact_table_entries.h>
+#include <nop/utility/sizing_writer.h>
+
+#include "test_writer.h"
+
+using nop::Canonical;
+using nop::Entry;
+using nop::ErrorStatus;
+using nop::ExactEncodingSize;
+using nop::ExactTableEntries;
+using nop::FileHandle;
+using nop::Serializer;
+using nop::SizingWriter;
+using nop::TestWriter;
+
+namespace {
+
+struct Planes {
+  std::string name;
+  FileHandle buffer;
+  std::vector<FileHandle> planes;
+  NOP_STRUCTURE(Planes, name, buffer, planes);
+};
+
+struct Surface {
+  Entry<Planes, 0> planes;
+  Entry<std::uint32_t, 1> format;
+  NOP_TABLE(Surface, planes, format);
+};
+
+Planes MakePlanes() {
+  return {"surface",
+          FileHandle{3},
+          {FileHandle{4}, FileHandle{}, FileHandle{5}}};
+}
+
+}  // anonymous namespace
+
+TEST(SizingWriter, ExactSize) {
+  // Values without handles are sized exactly by either method.
+  const std::vector<std::string> strings{"a", "bc", "def"};
+  Serializer<TestWriter> serializer;
+  auto size = ExactEncodingSize<TestWriter>(strings);
+  ASSERT_TRUE(size);
+  EXPECT_EQ(serializer.GetSize(strings), size.get());
+
+  // Handles are estimated with I64 references, but encoded with one byte.
+  const Planes planes = MakePlanes();
+  ASSERT_TRUE(serializer.Write(planes));
+  size = ExactEncodingSize<TestWriter>(planes);
+  ASSERT_TRUE(size);
+  EXPECT_EQ(serializer.writer().data().size(), size.get());
+  EXPECT_EQ(serializer.GetSize(planes) - 4u * 8u, size.get());
+
+  // References that do not fit in a fixint take more space.
+  auto later_size = ExactEncodingSize<TestWriter>(planes, 1000);
+  ASSERT_TRUE(later_size);
+  EXPECT_EQ(size.get() + 3u * 2u, later_size.get());
+
+  // The sizing writer assigns references as pushed.
+  SizingWriter<TestWriter> writer{10};
+  ASSERT_TRUE(writer.PushHandle(FileHandle{7}));
+  EXPECT_EQ(11, writer.PushHandle(FileHandle{8}).get());
+  EXPECT_EQ(-1, writer.PushHandle(FileHandle{}).get());
+  EXPECT_EQ(12, writer.PushHandle(FileHandle{9}).get());
+}
+
+TEST(SizingWriter, TableEntries) {
+  Surface surface;
+  surface.planes = MakePlanes();
+  surface.format = 7;
+
+  // Writers that pad table entries produce the estimated size.
+  Serializer<TestWriter> serializer;
+  ASSERT_TRUE(serializer.Write(surface));
+  auto padded_size = ExactEncodingSize<TestWriter>(surface);
+  ASSERT_TRUE(padded_size);
+  EXPECT_EQ(serializer.writer().data().size(), padded_size.get());
+  EXPECT_EQ(serializer.GetSize(surface), padded_size.get());
+
+  // Writers with exact table entries do not pad.
+  Serializer<ExactTableEntries<TestWriter>> exact_serializer;
+  ASSERT_TRUE(exact_serializer.Write(surface));
+  auto exact_size = ExactEncodingSize<ExactTableEntries<TestWriter>>(surface);
+  ASSERT_TRUE(exact_size);
+  EXPECT_EQ(exact_serializer.writer().data().size(), exact_size.get());
+  EXPECT_EQ(padded_size.get() - 4u * 8u, exact_size.get());
+
+  // The canonical encoding cannot pad the entry.
+  EXPECT_EQ(ErrorStatus::ProtocolError,
+            ExactEncodingSize<Canonical<TestWriter>>(surface).error());
+}
@@ -0,0 +1,326 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <nop/base/skip.h>
+#include <nop/serializer.h>
+#include <nop/structure.h>
+#include <nop/table.h>
+#include <nop/types/variant.h>
+#include <nop/utility/fixint_scan.h>
+#include <nop/utility/pedantic_buffer_reader.h>
+#include <nop/utility/stream_reader.h>
+#include <nop/utility/validate_buffer.h>
+#include <nop/utility/vector_writer.h>
+
+#include "test_utilities.h"
+
+using nop::BufferReader;
+using nop::CaptureValue;
+using nop::Compose;
+using nop::CountFixInts;
+using nop::Deserializer;
+using nop::EncodingByte;
+using nop::Entry;
+using nop::ErrorStatus;
+using nop::PedanticBufferReader;
+using nop::Serializer;
+using nop::SkipValue;
+using nop::StreamReader;
+using nop::ValidateBuffer;
+using nop::ValidateValue;
+using nop::Variant;
+using nop::VectorWriter;
+
+namespace {
+
+struct Point {
+  float x;
+  double y;
+  std::int64_t z;
+  NOP_STRUCTURE(Point, x, y, z);
+};
+
+struct Shape {
+  Entry<std::string, 0> name;
+  Entry<std::vector<Point>, 1> points;
+  Entry<Variant<int, std::string>, 2> label;
+  Entry<Variant<int, std::string>, 3> empty_label;
+  NOP_TABLE_NS("Shape", Shape, name, points, label, empty_label);
+};
+
+struct Document {
+  std::map<std::string, Shape> shapes;
+  std::vector<std::uint16_t> data;
+  std::vector<std::int8_t> deltas;
+  bool visible;
+  NOP_STRUCTURE(Document, shapes, data, deltas, visible);
+};
+
+std::vector<std::uint8_t> Serialize(const Document& document) {
+  Serializer<VectorWriter> serializer;
+  EXPECT_TRUE(serializer.Write(document));
+  EXPECT_TRUE(serializer.Write(std::string{"trailer"}));
+  return serializer.writer().Take();
+}
+
+}  // anonymous namespace
+
+TEST(SkipValue, Document) {
+  Shape shape;
+  shape.name = std::string{"triangle"};
+  shape.points = std::vector<Point>{{1.f, 2., -3}, {4.f, 5., 1LL << 40}};
+  shape.label = Variant<int, std::string>{std::string{"label"}};
+  shape.empty_label = Variant<int, std::string>{};
+
+  Document document{{{"a", shape}, {"b", Shape{}}}, {1, 1000}, {-1, -100},
+                    true};
+  const std::vector<std::uint8_t> data = Serialize(document);
+
+  // Both functions stop at the start of the following value.
+  PedanticBufferReader reader{data.data(), data.size()};
+  ASSERT_TRUE(SkipValue(&reader));
+  EXPECT_EQ(Compose(EncodingByte::String, 7, "trailer").size(),
+            reader.remaining());
+
+  PedanticBufferReader validate_reader{data.data(), data.size()};
+  ASSERT_TRUE(ValidateValue(&validate_reader));
+  EXPECT_EQ(reader.remaining(), validate_reader.remaining());
+
+  ASSERT_TRUE(SkipValue(&reader));
+  EXPECT_TRUE(reader.empty());
+}
+
+TEST(SkipValue, Scalars) {
+  const std::vector<std::uint8_t> data =
+      Compose(0, 127, -1, EncodingByte::U8, 200, EncodingByte::I16, 0, 1,
+              EncodingByte::U32, 0, 0, 0, 1, EncodingByte::F64, 0, 0, 0, 0, 0,
+              0, 0, 0, EncodingByte::Nil, EncodingByte::Error, 3,
+              EncodingByte::Handle, 0, EncodingByte::I64, 0, 0, 0, 0, 0, 0,
+              0, 0);
+
+  PedanticBufferReader reader{data.data(), data.size()};
+  for (int i = 0; i < 10; i++)
+    ASSERT_TRUE(ValidateValue(&reader)) << "value " << i;
+  EXPECT_TRUE(reader.empty());
+}
+
+TEST(SkipValue, Errors) {
+  std::vector<std::uint8_t> data;
+
+  // Truncated payloads.
+  data = Compose(EncodingByte::String, 10, "short");
+  PedanticBufferReader truncated{data.data(), data.size()};
+  EXPECT_EQ(ErrorStatus::ReadLimitReached, SkipValue(&truncated).error());
+
+  data = Compose(EncodingByte::U32, 1, 2);
+  PedanticBufferReader truncated_integer{data.data(), data.size()};
+  EXPECT_EQ(ErrorStatus::ReadLimitReached,
+            SkipValue(&truncated_integer).error());
+
+  // Types without a defined length.
+  data = Compose(EncodingByte::Extension, 2, 0);
+  PedanticBufferReader extension{data.data(), data.size()};
+  EXPECT_EQ(ErrorStatus::UnexpectedEncodingType,
+            SkipValue(&extension).error());
+
+  data = Compose(EncodingByte::Extension, 0);
+  PedanticBufferReader truncated_extension{data.data(), data.size()};
+  EXPECT_EQ(ErrorStatus::ReadLimitReached,
+            SkipValue(&truncated_extension).error());
+
+  data = Compose(EncodingByte::ReservedMin);
+  PedanticBufferReader reserved{data.data(), data.size()};
+  EXPECT_EQ(ErrorStatus::UnexpectedEncodingType, SkipValue(&reserved).error());
+
+  // Handles and errors hold integers.
+  data = Compose(EncodingByte::Error, EncodingByte::String, 0);
+  PedanticBufferReader error{data.data(), data.size()};
+  EXPECT_EQ(ErrorStatus::UnexpectedEncodingType, SkipValue(&error).error());
+
+  // Nesting beyond the depth limit.
+  data = Compose(EncodingByte::Array, 1, EncodingByte::Array, 1,
+                 EncodingByte::Array, 1, EncodingByte::Array, 0);
+  PedanticBufferReader deep{data.data(), data.size()};
+  EXPECT_EQ(ErrorStatus::DepthLimitReached, SkipValue(&deep, 3).error());
+  PedanticBufferReader shallow{data.data(), data.size()};
+  EXPECT_TRUE(SkipValue(&shallow, 4));
+}
+
+TEST(CaptureValue, Document) {
+  Shape shape;
+  shape.name = std::string{"square"};
+  shape.points = std::vector<Point>{{1.f, 2., 3}};
+  shape.label = Variant<int, std::string>{10};
+
+  Document document{{{"a", shape}}, {1, 2, 3}, {-4}, false};
+  const std::vector<std::uint8_t> data = Serialize(document);
+  const std::vector<std::uint8_t> trailer =
+      Compose(EncodingByte::String, 7, "trailer");
+  const std::vector<std::uint8_t> expected{data.begin(),
+                                           data.end() - trailer.size()};
+
+  // Values are captured from readers that do not expose their input as memory.
+  StreamReader<std::stringstream> reader{
+      std::string{data.begin(), data.end()}};
+  std::vector<std::uint8_t> bytes;
+  ASSERT_TRUE(CaptureValue(&reader, &bytes));
+  EXPECT_EQ(expected, bytes);
+
+  // Captured values are appended.
+  ASSERT_TRUE(CaptureValue(&reader, &bytes));
+  EXPECT_EQ(data, bytes);
+
+  // The captured bytes decode to the original value.
+  Document decoded;
+  Deserializer<BufferReader> deserializer{bytes.data(), bytes.size()};
+  ASSERT_TRUE(deserializer.Read(&decoded));
+  EXPECT_EQ(document.data, decoded.data);
+  EXPECT_EQ(document.shapes.size(), decoded.shapes.size());
+
+  // Values that exceed the size limit are rejected.
+  PedanticBufferReader limited_reader{data.data(), data.size()};
+  bytes.clear();
+  auto status = CaptureValue(&limited_reader, &bytes, expected.size() - 1);
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::ReadLimitReached, status.error());
+
+  PedanticBufferReader truncated_reader{data.data(), expected.size() - 1};
+  bytes.clear();
+  EXPECT_FALSE(CaptureValue(&truncated_reader, &bytes));
+}
+
+TEST(ValidateValue, Errors) {
+  std::vector<std::uint8_t> data;
+
+  // Table entries may pad their values. SkipValue only uses the entry length,
+  // while ValidateValue also checks that the value fits within it.
+  data = Compose(EncodingByte::Table, 0, 1, 0, 2, 1, 2);
+  PedanticBufferReader two_values{data.data(), data.size()};
+  EXPECT_TRUE(SkipValue(&two_values));
+  EXPECT_TRUE(two_values.empty());
+  two_values = PedanticBufferReader{data.data(), data.size()};
+  EXPECT_TRUE(ValidateValue(&two_values));
+
+  data = Compose(EncodingByte::Table, 0, 1, 0, 2, EncodingByte::String, 2,
+                 "ab");
+  PedanticBufferReader overrun{data.data(), data.size()};
+  EXPECT_TRUE(SkipValue(&overrun));
+  EXPECT_FALSE(overrun.empty());
+  overrun = PedanticBufferReader{data.data(), data.size()};
+  EXPECT_EQ(ErrorStatus::ReadLimitReached, ValidateValue(&overrun).error());
+
+  // Variant indices.
+  data = Compose(EncodingByte::Variant, -2, 0);
+  PedanticBufferReader index{data.data(), data.size()};
+  EXPECT_EQ(ErrorStatus::UnexpectedVariantType, ValidateValue(&index).error());
+
+  data = Compose(EncodingByte::Variant, -1, 0);
+  PedanticBufferReader empty{data.data(), data.size()};
+  EXPECT_EQ(ErrorStatus::UnexpectedVariantType, ValidateValue(&empty).error());
+
+  // Element counts larger than the input.
+  data = Compose(EncodingByte::Array, EncodingByte::U32, 0, 0, 0, 1, 0);
+  PedanticBufferReader count{data.data(), data.size()};
+  EXPECT_EQ(ErrorStatus::InvalidContainerLength,
+            ValidateValue(&count).error());
+}
+
+TEST(ValidateBuffer, CountFixInts) {
+  std::vector<std::uint8_t> data(40, 0x7f);
+  EXPECT_EQ(40u, CountFixInts(data.data(), data.size()));
+  EXPECT_EQ(0u, CountFixInts(data.data(), 0));
+
+  // Check the boundaries of the fixint ranges at every position of a word.
+  for (std::size_t i = 0; i < data.size(); i++) {
+    for (std::uint8_t byte : {0x80, 0xbf}) {
+      data[i] = byte;
+      EXPECT_EQ(i, CountFixInts(data.data(), data.size())) << i;
+    }
+    for (std::uint8_t byte : {0x00, 0x7f, 0xc0, 0xff}) {
+      data[i] = byte;
+      EXPECT_EQ(data.size(), CountFixInts(data.data(), data.size())) << i;
+    }
+  }
+}
+
+TEST(ValidateBuffer, Document) {
+  Shape shape;
+  shape.name = std::string{"square"};
+  shape.points = std::vector<Point>{{1.f, 2., 3}};
+  shape.label = Variant<int, std::string>{10};
+
+  std::vector<std::uint16_t> samples(100);
+  for (std::size_t i = 0; i < samples.size(); i++)
+    samples[i] = static_cast<std::uint16_t>(i * 7);
+  Document document{{{"a", shape}}, samples, {1, -1, -64, 63}, false};
+
+  // The buffer holds two values.
+  const std::vector<std::uint8_t> data = Serialize(document);
+  auto status = ValidateBuffer(data.data(), data.size());
+  ASSERT_TRUE(status);
+
+  Deserializer<BufferReader> deserializer{status.take()};
+  Document decoded;
+  std::string trailer;
+  ASSERT_TRUE(deserializer.Read(&decoded));
+  ASSERT_TRUE(deserializer.Read(&trailer));
+  EXPECT_EQ(samples, decoded.data);
+  EXPECT_EQ(document.deltas, decoded.deltas);
+  EXPECT_EQ("square", decoded.shapes["a"].name.get());
+  EXPECT_EQ("trailer", trailer);
+
+  // Every truncation of the buffer fails validation, except the one that ends
+  // between the two values.
+  const std::size_t trailer_size = Compose(EncodingByte::String, 7, "trailer")
+                                       .size();
+  for (std::size_t size = 1; size < data.size(); size++) {
+    EXPECT_EQ(size == data.size() - trailer_size,
+              !!ValidateBuffer(data.data(), size))
+        << size;
+  }
+}
+
+TEST(ValidateBuffer, Errors) {
+  std::vector<std::uint8_t> data;
+
+  // A run of fixints interrupted by a value with a payload.
+  data = Compose(EncodingByte::Array, 12, 1, 2, 3, 4, 5, 6, 7, 8, 9,
+                 EncodingByte::U16, 0, 1, 10, 11);
+  EXPECT_TRUE(ValidateBuffer(data.data(), data.size()));
+  EXPECT_EQ(ErrorStatus::ReadLimitReached,
+            ValidateBuffer(data.data(), data.size() - 1).error());
+
+  // Fixint runs do not extend past the element count.
+  data = Compose(EncodingByte::Array, 2, 1, 2, EncodingByte::U16, 0);
+  EXPECT_EQ(ErrorStatus::ReadLimitReached,
+            ValidateBuffer(data.data(), data.size()).error());
+
+  // Nor past the end of a table entry.
+  data = Compose(EncodingByte::Table, 0, 1, 0, 4, EncodingByte::Array, 3, 1,
+                 2, 3);
+  EXPECT_EQ(ErrorStatus::InvalidContainerLength,
+            ValidateBuffer(data.data(), data.size()).error());
+
+  data = Compose(EncodingByte::Array, EncodingByte::U32, 0, 0, 0, 1, 0);
+  EXPECT_EQ(ErrorStatus::InvalidContainerLength,
+            ValidateBuffer(data.data(), data.size()).error());
+}
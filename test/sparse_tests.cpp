@@ -0,0 +1,155 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <nop/base/skip.h>
+#include <nop/serializer.h>
+#include <nop/types/sparse.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/pedantic_buffer_reader.h>
+#include <nop/utility/vector_writer.h>
+
+#include "test_utilities.h"
+
+using nop::Deserialize;
+using nop::ErrorStatus;
+using nop::Serialize;
+using nop::SkipValue;
+using nop::Sparse;
+
+namespace {
+
+template <typename T>
+void ExpectRoundTrip(const std::vector<T>& values) {
+  const auto data = Serialize(Sparse<std::vector<T>>{values});
+  Sparse<std::vector<T>> decoded{std::vector<T>(5, 1)};
+  ASSERT_TRUE(Deserialize(data, &decoded));
+  EXPECT_EQ(values, decoded.get());
+
+  nop::BufferReader reader{data.data(), data.size()};
+  EXPECT_TRUE(SkipValue(&reader));
+  EXPECT_EQ(0u, reader.remaining());
+}
+
+template <typename T>
+std::vector<T> MakeSparse(std::size_t count, unsigned percent) {
+  std::mt19937 random{7};
+  std::vector<T> values(count);
+  for (auto& value : values) {
+    if (random() % 100 < percent)
+      value = static_cast<T>(random() % 1000 + 1);
+  }
+  return values;
+}
+
+}  // anonymous namespace
+
+TEST(Sparse, RoundTrip) {
+  for (std::size_t count : {0u, 1u, 7u, 8u, 9u, 1000u}) {
+    for (unsigned percent : {0u, 3u, 50u, 100u}) {
+      ExpectRoundTrip(MakeSparse<std::uint8_t>(count, percent));
+      ExpectRoundTrip(MakeSparse<std::int16_t>(count, percent));
+      ExpectRoundTrip(MakeSparse<std::uint32_t>(count, percent));
+      ExpectRoundTrip(MakeSparse<std::int64_t>(count, percent));
+      ExpectRoundTrip(MakeSparse<double>(count, percent));
+    }
+  }
+
+  // Negative zero is not a zero run.
+  const std::vector<float> floats = {0.0f, -0.0f, 0.0f, 0.0f, 0.0f, 1.0f};
+  Sparse<std::vector<float>> decoded;
+  ASSERT_TRUE(Deserialize(Serialize(Sparse<std::vector<float>>{floats}),
+                          &decoded));
+  ASSERT_EQ(floats.size(), decoded->size());
+  EXPECT_TRUE(std::signbit(decoded.get()[1]));
+  EXPECT_FALSE(std::signbit(decoded.get()[0]));
+}
+
+TEST(Sparse, Size) {
+  // A histogram with 2% of its buckets set.
+  const auto histogram = MakeSparse<std::uint32_t>(10000, 2);
+  const auto sparse = Serialize(Sparse<std::vector<std::uint32_t>>{histogram});
+  EXPECT_LT(sparse.size() * 10, Serialize(histogram).size());
+
+  // BIN, L = 8, N = 6, one run of three elements, including a zero that is
+  // too short for a run of its own, and a run of three trailing zeros.
+  EXPECT_EQ((std::vector<std::uint8_t>{0xbc, 0x08, 0x06, 0x00, 0x03, 0x05,
+                                       0x00, 0x01, 0x03, 0x00}),
+            Serialize(Sparse<std::vector<std::uint8_t>>{
+                std::vector<std::uint8_t>{5, 0, 1, 0, 0, 0}}));
+}
+
+TEST(Sparse, Errors) {
+  Sparse<std::vector<std::uint16_t>> value;
+
+  // A run that covers no elements.
+  EXPECT_EQ(ErrorStatus::InvalidContainerLength,
+            Deserialize(std::vector<std::uint8_t>{0xbc, 0x03, 0x01, 0x00, 0x00},
+                        &value)
+                .error());
+
+  // A run beyond the end of the vector.
+  EXPECT_EQ(ErrorStatus::InvalidContainerLength,
+            Deserialize(std::vector<std::uint8_t>{0xbc, 0x03, 0x01, 0x02, 0x00},
+                        &value)
+                .error());
+
+  // Elements beyond the end of the payload.
+  EXPECT_EQ(ErrorStatus::InvalidContainerLength,
+            Deserialize(std::vector<std::uint8_t>{0xbc, 0x04, 0x01, 0x00, 0x01,
+                                                  0x00},
+                        &value)
+                .error());
+
+  // Extra bytes after the last run.
+  EXPECT_EQ(ErrorStatus::InvalidContainerLength,
+            Deserialize(std::vector<std::uint8_t>{0xbc, 0x04, 0x01, 0x01, 0x00,
+                                                  0x00},
+                        &value)
+                .error());
+
+  // A vector larger than the limit.
+  const auto data = Serialize(Sparse<std::vector<std::uint16_t>>{
+      std::vector<std::uint16_t>(1000)});
+  EXPECT_EQ(9u, data.size());
+  value.set_max_size(999);
+  EXPECT_EQ(ErrorStatus::InvalidContainerLength,
+            Deserialize(data, &value).error());
+  value.set_max_size(1000);
+  EXPECT_TRUE(Deserialize(data, &value));
+
+  // A huge size without the runs to back it is rejected by the default limit,
+  // and otherwise fails on the missing runs without allocating the vector.
+  const std::vector<std::uint8_t> huge{0xbc, 0x09, 0x83, 0x00, 0x00, 0x00,
+                                       0x00, 0x00, 0x01, 0x00, 0x00};
+  Sparse<std::vector<std::uint16_t>> unbounded;
+  EXPECT_EQ(Sparse<std::vector<std::uint16_t>>::kDefaultMaxSize,
+            unbounded.max_size());
+  EXPECT_EQ(ErrorStatus::InvalidContainerLength,
+            Deserialize(huge, &unbounded).error());
+  unbounded.set_max_size(std::numeric_limits<std::uint64_t>::max());
+  EXPECT_FALSE(Deserialize(huge, &unbounded));
+  EXPECT_GT(1000u, unbounded->capacity());
+
+  EXPECT_EQ(ErrorStatus::UnexpectedEncodingType,
+            Deserialize(Serialize(std::string{"a"}), &value).error());
+}
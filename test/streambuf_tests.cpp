@@ -0,0 +1,190 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <map>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include <nop/serializer.h>
+#include <nop/structure.h>
+#include <nop/table.h>
+#include <nop/utility/stream_reader.h>
+#include <nop/utility/stream_writer.h>
+#include <nop/utility/streambuf_reader.h>
+#include <nop/utility/streambuf_writer.h>
+#include <nop/utility/vector_writer.h>
+
+using nop::Deserializer;
+using nop::Entry;
+using nop::ErrorStatus;
+using nop::Serializer;
+using nop::StreamReader;
+using nop::StreamWriter;
+using nop::StreambufReader;
+using nop::StreambufWriter;
+using nop::VectorWriter;
+
+namespace {
+
+struct Message {
+  std::uint32_t id;
+  std::string name;
+  std::vector<std::int64_t> values;
+  std::map<std::string, int> counts;
+  NOP_STRUCTURE(Message, id, name, values, counts);
+};
+
+struct Settings {
+  Entry<std::string, 0> name;
+  Entry<std::vector<int>, 1> values;
+  NOP_TABLE_NS("StreambufSettings", Settings, name, values);
+};
+
+Message MakeMessage() {
+  return {42, "message", {-1, 0, 1 << 20}, {{"a", 1}, {"b", 2}}};
+}
+
+template <typename T>
+std::string Encode(const T& value) {
+  Serializer<VectorWriter> serializer;
+  EXPECT_TRUE(serializer.Write(value));
+  const auto& writer = serializer.writer();
+  return {writer.data(), writer.data() + writer.size()};
+}
+
+// Stream buffer over a fixed array that does not support seeking.
+class FixedBuffer : public std::streambuf {
+ public:
+  explicit FixedBuffer(std::size_t size) : data_(size) {
+    setp(data_.data(), data_.data() + data_.size());
+    setg(data_.data(), data_.data(), data_.data() + data_.size());
+  }
+
+  std::size_t written() const { return pptr() - pbase(); }
+
+ private:
+  std::vector<char> data_;
+};
+
+}  // anonymous namespace
+
+TEST(StreambufWriter, Write) {
+  std::ostringstream stream;
+  Serializer<StreambufWriter> serializer{&stream};
+  ASSERT_TRUE(serializer.Write(MakeMessage()));
+  EXPECT_EQ(Encode(MakeMessage()), stream.str());
+  EXPECT_TRUE(stream.good());
+}
+
+TEST(StreambufWriter, Skip) {
+  std::ostringstream stream;
+  StreambufWriter writer{&stream};
+  ASSERT_TRUE(writer.Write(std::uint8_t{1}));
+  ASSERT_TRUE(writer.Skip(150, 0xaa));
+  ASSERT_TRUE(writer.Skip(0));
+
+  const std::string data = stream.str();
+  ASSERT_EQ(151u, data.size());
+  EXPECT_EQ(std::string(150, '\xaa'), data.substr(1));
+
+  // StreamWriter pads in blocks too.
+  StreamWriter<std::ostringstream> stream_writer;
+  ASSERT_TRUE(stream_writer.Skip(100, 0x55));
+  EXPECT_EQ(std::string(100, '\x55'), stream_writer.stream().str());
+}
+
+TEST(StreambufWriter, Full) {
+  FixedBuffer buffer{4};
+  std::ostream stream{&buffer};
+  StreambufWriter writer{&stream};
+
+  const std::uint8_t data[] = {1, 2, 3};
+  ASSERT_TRUE(writer.Write(data, data + 3));
+  EXPECT_EQ(ErrorStatus::StreamError, writer.Write(data, data + 3).error());
+  EXPECT_TRUE(stream.bad());
+
+  EXPECT_EQ(ErrorStatus::StreamError, writer.Write(std::uint8_t{0}).error());
+  EXPECT_EQ(ErrorStatus::StreamError, writer.Skip(1).error());
+
+  // Without a stream only the status reports the error.
+  FixedBuffer small{2};
+  StreambufWriter buffer_writer{&small};
+  EXPECT_EQ(ErrorStatus::StreamError, buffer_writer.Skip(3).error());
+}
+
+TEST(StreambufReader, Read) {
+  std::istringstream stream{Encode(MakeMessage()) + Encode(MakeMessage())};
+  Deserializer<StreambufReader> deserializer{&stream};
+
+  for (int i = 0; i < 2; i++) {
+    Message message;
+    ASSERT_TRUE(deserializer.Read(&message));
+    EXPECT_EQ(Encode(MakeMessage()), Encode(message));
+  }
+
+  Message message;
+  EXPECT_EQ(ErrorStatus::StreamError, deserializer.Read(&message).error());
+  EXPECT_TRUE(stream.eof());
+  EXPECT_TRUE(stream.fail());
+}
+
+TEST(StreambufReader, Truncated) {
+  const std::string data = Encode(MakeMessage());
+  for (std::size_t size = 0; size < data.size(); size++) {
+    std::istringstream stream{data.substr(0, size)};
+    Deserializer<StreambufReader> deserializer{&stream};
+    Message message;
+    EXPECT_EQ(ErrorStatus::StreamError, deserializer.Read(&message).error());
+  }
+}
+
+TEST(StreambufReader, Skip) {
+  std::istringstream stream{std::string(100, 'x') + "y"};
+  StreambufReader reader{&stream};
+  ASSERT_TRUE(reader.Skip(100));
+
+  std::uint8_t byte = 0;
+  ASSERT_TRUE(reader.Read(&byte));
+  EXPECT_EQ('y', byte);
+  EXPECT_EQ(ErrorStatus::StreamError, reader.Skip(1).error());
+
+  // Buffers that cannot seek read and discard the padding.
+  FixedBuffer buffer{200};
+  StreambufReader buffer_reader{&buffer};
+  ASSERT_TRUE(buffer_reader.Skip(150));
+  EXPECT_EQ(ErrorStatus::StreamError, buffer_reader.Skip(51).error());
+}
+
+TEST(StreambufReader, Table) {
+  Settings settings;
+  settings.name = "table";
+  settings.values = std::vector<int>{1, 2, 3};
+
+  std::stringstream stream;
+  ASSERT_TRUE(Serializer<StreambufWriter>{&stream}.Write(settings));
+
+  Settings decoded;
+  ASSERT_TRUE(Deserializer<StreambufReader>{&stream}.Read(&decoded));
+  EXPECT_EQ(Encode(settings), Encode(decoded));
+
+  // The stream reader reads the same format.
+  StreamReader<std::stringstream> stream_reader{stream.str()};
+  Deserializer<StreamReader<std::stringstream>*> deserializer{&stream_reader};
+  ASSERT_TRUE(deserializer.Read(&decoded));
+  EXPECT_EQ(Encode(settings), Encode(decoded));
+}
@@ -0,0 +1,170 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <nop/serializer.h>
+#include <nop/structure.h>
+#include <nop/traits/is_fungible.h>
+#include <nop/types/string_list.h>
+#include <nop/utility/pedantic_buffer_reader.h>
+#include <nop/utility/stream_reader.h>
+#include <nop/utility/vector_writer.h>
+
+#include "test_utilities.h"
+
+using nop::Deserialize;
+using nop::Deserializer;
+using nop::EncodingByte;
+using nop::ErrorStatus;
+using nop::IsFungible;
+using nop::Serialize;
+using nop::StreamReader;
+using nop::StringList;
+using nop::StringView;
+
+namespace {
+
+struct Event {
+  std::uint64_t timestamp;
+  StringList tags;
+  NOP_STRUCTURE(Event, timestamp, tags);
+};
+
+struct PlainEvent {
+  std::uint64_t timestamp;
+  std::vector<std::string> tags;
+  NOP_STRUCTURE(PlainEvent, timestamp, tags);
+};
+
+std::vector<std::string> MakeTags(std::size_t count) {
+  std::vector<std::string> tags;
+  for (std::size_t i = 0; i < count; i++)
+    tags.push_back("tag-" + std::to_string(i) + std::string(i % 40, 'x'));
+  return tags;
+}
+
+}  // anonymous namespace
+
+TEST(StringList, Basic) {
+  StringList list{"abc", "", "defgh"};
+  ASSERT_EQ(3u, list.size());
+  EXPECT_FALSE(list.empty());
+  EXPECT_EQ(8u, list.size_bytes());
+  EXPECT_EQ(StringView{"abc"}, list[0]);
+  EXPECT_EQ(StringView{""}, list[1]);
+  EXPECT_EQ(StringView{"defgh"}, list[2]);
+
+  const std::vector<std::string> expected{"abc", "", "defgh"};
+  EXPECT_EQ(expected, list.ToVector());
+  EXPECT_EQ(list, StringList(expected.begin(), expected.end()));
+
+  std::vector<std::string> iterated;
+  for (StringView string : list)
+    iterated.push_back(string.ToString());
+  EXPECT_EQ(expected, iterated);
+
+  list.push_back("ij");
+  EXPECT_EQ(4u, list.size());
+  EXPECT_EQ(StringView{"ij"}, list[3]);
+  EXPECT_NE(list, StringList(expected.begin(), expected.end()));
+
+  list.clear();
+  EXPECT_TRUE(list.empty());
+  EXPECT_EQ(0u, list.size_bytes());
+  EXPECT_EQ(list, StringList{});
+}
+
+TEST(StringList, Fungible) {
+  static_assert(IsFungible<StringList, std::vector<std::string>>::value, "");
+  static_assert(IsFungible<std::vector<std::string>, StringList>::value, "");
+  static_assert(IsFungible<StringList, std::vector<StringView>>::value, "");
+  static_assert(IsFungible<Event, PlainEvent>::value, "");
+  static_assert(!IsFungible<StringList, std::vector<int>>::value, "");
+}
+
+TEST(StringList, RoundTrip) {
+  for (std::size_t count : {0u, 1u, 1000u}) {
+    const auto tags = MakeTags(count);
+    const StringList list{tags.begin(), tags.end()};
+
+    // The encoding matches std::vector<std::string> in both directions.
+    const auto data = Serialize(list);
+    EXPECT_EQ(Serialize(tags), data);
+
+    StringList decoded{"stale"};
+    ASSERT_TRUE(Deserialize(data, &decoded));
+    EXPECT_EQ(list, decoded);
+
+    std::vector<std::string> decoded_tags;
+    ASSERT_TRUE(Deserialize(data, &decoded_tags));
+    EXPECT_EQ(tags, decoded_tags);
+  }
+
+  const PlainEvent plain{1234, MakeTags(10)};
+  Event event;
+  ASSERT_TRUE(Deserialize(Serialize(plain), &event));
+  EXPECT_EQ(plain.timestamp, event.timestamp);
+  EXPECT_EQ(plain.tags, event.tags.ToVector());
+
+  // Readers without Borrow() decode the characters directly into the block.
+  const auto data = Serialize(event);
+  Deserializer<StreamReader<std::stringstream>> deserializer{
+      std::string{data.begin(), data.end()}};
+  Event streamed;
+  ASSERT_TRUE(deserializer.Read(&streamed));
+  EXPECT_EQ(event.tags, streamed.tags);
+}
+
+TEST(StringList, ReusesStorage) {
+  const auto tags = MakeTags(100);
+  const auto data = Serialize(tags);
+
+  StringList list;
+  ASSERT_TRUE(Deserialize(data, &list));
+  const char* characters = list[0].data();
+
+  // Decoding the same amount of data again reuses the block.
+  ASSERT_TRUE(Deserialize(data, &list));
+  EXPECT_EQ(characters, list[0].data());
+  EXPECT_EQ(tags, list.ToVector());
+}
+
+TEST(StringList, Errors) {
+  StringList list;
+
+  // Elements that are not strings.
+  EXPECT_EQ(ErrorStatus::UnexpectedEncodingType,
+            Deserialize(Serialize(std::vector<std::vector<std::uint8_t>>{
+                            {1, 2, 3}}),
+                        &list)
+                .error());
+  EXPECT_EQ(ErrorStatus::UnexpectedEncodingType,
+            Deserialize(Serialize(std::string{"abc"}), &list).error());
+
+  // Input that ends early, or a count larger than the input.
+  auto data = Serialize(MakeTags(3));
+  data.pop_back();
+  EXPECT_EQ(ErrorStatus::ReadLimitReached, Deserialize(data, &list).error());
+
+  const std::vector<std::uint8_t> count{
+      static_cast<std::uint8_t>(EncodingByte::Array),
+      static_cast<std::uint8_t>(EncodingByte::U32), 0xff, 0xff, 0xff, 0x7f};
+  EXPECT_EQ(ErrorStatus::ReadLimitReached, Deserialize(count, &list).error());
+}
@@ -17,11 +17,16 @@
 #ifndef LIBNOP_TEST_TEST_UTILITIES_H_
 #define LIBNOP_TEST_TEST_UTILITIES_H_
 
+#include <gtest/gtest.h>
+
 #include <cstdint>
 #include <utility>
 #include <vector>
 
 #include <nop/base/utility.h>
+#include <nop/serializer.h>
+#include <nop/utility/pedantic_buffer_reader.h>
+#include <nop/utility/vector_writer.h>
 
 namespace nop {
 
@@ -95,6 +100,28 @@ inline std::vector<std::uint8_t> Compose(Args&&... args) {
   return vector;
 }
 
+// Serializes |value| using a writer of type Writer and returns the bytes it
+// wrote, checking that the encoding reports the size it actually writes.
+template <typename T, typename Writer = VectorWriter>
+inline std::vector<std::uint8_t> Serialize(const T& value) {
+  Serializer<Writer> serializer;
+  EXPECT_TRUE(serializer.Write(value));
+  EXPECT_EQ(Encoding<T>::Size(value), serializer.writer().size());
+  return serializer.writer().Take();
+}
+
+// Deserializes |value| from |data| using a reader of type Reader. Bytes left
+// over after a successful read are reported as a protocol error.
+template <typename T, typename Reader = PedanticBufferReader>
+inline Status<void> Deserialize(const std::vector<std::uint8_t>& data,
+                                T* value) {
+  Deserializer<Reader> deserializer{data.data(), data.size()};
+  auto status = deserializer.Read(value);
+  if (status && !deserializer.reader().empty())
+    return ErrorStatus::ProtocolError;
+  return status;
+}
+
 }  // namespace nop
 
 #endif  // LIBNOP_TEST_TEST_UTILITIES_H_
@@ -62,6 +62,17 @@ class TestWriter {
     return Write(&*padding.begin(), &*padding.end());
   }
 
+  std::size_t offset() const { return data_.size(); }
+
+  Status<void> Patch(std::size_t offset, const std::uint8_t* begin,
+                     const std::uint8_t* end) {
+    if (offset + std::distance(begin, end) > data_.size())
+      return ErrorStatus::WriteLimitReached;
+
+    std::copy(begin, end, &data_[offset]);
+    return {};
+  }
+
   template <typename HandleType>
   Status<HandleReference> PushHandle(const HandleType& handle) {
     if (handle) {
@@ -0,0 +1,372 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include <nop/rpc/interface.h>
+#include <nop/rpc/thread_pool_server.h>
+#include <nop/serializer.h>
+#include <nop/utility/fd_reader.h>
+#include <nop/utility/fd_writer.h>
+#include <nop/utility/frame_reader.h>
+#include <nop/utility/frame_writer.h>
+#include <nop/utility/pedantic_buffer_reader.h>
+#include <nop/utility/thread_pool.h>
+#include <nop/utility/vector_writer.h>
+
+using nop::BindInterface;
+using nop::Deserializer;
+using nop::ErrorStatus;
+using nop::FdReader;
+using nop::FdWriter;
+using nop::FrameReader;
+using nop::Interface;
+using nop::ParallelFor;
+using nop::PedanticBufferReader;
+using nop::SerialExecutor;
+using nop::Serializer;
+using nop::Status;
+using nop::ThreadPool;
+using nop::ThreadPoolServer;
+using nop::VectorWriter;
+
+namespace {
+
+struct Counter : Interface<Counter> {
+  NOP_INTERFACE("io.github.eieio.test.Counter");
+  NOP_METHOD(Add, int(int value));
+  NOP_METHOD(Name, std::string(int id));
+  NOP_METHOD(Unbound, int());
+  NOP_INTERFACE_API(Add, Name, Unbound);
+};
+
+// Minimal pipelining client for the framed call format. Calls are written
+// immediately and the replies are matched to the calls in order.
+class Client {
+ public:
+  using Handler = std::function<Status<void>(PedanticBufferReader*)>;
+
+  Client(int request_fd, int reply_fd)
+      : writer_{request_fd}, reader_{reply_fd}, frame_reader_{&reader_} {}
+
+  template <typename Return, typename MethodSelector, typename... Args,
+            typename Callback>
+  void SendMethodAsync(MethodSelector method_selector,
+                       const std::tuple<Args...>& args, Callback&& callback) {
+    VectorWriter request;
+    nop::detail::BeginFrame(&request);
+    Serializer<VectorWriter*> serializer{&request};
+    ASSERT_TRUE(serializer.Write(method_selector));
+    ASSERT_TRUE(serializer.Write(args));
+    ASSERT_TRUE(nop::detail::EndFrame(&request));
+
+    handlers_.push_back([callback](PedanticBufferReader* reader) {
+      Return return_value;
+      auto status = Deserializer<PedanticBufferReader*>{reader}.Read(
+          &return_value);
+      if (!status)
+        return status;
+
+      callback(Status<Return>{std::move(return_value)});
+      return Status<void>{};
+    });
+
+    ASSERT_TRUE(writer_.Prepare(request.size()));
+    ASSERT_TRUE(writer_.Write(request.data(), request.data() + request.size()));
+  }
+
+  // Reads the next reply and completes the oldest pending call.
+  Status<void> ReceiveReply() {
+    std::vector<std::uint8_t> frame;
+    auto status = frame_reader_.ReadFrame(&frame);
+    if (!status)
+      return status;
+    else if (handlers_.empty())
+      return ErrorStatus::ProtocolError;
+
+    PedanticBufferReader reader{frame.data(), frame.size()};
+    status = handlers_.front()(&reader);
+    handlers_.pop_front();
+    return status;
+  }
+
+  // Closes the request pipe, which ends the session on the server.
+  void Close() { writer_.Clear(); }
+
+  std::size_t pending() const { return handlers_.size(); }
+
+ private:
+  FdWriter writer_;
+  FdReader reader_;
+  FrameReader<FdReader> frame_reader_;
+  std::deque<Handler> handlers_;
+};
+
+// Serves one connection over a pair of pipes on a thread. The request pipe
+// stays open until the session is destroyed, so that the client may keep
+// writing after the server stops reading.
+template <typename Server>
+class Session {
+ public:
+  Session(Server* server) {
+    int request_pipe[2], reply_pipe[2];
+    EXPECT_EQ(0, ::pipe(request_pipe));
+    EXPECT_EQ(0, ::pipe(reply_pipe));
+
+    reader_ = FdReader{request_pipe[0]};
+    writer_ = FdWriter{reply_pipe[1]};
+    client_.reset(new Client{request_pipe[1], reply_pipe[0]});
+    thread_ = std::thread{[this, server] {
+      status_ = server->Serve(&reader_, &writer_);
+      writer_.Clear();
+    }};
+  }
+
+  // Closes the connection and returns the result of serving it.
+  Status<void> Join() {
+    client_->Close();
+    thread_.join();
+    return status_;
+  }
+
+  Client* client() { return client_.get(); }
+
+ private:
+  FdReader reader_;
+  FdWriter writer_;
+  std::unique_ptr<Client> client_;
+  std::thread thread_;
+  Status<void> status_;
+};
+
+}  // anonymous namespace
+
+TEST(ThreadPool, Submit) {
+  std::atomic<int> count{0};
+  {
+    ThreadPool pool{4};
+    EXPECT_EQ(4u, pool.size());
+
+    // Tasks submitted from the workers are queued on their own deques.
+    for (int i = 0; i < 100; i++) {
+      pool.Submit([&pool, &count] {
+        count++;
+        for (int j = 0; j < 10; j++)
+          pool.Submit([&count] { count++; });
+      });
+    }
+  }
+  EXPECT_EQ(1100, count.load());
+}
+
+TEST(ThreadPool, Steal) {
+  std::mutex mutex;
+  std::set<std::thread::id> threads;
+  {
+    ThreadPool pool{4};
+
+    // All of the tasks are queued on the deque of one worker, so the other
+    // workers only run them by stealing.
+    pool.Submit([&] {
+      for (int i = 0; i < 64; i++) {
+        pool.Submit([&] {
+          std::this_thread::sleep_for(std::chrono::milliseconds{1});
+          std::lock_guard<std::mutex> lock{mutex};
+          threads.insert(std::this_thread::get_id());
+        });
+      }
+    });
+  }
+  EXPECT_LT(1u, threads.size());
+}
+
+TEST(ThreadPool, ParallelFor) {
+  ThreadPool pool{4};
+
+  std::vector<std::atomic<int>> counts(1000);
+  ParallelFor(&pool, counts.size(), [&counts](std::size_t i) { counts[i]++; });
+  for (const auto& count : counts)
+    EXPECT_EQ(1, count.load());
+
+  ParallelFor(&pool, 0, [](std::size_t) { FAIL(); });
+
+  // Nested calls from tasks on a single worker pool do not deadlock, because
+  // the calling thread runs the indices itself.
+  ThreadPool single{1};
+  std::atomic<int> total{0};
+  std::mutex mutex;
+  std::condition_variable condition;
+  bool done = false;
+  single.Submit([&] {
+    ParallelFor(&single, 10, [&](std::size_t) {
+      ParallelFor(&single, 10, [&](std::size_t) { total++; });
+    });
+    std::lock_guard<std::mutex> lock{mutex};
+    done = true;
+    condition.notify_all();
+  });
+
+  std::unique_lock<std::mutex> lock{mutex};
+  condition.wait(lock, [&done] { return done; });
+  EXPECT_EQ(100, total.load());
+}
+
+TEST(SerialExecutor, Order) {
+  ThreadPool pool{4};
+  const int kExecutors = 4;
+  const int kTasks = 1000;
+
+  struct State {
+    std::vector<int> order;
+    std::atomic<bool> running{false};
+    std::atomic<bool> overlapped{false};
+  };
+  std::vector<State> states(kExecutors);
+  std::vector<std::unique_ptr<SerialExecutor>> executors;
+  for (int i = 0; i < kExecutors; i++)
+    executors.emplace_back(new SerialExecutor{&pool});
+
+  for (int i = 0; i < kTasks; i++) {
+    for (int j = 0; j < kExecutors; j++) {
+      State* state = &states[j];
+      executors[j]->Submit([state, i] {
+        if (state->running.exchange(true))
+          state->overlapped = true;
+        state->order.push_back(i);
+        state->running = false;
+      });
+    }
+  }
+
+  for (int j = 0; j < kExecutors; j++) {
+    executors[j]->Wait();
+    EXPECT_FALSE(states[j].overlapped.load());
+    ASSERT_EQ(static_cast<std::size_t>(kTasks), states[j].order.size());
+    for (int i = 0; i < kTasks; i++)
+      EXPECT_EQ(i, states[j].order[i]);
+  }
+}
+
+TEST(ThreadPoolServer, Serve) {
+  std::atomic<int> total{0};
+  auto dispatcher = BindInterface(
+      Counter::Add::Bind([&total](int value) {
+        // Vary the time the calls take so that later calls would overtake
+        // earlier ones were they not ordered.
+        if (value % 3 == 0)
+          std::this_thread::sleep_for(std::chrono::microseconds{200});
+        total += value;
+        return value * 2;
+      }),
+      Counter::Name::Bind(
+          [](int id) { return std::string(id, 'x'); }));
+  ThreadPoolServer<decltype(dispatcher)> server{dispatcher, 4};
+
+  const int kSessions = 4;
+  const int kCalls = 100;
+  std::vector<std::unique_ptr<Session<decltype(server)>>> sessions;
+  for (int i = 0; i < kSessions; i++)
+    sessions.emplace_back(new Session<decltype(server)>{&server});
+
+  // Pipeline all of the calls of each session before reading any replies.
+  std::vector<std::vector<int>> results(kSessions);
+  std::vector<std::vector<std::string>> names(kSessions);
+  for (int i = 0; i < kSessions; i++) {
+    Client* client = sessions[i]->client();
+    for (int j = 0; j < kCalls; j++) {
+      Counter::Add::InvokeAsync(client,
+                                [&results, i](Status<int> status) {
+                                  ASSERT_TRUE(status);
+                                  results[i].push_back(status.get());
+                                },
+                                j);
+      Counter::Name::InvokeAsync(client,
+                                 [&names, i](Status<std::string> status) {
+                                   ASSERT_TRUE(status);
+                                   names[i].push_back(status.take());
+                                 },
+                                 j % 8);
+    }
+  }
+
+  for (int i = 0; i < kSessions; i++) {
+    Client* client = sessions[i]->client();
+    while (client->pending() > 0)
+      ASSERT_TRUE(client->ReceiveReply());
+
+    ASSERT_EQ(static_cast<std::size_t>(kCalls), results[i].size());
+    ASSERT_EQ(static_cast<std::size_t>(kCalls), names[i].size());
+    for (int j = 0; j < kCalls; j++) {
+      EXPECT_EQ(j * 2, results[i][j]);
+      EXPECT_EQ(std::string(j % 8, 'x'), names[i][j]);
+    }
+  }
+
+  for (auto& session : sessions)
+    EXPECT_FALSE(session->Join());
+  EXPECT_EQ(kSessions * kCalls * (kCalls - 1) / 2, total.load());
+}
+
+TEST(ThreadPoolServer, Errors) {
+  auto dispatcher =
+      BindInterface(Counter::Add::Bind([](int value) { return value; }));
+  ThreadPoolServer<decltype(dispatcher)> server{dispatcher, 2};
+
+  // A call to an unbound method fails the connection, and the calls after it
+  // are discarded.
+  {
+    Session<decltype(server)> session{&server};
+    Client* client = session.client();
+
+    int value = 0;
+    auto callback = [&value](Status<int> status) { value = status.get(); };
+    Counter::Add::InvokeAsync(client, callback, 1);
+    Counter::Unbound::InvokeAsync(client, callback);
+    Counter::Add::InvokeAsync(client, callback, 2);
+
+    ASSERT_TRUE(client->ReceiveReply());
+    EXPECT_EQ(1, value);
+
+    auto status = session.Join();
+    ASSERT_FALSE(status);
+    EXPECT_EQ(ErrorStatus::InvalidInterfaceMethod, status.error());
+    EXPECT_FALSE(client->ReceiveReply());
+  }
+
+  // Frames larger than the limit are rejected before they are read.
+  {
+    ThreadPoolServer<decltype(dispatcher)> limited{dispatcher, 1, 8};
+    Session<decltype(limited)> session{&limited};
+    Counter::Add::InvokeAsync(session.client(), [](Status<int>) {}, 1);
+
+    auto status = session.Join();
+    ASSERT_FALSE(status);
+    EXPECT_EQ(ErrorStatus::ProtocolError, status.error());
+  }
+}
@@ -0,0 +1,232 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <fcntl.h>
+#include <gtest/gtest.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <nop/serializer.h>
+#include <nop/structure.h>
+#include <nop/table.h>
+#include <nop/types/file_handle.h>
+#include <nop/utility/exact_table_entries.h>
+#include <nop/utility/sizing_writer.h>
+#include <nop/utility/unix_socket_reader.h>
+#include <nop/utility/unix_socket_writer.h>
+
+using nop::Deserializer;
+using nop::Entry;
+using nop::ErrorStatus;
+using nop::ExactEncodingSize;
+using nop::ExactTableEntries;
+using nop::FileHandle;
+using nop::Serializer;
+using nop::UniqueFileHandle;
+using nop::UnixSocketReader;
+using nop::UnixSocketWriter;
+
+namespace {
+
+struct Frame {
+  std::string name;
+  UniqueFileHandle buffer;
+  std::vector<FileHandle> planes;
+  NOP_STRUCTURE(Frame, name, buffer, planes);
+};
+
+struct Planes {
+  Entry<std::vector<FileHandle>, 0> planes;
+  NOP_TABLE(Planes, planes);
+};
+
+// Returns a memfd holding |contents|.
+UniqueFileHandle MakeMemfd(const std::string& contents) {
+  UniqueFileHandle handle{
+      static_cast<int>(::syscall(SYS_memfd_create, "nop-test", 0))};
+  EXPECT_TRUE(handle);
+  EXPECT_EQ(static_cast<ssize_t>(contents.size()),
+            ::write(handle.get(), contents.data(), contents.size()));
+  return handle;
+}
+
+// Returns the contents of the file referred to by |fd| from the start.
+std::string ReadContents(int fd) {
+  char buffer[64];
+  const ssize_t size = ::pread(fd, buffer, sizeof(buffer), 0);
+  return size > 0 ? std::string(buffer, size) : std::string{};
+}
+
+struct Sockets {
+  Sockets() {
+    int fds[2];
+    EXPECT_EQ(0, ::socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    writer_fd = fds[0];
+    reader_fd = fds[1];
+  }
+
+  int writer_fd;
+  int reader_fd;
+};
+
+}  // anonymous namespace
+
+TEST(UnixSocket, SendHandles) {
+  Sockets sockets;
+  Serializer<UnixSocketWriter> serializer{sockets.writer_fd};
+  Deserializer<UnixSocketReader> deserializer{sockets.reader_fd};
+
+  UniqueFileHandle y = MakeMemfd("luma");
+  UniqueFileHandle uv = MakeMemfd("chroma");
+  Frame frame{"frame", MakeMemfd("pixels"), {FileHandle{y}, FileHandle{uv}}};
+  ASSERT_TRUE(serializer.Write(frame));
+  EXPECT_EQ(3u, serializer.writer().handle_count());
+  ASSERT_TRUE(serializer.writer().Send());
+  EXPECT_EQ(0u, serializer.writer().handle_count());
+
+  // A second message without handles.
+  ASSERT_TRUE(serializer.Write(std::string{"end"}));
+  ASSERT_TRUE(serializer.writer().Send());
+
+  ASSERT_TRUE(deserializer.reader().Receive());
+  EXPECT_EQ(3u, deserializer.reader().handle_count());
+  Frame received;
+  ASSERT_TRUE(deserializer.Read(&received));
+  EXPECT_TRUE(deserializer.reader().empty());
+
+  EXPECT_EQ("frame", received.name);
+  ASSERT_TRUE(received.buffer);
+  EXPECT_NE(frame.buffer.get(), received.buffer.get());
+  EXPECT_EQ("pixels", ReadContents(received.buffer.get()));
+  ASSERT_EQ(2u, received.planes.size());
+  EXPECT_EQ("luma", ReadContents(received.planes[0].get()));
+  EXPECT_EQ("chroma", ReadContents(received.planes[1].get()));
+  EXPECT_TRUE(::fcntl(received.buffer.get(), F_GETFD) & FD_CLOEXEC);
+
+  // The next message closes the borrowed handles but not the owned one.
+  const int borrowed = received.planes[0].get();
+  ASSERT_TRUE(deserializer.reader().Receive());
+  EXPECT_EQ(0u, deserializer.reader().handle_count());
+  EXPECT_EQ(-1, ::fcntl(borrowed, F_GETFD));
+  EXPECT_EQ("pixels", ReadContents(received.buffer.get()));
+
+  std::string end;
+  ASSERT_TRUE(deserializer.Read(&end));
+  EXPECT_EQ("end", end);
+
+  ::close(sockets.writer_fd);
+  serializer.writer().Release();
+  EXPECT_EQ(ErrorStatus::ReadLimitReached,
+            deserializer.reader().Receive().error());
+}
+
+TEST(UnixSocket, ExactTableEntries) {
+  Sockets sockets;
+  Serializer<ExactTableEntries<UnixSocketWriter>> serializer{
+      sockets.writer_fd};
+  Deserializer<UnixSocketReader> deserializer{sockets.reader_fd};
+
+  UniqueFileHandle y = MakeMemfd("luma");
+  UniqueFileHandle uv = MakeMemfd("chroma");
+  Planes planes;
+  planes.planes = std::vector<FileHandle>{FileHandle{y}, FileHandle{uv}};
+
+  // The table entry is written without padding for the handle references.
+  auto padded_size = ExactEncodingSize<UnixSocketWriter>(planes);
+  auto exact_size =
+      ExactEncodingSize<ExactTableEntries<UnixSocketWriter>>(planes);
+  ASSERT_TRUE(padded_size);
+  ASSERT_TRUE(exact_size);
+  EXPECT_EQ(padded_size.get() - 2u * 8u, exact_size.get());
+
+  ASSERT_TRUE(serializer.Write(planes));
+  EXPECT_EQ(exact_size.get(), serializer.writer().offset());
+  ASSERT_TRUE(serializer.writer().Send());
+
+  ASSERT_TRUE(deserializer.reader().Receive());
+  Planes received;
+  ASSERT_TRUE(deserializer.Read(&received));
+  EXPECT_TRUE(deserializer.reader().empty());
+  ASSERT_TRUE(received.planes);
+  ASSERT_EQ(2u, received.planes.get().size());
+  EXPECT_EQ("luma", ReadContents(received.planes.get()[0].get()));
+  EXPECT_EQ("chroma", ReadContents(received.planes.get()[1].get()));
+}
+
+TEST(UnixSocket, AcrossProcesses) {
+  Sockets sockets;
+  const pid_t pid = ::fork();
+  ASSERT_LE(0, pid);
+  if (pid == 0) {
+    // The child sends a memfd that the parent reads after the child exits.
+    ::close(sockets.reader_fd);
+    Serializer<UnixSocketWriter> serializer{sockets.writer_fd};
+    Frame frame{"child", MakeMemfd("from child"), {}};
+    const bool sent = serializer.Write(frame) && serializer.writer().Send();
+    ::_exit(sent ? 0 : 1);
+  }
+
+  ::close(sockets.writer_fd);
+  int child_status = -1;
+  ASSERT_EQ(pid, ::waitpid(pid, &child_status, 0));
+  EXPECT_EQ(0, child_status);
+
+  Deserializer<UnixSocketReader> deserializer{sockets.reader_fd};
+  ASSERT_TRUE(deserializer.reader().Receive());
+  Frame received;
+  ASSERT_TRUE(deserializer.Read(&received));
+  EXPECT_EQ("child", received.name);
+  EXPECT_EQ("from child", ReadContents(received.buffer.get()));
+}
+
+TEST(UnixSocket, Errors) {
+  Sockets sockets;
+  UnixSocketWriter writer{sockets.writer_fd};
+  UnixSocketReader reader{sockets.reader_fd, 16};
+
+  // Too many handles for one message.
+  UniqueFileHandle memfd = MakeMemfd("x");
+  FileHandle handle{memfd};
+  for (std::size_t i = 0; i < UnixSocketWriter::kMaxHandles; i++)
+    ASSERT_TRUE(writer.PushHandle(handle));
+  EXPECT_EQ(ErrorStatus::WriteLimitReached, writer.PushHandle(handle).error());
+  writer.Discard();
+  EXPECT_EQ(0u, writer.handle_count());
+
+  // References to handles that were not received.
+  ASSERT_TRUE(Serializer<UnixSocketWriter*>{&writer}.Write(handle));
+  ASSERT_TRUE(writer.Send());
+  ASSERT_TRUE(reader.Receive());
+  EXPECT_EQ(ErrorStatus::InvalidHandleReference,
+            reader.GetHandle<FileHandle>(1).error());
+  UniqueFileHandle owned;
+  ASSERT_TRUE(Deserializer<UnixSocketReader*>{&reader}.Read(&owned));
+  EXPECT_TRUE(owned);
+  EXPECT_EQ(ErrorStatus::InvalidHandleReference,
+            reader.GetHandle<UniqueFileHandle>(0).error());
+  EXPECT_FALSE(reader.GetHandle<FileHandle>(nop::kEmptyHandleReference)
+                   .get());
+
+  // Oversized messages.
+  ASSERT_TRUE(
+      Serializer<UnixSocketWriter*>{&writer}.Write(std::string(32, 'x')));
+  ASSERT_TRUE(writer.Send());
+  EXPECT_EQ(ErrorStatus::ProtocolError, reader.Receive().error());
+}
@@ -0,0 +1,202 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <nop/serializer.h>
+#include <nop/structure.h>
+#include <nop/utility/python_module.h>
+#include <nop/utility/vector_writer.h>
+#include <nop/utility/wire_view.h>
+
+#include "test_utilities.h"
+
+using nop::Compose;
+using nop::EncodingByte;
+using nop::ErrorStatus;
+using nop::Float;
+using nop::InspectValue;
+using nop::Optional;
+using nop::PythonSchema;
+using nop::PythonWireValue;
+using nop::Serializer;
+using nop::Status;
+using nop::VectorWriter;
+using nop::WireKind;
+using nop::WireValue;
+
+namespace {
+
+enum class Color : std::uint8_t { Red, Green, Blue };
+
+struct Point {
+  float x;
+  float y;
+  NOP_STRUCTURE(Point, x, y);
+};
+NOP_PYTHON_STRUCTURE(Point, x, y);
+
+struct Sample {
+  std::uint64_t timestamp;
+  Color color;
+  std::string label;
+  std::vector<std::int16_t> counts;
+  std::vector<Point> points;
+  Optional<double> scale;
+  NOP_STRUCTURE(Sample, timestamp, color, label, counts, points, scale);
+};
+NOP_PYTHON_STRUCTURE(Sample, timestamp, color, label, counts, points, scale);
+
+}  // anonymous namespace
+
+NOP_PYTHON_MODULE(Point, Sample);
+
+namespace {
+
+template <typename T>
+std::vector<std::uint8_t> Encode(const T& value) {
+  Serializer<VectorWriter> serializer;
+  EXPECT_TRUE(serializer.Write(value));
+  return serializer.writer().Take();
+}
+
+}  // anonymous namespace
+
+TEST(WireView, Scalars) {
+  std::vector<std::uint8_t> data;
+  Status<WireValue> status;
+
+  data = Compose(10);
+  status = InspectValue(data.data(), data.size());
+  ASSERT_TRUE(status);
+  EXPECT_EQ(WireKind::Integer, status.get().kind);
+  EXPECT_EQ(10, status.get().integer);
+  EXPECT_EQ(1u, status.get().size);
+
+  data = Encode(std::int32_t{-100000});
+  status = InspectValue(data.data(), data.size());
+  ASSERT_TRUE(status);
+  EXPECT_EQ(EncodingByte::I32, status.get().prefix);
+  EXPECT_EQ(-100000, status.get().integer);
+  EXPECT_EQ(5u, status.get().size);
+
+  data = Encode(std::uint64_t{0xffffffffffffffffULL});
+  status = InspectValue(data.data(), data.size());
+  ASSERT_TRUE(status);
+  EXPECT_EQ(0xffffffffffffffffULL, status.get().unsigned_integer);
+
+  data = Encode(2.5);
+  status = InspectValue(data.data(), data.size());
+  ASSERT_TRUE(status);
+  EXPECT_EQ(WireKind::Float, status.get().kind);
+  EXPECT_EQ(2.5, status.get().real);
+
+  data = Encode(std::string{"abc"});
+  status = InspectValue(data.data(), data.size());
+  ASSERT_TRUE(status);
+  EXPECT_EQ(WireKind::String, status.get().kind);
+  EXPECT_EQ(3u, status.get().count);
+  EXPECT_EQ(2u, status.get().header);
+  EXPECT_EQ(5u, status.get().size);
+}
+
+TEST(WireView, Containers) {
+  std::vector<std::uint8_t> data;
+  Status<WireValue> status;
+
+  data = Encode(std::vector<std::uint32_t>(100, 7));
+  status = InspectValue(data.data(), data.size());
+  ASSERT_TRUE(status);
+  EXPECT_EQ(WireKind::Binary, status.get().kind);
+  EXPECT_EQ(400u, status.get().count);
+  EXPECT_EQ(data.size() - 400, status.get().header);
+  EXPECT_EQ(data.size(), status.get().size);
+
+  data = Encode(std::vector<float>{1.f, 2.f, 3.f});
+  status = InspectValue(data.data(), data.size());
+  ASSERT_TRUE(status);
+  EXPECT_EQ(WireKind::Array, status.get().kind);
+  EXPECT_EQ(3u, status.get().count);
+  EXPECT_EQ(2u, status.get().header);
+  EXPECT_EQ(5u, status.get().stride);
+
+  // Arrays with mixed element prefixes have no stride.
+  data = Compose(EncodingByte::Array, 2, EncodingByte::F32, Float(1.f), 3);
+  status = InspectValue(data.data(), data.size());
+  ASSERT_TRUE(status);
+  EXPECT_EQ(0u, status.get().stride);
+
+  Sample sample{1, Color::Blue, "x", {1, 2}, {{1.f, 2.f}}, {}};
+  data = Encode(sample);
+  status = InspectValue(data.data(), data.size());
+  ASSERT_TRUE(status);
+  EXPECT_EQ(WireKind::Structure, status.get().kind);
+  EXPECT_EQ(6u, status.get().count);
+
+  // Walk the members: each starts where the previous one ends.
+  std::size_t offset = status.get().header;
+  std::vector<WireKind> kinds;
+  for (std::size_t i = 0; i < status.get().count; i++) {
+    auto member = InspectValue(data.data() + offset, data.size() - offset);
+    ASSERT_TRUE(member);
+    kinds.push_back(member.get().kind);
+    offset += member.get().size;
+  }
+  EXPECT_EQ(data.size(), offset);
+  EXPECT_EQ((std::vector<WireKind>{WireKind::Integer, WireKind::Integer,
+                                   WireKind::String, WireKind::Binary,
+                                   WireKind::Array, WireKind::Nil}),
+            kinds);
+}
+
+TEST(WireView, Errors) {
+  std::vector<std::uint8_t> data;
+  Status<WireValue> status;
+
+  status = InspectValue(data.data(), data.size());
+  EXPECT_FALSE(status);
+
+  data = Encode(std::vector<std::uint32_t>(10, 7));
+  data.pop_back();
+  status = InspectValue(data.data(), data.size());
+  ASSERT_FALSE(status);
+  EXPECT_EQ(ErrorStatus::ReadLimitReached, status.error());
+}
+
+TEST(PythonModule, Schema) {
+  EXPECT_EQ(
+      "{'Point': (('x', 'f4'), ('y', 'f4'), ), "
+      "'Sample': (('timestamp', 'u8'), ('color', 'u1'), ('label', 'str'), "
+      "('counts', ('array', 'i2')), ('points', ('list', 'Point')), "
+      "('scale', ('optional', 'f8')), ), }",
+      (PythonSchema<Point, Sample>()));
+  EXPECT_EQ((PythonSchema<Point, Sample>()), nop_python_schema());
+}
+
+TEST(PythonModule, Inspect) {
+  std::vector<std::uint8_t> data = Encode(std::vector<double>{1.0, 2.0});
+  PythonWireValue value;
+
+  ASSERT_EQ(0, nop_python_inspect(data.data(), data.size(), &value));
+  EXPECT_EQ(static_cast<std::uint8_t>(WireKind::Array), value.kind);
+  EXPECT_EQ(2u, value.count);
+  EXPECT_EQ(9u, value.stride);
+  EXPECT_EQ(data.size(), value.size);
+
+  EXPECT_EQ(-static_cast<int>(ErrorStatus::ReadLimitReached),
+            nop_python_inspect(data.data(), data.size() - 1, &value));
+}
@@ -0,0 +1,712 @@
+// Copyright 2018 The Native Object Protocols Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <nop/serializer.h>
+#include <nop/structure.h>
+#include <nop/table.h>
+#include <nop/utility/buffer_reader.h>
+#include <nop/utility/buffered_fd_reader.h>
+#include <nop/utility/counting_writer.h>
+#include <nop/utility/inline_buffer_writer.h>
+#include <nop/utility/mmap_reader.h>
+#include <nop/utility/mmap_writer.h>
+#include <nop/utility/pedantic_buffer_writer.h>
+#include <nop/utility/scatter_gather_writer.h>
+#include <nop/utility/vector_writer.h>
+
+#include "test_reader.h"
+#include "test_utilities.h"
+#include "test_writer.h"
+
+using nop::BufferReader;
+using nop::BufferedFdReader;
+using nop::Compose;
+using nop::CountingWriter;
+using nop::DefaultHandlePolicy;
+using nop::Deserializer;
+using nop::EncodingByte;
+using nop::Entry;
+using nop::ErrorStatus;
+using nop::ExactTableEntries;
+using nop::Handle;
+using nop::InlineBufferWriter;
+using nop::Integer;
+using nop::IoStats;
+using nop::MmapReader;
+using nop::MmapWriter;
+using nop::PedanticBufferWriter;
+using nop::ScatterGatherWriter;
+using nop::Serializer;
+using nop::Status;
+using nop::SteadyClock;
+using nop::TestReader;
+using nop::TestWriter;
+using nop::UncheckedBufferWriter;
+using nop::VectorWriter;
+using nop::WriterHasUnchecked;
+
+namespace {
+
+struct Frame {
+  std::uint32_t sequence;
+  std::string label;
+  std::vector<std::uint8_t> pixels;
+  std::vector<std::uint16_t> depth;
+
+  bool operator==(const Frame& other) const {
+    return sequence == other.sequence && label == other.label &&
+           pixels == other.pixels && depth == other.depth;
+  }
+
+  NOP_STRUCTURE(Frame, sequence, label, pixels, depth);
+};
+
+struct Settings {
+  Entry<std::string, 0> name;
+  Entry<Frame, 1> frame;
+  NOP_TABLE(Settings, name, frame);
+};
+
+using IntHandle = Handle<DefaultHandlePolicy<int, -1>>;
+
+// Handles overestimate their size, padding the table entries that hold them.
+struct Resources {
+  Entry<IntHandle, 0> handle;
+  Entry<std::vector<IntHandle>, 1> handles;
+  NOP_TABLE(Resources, handle, handles);
+};
+
+struct Process {
+  Entry<Resources, 0> resources;
+  Entry<std::string, 1> name;
+  NOP_TABLE(Process, resources, name);
+};
+
+// Writer that appends to a vector and fails Prepare(), to verify whether the
+// serializer prepares writers that opt out of preparation.
+template <bool NeedsPrepare>
+class UnpreparedWriter {
+ public:
+  static constexpr bool kNeedsPrepare = NeedsPrepare;
+
+  Status<void> Prepare(std::size_t /*size*/) {
+    return ErrorStatus::WriteLimitReached;
+  }
+
+  Status<void> Write(std::uint8_t byte) {
+    data_.push_back(byte);
+    return {};
+  }
+
+  Status<void> Write(const void* begin, const void* end) {
+    data_.insert(data_.end(), static_cast<const std::uint8_t*>(begin),
+                 static_cast<const std::uint8_t*>(end));
+    return {};
+  }
+
+  Status<void> Skip(std::size_t padding_bytes,
+                    std::uint8_t padding_value = 0x00) {
+    data_.insert(data_.end(), padding_bytes, padding_value);
+    return {};
+  }
+
+  const std::vector<std::uint8_t>& data() const { return data_; }
+
+ private:
+  std::vector<std::uint8_t> data_;
+};
+
+// Reserves a temporary file name that is deleted when the object is destroyed.
+struct TempPath {
+  TempPath() {
+    char name[] = "/tmp/nop_writer_tests.XXXXXX";
+    const int fd = mkstemp(name);
+    EXPECT_LE(0, fd);
+    close(fd);
+    path = name;
+  }
+  ~TempPath() { unlink(path.c_str()); }
+
+  std::size_t FileSize() const {
+    struct stat stat_buf;
+    EXPECT_EQ(0, stat(path.c_str(), &stat_buf));
+    return static_cast<std::size_t>(stat_buf.st_size);
+  }
+
+  std::string path;
+};
+
+// Value whose encoding underestimates its size, as a buggy user encoding might.
+struct Underestimated {
+  std::uint32_t value;
+};
+
+}  // anonymous namespace
+
+namespace nop {
+
+template <>
+struct Encoding<Underestimated> : EncodingIO<Underestimated> {
+  static constexpr EncodingByte Prefix(const Underestimated& value) {
+    return Encoding<std::uint32_t>::Prefix(value.value);
+  }
+
+  static constexpr std::size_t Size(const Underestimated& value) {
+    return Encoding<std::uint32_t>::Size(value.value) - 2;
+  }
+
+  static constexpr bool Match(EncodingByte prefix) {
+    return Encoding<std::uint32_t>::Match(prefix);
+  }
+
+  template <typename Writer>
+  static constexpr Status<void> WritePayload(EncodingByte prefix,
+                                             const Underestimated& value,
+                                             Writer* writer) {
+    return Encoding<std::uint32_t>::WritePayload(prefix, value.value, writer);
+  }
+
+  template <typename Reader>
+  static constexpr Status<void> ReadPayload(EncodingByte prefix,
+                                            Underestimated* value,
+                                            Reader* reader) {
+    return Encoding<std::uint32_t>::ReadPayload(prefix, &value->value,
+                                                reader);
+  }
+};
+
+}  // namespace nop
+
+TEST(VectorWriter, Write) {
+  Serializer<VectorWriter> serializer;
+  EXPECT_EQ(0u, serializer.writer().capacity());
+
+  ASSERT_TRUE(serializer.Write(std::string{"foo"}));
+  std::vector<std::uint8_t> expected = Compose(EncodingByte::String, 3, "foo");
+  EXPECT_EQ(expected, std::vector<std::uint8_t>(
+                          serializer.writer().data(),
+                          serializer.writer().data() +
+                              serializer.writer().size()));
+
+  ASSERT_TRUE(serializer.Write(std::vector<std::uint32_t>(1000, 0xaa55)));
+  EXPECT_EQ(5u + 1u + 3u + 4000u, serializer.writer().size());
+  EXPECT_LE(serializer.writer().size(), serializer.writer().capacity());
+
+  Deserializer<BufferReader> deserializer{serializer.writer().data(),
+                                          serializer.writer().size()};
+  std::string string_value;
+  ASSERT_TRUE(deserializer.Read(&string_value));
+  EXPECT_EQ("foo", string_value);
+
+  std::vector<std::uint32_t> vector_value;
+  ASSERT_TRUE(deserializer.Read(&vector_value));
+  EXPECT_EQ(std::vector<std::uint32_t>(1000, 0xaa55), vector_value);
+  EXPECT_TRUE(deserializer.reader().empty());
+}
+
+TEST(VectorWriter, ResetKeepsCapacity) {
+  Serializer<VectorWriter> serializer;
+  const std::vector<std::uint8_t> value(100, 1);
+
+  ASSERT_TRUE(serializer.Write(value));
+  const std::size_t capacity = serializer.writer().capacity();
+  const std::uint8_t* data = serializer.writer().data();
+
+  for (int i = 0; i < 10; i++) {
+    serializer.writer().Reset();
+    EXPECT_EQ(0u, serializer.writer().size());
+
+    ASSERT_TRUE(serializer.Write(value));
+    EXPECT_EQ(capacity, serializer.writer().capacity());
+    EXPECT_EQ(data, serializer.writer().data());
+  }
+
+  std::vector<std::uint8_t> taken = serializer.writer().Take();
+  EXPECT_EQ(serializer.GetSize(value), taken.size());
+  EXPECT_EQ(0u, serializer.writer().size());
+  EXPECT_EQ(0u, serializer.writer().capacity());
+}
+
+TEST(VectorWriter, ZeroLength) {
+  // Empty writes at the end of the storage, including writes to a writer
+  // without storage, must not index past the end of the buffer.
+  VectorWriter empty_writer;
+  const std::uint8_t* null_range = nullptr;
+  EXPECT_TRUE(empty_writer.Write(null_range, null_range));
+  EXPECT_TRUE(empty_writer.Skip(0));
+  EXPECT_EQ(0u, empty_writer.size());
+
+  Serializer<VectorWriter> serializer{VectorWriter{16}};
+  const std::vector<std::uint8_t> value(14, 0xaa);
+  ASSERT_TRUE(serializer.Write(value));
+  ASSERT_EQ(16u, serializer.writer().size());
+  ASSERT_EQ(16u, serializer.writer().capacity());
+
+  const std::vector<std::uint8_t> empty;
+  EXPECT_TRUE(serializer.writer().Write(empty.data(), empty.data()));
+  EXPECT_TRUE(serializer.writer().Skip(0));
+  EXPECT_TRUE(serializer.writer().Patch(16, empty.data(), empty.data()));
+  EXPECT_EQ(16u, serializer.writer().size());
+
+  ASSERT_TRUE(serializer.Write(empty));
+  EXPECT_EQ(18u, serializer.writer().size());
+}
+
+TEST(InlineBufferWriter, Write) {
+  Serializer<InlineBufferWriter<16>> serializer;
+  EXPECT_TRUE(serializer.writer().is_inline());
+  EXPECT_EQ(16u, serializer.writer().capacity());
+
+  ASSERT_TRUE(serializer.Write(std::string{"foo"}));
+  EXPECT_TRUE(serializer.writer().is_inline());
+  std::vector<std::uint8_t> expected = Compose(EncodingByte::String, 3, "foo");
+  EXPECT_EQ(expected, std::vector<std::uint8_t>(
+                          serializer.writer().data(),
+                          serializer.writer().data() +
+                              serializer.writer().size()));
+
+  // Spills to the heap, keeping the data already written.
+  ASSERT_TRUE(serializer.Write(std::vector<std::uint32_t>(1000, 0xaa55)));
+  EXPECT_FALSE(serializer.writer().is_inline());
+  EXPECT_EQ(5u + 1u + 3u + 4000u, serializer.writer().size());
+  EXPECT_LE(serializer.writer().size(), serializer.writer().capacity());
+
+  Deserializer<BufferReader> deserializer{serializer.writer().data(),
+                                          serializer.writer().size()};
+  std::string string_value;
+  ASSERT_TRUE(deserializer.Read(&string_value));
+  EXPECT_EQ("foo", string_value);
+
+  std::vector<std::uint32_t> vector_value;
+  ASSERT_TRUE(deserializer.Read(&vector_value));
+  EXPECT_EQ(std::vector<std::uint32_t>(1000, 0xaa55), vector_value);
+  EXPECT_TRUE(deserializer.reader().empty());
+
+  // The heap storage is kept across Reset() and released by Shrink().
+  const std::size_t capacity = serializer.writer().capacity();
+  serializer.writer().Reset();
+  ASSERT_TRUE(serializer.Write(std::string{"foo"}));
+  EXPECT_FALSE(serializer.writer().is_inline());
+  EXPECT_EQ(capacity, serializer.writer().capacity());
+
+  serializer.writer().Shrink();
+  EXPECT_TRUE(serializer.writer().is_inline());
+  EXPECT_EQ(16u, serializer.writer().capacity());
+  EXPECT_EQ(expected, std::vector<std::uint8_t>(
+                          serializer.writer().data(),
+                          serializer.writer().data() +
+                              serializer.writer().size()));
+}
+
+TEST(InlineBufferWriter, Move) {
+  InlineBufferWriter<16> inline_writer;
+  ASSERT_TRUE(Serializer<InlineBufferWriter<16>*>{&inline_writer}.Write(1234));
+  const std::vector<std::uint8_t> expected =
+      Compose(EncodingByte::I16, Integer<std::int16_t>(1234));
+
+  InlineBufferWriter<16> moved_inline{std::move(inline_writer)};
+  EXPECT_TRUE(moved_inline.is_inline());
+  EXPECT_EQ(expected, std::vector<std::uint8_t>(
+                          moved_inline.data(),
+                          moved_inline.data() + moved_inline.size()));
+  EXPECT_EQ(0u, inline_writer.size());
+  EXPECT_TRUE(inline_writer.is_inline());
+
+  InlineBufferWriter<16> heap_writer;
+  const std::vector<std::uint8_t> value(100, 1);
+  ASSERT_TRUE(Serializer<InlineBufferWriter<16>*>{&heap_writer}.Write(value));
+  EXPECT_FALSE(heap_writer.is_inline());
+  const std::uint8_t* data = heap_writer.data();
+
+  // Moving a spilled writer moves the heap storage.
+  InlineBufferWriter<16> moved_heap;
+  moved_heap = std::move(heap_writer);
+  EXPECT_FALSE(moved_heap.is_inline());
+  EXPECT_EQ(data, moved_heap.data());
+  EXPECT_EQ(0u, heap_writer.size());
+  EXPECT_TRUE(heap_writer.is_inline());
+
+  // Taking the data out of a spilled writer does not copy.
+  std::vector<std::uint8_t> taken = moved_heap.Take();
+  EXPECT_EQ(data, taken.data());
+  EXPECT_EQ(Serializer<VectorWriter>{}.GetSize(value), taken.size());
+  EXPECT_TRUE(moved_heap.is_inline());
+  EXPECT_EQ(0u, moved_heap.size());
+
+  taken = moved_inline.Take();
+  EXPECT_EQ(expected, taken);
+  EXPECT_EQ(0u, moved_inline.size());
+}
+
+TEST(ScatterGatherWriter, ReferencesLargePayloads) {
+  Frame frame{7, "camera", std::vector<std::uint8_t>(4096, 0x11),
+              std::vector<std::uint16_t>(2048, 0x2233)};
+
+  Serializer<ScatterGatherWriter> serializer;
+  ASSERT_TRUE(serializer.Write(frame));
+
+  // The struct header, sequence, label and the pixels prefix are copied into
+  // one internal segment, each payload is referenced by its own segment and the
+  // depth prefix is copied into a second internal segment.
+  EXPECT_EQ(4u, serializer.writer().segment_count());
+  EXPECT_EQ(serializer.GetSize(frame), serializer.writer().size());
+
+  Serializer<VectorWriter> reference;
+  ASSERT_TRUE(reference.Write(frame));
+  EXPECT_EQ(std::vector<std::uint8_t>(
+                reference.writer().data(),
+                reference.writer().data() + reference.writer().size()),
+            serializer.writer().Gather());
+}
+
+TEST(ScatterGatherWriter, ZeroLength) {
+  const std::vector<std::uint8_t> payload(300, 0x11);
+  const std::vector<std::uint8_t> empty;
+
+  // Empty writes add no segments, even after a referenced payload.
+  ScatterGatherWriter writer;
+  ASSERT_TRUE(writer.Write(payload.data(), payload.data() + payload.size()));
+  ASSERT_TRUE(writer.Write(empty.data(), empty.data()));
+  ASSERT_TRUE(writer.Skip(0));
+  EXPECT_EQ(1u, writer.segment_count());
+  EXPECT_EQ(payload, writer.Gather());
+
+  ScatterGatherWriter zero_threshold{0u};
+  ASSERT_TRUE(zero_threshold.Write(empty.data(), empty.data()));
+  EXPECT_EQ(0u, zero_threshold.segment_count());
+  EXPECT_EQ(empty, zero_threshold.Gather());
+}
+
+TEST(ScatterGatherWriter, WriteTo) {
+  int fds[2];
+  ASSERT_EQ(0, pipe(fds));
+
+  Frame frame{1, "depth", std::vector<std::uint8_t>(1000, 0x44),
+              std::vector<std::uint16_t>(500, 0x5566)};
+
+  Serializer<ScatterGatherWriter> serializer{64u};
+  ASSERT_TRUE(serializer.Write(frame));
+  ASSERT_TRUE(serializer.writer().WriteTo(fds[1]));
+  EXPECT_EQ(0u, serializer.writer().size());
+  close(fds[1]);
+
+  Deserializer<BufferedFdReader> deserializer{fds[0]};
+  Frame result;
+  ASSERT_TRUE(deserializer.Read(&result));
+  EXPECT_EQ(frame, result);
+}
+
+TEST(Serializer, SkipsPrepare) {
+  static_assert(nop::WriterNeedsPrepare<VectorWriter>::value, "");
+  static_assert(!nop::WriterNeedsPrepare<ScatterGatherWriter>::value, "");
+
+  Settings settings;
+  settings.name = std::string{"camera"};
+  settings.frame = Frame{3, "rgb", {1, 2, 3}, {4, 5, 6}};
+
+  Serializer<UnpreparedWriter<true>> prepared;
+  EXPECT_EQ(ErrorStatus::WriteLimitReached, prepared.Write(settings).error());
+
+  // Tables still compute the sizes of their entries when Prepare() is skipped.
+  Serializer<UnpreparedWriter<false>> unprepared;
+  ASSERT_TRUE(unprepared.Write(settings));
+  EXPECT_EQ(unprepared.GetSize(settings), unprepared.writer().data().size());
+
+  Serializer<VectorWriter> reference;
+  ASSERT_TRUE(reference.Write(settings));
+  EXPECT_EQ(std::vector<std::uint8_t>(
+                reference.writer().data(),
+                reference.writer().data() + reference.writer().size()),
+            unprepared.writer().data());
+}
+
+TEST(Serializer, ExactTableEntries) {
+  Process value;
+  value.resources = Resources{};
+  value.resources.get().handle = IntHandle{3};
+  value.resources.get().handles = std::vector<IntHandle>(20, IntHandle{4});
+  value.name = std::string{"init"};
+
+  const auto handle = [](std::uint8_t reference) {
+    return Compose(EncodingByte::Handle, 0, reference);
+  };
+  std::vector<std::uint8_t> handles = Compose(EncodingByte::Array, 20);
+  for (std::uint8_t i = 0; i < 20; i++)
+    handles = Compose(handles, handle(i + 1));
+
+  // Each handle is estimated as 11 bytes, making the padded resources entry
+  // 20 * 11 + 2 = 222 bytes and the exact entry 20 * 3 + 2 = 62 bytes. The
+  // exact length keeps the width of the estimated length.
+  const std::vector<std::uint8_t> resources =
+      Compose(EncodingByte::Table, 0, 2, 0, 3, handle(0), 1, EncodingByte::U8,
+              62, handles);
+  const std::vector<std::uint8_t> expected = Compose(
+      EncodingByte::Table, 0, 2, 0, EncodingByte::U8, resources.size(),
+      resources, 1, 6, EncodingByte::String, 4, "init");
+
+  Serializer<ExactTableEntries<TestWriter>> serializer;
+  ASSERT_TRUE(serializer.Write(value));
+  EXPECT_EQ(expected, serializer.writer().data());
+
+  // The exact encoding is smaller than the padded encoding.
+  Serializer<TestWriter> padded_serializer;
+  ASSERT_TRUE(padded_serializer.Write(value));
+  EXPECT_GT(padded_serializer.writer().data().size(), expected.size());
+
+  TestReader reader;
+  reader.Set(serializer.writer().data());
+  reader.SetHandles(serializer.writer().handles());
+  Deserializer<TestReader*> deserializer{&reader};
+  Process copy;
+  ASSERT_TRUE(deserializer.Read(&copy));
+  ASSERT_TRUE(copy.resources);
+  EXPECT_EQ(3, copy.resources.get().handle.get().get());
+  ASSERT_TRUE(copy.resources.get().handles);
+  EXPECT_EQ(20u, copy.resources.get().handles.get().size());
+  EXPECT_EQ("init", copy.name.get());
+}
+
+TEST(VectorWriter, ExactTableEntries) {
+  Settings value;
+  value.name = std::string{"settings"};
+  value.frame = Frame{1, "frame", {1, 2, 3}, {4, 5}};
+
+  // Exact sizes produce the same encoding with or without patching.
+  Serializer<VectorWriter> padded_serializer;
+  ASSERT_TRUE(padded_serializer.Write(value));
+
+  Serializer<ExactTableEntries<VectorWriter>> serializer;
+  ASSERT_TRUE(serializer.Write(value));
+  EXPECT_EQ(padded_serializer.writer().Take(), serializer.writer().Take());
+
+  VectorWriter writer;
+  ASSERT_TRUE(writer.Prepare(4));
+  const std::uint8_t bytes[] = {1, 2, 3};
+  ASSERT_TRUE(writer.Write(&bytes[0], &bytes[3]));
+  EXPECT_EQ(3u, writer.offset());
+  ASSERT_TRUE(writer.Patch(1, &bytes[0], &bytes[2]));
+  EXPECT_EQ(ErrorStatus::WriteLimitReached,
+            writer.Patch(2, &bytes[0], &bytes[2]).error());
+  EXPECT_EQ(Compose(1, 1, 2), writer.Take());
+}
+
+TEST(PedanticBufferWriter, Unchecked) {
+  EXPECT_TRUE(WriterHasUnchecked<PedanticBufferWriter>::value);
+  EXPECT_FALSE(WriterHasUnchecked<VectorWriter>::value);
+  EXPECT_FALSE(WriterHasUnchecked<CountingWriter<PedanticBufferWriter>>::value);
+
+  const Frame frame{1, "label", {1, 2, 3}, {4, 5, 6, 7}};
+  Serializer<VectorWriter> reference;
+  ASSERT_TRUE(reference.Write(frame));
+  const std::vector<std::uint8_t> expected = reference.writer().Take();
+
+  // Prepared values are encoded without per-write checks, with the same
+  // output. Consecutive values are appended.
+  std::vector<std::uint8_t> buffer(2 * expected.size());
+  Serializer<PedanticBufferWriter> serializer{buffer.data(), buffer.size()};
+  ASSERT_TRUE(serializer.Write(frame));
+  EXPECT_EQ(expected.size(), serializer.writer().size());
+  ASSERT_TRUE(serializer.Write(frame));
+  EXPECT_EQ(buffer.size(), serializer.writer().size());
+  EXPECT_EQ(expected, std::vector<std::uint8_t>(
+                          buffer.begin(), buffer.begin() + expected.size()));
+  EXPECT_EQ(expected, std::vector<std::uint8_t>(
+                          buffer.begin() + expected.size(), buffer.end()));
+
+  // The single check of the prepared size still rejects values that do not
+  // fit, without writing.
+  EXPECT_EQ(ErrorStatus::WriteLimitReached, serializer.Write(frame).error());
+  EXPECT_EQ(buffer.size(), serializer.writer().size());
+
+  // Direct writes remain checked.
+  PedanticBufferWriter writer{buffer.data(), 1};
+  const std::uint8_t bytes[] = {1, 2};
+  EXPECT_EQ(ErrorStatus::WriteLimitReached,
+            writer.Write(&bytes[0], &bytes[2]).error());
+
+  UncheckedBufferWriter unchecked{buffer.data(), buffer.data() + 4};
+  ASSERT_TRUE(unchecked.Write(&bytes[0], &bytes[2]));
+  ASSERT_TRUE(unchecked.Skip(2, 9));
+  EXPECT_EQ(buffer.data() + 4, unchecked.cursor());
+  EXPECT_EQ(Compose(1, 2, 9, 9),
+            std::vector<std::uint8_t>(buffer.begin(), buffer.begin() + 4));
+
+  // The unchecked writer still stops at the end of the prepared space.
+  EXPECT_EQ(ErrorStatus::WriteLimitReached, unchecked.Write(bytes[0]).error());
+  EXPECT_EQ(ErrorStatus::WriteLimitReached,
+            unchecked.Write(&bytes[0], &bytes[1]).error());
+  EXPECT_EQ(ErrorStatus::WriteLimitReached, unchecked.Skip(1).error());
+  EXPECT_EQ(buffer.data() + 4, unchecked.cursor());
+
+  // An encoding that underestimates its size fails instead of writing past
+  // the space it prepared.
+  std::vector<std::uint8_t> guarded(8, 0xee);
+  Serializer<PedanticBufferWriter> guarded_serializer{guarded.data(), 3u};
+  EXPECT_EQ(ErrorStatus::WriteLimitReached,
+            guarded_serializer.Write(Underestimated{0x12345678}).error());
+  EXPECT_EQ(std::vector<std::uint8_t>(5, 0xee),
+            std::vector<std::uint8_t>(guarded.begin() + 3, guarded.end()));
+}
+
+TEST(CountingWriter, Counts) {
+  const Frame frame{1, "label", {1, 2, 3}, {4, 5, 6, 7}};
+  VectorWriter vector_writer;
+  Serializer<CountingWriter<VectorWriter>> serializer{&vector_writer};
+  ASSERT_TRUE(serializer.Write(frame));
+
+  // Every byte of the output passes through the counting writer.
+  const IoStats& stats = serializer.writer().stats();
+  EXPECT_EQ(1u, stats.prepare_calls);
+  EXPECT_EQ(vector_writer.size(), stats.prepared_bytes);
+  EXPECT_EQ(vector_writer.size(), stats.bytes());
+  EXPECT_EQ(0u, stats.skip_calls);
+  EXPECT_EQ(0u, stats.errors);
+  EXPECT_EQ(0u, stats.ticks);
+
+  std::uint64_t histogram_calls = 0;
+  for (auto count : stats.transfer_sizes)
+    histogram_calls += count;
+  EXPECT_EQ(stats.transfer_calls, histogram_calls);
+  // The depth payload is the only transfer of 8 bytes.
+  EXPECT_EQ(1u, stats.transfer_sizes[IoStats::SizeBucket(8)]);
+
+  // Writers that ignore Prepare() are still not prepared.
+  UnpreparedWriter<false> unprepared_writer;
+  Serializer<CountingWriter<UnpreparedWriter<false>>> unprepared_serializer{
+      &unprepared_writer};
+  ASSERT_TRUE(unprepared_serializer.Write(frame));
+  EXPECT_EQ(0u, unprepared_serializer.writer().stats().prepare_calls);
+  EXPECT_EQ(vector_writer.size(), unprepared_writer.data().size());
+
+  serializer.writer().ResetStats();
+  EXPECT_EQ(0u, serializer.writer().stats().calls());
+}
+
+TEST(CountingWriter, Timing) {
+  VectorWriter vector_writer;
+  Serializer<CountingWriter<VectorWriter, SteadyClock>> serializer{
+      &vector_writer};
+  for (int i = 0; i < 100; i++)
+    ASSERT_TRUE(serializer.Write(std::string(1000, 'x')));
+  EXPECT_LT(0u, serializer.writer().stats().ticks);
+}
+
+TEST(IoStats, SizeBucket) {
+  EXPECT_EQ(0u, IoStats::SizeBucket(0));
+  EXPECT_EQ(1u, IoStats::SizeBucket(1));
+  EXPECT_EQ(2u, IoStats::SizeBucket(2));
+  EXPECT_EQ(2u, IoStats::SizeBucket(3));
+  EXPECT_EQ(3u, IoStats::SizeBucket(4));
+  EXPECT_EQ(11u, IoStats::SizeBucket(1024));
+  EXPECT_EQ(IoStats::kSizeBuckets - 1, IoStats::SizeBucket(~std::size_t{0}));
+
+  IoStats a, b;
+  a.transfer_calls = 1;
+  a.transfer_sizes[2] = 1;
+  b.transfer_calls = 2;
+  b.transfer_sizes[2] = 2;
+  a += b;
+  EXPECT_EQ(3u, a.transfer_calls);
+  EXPECT_EQ(3u, a.transfer_sizes[2]);
+}
+
+TEST(MmapWriter, Write) {
+  TempPath file;
+  const Frame frame{9, "export", std::vector<std::uint8_t>(3000, 0x3c),
+                    {1, 2, 3}};
+
+  // A one page extent makes the writer grow and remap several times.
+  auto writer = MmapWriter::Open(file.path, 1);
+  ASSERT_TRUE(writer);
+  EXPECT_EQ(static_cast<std::size_t>(sysconf(_SC_PAGESIZE)),
+            writer.get().extent());
+
+  Serializer<MmapWriter> serializer{writer.take()};
+  for (int i = 0; i < 10; i++)
+    ASSERT_TRUE(serializer.Write(frame));
+  const std::size_t size = serializer.writer().size();
+  EXPECT_LE(size, serializer.writer().capacity());
+  EXPECT_EQ(0u, serializer.writer().capacity() % serializer.writer().extent());
+  EXPECT_EQ(serializer.writer().capacity(), file.FileSize());
+
+  // Values larger than an extent are prepared in one step.
+  ASSERT_TRUE(serializer.Write(std::vector<std::uint8_t>(100000, 0x5a)));
+  EXPECT_LE(serializer.writer().size(), serializer.writer().capacity());
+  EXPECT_TRUE(serializer.writer().Sync());
+
+  // Closing truncates the file to the output.
+  const std::size_t total = serializer.writer().size();
+  ASSERT_TRUE(serializer.writer().Close());
+  EXPECT_FALSE(serializer.writer().is_open());
+  EXPECT_EQ(total, file.FileSize());
+  EXPECT_LT(size, total);
+
+  auto reader = MmapReader::Open(file.path);
+  ASSERT_TRUE(reader);
+  Deserializer<MmapReader> deserializer{reader.take()};
+  for (int i = 0; i < 10; i++) {
+    Frame result;
+    ASSERT_TRUE(deserializer.Read(&result));
+    EXPECT_EQ(frame, result);
+  }
+  std::vector<std::uint8_t> bytes;
+  ASSERT_TRUE(deserializer.Read(&bytes));
+  EXPECT_EQ(std::vector<std::uint8_t>(100000, 0x5a), bytes);
+  EXPECT_TRUE(deserializer.reader().empty());
+}
+
+TEST(MmapWriter, CloseOnDestruction) {
+  TempPath file;
+  {
+    auto writer = MmapWriter::Open(file.path);
+    ASSERT_TRUE(writer);
+    Serializer<MmapWriter> serializer{writer.take()};
+    ASSERT_TRUE(serializer.Write(std::string{"foo"}));
+  }
+  EXPECT_EQ(5u, file.FileSize());
+}
+
+TEST(MmapWriter, Errors) {
+  EXPECT_EQ(ErrorStatus::IOError,
+            MmapWriter::Open("/nonexistent/nop/file").error());
+
+  // Writers that are not open, including moved-from writers, reject output.
+  MmapWriter closed;
+  EXPECT_EQ(ErrorStatus::WriteLimitReached, closed.Prepare(1).error());
+  EXPECT_TRUE(closed.Close());
+
+  TempPath file;
+  auto writer = MmapWriter::Open(file.path);
+  ASSERT_TRUE(writer);
+  MmapWriter moved{writer.take()};
+  EXPECT_EQ(ErrorStatus::WriteLimitReached, writer.get().Prepare(1).error());
+  EXPECT_TRUE(moved.is_open());
+
+  ASSERT_TRUE(moved.Prepare(2));
+  ASSERT_TRUE(moved.Write(std::uint8_t{1}));
+  const std::uint8_t bytes[] = {7, 8};
+  EXPECT_EQ(ErrorStatus::WriteLimitReached,
+            moved.Patch(0, &bytes[0], &bytes[2]).error());
+  ASSERT_TRUE(moved.Patch(0, &bytes[0], &bytes[1]));
+  EXPECT_EQ(7u, moved.data()[0]);
+}